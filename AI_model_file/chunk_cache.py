@@ -0,0 +1,124 @@
+"""
+The SSBD videos preprocessed once, on every core, into a cache of chunks
+read in place (layout in native/chunk_cache.h).
+
+    cached = chunk_cache.preprocess(video_paths, 'ssbd_cache')
+    for video in cached:
+        for chunk in video.chunks():        # (n, 100, 100, 3) uint8, BGR
+            ...
+
+preprocess() runs native/build/ssbd_cache (make in native/), which
+decodes the videos missing from the cache in parallel, one ffmpeg each,
+and only hashes those already there: the cache is keyed on the bytes of a
+video and the chunking parameters, so a second run with the same videos
+decodes nothing. The chunks are those video_chunks.Chunker makes, read as
+views of a memory map.
+
+    python chunk_cache.py -d dir [--fps fps] [--verify] video...
+"""
+import argparse
+import os
+import struct
+import subprocess
+import sys
+import time
+
+import numpy as np
+
+import video_chunks
+
+TOOL = os.environ.get('SSBD_CACHE', os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                 'native', 'build', 'ssbd_cache'))
+MAGIC = 0x31425353          # "SSB1"
+HEADER = struct.Struct('<IIQ2QQQQQQ8I')
+
+
+class CachedVideo:
+    """A cache file, mapped read-only."""
+
+    def __init__(self, path):
+        self.path = path
+        self.map = np.memmap(path, dtype=np.uint8, mode='r')
+        if len(self.map) < HEADER.size:
+            raise ValueError('%s: not a chunk cache file' % path)
+        fields = HEADER.unpack_from(self.map[:HEADER.size].tobytes())
+        magic, header_bytes, self.video_size = fields[:3]
+        self.read, self.sampled, frames, chunks, size = fields[5:10]
+        self.step, self.frames, self.hop, width, height, self.bgr, self.partial, count = fields[10:18]
+        if magic != MAGIC or header_bytes != HEADER.size or size != len(self.map) \
+                or chunks + count * 8 != size or frames + self.sampled * height * width * 3 > chunks:
+            raise ValueError('%s: not a chunk cache file' % path)
+        self.size = (width, height)
+        self.images = self.map[frames:frames + self.sampled * height * width * 3].reshape(
+            self.sampled, height, width, 3)
+        self.table = self.map[chunks:size].view('<u4').reshape(count, 2)
+
+    def __len__(self):
+        return len(self.table)
+
+    def chunk(self, i):
+        first, count = self.table[i]
+        return self.images[first:first + count]
+
+    def chunks(self):
+        return (self.chunk(i) for i in range(len(self)))
+
+
+def open_cached(path):
+    return CachedVideo(path)
+
+
+def preprocess(videos, cache_dir, jobs=None, fps=None, target_fps=video_chunks.FPS,
+               frames=video_chunks.CHUNK_SIZE, hop=None, size=(video_chunks.WIDTH, video_chunks.HEIGHT),
+               bgr=True, partial=True):
+    """CachedVideo of each video, in order, building those not cached.
+    fps is that of .ppm/.pgm streams; ffprobe reads it from videos."""
+    if not os.path.exists(TOOL):
+        raise OSError('%s missing: run make in %s' % (TOOL, os.path.dirname(os.path.dirname(TOOL))))
+    command = [TOOL, '-d', cache_dir, '-f', str(target_fps), '-n', str(frames), '-o', str(hop or frames // 2),
+               '-s', '%dx%d' % size]
+    if jobs:
+        command += ['-j', str(jobs)]
+    if fps:
+        command += ['-r', str(fps)]
+    if not bgr:
+        command.append('-g')
+    if not partial:
+        command.append('-x')
+    result = subprocess.run(command + ['--'] + list(videos), capture_output=True, text=True)
+    lines = result.stdout.splitlines()
+    if result.returncode != 0 or len(lines) != len(videos) + 1:
+        raise ValueError(result.stderr.strip() or 'ssbd_cache failed')
+    preprocess.summary = lines[-1]
+    return [CachedVideo(line.split(' ', 3)[0]) for line in lines[:-1]]
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('videos', nargs='+')
+    ap.add_argument('-d', '--dir', required=True, help='cache directory')
+    ap.add_argument('-j', '--jobs', type=int, default=None)
+    ap.add_argument('--fps', type=float, default=None, help='of frame streams; ffprobe reads it from videos')
+    ap.add_argument('--verify', action='store_true', help='compare every chunk with video_chunks.Chunker')
+    args = ap.parse_args()
+
+    start = time.perf_counter()
+    cached = preprocess(args.videos, args.dir, jobs=args.jobs, fps=args.fps)
+    elapsed = time.perf_counter() - start
+    print(preprocess.summary)
+    print('%d videos, %d chunks ready in %.2f s' % (len(cached), sum(len(v) for v in cached), elapsed))
+    if args.verify:
+        for path, video in zip(args.videos, cached):
+            with video_chunks.Chunker(path, fps=args.fps) as chunker:
+                expected = [np.array(chunk) for chunk in chunker]
+            if len(expected) != len(video) or any(not np.array_equal(a, b)
+                                                  for a, b in zip(expected, video.chunks())):
+                raise ValueError('%s: cached chunks differ from video_chunks' % path)
+        print('every chunk matches video_chunks')
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except ValueError as e:
+        sys.exit(str(e))
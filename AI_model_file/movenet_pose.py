@@ -0,0 +1,175 @@
+"""
+MoveNet keypoints of every frame of a video from a persistent native
+worker (native/pose_worker.c, built as native/build/libpose_worker.so by
+make; make TFLITE=dir to run .tflite models).
+
+    worker = movenet_pose.PoseWorker('movenet_thunder.tflite')
+    for path in videos:
+        keypoints, frames = worker.run(path)    # (n, 17, 3) float32, []
+
+The model is loaded and its tensors allocated once, when the worker is
+made, and every video after that reuses them. Frames are decoded by
+ffmpeg into a pipe (.ppm/.pgm streams are read directly), letterboxed to
+the model's input as tf.image.resize_with_pad does on the worker's
+threads and run through the model while the next ones are decoded. The
+256x341 display frames get_movenet_data used to make for every frame are
+only made with display=True, as uint8.
+
+    python movenet_pose.py -m model video...    times the worker
+"""
+import argparse
+import ctypes
+import os
+import subprocess
+import sys
+import time
+
+import numpy as np
+
+LIB = os.environ.get('POSE_WORKER_LIB', os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                    'native', 'build', 'libpose_worker.so'))
+KEYPOINTS = 17
+INPUT_SIZE = 256
+DISPLAY_SIZE = (341, 256)
+
+
+class _Config(ctypes.Structure):
+    _fields_ = [('model', ctypes.c_char_p), ('size', ctypes.c_uint32), ('threads', ctypes.c_uint32),
+                ('model_threads', ctypes.c_uint32), ('slots', ctypes.c_uint32), ('display', ctypes.c_uint32),
+                ('display_width', ctypes.c_uint32), ('display_height', ctypes.c_uint32), ('rgb', ctypes.c_uint32)]
+
+
+class _Frame(ctypes.Structure):
+    _fields_ = [('keypoints', ctypes.POINTER(ctypes.c_float)), ('display', ctypes.POINTER(ctypes.c_uint8)),
+                ('index', ctypes.c_uint64)]
+
+
+class _Stats(ctypes.Structure):
+    _fields_ = [('frames', ctypes.c_uint64), ('videos', ctypes.c_uint64), ('letterbox', ctypes.c_double),
+                ('invoke', ctypes.c_double), ('decode', ctypes.c_double), ('memory', ctypes.c_size_t)]
+
+
+_lib = None
+
+
+def _library():
+    global _lib
+    if _lib is None:
+        if not os.path.exists(LIB):
+            raise OSError('%s missing: run make in %s' % (LIB, os.path.dirname(os.path.dirname(LIB))))
+        _lib = ctypes.CDLL(LIB)
+        _lib.PoseWorker_Open.restype = ctypes.c_void_p
+        _lib.PoseWorker_Open.argtypes = [ctypes.POINTER(_Config)]
+        _lib.PoseWorker_Start.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        _lib.PoseWorker_Next.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Frame)]
+        _lib.PoseWorker_Stop.argtypes = [ctypes.c_void_p]
+        _lib.PoseWorker_Stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Stats)]
+        _lib.PoseWorker_Close.argtypes = [ctypes.c_void_p]
+    return _lib
+
+
+class PoseWorker:
+    """A pose model loaded once, for one video after another."""
+
+    def __init__(self, model, size=INPUT_SIZE, threads=2, model_threads=1, slots=8, display=True, rgb=False):
+        lib = _library()
+        self._lib = lib
+        self._handle = None
+        self.size = size
+        self.display_size = DISPLAY_SIZE if display else None
+        config = _Config(model.encode(), size, threads, model_threads, slots, int(display), DISPLAY_SIZE[0],
+                         DISPLAY_SIZE[1], int(rgb))
+        self._handle = lib.PoseWorker_Open(ctypes.byref(config))
+        if not self._handle:
+            raise ValueError('%s: cannot load the model' % model)
+
+    def run(self, source, display=False):
+        """Keypoints (n, 17, 3) of every frame of a video, y, x and score,
+        and its display frames (n, 256, 341, 3) uint8 if asked for (the
+        worker must have been made with display=True), else []."""
+        if display and not self.display_size:
+            raise ValueError('this worker makes no display frames')
+        process = None
+        if source.endswith(('.ppm', '.pgm', '.pnm')):
+            stream = open(source, 'rb')
+        else:
+            process = subprocess.Popen(['ffmpeg', '-v', 'error', '-i', source, '-f', 'image2pipe', '-vcodec',
+                                        'ppm', '-'], stdout=subprocess.PIPE)
+            stream = process.stdout
+        keypoints = []
+        frames = []
+        status = -1
+        try:
+            if self._lib.PoseWorker_Start(self._handle, stream.fileno()) == 0:
+                frame = _Frame()
+                while (status := self._lib.PoseWorker_Next(self._handle, ctypes.byref(frame))) == 1:
+                    keypoints.append(np.ctypeslib.as_array(frame.keypoints, shape=(KEYPOINTS, 3)).copy())
+                    if display:
+                        width, height = self.display_size
+                        frames.append(np.ctypeslib.as_array(frame.display, shape=(height, width, 3)).copy())
+        finally:
+            if process:
+                process.kill()
+            stream.close()
+            self._lib.PoseWorker_Stop(self._handle)
+            if process:
+                process.wait()
+        if status != 0:
+            raise ValueError('%s: not a video, or cut short' % source)
+        keypoints = np.array(keypoints, dtype=np.float32).reshape(-1, KEYPOINTS, 3)
+        return keypoints, (np.array(frames) if display else [])
+
+    def stats(self):
+        """Frames, videos, seconds spent decoding, letterboxing and running
+        the model, and bytes held."""
+        stats = _Stats()
+        self._lib.PoseWorker_Stats(self._handle, ctypes.byref(stats))
+        return {'frames': stats.frames, 'videos': stats.videos, 'decode': stats.decode,
+                'letterbox': stats.letterbox, 'invoke': stats.invoke, 'memory': stats.memory}
+
+    def close(self):
+        if self._handle:
+            self._lib.PoseWorker_Close(self._handle)
+            self._handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('videos', nargs='+')
+    ap.add_argument('-m', '--model', required=True, help='.tflite MoveNet, or stub')
+    ap.add_argument('-j', '--threads', type=int, default=2, help='letterboxing threads')
+    ap.add_argument('--display', action='store_true', help='also make the 256x341 display frames')
+    ap.add_argument('--check', default=None, help='keypoints pose_keypoints wrote for the videos, to compare')
+    args = ap.parse_args()
+
+    start = time.perf_counter()
+    with PoseWorker(args.model, threads=args.threads, display=args.display) as worker:
+        loaded = time.perf_counter()
+        results = [worker.run(video, display=args.display)[0] for video in args.videos]
+        stats = worker.stats()
+    elapsed = time.perf_counter() - loaded
+    print('model loaded in %.3f s; %d frames of %d videos in %.2f s, %.0f frames/s: decode %.2f s, '
+          'letterbox %.2f s, invoke %.2f s, %d kB held'
+          % (loaded - start, stats['frames'], stats['videos'], elapsed, stats['frames'] / elapsed, stats['decode'],
+             stats['letterbox'], stats['invoke'], stats['memory'] // 1024))
+    if args.check:
+        expected = np.fromfile(args.check, dtype=np.float32).reshape(-1, KEYPOINTS, 3)
+        if not np.array_equal(np.concatenate(results), expected):
+            raise ValueError('%s: keypoints differ from pose_keypoints' % args.check)
+        print('keypoints match %s' % args.check)
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except ValueError as e:
+        sys.exit(str(e))
@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file           : chunk_cache.c
+  * @brief          : Keys of the chunk cache (layout in chunk_cache.h).
+  *
+  *                   ChunkCache_Hash() is a 128-bit non-cryptographic hash
+  *                   in the manner of xxHash64: four 64-bit lanes take 32
+  *                   bytes per round, so a video is hashed at memory speed.
+  *                   It tells apart versions of a video, not adversaries.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "chunk_cache.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define HASH_P1             0x9E3779B185EBCA87ULL
+#define HASH_P2             0xC2B2AE3D27D4EB4FULL
+#define HASH_P3             0x165667B19E3779F9ULL
+#define HASH_P4             0x85EBCA77C2B2AE63ULL
+
+/* Private function prototypes -----------------------------------------------*/
+static uint64_t Hash_Round(uint64_t acc, uint64_t word);
+static uint64_t Hash_Avalanche(uint64_t h);
+static uint64_t Hash_Read(const uint8_t *p);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  128-bit hash of size bytes.
+  */
+void ChunkCache_Hash(const uint8_t *data, size_t size, uint64_t hash[2])
+{
+  uint64_t v[4] = { HASH_P1 + HASH_P2, HASH_P2, 0U, 0U - HASH_P1 };
+  uint64_t tail = 0U;
+  size_t i = 0U;
+
+  for (; (i + 32U) <= size; i += 32U)
+  {
+    for (uint32_t k = 0U; k < 4U; k++)
+    {
+      v[k] = Hash_Round(v[k], Hash_Read(&data[i + (8U * k)]));
+    }
+  }
+  for (; (i + 8U) <= size; i += 8U)
+  {
+    v[(i / 8U) & 3U] = Hash_Round(v[(i / 8U) & 3U], Hash_Read(&data[i]));
+  }
+  for (uint32_t k = 0U; i < size; i++, k++)
+  {
+    tail |= (uint64_t)data[i] << (8U * k);
+  }
+  v[0] = Hash_Round(v[0], tail ^ (uint64_t)size);
+  hash[0] = Hash_Avalanche(((v[0] << 1) | (v[0] >> 63)) + ((v[1] << 7) | (v[1] >> 57))
+                           + ((v[2] << 12) | (v[2] >> 52)) + ((v[3] << 18) | (v[3] >> 46)));
+  hash[1] = Hash_Avalanche((v[3] * HASH_P3) ^ (v[2] * HASH_P4) ^ (v[1] * HASH_P1) ^ (v[0] * HASH_P2)
+                           ^ hash[0]);
+}
+
+/**
+  * @brief  Name of the cache file of a video and parameters.
+  * @param  header: video_size, video_hash and the parameters
+  * @param  key: 32 hex digits
+  */
+void ChunkCache_Key(const ChunkCache_HeaderTypeDef *header, char key[CHUNK_CACHE_KEY_CHARS + 1U])
+{
+  const uint64_t fields[] =
+  {
+    CHUNK_CACHE_MAGIC, header->video_size, header->video_hash[0], header->video_hash[1], header->step,
+    header->frames, header->hop, header->width, header->height, header->bgr, header->partial,
+  };
+  uint8_t bytes[sizeof(fields)];
+  uint64_t hash[2];
+
+  memcpy(bytes, fields, sizeof(fields));
+  ChunkCache_Hash(bytes, sizeof(bytes), hash);
+  (void)snprintf(key, CHUNK_CACHE_KEY_CHARS + 1U, "%016llx%016llx", (unsigned long long)hash[0],
+                 (unsigned long long)hash[1]);
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint64_t Hash_Round(uint64_t acc, uint64_t word)
+{
+  acc += word * HASH_P2;
+  acc = (acc << 31) | (acc >> 33);
+  return acc * HASH_P1;
+}
+
+static uint64_t Hash_Avalanche(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= HASH_P2;
+  h ^= h >> 29;
+  h *= HASH_P3;
+  h ^= h >> 32;
+  return h;
+}
+
+/* Little endian whatever the host */
+static uint64_t Hash_Read(const uint8_t *p)
+{
+  uint64_t w = 0U;
+
+  for (uint32_t k = 0U; k < 8U; k++)
+  {
+    w |= (uint64_t)p[k] << (8U * k);
+  }
+  return w;
+}
@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+  * @file           : chunk_cache.h
+  * @brief          : Cached chunks of a video, written by ssbd_cache and
+  *                   read in place (memory-mapped) by chunk_cache.py.
+  *
+  *                   A cache file holds what video_chunk makes of one video
+  *                   with one set of parameters, and is named after both:
+  *                     <dir>/<key[0:2]>/<key>.ssbd
+  *                   the key being 32 hex digits of ChunkCache_Key() over
+  *                   the bytes of the video and the parameters, so a video
+  *                   renamed or copied is found again and an edited one is
+  *                   not. Files are written under a temporary name and
+  *                   renamed, so a reader never sees half of one.
+  *
+  *                   Layout, little endian, every section 64-byte aligned:
+  *                     header    ChunkCache_HeaderTypeDef
+  *                     frames    uint8 [sampled][height][width][3]
+  *                     chunks    uint32 [chunks][2], first frame and count
+  *                   The sampled frames are stored once: the 50% overlapping
+  *                   chunks are runs of them, frames[first:first + count].
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CHUNK_CACHE_H
+#define __CHUNK_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define CHUNK_CACHE_MAGIC       0x31425353U     /* "SSB1" */
+#define CHUNK_CACHE_ALIGN       64U
+#define CHUNK_CACHE_KEY_CHARS   32U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t magic;
+  uint32_t header_bytes;    /* sizeof(ChunkCache_HeaderTypeDef)            */
+  uint64_t video_size;      /* bytes of the video                          */
+  uint64_t video_hash[2];   /* ChunkCache_Hash() of them                   */
+  uint64_t read;            /* source frames                               */
+  uint64_t sampled;         /* frames stored                               */
+  uint64_t frames_offset;   /* section offsets                             */
+  uint64_t chunks_offset;
+  uint64_t size;            /* of the file                                 */
+  /* VideoChunk_ConfigTypeDef the frames were made with */
+  uint32_t step;
+  uint32_t frames;          /* per full chunk                              */
+  uint32_t hop;
+  uint32_t width;
+  uint32_t height;
+  uint32_t bgr;
+  uint32_t partial;
+  uint32_t chunks;
+} ChunkCache_HeaderTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void ChunkCache_Hash(const uint8_t *data, size_t size, uint64_t hash[2]);
+void ChunkCache_Key(const ChunkCache_HeaderTypeDef *header, char key[CHUNK_CACHE_KEY_CHARS + 1U]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CHUNK_CACHE_H */
@@ -0,0 +1,408 @@
+/**
+  ******************************************************************************
+  * @file           : chunk_check.c
+  * @brief          : Check and time video_chunk against the notebook's way.
+  *
+  *                     chunk_check [-n frames] [-l long_frames] dir
+  *
+  *                   Writes a generated video of -n frames to dir as a PPM
+  *                   stream, a PGM stream and raw RGB frames, and checks
+  *                   that the chunks of video_chunk, read from the files
+  *                   and through a pipe, are those of the notebook: every
+  *                   frame read into memory, one in step kept, resized and
+  *                   sliced every hop, for several steps, hops, channel
+  *                   orders and with or without the partial chunks.
+  *                   Then streams -l generated frames through a pipe and
+  *                   checks that the memory held stays the same, reporting
+  *                   frames per second.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "video_chunk.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK_WIDTH         192U        /* of the generated frames         */
+#define CHECK_HEIGHT        144U
+#define CHECK_LONG_WIDTH    640U
+#define CHECK_LONG_HEIGHT   360U
+#define CHECK_PPM           0U
+#define CHECK_PGM           1U
+#define CHECK_RAW           2U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  int fd;
+  uint32_t format;          /* CHECK_*                                     */
+  uint32_t frames;
+  uint32_t width;
+  uint32_t height;
+} Check_WriterTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const char *check_names[] = { "ppm", "pgm", "raw" };
+
+/* Private function prototypes -----------------------------------------------*/
+static void Check_Frame(uint32_t index, uint32_t width, uint32_t height, uint32_t format, uint8_t *out);
+static int Check_Write(FILE *f, uint32_t format, uint32_t frames, uint32_t width, uint32_t height);
+static void *Check_Writer(void *arg);
+static int Check_Case(const char *path, uint32_t format, uint32_t frames, int piped, uint32_t step, uint32_t hop,
+                      uint32_t bgr, uint32_t partial);
+static void Check_Reference(const uint8_t *src, uint32_t format, uint32_t bgr, uint8_t *dst);
+static int Check_Long(uint32_t frames);
+static long Check_PeakKb(void);
+static double Check_Now(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  static const struct
+  {
+    uint32_t step;
+    uint32_t hop;
+    uint32_t bgr;
+    uint32_t partial;
+  } cases[] =
+  {
+    { 3U, VIDEO_CHUNK_SIZE / 2U, 1U, 1U },      /* the notebook at 30 fps */
+    { 1U, VIDEO_CHUNK_SIZE / 2U, 0U, 0U },
+    { 2U, VIDEO_CHUNK_SIZE, 1U, 1U },
+    { 5U, 7U, 0U, 1U },
+    { 1U, VIDEO_CHUNK_SIZE + 9U, 1U, 0U },
+  };
+  uint32_t frames = 250U;
+  uint32_t long_frames = 3000U;
+  char path[3][4096];
+  int failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:l:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        frames = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'l':
+        long_frames = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n frames] [-l long_frames] dir\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if (optind + 1 != argc)
+  {
+    fprintf(stderr, "usage: %s [-n frames] [-l long_frames] dir\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  for (uint32_t format = CHECK_PPM; format <= CHECK_RAW; format++)
+  {
+    FILE *f;
+
+    (void)snprintf(path[format], sizeof(path[format]), "%s/video.%s", argv[optind], check_names[format]);
+    f = fopen(path[format], "wb");
+    if ((f == NULL) || (Check_Write(f, format, frames, CHECK_WIDTH, CHECK_HEIGHT) != 0) || (fclose(f) != 0))
+    {
+      perror(path[format]);
+      return EXIT_FAILURE;
+    }
+  }
+  for (uint32_t i = 0U; i < (sizeof(cases) / sizeof(cases[0])); i++)
+  {
+    for (uint32_t format = CHECK_PPM; format <= CHECK_RAW; format++)
+    {
+      for (int piped = 0; piped <= 1; piped++)
+      {
+        failed |= Check_Case(path[format], format, frames, piped, cases[i].step, cases[i].hop, cases[i].bgr,
+                             cases[i].partial);
+      }
+    }
+  }
+  if (failed == 0)
+  {
+    printf("%s: chunks of %u frames match the notebook's in %u ways\n", argv[optind], frames,
+           (uint32_t)(sizeof(cases) / sizeof(cases[0])) * 6U);
+  }
+  failed |= Check_Long(long_frames);
+  return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Generated frame: PPM and raw RGB, PGM gray */
+static void Check_Frame(uint32_t index, uint32_t width, uint32_t height, uint32_t format, uint8_t *out)
+{
+  const uint32_t channels = (format == CHECK_PGM) ? 1U : 3U;
+
+  for (uint32_t y = 0U; y < height; y++)
+  {
+    for (uint32_t x = 0U; x < width; x++)
+    {
+      for (uint32_t c = 0U; c < channels; c++)
+      {
+        *out++ = (uint8_t)(((x * 3U) + ((y * y) / 7U) + (index * 11U) + (c * 80U) + ((x ^ y) & 16U)) & 0xFFU);
+      }
+    }
+  }
+}
+
+static int Check_Write(FILE *f, uint32_t format, uint32_t frames, uint32_t width, uint32_t height)
+{
+  const size_t bytes = (size_t)width * height * ((format == CHECK_PGM) ? 1U : 3U);
+  uint8_t *frame = malloc(bytes);
+  int failed = (frame == NULL);
+
+  for (uint32_t i = 0U; (i < frames) && (failed == 0); i++)
+  {
+    Check_Frame(i, width, height, format, frame);
+    if (format != CHECK_RAW)
+    {
+      /* a comment in some headers, as some writers do */
+      failed |= (fprintf(f, (i % 3U) ? "P%c\n%u %u\n255\n" : "P%c\n# frame\n%u %u\n255\n",
+                         (format == CHECK_PGM) ? '5' : '6', width, height) < 0);
+    }
+    failed |= (fwrite(frame, 1U, bytes, f) != bytes);
+  }
+  free(frame);
+  return failed;
+}
+
+static void *Check_Writer(void *arg)
+{
+  Check_WriterTypeDef *w = arg;
+  FILE *f = fdopen(w->fd, "wb");
+
+  if (f != NULL)
+  {
+    /* a reader that stops early makes the writes fail, which is fine */
+    (void)Check_Write(f, w->format, w->frames, w->width, w->height);
+    fclose(f);
+  }
+  else
+  {
+    close(w->fd);
+  }
+  return NULL;
+}
+
+static int Check_Case(const char *path, uint32_t format, uint32_t frames, int piped, uint32_t step, uint32_t hop,
+                      uint32_t bgr, uint32_t partial)
+{
+  VideoChunk_ConfigTypeDef config = VIDEO_CHUNK_CONFIG_DEFAULT;
+  const size_t frame_bytes = (size_t)VIDEO_CHUNK_WIDTH * VIDEO_CHUNK_HEIGHT * VIDEO_CHUNK_CHANNELS;
+  const size_t src_bytes = (size_t)CHECK_WIDTH * CHECK_HEIGHT * ((format == CHECK_PGM) ? 1U : 3U);
+  const uint32_t sampled = (frames + step - 1U) / step;
+  uint8_t *all = malloc((size_t)sampled * frame_bytes);
+  uint8_t *src = malloc(src_bytes);
+  Check_WriterTypeDef writer = { -1, format, frames, CHECK_WIDTH, CHECK_HEIGHT };
+  pthread_t thread;
+  VideoChunk_HandleTypeDef *chunker;
+  VideoChunk_ViewTypeDef view;
+  uint32_t expected = 0U;
+  uint32_t got = 0U;
+  int fds[2];
+  int status;
+  int failed = 0;
+
+  /* the notebook: every frame, then frames[::step], resized, sliced */
+  for (uint32_t i = 0U; (all != NULL) && (src != NULL) && (i < sampled); i++)
+  {
+    Check_Frame(i * step, CHECK_WIDTH, CHECK_HEIGHT, format, src);
+    Check_Reference(src, format, bgr, &all[(size_t)i * frame_bytes]);
+  }
+  free(src);
+
+  config.raw_width = (format == CHECK_RAW) ? CHECK_WIDTH : 0U;
+  config.raw_height = (format == CHECK_RAW) ? CHECK_HEIGHT : 0U;
+  config.step = step;
+  config.hop = hop;
+  config.bgr = bgr;
+  config.partial = partial;
+  if (piped)
+  {
+    if (pipe(fds) != 0)
+    {
+      free(all);
+      return 1;
+    }
+    writer.fd = fds[1];
+    config.fd = fds[0];
+    if (pthread_create(&thread, NULL, Check_Writer, &writer) != 0)
+    {
+      free(all);
+      return 1;
+    }
+  }
+  else
+  {
+    FILE *f = fopen(path, "rb");
+
+    config.fd = (f != NULL) ? dup(fileno(f)) : -1;
+    if (f != NULL)
+    {
+      fclose(f);
+    }
+  }
+  chunker = VideoChunk_Open(&config);
+  if ((all == NULL) || (chunker == NULL))
+  {
+    free(all);
+    return 1;
+  }
+  while ((status = VideoChunk_Next(chunker, &view)) == 1)
+  {
+    const uint32_t first = got * hop;
+    const uint32_t count = ((first + VIDEO_CHUNK_SIZE) <= sampled) ? VIDEO_CHUNK_SIZE : (sampled - first);
+
+    if ((first >= sampled) || (view.index != got) || (view.first != first) || (view.count != count)
+        || (memcmp(view.frames, &all[(size_t)first * frame_bytes], (size_t)count * frame_bytes) != 0))
+    {
+      failed = 1;
+      break;
+    }
+    got++;
+  }
+  for (uint32_t first = 0U; first < sampled; first += hop)
+  {
+    expected += ((partial != 0U) || ((first + VIDEO_CHUNK_SIZE) <= sampled)) ? 1U : 0U;
+  }
+  if ((failed != 0) || (status != 0) || (got != expected))
+  {
+    fprintf(stderr, "%s%s step %u hop %u%s%s: chunk %u of %u differs from the notebook's\n", path,
+            piped ? " piped" : "", step, hop, bgr ? " bgr" : "", partial ? " partial" : "", got, expected);
+    failed = 1;
+  }
+  VideoChunk_Close(chunker);
+  close(config.fd);
+  if (piped)
+  {
+    pthread_join(thread, NULL);
+  }
+  free(all);
+  return failed;
+}
+
+/* cv2.resize(frame, (100, 100)) written out plainly, gray to 3 channels */
+static void Check_Reference(const uint8_t *src, uint32_t format, uint32_t bgr, uint8_t *dst)
+{
+  const uint32_t channels = (format == CHECK_PGM) ? 1U : 3U;
+  const float sx = (float)CHECK_WIDTH / (float)VIDEO_CHUNK_WIDTH;
+  const float sy = (float)CHECK_HEIGHT / (float)VIDEO_CHUNK_HEIGHT;
+
+  for (uint32_t y = 0U; y < VIDEO_CHUNK_HEIGHT; y++)
+  {
+    const float fy = (((float)y + 0.5f) * sy) - 0.5f;
+    const int32_t y0 = (fy < 0.0f) ? 0 : (int32_t)floorf(fy);
+    const int32_t b = ((fy < 0.0f) || (y0 >= (int32_t)CHECK_HEIGHT - 1)) ? 0
+                      : (int32_t)lrintf((fy - (float)y0) * 2048.0f);
+    const int32_t y1 = (b != 0) ? (y0 + 1) : y0;
+
+    for (uint32_t x = 0U; x < VIDEO_CHUNK_WIDTH; x++)
+    {
+      const float fx = (((float)x + 0.5f) * sx) - 0.5f;
+      const int32_t x0 = (fx < 0.0f) ? 0 : (int32_t)floorf(fx);
+      const int32_t a = ((fx < 0.0f) || (x0 >= (int32_t)CHECK_WIDTH - 1)) ? 0
+                        : (int32_t)lrintf((fx - (float)x0) * 2048.0f);
+      const int32_t x1 = (a != 0) ? (x0 + 1) : x0;
+
+      for (uint32_t c = 0U; c < 3U; c++)
+      {
+        const uint32_t k = (channels == 1U) ? 0U : c;
+        const int32_t p00 = src[((((size_t)y0 * CHECK_WIDTH) + (size_t)x0) * channels) + k];
+        const int32_t p01 = src[((((size_t)y0 * CHECK_WIDTH) + (size_t)x1) * channels) + k];
+        const int32_t p10 = src[((((size_t)y1 * CHECK_WIDTH) + (size_t)x0) * channels) + k];
+        const int32_t p11 = src[((((size_t)y1 * CHECK_WIDTH) + (size_t)x1) * channels) + k];
+        const int32_t v = ((((p00 * (2048 - a)) + (p01 * a)) * (2048 - b)) + (((p10 * (2048 - a)) + (p11 * a)) * b)
+                           + (1 << 21)) >> 22;
+        const uint32_t out = ((bgr != 0U) && (channels == 3U)) ? (2U - c) : c;
+
+        dst[(((size_t)y * VIDEO_CHUNK_WIDTH) + x) * 3U + out] = (uint8_t)v;
+      }
+    }
+  }
+}
+
+/* A long video through a pipe: the memory held must not grow */
+static int Check_Long(uint32_t frames)
+{
+  VideoChunk_ConfigTypeDef config = VIDEO_CHUNK_CONFIG_DEFAULT;
+  Check_WriterTypeDef writer = { -1, CHECK_PPM, frames, CHECK_LONG_WIDTH, CHECK_LONG_HEIGHT };
+  VideoChunk_HandleTypeDef *chunker;
+  VideoChunk_ViewTypeDef view;
+  VideoChunk_StatsTypeDef early = { 0 };
+  VideoChunk_StatsTypeDef stats;
+  pthread_t thread;
+  long peak_early = 0;
+  double start;
+  int fds[2];
+  int status;
+
+  if (pipe(fds) != 0)
+  {
+    return 1;
+  }
+  writer.fd = fds[1];
+  if (pthread_create(&thread, NULL, Check_Writer, &writer) != 0)
+  {
+    return 1;
+  }
+  config.fd = fds[0];
+  config.step = 3U;                     /* 30 fps to 10 */
+  chunker = VideoChunk_Open(&config);
+  if (chunker == NULL)
+  {
+    return 1;
+  }
+  start = Check_Now();
+  while ((status = VideoChunk_Next(chunker, &view)) == 1)
+  {
+    if (view.index == 4U)
+    {
+      VideoChunk_Stats(chunker, &early);
+      peak_early = Check_PeakKb();
+    }
+  }
+  VideoChunk_Stats(chunker, &stats);
+  printf("%llu frames of %ux%u, %llu sampled, %llu chunks: %.0f frames/s, %zu bytes held, peak RSS %ld -> %ld kB\n",
+         (unsigned long long)stats.read, CHECK_LONG_WIDTH, CHECK_LONG_HEIGHT, (unsigned long long)stats.sampled,
+         (unsigned long long)stats.chunks, (double)stats.read / (Check_Now() - start), stats.memory, peak_early,
+         Check_PeakKb());
+  VideoChunk_Close(chunker);
+  close(fds[0]);
+  pthread_join(thread, NULL);
+  if ((status != 0) || (stats.read != frames) || ((early.memory != 0U) && (stats.memory != early.memory))
+      || ((peak_early != 0) && (Check_PeakKb() > (peak_early + 1024))))
+  {
+    fprintf(stderr, "long video: the chunker's memory grew\n");
+    return 1;
+  }
+  return 0;
+}
+
+static long Check_PeakKb(void)
+{
+  struct rusage ru;
+
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+static double Check_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
@@ -0,0 +1,691 @@
+/**
+  ******************************************************************************
+  * @file           : person_track.c
+  * @brief          : People through a video, the detector run every few
+  *                   frames.
+  *
+  *                   Decoding takes YOLOv8's raw output, [4 + classes]
+  *                   rows of [anchors] (cx, cy, w, h then the class scores,
+  *                   in input pixels), and keeps the anchors whose best
+  *                   class is a person scoring over the threshold, as
+  *                   ultralytics' non_max_suppression() does; the person
+  *                   row is compared 4 anchors at a time. The candidates
+  *                   are sorted by score into columns and suppressed
+  *                   greedily, each kept box against the next 4 at once,
+  *                   then scaled back to the frame.
+  *
+  *                   Each track is a constant velocity Kalman filter on
+  *                   (cx, cy, w, h) with BoT-SORT's noise, relative to the
+  *                   box: every coordinate is independent, so it is four
+  *                   filters of 2 states. Every frame predicts the tracks;
+  *                   a frame the detector ran on matches them to its
+  *                   detections greedily by IoU, updates the matched ones,
+  *                   counts a miss against the rest and starts a track for
+  *                   every detection left over. The detector is asked for
+  *                   every interval frames, and sooner when a track's
+  *                   confidence, decaying while it goes unseen, falls below
+  *                   min_confidence. PERSON_TRACK_GENERIC builds the plain
+  *                   C loops, with the same arithmetic.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "person_track.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__) && !defined(PERSON_TRACK_GENERIC)
+#include <emmintrin.h>
+#define PERSON_TRACK_SSE2
+#endif
+
+/* Private define ------------------------------------------------------------*/
+#define TRACK_MAX_NMS       30000U      /* boxes into a suppression, as
+                                           ultralytics' max_nms            */
+#define TRACK_STD_POS       (1.0f / 20.0f)  /* of the box side, per frame  */
+#define TRACK_STD_VEL       (1.0f / 160.0f)
+#define TRACK_SIDE_MIN      1.0f
+#define TRACK_NONE          UINT64_MAX
+#define TRACK_COLUMNS       5U          /* x1 y1 x2 y2 score               */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  float x[4];               /* cx, cy, w, h                                */
+  float v[4];               /* per frame                                   */
+  float pp[4];              /* covariance of each coordinate's filter      */
+  float pv[4];
+  float vv[4];
+  float score;
+  uint32_t id;
+  uint32_t misses;
+  uint8_t detected;
+} Track_TypeDef;
+
+typedef struct
+{
+  float iou;
+  uint16_t track;
+  uint16_t detection;
+} Track_PairTypeDef;
+
+typedef struct
+{
+  float score;
+  uint32_t index;
+} Track_RankTypeDef;
+
+struct PersonTrack_Handle
+{
+  PersonTrack_ConfigTypeDef config;
+  Track_TypeDef tracks[PERSON_TRACK_TRACKS_MAX];
+  uint32_t n_tracks;
+  uint32_t next_id;
+  uint64_t frame;
+  uint64_t last_detection;  /* frame of the last run, TRACK_NONE before    */
+  PersonTrack_StatsTypeDef stats;
+  Track_PairTypeDef pairs[PERSON_TRACK_TRACKS_MAX * PERSON_TRACK_MAX_DET];
+  uint8_t matched[PERSON_TRACK_MAX_DET];
+  uint32_t keep[PERSON_TRACK_MAX_DET];
+  /* decoding, grown to the most candidates a frame had */
+  uint32_t capacity;
+  float *cand[TRACK_COLUMNS];   /* in anchor order                         */
+  float *box[TRACK_COLUMNS];    /* by score                                */
+  float *area;
+  Track_RankTypeDef *rank;
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static int Track_Candidate(PersonTrack_HandleTypeDef *tracker, const float *output, uint32_t rows,
+                           uint32_t anchors, uint32_t a, uint32_t n);
+static int Track_Grow(PersonTrack_HandleTypeDef *tracker);
+static int Track_CompareRank(const void *a, const void *b);
+static int Track_ComparePair(const void *a, const void *b);
+static void Track_Associate(PersonTrack_HandleTypeDef *tracker, const PersonTrack_DetectionTypeDef *detections,
+                            uint32_t count);
+static void Track_Start(PersonTrack_HandleTypeDef *tracker, const PersonTrack_DetectionTypeDef *detection);
+static void Track_Predict(Track_TypeDef *track);
+static void Track_Update(Track_TypeDef *track, const PersonTrack_DetectionTypeDef *detection);
+static void Track_Box(const Track_TypeDef *track, float box[4]);
+static float Track_Iou(const float a[4], const float b[4]);
+static float Track_Clip(float v, float hi);
+
+/* Exported functions --------------------------------------------------------*/
+
+PersonTrack_HandleTypeDef *PersonTrack_Open(const PersonTrack_ConfigTypeDef *config)
+{
+  PersonTrack_HandleTypeDef *tracker;
+
+  if ((config->max_tracks == 0U) || (config->max_tracks > PERSON_TRACK_TRACKS_MAX) || !(config->decay > 0.0f) ||
+      (config->decay > 1.0f))
+  {
+    return NULL;
+  }
+  tracker = calloc(1U, sizeof(*tracker));
+  if (tracker != NULL)
+  {
+    tracker->config = *config;
+    PersonTrack_Reset(tracker);
+  }
+  return tracker;
+}
+
+/**
+  * @brief  Forget the tracks, for a new video; the stats go on.
+  */
+void PersonTrack_Reset(PersonTrack_HandleTypeDef *tracker)
+{
+  tracker->n_tracks = 0U;
+  tracker->next_id = 1U;
+  tracker->frame = 0U;
+  tracker->last_detection = TRACK_NONE;
+}
+
+/**
+  * @brief  Whether the detector should run on the next frame.
+  * @retval 1 on the first frame, every interval frames, and when a track
+  *         has grown unsure; else 0
+  */
+int PersonTrack_NeedsDetection(const PersonTrack_HandleTypeDef *tracker)
+{
+  if ((tracker->last_detection == TRACK_NONE) ||
+      ((tracker->frame - tracker->last_detection) >= tracker->config.interval))
+  {
+    return 1;
+  }
+  for (uint32_t t = 0U; t < tracker->n_tracks; t++)
+  {
+    if (tracker->tracks[t].score < tracker->config.min_confidence)
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  Move the tracks on by a frame and append their boxes.
+  * @param  detections: what the detector found on this frame, NULL if it
+  *         did not run on it (the first PERSON_TRACK_MAX_DET are used)
+  * @param  boxes: columns to append a row per track to, or NULL
+  * @retval rows appended, -1 with nothing changed if the columns might not
+  *         have room for them: grow them and step again
+  */
+int PersonTrack_Step(PersonTrack_HandleTypeDef *tracker, const PersonTrack_DetectionTypeDef *detections,
+                     uint32_t count, PersonTrack_BoxesTypeDef *boxes)
+{
+  const PersonTrack_ConfigTypeDef *config = &tracker->config;
+  uint32_t rows = 0U;
+
+  if (detections == NULL)
+  {
+    count = 0U;
+  }
+  else if (count > PERSON_TRACK_MAX_DET)
+  {
+    count = PERSON_TRACK_MAX_DET;
+  }
+  if ((boxes != NULL) && (((uint64_t)boxes->count + tracker->n_tracks + count) > boxes->capacity))
+  {
+    return -1;
+  }
+
+  for (uint32_t t = 0U; t < tracker->n_tracks; t++)
+  {
+    Track_Predict(&tracker->tracks[t]);
+    tracker->tracks[t].score *= config->decay;
+    tracker->tracks[t].detected = 0U;
+  }
+  if (detections != NULL)
+  {
+    Track_Associate(tracker, detections, count);
+    tracker->last_detection = tracker->frame;
+    tracker->stats.detections++;
+  }
+
+  if (boxes != NULL)
+  {
+    for (uint32_t t = 0U; t < tracker->n_tracks; t++)
+    {
+      const Track_TypeDef *track = &tracker->tracks[t];
+      const uint32_t row = boxes->count + rows;
+      float box[4];
+
+      Track_Box(track, box);
+      boxes->frame[row] = (uint32_t)tracker->frame;
+      boxes->track[row] = track->id;
+      boxes->x1[row] = box[0];
+      boxes->y1[row] = box[1];
+      boxes->x2[row] = box[2];
+      boxes->y2[row] = box[3];
+      boxes->score[row] = track->score;
+      boxes->detected[row] = track->detected;
+      rows++;
+    }
+    boxes->count += rows;
+  }
+  tracker->frame++;
+  tracker->stats.frames++;
+  return (int)rows;
+}
+
+void PersonTrack_Stats(const PersonTrack_HandleTypeDef *tracker, PersonTrack_StatsTypeDef *stats)
+{
+  *stats = tracker->stats;
+}
+
+void PersonTrack_Close(PersonTrack_HandleTypeDef *tracker)
+{
+  if (tracker != NULL)
+  {
+    for (uint32_t k = 0U; k < TRACK_COLUMNS; k++)
+    {
+      free(tracker->cand[k]);
+      free(tracker->box[k]);
+    }
+    free(tracker->area);
+    free(tracker->rank);
+    free(tracker);
+  }
+}
+
+/**
+  * @brief  The people in a frame from the detector's raw output.
+  * @param  output: [rows][anchors], rows = 4 + classes
+  * @param  letterbox: how the frame was fitted to the input
+  * @param  detections: the people kept, by score, in frame pixels
+  * @retval how many, at most max and PERSON_TRACK_MAX_DET; -1 if the output
+  *         has no person row or memory ran out
+  */
+int PersonTrack_Decode(PersonTrack_HandleTypeDef *tracker, const float *output, uint32_t rows, uint32_t anchors,
+                       const PersonTrack_LetterboxTypeDef *letterbox, PersonTrack_DetectionTypeDef *detections,
+                       uint32_t max)
+{
+  const float conf = tracker->config.conf_threshold;
+  const float *person = &output[(size_t)(4U + PERSON_TRACK_CLASS) * anchors];
+  uint32_t n = 0U;
+  uint32_t kept;
+  uint32_t a = 0U;
+  int found;
+
+  if ((rows <= (4U + PERSON_TRACK_CLASS)) || !(letterbox->gain > 0.0f))
+  {
+    return -1;
+  }
+#if defined(PERSON_TRACK_SSE2)
+  {
+    const __m128 threshold = _mm_set1_ps(conf);
+
+    for (; (a + 4U) <= anchors; a += 4U)
+    {
+      unsigned int mask = (unsigned int)_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(&person[a]), threshold));
+
+      while (mask != 0U)
+      {
+        if ((found = Track_Candidate(tracker, output, rows, anchors, a + (uint32_t)__builtin_ctz(mask), n)) < 0)
+        {
+          return -1;
+        }
+        n += (uint32_t)found;
+        mask &= mask - 1U;
+      }
+    }
+  }
+#endif
+  for (; a < anchors; a++)
+  {
+    if (person[a] > conf)
+    {
+      if ((found = Track_Candidate(tracker, output, rows, anchors, a, n)) < 0)
+      {
+        return -1;
+      }
+      n += (uint32_t)found;
+    }
+  }
+
+  for (uint32_t i = 0U; i < n; i++)
+  {
+    tracker->rank[i].score = tracker->cand[4][i];
+    tracker->rank[i].index = i;
+  }
+  qsort(tracker->rank, n, sizeof(tracker->rank[0]), Track_CompareRank);
+  if (n > TRACK_MAX_NMS)
+  {
+    n = TRACK_MAX_NMS;
+  }
+  for (uint32_t k = 0U; k < TRACK_COLUMNS; k++)
+  {
+    for (uint32_t i = 0U; i < n; i++)
+    {
+      tracker->box[k][i] = tracker->cand[k][tracker->rank[i].index];
+    }
+  }
+  if (max > PERSON_TRACK_MAX_DET)
+  {
+    max = PERSON_TRACK_MAX_DET;
+  }
+  kept = PersonTrack_Nms(tracker->box[0], tracker->box[1], tracker->box[2], tracker->box[3], n,
+                         tracker->config.iou_threshold, tracker->area, tracker->keep, max);
+
+  for (uint32_t i = 0U; i < kept; i++)
+  {
+    const uint32_t k = tracker->keep[i];
+    PersonTrack_DetectionTypeDef *det = &detections[i];
+
+    det->x1 = Track_Clip((tracker->box[0][k] - letterbox->pad_x) / letterbox->gain, (float)letterbox->width);
+    det->y1 = Track_Clip((tracker->box[1][k] - letterbox->pad_y) / letterbox->gain, (float)letterbox->height);
+    det->x2 = Track_Clip((tracker->box[2][k] - letterbox->pad_x) / letterbox->gain, (float)letterbox->width);
+    det->y2 = Track_Clip((tracker->box[3][k] - letterbox->pad_y) / letterbox->gain, (float)letterbox->height);
+    det->score = tracker->box[4][k];
+  }
+  return (int)kept;
+}
+
+/**
+  * @brief  Greedy suppression of boxes sorted by score.
+  * @param  area: [count] of scratch; left -1 for the boxes suppressed
+  * @param  keep: indices of the boxes kept, in order
+  * @retval how many, at most max; boxes of negative extent are never kept
+  */
+uint32_t PersonTrack_Nms(const float *x1, const float *y1, const float *x2, const float *y2, uint32_t count,
+                         float iou_threshold, float *area, uint32_t *keep, uint32_t max)
+{
+  uint32_t kept = 0U;
+
+  for (uint32_t j = 0U; j < count; j++)
+  {
+    area[j] = (x2[j] - x1[j]) * (y2[j] - y1[j]);
+  }
+  for (uint32_t i = 0U; (i < count) && (kept < max); i++)
+  {
+    uint32_t j = i + 1U;
+
+    if (area[i] < 0.0f)
+    {
+      continue;
+    }
+    keep[kept++] = i;
+#if defined(PERSON_TRACK_SSE2)
+    {
+      const __m128 ix1 = _mm_set1_ps(x1[i]);
+      const __m128 iy1 = _mm_set1_ps(y1[i]);
+      const __m128 ix2 = _mm_set1_ps(x2[i]);
+      const __m128 iy2 = _mm_set1_ps(y2[i]);
+      const __m128 ia = _mm_set1_ps(area[i]);
+      const __m128 threshold = _mm_set1_ps(iou_threshold);
+      const __m128 zero = _mm_setzero_ps();
+      const __m128 gone = _mm_set1_ps(-1.0f);
+
+      for (; (j + 4U) <= count; j += 4U)
+      {
+        const __m128 w = _mm_max_ps(_mm_sub_ps(_mm_min_ps(_mm_loadu_ps(&x2[j]), ix2),
+                                               _mm_max_ps(_mm_loadu_ps(&x1[j]), ix1)), zero);
+        const __m128 h = _mm_max_ps(_mm_sub_ps(_mm_min_ps(_mm_loadu_ps(&y2[j]), iy2),
+                                               _mm_max_ps(_mm_loadu_ps(&y1[j]), iy1)), zero);
+        const __m128 inter = _mm_mul_ps(w, h);
+        const __m128 aj = _mm_loadu_ps(&area[j]);
+        const __m128 both = _mm_sub_ps(_mm_add_ps(ia, aj), inter);
+        const __m128 over = _mm_cmpgt_ps(inter, _mm_mul_ps(threshold, both));
+
+        _mm_storeu_ps(&area[j], _mm_or_ps(_mm_and_ps(over, gone), _mm_andnot_ps(over, aj)));
+      }
+    }
+#endif
+    for (; j < count; j++)
+    {
+      const float left = (x1[j] > x1[i]) ? x1[j] : x1[i];
+      const float right = (x2[j] < x2[i]) ? x2[j] : x2[i];
+      const float top = (y1[j] > y1[i]) ? y1[j] : y1[i];
+      const float bottom = (y2[j] < y2[i]) ? y2[j] : y2[i];
+      const float w = ((right - left) > 0.0f) ? (right - left) : 0.0f;
+      const float h = ((bottom - top) > 0.0f) ? (bottom - top) : 0.0f;
+      const float inter = w * h;
+
+      if (inter > (iou_threshold * ((area[i] + area[j]) - inter)))
+      {
+        area[j] = -1.0f;
+      }
+    }
+  }
+  return kept;
+}
+
+/**
+  * @brief  Instructions the suppression uses.
+  */
+const char *PersonTrack_Isa(void)
+{
+#if defined(PERSON_TRACK_SSE2)
+  return "sse2";
+#else
+  return "generic";
+#endif
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/* anchor a as a candidate n if no other class outscores the person */
+static int Track_Candidate(PersonTrack_HandleTypeDef *tracker, const float *output, uint32_t rows,
+                           uint32_t anchors, uint32_t a, uint32_t n)
+{
+  const float score = output[(size_t)(4U + PERSON_TRACK_CLASS) * anchors + a];
+  float cx;
+  float cy;
+  float hw;
+  float hh;
+
+  for (uint32_t r = 4U; r < rows; r++)
+  {
+    if (output[(size_t)r * anchors + a] > score)
+    {
+      return 0;
+    }
+  }
+  if ((n == tracker->capacity) && (Track_Grow(tracker) != 0))
+  {
+    return -1;
+  }
+  cx = output[a];
+  cy = output[(size_t)anchors + a];
+  hw = output[(size_t)2U * anchors + a] / 2.0f;
+  hh = output[(size_t)3U * anchors + a] / 2.0f;
+  tracker->cand[0][n] = cx - hw;
+  tracker->cand[1][n] = cy - hh;
+  tracker->cand[2][n] = cx + hw;
+  tracker->cand[3][n] = cy + hh;
+  tracker->cand[4][n] = score;
+  return 1;
+}
+
+static int Track_Grow(PersonTrack_HandleTypeDef *tracker)
+{
+  const uint32_t capacity = (tracker->capacity == 0U) ? 256U : (tracker->capacity * 2U);
+  void *p;
+
+  for (uint32_t k = 0U; k < TRACK_COLUMNS; k++)
+  {
+    if ((p = realloc(tracker->cand[k], capacity * sizeof(float))) == NULL)
+    {
+      return -1;
+    }
+    tracker->cand[k] = p;
+    if ((p = realloc(tracker->box[k], capacity * sizeof(float))) == NULL)
+    {
+      return -1;
+    }
+    tracker->box[k] = p;
+  }
+  if ((p = realloc(tracker->area, capacity * sizeof(float))) == NULL)
+  {
+    return -1;
+  }
+  tracker->area = p;
+  if ((p = realloc(tracker->rank, capacity * sizeof(Track_RankTypeDef))) == NULL)
+  {
+    return -1;
+  }
+  tracker->rank = p;
+  tracker->capacity = capacity;
+  return 0;
+}
+
+/* by score, highest first, then by anchor */
+static int Track_CompareRank(const void *a, const void *b)
+{
+  const Track_RankTypeDef *ra = a;
+  const Track_RankTypeDef *rb = b;
+
+  if (ra->score != rb->score)
+  {
+    return (ra->score > rb->score) ? -1 : 1;
+  }
+  return (ra->index > rb->index) - (ra->index < rb->index);
+}
+
+/* by IoU, highest first, then by track and detection */
+static int Track_ComparePair(const void *a, const void *b)
+{
+  const Track_PairTypeDef *pa = a;
+  const Track_PairTypeDef *pb = b;
+
+  if (pa->iou != pb->iou)
+  {
+    return (pa->iou > pb->iou) ? -1 : 1;
+  }
+  if (pa->track != pb->track)
+  {
+    return (pa->track > pb->track) ? 1 : -1;
+  }
+  return (pa->detection > pb->detection) - (pa->detection < pb->detection);
+}
+
+static void Track_Associate(PersonTrack_HandleTypeDef *tracker, const PersonTrack_DetectionTypeDef *detections,
+                            uint32_t count)
+{
+  uint8_t updated[PERSON_TRACK_TRACKS_MAX] = {0};
+  uint32_t n_pairs = 0U;
+  uint32_t live = 0U;
+
+  for (uint32_t t = 0U; t < tracker->n_tracks; t++)
+  {
+    float box[4];
+
+    Track_Box(&tracker->tracks[t], box);
+    for (uint32_t d = 0U; d < count; d++)
+    {
+      const float det[4] = { detections[d].x1, detections[d].y1, detections[d].x2, detections[d].y2 };
+      const float iou = Track_Iou(box, det);
+
+      if (iou >= tracker->config.match_iou)
+      {
+        tracker->pairs[n_pairs].iou = iou;
+        tracker->pairs[n_pairs].track = (uint16_t)t;
+        tracker->pairs[n_pairs].detection = (uint16_t)d;
+        n_pairs++;
+      }
+    }
+  }
+  qsort(tracker->pairs, n_pairs, sizeof(tracker->pairs[0]), Track_ComparePair);
+  memset(tracker->matched, 0, count);
+  for (uint32_t p = 0U; p < n_pairs; p++)
+  {
+    const Track_PairTypeDef *pair = &tracker->pairs[p];
+
+    if ((updated[pair->track] == 0U) && (tracker->matched[pair->detection] == 0U))
+    {
+      updated[pair->track] = 1U;
+      tracker->matched[pair->detection] = 1U;
+      Track_Update(&tracker->tracks[pair->track], &detections[pair->detection]);
+    }
+  }
+
+  /* drop the tracks missing too long, keeping the rest in order */
+  for (uint32_t t = 0U; t < tracker->n_tracks; t++)
+  {
+    Track_TypeDef *track = &tracker->tracks[t];
+
+    if ((updated[t] == 0U) && (++track->misses > tracker->config.max_misses))
+    {
+      continue;
+    }
+    tracker->tracks[live++] = *track;
+  }
+  tracker->n_tracks = live;
+
+  for (uint32_t d = 0U; d < count; d++)
+  {
+    if ((tracker->matched[d] == 0U) && (tracker->n_tracks < tracker->config.max_tracks))
+    {
+      Track_Start(tracker, &detections[d]);
+    }
+  }
+}
+
+static void Track_Start(PersonTrack_HandleTypeDef *tracker, const PersonTrack_DetectionTypeDef *detection)
+{
+  Track_TypeDef *track = &tracker->tracks[tracker->n_tracks++];
+
+  track->x[0] = (detection->x1 + detection->x2) / 2.0f;
+  track->x[1] = (detection->y1 + detection->y2) / 2.0f;
+  track->x[2] = detection->x2 - detection->x1;
+  track->x[3] = detection->y2 - detection->y1;
+  track->x[2] = (track->x[2] > TRACK_SIDE_MIN) ? track->x[2] : TRACK_SIDE_MIN;
+  track->x[3] = (track->x[3] > TRACK_SIDE_MIN) ? track->x[3] : TRACK_SIDE_MIN;
+  for (uint32_t k = 0U; k < 4U; k++)
+  {
+    const float side = track->x[2U + (k & 1U)];
+    const float pos = 2.0f * TRACK_STD_POS * side;
+    const float vel = 10.0f * TRACK_STD_VEL * side;
+
+    track->v[k] = 0.0f;
+    track->pp[k] = pos * pos;
+    track->pv[k] = 0.0f;
+    track->vv[k] = vel * vel;
+  }
+  track->score = detection->score;
+  track->id = tracker->next_id++;
+  track->misses = 0U;
+  track->detected = 1U;
+  tracker->stats.tracks++;
+}
+
+static void Track_Predict(Track_TypeDef *track)
+{
+  for (uint32_t k = 0U; k < 4U; k++)
+  {
+    /* x, w against the width; y, h against the height */
+    const float side = track->x[2U + (k & 1U)];
+    const float q_pos = (TRACK_STD_POS * side) * (TRACK_STD_POS * side);
+    const float q_vel = (TRACK_STD_VEL * side) * (TRACK_STD_VEL * side);
+
+    track->pp[k] += (2.0f * track->pv[k]) + track->vv[k] + q_pos;
+    track->pv[k] += track->vv[k];
+    track->vv[k] += q_vel;
+  }
+  for (uint32_t k = 0U; k < 4U; k++)
+  {
+    track->x[k] += track->v[k];
+  }
+  track->x[2] = (track->x[2] > TRACK_SIDE_MIN) ? track->x[2] : TRACK_SIDE_MIN;
+  track->x[3] = (track->x[3] > TRACK_SIDE_MIN) ? track->x[3] : TRACK_SIDE_MIN;
+}
+
+static void Track_Update(Track_TypeDef *track, const PersonTrack_DetectionTypeDef *detection)
+{
+  const float z[4] = {(detection->x1 + detection->x2) / 2.0f, (detection->y1 + detection->y2) / 2.0f,
+                      detection->x2 - detection->x1, detection->y2 - detection->y1};
+  float side[2];
+
+  side[0] = track->x[2];
+  side[1] = track->x[3];
+  for (uint32_t k = 0U; k < 4U; k++)
+  {
+    const float r = (TRACK_STD_POS * side[k & 1U]) * (TRACK_STD_POS * side[k & 1U]);
+    const float s = track->pp[k] + r;
+    const float gain_pos = track->pp[k] / s;
+    const float gain_vel = track->pv[k] / s;
+    const float y = z[k] - track->x[k];
+
+    track->x[k] += gain_pos * y;
+    track->v[k] += gain_vel * y;
+    track->vv[k] -= gain_vel * track->pv[k];
+    track->pv[k] -= gain_pos * track->pv[k];
+    track->pp[k] -= gain_pos * track->pp[k];
+  }
+  track->x[2] = (track->x[2] > TRACK_SIDE_MIN) ? track->x[2] : TRACK_SIDE_MIN;
+  track->x[3] = (track->x[3] > TRACK_SIDE_MIN) ? track->x[3] : TRACK_SIDE_MIN;
+  track->score = detection->score;
+  track->misses = 0U;
+  track->detected = 1U;
+}
+
+static void Track_Box(const Track_TypeDef *track, float box[4])
+{
+  box[0] = track->x[0] - (track->x[2] / 2.0f);
+  box[1] = track->x[1] - (track->x[3] / 2.0f);
+  box[2] = track->x[0] + (track->x[2] / 2.0f);
+  box[3] = track->x[1] + (track->x[3] / 2.0f);
+}
+
+static float Track_Iou(const float a[4], const float b[4])
+{
+  const float w = ((a[2] < b[2]) ? a[2] : b[2]) - ((a[0] > b[0]) ? a[0] : b[0]);
+  const float h = ((a[3] < b[3]) ? a[3] : b[3]) - ((a[1] > b[1]) ? a[1] : b[1]);
+  float inter;
+  float both;
+
+  if ((w <= 0.0f) || (h <= 0.0f))
+  {
+    return 0.0f;
+  }
+  inter = w * h;
+  both = ((a[2] - a[0]) * (a[3] - a[1])) + ((b[2] - b[0]) * (b[3] - b[1])) - inter;
+  return (both > 0.0f) ? (inter / both) : 0.0f;
+}
+
+static float Track_Clip(float v, float hi)
+{
+  return (v < 0.0f) ? 0.0f : ((v > hi) ? hi : v);
+}
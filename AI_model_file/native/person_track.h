@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * @file           : person_track.h
+  * @brief          : Header for person_track.c file.
+  *                   People through a video from YOLOv8 run every few
+  *                   frames: the detector's raw output decoded and
+  *                   suppressed here, each person tracked between runs by
+  *                   IoU association and a Kalman filter, and the boxes of
+  *                   every frame appended to caller-owned columns. Built as
+  *                   libperson_track.so for person_track.py.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PERSON_TRACK_H
+#define __PERSON_TRACK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define PERSON_TRACK_CLASS      0U      /* 'person' of the COCO classes    */
+#define PERSON_TRACK_MAX_DET    300U    /* kept by a suppression, as
+                                           ultralytics' max_det            */
+#define PERSON_TRACK_TRACKS_MAX 64U
+
+#define PERSON_TRACK_CONFIG_DEFAULT \
+  { 5U, 0.5f, 0.5f, 0.3f, 0.35f, 0.95f, 2U, 32U }
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t interval;        /* frames from one detector run to the next    */
+  float conf_threshold;     /* of a person, as the notebook's NMS          */
+  float iou_threshold;      /* of the suppression                          */
+  float match_iou;          /* least IoU of a detection with its track     */
+  float min_confidence;     /* a track below it asks for the detector      */
+  float decay;              /* of a track's confidence per frame unseen    */
+  uint32_t max_misses;      /* detector runs a track may be missing from   */
+  uint32_t max_tracks;      /* PERSON_TRACK_TRACKS_MAX at most             */
+} PersonTrack_ConfigTypeDef;
+
+/* how a frame was letterboxed to the detector's input */
+typedef struct
+{
+  float gain;               /* input pixels per frame pixel                */
+  float pad_x;
+  float pad_y;
+  uint32_t width;           /* of the frame                                */
+  uint32_t height;
+} PersonTrack_LetterboxTypeDef;
+
+typedef struct
+{
+  float x1;
+  float y1;
+  float x2;
+  float y2;
+  float score;
+} PersonTrack_DetectionTypeDef;
+
+/* the boxes of every frame, a row each, in columns the caller allocates */
+typedef struct
+{
+  uint32_t capacity;
+  uint32_t count;
+  uint32_t *frame;
+  uint32_t *track;          /* from 1, the same person from frame to frame */
+  float *x1;
+  float *y1;
+  float *x2;
+  float *y2;
+  float *score;             /* the detector's, decayed while unseen        */
+  uint8_t *detected;        /* 1 where a detection placed it, 0 predicted  */
+} PersonTrack_BoxesTypeDef;
+
+typedef struct
+{
+  uint64_t frames;
+  uint64_t detections;      /* detector runs                               */
+  uint64_t tracks;          /* started                                     */
+} PersonTrack_StatsTypeDef;
+
+typedef struct PersonTrack_Handle PersonTrack_HandleTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+PersonTrack_HandleTypeDef *PersonTrack_Open(const PersonTrack_ConfigTypeDef *config);
+void PersonTrack_Reset(PersonTrack_HandleTypeDef *tracker);
+int PersonTrack_NeedsDetection(const PersonTrack_HandleTypeDef *tracker);
+int PersonTrack_Step(PersonTrack_HandleTypeDef *tracker, const PersonTrack_DetectionTypeDef *detections,
+                     uint32_t count, PersonTrack_BoxesTypeDef *boxes);
+void PersonTrack_Stats(const PersonTrack_HandleTypeDef *tracker, PersonTrack_StatsTypeDef *stats);
+void PersonTrack_Close(PersonTrack_HandleTypeDef *tracker);
+
+int PersonTrack_Decode(PersonTrack_HandleTypeDef *tracker, const float *output, uint32_t rows, uint32_t anchors,
+                       const PersonTrack_LetterboxTypeDef *letterbox, PersonTrack_DetectionTypeDef *detections,
+                       uint32_t max);
+uint32_t PersonTrack_Nms(const float *x1, const float *y1, const float *x2, const float *y2, uint32_t count,
+                         float iou_threshold, float *area, uint32_t *keep, uint32_t max);
+const char *PersonTrack_Isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PERSON_TRACK_H */
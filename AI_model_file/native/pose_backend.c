@@ -0,0 +1,193 @@
+/**
+  ******************************************************************************
+  * @file           : pose_backend.c
+  * @brief          : What runs the pose model for pose_worker.c.
+  *
+  *                   With POSE_TFLITE (make TFLITE=dir) a .tflite MoveNet
+  *                   is run by the TensorFlow Lite C library: the model is
+  *                   loaded, its tensors allocated and looked up once, and
+  *                   a frame is a copy in, an invoke and a copy out.
+  *
+  *                   POSE_STUB is a stand-in with the model's input and
+  *                   output, so the pipeline can be checked and timed
+  *                   without TensorFlow: keypoint k is the centre of
+  *                   brightness of the k-th of 17 bands of the input, its
+  *                   score the band's mean brightness.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "pose_worker.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef POSE_TFLITE
+#include "tensorflow/lite/c/c_api.h"
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t size;
+} Stub_ModelTypeDef;
+
+#ifdef POSE_TFLITE
+typedef struct
+{
+  TfLiteModel *model;
+  TfLiteInterpreter *interpreter;
+  TfLiteTensor *input;
+  const TfLiteTensor *output;
+  size_t input_bytes;
+} TfLite_ModelTypeDef;
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static void *Stub_Open(const char *model, uint32_t size, uint32_t threads);
+static int Stub_Invoke(void *model, const float *input, float keypoints[POSE_VALUES]);
+static void Stub_Close(void *model);
+#ifdef POSE_TFLITE
+static void *TfLite_Open(const char *model, uint32_t size, uint32_t threads);
+static int TfLite_Invoke(void *model, const float *input, float keypoints[POSE_VALUES]);
+static void TfLite_Close(void *model);
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static const PoseWorker_BackendTypeDef pose_stub = { POSE_STUB, Stub_Open, Stub_Invoke, Stub_Close };
+#ifdef POSE_TFLITE
+static const PoseWorker_BackendTypeDef pose_tflite = { "tflite", TfLite_Open, TfLite_Invoke, TfLite_Close };
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  The backend that runs a model.
+  * @param  model: a .tflite file, or POSE_STUB
+  * @retval NULL if this build cannot run it
+  */
+const PoseWorker_BackendTypeDef *PoseWorker_Backend(const char *model)
+{
+  if (strcmp(model, POSE_STUB) == 0)
+  {
+    return &pose_stub;
+  }
+#ifdef POSE_TFLITE
+  return &pose_tflite;
+#else
+  fprintf(stderr, "%s: built without TensorFlow Lite (make TFLITE=dir)\n", model);
+  return NULL;
+#endif
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static void *Stub_Open(const char *model, uint32_t size, uint32_t threads)
+{
+  Stub_ModelTypeDef *stub = malloc(sizeof(*stub));
+
+  (void)model;
+  (void)threads;
+  if (stub != NULL)
+  {
+    stub->size = size;
+  }
+  return stub;
+}
+
+static int Stub_Invoke(void *model, const float *input, float keypoints[POSE_VALUES])
+{
+  const uint32_t size = ((const Stub_ModelTypeDef *)model)->size;
+
+  for (uint32_t k = 0U; k < POSE_KEYPOINTS; k++)
+  {
+    const uint32_t y0 = (k * size) / POSE_KEYPOINTS;
+    const uint32_t y1 = ((k + 1U) * size) / POSE_KEYPOINTS;
+    double sum = 0.0;
+    double sum_y = 0.0;
+    double sum_x = 0.0;
+
+    for (uint32_t y = y0; y < y1; y++)
+    {
+      const float *row = &input[(size_t)y * size * 3U];
+
+      for (uint32_t x = 0U; x < size; x++)
+      {
+        const double v = (double)row[3U * x] + row[(3U * x) + 1U] + row[(3U * x) + 2U];
+
+        sum += v;
+        sum_y += v * y;
+        sum_x += v * x;
+      }
+    }
+    keypoints[3U * k] = (sum > 0.0) ? (float)(sum_y / sum / size) : 0.5f;
+    keypoints[(3U * k) + 1U] = (sum > 0.0) ? (float)(sum_x / sum / size) : 0.5f;
+    keypoints[(3U * k) + 2U] = (y1 > y0) ? (float)(sum / (3.0 * 255.0 * size * (y1 - y0))) : 0.0f;
+  }
+  return 0;
+}
+
+static void Stub_Close(void *model)
+{
+  free(model);
+}
+
+#ifdef POSE_TFLITE
+static void *TfLite_Open(const char *model, uint32_t size, uint32_t threads)
+{
+  TfLite_ModelTypeDef *tfl = calloc(1U, sizeof(*tfl));
+  TfLiteInterpreterOptions *options = TfLiteInterpreterOptionsCreate();
+
+  if ((tfl == NULL) || (options == NULL))
+  {
+    free(tfl);
+    TfLiteInterpreterOptionsDelete(options);
+    return NULL;
+  }
+  TfLiteInterpreterOptionsSetNumThreads(options, (int32_t)threads);
+  tfl->model = TfLiteModelCreateFromFile(model);
+  tfl->interpreter = (tfl->model != NULL) ? TfLiteInterpreterCreate(tfl->model, options) : NULL;
+  TfLiteInterpreterOptionsDelete(options);
+  if ((tfl->interpreter == NULL) || (TfLiteInterpreterAllocateTensors(tfl->interpreter) != kTfLiteOk))
+  {
+    fprintf(stderr, "%s: not a TensorFlow Lite model\n", model);
+    TfLite_Close(tfl);
+    return NULL;
+  }
+
+  /* [1][size][size][3] float in, [1][1][17][3] float out */
+  tfl->input = TfLiteInterpreterGetInputTensor(tfl->interpreter, 0);
+  tfl->output = TfLiteInterpreterGetOutputTensor(tfl->interpreter, 0);
+  tfl->input_bytes = (size_t)size * size * 3U * sizeof(float);
+  if ((tfl->input == NULL) || (tfl->output == NULL) || (TfLiteTensorType(tfl->input) != kTfLiteFloat32)
+      || (TfLiteTensorByteSize(tfl->input) != tfl->input_bytes) || (TfLiteTensorType(tfl->output) != kTfLiteFloat32)
+      || (TfLiteTensorByteSize(tfl->output) != (POSE_VALUES * sizeof(float))))
+  {
+    fprintf(stderr, "%s: not a single pose MoveNet taking %ux%u float frames\n", model, size, size);
+    TfLite_Close(tfl);
+    return NULL;
+  }
+  return tfl;
+}
+
+static int TfLite_Invoke(void *model, const float *input, float keypoints[POSE_VALUES])
+{
+  TfLite_ModelTypeDef *tfl = model;
+
+  if ((TfLiteTensorCopyFromBuffer(tfl->input, input, tfl->input_bytes) != kTfLiteOk)
+      || (TfLiteInterpreterInvoke(tfl->interpreter) != kTfLiteOk)
+      || (TfLiteTensorCopyToBuffer(tfl->output, keypoints, POSE_VALUES * sizeof(float)) != kTfLiteOk))
+  {
+    return -1;
+  }
+  return 0;
+}
+
+static void TfLite_Close(void *model)
+{
+  TfLite_ModelTypeDef *tfl = model;
+
+  TfLiteInterpreterDelete(tfl->interpreter);
+  TfLiteModelDelete(tfl->model);
+  free(tfl);
+}
+#endif /* POSE_TFLITE */
@@ -0,0 +1,512 @@
+/**
+  ******************************************************************************
+  * @file           : pose_check.c
+  * @brief          : Check and time pose_worker against the notebook's way.
+  *
+  *                     pose_check [-n frames] [-l long_frames] [-j threads]
+  *                                dir
+  *
+  *                   Checks PoseWorker_Letterbox() against
+  *                   tf.image.resize_with_pad written out plainly, for
+  *                   landscape, portrait, gray and odd sizes. Then writes a
+  *                   stream of -n frames of several sizes to dir/pose.ppm
+  *                   and checks that the worker, read from the file and
+  *                   through a pipe, gives for each frame in order the
+  *                   keypoints and display frame of the notebook's loop
+  *                   (letterbox, invoke, one frame at a time), for several
+  *                   thread and slot counts, the same worker taking video
+  *                   after video. A video cut short must fail and one
+  *                   stopped half way must leave the worker usable. Then
+  *                   times -l frames of 640x360 on 1 and -j letterboxing
+  *                   threads, with the stub model.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "pose_worker.h"
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK_SIZES         3U          /* frame sizes the stream cycles   */
+#define CHECK_LONG_WIDTH    640U
+#define CHECK_LONG_HEIGHT   360U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t width;
+  uint32_t height;
+  uint32_t channels;
+} Check_SizeTypeDef;
+
+typedef struct
+{
+  int fd;
+  uint32_t frames;
+  uint32_t cut;             /* stop half way through the last frame        */
+  const Check_SizeTypeDef *sizes;
+  uint32_t count;           /* of sizes                                    */
+} Check_WriterTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const Check_SizeTypeDef check_sizes[CHECK_SIZES] =
+{
+  { 192U, 144U, 3U }, { 100U, 300U, 1U }, { 341U, 171U, 3U },
+};
+static const Check_SizeTypeDef check_long = { CHECK_LONG_WIDTH, CHECK_LONG_HEIGHT, 3U };
+
+/* Private function prototypes -----------------------------------------------*/
+static void Check_Frame(uint32_t index, const Check_SizeTypeDef *size, uint8_t *out);
+static int Check_Write(FILE *f, const Check_WriterTypeDef *w);
+static void *Check_Writer(void *arg);
+static int Check_Letterbox(void);
+static void Check_Reference(const uint8_t *src, const Check_SizeTypeDef *size, uint32_t target_width,
+                            uint32_t target_height, uint32_t swap, float *dst);
+static int Check_Video(PoseWorker_HandleTypeDef *worker, const PoseWorker_ConfigTypeDef *config, const char *path,
+                       uint32_t frames, int piped);
+static int Check_Failures(const char *path, uint32_t frames);
+static int Check_Long(uint32_t frames, uint32_t threads);
+static int Check_Start(PoseWorker_HandleTypeDef *worker, const char *path, Check_WriterTypeDef *writer,
+                       pthread_t *thread, int *fd);
+static double Check_Now(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  static const struct
+  {
+    uint32_t threads;
+    uint32_t slots;
+    uint32_t display;
+    uint32_t rgb;
+  } cases[] =
+  {
+    { 1U, 2U, 0U, 0U }, { 2U, 8U, 1U, 0U }, { 4U, 3U, 1U, 1U }, { 3U, 16U, 0U, 1U },
+  };
+  Check_WriterTypeDef writer = { -1, 60U, 0U, check_sizes, CHECK_SIZES };
+  uint32_t long_frames = 300U;
+  uint32_t threads = 4U;
+  char path[4096];
+  FILE *f;
+  int failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:l:j:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        writer.frames = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'l':
+        long_frames = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'j':
+        threads = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n frames] [-l long_frames] [-j threads] dir\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if ((optind + 1 != argc) || (threads == 0U) || (threads > POSE_THREADS_MAX))
+  {
+    fprintf(stderr, "usage: %s [-n frames] [-l long_frames] [-j threads] dir\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  /* a worker stopped on a pipe leaves its writer writing to nobody */
+  signal(SIGPIPE, SIG_IGN);
+  failed |= Check_Letterbox();
+  (void)snprintf(path, sizeof(path), "%s/pose.ppm", argv[optind]);
+  f = fopen(path, "wb");
+  if ((f == NULL) || (Check_Write(f, &writer) != 0) || (fclose(f) != 0))
+  {
+    perror(path);
+    return EXIT_FAILURE;
+  }
+  for (uint32_t i = 0U; i < (sizeof(cases) / sizeof(cases[0])); i++)
+  {
+    PoseWorker_ConfigTypeDef config = POSE_WORKER_CONFIG_DEFAULT;
+    PoseWorker_HandleTypeDef *worker;
+
+    config.threads = cases[i].threads;
+    config.slots = cases[i].slots;
+    config.display = cases[i].display;
+    config.rgb = cases[i].rgb;
+    worker = PoseWorker_Open(&config);
+    if (worker == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+    /* one worker, several videos */
+    for (int piped = 0; piped <= 1; piped++)
+    {
+      failed |= Check_Video(worker, &config, path, writer.frames, piped);
+    }
+    PoseWorker_Close(worker);
+  }
+  if (failed == 0)
+  {
+    printf("%s: keypoints of %u frames match the notebook's in %u ways\n", path, writer.frames,
+           (uint32_t)(sizeof(cases) / sizeof(cases[0])) * 2U);
+  }
+  failed |= Check_Failures(path, writer.frames);
+  failed |= Check_Long(long_frames, 1U);
+  failed |= Check_Long(long_frames, threads);
+  return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Generated frame, PGM when the size has one channel */
+static void Check_Frame(uint32_t index, const Check_SizeTypeDef *size, uint8_t *out)
+{
+  for (uint32_t y = 0U; y < size->height; y++)
+  {
+    for (uint32_t x = 0U; x < size->width; x++)
+    {
+      for (uint32_t c = 0U; c < size->channels; c++)
+      {
+        *out++ = (uint8_t)(((x * 5U) + ((y * y) / 9U) + (index * 13U) + (c * 70U) + ((x ^ y) & 32U)) & 0xFFU);
+      }
+    }
+  }
+}
+
+static int Check_Write(FILE *f, const Check_WriterTypeDef *w)
+{
+  const size_t max = (size_t)CHECK_LONG_WIDTH * CHECK_LONG_HEIGHT * 3U;
+  uint8_t *frame = malloc(max);
+  int failed = (frame == NULL);
+
+  for (uint32_t i = 0U; (i < w->frames) && (failed == 0); i++)
+  {
+    const Check_SizeTypeDef *size = &w->sizes[i % w->count];
+    size_t bytes = (size_t)size->width * size->height * size->channels;
+
+    Check_Frame(i, size, frame);
+    bytes = ((w->cut != 0U) && ((i + 1U) == w->frames)) ? (bytes / 2U) : bytes;
+    failed |= (fprintf(f, "P%c\n%u %u\n255\n", (size->channels == 1U) ? '5' : '6', size->width, size->height) < 0);
+    failed |= (fwrite(frame, 1U, bytes, f) != bytes);
+  }
+  free(frame);
+  return failed;
+}
+
+static void *Check_Writer(void *arg)
+{
+  Check_WriterTypeDef *w = arg;
+  FILE *f = fdopen(w->fd, "wb");
+
+  if (f != NULL)
+  {
+    /* a reader that stops early makes the writes fail, which is fine */
+    (void)Check_Write(f, w);
+    fclose(f);
+  }
+  else
+  {
+    close(w->fd);
+  }
+  return NULL;
+}
+
+/* PoseWorker_Letterbox() against the plain version */
+static int Check_Letterbox(void)
+{
+  static const Check_SizeTypeDef sizes[] =
+  {
+    { 192U, 144U, 3U }, { 100U, 300U, 1U }, { 640U, 360U, 3U }, { 257U, 255U, 3U }, { 1U, 1U, 3U },
+    { 2000U, 3U, 1U }, { 256U, 256U, 3U },
+  };
+  static const uint32_t targets[][2] =
+  {
+    { POSE_INPUT_SIZE, POSE_INPUT_SIZE }, { POSE_DISPLAY_WIDTH, POSE_DISPLAY_HEIGHT }, { 192U, 192U },
+  };
+  const size_t max = (size_t)POSE_DISPLAY_WIDTH * POSE_DISPLAY_HEIGHT * 3U;
+  uint8_t *src = malloc((size_t)2000U * 360U * 3U);
+  float *got = malloc(max * sizeof(float));
+  float *want = malloc(max * sizeof(float));
+  uint8_t *bytes = malloc(max);
+  void *scratch = malloc(PoseWorker_Scratch(POSE_DISPLAY_WIDTH));
+  int failed = (src == NULL) || (got == NULL) || (want == NULL) || (bytes == NULL) || (scratch == NULL);
+
+  for (uint32_t i = 0U; (failed == 0) && (i < (sizeof(sizes) / sizeof(sizes[0]))); i++)
+  {
+    for (uint32_t t = 0U; (failed == 0) && (t < (sizeof(targets) / sizeof(targets[0]))); t++)
+    {
+      const size_t n = (size_t)targets[t][0] * targets[t][1] * 3U;
+
+      Check_Frame(i, &sizes[i], src);
+      Check_Reference(src, &sizes[i], targets[t][0], targets[t][1], i & 1U, want);
+      PoseWorker_Letterbox(src, sizes[i].width, sizes[i].height, sizes[i].channels, targets[t][0], targets[t][1],
+                           i & 1U, got, bytes, scratch);
+      failed = (memcmp(got, want, n * sizeof(float)) != 0);
+      for (size_t k = 0U; (failed == 0) && (k < n); k++)
+      {
+        failed = (bytes[k] != (uint8_t)lrintf(want[k])) && (fabsf(want[k] - floorf(want[k]) - 0.5f) > 1e-3f);
+      }
+      if (failed != 0)
+      {
+        fprintf(stderr, "letterbox of %ux%ux%u to %ux%u differs from resize_with_pad\n", sizes[i].width,
+                sizes[i].height, sizes[i].channels, targets[t][0], targets[t][1]);
+      }
+    }
+  }
+  free(src);
+  free(got);
+  free(want);
+  free(bytes);
+  free(scratch);
+  return failed;
+}
+
+/* tf.image.resize_with_pad(frame, target_height, target_width) written out
+   plainly, gray to 3 channels */
+static void Check_Reference(const uint8_t *src, const Check_SizeTypeDef *size, uint32_t target_width,
+                            uint32_t target_height, uint32_t swap, float *dst)
+{
+  const float ratio = fmaxf((float)size->width / (float)target_width, (float)size->height / (float)target_height);
+  const float rw_f = (float)size->width / ratio;
+  const float rh_f = (float)size->height / ratio;
+  const int32_t rw = ((int32_t)floorf(rw_f) > 0) ? (int32_t)floorf(rw_f) : 1;
+  const int32_t rh = ((int32_t)floorf(rh_f) > 0) ? (int32_t)floorf(rh_f) : 1;
+  const int32_t left = (int32_t)fmaxf(floorf(((float)target_width - rw_f) / 2.0f), 0.0f);
+  const int32_t top = (int32_t)fmaxf(floorf(((float)target_height - rh_f) / 2.0f), 0.0f);
+  const float sx = (float)size->width / (float)rw;
+  const float sy = (float)size->height / (float)rh;
+
+  for (int32_t y = 0; y < (int32_t)target_height; y++)
+  {
+    for (int32_t x = 0; x < (int32_t)target_width; x++)
+    {
+      for (uint32_t c = 0U; c < 3U; c++)
+      {
+        const uint32_t k = (size->channels == 1U) ? 0U : ((swap != 0U) ? (2U - c) : c);
+        float v = 0.0f;
+
+        if ((y >= top) && (y < (top + rh)) && (x >= left) && (x < (left + rw)))
+        {
+          const float in_y = (((float)(y - top) + 0.5f) * sy) - 0.5f;
+          const float in_x = (((float)(x - left) + 0.5f) * sx) - 0.5f;
+          const int32_t y0 = (int32_t)fmaxf(floorf(in_y), 0.0f);
+          const int32_t y1 = (int32_t)fminf(ceilf(in_y), (float)size->height - 1.0f);
+          const int32_t x0 = (int32_t)fmaxf(floorf(in_x), 0.0f);
+          const int32_t x1 = (int32_t)fminf(ceilf(in_x), (float)size->width - 1.0f);
+          const float ly = in_y - floorf(in_y);
+          const float lx = in_x - floorf(in_x);
+          const float tl = src[((((size_t)y0 * size->width) + (size_t)x0) * size->channels) + k];
+          const float tr = src[((((size_t)y0 * size->width) + (size_t)x1) * size->channels) + k];
+          const float bl = src[((((size_t)y1 * size->width) + (size_t)x0) * size->channels) + k];
+          const float br = src[((((size_t)y1 * size->width) + (size_t)x1) * size->channels) + k];
+          const float t = tl + ((tr - tl) * lx);
+          const float b = bl + ((br - bl) * lx);
+
+          v = t + ((b - t) * ly);
+        }
+        dst[((((size_t)y * target_width) + (size_t)x) * 3U) + c] = v;
+      }
+    }
+  }
+}
+
+/* One video through the worker against the notebook's loop */
+static int Check_Video(PoseWorker_HandleTypeDef *worker, const PoseWorker_ConfigTypeDef *config, const char *path,
+                       uint32_t frames, int piped)
+{
+  const PoseWorker_BackendTypeDef *backend = PoseWorker_Backend(POSE_STUB);
+  const size_t input = (size_t)config->size * config->size * 3U;
+  const size_t display = (size_t)config->display_width * config->display_height * 3U;
+  Check_WriterTypeDef writer = { -1, frames, 0U, check_sizes, CHECK_SIZES };
+  void *model = backend->open(POSE_STUB, config->size, 1U);
+  float *want_input = malloc(input * sizeof(float));
+  float *want_display = malloc(display * sizeof(float));
+  uint8_t *src = malloc((size_t)341U * 300U * 3U);
+  float keypoints[POSE_VALUES];
+  PoseWorker_FrameTypeDef frame;
+  pthread_t thread;
+  uint32_t got = 0U;
+  int fd = -1;
+  int status = -1;
+  int failed = (model == NULL) || (want_input == NULL) || (want_display == NULL) || (src == NULL);
+
+  writer.fd = piped;
+  failed = failed || (Check_Start(worker, path, &writer, &thread, &fd) != 0);
+  while ((failed == 0) && ((status = PoseWorker_Next(worker, &frame)) == 1))
+  {
+    const Check_SizeTypeDef *size = &check_sizes[got % CHECK_SIZES];
+
+    /* the notebook: letterbox to the model, invoke, letterbox to display */
+    Check_Frame(got, size, src);
+    Check_Reference(src, size, config->size, config->size, (config->rgb == 0U), want_input);
+    (void)backend->invoke(model, want_input, keypoints);
+    failed = (frame.index != got) || (memcmp(frame.keypoints, keypoints, sizeof(keypoints)) != 0)
+             || ((config->display != 0U) != (frame.display != NULL));
+    if ((failed == 0) && (frame.display != NULL))
+    {
+      Check_Reference(src, size, config->display_width, config->display_height, (config->rgb == 0U), want_display);
+      for (size_t k = 0U; (failed == 0) && (k < display); k++)
+      {
+        failed = (abs((int)frame.display[k] - (int)lrintf(want_display[k])) > 1);
+      }
+    }
+    got++;
+  }
+  if ((failed != 0) || (status != 0) || (got != frames))
+  {
+    fprintf(stderr, "%s%s, %u threads, %u slots%s: frame %u of %u differs from the notebook's\n", path,
+            piped ? " piped" : "", config->threads, config->slots, config->display ? ", display" : "", got, frames);
+    failed = 1;
+    PoseWorker_Stop(worker);
+  }
+  close(fd);
+  if (piped)
+  {
+    pthread_join(thread, NULL);
+  }
+  if (model != NULL)
+  {
+    backend->close(model);
+  }
+  free(want_input);
+  free(want_display);
+  free(src);
+  return failed;
+}
+
+/* A video cut short fails; a worker stopped half way takes the next one */
+static int Check_Failures(const char *path, uint32_t frames)
+{
+  PoseWorker_ConfigTypeDef config = POSE_WORKER_CONFIG_DEFAULT;
+  PoseWorker_HandleTypeDef *worker = PoseWorker_Open(&config);
+  Check_WriterTypeDef writer = { 1, frames, 1U, check_sizes, CHECK_SIZES };
+  PoseWorker_FrameTypeDef frame;
+  pthread_t thread;
+  uint32_t got = 0U;
+  int fd = -1;
+  int status = -1;
+  int failed = (worker == NULL) || (Check_Start(worker, path, &writer, &thread, &fd) != 0);
+
+  while ((failed == 0) && ((status = PoseWorker_Next(worker, &frame)) == 1))
+  {
+    got++;
+  }
+  if (failed == 0)
+  {
+    close(fd);
+    pthread_join(thread, NULL);
+  }
+  if ((failed != 0) || (status != -1) || (got >= frames))
+  {
+    fprintf(stderr, "a video cut short was read as a whole one\n");
+    failed = 1;
+  }
+
+  /* stop after 2 frames of the file, then the whole of it */
+  writer.fd = 0;
+  for (uint32_t pass = 0U; (failed == 0) && (pass < 2U); pass++)
+  {
+    got = 0U;
+    failed = (Check_Start(worker, path, &writer, &thread, &fd) != 0);
+    while ((failed == 0) && ((pass == 1U) || (got < 2U)) && ((status = PoseWorker_Next(worker, &frame)) == 1))
+    {
+      got++;
+    }
+    PoseWorker_Stop(worker);
+    close(fd);
+  }
+  if ((failed != 0) || (got != frames) || (status != 0))
+  {
+    fprintf(stderr, "a worker stopped half way did not take the next video\n");
+    failed = 1;
+  }
+  PoseWorker_Close(worker);
+  return failed;
+}
+
+/* A long video through a pipe, as from ffmpeg */
+static int Check_Long(uint32_t frames, uint32_t threads)
+{
+  PoseWorker_ConfigTypeDef config = POSE_WORKER_CONFIG_DEFAULT;
+  PoseWorker_HandleTypeDef *worker;
+  Check_WriterTypeDef writer = { 1, frames, 0U, &check_long, 1U };
+  PoseWorker_FrameTypeDef frame;
+  PoseWorker_StatsTypeDef stats;
+  pthread_t thread;
+  uint32_t got = 0U;
+  double start;
+  int fd = -1;
+  int status = -1;
+
+  config.threads = threads;
+  worker = PoseWorker_Open(&config);
+  start = Check_Now();
+  if ((worker == NULL) || (Check_Start(worker, NULL, &writer, &thread, &fd) != 0))
+  {
+    return 1;
+  }
+  while ((status = PoseWorker_Next(worker, &frame)) == 1)
+  {
+    got++;
+  }
+  close(fd);
+  pthread_join(thread, NULL);
+  PoseWorker_Stats(worker, &stats);
+  printf("%u frames of %ux%u on %u letterboxing threads: %.0f frames/s; decode %.2f s, letterbox %.2f s, "
+         "invoke %.2f s; %zu bytes of slots\n", got, CHECK_LONG_WIDTH, CHECK_LONG_HEIGHT, threads,
+         (double)got / (Check_Now() - start), stats.decode, stats.letterbox, stats.invoke, stats.memory);
+  PoseWorker_Close(worker);
+  return (status != 0) || (got != frames);
+}
+
+/* Start the worker on the file at path, or on a pipe the writer fills when
+   writer->fd is set */
+static int Check_Start(PoseWorker_HandleTypeDef *worker, const char *path, Check_WriterTypeDef *writer,
+                       pthread_t *thread, int *fd)
+{
+  int fds[2];
+
+  if (writer->fd != 0)
+  {
+    if (pipe(fds) != 0)
+    {
+      return 1;
+    }
+    writer->fd = fds[1];
+    if (pthread_create(thread, NULL, Check_Writer, writer) != 0)
+    {
+      close(fds[0]);
+      close(fds[1]);
+      return 1;
+    }
+    *fd = fds[0];
+  }
+  else
+  {
+    FILE *f = fopen(path, "rb");
+
+    *fd = (f != NULL) ? dup(fileno(f)) : -1;
+    if (f != NULL)
+    {
+      fclose(f);
+    }
+  }
+  return (*fd < 0) || (PoseWorker_Start(worker, *fd) != 0);
+}
+
+static double Check_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
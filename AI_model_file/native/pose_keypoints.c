@@ -0,0 +1,172 @@
+/**
+  ******************************************************************************
+  * @file           : pose_keypoints.c
+  * @brief          : MoveNet keypoints of videos from one pose worker.
+  *
+  *                     pose_keypoints -m model [-s size] [-j threads]
+  *                                    [-t model_threads] [-q slots] [-r]
+  *                                    [-o keypoints.f32] stream...
+  *
+  *                   Each stream is PPM/PGM frames, '-' for stdin:
+  *                     ffmpeg -v error -i clip.mp4 -f image2pipe -vcodec ppm - \
+  *                       | pose_keypoints -m movenet_thunder.tflite -o clip.f32 -
+  *                   The model is loaded once for all of them. -o gets 17
+  *                   (y, x, score) float32 triples per frame, the streams one
+  *                   after the other; one line per stream with its frame
+  *                   count, and the timings, go to stdout. -m stub runs the
+  *                   stand-in model.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "pose_worker.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private function prototypes -----------------------------------------------*/
+static int Keypoints_Stream(PoseWorker_HandleTypeDef *worker, const char *path, FILE *out);
+static double Keypoints_Now(void);
+static void Keypoints_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  PoseWorker_ConfigTypeDef config = POSE_WORKER_CONFIG_DEFAULT;
+  PoseWorker_HandleTypeDef *worker;
+  PoseWorker_StatsTypeDef stats;
+  const char *out_path = NULL;
+  FILE *out = NULL;
+  double start;
+  int failed = 0;
+  int opt;
+
+  config.model = NULL;
+  while ((opt = getopt(argc, argv, "m:s:j:t:q:ro:h")) != -1)
+  {
+    switch (opt)
+    {
+      case 'm':
+        config.model = optarg;
+        break;
+      case 's':
+        config.size = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'j':
+        config.threads = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 't':
+        config.model_threads = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'q':
+        config.slots = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        config.rgb = 1U;
+        break;
+      case 'o':
+        out_path = optarg;
+        break;
+      default:
+        Keypoints_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((config.model == NULL) || (optind == argc))
+  {
+    Keypoints_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  start = Keypoints_Now();
+  worker = PoseWorker_Open(&config);
+  if (worker == NULL)
+  {
+    fprintf(stderr, "%s: cannot start a worker on it\n", config.model);
+    return EXIT_FAILURE;
+  }
+  printf("model loaded in %.3f s\n", Keypoints_Now() - start);
+  if ((out_path != NULL) && ((out = fopen(out_path, "wb")) == NULL))
+  {
+    perror(out_path);
+    PoseWorker_Close(worker);
+    return EXIT_FAILURE;
+  }
+
+  start = Keypoints_Now();
+  for (int i = optind; i < argc; i++)
+  {
+    failed |= Keypoints_Stream(worker, argv[i], out);
+  }
+  PoseWorker_Stats(worker, &stats);
+  printf("%llu frames of %llu videos in %.2f s, %.0f frames/s: decode %.2f s, letterbox %.2f s on %u threads, "
+         "invoke %.2f s\n", (unsigned long long)stats.frames, (unsigned long long)stats.videos,
+         Keypoints_Now() - start, (double)stats.frames / (Keypoints_Now() - start), stats.decode, stats.letterbox,
+         config.threads, stats.invoke);
+  PoseWorker_Close(worker);
+  if ((out != NULL) && (fclose(out) != 0))
+  {
+    perror(out_path);
+    failed = 1;
+  }
+  return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int Keypoints_Stream(PoseWorker_HandleTypeDef *worker, const char *path, FILE *out)
+{
+  const int fd = (strcmp(path, "-") == 0) ? STDIN_FILENO : open(path, O_RDONLY);
+  PoseWorker_FrameTypeDef frame;
+  uint64_t frames = 0U;
+  int status = -1;
+
+  if ((fd < 0) || (PoseWorker_Start(worker, fd) != 0))
+  {
+    perror(path);
+  }
+  else
+  {
+    while ((status = PoseWorker_Next(worker, &frame)) == 1)
+    {
+      if ((out != NULL) && (fwrite(frame.keypoints, sizeof(float), POSE_VALUES, out) != POSE_VALUES))
+      {
+        perror("keypoints");
+        PoseWorker_Stop(worker);
+        status = -1;
+        break;
+      }
+      frames++;
+    }
+  }
+  if ((fd >= 0) && (fd != STDIN_FILENO))
+  {
+    close(fd);
+  }
+  printf("%s %llu%s\n", path, (unsigned long long)frames, (status == 0) ? "" : " failed");
+  return (status != 0);
+}
+
+static double Keypoints_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static void Keypoints_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s -m model [-s size] [-j threads] [-t model_threads] [-q slots] [-r] [-o keypoints.f32] "
+          "stream...\n"
+          "  -m     .tflite MoveNet (make TFLITE=dir), or %s\n"
+          "  -s     side of the model input (%u, 192 for lightning)\n"
+          "  -j -t  letterboxing threads and the interpreter's own\n"
+          "  -q     frames in flight (%u at most)\n"
+          "  -r     RGB to the model, rather than BGR as the notebook's cv2 frames\n"
+          "  -o     17 (y, x, score) float32 triples per frame\n",
+          argv0, POSE_STUB, POSE_INPUT_SIZE, POSE_SLOTS_MAX);
+}
@@ -0,0 +1,706 @@
+/**
+  ******************************************************************************
+  * @file           : pose_worker.c
+  * @brief          : get_movenet_data() of model.ipynb as a persistent,
+  *                   pipelined worker.
+  *
+  *                   The notebook makes a new interpreter and allocates its
+  *                   tensors for every video, looks up the tensor details
+  *                   for every frame and letterboxes every frame twice, to
+  *                   256x341 for display and 256x256 for the model. Here:
+  *                     - the model is loaded and its tensors allocated once,
+  *                       in PoseWorker_Open(), and the worker then takes
+  *                       one video after another (PoseWorker_Start())
+  *                     - frames go through a ring of slots, each with its
+  *                       source, input and display buffers allocated once,
+  *                       and three stages overlap on different frames: a
+  *                       thread decodes PPM/PGM frames, `threads` threads
+  *                       letterbox them and a thread runs the model
+  *                     - the display letterbox is only made when asked for
+  *                     - the keypoints come out in frame order as 17 x 3
+  *                       floats per frame
+  *
+  *                   The letterbox is tf.image.resize_with_pad: scaled to
+  *                   fit, bilinear with half-pixel centres and centred in
+  *                   zeros, as float values 0..255.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "pose_worker.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+/* Slot states, in the order a frame goes through them */
+#define SLOT_FREE           0U
+#define SLOT_DECODED        1U
+#define SLOT_BOXED          2U
+#define SLOT_DONE           3U
+
+#define POSE_NO_END         UINT64_MAX
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t state;           /* SLOT_*                                      */
+  uint64_t seq;             /* frame of the video in the slot              */
+  uint8_t *src;             /* the decoded frame                           */
+  size_t src_max;
+  uint32_t width;
+  uint32_t height;
+  uint32_t channels;
+  float *input;             /* [size][size][3]                             */
+  uint8_t *display;         /* [display_height][display_width][3]          */
+  float keypoints[POSE_VALUES];
+} Pose_SlotTypeDef;
+
+/* A letterboxing thread */
+typedef struct
+{
+  PoseWorker_HandleTypeDef *worker;
+  pthread_t tid;
+  void *scratch;            /* PoseWorker_Scratch() bytes                  */
+} Pose_BoxerTypeDef;
+
+struct PoseWorker_Handle
+{
+  PoseWorker_ConfigTypeDef config;
+  const PoseWorker_BackendTypeDef *backend;
+  void *model;
+  Pose_SlotTypeDef *slots;
+  FILE *file;
+  pthread_t decoder;
+  pthread_t invoker;
+  Pose_BoxerTypeDef boxers[POSE_THREADS_MAX];
+  uint32_t running;         /* stage threads of the current video          */
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  uint64_t box_next;        /* next frame to letterbox, invoke, hand out   */
+  uint64_t invoke_next;
+  uint64_t out_next;
+  uint64_t end;             /* frames of the video once known              */
+  int failed;
+  int stop;
+  int held;                 /* the caller holds slot out_next - 1          */
+  PoseWorker_StatsTypeDef stats;
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void *Pose_Decoder(void *arg);
+static void *Pose_Boxer(void *arg);
+static void *Pose_Invoker(void *arg);
+static int Pose_ReadFrame(PoseWorker_HandleTypeDef *worker, Pose_SlotTypeDef *slot, uint64_t seq);
+static int Pose_HeaderField(FILE *f, uint32_t *value);
+static void Pose_End(PoseWorker_HandleTypeDef *worker, uint64_t end, int failed);
+static void Pose_Join(PoseWorker_HandleTypeDef *worker);
+static void Pose_Geometry(uint32_t width, uint32_t height, uint32_t target_width, uint32_t target_height,
+                          uint32_t *resized_width, uint32_t *resized_height, uint32_t *top, uint32_t *left);
+static double Pose_Now(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Load the model and allocate every buffer the worker needs.
+  * @param  config: see PoseWorker_ConfigTypeDef
+  * @retval Worker, NULL if the configuration is wrong or the model cannot
+  *         be loaded
+  */
+PoseWorker_HandleTypeDef *PoseWorker_Open(const PoseWorker_ConfigTypeDef *config)
+{
+  PoseWorker_HandleTypeDef *worker;
+  size_t input_floats;
+  size_t display_bytes;
+  size_t scratch;
+  int failed = 0;
+
+  if ((config == NULL) || (config->model == NULL) || (config->size == 0U) || (config->size > POSE_TARGET_MAX)
+      || (config->threads == 0U) || (config->threads > POSE_THREADS_MAX) || (config->model_threads == 0U)
+      || (config->slots < 2U) || (config->slots > POSE_SLOTS_MAX)
+      || ((config->display != 0U) && ((config->display_width == 0U) || (config->display_height == 0U)
+                                      || (config->display_width > POSE_TARGET_MAX)
+                                      || (config->display_height > POSE_TARGET_MAX))))
+  {
+    return NULL;
+  }
+  worker = calloc(1U, sizeof(*worker));
+  if (worker == NULL)
+  {
+    return NULL;
+  }
+  worker->config = *config;
+  worker->backend = PoseWorker_Backend(config->model);
+  worker->model = (worker->backend != NULL) ? worker->backend->open(config->model, config->size,
+                                                                    config->model_threads) : NULL;
+  if (worker->model == NULL)
+  {
+    free(worker);
+    return NULL;
+  }
+  pthread_mutex_init(&worker->lock, NULL);
+  pthread_cond_init(&worker->changed, NULL);
+
+  input_floats = (size_t)config->size * config->size * 3U;
+  display_bytes = (config->display != 0U) ? ((size_t)config->display_width * config->display_height * 3U) : 0U;
+  worker->slots = calloc(config->slots, sizeof(*worker->slots));
+  failed = (worker->slots == NULL);
+  for (uint32_t i = 0U; (failed == 0) && (i < config->slots); i++)
+  {
+    worker->slots[i].input = malloc(input_floats * sizeof(float));
+    worker->slots[i].display = (display_bytes != 0U) ? malloc(display_bytes) : NULL;
+    failed = (worker->slots[i].input == NULL) || ((display_bytes != 0U) && (worker->slots[i].display == NULL));
+  }
+  scratch = PoseWorker_Scratch((config->display_width > config->size) ? config->display_width : config->size);
+  for (uint32_t t = 0U; (failed == 0) && (t < config->threads); t++)
+  {
+    worker->boxers[t].worker = worker;
+    worker->boxers[t].scratch = malloc(scratch);
+    failed = (worker->boxers[t].scratch == NULL);
+  }
+  worker->stats.memory = config->slots * ((input_floats * sizeof(float)) + display_bytes)
+                         + (config->threads * scratch);
+  if (failed != 0)
+  {
+    PoseWorker_Close(worker);
+    return NULL;
+  }
+  return worker;
+}
+
+/**
+  * @brief  Start on a video, stopping the one before if it was not read to
+  *         the end.
+  * @param  fd: PPM/PGM frames (ffmpeg -f image2pipe -vcodec ppm), read to
+  *         the end, not closed
+  * @retval 0, -1 if the stage threads cannot be started
+  */
+int PoseWorker_Start(PoseWorker_HandleTypeDef *worker, int fd)
+{
+  const uint32_t threads = worker->config.threads;
+  int dupped;
+
+  PoseWorker_Stop(worker);
+  dupped = dup(fd);
+  worker->file = (dupped >= 0) ? fdopen(dupped, "rb") : NULL;
+  if (worker->file == NULL)
+  {
+    if (dupped >= 0)
+    {
+      close(dupped);
+    }
+    return -1;
+  }
+  for (uint32_t i = 0U; i < worker->config.slots; i++)
+  {
+    worker->slots[i].state = SLOT_FREE;
+  }
+  worker->box_next = 0U;
+  worker->invoke_next = 0U;
+  worker->out_next = 0U;
+  worker->end = POSE_NO_END;
+  worker->failed = 0;
+  worker->stop = 0;
+  worker->held = 0;
+  worker->stats.videos++;
+
+  if (pthread_create(&worker->decoder, NULL, Pose_Decoder, worker) != 0)
+  {
+    fclose(worker->file);
+    worker->file = NULL;
+    return -1;
+  }
+  worker->running = 1U;
+  if (pthread_create(&worker->invoker, NULL, Pose_Invoker, worker) == 0)
+  {
+    worker->running++;
+    while ((worker->running < (threads + 2U))
+           && (pthread_create(&worker->boxers[worker->running - 2U].tid, NULL, Pose_Boxer,
+                              &worker->boxers[worker->running - 2U]) == 0))
+    {
+      worker->running++;
+    }
+  }
+  if (worker->running != (threads + 2U))
+  {
+    PoseWorker_Stop(worker);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Keypoints of the next frame, in order.
+  * @param  frame: the results, valid until the next call
+  * @retval 1 for a frame, 0 at the end of the video, -1 if it is not a
+  *         video of PPM/PGM frames, is cut short, or the model failed
+  */
+int PoseWorker_Next(PoseWorker_HandleTypeDef *worker, PoseWorker_FrameTypeDef *frame)
+{
+  Pose_SlotTypeDef *slot;
+  int status;
+
+  if (worker->running == 0U)
+  {
+    return (worker->failed != 0) ? -1 : 0;
+  }
+  pthread_mutex_lock(&worker->lock);
+  if (worker->held != 0)
+  {
+    worker->slots[(worker->out_next - 1U) % worker->config.slots].state = SLOT_FREE;
+    worker->held = 0;
+    pthread_cond_broadcast(&worker->changed);
+  }
+  slot = &worker->slots[worker->out_next % worker->config.slots];
+  while ((worker->failed == 0) && (worker->out_next < worker->end)
+         && !((slot->state == SLOT_DONE) && (slot->seq == worker->out_next)))
+  {
+    pthread_cond_wait(&worker->changed, &worker->lock);
+  }
+  status = (worker->failed != 0) ? -1 : ((worker->out_next < worker->end) ? 1 : 0);
+  if (status == 1)
+  {
+    frame->keypoints = slot->keypoints;
+    frame->display = slot->display;
+    frame->index = worker->out_next++;
+    worker->held = 1;
+    worker->stats.frames++;
+  }
+  pthread_mutex_unlock(&worker->lock);
+  if (status != 1)
+  {
+    Pose_Join(worker);
+  }
+  return status;
+}
+
+/**
+  * @brief  Give up the current video. A stage waiting on the source is
+  *         only woken by its end: close the writing side (stop the
+  *         decoder) before stopping a video that is not finished.
+  */
+void PoseWorker_Stop(PoseWorker_HandleTypeDef *worker)
+{
+  if (worker->running != 0U)
+  {
+    pthread_mutex_lock(&worker->lock);
+    worker->stop = 1;
+    pthread_cond_broadcast(&worker->changed);
+    pthread_mutex_unlock(&worker->lock);
+    Pose_Join(worker);
+  }
+}
+
+void PoseWorker_Stats(const PoseWorker_HandleTypeDef *worker, PoseWorker_StatsTypeDef *stats)
+{
+  *stats = worker->stats;
+}
+
+void PoseWorker_Close(PoseWorker_HandleTypeDef *worker)
+{
+  if (worker == NULL)
+  {
+    return;
+  }
+  PoseWorker_Stop(worker);
+  for (uint32_t i = 0U; (worker->slots != NULL) && (i < worker->config.slots); i++)
+  {
+    free(worker->slots[i].src);
+    free(worker->slots[i].input);
+    free(worker->slots[i].display);
+  }
+  for (uint32_t t = 0U; t < POSE_THREADS_MAX; t++)
+  {
+    free(worker->boxers[t].scratch);
+  }
+  free(worker->slots);
+  worker->backend->close(worker->model);
+  pthread_cond_destroy(&worker->changed);
+  pthread_mutex_destroy(&worker->lock);
+  free(worker);
+}
+
+/**
+  * @brief  Bytes of scratch PoseWorker_Letterbox() needs for targets up to
+  *         target_width wide.
+  */
+size_t PoseWorker_Scratch(uint32_t target_width)
+{
+  return (size_t)target_width * (2U * sizeof(int32_t) + sizeof(float));
+}
+
+/**
+  * @brief  tf.image.resize_with_pad of one frame.
+  * @param  src: [height][width][channels], channels 1 or 3
+  * @param  swap: reverse the channel order
+  * @param  dst_float: [target_height][target_width][3] values 0..255, or NULL
+  * @param  dst_byte: the same rounded to bytes, or NULL
+  * @param  scratch: PoseWorker_Scratch(target_width) bytes
+  */
+void PoseWorker_Letterbox(const uint8_t *src, uint32_t width, uint32_t height, uint32_t channels,
+                          uint32_t target_width, uint32_t target_height, uint32_t swap, float *dst_float,
+                          uint8_t *dst_byte, void *scratch)
+{
+  int32_t *x_lo = scratch;
+  int32_t *x_hi = &x_lo[target_width];
+  float *x_lerp = (float *)&x_hi[target_width];
+  const size_t src_stride = (size_t)width * channels;
+  uint32_t rw;
+  uint32_t rh;
+  uint32_t top;
+  uint32_t left;
+  uint32_t from[3];
+  float scale;
+
+  Pose_Geometry(width, height, target_width, target_height, &rw, &rh, &top, &left);
+  for (uint32_t c = 0U; c < 3U; c++)
+  {
+    from[c] = (channels == 1U) ? 0U : ((swap != 0U) ? (2U - c) : c);
+  }
+  scale = (float)width / (float)rw;
+  for (uint32_t x = 0U; x < rw; x++)
+  {
+    const float in = (((float)x + 0.5f) * scale) - 0.5f;
+    const float in_f = floorf(in);
+    const int32_t hi = (int32_t)ceilf(in);
+
+    x_lo[x] = ((in_f > 0.0f) ? (int32_t)in_f : 0) * (int32_t)channels;
+    x_hi[x] = ((hi < (int32_t)width) ? hi : (int32_t)width - 1) * (int32_t)channels;
+    x_lerp[x] = in - in_f;
+  }
+
+  scale = (float)height / (float)rh;
+  for (uint32_t y = 0U; y < target_height; y++)
+  {
+    float *row_float = (dst_float != NULL) ? &dst_float[(size_t)y * target_width * 3U] : NULL;
+    uint8_t *row_byte = (dst_byte != NULL) ? &dst_byte[(size_t)y * target_width * 3U] : NULL;
+    const uint8_t *row_lo;
+    const uint8_t *row_hi;
+    float y_lerp;
+
+    if (row_float != NULL)
+    {
+      memset(row_float, 0, (size_t)target_width * 3U * sizeof(float));
+    }
+    if (row_byte != NULL)
+    {
+      memset(row_byte, 0, (size_t)target_width * 3U);
+    }
+    if ((y < top) || (y >= (top + rh)))
+    {
+      continue;
+    }
+    {
+      const float in = (((float)(y - top) + 0.5f) * scale) - 0.5f;
+      const float in_f = floorf(in);
+      const int32_t hi = (int32_t)ceilf(in);
+
+      row_lo = &src[(size_t)((in_f > 0.0f) ? (int32_t)in_f : 0) * src_stride];
+      row_hi = &src[(size_t)((hi < (int32_t)height) ? hi : (int32_t)height - 1) * src_stride];
+      y_lerp = in - in_f;
+    }
+    row_float = (row_float != NULL) ? &row_float[(size_t)left * 3U] : NULL;
+    row_byte = (row_byte != NULL) ? &row_byte[(size_t)left * 3U] : NULL;
+    for (uint32_t i = 0U; i < rw; i++)
+    {
+      for (uint32_t c = 0U; c < 3U; c++)
+      {
+        const float tl = (float)row_lo[x_lo[i] + from[c]];
+        const float tr = (float)row_lo[x_hi[i] + from[c]];
+        const float bl = (float)row_hi[x_lo[i] + from[c]];
+        const float br = (float)row_hi[x_hi[i] + from[c]];
+        const float t = tl + ((tr - tl) * x_lerp[i]);
+        const float b = bl + ((br - bl) * x_lerp[i]);
+        const float v = t + ((b - t) * y_lerp);
+
+        if (row_float != NULL)
+        {
+          row_float[(i * 3U) + c] = v;
+        }
+        if (row_byte != NULL)
+        {
+          row_byte[(i * 3U) + c] = (uint8_t)(v + 0.5f);
+        }
+      }
+    }
+  }
+}
+
+/* Decode frames into free slots until the end of the video */
+static void *Pose_Decoder(void *arg)
+{
+  PoseWorker_HandleTypeDef *worker = arg;
+  const uint32_t slots = worker->config.slots;
+
+  for (uint64_t seq = 0U;; seq++)
+  {
+    Pose_SlotTypeDef *slot = &worker->slots[seq % slots];
+    double start;
+    int status;
+
+    pthread_mutex_lock(&worker->lock);
+    while ((worker->stop == 0) && (worker->failed == 0) && (slot->state != SLOT_FREE))
+    {
+      pthread_cond_wait(&worker->changed, &worker->lock);
+    }
+    status = (worker->stop == 0) && (worker->failed == 0);
+    pthread_mutex_unlock(&worker->lock);
+    if (status == 0)
+    {
+      break;
+    }
+
+    start = Pose_Now();
+    status = Pose_ReadFrame(worker, slot, seq);
+    pthread_mutex_lock(&worker->lock);
+    worker->stats.decode += Pose_Now() - start;
+    if (status == 1)
+    {
+      slot->seq = seq;
+      slot->state = SLOT_DECODED;
+      pthread_cond_broadcast(&worker->changed);
+      pthread_mutex_unlock(&worker->lock);
+      continue;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    Pose_End(worker, seq, (status != 0));
+    break;
+  }
+  return NULL;
+}
+
+/* Letterbox decoded frames, the next one in order each time */
+static void *Pose_Boxer(void *arg)
+{
+  const Pose_BoxerTypeDef *boxer = arg;
+  PoseWorker_HandleTypeDef *worker = boxer->worker;
+
+  for (;;)
+  {
+    const PoseWorker_ConfigTypeDef *cfg = &worker->config;
+    Pose_SlotTypeDef *slot;
+    uint64_t seq;
+    double start;
+
+    pthread_mutex_lock(&worker->lock);
+    for (;;)
+    {
+      seq = worker->box_next;
+      slot = &worker->slots[seq % cfg->slots];
+      if ((worker->stop != 0) || (worker->failed != 0) || (seq >= worker->end)
+          || ((slot->state == SLOT_DECODED) && (slot->seq == seq)))
+      {
+        break;
+      }
+      pthread_cond_wait(&worker->changed, &worker->lock);
+    }
+    if ((worker->stop != 0) || (worker->failed != 0) || (seq >= worker->end))
+    {
+      pthread_mutex_unlock(&worker->lock);
+      break;
+    }
+    worker->box_next++;
+    pthread_mutex_unlock(&worker->lock);
+
+    start = Pose_Now();
+    PoseWorker_Letterbox(slot->src, slot->width, slot->height, slot->channels, cfg->size, cfg->size,
+                         (cfg->rgb == 0U), slot->input, NULL, boxer->scratch);
+    if (slot->display != NULL)
+    {
+      PoseWorker_Letterbox(slot->src, slot->width, slot->height, slot->channels, cfg->display_width,
+                           cfg->display_height, (cfg->rgb == 0U), NULL, slot->display,
+                           boxer->scratch);
+    }
+
+    pthread_mutex_lock(&worker->lock);
+    worker->stats.letterbox += Pose_Now() - start;
+    slot->state = SLOT_BOXED;
+    pthread_cond_broadcast(&worker->changed);
+    pthread_mutex_unlock(&worker->lock);
+  }
+  return NULL;
+}
+
+/* Run the model on the letterboxed frames, in order */
+static void *Pose_Invoker(void *arg)
+{
+  PoseWorker_HandleTypeDef *worker = arg;
+
+  for (;;)
+  {
+    Pose_SlotTypeDef *slot;
+    uint64_t seq;
+    double start;
+    int status;
+
+    pthread_mutex_lock(&worker->lock);
+    for (;;)
+    {
+      seq = worker->invoke_next;
+      slot = &worker->slots[seq % worker->config.slots];
+      if ((worker->stop != 0) || (worker->failed != 0) || (seq >= worker->end)
+          || ((slot->state == SLOT_BOXED) && (slot->seq == seq)))
+      {
+        break;
+      }
+      pthread_cond_wait(&worker->changed, &worker->lock);
+    }
+    if ((worker->stop != 0) || (worker->failed != 0) || (seq >= worker->end))
+    {
+      pthread_mutex_unlock(&worker->lock);
+      break;
+    }
+    worker->invoke_next++;
+    pthread_mutex_unlock(&worker->lock);
+
+    start = Pose_Now();
+    status = worker->backend->invoke(worker->model, slot->input, slot->keypoints);
+
+    pthread_mutex_lock(&worker->lock);
+    worker->stats.invoke += Pose_Now() - start;
+    slot->state = SLOT_DONE;
+    worker->failed |= (status != 0);
+    pthread_cond_broadcast(&worker->changed);
+    pthread_mutex_unlock(&worker->lock);
+  }
+  return NULL;
+}
+
+/* One PPM/PGM frame into the slot; 1 if there was one, 0 at the end */
+static int Pose_ReadFrame(PoseWorker_HandleTypeDef *worker, Pose_SlotTypeDef *slot, uint64_t seq)
+{
+  FILE *f = worker->file;
+  uint32_t maxval;
+  size_t bytes;
+  int c;
+
+  do
+  {
+    c = fgetc(f);
+  } while ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'));
+  if (c == EOF)
+  {
+    return 0;
+  }
+  c = (c == 'P') ? fgetc(f) : EOF;
+  slot->channels = (c == '5') ? 1U : ((c == '6') ? 3U : 0U);
+  if ((slot->channels == 0U) || (Pose_HeaderField(f, &slot->width) != 0)
+      || (Pose_HeaderField(f, &slot->height) != 0) || (Pose_HeaderField(f, &maxval) != 0) || (maxval == 0U)
+      || (maxval > 255U) || (slot->width == 0U) || (slot->height == 0U) || (slot->width > POSE_SIDE_MAX)
+      || (slot->height > POSE_SIDE_MAX))
+  {
+    fprintf(stderr, "frame %llu: not a binary PGM or PPM image\n", (unsigned long long)seq);
+    return -1;
+  }
+  bytes = (size_t)slot->width * slot->height * slot->channels;
+  if (bytes > slot->src_max)
+  {
+    free(slot->src);
+    slot->src = malloc(bytes);
+    slot->src_max = (slot->src != NULL) ? bytes : 0U;
+  }
+  if ((slot->src == NULL) || (fread(slot->src, 1U, bytes, f) != bytes))
+  {
+    fprintf(stderr, "frame %llu: cut short\n", (unsigned long long)seq);
+    return -1;
+  }
+  return 1;
+}
+
+static int Pose_HeaderField(FILE *f, uint32_t *value)
+{
+  int c = fgetc(f);
+  uint32_t v = 0U;
+  uint32_t digits = 0U;
+
+  for (;;)
+  {
+    if (c == '#')
+    {
+      while ((c != '\n') && (c != EOF))
+      {
+        c = fgetc(f);
+      }
+    }
+    else if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'))
+    {
+      c = fgetc(f);
+    }
+    else
+    {
+      break;
+    }
+  }
+  while ((c >= '0') && (c <= '9') && (digits < 9U))
+  {
+    v = (v * 10U) + (uint32_t)(c - '0');
+    digits++;
+    c = fgetc(f);
+  }
+  *value = v;
+  return ((digits == 0U) || ((c != ' ') && (c != '\t') && (c != '\r') && (c != '\n')));
+}
+
+static void Pose_End(PoseWorker_HandleTypeDef *worker, uint64_t end, int failed)
+{
+  pthread_mutex_lock(&worker->lock);
+  worker->end = end;
+  worker->failed |= failed;
+  pthread_cond_broadcast(&worker->changed);
+  pthread_mutex_unlock(&worker->lock);
+}
+
+static void Pose_Join(PoseWorker_HandleTypeDef *worker)
+{
+  if (worker->running == 0U)
+  {
+    return;
+  }
+  pthread_join(worker->decoder, NULL);
+  if (worker->running > 1U)
+  {
+    pthread_join(worker->invoker, NULL);
+  }
+  for (uint32_t t = 2U; t < worker->running; t++)
+  {
+    pthread_join(worker->boxers[t - 2U].tid, NULL);
+  }
+  worker->running = 0U;
+  fclose(worker->file);
+  worker->file = NULL;
+}
+
+/* tf.image.resize_with_pad: the scaled size and the padding above and to
+   the left, in float32 as TensorFlow computes them */
+static void Pose_Geometry(uint32_t width, uint32_t height, uint32_t target_width, uint32_t target_height,
+                          uint32_t *resized_width, uint32_t *resized_height, uint32_t *top, uint32_t *left)
+{
+  const float ratio_w = (float)width / (float)target_width;
+  const float ratio_h = (float)height / (float)target_height;
+  const float ratio = (ratio_w > ratio_h) ? ratio_w : ratio_h;
+  const float rw = (float)width / ratio;
+  const float rh = (float)height / ratio;
+  const float pad_w = floorf(((float)target_width - rw) / 2.0f);
+  const float pad_h = floorf(((float)target_height - rh) / 2.0f);
+
+  *resized_width = (uint32_t)floorf(rw);
+  *resized_height = (uint32_t)floorf(rh);
+  *resized_width = (*resized_width == 0U) ? 1U : *resized_width;
+  *resized_height = (*resized_height == 0U) ? 1U : *resized_height;
+  *left = (pad_w > 0.0f) ? (uint32_t)pad_w : 0U;
+  *top = (pad_h > 0.0f) ? (uint32_t)pad_h : 0U;
+}
+
+static double Pose_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
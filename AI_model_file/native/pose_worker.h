@@ -0,0 +1,107 @@
+/**
+  ******************************************************************************
+  * @file           : pose_worker.h
+  * @brief          : Header for pose_worker.c file.
+  *                   MoveNet keypoints of every frame of a video, as
+  *                   get_movenet_data() of model.ipynb gives them, from a
+  *                   worker that loads the model once and is then handed
+  *                   one video after another; built as libpose_worker.so
+  *                   for movenet_pose.py and as the pose_worker tool.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __POSE_WORKER_H
+#define __POSE_WORKER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define POSE_KEYPOINTS          17U     /* MoveNet single pose             */
+#define POSE_VALUES             (POSE_KEYPOINTS * 3U)   /* y, x, score     */
+
+/* model.ipynb */
+#define POSE_INPUT_SIZE         256U    /* thunder, 192 for lightning      */
+#define POSE_DISPLAY_WIDTH      341U
+#define POSE_DISPLAY_HEIGHT     256U
+
+#define POSE_SIDE_MAX           16384U  /* of a source frame               */
+#define POSE_TARGET_MAX         2048U   /* of the input and display frames */
+#define POSE_THREADS_MAX        16U
+#define POSE_SLOTS_MAX          64U
+
+#define POSE_STUB               "stub"  /* model name of PoseWorker_Stub   */
+
+/* Exported types ------------------------------------------------------------*/
+/* What runs the model: TFLite, or the stand-in used by the checks */
+typedef struct
+{
+  const char *name;
+  void *(*open)(const char *model, uint32_t size, uint32_t threads);
+  int (*invoke)(void *model, const float *input, float keypoints[POSE_VALUES]);
+  void (*close)(void *model);
+} PoseWorker_BackendTypeDef;
+
+typedef struct
+{
+  const char *model;        /* .tflite file, or POSE_STUB                  */
+  uint32_t size;            /* of the square model input                   */
+  uint32_t threads;         /* letterboxing frames                         */
+  uint32_t model_threads;   /* the interpreter's own                       */
+  uint32_t slots;           /* frames in flight between the stages         */
+  uint32_t display;         /* also letterbox display_width x height       */
+  uint32_t display_width;
+  uint32_t display_height;
+  uint32_t rgb;             /* RGB to the model, rather than BGR as the
+                               notebook's cv2 frames are                   */
+} PoseWorker_ConfigTypeDef;
+
+#define POSE_WORKER_CONFIG_DEFAULT  { POSE_STUB, POSE_INPUT_SIZE, 2U, 1U, 8U, 0U, POSE_DISPLAY_WIDTH, \
+                                      POSE_DISPLAY_HEIGHT, 0U }
+
+/* A frame's results, valid until the next call */
+typedef struct
+{
+  const float *keypoints;   /* [POSE_KEYPOINTS][3], y and x in 0..1 of the
+                               letterboxed input, and score                */
+  const uint8_t *display;   /* [display_height][display_width][3], or NULL */
+  uint64_t index;           /* frames of the video before this one         */
+} PoseWorker_FrameTypeDef;
+
+typedef struct
+{
+  uint64_t frames;          /* since the worker was opened                 */
+  uint64_t videos;
+  double letterbox;         /* seconds, summed over the threads            */
+  double invoke;
+  double decode;
+  size_t memory;            /* bytes of the slots                          */
+} PoseWorker_StatsTypeDef;
+
+typedef struct PoseWorker_Handle PoseWorker_HandleTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+PoseWorker_HandleTypeDef *PoseWorker_Open(const PoseWorker_ConfigTypeDef *config);
+int PoseWorker_Start(PoseWorker_HandleTypeDef *worker, int fd);
+int PoseWorker_Next(PoseWorker_HandleTypeDef *worker, PoseWorker_FrameTypeDef *frame);
+void PoseWorker_Stop(PoseWorker_HandleTypeDef *worker);
+void PoseWorker_Stats(const PoseWorker_HandleTypeDef *worker, PoseWorker_StatsTypeDef *stats);
+void PoseWorker_Close(PoseWorker_HandleTypeDef *worker);
+
+const PoseWorker_BackendTypeDef *PoseWorker_Backend(const char *model);
+void PoseWorker_Letterbox(const uint8_t *src, uint32_t width, uint32_t height, uint32_t channels,
+                          uint32_t target_width, uint32_t target_height, uint32_t swap, float *dst_float,
+                          uint8_t *dst_byte, void *scratch);
+size_t PoseWorker_Scratch(uint32_t target_width);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __POSE_WORKER_H */
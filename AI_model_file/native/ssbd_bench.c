@@ -0,0 +1,222 @@
+/**
+  ******************************************************************************
+  * @file           : ssbd_bench.c
+  * @brief          : Clips per second of an SSBD model file on the runtime.
+  *
+  *                     ssbd_bench -m model.ssbm [-j threads] [-n clips]
+  *                                [-o probs.f32]
+  *
+  *                   Every thread keeps its own context and classifies
+  *                   pseudo-random uint8 clips, clip i the same whatever
+  *                   thread gets it; -o gets the class probabilities of
+  *                   each clip in order, float32, to compare builds.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ssbd_model.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_THREADS_MAX       64U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const SsbdModel_HandleTypeDef *model;
+  atomic_uint next;
+  uint32_t clips;
+  float *probs;             /* [clips][classes]                            */
+  atomic_int failed;
+} Bench_TypeDef;
+
+/* Private function prototypes -----------------------------------------------*/
+static void *Bench_Thread(void *arg);
+static void Bench_Clip(uint32_t clip, uint8_t *frames, size_t size);
+static double Bench_Now(void);
+static void Bench_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  pthread_t threads[BENCH_THREADS_MAX];
+  const SsbdModel_HeaderTypeDef *hdr;
+  SsbdModel_HandleTypeDef *model;
+  SsbdModel_ContextTypeDef *probe;
+  Bench_TypeDef bench = {0};
+  const char *path = NULL;
+  const char *out_path = NULL;
+  uint32_t n_threads = 1U;
+  uint32_t started = 0U;
+  size_t workspace;
+  double start;
+  double elapsed;
+  int opt;
+
+  bench.clips = 8U;
+  while ((opt = getopt(argc, argv, "m:j:n:o:h")) != -1)
+  {
+    switch (opt)
+    {
+      case 'm':
+        path = optarg;
+        break;
+      case 'j':
+        n_threads = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        bench.clips = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'o':
+        out_path = optarg;
+        break;
+      default:
+        Bench_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((path == NULL) || (optind != argc) || (n_threads == 0U) || (n_threads > BENCH_THREADS_MAX) ||
+      (bench.clips == 0U))
+  {
+    Bench_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  start = Bench_Now();
+  model = SsbdModel_Load(path);
+  if (model == NULL)
+  {
+    fprintf(stderr, "%s: not an SSBD model file\n", path);
+    return EXIT_FAILURE;
+  }
+  hdr = SsbdModel_Header(model);
+  probe = SsbdModel_NewContext(model);
+  if ((hdr->channels != 3U) || (probe == NULL))
+  {
+    fprintf(stderr, "%s: %s\n", path, (probe == NULL) ? "no memory for a context" : "not a 3 channel model");
+    SsbdModel_FreeContext(probe);
+    SsbdModel_Free(model);
+    return EXIT_FAILURE;
+  }
+  workspace = SsbdModel_Workspace(probe);
+  SsbdModel_FreeContext(probe);
+  printf("%s: %ux%ux%u clips, %u classes, loaded in %.3f s, %zu kB workspace a thread (%s)\n", path, hdr->frames,
+         hdr->height, hdr->width, hdr->classes, Bench_Now() - start, workspace / 1024U, SsbdModel_Isa());
+
+  bench.model = model;
+  bench.probs = calloc((size_t)bench.clips * hdr->classes, sizeof(float));
+  if (bench.probs == NULL)
+  {
+    perror("probs");
+    SsbdModel_Free(model);
+    return EXIT_FAILURE;
+  }
+  start = Bench_Now();
+  for (; started < n_threads; started++)
+  {
+    if (pthread_create(&threads[started], NULL, Bench_Thread, &bench) != 0)
+    {
+      atomic_store(&bench.failed, 1);
+      break;
+    }
+  }
+  for (uint32_t i = 0U; i < started; i++)
+  {
+    pthread_join(threads[i], NULL);
+  }
+  elapsed = Bench_Now() - start;
+
+  if (atomic_load(&bench.failed) == 0)
+  {
+    printf("%u clips on %u threads in %.2f s: %.2f clips/s, %.1f ms a clip\n", bench.clips, n_threads, elapsed,
+           (double)bench.clips / elapsed, elapsed * 1e3 * n_threads / bench.clips);
+    if (out_path != NULL)
+    {
+      FILE *out = fopen(out_path, "wb");
+
+      if ((out == NULL) || (fwrite(bench.probs, sizeof(float) * hdr->classes, bench.clips, out) != bench.clips) ||
+          (fclose(out) != 0))
+      {
+        perror(out_path);
+        atomic_store(&bench.failed, 1);
+      }
+    }
+  }
+  else
+  {
+    fprintf(stderr, "%s: cannot run the clips\n", path);
+  }
+  free(bench.probs);
+  SsbdModel_Free(model);
+  return (atomic_load(&bench.failed) != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void *Bench_Thread(void *arg)
+{
+  Bench_TypeDef *bench = arg;
+  const SsbdModel_HeaderTypeDef *hdr = SsbdModel_Header(bench->model);
+  const size_t size = (size_t)hdr->frames * hdr->height * hdr->width * 3U;
+  SsbdModel_ContextTypeDef *ctx = SsbdModel_NewContext(bench->model);
+  uint8_t *frames = malloc(size);
+  float *movenet = calloc((size_t)hdr->frames * hdr->movenet_dim + 1U, sizeof(float));
+  uint32_t clip;
+
+  if ((ctx == NULL) || (frames == NULL) || (movenet == NULL))
+  {
+    atomic_store(&bench->failed, 1);
+  }
+  else
+  {
+    while ((atomic_load(&bench->failed) == 0) && ((clip = atomic_fetch_add(&bench->next, 1U)) < bench->clips))
+    {
+      Bench_Clip(clip, frames, size);
+      if (SsbdModel_PredictFrames(ctx, frames, movenet, &bench->probs[(size_t)clip * hdr->classes]) != 0)
+      {
+        atomic_store(&bench->failed, 1);
+      }
+    }
+  }
+  free(movenet);
+  free(frames);
+  SsbdModel_FreeContext(ctx);
+  return NULL;
+}
+
+/* xorshift frames, seeded by the clip */
+static void Bench_Clip(uint32_t clip, uint8_t *frames, size_t size)
+{
+  uint32_t x = (clip * 2654435761U) | 1U;
+
+  for (size_t i = 0U; i < size; i++)
+  {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    frames[i] = (uint8_t)(x >> 24);
+  }
+}
+
+static double Bench_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static void Bench_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s -m model.ssbm [-j threads] [-n clips] [-o probs.f32]\n"
+          "  -m     a model ssbd_runtime.export() wrote\n"
+          "  -j     threads, each with its own context (%u at most)\n"
+          "  -n     clips to classify (8)\n"
+          "  -o     class probabilities of each clip, float32\n",
+          argv0, BENCH_THREADS_MAX);
+}
@@ -0,0 +1,523 @@
+/**
+  ******************************************************************************
+  * @file           : ssbd_cache.c
+  * @brief          : Preprocess a video corpus into the chunk cache, on all
+  *                   cores.
+  *
+  *                     ssbd_cache -d dir [-j jobs] [-r fps] [-f target_fps]
+  *                                [-n frames] [-o hop] [-s WxH] [-g] [-x]
+  *                                video...
+  *
+  *                   Each of -j workers takes the next video, hashes its
+  *                   bytes and looks for the cache file of that hash and
+  *                   these parameters (chunk_cache.h). If it is missing the
+  *                   worker decodes the video with an ffmpeg of its own
+  *                   (PPM/PGM streams are read directly, at -r fps), chunks
+  *                   it with video_chunk and writes the sampled frames and
+  *                   the chunk table. Videos are independent, so the work
+  *                   scales with the cores, and a second run finds every
+  *                   video cached and only hashes them.
+  *
+  *                   One line per video, in the order given, goes to stdout:
+  *                     cache_file cached|built chunks video
+  *                   then a summary. A video that cannot be decoded gets
+  *                   "- failed 0 video" and the exit status is 1.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "chunk_cache.h"
+#include "video_chunk.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CACHE_JOBS_MAX      64U
+#define CACHE_PATH_MAX      4096U
+
+#define CACHE_FAILED        0U
+#define CACHE_CACHED        1U
+#define CACHE_BUILT         2U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char *video;
+  char path[CACHE_PATH_MAX];
+  uint32_t status;          /* CACHE_*                                     */
+  uint32_t chunks;
+  uint64_t read;            /* source frames decoded                       */
+} Cache_VideoTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+extern char **environ;
+
+static const char *cache_dir;
+static double cache_fps;                /* of PPM/PGM streams              */
+static uint32_t cache_target_fps = VIDEO_CHUNK_FPS;
+static VideoChunk_ConfigTypeDef cache_config = VIDEO_CHUNK_CONFIG_DEFAULT;
+static Cache_VideoTypeDef *cache_videos;
+static uint32_t cache_count;
+static atomic_uint cache_next;
+
+/* Private function prototypes -----------------------------------------------*/
+static void *Cache_Worker(void *arg);
+static uint32_t Cache_Video(Cache_VideoTypeDef *v, uint32_t worker);
+static int Cache_Valid(const char *path, const ChunkCache_HeaderTypeDef *want, uint32_t *chunks);
+static int Cache_Build(const char *video, int fd, const char *tmp, ChunkCache_HeaderTypeDef *hdr);
+static int Cache_Stream(const char *video);
+static pid_t Cache_Spawn(char *const argv[], int *out);
+static int Cache_Wait(pid_t pid);
+static double Cache_Probe(const char *video);
+static int Cache_Pad(FILE *f, uint64_t to);
+static uint64_t Cache_Align(uint64_t offset);
+static double Cache_Now(void);
+static void Cache_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  pthread_t tids[CACHE_JOBS_MAX];
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t jobs = (cpus > 0) ? (uint32_t)cpus : 1U;
+  uint32_t counts[3] = { 0U, 0U, 0U };
+  uint64_t decoded = 0U;
+  double start;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:j:r:f:n:o:s:gxh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'd':
+        cache_dir = optarg;
+        break;
+      case 'j':
+        jobs = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        cache_fps = strtod(optarg, NULL);
+        break;
+      case 'f':
+        cache_target_fps = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        cache_config.frames = (uint32_t)strtoul(optarg, NULL, 0);
+        cache_config.hop = cache_config.frames / 2U;
+        break;
+      case 'o':
+        cache_config.hop = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        if (sscanf(optarg, "%ux%u", &cache_config.width, &cache_config.height) != 2)
+        {
+          Cache_Usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'g':
+        cache_config.bgr = 0U;
+        break;
+      case 'x':
+        cache_config.partial = 0U;
+        break;
+      default:
+        Cache_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  jobs = (jobs > CACHE_JOBS_MAX) ? CACHE_JOBS_MAX : jobs;
+  if ((cache_dir == NULL) || (optind == argc) || (jobs == 0U) || (cache_target_fps == 0U)
+      || (cache_config.frames == 0U) || (cache_config.hop == 0U) || (cache_config.width == 0U)
+      || (cache_config.height == 0U) || (cache_config.width > VIDEO_CHUNK_SIDE_MAX)
+      || (cache_config.height > VIDEO_CHUNK_SIDE_MAX))
+  {
+    Cache_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if ((mkdir(cache_dir, 0777) != 0) && (errno != EEXIST))
+  {
+    perror(cache_dir);
+    return EXIT_FAILURE;
+  }
+  cache_count = (uint32_t)(argc - optind);
+  cache_videos = calloc(cache_count, sizeof(*cache_videos));
+  if (cache_videos == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+  for (uint32_t i = 0U; i < cache_count; i++)
+  {
+    cache_videos[i].video = argv[optind + (int)i];
+  }
+  jobs = (jobs > cache_count) ? cache_count : jobs;
+
+  start = Cache_Now();
+  atomic_init(&cache_next, 0U);
+  for (uint32_t t = 1U; t < jobs; t++)
+  {
+    if (pthread_create(&tids[t], NULL, Cache_Worker, (void *)(uintptr_t)t) != 0)
+    {
+      jobs = t;
+      break;
+    }
+  }
+  (void)Cache_Worker((void *)(uintptr_t)0U);
+  for (uint32_t t = 1U; t < jobs; t++)
+  {
+    pthread_join(tids[t], NULL);
+  }
+
+  for (uint32_t i = 0U; i < cache_count; i++)
+  {
+    const Cache_VideoTypeDef *v = &cache_videos[i];
+    static const char *names[] = { "failed", "cached", "built" };
+
+    printf("%s %s %u %s\n", (v->status == CACHE_FAILED) ? "-" : v->path, names[v->status], v->chunks, v->video);
+    counts[v->status]++;
+    decoded += v->read;
+  }
+  printf("%u videos on %u workers: %u cached, %u built, %u failed in %.2f s, %llu frames decoded\n", cache_count,
+         jobs, counts[CACHE_CACHED], counts[CACHE_BUILT], counts[CACHE_FAILED], Cache_Now() - start,
+         (unsigned long long)decoded);
+  free(cache_videos);
+  return (counts[CACHE_FAILED] != 0U) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Videos until there are none left */
+static void *Cache_Worker(void *arg)
+{
+  const uint32_t worker = (uint32_t)(uintptr_t)arg;
+  uint32_t i;
+
+  while ((i = atomic_fetch_add(&cache_next, 1U)) < cache_count)
+  {
+    cache_videos[i].status = Cache_Video(&cache_videos[i], worker);
+  }
+  return NULL;
+}
+
+static uint32_t Cache_Video(Cache_VideoTypeDef *v, uint32_t worker)
+{
+  ChunkCache_HeaderTypeDef hdr = { 0 };
+  char key[CHUNK_CACHE_KEY_CHARS + 1U];
+  char tmp[CACHE_PATH_MAX + 32U];
+  struct stat st;
+  const uint8_t *map = NULL;
+  double fps;
+  int fd = open(v->video, O_RDONLY | O_CLOEXEC);
+
+  if ((fd < 0) || (fstat(fd, &st) != 0) || (st.st_size <= 0)
+      || ((map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED))
+  {
+    perror(v->video);
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    return CACHE_FAILED;
+  }
+  (void)madvise((void *)map, (size_t)st.st_size, MADV_SEQUENTIAL);
+  hdr.video_size = (uint64_t)st.st_size;
+  ChunkCache_Hash(map, (size_t)st.st_size, hdr.video_hash);
+  munmap((void *)map, (size_t)st.st_size);
+
+  /* the step depends on the video's frame rate, so it is part of the key */
+  fps = Cache_Stream(v->video) ? cache_fps : Cache_Probe(v->video);
+  if (fps <= 0.0)
+  {
+    fprintf(stderr, "%s: %s\n", v->video, Cache_Stream(v->video) ? "give the fps of a frame stream with -r"
+                                                                  : "no frame rate, is ffprobe installed?");
+    close(fd);
+    return CACHE_FAILED;
+  }
+  hdr.step = VideoChunk_Step(fps, cache_target_fps);
+  hdr.frames = cache_config.frames;
+  hdr.hop = cache_config.hop;
+  hdr.width = cache_config.width;
+  hdr.height = cache_config.height;
+  hdr.bgr = cache_config.bgr;
+  hdr.partial = cache_config.partial;
+  ChunkCache_Key(&hdr, key);
+  (void)snprintf(v->path, sizeof(v->path), "%s/%.2s", cache_dir, key);
+  if ((mkdir(v->path, 0777) != 0) && (errno != EEXIST))
+  {
+    perror(v->path);
+    close(fd);
+    return CACHE_FAILED;
+  }
+  (void)snprintf(v->path, sizeof(v->path), "%s/%.2s/%s.ssbd", cache_dir, key, key);
+  if (Cache_Valid(v->path, &hdr, &v->chunks) == 0)
+  {
+    close(fd);
+    return CACHE_CACHED;
+  }
+
+  (void)snprintf(tmp, sizeof(tmp), "%s.%ld.%u", v->path, (long)getpid(), worker);
+  if ((Cache_Build(v->video, fd, tmp, &hdr) != 0) || (rename(tmp, v->path) != 0))
+  {
+    unlink(tmp);
+    close(fd);
+    return CACHE_FAILED;
+  }
+  close(fd);
+  v->chunks = hdr.chunks;
+  v->read = hdr.read;
+  return CACHE_BUILT;
+}
+
+/* 0 if path is a complete cache file of the video and parameters */
+static int Cache_Valid(const char *path, const ChunkCache_HeaderTypeDef *want, uint32_t *chunks)
+{
+  ChunkCache_HeaderTypeDef hdr;
+  struct stat st;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  int ok;
+
+  if (fd < 0)
+  {
+    return 1;
+  }
+  ok = (fstat(fd, &st) == 0) && (pread(fd, &hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr));
+  close(fd);
+  ok = ok && (hdr.magic == CHUNK_CACHE_MAGIC) && (hdr.header_bytes == sizeof(hdr))
+       && (hdr.size == (uint64_t)st.st_size) && (hdr.video_size == want->video_size)
+       && (hdr.video_hash[0] == want->video_hash[0]) && (hdr.video_hash[1] == want->video_hash[1])
+       && (hdr.step == want->step) && (hdr.frames == want->frames) && (hdr.hop == want->hop)
+       && (hdr.width == want->width) && (hdr.height == want->height) && (hdr.bgr == want->bgr)
+       && (hdr.partial == want->partial);
+  *chunks = ok ? hdr.chunks : 0U;
+  return !ok;
+}
+
+/* Decode the video into tmp: every sampled frame, then the chunk table */
+static int Cache_Build(const char *video, int fd, const char *tmp, ChunkCache_HeaderTypeDef *hdr)
+{
+  const size_t frame_bytes = (size_t)hdr->width * hdr->height * VIDEO_CHUNK_CHANNELS;
+  VideoChunk_ConfigTypeDef config = cache_config;
+  VideoChunk_HandleTypeDef *chunker;
+  VideoChunk_ViewTypeDef view;
+  VideoChunk_StatsTypeDef stats;
+  FILE *out = fopen(tmp, "wbe");
+  pid_t pid = -1;
+  int failed;
+  int status;
+
+  if (out == NULL)
+  {
+    perror(tmp);
+    return 1;
+  }
+  if (Cache_Stream(video))
+  {
+    config.fd = fd;
+  }
+  else
+  {
+    /* one decoding thread per ffmpeg: the workers already fill the cores */
+    char *const argv[] =
+    {
+      "ffmpeg", "-v", "error", "-nostdin", "-threads", "1", "-i", (char *)video, "-f", "image2pipe",
+      "-vcodec", "ppm", "-", NULL,
+    };
+
+    pid = Cache_Spawn(argv, &config.fd);
+    if (pid < 0)
+    {
+      fclose(out);
+      return 1;
+    }
+  }
+
+  /* a chunk of one frame per sampled frame: each is stored once */
+  config.step = hdr->step;
+  config.frames = 1U;
+  config.hop = 1U;
+  config.partial = 1U;
+  chunker = VideoChunk_Open(&config);
+  hdr->magic = CHUNK_CACHE_MAGIC;
+  hdr->header_bytes = sizeof(*hdr);
+  hdr->frames_offset = Cache_Align(sizeof(*hdr));
+  failed = (chunker == NULL) || (Cache_Pad(out, hdr->frames_offset) != 0);
+  while ((failed == 0) && ((status = VideoChunk_Next(chunker, &view)) == 1))
+  {
+    failed = (fwrite(view.frames, 1U, frame_bytes, out) != frame_bytes);
+  }
+  failed |= (chunker == NULL) || (status != 0);
+  if (chunker != NULL)
+  {
+    VideoChunk_Stats(chunker, &stats);
+    VideoChunk_Close(chunker);
+    hdr->read = stats.read;
+    hdr->sampled = stats.sampled;
+  }
+  if (pid >= 0)
+  {
+    close(config.fd);
+    failed |= (Cache_Wait(pid) != 0);
+  }
+
+  /* the chunks video_chunk would give with the real frames and hop */
+  hdr->chunks = 0U;
+  hdr->chunks_offset = Cache_Align(hdr->frames_offset + (hdr->sampled * frame_bytes));
+  failed |= (Cache_Pad(out, hdr->chunks_offset) != 0);
+  for (uint64_t first = 0U; (failed == 0) && (first < hdr->sampled); first += hdr->hop)
+  {
+    const uint64_t left = hdr->sampled - first;
+    const uint32_t entry[2] = { (uint32_t)first, (left < hdr->frames) ? (uint32_t)left : hdr->frames };
+
+    if ((entry[1] == hdr->frames) || (hdr->partial != 0U))
+    {
+      failed = (fwrite(entry, sizeof(entry), 1U, out) != 1U);
+      hdr->chunks++;
+    }
+  }
+  hdr->size = hdr->chunks_offset + ((uint64_t)hdr->chunks * 2U * sizeof(uint32_t));
+  failed |= (fseek(out, 0L, SEEK_SET) != 0) || (fwrite(hdr, sizeof(*hdr), 1U, out) != 1U);
+  failed |= (fclose(out) != 0);
+  if (failed != 0)
+  {
+    fprintf(stderr, "%s: cannot be decoded\n", video);
+  }
+  return failed;
+}
+
+/* PPM/PGM streams are read as they are, anything else through ffmpeg */
+static int Cache_Stream(const char *video)
+{
+  const char *dot = strrchr(video, '.');
+
+  return (dot != NULL) && ((strcmp(dot, ".ppm") == 0) || (strcmp(dot, ".pgm") == 0) || (strcmp(dot, ".pnm") == 0));
+}
+
+/* Start argv with its stdout on a pipe; -1 if it cannot be run */
+static pid_t Cache_Spawn(char *const argv[], int *out)
+{
+  posix_spawn_file_actions_t actions;
+  pid_t pid;
+  int fds[2];
+  int err;
+
+  /* close-on-exec, or the other workers' children would hold the pipe
+     open and this one would never see the end */
+  if (pipe2(fds, O_CLOEXEC) != 0)
+  {
+    return -1;
+  }
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+  err = posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(fds[1]);
+  if (err != 0)
+  {
+    fprintf(stderr, "%s: %s\n", argv[0], strerror(err));
+    close(fds[0]);
+    return -1;
+  }
+  *out = fds[0];
+  return pid;
+}
+
+static int Cache_Wait(pid_t pid)
+{
+  int status;
+
+  while (waitpid(pid, &status, 0) < 0)
+  {
+    if (errno != EINTR)
+    {
+      return 1;
+    }
+  }
+  return !(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+}
+
+/* Frame rate of a video, cap.get(5); 0 if ffprobe cannot tell */
+static double Cache_Probe(const char *video)
+{
+  char *const argv[] =
+  {
+    "ffprobe", "-v", "error", "-select_streams", "v:0", "-show_entries", "stream=avg_frame_rate", "-of",
+    "csv=p=0", (char *)video, NULL,
+  };
+  char text[64] = { 0 };
+  size_t got = 0U;
+  double num = 0.0;
+  double den = 1.0;
+  int fd;
+  pid_t pid = Cache_Spawn(argv, &fd);
+  ssize_t n;
+
+  if (pid < 0)
+  {
+    return 0.0;
+  }
+  while ((got < (sizeof(text) - 1U)) && ((n = read(fd, &text[got], sizeof(text) - 1U - got)) > 0))
+  {
+    got += (size_t)n;
+  }
+  close(fd);
+  if ((Cache_Wait(pid) != 0) || (sscanf(text, "%lf/%lf", &num, &den) < 1) || (den <= 0.0))
+  {
+    return 0.0;
+  }
+  return num / den;
+}
+
+static int Cache_Pad(FILE *f, uint64_t to)
+{
+  long at = ftell(f);
+
+  while ((at >= 0) && ((uint64_t)at < to))
+  {
+    if (fputc(0, f) == EOF)
+    {
+      return 1;
+    }
+    at++;
+  }
+  return (at < 0);
+}
+
+static uint64_t Cache_Align(uint64_t offset)
+{
+  return (offset + CHUNK_CACHE_ALIGN - 1U) & ~(uint64_t)(CHUNK_CACHE_ALIGN - 1U);
+}
+
+static double Cache_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static void Cache_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s -d dir [-j jobs] [-r fps] [-f target_fps] [-n frames] [-o hop] [-s WxH] [-g] [-x] video...\n"
+          "  -d     cache directory, made if missing\n"
+          "  -j     videos decoded at once (the cores, at most %u)\n"
+          "  -r     frame rate of .ppm/.pgm streams; ffprobe reads it from videos\n"
+          "  -f     frames kept per second (%u)\n"
+          "  -n -o  frames per chunk (%u) and between chunk starts (half a chunk)\n"
+          "  -s     size of the stored frames (%ux%u)\n"
+          "  -g     RGB order, not BGR as cv2\n"
+          "  -x     no chunks cut short by the end of a video\n",
+          argv0, CACHE_JOBS_MAX, VIDEO_CHUNK_FPS, VIDEO_CHUNK_SIZE, VIDEO_CHUNK_WIDTH, VIDEO_CHUNK_HEIGHT);
+}
@@ -0,0 +1,818 @@
+/**
+  ******************************************************************************
+  * @file           : ssbd_model.c
+  * @brief          : CPU inference of MultimodalSSBDModel, one clip at a
+  *                   time, without PyTorch.
+  *
+  *                   The notebook's forward() as a runtime can run it:
+  *                     - the spatiotemporal block is the two Conv3d (each
+  *                       with its batch norm folded in, then ReLU) over the
+  *                       clip [channels][frames][height][width], valid
+  *                       padding; step t of the sequence is the output
+  *                       slice t flattened (channel, height, width),
+  *                       followed by the MoveNet features of the last frame
+  *                       it sees
+  *                     - the bidirectional LSTM, PyTorch's gates i f g o
+  *                     - self-attention over its outputs, of which only the
+  *                       last step is classified, so only that query is made
+  *                     - the fully connected head with LeakyReLU, ending in
+  *                       the softmax
+  *
+  *                   The model file is mapped and read in place; only the
+  *                   convolution weights are repacked, in blocks of 8
+  *                   output channels so that a window is multiplied into 8
+  *                   accumulators at once. The matrix products take 4 rows
+  *                   against one weight row in 8 lanes, so each weight is
+  *                   read once per clip, and the LSTM's input projections
+  *                   for every step and all 4 gates are one such product
+  *                   before the recurrence. A context holds every buffer a
+  *                   clip needs, allocated once: memory is the model plus a
+  *                   fixed workspace per thread. SSBD_MODEL_GENERIC builds
+  *                   the plain C kernels, with the same sums in the same
+  *                   order, so both builds give the same results.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "ssbd_model.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__SSE2__) && !defined(SSBD_MODEL_GENERIC)
+#include <emmintrin.h>
+#define SSBD_MODEL_SSE2
+#endif
+
+/* Private define ------------------------------------------------------------*/
+#define SSBD_BLOCK          8U          /* output channels per conv block  */
+#define SSBD_LANES          8U          /* partial sums of a dot product   */
+#define SSBD_ROWS           4U          /* rows per weight row pass        */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const float *w_ih;        /* [4 hidden][input]                           */
+  const float *w_hh;        /* [4 hidden][hidden]                          */
+  const float *bias;        /* [4 hidden]                                  */
+  uint32_t input;
+} Ssbd_LstmTypeDef;
+
+struct SsbdModel_Handle
+{
+  SsbdModel_HeaderTypeDef hdr;
+  void *map;
+  size_t map_size;
+  uint32_t shape[3][3];     /* (t, h, w) of the clip and the two convs     */
+  uint32_t steps;           /* of the sequence, shape[2][0]                */
+  uint32_t embed;           /* conv features per step                      */
+  uint32_t input;           /* embed + movenet_dim                         */
+  float *conv_packed[2];    /* [out / 8][in][kt][kh][kw][8]                */
+  const float *conv_bias[2];
+  Ssbd_LstmTypeDef *lstm;   /* [layers][2]                                 */
+  const float *in_proj_w;
+  const float *in_proj_b;
+  const float *out_proj_w;
+  const float *out_proj_b;
+  const float *fc_w[3];
+  const float *fc_b[3];
+};
+
+struct SsbdModel_Context
+{
+  const SsbdModel_HandleTypeDef *model;
+  void *block;              /* every buffer below                          */
+  size_t bytes;
+  float *video;             /* [channels][frames][height][width]           */
+  float *conv;              /* the first conv's output                     */
+  float *seq;               /* [steps][input]                              */
+  float *gates;             /* [steps][4 hidden]                           */
+  float *out[2];            /* [steps][2 hidden], layer by layer           */
+  float *h;                 /* [hidden]                                    */
+  float *c;
+  float *g;                 /* [4 hidden]                                  */
+  float *kv;                /* [steps][2 E]                                */
+  float *q;                 /* [E]                                         */
+  float *p;                 /* [steps]                                     */
+  float *ctx;               /* [E]                                         */
+  float *a;                 /* [E]                                         */
+  float *fc[3];             /* [fc1], [fc2], [classes]                     */
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static int Ssbd_Layout(SsbdModel_HandleTypeDef *model);
+static const float *Ssbd_Take(SsbdModel_HandleTypeDef *model, uint64_t *offset, uint64_t count);
+static void Ssbd_Pack(const float *w, uint32_t out, uint32_t window, float *packed);
+static float *Ssbd_Carve(uint8_t **at, size_t count);
+static void Ssbd_Forward(SsbdModel_ContextTypeDef *ctx, const float *movenet, float *probs);
+static void Ssbd_Conv3d(const float *x, const uint32_t in_shape[3], uint32_t in_channels, const float *packed,
+                        const float *bias, uint32_t out_channels, const uint32_t kernel[3], const uint32_t stride[3],
+                        const uint32_t out_shape[3], float *y, size_t y_channel, size_t y_step);
+static void Ssbd_Gemm(const float *a, size_t lda, uint32_t m, const float *b, uint32_t n, uint32_t k,
+                      const float *bias, float *c, size_t ldc);
+static void Ssbd_Lstm(const SsbdModel_HandleTypeDef *model, SsbdModel_ContextTypeDef *ctx, const float *x,
+                      uint32_t layer, uint32_t dir, float *y);
+static void Ssbd_Attention(const SsbdModel_HandleTypeDef *model, SsbdModel_ContextTypeDef *ctx, const float *x);
+static void Ssbd_Gemv(const float *w, const float *b, const float *x, uint32_t n, uint32_t k, float *y);
+static void Ssbd_Dense(const float *w, const float *b, const float *x, uint32_t n, uint32_t k, float *y, int leaky);
+static void Ssbd_Softmax(float *v, uint32_t n);
+static void Ssbd_Dot4(const float *const a[SSBD_ROWS], const float *b, uint32_t k, float out[SSBD_ROWS]);
+static float Ssbd_Sigmoid(float x);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Map a model file and check it against its header.
+  * @retval Model, NULL if the file is not one
+  */
+SsbdModel_HandleTypeDef *SsbdModel_Load(const char *path)
+{
+  SsbdModel_HandleTypeDef *model;
+  struct stat st;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+  if ((fd < 0) || (fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(SsbdModel_HeaderTypeDef)))
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    return NULL;
+  }
+  model = calloc(1U, sizeof(*model));
+  if (model == NULL)
+  {
+    close(fd);
+    return NULL;
+  }
+  model->map_size = (size_t)st.st_size;
+  model->map = mmap(NULL, model->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (model->map == MAP_FAILED)
+  {
+    free(model);
+    return NULL;
+  }
+  memcpy(&model->hdr, model->map, sizeof(model->hdr));
+  if (Ssbd_Layout(model) != 0)
+  {
+    SsbdModel_Free(model);
+    return NULL;
+  }
+  return model;
+}
+
+const SsbdModel_HeaderTypeDef *SsbdModel_Header(const SsbdModel_HandleTypeDef *model)
+{
+  return &model->hdr;
+}
+
+void SsbdModel_Free(SsbdModel_HandleTypeDef *model)
+{
+  if (model == NULL)
+  {
+    return;
+  }
+  free(model->conv_packed[0]);
+  free(model->conv_packed[1]);
+  free(model->lstm);
+  if ((model->map != NULL) && (model->map != MAP_FAILED))
+  {
+    munmap(model->map, model->map_size);
+  }
+  free(model);
+}
+
+/**
+  * @brief  Buffers for one clip at a time; one per thread running clips.
+  */
+SsbdModel_ContextTypeDef *SsbdModel_NewContext(const SsbdModel_HandleTypeDef *model)
+{
+  const SsbdModel_HeaderTypeDef *hdr = &model->hdr;
+  const size_t steps = model->steps;
+  const size_t hidden = hdr->hidden;
+  const size_t e = 2U * hidden;
+  const size_t sizes[] =
+  {
+    (size_t)hdr->channels * hdr->frames * hdr->height * hdr->width,
+    (size_t)hdr->conv_channels[0] * model->shape[1][0] * model->shape[1][1] * model->shape[1][2],
+    steps * model->input, steps * 4U * hidden, steps * e, steps * e, hidden, hidden, 4U * hidden, steps * 2U * e,
+    e, steps, e, e, hdr->fc[0], hdr->fc[1], hdr->classes,
+  };
+  SsbdModel_ContextTypeDef *ctx = calloc(1U, sizeof(*ctx));
+  float **slots[sizeof(sizes) / sizeof(sizes[0])];
+  uint8_t *at;
+
+  if (ctx == NULL)
+  {
+    return NULL;
+  }
+  slots[0] = &ctx->video;
+  slots[1] = &ctx->conv;
+  slots[2] = &ctx->seq;
+  slots[3] = &ctx->gates;
+  slots[4] = &ctx->out[0];
+  slots[5] = &ctx->out[1];
+  slots[6] = &ctx->h;
+  slots[7] = &ctx->c;
+  slots[8] = &ctx->g;
+  slots[9] = &ctx->kv;
+  slots[10] = &ctx->q;
+  slots[11] = &ctx->p;
+  slots[12] = &ctx->ctx;
+  slots[13] = &ctx->a;
+  slots[14] = &ctx->fc[0];
+  slots[15] = &ctx->fc[1];
+  slots[16] = &ctx->fc[2];
+  for (uint32_t i = 0U; i < (sizeof(sizes) / sizeof(sizes[0])); i++)
+  {
+    ctx->bytes += ((sizes[i] * sizeof(float)) + SSBD_MODEL_ALIGN - 1U) & ~(size_t)(SSBD_MODEL_ALIGN - 1U);
+  }
+  if (posix_memalign(&ctx->block, SSBD_MODEL_ALIGN, ctx->bytes) != 0)
+  {
+    free(ctx);
+    return NULL;
+  }
+  at = ctx->block;
+  for (uint32_t i = 0U; i < (sizeof(sizes) / sizeof(sizes[0])); i++)
+  {
+    *slots[i] = Ssbd_Carve(&at, sizes[i]);
+  }
+  ctx->model = model;
+  return ctx;
+}
+
+size_t SsbdModel_Workspace(const SsbdModel_ContextTypeDef *context)
+{
+  return context->bytes;
+}
+
+/**
+  * @brief  Class probabilities of a clip, predict() of the notebook.
+  * @param  video: [frames][channels][height][width], as predict() takes it
+  * @param  movenet: [frames][movenet_dim], NULL for zeros
+  * @param  probs: [classes], after the softmax
+  * @retval 0
+  */
+int SsbdModel_Predict(SsbdModel_ContextTypeDef *context, const float *video, const float *movenet, float *probs)
+{
+  const SsbdModel_HeaderTypeDef *hdr = &context->model->hdr;
+  const size_t plane = (size_t)hdr->height * hdr->width;
+
+  for (uint32_t t = 0U; t < hdr->frames; t++)
+  {
+    for (uint32_t c = 0U; c < hdr->channels; c++)
+    {
+      memcpy(&context->video[((size_t)c * hdr->frames + t) * plane],
+             &video[((size_t)t * hdr->channels + c) * plane], plane * sizeof(float));
+    }
+  }
+  Ssbd_Forward(context, movenet, probs);
+  return 0;
+}
+
+/**
+  * @brief  The same from the frames of a chunk: [frames][height][width][3]
+  *         uint8 as video_chunks and chunk_cache give them, scaled to 0..1
+  *         as preprocessing.ipynb does.
+  * @retval 0, -1 if the model does not take 3 channels
+  */
+int SsbdModel_PredictFrames(SsbdModel_ContextTypeDef *context, const uint8_t *frames, const float *movenet,
+                            float *probs)
+{
+  const SsbdModel_HeaderTypeDef *hdr = &context->model->hdr;
+  const size_t plane = (size_t)hdr->height * hdr->width;
+
+  if (hdr->channels != 3U)
+  {
+    return -1;
+  }
+  for (uint32_t t = 0U; t < hdr->frames; t++)
+  {
+    const uint8_t *src = &frames[(size_t)t * plane * 3U];
+
+    for (uint32_t c = 0U; c < 3U; c++)
+    {
+      float *dst = &context->video[((size_t)c * hdr->frames + t) * plane];
+
+      for (size_t i = 0U; i < plane; i++)
+      {
+        dst[i] = (float)src[(3U * i) + c] / 255.0f;
+      }
+    }
+  }
+  Ssbd_Forward(context, movenet, probs);
+  return 0;
+}
+
+void SsbdModel_FreeContext(SsbdModel_ContextTypeDef *context)
+{
+  if (context != NULL)
+  {
+    free(context->block);
+    free(context);
+  }
+}
+
+/**
+  * @brief  Instructions the kernels use.
+  */
+const char *SsbdModel_Isa(void)
+{
+#if defined(SSBD_MODEL_SSE2)
+  return "sse2";
+#else
+  return "generic";
+#endif
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Shapes from the header, tensors from the file after it */
+static int Ssbd_Layout(SsbdModel_HandleTypeDef *model)
+{
+  const SsbdModel_HeaderTypeDef *hdr = &model->hdr;
+  const uint32_t dims[] =
+  {
+    hdr->channels, hdr->frames, hdr->height, hdr->width, hdr->conv_channels[0], hdr->conv_channels[1],
+    hdr->hidden, hdr->layers, hdr->heads, hdr->fc[0], hdr->fc[1], hdr->classes,
+  };
+  const uint32_t e = 2U * hdr->hidden;
+  uint64_t offset = sizeof(*hdr);
+  uint32_t in_channels = hdr->channels;
+
+  if ((hdr->magic != SSBD_MODEL_MAGIC) || (hdr->header_bytes != sizeof(*hdr)) || (hdr->size != model->map_size)
+      || (hdr->movenet_dim > SSBD_MODEL_DIM_MAX))
+  {
+    return 1;
+  }
+  for (uint32_t i = 0U; i < (sizeof(dims) / sizeof(dims[0])); i++)
+  {
+    if ((dims[i] == 0U) || (dims[i] > SSBD_MODEL_DIM_MAX))
+    {
+      return 1;
+    }
+  }
+  if ((e % hdr->heads) != 0U)
+  {
+    return 1;
+  }
+  model->shape[0][0] = hdr->frames;
+  model->shape[0][1] = hdr->height;
+  model->shape[0][2] = hdr->width;
+  for (uint32_t l = 0U; l < 2U; l++)
+  {
+    const uint32_t window = in_channels * hdr->conv_kernel[l][0] * hdr->conv_kernel[l][1] * hdr->conv_kernel[l][2];
+    const uint32_t blocks = (hdr->conv_channels[l] + SSBD_BLOCK - 1U) / SSBD_BLOCK;
+    const float *w;
+
+    for (uint32_t d = 0U; d < 3U; d++)
+    {
+      if ((hdr->conv_kernel[l][d] == 0U) || (hdr->conv_stride[l][d] == 0U)
+          || (hdr->conv_kernel[l][d] > model->shape[l][d]))
+      {
+        return 1;
+      }
+      model->shape[l + 1U][d] = ((model->shape[l][d] - hdr->conv_kernel[l][d]) / hdr->conv_stride[l][d]) + 1U;
+    }
+    w = Ssbd_Take(model, &offset, (uint64_t)hdr->conv_channels[l] * window);
+    model->conv_bias[l] = Ssbd_Take(model, &offset, hdr->conv_channels[l]);
+    model->conv_packed[l] = malloc((size_t)blocks * window * SSBD_BLOCK * sizeof(float));
+    if ((w == NULL) || (model->conv_bias[l] == NULL) || (model->conv_packed[l] == NULL))
+    {
+      return 1;
+    }
+    Ssbd_Pack(w, hdr->conv_channels[l], window, model->conv_packed[l]);
+    in_channels = hdr->conv_channels[l];
+  }
+  model->steps = model->shape[2][0];
+  model->embed = hdr->conv_channels[1] * model->shape[2][1] * model->shape[2][2];
+  model->input = model->embed + hdr->movenet_dim;
+
+  model->lstm = calloc((size_t)hdr->layers * 2U, sizeof(*model->lstm));
+  if (model->lstm == NULL)
+  {
+    return 1;
+  }
+  for (uint32_t l = 0U; l < hdr->layers; l++)
+  {
+    for (uint32_t d = 0U; d < 2U; d++)
+    {
+      Ssbd_LstmTypeDef *cell = &model->lstm[(2U * l) + d];
+
+      cell->input = (l == 0U) ? model->input : e;
+      cell->w_ih = Ssbd_Take(model, &offset, 4ULL * hdr->hidden * cell->input);
+      cell->w_hh = Ssbd_Take(model, &offset, 4ULL * hdr->hidden * hdr->hidden);
+      cell->bias = Ssbd_Take(model, &offset, 4ULL * hdr->hidden);
+      if ((cell->w_ih == NULL) || (cell->w_hh == NULL) || (cell->bias == NULL))
+      {
+        return 1;
+      }
+    }
+  }
+  model->in_proj_w = Ssbd_Take(model, &offset, 3ULL * e * e);
+  model->in_proj_b = Ssbd_Take(model, &offset, 3ULL * e);
+  model->out_proj_w = Ssbd_Take(model, &offset, (uint64_t)e * e);
+  model->out_proj_b = Ssbd_Take(model, &offset, e);
+  model->fc_w[0] = Ssbd_Take(model, &offset, (uint64_t)hdr->fc[0] * e);
+  model->fc_b[0] = Ssbd_Take(model, &offset, hdr->fc[0]);
+  model->fc_w[1] = Ssbd_Take(model, &offset, (uint64_t)hdr->fc[1] * hdr->fc[0]);
+  model->fc_b[1] = Ssbd_Take(model, &offset, hdr->fc[1]);
+  model->fc_w[2] = Ssbd_Take(model, &offset, (uint64_t)hdr->classes * hdr->fc[1]);
+  model->fc_b[2] = Ssbd_Take(model, &offset, hdr->classes);
+  return (model->fc_b[2] == NULL) || (offset != hdr->size);
+}
+
+/* The next tensor of count floats, 64-byte aligned; NULL past the end */
+static const float *Ssbd_Take(SsbdModel_HandleTypeDef *model, uint64_t *offset, uint64_t count)
+{
+  const uint64_t at = (*offset + SSBD_MODEL_ALIGN - 1U) & ~(uint64_t)(SSBD_MODEL_ALIGN - 1U);
+
+  if ((at > model->map_size) || (count > ((model->map_size - at) / sizeof(float))))
+  {
+    return NULL;
+  }
+  *offset = at + (count * sizeof(float));
+  return (const float *)((const uint8_t *)model->map + at);
+}
+
+/* [out][window] to [out / 8][window][8], the missing channels zero */
+static void Ssbd_Pack(const float *w, uint32_t out, uint32_t window, float *packed)
+{
+  const uint32_t blocks = (out + SSBD_BLOCK - 1U) / SSBD_BLOCK;
+
+  for (uint32_t b = 0U; b < blocks; b++)
+  {
+    for (uint32_t i = 0U; i < window; i++)
+    {
+      for (uint32_t j = 0U; j < SSBD_BLOCK; j++)
+      {
+        const uint32_t o = (b * SSBD_BLOCK) + j;
+
+        packed[(((size_t)b * window) + i) * SSBD_BLOCK + j] = (o < out) ? w[((size_t)o * window) + i] : 0.0f;
+      }
+    }
+  }
+}
+
+static float *Ssbd_Carve(uint8_t **at, size_t count)
+{
+  float *p = (float *)*at;
+
+  *at += ((count * sizeof(float)) + SSBD_MODEL_ALIGN - 1U) & ~(size_t)(SSBD_MODEL_ALIGN - 1U);
+  return p;
+}
+
+static void Ssbd_Forward(SsbdModel_ContextTypeDef *ctx, const float *movenet, float *probs)
+{
+  const SsbdModel_HandleTypeDef *model = ctx->model;
+  const SsbdModel_HeaderTypeDef *hdr = &model->hdr;
+  const size_t s2 = (size_t)model->shape[2][1] * model->shape[2][2];
+  const float *x;
+
+  /* the spatiotemporal block, the second conv writing straight into the
+     rows of the sequence */
+  Ssbd_Conv3d(ctx->video, model->shape[0], hdr->channels, model->conv_packed[0], model->conv_bias[0],
+              hdr->conv_channels[0], hdr->conv_kernel[0], hdr->conv_stride[0], model->shape[1], ctx->conv,
+              (size_t)model->shape[1][0] * model->shape[1][1] * model->shape[1][2],
+              (size_t)model->shape[1][1] * model->shape[1][2]);
+  Ssbd_Conv3d(ctx->conv, model->shape[1], hdr->conv_channels[0], model->conv_packed[1], model->conv_bias[1],
+              hdr->conv_channels[1], hdr->conv_kernel[1], hdr->conv_stride[1], model->shape[2], ctx->seq, s2,
+              model->input);
+  for (uint32_t t = 0U; t < model->steps; t++)
+  {
+    /* the last frame step t sees */
+    const uint32_t f1 = (t * hdr->conv_stride[1][0]) + hdr->conv_kernel[1][0] - 1U;
+    const uint32_t frame = (f1 * hdr->conv_stride[0][0]) + hdr->conv_kernel[0][0] - 1U;
+    float *row = &ctx->seq[((size_t)t * model->input) + model->embed];
+
+    if (movenet != NULL)
+    {
+      memcpy(row, &movenet[(size_t)frame * hdr->movenet_dim], hdr->movenet_dim * sizeof(float));
+    }
+    else
+    {
+      memset(row, 0, hdr->movenet_dim * sizeof(float));
+    }
+  }
+
+  x = ctx->seq;
+  for (uint32_t l = 0U; l < hdr->layers; l++)
+  {
+    float *y = ctx->out[l & 1U];
+
+    Ssbd_Lstm(model, ctx, x, l, 0U, y);
+    Ssbd_Lstm(model, ctx, x, l, 1U, y);
+    x = y;
+  }
+  Ssbd_Attention(model, ctx, x);
+
+  Ssbd_Dense(model->fc_w[0], model->fc_b[0], ctx->a, hdr->fc[0], 2U * hdr->hidden, ctx->fc[0], 1);
+  Ssbd_Dense(model->fc_w[1], model->fc_b[1], ctx->fc[0], hdr->fc[1], hdr->fc[0], ctx->fc[1], 1);
+  Ssbd_Dense(model->fc_w[2], model->fc_b[2], ctx->fc[1], hdr->classes, hdr->fc[1], probs, 0);
+  Ssbd_Softmax(probs, hdr->classes);
+}
+
+/* Valid Conv3d and ReLU, 8 output channels per pass over a window; y is
+   [channel * y_channel + t * y_step + h * ow + w] */
+static void Ssbd_Conv3d(const float *x, const uint32_t in_shape[3], uint32_t in_channels, const float *packed,
+                        const float *bias, uint32_t out_channels, const uint32_t kernel[3], const uint32_t stride[3],
+                        const uint32_t out_shape[3], float *y, size_t y_channel, size_t y_step)
+{
+  const size_t window = (size_t)in_channels * kernel[0] * kernel[1] * kernel[2];
+  const size_t plane = (size_t)in_shape[1] * in_shape[2];
+  const uint32_t blocks = (out_channels + SSBD_BLOCK - 1U) / SSBD_BLOCK;
+
+  for (uint32_t b = 0U; b < blocks; b++)
+  {
+    const float *wb = &packed[(size_t)b * window * SSBD_BLOCK];
+    const uint32_t first = b * SSBD_BLOCK;
+    const uint32_t count = ((out_channels - first) < SSBD_BLOCK) ? (out_channels - first) : SSBD_BLOCK;
+
+    for (uint32_t t = 0U; t < out_shape[0]; t++)
+    {
+      for (uint32_t h = 0U; h < out_shape[1]; h++)
+      {
+        for (uint32_t w = 0U; w < out_shape[2]; w++)
+        {
+          const float *wk = wb;
+          float acc[SSBD_BLOCK];
+#if defined(SSBD_MODEL_SSE2)
+          __m128 lo = _mm_setzero_ps();
+          __m128 hi = _mm_setzero_ps();
+#else
+          memset(acc, 0, sizeof(acc));
+#endif
+
+          for (uint32_t c = 0U; c < in_channels; c++)
+          {
+            for (uint32_t dt = 0U; dt < kernel[0]; dt++)
+            {
+              for (uint32_t dh = 0U; dh < kernel[1]; dh++)
+              {
+                const float *row = &x[((size_t)c * in_shape[0] + (t * stride[0]) + dt) * plane
+                                      + ((size_t)((h * stride[1]) + dh) * in_shape[2]) + (w * stride[2])];
+
+                for (uint32_t dw = 0U; dw < kernel[2]; dw++, wk += SSBD_BLOCK)
+                {
+#if defined(SSBD_MODEL_SSE2)
+                  const __m128 v = _mm_set1_ps(row[dw]);
+
+                  lo = _mm_add_ps(lo, _mm_mul_ps(_mm_load_ps(wk), v));
+                  hi = _mm_add_ps(hi, _mm_mul_ps(_mm_load_ps(&wk[4]), v));
+#else
+                  for (uint32_t j = 0U; j < SSBD_BLOCK; j++)
+                  {
+                    acc[j] += wk[j] * row[dw];
+                  }
+#endif
+                }
+              }
+            }
+          }
+#if defined(SSBD_MODEL_SSE2)
+          _mm_storeu_ps(acc, lo);
+          _mm_storeu_ps(&acc[4], hi);
+#endif
+          for (uint32_t j = 0U; j < count; j++)
+          {
+            const float v = acc[j] + bias[first + j];
+
+            y[((size_t)(first + j) * y_channel) + ((size_t)t * y_step) + ((size_t)h * out_shape[2]) + w]
+              = (v > 0.0f) ? v : 0.0f;
+          }
+        }
+      }
+    }
+  }
+}
+
+/* c[i][j] = a[i] . b[j] + bias[j] for m rows of a against n rows of b,
+   each row of b read once per SSBD_ROWS rows of a */
+static void Ssbd_Gemm(const float *a, size_t lda, uint32_t m, const float *b, uint32_t n, uint32_t k,
+                      const float *bias, float *c, size_t ldc)
+{
+  for (uint32_t i = 0U; i < m; i += SSBD_ROWS)
+  {
+    const float *rows[SSBD_ROWS];
+    const uint32_t count = ((m - i) < SSBD_ROWS) ? (m - i) : SSBD_ROWS;
+
+    for (uint32_t r = 0U; r < SSBD_ROWS; r++)
+    {
+      rows[r] = &a[(size_t)(i + ((r < count) ? r : 0U)) * lda];
+    }
+    for (uint32_t j = 0U; j < n; j++)
+    {
+      float out[SSBD_ROWS];
+
+      Ssbd_Dot4(rows, &b[(size_t)j * k], k, out);
+      for (uint32_t r = 0U; r < count; r++)
+      {
+        c[((size_t)(i + r) * ldc) + j] = out[r] + ((bias != NULL) ? bias[j] : 0.0f);
+      }
+    }
+  }
+}
+
+/* One direction of one layer: y[t][dir * hidden ...] */
+static void Ssbd_Lstm(const SsbdModel_HandleTypeDef *model, SsbdModel_ContextTypeDef *ctx, const float *x,
+                      uint32_t layer, uint32_t dir, float *y)
+{
+  const Ssbd_LstmTypeDef *cell = &model->lstm[(2U * layer) + dir];
+  const uint32_t hidden = model->hdr.hidden;
+  const uint32_t steps = model->steps;
+  const size_t ldx = (layer == 0U) ? model->input : (2U * hidden);
+
+  /* input projections of every step and gate at once */
+  Ssbd_Gemm(x, ldx, steps, cell->w_ih, 4U * hidden, cell->input, cell->bias, ctx->gates, 4U * hidden);
+  memset(ctx->h, 0, hidden * sizeof(float));
+  memset(ctx->c, 0, hidden * sizeof(float));
+  for (uint32_t s = 0U; s < steps; s++)
+  {
+    const uint32_t t = (dir == 0U) ? s : (steps - 1U - s);
+
+    /* all 4 gates' recurrent products, onto the input projections */
+    Ssbd_Gemv(cell->w_hh, &ctx->gates[(size_t)t * 4U * hidden], ctx->h, 4U * hidden, hidden, ctx->g);
+    for (uint32_t j = 0U; j < hidden; j++)
+    {
+      const float i_gate = Ssbd_Sigmoid(ctx->g[j]);
+      const float f_gate = Ssbd_Sigmoid(ctx->g[hidden + j]);
+      const float g_gate = tanhf(ctx->g[(2U * hidden) + j]);
+      const float o_gate = Ssbd_Sigmoid(ctx->g[(3U * hidden) + j]);
+
+      ctx->c[j] = (f_gate * ctx->c[j]) + (i_gate * g_gate);
+      ctx->h[j] = o_gate * tanhf(ctx->c[j]);
+    }
+    memcpy(&y[((size_t)t * 2U * hidden) + ((size_t)dir * hidden)], ctx->h, hidden * sizeof(float));
+  }
+}
+
+/* nn.MultiheadAttention(x, x, x) at the last step only, into ctx->a */
+static void Ssbd_Attention(const SsbdModel_HandleTypeDef *model, SsbdModel_ContextTypeDef *ctx, const float *x)
+{
+  const uint32_t e = 2U * model->hdr.hidden;
+  const uint32_t steps = model->steps;
+  const uint32_t heads = model->hdr.heads;
+  const uint32_t dim = e / heads;
+  const float scale = 1.0f / sqrtf((float)dim);
+
+  /* keys and values of every step, the query of the last */
+  Ssbd_Gemm(x, e, steps, &model->in_proj_w[(size_t)e * e], 2U * e, e, &model->in_proj_b[e], ctx->kv, 2U * e);
+  Ssbd_Gemv(model->in_proj_w, model->in_proj_b, &x[(size_t)(steps - 1U) * e], e, e, ctx->q);
+  for (uint32_t hd = 0U; hd < heads; hd++)
+  {
+    const float *q = &ctx->q[hd * dim];
+    float *out = &ctx->ctx[hd * dim];
+
+    for (uint32_t t = 0U; t < steps; t++)
+    {
+      const float *k = &ctx->kv[((size_t)t * 2U * e) + (hd * dim)];
+      float s = 0.0f;
+
+      for (uint32_t i = 0U; i < dim; i++)
+      {
+        s += q[i] * k[i];
+      }
+      ctx->p[t] = s * scale;
+    }
+    Ssbd_Softmax(ctx->p, steps);
+    memset(out, 0, dim * sizeof(float));
+    for (uint32_t t = 0U; t < steps; t++)
+    {
+      const float *v = &ctx->kv[((size_t)t * 2U * e) + e + (hd * dim)];
+
+      for (uint32_t i = 0U; i < dim; i++)
+      {
+        out[i] += ctx->p[t] * v[i];
+      }
+    }
+  }
+  Ssbd_Dense(model->out_proj_w, model->out_proj_b, ctx->ctx, e, e, ctx->a, 0);
+}
+
+/* y = w x + b, [n][k] weights, 4 rows of w per pass over x */
+static void Ssbd_Gemv(const float *w, const float *b, const float *x, uint32_t n, uint32_t k, float *y)
+{
+  for (uint32_t j = 0U; j < n; j += SSBD_ROWS)
+  {
+    const uint32_t count = ((n - j) < SSBD_ROWS) ? (n - j) : SSBD_ROWS;
+    const float *rows[SSBD_ROWS];
+    float out[SSBD_ROWS];
+
+    for (uint32_t r = 0U; r < SSBD_ROWS; r++)
+    {
+      rows[r] = &w[(size_t)(j + ((r < count) ? r : 0U)) * k];
+    }
+    Ssbd_Dot4(rows, x, k, out);
+    for (uint32_t r = 0U; r < count; r++)
+    {
+      y[j + r] = out[r] + b[j + r];
+    }
+  }
+}
+
+/* Ssbd_Gemv, then LeakyReLU if leaky */
+static void Ssbd_Dense(const float *w, const float *b, const float *x, uint32_t n, uint32_t k, float *y, int leaky)
+{
+  Ssbd_Gemv(w, b, x, n, k, y);
+  for (uint32_t j = 0U; (leaky != 0) && (j < n); j++)
+  {
+    y[j] = (y[j] < 0.0f) ? (y[j] * SSBD_MODEL_LEAKY) : y[j];
+  }
+}
+
+static void Ssbd_Softmax(float *v, uint32_t n)
+{
+  float max = v[0];
+  float sum = 0.0f;
+
+  for (uint32_t i = 1U; i < n; i++)
+  {
+    max = (v[i] > max) ? v[i] : max;
+  }
+  for (uint32_t i = 0U; i < n; i++)
+  {
+    v[i] = expf(v[i] - max);
+    sum += v[i];
+  }
+  for (uint32_t i = 0U; i < n; i++)
+  {
+    v[i] /= sum;
+  }
+}
+
+/* 4 dot products against b in SSBD_LANES partial sums each, added up as
+   ((l0 + l4) + (l2 + l6)) + ((l1 + l5) + (l3 + l7)) in both builds */
+static void Ssbd_Dot4(const float *const a[SSBD_ROWS], const float *b, uint32_t k, float out[SSBD_ROWS])
+{
+  const uint32_t whole = k - (k % SSBD_LANES);
+#if defined(SSBD_MODEL_SSE2)
+  __m128 lo[SSBD_ROWS];
+  __m128 hi[SSBD_ROWS];
+
+  for (uint32_t r = 0U; r < SSBD_ROWS; r++)
+  {
+    lo[r] = _mm_setzero_ps();
+    hi[r] = _mm_setzero_ps();
+  }
+  for (uint32_t i = 0U; i < whole; i += SSBD_LANES)
+  {
+    const __m128 b_lo = _mm_loadu_ps(&b[i]);
+    const __m128 b_hi = _mm_loadu_ps(&b[i + 4U]);
+
+    for (uint32_t r = 0U; r < SSBD_ROWS; r++)
+    {
+      lo[r] = _mm_add_ps(lo[r], _mm_mul_ps(_mm_loadu_ps(&a[r][i]), b_lo));
+      hi[r] = _mm_add_ps(hi[r], _mm_mul_ps(_mm_loadu_ps(&a[r][i + 4U]), b_hi));
+    }
+  }
+  for (uint32_t r = 0U; r < SSBD_ROWS; r++)
+  {
+    const __m128 v = _mm_add_ps(lo[r], hi[r]);
+    const __m128 pair = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    float s = _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 1)));
+
+    for (uint32_t i = whole; i < k; i++)
+    {
+      s += a[r][i] * b[i];
+    }
+    out[r] = s;
+  }
+#else
+  float acc[SSBD_ROWS][SSBD_LANES];
+
+  memset(acc, 0, sizeof(acc));
+  for (uint32_t i = 0U; i < whole; i += SSBD_LANES)
+  {
+    for (uint32_t r = 0U; r < SSBD_ROWS; r++)
+    {
+      for (uint32_t j = 0U; j < SSBD_LANES; j++)
+      {
+        acc[r][j] += a[r][i + j] * b[i + j];
+      }
+    }
+  }
+  for (uint32_t r = 0U; r < SSBD_ROWS; r++)
+  {
+    const float v[4] = { acc[r][0] + acc[r][4], acc[r][1] + acc[r][5], acc[r][2] + acc[r][6],
+                         acc[r][3] + acc[r][7] };
+    float s = (v[0] + v[2]) + (v[1] + v[3]);
+
+    for (uint32_t i = whole; i < k; i++)
+    {
+      s += a[r][i] * b[i];
+    }
+    out[r] = s;
+  }
+#endif
+}
+
+static float Ssbd_Sigmoid(float x)
+{
+  return 1.0f / (1.0f + expf(-x));
+}
@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file           : ssbd_model.h
+  * @brief          : Header for ssbd_model.c file.
+  *                   MultimodalSSBDModel of model.ipynb run on the CPU from
+  *                   weights exported by ssbd_runtime.export(); built as
+  *                   libssbd_model.so for ssbd_runtime.py and into
+  *                   ssbd_bench.
+  *
+  *                   The model file, little endian, every tensor 64-byte
+  *                   aligned, float32, in this order after the header:
+  *                     conv1 weight [mid][channels][kt][kh][kw], bias [mid]
+  *                     conv2 weight [out][mid][kt][kh][kw], bias [out]
+  *                     per LSTM layer, forward then reverse:
+  *                       w_ih [4 hidden][input], w_hh [4 hidden][hidden],
+  *                       bias [4 hidden] (b_ih + b_hh), gates i f g o
+  *                     attention in_proj weight [3 E][E], bias [3 E],
+  *                       out_proj weight [E][E], bias [E], E = 2 hidden
+  *                     fc1 weight [fc1][E], bias; fc2 weight [fc2][fc1],
+  *                       bias; fc3 weight [classes][fc2], bias
+  *                   the batch norms folded into the layer before (the
+  *                   convolutions) or after (the fully connected ones).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SSBD_MODEL_H
+#define __SSBD_MODEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define SSBD_MODEL_MAGIC        0x314D5353U     /* "SSM1" */
+#define SSBD_MODEL_ALIGN        64U
+#define SSBD_MODEL_DIM_MAX      65536U  /* of any dimension                */
+#define SSBD_MODEL_LEAKY        0.01f   /* nn.LeakyReLU() slope            */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t magic;
+  uint32_t header_bytes;    /* sizeof(SsbdModel_HeaderTypeDef)             */
+  /* a clip */
+  uint32_t channels;
+  uint32_t frames;
+  uint32_t height;
+  uint32_t width;
+  /* spatiotemporal block: two Conv3d, kernels and strides (t, h, w) */
+  uint32_t conv_channels[2];
+  uint32_t conv_kernel[2][3];
+  uint32_t conv_stride[2][3];
+  uint32_t movenet_dim;     /* keypoint features per frame, 0 without     */
+  uint32_t hidden;          /* of each LSTM direction                      */
+  uint32_t layers;
+  uint32_t heads;           /* of the attention                            */
+  uint32_t fc[2];
+  uint32_t classes;
+  uint32_t reserved[3];
+  uint64_t size;            /* of the file                                 */
+} SsbdModel_HeaderTypeDef;
+
+typedef struct SsbdModel_Handle SsbdModel_HandleTypeDef;
+typedef struct SsbdModel_Context SsbdModel_ContextTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+SsbdModel_HandleTypeDef *SsbdModel_Load(const char *path);
+const SsbdModel_HeaderTypeDef *SsbdModel_Header(const SsbdModel_HandleTypeDef *model);
+void SsbdModel_Free(SsbdModel_HandleTypeDef *model);
+
+SsbdModel_ContextTypeDef *SsbdModel_NewContext(const SsbdModel_HandleTypeDef *model);
+size_t SsbdModel_Workspace(const SsbdModel_ContextTypeDef *context);
+int SsbdModel_Predict(SsbdModel_ContextTypeDef *context, const float *video, const float *movenet, float *probs);
+int SsbdModel_PredictFrames(SsbdModel_ContextTypeDef *context, const uint8_t *frames, const float *movenet,
+                            float *probs);
+void SsbdModel_FreeContext(SsbdModel_ContextTypeDef *context);
+const char *SsbdModel_Isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SSBD_MODEL_H */
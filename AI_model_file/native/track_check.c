@@ -0,0 +1,629 @@
+/**
+  ******************************************************************************
+  * @file           : track_check.c
+  * @brief          : Check and time person_track against detecting every
+  *                   frame.
+  *
+  *                     track_check [-n frames] [-i interval] [-p people]
+  *
+  *                   Checks PersonTrack_Nms() against the suppression
+  *                   written out plainly, on clustered boxes of many
+  *                   counts, and PersonTrack_Decode() against a plain
+  *                   decoding of YOLOv8 output made up for -p people walking
+  *                   through a 1280x720 video: jittered duplicate boxes per
+  *                   person, a few misses and false alarms, and anchors
+  *                   where another class outscores the person. Then tracks
+  *                   -n frames of it with the detector on every frame and
+  *                   every -i frames, and requires the second to run the
+  *                   detector at least 3 times less with about the same
+  *                   recall, IoU and identity switches.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "person_track.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK_WIDTH         1280U
+#define CHECK_HEIGHT        720U
+#define CHECK_INPUT         640U
+#define CHECK_ANCHORS       8400U
+#define CHECK_ROWS          84U         /* 4 + the 80 COCO classes         */
+#define CHECK_PEOPLE_MAX    8U
+#define CHECK_DUPLICATES    10U         /* anchors firing on each person   */
+#define CHECK_MISS          0.05f       /* chance a person is not detected */
+#define CHECK_FALSE_ALARM   0.02f       /* chance of a box on nobody       */
+#define CHECK_MATCH         0.5f        /* IoU of a box found              */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  float cx;
+  float cy;
+  float w;
+  float h;
+  float vx;
+  float vy;
+  float phase;
+} Check_PersonTypeDef;
+
+typedef struct
+{
+  Check_PersonTypeDef people[CHECK_PEOPLE_MAX];
+  uint32_t count;
+  uint32_t seed;            /* of the detector's noise                     */
+} Check_SceneTypeDef;
+
+typedef struct
+{
+  uint64_t runs;
+  uint64_t found;           /* person-frames with a box of IoU 0.5         */
+  uint64_t switches;        /* a person's box changing track               */
+  uint64_t stray;           /* boxes on nobody                             */
+  double iou;               /* summed over person-frames                   */
+  double decode;            /* seconds                                     */
+  double step;
+} Check_ResultTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const PersonTrack_LetterboxTypeDef check_letterbox =
+{
+  (float)CHECK_INPUT / (float)CHECK_WIDTH, 0.0f,
+  ((float)CHECK_INPUT - ((float)CHECK_HEIGHT * (float)CHECK_INPUT / (float)CHECK_WIDTH)) / 2.0f,
+  CHECK_WIDTH, CHECK_HEIGHT,
+};
+static float *check_background;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t Check_Rand(uint32_t *state);
+static float Check_Uniform(uint32_t *state, float lo, float hi);
+static int Check_Nms(void);
+static uint32_t Check_NmsReference(const float *x1, const float *y1, const float *x2, const float *y2,
+                                   uint32_t count, float iou_threshold, uint32_t *keep, uint32_t max);
+static uint32_t Check_DecodeReference(const float *output, float conf_threshold, float iou_threshold,
+                                      PersonTrack_DetectionTypeDef *detections);
+static void Check_Scene(Check_SceneTypeDef *scene, uint32_t people);
+static void Check_Move(Check_SceneTypeDef *scene, uint32_t frame);
+static void Check_Detect(Check_SceneTypeDef *scene, float *output);
+static int Check_Track(const Check_SceneTypeDef *start, uint32_t frames, uint32_t interval, int compare,
+                       Check_ResultTypeDef *result);
+static int Check_Grow(PersonTrack_BoxesTypeDef *boxes);
+static float Check_Iou(const float a[4], const float b[4]);
+static double Check_Now(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  Check_ResultTypeDef every = {0};
+  Check_ResultTypeDef skip = {0};
+  Check_SceneTypeDef scene;
+  uint32_t frames = 1800U;
+  uint32_t interval = 5U;
+  uint32_t people = 3U;
+  double cases;
+  int failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:i:p:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        frames = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'i':
+        interval = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'p':
+        people = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n frames] [-i interval] [-p people]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if ((optind != argc) || (frames == 0U) || (interval < 2U) || (people == 0U) || (people > CHECK_PEOPLE_MAX))
+  {
+    fprintf(stderr, "usage: %s [-n frames] [-i interval] [-p people]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  check_background = malloc((size_t)CHECK_ROWS * CHECK_ANCHORS * sizeof(float));
+  if (check_background == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+  /* anchors on nothing: small boxes, every class unlikely */
+  for (uint32_t a = 0U; a < CHECK_ANCHORS; a++)
+  {
+    uint32_t state = (a * 2654435761U) | 1U;
+
+    check_background[a] = Check_Uniform(&state, 0.0f, (float)CHECK_INPUT);
+    check_background[CHECK_ANCHORS + a] = Check_Uniform(&state, 0.0f, (float)CHECK_INPUT);
+    check_background[(2U * CHECK_ANCHORS) + a] = Check_Uniform(&state, 4.0f, 60.0f);
+    check_background[(3U * CHECK_ANCHORS) + a] = Check_Uniform(&state, 4.0f, 60.0f);
+    for (uint32_t r = 4U; r < CHECK_ROWS; r++)
+    {
+      check_background[((size_t)r * CHECK_ANCHORS) + a] = Check_Uniform(&state, 0.0f, 0.3f);
+    }
+  }
+
+  failed |= Check_Nms();
+  Check_Scene(&scene, people);
+  failed |= Check_Track(&scene, frames, 1U, 1, &every);
+  failed |= Check_Track(&scene, frames, interval, 0, &skip);
+  if (failed == 0)
+  {
+    printf("%u people, %u frames: decoding matches the plain one on %llu detector runs\n", people, frames,
+           (unsigned long long)every.runs);
+  }
+
+  cases = (double)frames * people;
+  printf("every frame: %llu detector runs, %.4f found, IoU %.3f, %llu switches, %llu stray boxes; "
+         "decode %.1f us a run, track %.2f us a frame (%s)\n", (unsigned long long)every.runs,
+         (double)every.found / cases, every.iou / cases, (unsigned long long)every.switches,
+         (unsigned long long)every.stray, every.decode * 1e6 / (double)every.runs, every.step * 1e6 / frames,
+         PersonTrack_Isa());
+  printf("every %u frames: %llu detector runs (%.1fx fewer), %.4f found, IoU %.3f, %llu switches, "
+         "%llu stray boxes; track %.2f us a frame\n", interval, (unsigned long long)skip.runs,
+         (double)every.runs / (double)skip.runs, (double)skip.found / cases, skip.iou / cases,
+         (unsigned long long)skip.switches, (unsigned long long)skip.stray, skip.step * 1e6 / frames);
+  if (((skip.runs * 3U) > every.runs) || (((double)skip.found / cases) < (((double)every.found / cases) - 0.03)) ||
+      ((skip.iou / cases) < ((every.iou / cases) - 0.05)) || (skip.switches > (every.switches + people)))
+  {
+    fprintf(stderr, "tracking every %u frames falls short of detecting every frame\n", interval);
+    failed = 1;
+  }
+  free(check_background);
+  return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static uint32_t Check_Rand(uint32_t *state)
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static float Check_Uniform(uint32_t *state, float lo, float hi)
+{
+  return lo + ((hi - lo) * (float)(Check_Rand(state) >> 8) / 16777216.0f);
+}
+
+/* clustered boxes by score, every count round the vector width */
+static int Check_Nms(void)
+{
+  static const uint32_t counts[] = { 0U, 1U, 3U, 4U, 5U, 17U, 64U, 301U, 1000U, 2999U };
+  static const uint32_t maxes[] = { PERSON_TRACK_MAX_DET, 7U };
+  const uint32_t n = 2999U;
+  float *x1 = malloc(5U * n * sizeof(float));
+  float *y1 = &x1[n];
+  float *x2 = &x1[2U * n];
+  float *y2 = &x1[3U * n];
+  float *area = &x1[4U * n];
+  uint32_t *keep = malloc(2U * n * sizeof(uint32_t));
+  uint32_t *want = &keep[n];
+  uint32_t state = 12345U;
+  int failed = 0;
+
+  if ((x1 == NULL) || (keep == NULL))
+  {
+    free(x1);
+    free(keep);
+    return 1;
+  }
+  for (uint32_t c = 0U; c < (sizeof(counts) / sizeof(counts[0])); c++)
+  {
+    const uint32_t count = counts[c];
+
+    /* scores fall with the index; 20 clusters of overlapping boxes */
+    for (uint32_t i = 0U; i < count; i++)
+    {
+      const float cx = 30.0f * (float)(Check_Rand(&state) % 20U) + Check_Uniform(&state, 0.0f, 12.0f);
+      const float cy = Check_Uniform(&state, 100.0f, 120.0f);
+      const float w = Check_Uniform(&state, 20.0f, 40.0f);
+      const float h = Check_Uniform(&state, 30.0f, 90.0f);
+
+      x1[i] = cx - (w / 2.0f);
+      x2[i] = cx + (w / 2.0f);
+      y1[i] = cy - (h / 2.0f);
+      y2[i] = (i % 97U == 5U) ? (y1[i] - 1.0f) : (cy + (h / 2.0f));
+    }
+    for (uint32_t m = 0U; m < (sizeof(maxes) / sizeof(maxes[0])); m++)
+    {
+      for (uint32_t t = 0U; t < 3U; t++)
+      {
+        const float threshold = 0.25f * (float)(t + 1U);
+        const uint32_t got = PersonTrack_Nms(x1, y1, x2, y2, count, threshold, area, keep, maxes[m]);
+        const uint32_t expected = Check_NmsReference(x1, y1, x2, y2, count, threshold, want, maxes[m]);
+
+        if ((got != expected) || (memcmp(keep, want, got * sizeof(uint32_t)) != 0))
+        {
+          fprintf(stderr, "suppression of %u boxes at IoU %.2f keeps %u boxes, not %u\n", count, threshold, got,
+                  expected);
+          failed = 1;
+        }
+      }
+    }
+  }
+  if (failed == 0)
+  {
+    printf("suppression (%s) matches the plain one on %u box counts\n", PersonTrack_Isa(),
+           (uint32_t)(sizeof(counts) / sizeof(counts[0])));
+  }
+  free(x1);
+  free(keep);
+  return failed;
+}
+
+static uint32_t Check_NmsReference(const float *x1, const float *y1, const float *x2, const float *y2,
+                                   uint32_t count, float iou_threshold, uint32_t *keep, uint32_t max)
+{
+  uint8_t *gone = calloc(count + 1U, 1U);
+  uint32_t kept = 0U;
+
+  for (uint32_t i = 0U; (i < count) && (kept < max); i++)
+  {
+    const float area_i = (x2[i] - x1[i]) * (y2[i] - y1[i]);
+
+    if ((gone[i] != 0U) || (area_i < 0.0f))
+    {
+      continue;
+    }
+    keep[kept++] = i;
+    for (uint32_t j = i + 1U; j < count; j++)
+    {
+      const float w = fmaxf(fminf(x2[j], x2[i]) - fmaxf(x1[j], x1[i]), 0.0f);
+      const float h = fmaxf(fminf(y2[j], y2[i]) - fmaxf(y1[j], y1[i]), 0.0f);
+      const float inter = w * h;
+      const float area_j = (gone[j] != 0U) ? -1.0f : ((x2[j] - x1[j]) * (y2[j] - y1[j]));
+
+      if (inter > (iou_threshold * ((area_i + area_j) - inter)))
+      {
+        gone[j] = 1U;
+      }
+    }
+  }
+  free(gone);
+  return kept;
+}
+
+/* ultralytics' non_max_suppression() for the person class, one anchor at a time */
+static uint32_t Check_DecodeReference(const float *output, float conf_threshold, float iou_threshold,
+                                      PersonTrack_DetectionTypeDef *detections)
+{
+  static float x1[CHECK_ANCHORS];
+  static float y1[CHECK_ANCHORS];
+  static float x2[CHECK_ANCHORS];
+  static float y2[CHECK_ANCHORS];
+  static float score[CHECK_ANCHORS];
+  static uint32_t keep[PERSON_TRACK_MAX_DET];
+  const PersonTrack_LetterboxTypeDef *lb = &check_letterbox;
+  uint32_t n = 0U;
+  uint32_t kept;
+
+  for (uint32_t a = 0U; a < CHECK_ANCHORS; a++)
+  {
+    uint32_t best = 4U;
+
+    for (uint32_t r = 5U; r < CHECK_ROWS; r++)
+    {
+      best = (output[((size_t)r * CHECK_ANCHORS) + a] > output[((size_t)best * CHECK_ANCHORS) + a]) ? r : best;
+    }
+    if ((best == (4U + PERSON_TRACK_CLASS)) && (output[((size_t)best * CHECK_ANCHORS) + a] > conf_threshold))
+    {
+      const float s = output[((size_t)best * CHECK_ANCHORS) + a];
+      uint32_t at = n++;
+
+      /* insertion by score, ties in anchor order */
+      while ((at > 0U) && (score[at - 1U] < s))
+      {
+        x1[at] = x1[at - 1U];
+        y1[at] = y1[at - 1U];
+        x2[at] = x2[at - 1U];
+        y2[at] = y2[at - 1U];
+        score[at] = score[at - 1U];
+        at--;
+      }
+      x1[at] = output[a] - (output[(2U * CHECK_ANCHORS) + a] / 2.0f);
+      y1[at] = output[CHECK_ANCHORS + a] - (output[(3U * CHECK_ANCHORS) + a] / 2.0f);
+      x2[at] = output[a] + (output[(2U * CHECK_ANCHORS) + a] / 2.0f);
+      y2[at] = output[CHECK_ANCHORS + a] + (output[(3U * CHECK_ANCHORS) + a] / 2.0f);
+      score[at] = s;
+    }
+  }
+  kept = Check_NmsReference(x1, y1, x2, y2, n, iou_threshold, keep, PERSON_TRACK_MAX_DET);
+  for (uint32_t i = 0U; i < kept; i++)
+  {
+    const uint32_t k = keep[i];
+
+    detections[i].x1 = fminf(fmaxf((x1[k] - lb->pad_x) / lb->gain, 0.0f), (float)lb->width);
+    detections[i].y1 = fminf(fmaxf((y1[k] - lb->pad_y) / lb->gain, 0.0f), (float)lb->height);
+    detections[i].x2 = fminf(fmaxf((x2[k] - lb->pad_x) / lb->gain, 0.0f), (float)lb->width);
+    detections[i].y2 = fminf(fmaxf((y2[k] - lb->pad_y) / lb->gain, 0.0f), (float)lb->height);
+    detections[i].score = score[k];
+  }
+  return kept;
+}
+
+static void Check_Scene(Check_SceneTypeDef *scene, uint32_t people)
+{
+  uint32_t state = 2463534242U;
+
+  scene->count = people;
+  scene->seed = 88172645U;
+  for (uint32_t p = 0U; p < people; p++)
+  {
+    Check_PersonTypeDef *person = &scene->people[p];
+
+    person->w = Check_Uniform(&state, 90.0f, 160.0f);
+    person->h = Check_Uniform(&state, 240.0f, 420.0f);
+    person->cx = ((float)CHECK_WIDTH * ((float)p + 0.5f)) / (float)people;
+    person->cy = Check_Uniform(&state, person->h / 2.0f, (float)CHECK_HEIGHT - (person->h / 2.0f));
+    person->vx = Check_Uniform(&state, -4.0f, 4.0f);
+    person->vy = Check_Uniform(&state, -1.0f, 1.0f);
+    person->phase = Check_Uniform(&state, 0.0f, 6.0f);
+  }
+}
+
+/* walking, swaying, turning back at the edges */
+static void Check_Move(Check_SceneTypeDef *scene, uint32_t frame)
+{
+  for (uint32_t p = 0U; p < scene->count; p++)
+  {
+    Check_PersonTypeDef *person = &scene->people[p];
+
+    person->cx += person->vx + (1.5f * sinf(((float)frame * 0.07f) + person->phase));
+    person->cy += person->vy;
+    if (((person->cx - (person->w / 2.0f)) < 0.0f) || ((person->cx + (person->w / 2.0f)) > (float)CHECK_WIDTH))
+    {
+      person->vx = -person->vx;
+      person->cx += 2.0f * person->vx;
+    }
+    if (((person->cy - (person->h / 2.0f)) < 0.0f) || ((person->cy + (person->h / 2.0f)) > (float)CHECK_HEIGHT))
+    {
+      person->vy = -person->vy;
+      person->cy += 2.0f * person->vy;
+    }
+  }
+}
+
+/* what YOLOv8 might see on the frame, in input pixels */
+static void Check_Detect(Check_SceneTypeDef *scene, float *output)
+{
+  const PersonTrack_LetterboxTypeDef *lb = &check_letterbox;
+  uint32_t *state = &scene->seed;
+  uint32_t a;
+
+  memcpy(output, check_background, (size_t)CHECK_ROWS * CHECK_ANCHORS * sizeof(float));
+  for (uint32_t p = 0U; p < scene->count; p++)
+  {
+    const Check_PersonTypeDef *person = &scene->people[p];
+
+    if (Check_Uniform(state, 0.0f, 1.0f) < CHECK_MISS)
+    {
+      continue;
+    }
+    for (uint32_t k = 0U; k < CHECK_DUPLICATES; k++)
+    {
+      a = Check_Rand(state) % CHECK_ANCHORS;
+      output[a] = (person->cx * lb->gain) + lb->pad_x + Check_Uniform(state, -0.04f, 0.04f) * person->w * lb->gain;
+      output[CHECK_ANCHORS + a] = (person->cy * lb->gain) + lb->pad_y +
+                                  Check_Uniform(state, -0.03f, 0.03f) * person->h * lb->gain;
+      output[(2U * CHECK_ANCHORS) + a] = person->w * lb->gain * Check_Uniform(state, 0.92f, 1.08f);
+      output[(3U * CHECK_ANCHORS) + a] = person->h * lb->gain * Check_Uniform(state, 0.94f, 1.06f);
+      output[(4U * CHECK_ANCHORS) + a] = Check_Uniform(state, 0.55f, 0.92f);
+    }
+  }
+  if (Check_Uniform(state, 0.0f, 1.0f) < CHECK_FALSE_ALARM)
+  {
+    a = Check_Rand(state) % CHECK_ANCHORS;
+    output[a] = Check_Uniform(state, 100.0f, 540.0f);
+    output[CHECK_ANCHORS + a] = Check_Uniform(state, 200.0f, 440.0f);
+    output[(2U * CHECK_ANCHORS) + a] = 50.0f;
+    output[(3U * CHECK_ANCHORS) + a] = 120.0f;
+    output[(4U * CHECK_ANCHORS) + a] = 0.6f;
+  }
+  /* a dog that looks a little like a person */
+  a = Check_Rand(state) % CHECK_ANCHORS;
+  output[a] = Check_Uniform(state, 100.0f, 540.0f);
+  output[CHECK_ANCHORS + a] = Check_Uniform(state, 200.0f, 440.0f);
+  output[(2U * CHECK_ANCHORS) + a] = 80.0f;
+  output[(3U * CHECK_ANCHORS) + a] = 60.0f;
+  output[(4U * CHECK_ANCHORS) + a] = 0.7f;
+  output[(20U * CHECK_ANCHORS) + a] = 0.9f;
+}
+
+static int Check_Track(const Check_SceneTypeDef *start, uint32_t frames, uint32_t interval, int compare,
+                       Check_ResultTypeDef *result)
+{
+  PersonTrack_ConfigTypeDef config = PERSON_TRACK_CONFIG_DEFAULT;
+  static PersonTrack_DetectionTypeDef detections[PERSON_TRACK_MAX_DET];
+  static PersonTrack_DetectionTypeDef expected[PERSON_TRACK_MAX_DET];
+  PersonTrack_BoxesTypeDef boxes = {0};
+  Check_SceneTypeDef scene = *start;
+  uint32_t last[CHECK_PEOPLE_MAX] = {0};
+  PersonTrack_HandleTypeDef *tracker;
+  PersonTrack_StatsTypeDef stats;
+  float *output = malloc((size_t)CHECK_ROWS * CHECK_ANCHORS * sizeof(float));
+  int failed = 0;
+
+  config.interval = interval;
+  tracker = PersonTrack_Open(&config);
+  if ((output == NULL) || (tracker == NULL) || (Check_Grow(&boxes) != 0))
+  {
+    failed = 1;
+  }
+  for (uint32_t f = 0U; (f < frames) && (failed == 0); f++)
+  {
+    const uint32_t first = boxes.count;
+    int count = -1;
+    double t0;
+
+    Check_Move(&scene, f);
+    if (PersonTrack_NeedsDetection(tracker) != 0)
+    {
+      Check_Detect(&scene, output);
+      t0 = Check_Now();
+      count = PersonTrack_Decode(tracker, output, CHECK_ROWS, CHECK_ANCHORS, &check_letterbox, detections,
+                                 PERSON_TRACK_MAX_DET);
+      result->decode += Check_Now() - t0;
+      if (count < 0)
+      {
+        failed = 1;
+        break;
+      }
+      if ((compare != 0) && (result->runs < 200U) &&
+          (((uint32_t)count != Check_DecodeReference(output, config.conf_threshold, config.iou_threshold,
+                                                     expected)) ||
+           (memcmp(detections, expected, (size_t)count * sizeof(detections[0])) != 0)))
+      {
+        fprintf(stderr, "frame %u: %d people decoded differ from the plain decoding\n", f, count);
+        failed = 1;
+      }
+      result->runs++;
+    }
+    t0 = Check_Now();
+    while (PersonTrack_Step(tracker, (count >= 0) ? detections : NULL, (count >= 0) ? (uint32_t)count : 0U,
+                            &boxes) < 0)
+    {
+      if (Check_Grow(&boxes) != 0)
+      {
+        failed = 1;
+        break;
+      }
+    }
+    result->step += Check_Now() - t0;
+
+    /* each person's best box this frame */
+    for (uint32_t r = first; r < boxes.count; r++)
+    {
+      const float box[4] = { boxes.x1[r], boxes.y1[r], boxes.x2[r], boxes.y2[r] };
+      int on_someone = 0;
+
+      if (boxes.frame[r] != f)
+      {
+        fprintf(stderr, "frame %u: a row of frame %u\n", f, boxes.frame[r]);
+        failed = 1;
+      }
+      for (uint32_t p = 0U; p < scene.count; p++)
+      {
+        const Check_PersonTypeDef *person = &scene.people[p];
+        const float truth[4] = { person->cx - (person->w / 2.0f), person->cy - (person->h / 2.0f),
+                                 person->cx + (person->w / 2.0f), person->cy + (person->h / 2.0f) };
+
+        on_someone |= (Check_Iou(box, truth) >= CHECK_MATCH);
+      }
+      result->stray += (on_someone == 0);
+    }
+    for (uint32_t p = 0U; p < scene.count; p++)
+    {
+      const Check_PersonTypeDef *person = &scene.people[p];
+      const float truth[4] = { person->cx - (person->w / 2.0f), person->cy - (person->h / 2.0f),
+                               person->cx + (person->w / 2.0f), person->cy + (person->h / 2.0f) };
+      float best = 0.0f;
+      uint32_t track = 0U;
+
+      for (uint32_t r = first; r < boxes.count; r++)
+      {
+        const float box[4] = { boxes.x1[r], boxes.y1[r], boxes.x2[r], boxes.y2[r] };
+        const float iou = Check_Iou(box, truth);
+
+        if (iou > best)
+        {
+          best = iou;
+          track = boxes.track[r];
+        }
+      }
+      result->iou += best;
+      if (best >= CHECK_MATCH)
+      {
+        result->found++;
+        result->switches += ((last[p] != 0U) && (last[p] != track));
+        last[p] = track;
+      }
+    }
+  }
+  if (tracker != NULL)
+  {
+    PersonTrack_Stats(tracker, &stats);
+    if ((failed == 0) && ((stats.frames != frames) || (stats.detections != result->runs)))
+    {
+      fprintf(stderr, "stats of %llu frames, %llu runs\n", (unsigned long long)stats.frames,
+              (unsigned long long)stats.detections);
+      failed = 1;
+    }
+  }
+  PersonTrack_Close(tracker);
+  free(boxes.frame);
+  free(output);
+  return failed;
+}
+
+/* columns twice as long, in one block */
+static int Check_Grow(PersonTrack_BoxesTypeDef *boxes)
+{
+  const uint32_t capacity = (boxes->capacity == 0U) ? 16U : (boxes->capacity * 2U);
+  uint8_t *block = malloc((size_t)capacity * ((7U * 4U) + 1U));
+  PersonTrack_BoxesTypeDef grown;
+
+  if (block == NULL)
+  {
+    return -1;
+  }
+  grown.capacity = capacity;
+  grown.count = boxes->count;
+  grown.frame = (uint32_t *)block;
+  grown.track = &grown.frame[capacity];
+  grown.x1 = (float *)&grown.track[capacity];
+  grown.y1 = &grown.x1[capacity];
+  grown.x2 = &grown.y1[capacity];
+  grown.y2 = &grown.x2[capacity];
+  grown.score = &grown.y2[capacity];
+  grown.detected = (uint8_t *)&grown.score[capacity];
+  if (boxes->count > 0U)
+  {
+    memcpy(grown.frame, boxes->frame, boxes->count * sizeof(uint32_t));
+    memcpy(grown.track, boxes->track, boxes->count * sizeof(uint32_t));
+    memcpy(grown.x1, boxes->x1, boxes->count * sizeof(float));
+    memcpy(grown.y1, boxes->y1, boxes->count * sizeof(float));
+    memcpy(grown.x2, boxes->x2, boxes->count * sizeof(float));
+    memcpy(grown.y2, boxes->y2, boxes->count * sizeof(float));
+    memcpy(grown.score, boxes->score, boxes->count * sizeof(float));
+    memcpy(grown.detected, boxes->detected, boxes->count);
+  }
+  free(boxes->frame);
+  *boxes = grown;
+  return 0;
+}
+
+static float Check_Iou(const float a[4], const float b[4])
+{
+  const float w = fminf(a[2], b[2]) - fmaxf(a[0], b[0]);
+  const float h = fminf(a[3], b[3]) - fmaxf(a[1], b[1]);
+  const float inter = (w > 0.0f && h > 0.0f) ? (w * h) : 0.0f;
+  const float both = ((a[2] - a[0]) * (a[3] - a[1])) + ((b[2] - b[0]) * (b[3] - b[1])) - inter;
+
+  return (both > 0.0f) ? (inter / both) : 0.0f;
+}
+
+static double Check_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
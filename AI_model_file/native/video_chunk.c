@@ -0,0 +1,406 @@
+/**
+  ******************************************************************************
+  * @file           : video_chunk.c
+  * @brief          : Streaming version of load_and_preprocess_video_chunk()
+  *                   of preprocessing.ipynb.
+  *
+  *                   The notebook reads every frame of the video into a
+  *                   list, keeps one in fps // FPS, resizes them to 100x100
+  *                   and slices chunks of 40 starting every 20. Here the
+  *                   frames are read one at a time as chunks are asked for:
+  *                     - a frame that is not sampled is skipped, by a seek
+  *                       when the source allows it, without being decoded
+  *                     - a sampled frame is resized straight into a ring of
+  *                       `frames` slots, bilinear as cv::resize INTER_LINEAR
+  *                     - a chunk is handed out as soon as its last frame is
+  *                       in, as a pointer into the ring
+  *                   so the memory held is the ring and one source frame,
+  *                   however long the video.
+  *
+  *                   Every frame is written to its slot and to the slot
+  *                   `frames` further on, in a ring twice as long: any run
+  *                   of up to `frames` consecutive frames is then one
+  *                   contiguous block, and a chunk never needs copying.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "video_chunk.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CHUNK_RESIZE_BITS   11U         /* bilinear weights, as OpenCV     */
+#define CHUNK_RESIZE_ONE    (1 << CHUNK_RESIZE_BITS)
+
+/* Private typedef -----------------------------------------------------------*/
+struct VideoChunk_Handle
+{
+  VideoChunk_ConfigTypeDef config;
+  FILE *file;
+  int seekable;
+  int ended;
+  size_t frame_bytes;       /* of a resized frame                          */
+  uint8_t *ring;            /* 2 x frames resized frames                   */
+  uint8_t *src;             /* the source frame being read                 */
+  size_t src_max;
+  uint32_t src_width;       /* that x0 and xw were computed for            */
+  int32_t *x0;              /* bilinear source column and weight           */
+  int32_t *xw;
+  uint64_t read;
+  uint64_t sampled;
+  uint64_t chunks;
+  uint64_t next_first;      /* sampled frame the next chunk starts at      */
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static int Chunk_ReadFrame(VideoChunk_HandleTypeDef *chunker);
+static int Chunk_Header(VideoChunk_HandleTypeDef *chunker, uint32_t *width, uint32_t *height, uint32_t *channels);
+static int Chunk_HeaderField(FILE *f, uint32_t *value);
+static int Chunk_Skip(VideoChunk_HandleTypeDef *chunker, size_t bytes);
+static int Chunk_Reserve(VideoChunk_HandleTypeDef *chunker, size_t bytes);
+static void Chunk_Resize(VideoChunk_HandleTypeDef *chunker, uint32_t width, uint32_t height, uint32_t channels,
+                         uint8_t *dst);
+static void Chunk_Coefficient(float scale, uint32_t i, uint32_t src_len, int32_t *i0, int32_t *weight);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Start chunking a video.
+  * @param  config: see VideoChunk_ConfigTypeDef
+  * @retval Chunker, NULL if the configuration is empty or the source
+  *         cannot be read
+  */
+VideoChunk_HandleTypeDef *VideoChunk_Open(const VideoChunk_ConfigTypeDef *config)
+{
+  VideoChunk_HandleTypeDef *chunker;
+  int fd;
+
+  if ((config == NULL) || (config->step == 0U) || (config->frames == 0U) || (config->hop == 0U)
+      || (config->width == 0U) || (config->height == 0U) || (config->width > VIDEO_CHUNK_SIDE_MAX)
+      || (config->height > VIDEO_CHUNK_SIDE_MAX) || (config->raw_width > VIDEO_CHUNK_SIDE_MAX)
+      || (config->raw_height > VIDEO_CHUNK_SIDE_MAX) || ((config->raw_width == 0U) != (config->raw_height == 0U)))
+  {
+    return NULL;
+  }
+  chunker = calloc(1U, sizeof(*chunker));
+  if (chunker == NULL)
+  {
+    return NULL;
+  }
+  chunker->config = *config;
+  chunker->frame_bytes = (size_t)config->width * config->height * VIDEO_CHUNK_CHANNELS;
+  chunker->ring = malloc(2U * config->frames * chunker->frame_bytes);
+  chunker->x0 = malloc((size_t)config->width * sizeof(int32_t));
+  chunker->xw = malloc((size_t)config->width * sizeof(int32_t));
+  fd = dup(config->fd);
+  chunker->file = (fd >= 0) ? fdopen(fd, "rb") : NULL;
+  if ((chunker->ring == NULL) || (chunker->x0 == NULL) || (chunker->xw == NULL) || (chunker->file == NULL))
+  {
+    if ((chunker->file == NULL) && (fd >= 0))
+    {
+      close(fd);
+    }
+    VideoChunk_Close(chunker);
+    return NULL;
+  }
+  chunker->seekable = (lseek(fd, 0, SEEK_CUR) >= 0);
+  return chunker;
+}
+
+/**
+  * @brief  The next chunk, reading as many frames as it needs.
+  * @param  view: the chunk, valid until the next call
+  * @retval 1 for a chunk, 0 at the end of the video, -1 if the source is
+  *         not a video of PPM/PGM or raw frames, or is cut short
+  */
+int VideoChunk_Next(VideoChunk_HandleTypeDef *chunker, VideoChunk_ViewTypeDef *view)
+{
+  const VideoChunk_ConfigTypeDef *cfg = &chunker->config;
+
+  for (;;)
+  {
+    const uint64_t first = chunker->next_first;
+    const uint64_t have = (chunker->sampled > first) ? (chunker->sampled - first) : 0U;
+
+    if ((have == cfg->frames) || (chunker->ended && (cfg->partial != 0U) && (have != 0U)))
+    {
+      view->frames = &chunker->ring[(size_t)(first % cfg->frames) * chunker->frame_bytes];
+      view->count = (uint32_t)have;
+      view->index = chunker->chunks++;
+      view->first = first;
+      chunker->next_first += cfg->hop;
+      return 1;
+    }
+    if (chunker->ended)
+    {
+      return 0;
+    }
+    switch (Chunk_ReadFrame(chunker))
+    {
+      case 0:
+        chunker->ended = 1;
+        break;
+      case 1:
+        break;
+      default:
+        return -1;
+    }
+  }
+}
+
+void VideoChunk_Stats(const VideoChunk_HandleTypeDef *chunker, VideoChunk_StatsTypeDef *stats)
+{
+  stats->read = chunker->read;
+  stats->sampled = chunker->sampled;
+  stats->chunks = chunker->chunks;
+  stats->memory = sizeof(*chunker) + (2U * chunker->config.frames * chunker->frame_bytes) + chunker->src_max
+                  + (2U * (size_t)chunker->config.width * sizeof(int32_t));
+}
+
+void VideoChunk_Close(VideoChunk_HandleTypeDef *chunker)
+{
+  if (chunker != NULL)
+  {
+    if (chunker->file != NULL)
+    {
+      fclose(chunker->file);
+    }
+    free(chunker->ring);
+    free(chunker->src);
+    free(chunker->x0);
+    free(chunker->xw);
+    free(chunker);
+  }
+}
+
+/**
+  * @brief  Source frames per sampled one, int(fps // target_fps) as the
+  *         notebook, but at least 1 for videos slower than the target.
+  */
+uint32_t VideoChunk_Step(double fps, uint32_t target_fps)
+{
+  const double step = (target_fps != 0U) ? floor(fps / (double)target_fps) : 1.0;
+
+  return (step >= 1.0) ? (uint32_t)step : 1U;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/* Read or skip the next source frame; 1 if there was one, 0 at the end */
+static int Chunk_ReadFrame(VideoChunk_HandleTypeDef *chunker)
+{
+  const VideoChunk_ConfigTypeDef *cfg = &chunker->config;
+  uint32_t width = cfg->raw_width;
+  uint32_t height = cfg->raw_height;
+  uint32_t channels = VIDEO_CHUNK_CHANNELS;
+  size_t bytes;
+  int status = 1;
+
+  if (width == 0U)
+  {
+    status = Chunk_Header(chunker, &width, &height, &channels);
+  }
+  else
+  {
+    const int c = fgetc(chunker->file);
+
+    status = (c == EOF) ? 0 : ((ungetc(c, chunker->file) == EOF) ? -1 : 1);
+  }
+  if (status != 1)
+  {
+    return status;
+  }
+  bytes = (size_t)width * height * channels;
+  if ((chunker->read++ % cfg->step) != 0U)
+  {
+    status = Chunk_Skip(chunker, bytes);
+  }
+  else if ((Chunk_Reserve(chunker, bytes) != 0) || (fread(chunker->src, 1U, bytes, chunker->file) != bytes))
+  {
+    status = -1;
+  }
+  else
+  {
+    const size_t slot = (size_t)(chunker->sampled++ % cfg->frames);
+    uint8_t *dst = &chunker->ring[slot * chunker->frame_bytes];
+
+    Chunk_Resize(chunker, width, height, channels, dst);
+    memcpy(dst + ((size_t)cfg->frames * chunker->frame_bytes), dst, chunker->frame_bytes);
+  }
+  if (status != 1)
+  {
+    fprintf(stderr, "frame %llu: cut short\n", (unsigned long long)(chunker->read - 1U));
+  }
+  return status;
+}
+
+/* Header of a binary PGM (P5) or PPM (P6) image; 0 at the end */
+static int Chunk_Header(VideoChunk_HandleTypeDef *chunker, uint32_t *width, uint32_t *height, uint32_t *channels)
+{
+  FILE *f = chunker->file;
+  uint32_t maxval;
+  int c;
+
+  do
+  {
+    c = fgetc(f);
+  } while ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'));
+  if (c == EOF)
+  {
+    return 0;
+  }
+  c = (c == 'P') ? fgetc(f) : EOF;
+  *channels = (c == '5') ? 1U : ((c == '6') ? 3U : 0U);
+  if ((*channels == 0U) || (Chunk_HeaderField(f, width) != 0) || (Chunk_HeaderField(f, height) != 0)
+      || (Chunk_HeaderField(f, &maxval) != 0) || (maxval == 0U) || (maxval > 255U) || (*width == 0U)
+      || (*height == 0U) || (*width > VIDEO_CHUNK_SIDE_MAX) || (*height > VIDEO_CHUNK_SIDE_MAX))
+  {
+    fprintf(stderr, "frame %llu: not a binary PGM or PPM image\n", (unsigned long long)chunker->read);
+    return -1;
+  }
+  return 1;
+}
+
+static int Chunk_HeaderField(FILE *f, uint32_t *value)
+{
+  int c = fgetc(f);
+  uint32_t v = 0U;
+  uint32_t digits = 0U;
+
+  for (;;)
+  {
+    if (c == '#')
+    {
+      while ((c != '\n') && (c != EOF))
+      {
+        c = fgetc(f);
+      }
+    }
+    else if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'))
+    {
+      c = fgetc(f);
+    }
+    else
+    {
+      break;
+    }
+  }
+  while ((c >= '0') && (c <= '9') && (digits < 9U))
+  {
+    v = (v * 10U) + (uint32_t)(c - '0');
+    digits++;
+    c = fgetc(f);
+  }
+  *value = v;
+  return ((digits == 0U) || ((c != ' ') && (c != '\t') && (c != '\r') && (c != '\n')));
+}
+
+/* Past a frame that is not sampled: seek, or read into the source buffer
+   from a pipe */
+static int Chunk_Skip(VideoChunk_HandleTypeDef *chunker, size_t bytes)
+{
+  if (chunker->seekable)
+  {
+    const int c = (fseeko(chunker->file, (off_t)bytes - 1, SEEK_CUR) == 0) ? fgetc(chunker->file) : EOF;
+
+    return (c != EOF) ? 1 : -1;
+  }
+  if (Chunk_Reserve(chunker, bytes) != 0)
+  {
+    return -1;
+  }
+  return (fread(chunker->src, 1U, bytes, chunker->file) == bytes) ? 1 : -1;
+}
+
+static int Chunk_Reserve(VideoChunk_HandleTypeDef *chunker, size_t bytes)
+{
+  if (bytes > chunker->src_max)
+  {
+    free(chunker->src);
+    chunker->src = malloc(bytes);
+    chunker->src_max = (chunker->src != NULL) ? bytes : 0U;
+    chunker->src_width = 0U;
+  }
+  return (chunker->src == NULL);
+}
+
+/* The source frame to width x height x 3, gray repeated over the channels */
+static void Chunk_Resize(VideoChunk_HandleTypeDef *chunker, uint32_t width, uint32_t height, uint32_t channels,
+                         uint8_t *dst)
+{
+  const VideoChunk_ConfigTypeDef *cfg = &chunker->config;
+  const float sx = (float)width / (float)cfg->width;
+  const float sy = (float)height / (float)cfg->height;
+  const size_t stride = (size_t)width * channels;
+  const uint32_t swap = ((cfg->bgr != 0U) && (channels == 3U));
+
+  if (chunker->src_width != width)
+  {
+    for (uint32_t x = 0U; x < cfg->width; x++)
+    {
+      Chunk_Coefficient(sx, x, width, &chunker->x0[x], &chunker->xw[x]);
+    }
+    chunker->src_width = width;
+  }
+  for (uint32_t y = 0U; y < cfg->height; y++)
+  {
+    int32_t y0;
+    int32_t b;
+    const uint8_t *r0;
+    const uint8_t *r1;
+
+    Chunk_Coefficient(sy, y, height, &y0, &b);
+    r0 = &chunker->src[(size_t)y0 * stride];
+    r1 = (b != 0) ? (r0 + stride) : r0;
+    for (uint32_t x = 0U; x < cfg->width; x++)
+    {
+      const int32_t a = chunker->xw[x];
+      const size_t x0 = (size_t)chunker->x0[x] * channels;
+      const size_t x1 = (a != 0) ? (x0 + channels) : x0;
+      uint8_t *out = &dst[(((size_t)y * cfg->width) + x) * VIDEO_CHUNK_CHANNELS];
+
+      for (uint32_t c = 0U; c < channels; c++)
+      {
+        const int32_t top = ((int32_t)r0[x0 + c] * (CHUNK_RESIZE_ONE - a)) + ((int32_t)r0[x1 + c] * a);
+        const int32_t bottom = ((int32_t)r1[x0 + c] * (CHUNK_RESIZE_ONE - a)) + ((int32_t)r1[x1 + c] * a);
+
+        out[(swap != 0U) ? (2U - c) : c] = (uint8_t)(((top * (CHUNK_RESIZE_ONE - b)) + (bottom * b)
+                                  + (1 << ((2U * CHUNK_RESIZE_BITS) - 1U))) >> (2U * CHUNK_RESIZE_BITS));
+      }
+      if (channels == 1U)
+      {
+        out[1] = out[0];
+        out[2] = out[0];
+      }
+    }
+  }
+}
+
+/* Source index and 11-bit weight of the next one for destination i, the
+   pixel centres aligned and the source clamped, as fer_detect.c */
+static void Chunk_Coefficient(float scale, uint32_t i, uint32_t src_len, int32_t *i0, int32_t *weight)
+{
+  const float f = (((float)i + 0.5f) * scale) - 0.5f;
+  int32_t at = (int32_t)floorf(f);
+  int32_t w = (int32_t)lrintf((f - (float)at) * (float)CHUNK_RESIZE_ONE);
+
+  if (at < 0)
+  {
+    at = 0;
+    w = 0;
+  }
+  if (at >= ((int32_t)src_len - 1))
+  {
+    at = (int32_t)src_len - 1;
+    w = 0;
+  }
+  *i0 = at;
+  *weight = w;
+}
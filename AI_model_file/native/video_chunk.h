@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file           : video_chunk.h
+  * @brief          : Header for video_chunk.c file.
+  *                   Overlapping fixed-length chunks of resized frames of a
+  *                   video, read one frame at a time from a PPM/PGM stream
+  *                   (ffmpeg -f image2pipe -vcodec ppm) or raw RGB frames,
+  *                   in constant memory; built as libvideo_chunk.so and
+  *                   used from Python through video_chunks.py.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __VIDEO_CHUNK_H
+#define __VIDEO_CHUNK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* preprocessing.ipynb */
+#define VIDEO_CHUNK_SIZE        40U     /* frames per chunk                */
+#define VIDEO_CHUNK_FPS         10U     /* frames sampled per second       */
+#define VIDEO_CHUNK_WIDTH       100U
+#define VIDEO_CHUNK_HEIGHT      100U
+#define VIDEO_CHUNK_CHANNELS    3U
+
+#define VIDEO_CHUNK_SIDE_MAX    16384U  /* of a source frame               */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  int fd;                   /* read to the end, not closed                 */
+  uint32_t raw_width;       /* raw rgb24 frames of that size, 0 for PPM/PGM */
+  uint32_t raw_height;
+  uint32_t step;            /* keep source frames 0, step, 2 step, ...     */
+  uint32_t frames;          /* per chunk                                   */
+  uint32_t hop;             /* sampled frames between chunk starts         */
+  uint32_t width;           /* of the resized frames                       */
+  uint32_t height;
+  uint32_t bgr;             /* channels in cv2's order rather than RGB     */
+  uint32_t partial;         /* also the chunks the end of the video cuts
+                               short, as the notebook's slicing gives them */
+} VideoChunk_ConfigTypeDef;
+
+#define VIDEO_CHUNK_CONFIG_DEFAULT  { 0, 0U, 0U, 1U, VIDEO_CHUNK_SIZE, VIDEO_CHUNK_SIZE / 2U, \
+                                      VIDEO_CHUNK_WIDTH, VIDEO_CHUNK_HEIGHT, 1U, 1U }
+
+/* A chunk, a view of the chunker's frames valid until the next call */
+typedef struct
+{
+  const uint8_t *frames;    /* [count][height][width][VIDEO_CHUNK_CHANNELS] */
+  uint32_t count;           /* frames, fewer only in a partial chunk       */
+  uint64_t index;           /* chunks before this one                      */
+  uint64_t first;           /* sampled frames before its first one         */
+} VideoChunk_ViewTypeDef;
+
+typedef struct
+{
+  uint64_t read;            /* source frames                               */
+  uint64_t sampled;         /* of them resized                             */
+  uint64_t chunks;
+  size_t memory;            /* bytes held, whatever the length of the video */
+} VideoChunk_StatsTypeDef;
+
+typedef struct VideoChunk_Handle VideoChunk_HandleTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+VideoChunk_HandleTypeDef *VideoChunk_Open(const VideoChunk_ConfigTypeDef *config);
+int VideoChunk_Next(VideoChunk_HandleTypeDef *chunker, VideoChunk_ViewTypeDef *view);
+void VideoChunk_Stats(const VideoChunk_HandleTypeDef *chunker, VideoChunk_StatsTypeDef *stats);
+void VideoChunk_Close(VideoChunk_HandleTypeDef *chunker);
+uint32_t VideoChunk_Step(double fps, uint32_t target_fps);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VIDEO_CHUNK_H */
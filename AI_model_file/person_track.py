@@ -0,0 +1,282 @@
+"""
+People through a video with YOLOv8 run every few frames only
+(native/person_track.c, built as native/build/libperson_track.so by make).
+
+    tracker = person_track.PersonTracker(interval=5)
+    for frame in frames:
+        if tracker.needs_detection():
+            image, box = person_track.letterbox(frame)
+            rows = tracker.step(yolo(image), box)   # raw output [84, anchors]
+        else:
+            rows = tracker.step()
+    boxes = tracker.boxes()     # columns frame, track, x1, y1, x2, y2, score, detected
+
+The raw output is decoded and suppressed natively as ultralytics'
+non_max_suppression() does for the person class, and every person is
+followed between detector runs by a Kalman filter, matched to the next
+run's boxes by IoU. The boxes of every frame go into columns allocated
+up front and doubled when full.
+
+    python person_track.py --self-check     native against numpy
+"""
+import argparse
+import ctypes
+import os
+import sys
+
+import numpy as np
+
+LIB = os.environ.get('PERSON_TRACK_LIB', os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                     'native', 'build', 'libperson_track.so'))
+MAX_DET = 300
+INPUT_SIZE = 640
+COLUMNS = (('frame', np.uint32), ('track', np.uint32), ('x1', np.float32), ('y1', np.float32),
+           ('x2', np.float32), ('y2', np.float32), ('score', np.float32), ('detected', np.uint8))
+
+
+class _Config(ctypes.Structure):
+    _fields_ = [('interval', ctypes.c_uint32), ('conf_threshold', ctypes.c_float), ('iou_threshold', ctypes.c_float),
+                ('match_iou', ctypes.c_float), ('min_confidence', ctypes.c_float), ('decay', ctypes.c_float),
+                ('max_misses', ctypes.c_uint32), ('max_tracks', ctypes.c_uint32)]
+
+
+class Letterbox(ctypes.Structure):
+    """How a frame was fitted to the detector's input."""
+    _fields_ = [('gain', ctypes.c_float), ('pad_x', ctypes.c_float), ('pad_y', ctypes.c_float),
+                ('width', ctypes.c_uint32), ('height', ctypes.c_uint32)]
+
+
+class _Detection(ctypes.Structure):
+    _fields_ = [('x1', ctypes.c_float), ('y1', ctypes.c_float), ('x2', ctypes.c_float), ('y2', ctypes.c_float),
+                ('score', ctypes.c_float)]
+
+
+class _Boxes(ctypes.Structure):
+    _fields_ = [('capacity', ctypes.c_uint32), ('count', ctypes.c_uint32)] + \
+               [(name, ctypes.c_void_p) for name, _ in COLUMNS]
+
+
+class _Stats(ctypes.Structure):
+    _fields_ = [('frames', ctypes.c_uint64), ('detections', ctypes.c_uint64), ('tracks', ctypes.c_uint64)]
+
+
+_lib = None
+
+
+def _library():
+    global _lib
+    if _lib is None:
+        if not os.path.exists(LIB):
+            raise OSError('%s missing: run make in %s' % (LIB, os.path.dirname(os.path.dirname(LIB))))
+        _lib = ctypes.CDLL(LIB)
+        _lib.PersonTrack_Open.restype = ctypes.c_void_p
+        _lib.PersonTrack_Open.argtypes = [ctypes.POINTER(_Config)]
+        _lib.PersonTrack_Reset.argtypes = [ctypes.c_void_p]
+        _lib.PersonTrack_NeedsDetection.argtypes = [ctypes.c_void_p]
+        _lib.PersonTrack_Step.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Detection), ctypes.c_uint32,
+                                          ctypes.POINTER(_Boxes)]
+        _lib.PersonTrack_Stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Stats)]
+        _lib.PersonTrack_Close.argtypes = [ctypes.c_void_p]
+        _lib.PersonTrack_Decode.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint32,
+                                            ctypes.POINTER(Letterbox), ctypes.POINTER(_Detection), ctypes.c_uint32]
+        _lib.PersonTrack_Nms.restype = ctypes.c_uint32
+        _lib.PersonTrack_Nms.argtypes = [ctypes.c_void_p] * 4 + [ctypes.c_uint32, ctypes.c_float, ctypes.c_void_p,
+                                                                 ctypes.c_void_p, ctypes.c_uint32]
+        _lib.PersonTrack_Isa.restype = ctypes.c_char_p
+    return _lib
+
+
+def letterbox(frame, size=INPUT_SIZE):
+    """The frame fitted into size x size as ultralytics' LetterBox does,
+    and how, for step()."""
+    import cv2
+
+    height, width = frame.shape[:2]
+    gain = min(size / height, size / width)
+    new_width, new_height = round(width * gain), round(height * gain)
+    dw, dh = (size - new_width) / 2, (size - new_height) / 2
+    if (new_width, new_height) != (width, height):
+        frame = cv2.resize(frame, (new_width, new_height), interpolation=cv2.INTER_LINEAR)
+    top, bottom = round(dh - 0.1), round(dh + 0.1)
+    left, right = round(dw - 0.1), round(dw + 0.1)
+    image = cv2.copyMakeBorder(frame, top, bottom, left, right, cv2.BORDER_CONSTANT, value=(114, 114, 114))
+    return image, Letterbox(gain, left, top, width, height)
+
+
+def nms(boxes, iou_threshold, max_det=MAX_DET):
+    """Indices kept of boxes [n, 4] x1 y1 x2 y2 sorted by score, natively."""
+    boxes = np.ascontiguousarray(np.asarray(boxes, dtype=np.float32).T)
+    n = boxes.shape[1]
+    area = np.empty(n, dtype=np.float32)
+    keep = np.empty(max(n, 1), dtype=np.uint32)
+    kept = _library().PersonTrack_Nms(*[boxes[k].ctypes.data for k in range(4)], n, iou_threshold, area.ctypes.data,
+                                      keep.ctypes.data, max_det)
+    return keep[:kept].copy()
+
+
+class PersonTracker:
+    """People from frame to frame of one video after another."""
+
+    def __init__(self, interval=5, conf_threshold=0.5, iou_threshold=0.5, match_iou=0.3, min_confidence=0.35,
+                 decay=0.95, max_misses=2, max_tracks=32, capacity=4096):
+        lib = _library()
+        self._lib = lib
+        self._handle = None
+        config = _Config(interval, conf_threshold, iou_threshold, match_iou, min_confidence, decay, max_misses,
+                         max_tracks)
+        self._handle = lib.PersonTrack_Open(ctypes.byref(config))
+        if not self._handle:
+            raise ValueError('bad tracker settings')
+        self._detections = (_Detection * MAX_DET)()
+        self._boxes = _Boxes()
+        self._columns = {}
+        self._grow(capacity)
+
+    def _grow(self, capacity):
+        count = self._boxes.count
+        columns = {name: np.empty(capacity, dtype=dtype) for name, dtype in COLUMNS}
+        for name in self._columns:
+            columns[name][:count] = self._columns[name][:count]
+        self._columns = columns
+        self._boxes.capacity = capacity
+        for name, _ in COLUMNS:
+            setattr(self._boxes, name, columns[name].ctypes.data)
+
+    def needs_detection(self):
+        """Whether the detector should run on the next frame."""
+        return bool(self._lib.PersonTrack_NeedsDetection(self._handle))
+
+    def decode(self, output, box):
+        """People [n, 5] (x1, y1, x2, y2, score in frame pixels) of the raw
+        YOLOv8 output [4 + classes, anchors] of a frame letterboxed as box."""
+        output = np.ascontiguousarray(output, dtype=np.float32)
+        if output.ndim != 2:
+            raise ValueError('raw output of shape %s, not [4 + classes, anchors]' % (output.shape,))
+        n = self._lib.PersonTrack_Decode(self._handle, output.ctypes.data, output.shape[0], output.shape[1],
+                                         ctypes.byref(box), self._detections, MAX_DET)
+        if n < 0:
+            raise ValueError('raw output of shape %s has no person row' % (output.shape,))
+        return np.ctypeslib.as_array(self._detections).view(np.float32).reshape(MAX_DET, 5)[:n].copy()
+
+    def step(self, output=None, box=None):
+        """Move on a frame, with the detector's raw output if it ran on it;
+        the rows appended for the frame, as column views."""
+        count = 0
+        if output is not None:
+            count = len(self.decode(output, box))
+        start = self._boxes.count
+        detections = self._detections if output is not None else None
+        while self._lib.PersonTrack_Step(self._handle, detections, count, ctypes.byref(self._boxes)) < 0:
+            self._grow(2 * self._boxes.capacity)
+        return {name: column[start:self._boxes.count] for name, column in self._columns.items()}
+
+    def boxes(self):
+        """Every row so far, column by column."""
+        return {name: column[:self._boxes.count] for name, column in self._columns.items()}
+
+    def reset(self):
+        """Forget the tracks and rows, for a new video."""
+        self._lib.PersonTrack_Reset(self._handle)
+        self._boxes.count = 0
+
+    def stats(self):
+        stats = _Stats()
+        self._lib.PersonTrack_Stats(self._handle, ctypes.byref(stats))
+        return {'frames': stats.frames, 'detections': stats.detections, 'tracks': stats.tracks}
+
+    def close(self):
+        if self._handle:
+            self._lib.PersonTrack_Close(self._handle)
+            self._handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+
+def nms_reference(boxes, iou_threshold, max_det=MAX_DET):
+    """The same suppression in numpy, one kept box against the rest at once."""
+    x1, y1, x2, y2 = np.asarray(boxes, dtype=np.float32).T
+    area = (x2 - x1) * (y2 - y1)
+    gone = area < 0
+    keep = []
+    threshold = np.float32(iou_threshold)
+    for i in range(len(area)):
+        if gone[i]:
+            continue
+        keep.append(i)
+        if len(keep) == max_det:
+            break
+        w = np.maximum(np.minimum(x2[i + 1:], x2[i]) - np.maximum(x1[i + 1:], x1[i]), np.float32(0))
+        h = np.maximum(np.minimum(y2[i + 1:], y2[i]) - np.maximum(y1[i + 1:], y1[i]), np.float32(0))
+        inter = w * h
+        gone[i + 1:] |= inter > threshold * ((area[i] + area[i + 1:]) - inter)
+    return np.array(keep, dtype=np.uint32)
+
+
+def self_check():
+    rng = np.random.default_rng(3)
+    for n in (0, 1, 4, 7, 33, 500):
+        centers = rng.uniform(0, 600, (n, 2)).astype(np.float32) // 40 * 40
+        sides = rng.uniform(20, 80, (n, 2)).astype(np.float32)
+        boxes = np.concatenate([centers - sides / 2, centers + sides / 2], axis=1)
+        for threshold in (0.3, 0.5, 0.7):
+            got, want = nms(boxes, threshold), nms_reference(boxes, threshold)
+            if not np.array_equal(got, want):
+                raise ValueError('suppression of %d boxes at %.1f keeps %s, numpy %s' % (n, threshold, got, want))
+
+    # raw output for two people on a 1280x720 frame, another class on a third
+    box = Letterbox(0.5, 0, 140, 1280, 720)
+    output = rng.uniform(0, 0.3, (84, 8400)).astype(np.float32)
+    output[:4] = rng.uniform(0, 60, (4, 8400))
+    people = np.array([[200, 300, 120, 300], [900, 400, 140, 320], [600, 200, 100, 100]], dtype=np.float32)
+    tracker = PersonTracker(interval=4, capacity=2)
+    for frame in range(30):
+        if tracker.needs_detection():
+            raw = output.copy()
+            for p, (cx, cy, w, h) in enumerate(people + [frame * 3, 0, 0, 0]):
+                anchors = rng.choice(8400, 6, replace=False)
+                raw[0, anchors] = cx * box.gain + box.pad_x + rng.normal(0, 1, 6)
+                raw[1, anchors] = cy * box.gain + box.pad_y + rng.normal(0, 1, 6)
+                raw[2, anchors] = w * box.gain
+                raw[3, anchors] = h * box.gain
+                raw[4, anchors] = rng.uniform(0.6, 0.9, 6)
+                if p == 2:
+                    raw[20, anchors] = 0.95
+            found = tracker.decode(raw, box)
+            if len(found) != 2:
+                raise ValueError('frame %d: %d people decoded, not 2' % (frame, len(found)))
+            rows = tracker.step(raw, box)
+        else:
+            rows = tracker.step()
+        if len(rows['track']) != 2 or not np.all(rows['frame'] == frame):
+            raise ValueError('frame %d: rows %s' % (frame, rows))
+    boxes = tracker.boxes()
+    stats = tracker.stats()
+    if len(boxes['frame']) != 60 or set(boxes['track']) != {1, 2} or stats['detections'] > 8:
+        raise ValueError('tracked %d rows of tracks %s with %d detector runs' % (len(boxes['frame']),
+                                                                                 set(boxes['track']),
+                                                                                 stats['detections']))
+    tracker.close()
+    print('suppression (%s) matches numpy; 2 people tracked through 30 frames on %d detector runs'
+          % (_library().PersonTrack_Isa().decode(), stats['detections']))
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('--self-check', action='store_true', help='compare the native suppression and tracker with numpy')
+    args = ap.parse_args()
+    if args.self_check:
+        self_check()
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except ValueError as e:
+        sys.exit(str(e))
@@ -0,0 +1,400 @@
+"""
+MultimodalSSBDModel of model.ipynb on the CPU without PyTorch, through the
+native runtime (native/ssbd_model.c, built as native/build/libssbd_model.so
+by make; file layout in native/ssbd_model.h).
+
+    ssbd_runtime.export(ssbd_model, 'ssbd.ssbm')    # once, where torch is
+
+    runtime = ssbd_runtime.Runtime('ssbd.ssbm')
+    probs = runtime.predict(video, movenet)         # [n_frames, c, h, w], [n_frames, movenet_dim]
+    label = runtime.label(video, movenet)           # "ASD" or "No_ASD"
+
+The batch norms are folded into the convolutions and linear layers on
+export; the runtime maps the file and keeps a fixed workspace per thread.
+
+    python ssbd_runtime.py --self-check          random models, native against numpy
+    python ssbd_runtime.py --random model.ssbm   a random model of the notebook's shape
+"""
+import argparse
+import ctypes
+import os
+import struct
+import sys
+import time
+
+import numpy as np
+
+LIB = os.environ.get('SSBD_MODEL_LIB', os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                   'native', 'build', 'libssbd_model.so'))
+MAGIC = 0x314D5353          # "SSM1"
+HEADER = struct.Struct('<30IQ')
+ALIGN = 64
+BN_EPS = 1e-5
+LEAKY = 0.01
+CLASSES = {0: 'No_ASD', 1: 'ASD'}
+
+# header fields after magic and header_bytes, in order
+DIMS = ('channels', 'frames', 'height', 'width', 'conv_channels', 'conv_kernel', 'conv_stride', 'movenet_dim',
+        'hidden', 'layers', 'heads', 'fc', 'classes')
+
+# the notebook's model, with 100x100 chunks of 40 frames and 17 (y, x) keypoints
+NOTEBOOK = {'channels': 3, 'frames': 40, 'height': 100, 'width': 100, 'conv_channels': (8, 16),
+            'conv_kernel': ((1, 3, 3), (3, 3, 1)), 'conv_stride': ((1, 2, 2), (2, 2, 1)), 'movenet_dim': 34,
+            'hidden': 64, 'layers': 2, 'heads': 1, 'fc': (64, 32), 'classes': 2}
+
+
+def shapes(dims):
+    """(t, h, w) after each convolution."""
+    shape = (dims['frames'], dims['height'], dims['width'])
+    out = []
+    for kernel, stride in zip(dims['conv_kernel'], dims['conv_stride']):
+        shape = tuple((n - k) // s + 1 for n, k, s in zip(shape, kernel, stride))
+        out.append(shape)
+    return out
+
+
+def embedding(dims):
+    """lstm_dim_embedding: the second conv's output of a step, flattened."""
+    _, h, w = shapes(dims)[1]
+    return dims['conv_channels'][1] * h * w
+
+
+def dims_of(model, height, width):
+    """The header dimensions of a MultimodalSSBDModel."""
+    conv1, conv2 = model.spatiotemporal_conv[0], model.spatiotemporal_conv[3]
+    dims = {'channels': conv1.in_channels, 'frames': model.n_frames, 'height': height, 'width': width,
+            'conv_channels': (conv1.out_channels, conv2.out_channels),
+            'conv_kernel': (tuple(conv1.kernel_size), tuple(conv2.kernel_size)),
+            'conv_stride': (tuple(conv1.stride), tuple(conv2.stride)), 'hidden': model.lstm.hidden_size,
+            'layers': model.lstm.num_layers, 'heads': model.attn.num_heads,
+            'fc': (model.fc[0].out_features, model.fc[3].out_features), 'classes': model.fc[6].out_features}
+    dims['movenet_dim'] = model.lstm.input_size - embedding(dims)
+    return dims
+
+
+def export(model, path, height=100, width=100):
+    """Write a trained MultimodalSSBDModel for the runtime."""
+    state = {k: v.detach().cpu().numpy() for k, v in model.state_dict().items()}
+    write(path, dims_of(model, height, width), state)
+
+
+def _fold_bn(state, prefix):
+    scale = state[prefix + '.weight'] / np.sqrt(state[prefix + '.running_var'] + BN_EPS)
+    return scale, state[prefix + '.bias'] - state[prefix + '.running_mean'] * scale
+
+
+def fold(dims, state):
+    """The tensors of the model file, in order, from a state_dict."""
+    tensors = []
+    for conv, bn in (('0', '1'), ('3', '4')):
+        scale, shift = _fold_bn(state, 'spatiotemporal_conv.' + bn)
+        w = state['spatiotemporal_conv.%s.weight' % conv]
+        tensors += [w * scale[:, None, None, None, None], state['spatiotemporal_conv.%s.bias' % conv] * scale + shift]
+    for layer in range(dims['layers']):
+        for suffix in ('', '_reverse'):
+            key = 'l%d%s' % (layer, suffix)
+            tensors += [state['lstm.weight_ih_' + key], state['lstm.weight_hh_' + key],
+                        state['lstm.bias_ih_' + key] + state['lstm.bias_hh_' + key]]
+    tensors += [state['attn.in_proj_weight'], state['attn.in_proj_bias'], state['attn.out_proj.weight'],
+                state['attn.out_proj.bias']]
+    # a batch norm after a LeakyReLU goes into the linear layer after it
+    w, b = state['fc.0.weight'], state['fc.0.bias']
+    tensors += [w, b]
+    for bn, linear in (('2', '3'), ('5', '6')):
+        scale, shift = _fold_bn(state, 'fc.' + bn)
+        w, b = state['fc.%s.weight' % linear], state['fc.%s.bias' % linear]
+        tensors += [w * scale[None, :], b + w @ shift]
+    return tensors
+
+
+def write(path, dims, state):
+    values = []
+    for name in DIMS:
+        v = dims[name]
+        values += list(np.array(v).flatten()) if isinstance(v, (tuple, list)) else [v]
+    blobs = []
+    offset = HEADER.size
+    for t in fold(dims, state):
+        start = (offset + ALIGN - 1) // ALIGN * ALIGN
+        data = np.ascontiguousarray(t, dtype='<f4').tobytes()
+        blobs.append((start - offset, data))
+        offset = start + len(data)
+    with open(path + '.tmp', 'wb') as f:
+        f.write(HEADER.pack(MAGIC, HEADER.size, *[int(v) for v in values], 0, 0, 0, offset))
+        for pad, data in blobs:
+            f.write(b'\0' * pad)
+            f.write(data)
+    os.replace(path + '.tmp', path)
+
+
+def random_state(dims, rng):
+    """A state_dict of random weights and batch norm statistics."""
+    state = {}
+    c_in = dims['channels']
+
+    def bn(prefix, n):
+        state[prefix + '.weight'] = rng.uniform(0.5, 1.5, n)
+        state[prefix + '.bias'] = rng.normal(0, 0.1, n)
+        state[prefix + '.running_mean'] = rng.normal(0, 0.1, n)
+        state[prefix + '.running_var'] = rng.uniform(0.5, 1.5, n)
+
+    for i, (conv, norm) in enumerate((('0', '1'), ('3', '4'))):
+        c_out = dims['conv_channels'][i]
+        window = c_in * int(np.prod(dims['conv_kernel'][i]))
+        state['spatiotemporal_conv.%s.weight' % conv] = rng.normal(0, 1 / np.sqrt(window),
+                                                                   (c_out, c_in) + tuple(dims['conv_kernel'][i]))
+        state['spatiotemporal_conv.%s.bias' % conv] = rng.normal(0, 0.1, c_out)
+        bn('spatiotemporal_conv.' + norm, c_out)
+        c_in = c_out
+    hidden = dims['hidden']
+    n_in = embedding(dims) + dims['movenet_dim']
+    for layer in range(dims['layers']):
+        for suffix in ('', '_reverse'):
+            key = 'l%d%s' % (layer, suffix)
+            state['lstm.weight_ih_' + key] = rng.normal(0, 1 / np.sqrt(n_in), (4 * hidden, n_in))
+            state['lstm.weight_hh_' + key] = rng.normal(0, 1 / np.sqrt(hidden), (4 * hidden, hidden))
+            state['lstm.bias_ih_' + key] = rng.normal(0, 0.1, 4 * hidden)
+            state['lstm.bias_hh_' + key] = rng.normal(0, 0.1, 4 * hidden)
+        n_in = 2 * hidden
+    e = 2 * hidden
+    state['attn.in_proj_weight'] = rng.normal(0, 1 / np.sqrt(e), (3 * e, e))
+    state['attn.in_proj_bias'] = rng.normal(0, 0.1, 3 * e)
+    state['attn.out_proj.weight'] = rng.normal(0, 1 / np.sqrt(e), (e, e))
+    state['attn.out_proj.bias'] = rng.normal(0, 0.1, e)
+    sizes = (e,) + tuple(dims['fc']) + (dims['classes'],)
+    for i, linear in enumerate(('0', '3', '6')):
+        state['fc.%s.weight' % linear] = rng.normal(0, 1 / np.sqrt(sizes[i]), (sizes[i + 1], sizes[i]))
+        state['fc.%s.bias' % linear] = rng.normal(0, 0.1, sizes[i + 1])
+    bn('fc.2', sizes[1])
+    bn('fc.5', sizes[2])
+    return {k: v.astype(np.float32) for k, v in state.items()}
+
+
+def reference(dims, state, video, movenet):
+    """The forward pass in numpy float64, batch norms and all queries."""
+    s = {k: v.astype(np.float64) for k, v in state.items()}
+    x = np.transpose(video.astype(np.float64), (1, 0, 2, 3))   # [c][t][h][w]
+    last = np.arange(dims['frames'])
+    for i, (conv, norm) in enumerate((('0', '1'), ('3', '4'))):
+        w = s['spatiotemporal_conv.%s.weight' % conv]
+        kt, kh, kw = dims['conv_kernel'][i]
+        st, sh, sw = dims['conv_stride'][i]
+        ot, oh, ow = shapes(dims)[i]
+        y = np.zeros((w.shape[0], ot, oh, ow))
+        for dt in range(kt):
+            for dh in range(kh):
+                for dw in range(kw):
+                    xs = x[:, dt:dt + st * (ot - 1) + 1:st, dh:dh + sh * (oh - 1) + 1:sh, dw:dw + sw * (ow - 1) + 1:sw]
+                    y += np.einsum('oc,cthw->othw', w[:, :, dt, dh, dw], xs)
+        y += s['spatiotemporal_conv.%s.bias' % conv][:, None, None, None]
+        p = 'spatiotemporal_conv.' + norm
+        y = (y - s[p + '.running_mean'][:, None, None, None]) / np.sqrt(s[p + '.running_var'][:, None, None, None]
+                                                                        + BN_EPS)
+        y = y * s[p + '.weight'][:, None, None, None] + s[p + '.bias'][:, None, None, None]
+        x = np.maximum(y, 0)
+        last = last[np.arange(ot) * st + kt - 1]
+    steps = x.shape[1]
+    seq = np.transpose(x, (1, 0, 2, 3)).reshape(steps, -1)
+    if dims['movenet_dim']:
+        feats = np.zeros((steps, dims['movenet_dim'])) if movenet is None else movenet.astype(np.float64)[last]
+        seq = np.concatenate([seq, feats], axis=1)
+
+    hidden = dims['hidden']
+    sig = lambda v: 1 / (1 + np.exp(-v))
+    for layer in range(dims['layers']):
+        outs = []
+        for suffix, order in (('', range(steps)), ('_reverse', reversed(range(steps)))):
+            key = 'l%d%s' % (layer, suffix)
+            h, c = np.zeros(hidden), np.zeros(hidden)
+            out = np.zeros((steps, hidden))
+            for t in order:
+                g = s['lstm.weight_ih_' + key] @ seq[t] + s['lstm.bias_ih_' + key] \
+                    + s['lstm.weight_hh_' + key] @ h + s['lstm.bias_hh_' + key]
+                i, f, gg, o = np.split(g, 4)
+                c = sig(f) * c + sig(i) * np.tanh(gg)
+                h = sig(o) * np.tanh(c)
+                out[t] = h
+            outs.append(out)
+        seq = np.concatenate(outs, axis=1)
+
+    e = 2 * hidden
+    heads = dims['heads']
+    qkv = seq @ s['attn.in_proj_weight'].T + s['attn.in_proj_bias']
+    q, k, v = qkv[:, :e], qkv[:, e:2 * e], qkv[:, 2 * e:]
+    ctx = np.zeros((steps, e))
+    d = e // heads
+    for hd in range(heads):
+        part = slice(hd * d, (hd + 1) * d)
+        scores = q[:, part] @ k[:, part].T / np.sqrt(d)
+        scores = np.exp(scores - scores.max(axis=1, keepdims=True))
+        ctx[:, part] = (scores / scores.sum(axis=1, keepdims=True)) @ v[:, part]
+    a = (ctx @ s['attn.out_proj.weight'].T + s['attn.out_proj.bias'])[-1]
+
+    for linear, norm in (('0', '2'), ('3', '5')):
+        a = s['fc.%s.weight' % linear] @ a + s['fc.%s.bias' % linear]
+        a = np.where(a < 0, a * LEAKY, a)
+        a = (a - s['fc.%s.running_mean' % norm]) / np.sqrt(s['fc.%s.running_var' % norm] + BN_EPS) \
+            * s['fc.%s.weight' % norm] + s['fc.%s.bias' % norm]
+    logits = s['fc.6.weight'] @ a + s['fc.6.bias']
+    p = np.exp(logits - logits.max())
+    return p / p.sum()
+
+
+_lib = None
+
+
+def _library():
+    global _lib
+    if _lib is None:
+        if not os.path.exists(LIB):
+            raise OSError('%s missing: run make in %s' % (LIB, os.path.dirname(os.path.dirname(LIB))))
+        _lib = ctypes.CDLL(LIB)
+        _lib.SsbdModel_Load.restype = ctypes.c_void_p
+        _lib.SsbdModel_Load.argtypes = [ctypes.c_char_p]
+        _lib.SsbdModel_Header.restype = ctypes.POINTER(ctypes.c_uint32)
+        _lib.SsbdModel_Header.argtypes = [ctypes.c_void_p]
+        _lib.SsbdModel_Free.argtypes = [ctypes.c_void_p]
+        _lib.SsbdModel_NewContext.restype = ctypes.c_void_p
+        _lib.SsbdModel_NewContext.argtypes = [ctypes.c_void_p]
+        _lib.SsbdModel_Workspace.restype = ctypes.c_size_t
+        _lib.SsbdModel_Workspace.argtypes = [ctypes.c_void_p]
+        _lib.SsbdModel_Predict.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p]
+        _lib.SsbdModel_PredictFrames.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p]
+        _lib.SsbdModel_FreeContext.argtypes = [ctypes.c_void_p]
+        _lib.SsbdModel_Isa.restype = ctypes.c_char_p
+    return _lib
+
+
+class Runtime:
+    """A model file, mapped, with the workspace for one clip at a time."""
+
+    def __init__(self, path):
+        lib = _library()
+        self._lib = lib
+        self._context = None
+        self._model = lib.SsbdModel_Load(os.fsencode(path))
+        if not self._model:
+            raise ValueError('%s: not an SSBD model file' % path)
+        header = lib.SsbdModel_Header(self._model)
+        fields = HEADER.unpack(ctypes.string_at(header, HEADER.size))
+        self.channels, self.frames, self.height, self.width = fields[2:6]
+        self.movenet_dim = fields[20]
+        self.classes = fields[26]
+        self._context = lib.SsbdModel_NewContext(self._model)
+        if not self._context:
+            raise MemoryError('no workspace for %s' % path)
+        self.workspace = lib.SsbdModel_Workspace(self._context)
+        self.isa = lib.SsbdModel_Isa().decode()
+
+    def predict(self, video, movenet=None):
+        """Class probabilities of a clip: video [n_frames, c, h, w] float,
+        as predict() takes it, or [n_frames, h, w, 3] uint8 frames from
+        video_chunks or chunk_cache; movenet [n_frames, movenet_dim]."""
+        video = np.asarray(video)
+        probs = np.zeros(self.classes, dtype=np.float32)
+        if movenet is not None:
+            movenet = np.ascontiguousarray(movenet, dtype=np.float32)
+            if movenet.shape != (self.frames, self.movenet_dim):
+                raise ValueError('movenet features of shape %s, not %s' % (movenet.shape,
+                                                                           (self.frames, self.movenet_dim)))
+        m = movenet.ctypes.data if movenet is not None else None
+        if video.dtype == np.uint8:
+            video = np.ascontiguousarray(video)
+            if video.shape != (self.frames, self.height, self.width, 3) or \
+                    self._lib.SsbdModel_PredictFrames(self._context, video.ctypes.data, m, probs.ctypes.data):
+                raise ValueError('frames of shape %s, not %s' % (video.shape, (self.frames, self.height, self.width, 3)))
+        else:
+            video = np.ascontiguousarray(video, dtype=np.float32)
+            if video.shape != (self.frames, self.channels, self.height, self.width):
+                raise ValueError('clip of shape %s, not %s' % (video.shape, (self.frames, self.channels, self.height,
+                                                                            self.width)))
+            self._lib.SsbdModel_Predict(self._context, video.ctypes.data, m, probs.ctypes.data)
+        return probs
+
+    def label(self, video, movenet=None):
+        """predict() of the notebook: "ASD" or "No_ASD"."""
+        return CLASSES[int(np.argmax(self.predict(video, movenet)))]
+
+    def close(self):
+        if self._context:
+            self._lib.SsbdModel_FreeContext(self._context)
+            self._context = None
+        if self._model:
+            self._lib.SsbdModel_Free(self._model)
+            self._model = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+
+def self_check(directory):
+    """Random models of awkward shapes, native against numpy."""
+    cases = [
+        {'channels': 3, 'frames': 8, 'height': 12, 'width': 10, 'conv_channels': (4, 5),
+         'conv_kernel': ((1, 3, 3), (3, 3, 1)), 'conv_stride': ((1, 2, 2), (2, 1, 1)), 'movenet_dim': 6,
+         'hidden': 7, 'layers': 2, 'heads': 2, 'fc': (9, 6), 'classes': 2},
+        {'channels': 3, 'frames': 10, 'height': 9, 'width': 11, 'conv_channels': (9, 17),
+         'conv_kernel': ((2, 2, 3), (2, 1, 2)), 'conv_stride': ((1, 1, 2), (3, 2, 1)), 'movenet_dim': 0,
+         'hidden': 12, 'layers': 1, 'heads': 1, 'fc': (5, 4), 'classes': 3},
+        dict(NOTEBOOK, conv_channels=(4, 4), hidden=16),
+    ]
+    rng = np.random.default_rng(7)
+    for n, dims in enumerate(cases):
+        state = random_state(dims, rng)
+        path = os.path.join(directory, 'check%d.ssbm' % n)
+        write(path, dims, state)
+        with Runtime(path) as runtime:
+            for _ in range(3):
+                video = rng.random((dims['frames'], dims['channels'], dims['height'], dims['width']), dtype=np.float32)
+                movenet = rng.random((dims['frames'], dims['movenet_dim']), dtype=np.float32) \
+                    if dims['movenet_dim'] else None
+                got = runtime.predict(video, movenet)
+                want = reference(dims, state, video, movenet)
+                if not np.allclose(got, want, rtol=1e-4, atol=1e-5):
+                    raise ValueError('model %d: %s, numpy %s' % (n, got, want))
+            frames = rng.integers(0, 256, (dims['frames'], dims['height'], dims['width'], 3), dtype=np.uint8)
+            if dims['channels'] == 3 and not np.array_equal(
+                    runtime.predict(frames, movenet),
+                    runtime.predict(np.transpose(frames, (0, 3, 1, 2)).astype(np.float32) / 255, movenet)):
+                raise ValueError('model %d: uint8 frames differ from the same clip as floats' % n)
+            isa = runtime.isa
+    print('%d random models (%s) match numpy' % (len(cases), isa))
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('--self-check', metavar='dir', help='compare random models with numpy, files in dir')
+    ap.add_argument('--random', metavar='model', help='write a random model of the notebook\'s shape')
+    ap.add_argument('--time', metavar='model', help='clips per second of a model, one thread')
+    args = ap.parse_args()
+
+    if args.self_check:
+        self_check(args.self_check)
+    if args.random:
+        write(args.random, NOTEBOOK, random_state(NOTEBOOK, np.random.default_rng(0)))
+        print('%s: %d bytes' % (args.random, os.path.getsize(args.random)))
+    if args.time:
+        with Runtime(args.time) as runtime:
+            video = np.random.default_rng(1).integers(0, 256, (runtime.frames, runtime.height, runtime.width, 3),
+                                                      dtype=np.uint8)
+            movenet = np.zeros((runtime.frames, runtime.movenet_dim), dtype=np.float32)
+            runtime.predict(video, movenet)
+            start = time.perf_counter()
+            n = 10
+            for _ in range(n):
+                runtime.predict(video, movenet)
+            print('%s: %.1f clips/s (%s), %d kB workspace' % (args.time, n / (time.perf_counter() - start),
+                                                               runtime.isa, runtime.workspace // 1024))
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except ValueError as e:
+        sys.exit(str(e))
@@ -0,0 +1,183 @@
+"""
+Overlapping chunks of resized frames of a video in constant memory, from
+the native chunker (native/video_chunk.c, built as
+native/build/libvideo_chunk.so by make).
+
+    with video_chunks.Chunker('session.mp4') as chunker:
+        for chunk in chunker:       # (n, 100, 100, 3) uint8, BGR
+            ...
+
+The chunks are those load_and_preprocess_video_chunk of
+preprocessing.ipynb makes: one frame in fps // 10 kept, 40 frames per
+chunk, a chunk starting every 20, the last ones shorter. Frames are read
+one at a time and those not kept are skipped undecoded; only a ring of 40
+resized frames is held. A chunk is a view of that ring, valid until the
+next one is taken: copy it (torch.tensor, np.array) to keep it.
+
+Videos are decoded by ffmpeg into a pipe; .ppm/.pgm streams and raw rgb24
+files (raw=(w, h)) are read directly, at the fps given.
+
+    python video_chunks.py [--fps fps] video    times the chunking
+"""
+import argparse
+import ctypes
+import json
+import os
+import resource
+import subprocess
+import sys
+import time
+
+import numpy as np
+
+LIB = os.environ.get('VIDEO_CHUNK_LIB', os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                    'native', 'build', 'libvideo_chunk.so'))
+CHUNK_SIZE = 40
+FPS = 10
+WIDTH = 100
+HEIGHT = 100
+
+
+class _Config(ctypes.Structure):
+    _fields_ = [('fd', ctypes.c_int), ('raw_width', ctypes.c_uint32), ('raw_height', ctypes.c_uint32),
+                ('step', ctypes.c_uint32), ('frames', ctypes.c_uint32), ('hop', ctypes.c_uint32),
+                ('width', ctypes.c_uint32), ('height', ctypes.c_uint32), ('bgr', ctypes.c_uint32),
+                ('partial', ctypes.c_uint32)]
+
+
+class _View(ctypes.Structure):
+    _fields_ = [('frames', ctypes.POINTER(ctypes.c_uint8)), ('count', ctypes.c_uint32),
+                ('index', ctypes.c_uint64), ('first', ctypes.c_uint64)]
+
+
+class _Stats(ctypes.Structure):
+    _fields_ = [('read', ctypes.c_uint64), ('sampled', ctypes.c_uint64), ('chunks', ctypes.c_uint64),
+                ('memory', ctypes.c_size_t)]
+
+
+_lib = None
+
+
+def _library():
+    global _lib
+    if _lib is None:
+        if not os.path.exists(LIB):
+            raise OSError('%s missing: run make in %s' % (LIB, os.path.dirname(os.path.dirname(LIB))))
+        _lib = ctypes.CDLL(LIB)
+        _lib.VideoChunk_Open.restype = ctypes.c_void_p
+        _lib.VideoChunk_Open.argtypes = [ctypes.POINTER(_Config)]
+        _lib.VideoChunk_Next.argtypes = [ctypes.c_void_p, ctypes.POINTER(_View)]
+        _lib.VideoChunk_Stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Stats)]
+        _lib.VideoChunk_Close.argtypes = [ctypes.c_void_p]
+        _lib.VideoChunk_Step.restype = ctypes.c_uint32
+        _lib.VideoChunk_Step.argtypes = [ctypes.c_double, ctypes.c_uint32]
+    return _lib
+
+
+def video_fps(path):
+    """Frame rate of a video as ffprobe reads it, cap.get(5) of OpenCV."""
+    out = subprocess.run(['ffprobe', '-v', 'error', '-select_streams', 'v:0', '-show_entries',
+                          'stream=avg_frame_rate', '-of', 'json', path],
+                         check=True, capture_output=True, text=True).stdout
+    num, _, den = json.loads(out)['streams'][0]['avg_frame_rate'].partition('/')
+    return float(num) / float(den or 1)
+
+
+class Chunker:
+    """Chunks of one video, taken in order."""
+
+    def __init__(self, source, fps=None, target_fps=FPS, frames=CHUNK_SIZE, hop=None, size=(WIDTH, HEIGHT),
+                 bgr=True, partial=True, raw=None):
+        lib = _library()
+        self._lib = lib
+        self._handle = None
+        self._process = None
+        self._file = None
+        self.frames = frames
+        self.size = size
+        direct = raw is not None or source.endswith(('.ppm', '.pgm', '.pnm'))
+        if fps is None:
+            if direct:
+                raise ValueError('%s: give the fps of a frame stream' % source)
+            fps = video_fps(source)
+        if direct:
+            self._file = open(source, 'rb')
+            fd = self._file.fileno()
+        else:
+            self._process = subprocess.Popen(['ffmpeg', '-v', 'error', '-i', source, '-f', 'image2pipe',
+                                              '-vcodec', 'ppm', '-'], stdout=subprocess.PIPE)
+            fd = self._process.stdout.fileno()
+        raw_width, raw_height = raw or (0, 0)
+        config = _Config(fd, raw_width, raw_height, lib.VideoChunk_Step(fps, target_fps), frames,
+                         hop or frames // 2, size[0], size[1], int(bgr), int(partial))
+        self.step = config.step
+        self._handle = lib.VideoChunk_Open(ctypes.byref(config))
+        if not self._handle:
+            self.close()
+            raise ValueError('%s: cannot chunk' % source)
+
+    def __iter__(self):
+        return self
+
+    def __next__(self):
+        view = _View()
+        status = self._lib.VideoChunk_Next(self._handle, ctypes.byref(view))
+        if status < 0:
+            raise ValueError('not a video of PPM/PGM or raw frames, or cut short')
+        if status == 0:
+            raise StopIteration
+        self.first = view.first
+        return np.ctypeslib.as_array(view.frames, shape=(view.count, self.size[1], self.size[0], 3))
+
+    def stats(self):
+        """Source frames read, frames sampled, chunks and bytes held."""
+        stats = _Stats()
+        self._lib.VideoChunk_Stats(self._handle, ctypes.byref(stats))
+        return {'read': stats.read, 'sampled': stats.sampled, 'chunks': stats.chunks, 'memory': stats.memory}
+
+    def close(self):
+        if self._handle:
+            self._lib.VideoChunk_Close(self._handle)
+            self._handle = None
+        if self._process:
+            self._process.stdout.close()
+            self._process.kill()
+            self._process.wait()
+            self._process = None
+        if self._file:
+            self._file.close()
+            self._file = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument('video')
+    ap.add_argument('--fps', type=float, default=None, help='of a frame stream; ffprobe reads it from videos')
+    ap.add_argument('--raw', default=None, help='raw rgb24 frames of WxH')
+    args = ap.parse_args()
+    raw = tuple(int(v) for v in args.raw.split('x')) if args.raw else None
+
+    start = time.perf_counter()
+    with Chunker(args.video, fps=args.fps, raw=raw) as chunker:
+        lengths = [len(chunk) for chunk in chunker]
+        stats = chunker.stats()
+    elapsed = time.perf_counter() - start
+    print('%s: %d frames, one in %d kept, %d chunks (%d full) in %.2f s, %.0f frames/s, %d kB held, peak RSS %d kB'
+          % (args.video, stats['read'], chunker.step, len(lengths), lengths.count(CHUNK_SIZE), elapsed,
+             stats['read'] / elapsed, stats['memory'] // 1024, resource.getrusage(resource.RUSAGE_SELF).ru_maxrss))
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except ValueError as e:
+        sys.exit(str(e))
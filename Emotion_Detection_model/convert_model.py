@@ -0,0 +1,260 @@
+"""
+Convert the Keras weights of emotion_2.py (model.h5) into the int8 blob read
+by Questionnair_Code_Stm32ide/srcs/emotion_net.c, so the emotion CNN can run
+on the STM32L475 or on a PC without TensorFlow.
+
+    python convert_model.py --weights model.h5 --calib fer2013.fer --out emotion_net.bin
+
+Only numpy, h5py and PIL are needed. The blob holds, per layer, int8
+weights quantized per output channel, int32 biases and the fixed-point
+requantization; activations are int8 with their scale taken from a float
+run of the model over calibration images: the test split of the packed
+fer2013.fer (fer_data.py), or data/test folders of PNGs. The converter
+then runs the same integer arithmetic as the C kernels and reports how
+often the int8 model agrees with the float one. --vectors writes images with the expected int8 logits, which
+build/nn_bench -m emotion_net.bin -v <file> replays bit for bit.
+
+On the board the blob is programmed into the QSPI flash at
+EMOTION_NET_QSPI_BASE (0x90500000 when memory-mapped), for instance with
+STM32CubeProgrammer and the board's external loader.
+"""
+import argparse
+import binascii
+import os
+import struct
+
+import numpy as np
+
+MAGIC = 0x314E4D45          # "EMN1"
+HEADER = struct.Struct('<IIHHfb3x')
+LAYER = struct.Struct('<HHbbbxIIII')
+CRC_FROM = 10               # after magic, size and crc
+
+INPUT_ZP = -128             # pixel - 128, scale 1/255
+
+# in_ch, out_ch of the layers with weights, in the order of emotion_2.py
+SHAPES = [(1, 32), (32, 64), (64, 128), (128, 128), (2048, 1024), (1024, 7)]
+CONVS = 4
+
+BATCH = 16                  # images per forward pass
+SAMPLE = 100000             # activation values kept per layer and batch
+
+
+def load_weights(path):
+    """[(kernel, bias)] of the layers with weights, in model order."""
+    import h5py
+    layers = []
+    with h5py.File(path, 'r') as f:
+        root = f['model_weights'] if 'model_weights' in f else f
+        if 'layer_names' in root.attrs:
+            # tf.keras HDF5 format, from model.save_weights('model.h5')
+            for name in root.attrs['layer_names']:
+                group = root[name.decode() if isinstance(name, bytes) else name]
+                names = [n.decode() if isinstance(n, bytes) else n for n in group.attrs['weight_names']]
+                if names:
+                    layers.append(tuple(np.asarray(group[n], dtype=np.float64) for n in names))
+        elif 'layers' in root:
+            # Keras 3 .weights.h5
+            for name in sorted(root['layers'].keys(), key=lambda n: (n.split('_')[0], len(n), n)):
+                group = root['layers'][name]
+                if 'vars' in group and len(group['vars']) > 0:
+                    layers.append(tuple(np.asarray(group['vars'][str(i)], dtype=np.float64)
+                                        for i in range(len(group['vars']))))
+    if len(layers) != len(SHAPES):
+        raise SystemExit('%s: expected %d layers with weights, found %d' % (path, len(SHAPES), len(layers)))
+    for i, ((kernel, bias), (cin, cout)) in enumerate(zip(layers, SHAPES)):
+        want = (3, 3, cin, cout) if i < CONVS else (cin, cout)
+        if kernel.shape != want or bias.shape != (cout,):
+            raise SystemExit('%s: layer %d is %s, expected %s' % (path, i, kernel.shape, want))
+    return layers
+
+
+def load_images(path, count):
+    """Up to count 48x48 uint8 faces from a packed file (its test split) or
+    a <class>/*.png tree, classes interleaved."""
+    if os.path.isfile(path):
+        import fer_data
+        images, labels = fer_data.open_packed(path).split('test')
+        rank = np.zeros(len(labels), dtype=np.int64)
+        for c in range(len(fer_data.CLASSES)):
+            rank[labels == c] = np.arange(np.count_nonzero(labels == c))
+        return images[np.lexsort((labels, rank))[:count]]
+    from PIL import Image
+    per_class = []
+    for name in sorted(os.listdir(path)):
+        folder = os.path.join(path, name)
+        if os.path.isdir(folder):
+            per_class.append(sorted(os.path.join(folder, f) for f in os.listdir(folder) if f.endswith('.png')))
+    files = []
+    for i in range(max((len(c) for c in per_class), default=0)):
+        files.extend(c[i] for c in per_class if i < len(c))
+    files = files[:count]
+    if not files:
+        raise SystemExit('%s: no images' % path)
+    return np.stack([np.asarray(Image.open(f).convert('L').resize((48, 48)), dtype=np.uint8) for f in files])
+
+
+def patches(x):
+    """(n, h, w, c) -> (n, h - 2, w - 2, 3, 3, c) views of the 3x3 patches."""
+    return np.lib.stride_tricks.sliding_window_view(x, (3, 3), axis=(1, 2)).transpose(0, 1, 2, 4, 5, 3)
+
+
+def pool(x):
+    n, h, w, c = x.shape
+    x = x[:, :h - h % 2, :w - w % 2]
+    return x.reshape(n, h // 2, 2, w // 2, 2, c).max(axis=(2, 4))
+
+
+def float_forward(layers, images):
+    """Activations after every layer with weights, and the logits."""
+    x = images[..., None].astype(np.float64) / 255.0
+    outs = []
+    for i, (kernel, bias) in enumerate(layers):
+        if i < CONVS:
+            cols = patches(x).reshape(x.shape[0], x.shape[1] - 2, x.shape[2] - 2, -1)
+            x = np.maximum(cols @ kernel.reshape(-1, kernel.shape[-1]) + bias, 0.0)
+            outs.append(x)
+            if i > 0:
+                x = pool(x)
+        else:
+            x = x.reshape(len(x), -1) @ kernel + bias
+            if i < len(layers) - 1:
+                x = np.maximum(x, 0.0)
+            outs.append(x)
+    return outs
+
+
+def calibrate(layers, images, percentile):
+    """Output ranges of the layers for quantize(), and the float logits.
+    A strided sample of every layer's outputs is enough for the ranges."""
+    samples = [[] for _ in layers]
+    scores = []
+    for i in range(0, len(images), BATCH):
+        outs = float_forward(layers, images[i:i + BATCH])
+        for sample, o in zip(samples, outs):
+            sample.append(o.ravel()[::max(1, o.size // SAMPLE)])
+        scores.append(outs[-1])
+    scores = np.concatenate(scores)
+    ranges = [float(np.percentile(np.concatenate(s), percentile)) for s in samples[:-1]]
+    ranges.append(float(np.abs(scores).max()))
+    return ranges, scores
+
+
+def quantize_multiplier(m):
+    """Real multiplier -> (Q31 mantissa in [2^30, 2^31), shift)."""
+    mant, exp = np.frexp(m)
+    q = np.round(mant * (1 << 31)).astype(np.int64)
+    exp = exp.astype(np.int64)
+    top = q == (1 << 31)
+    q[top] >>= 1
+    exp[top] += 1
+    if exp.min() < -31 or exp.max() > 30:
+        raise SystemExit('requantization multiplier out of range')
+    return q.astype(np.int32), exp.astype(np.int8)
+
+
+def quantize(layers, ranges):
+    """Quantized layers as dicts, and the logit scale and zero point."""
+    quant = []
+    in_scale, in_zp = 1.0 / 255.0, INPUT_ZP
+    for i, ((kernel, bias), top) in enumerate(zip(layers, ranges)):
+        last = i == len(layers) - 1
+        # [out][kh][kw][in] and [out][in], from Keras' [kh][kw][in][out] and [in][out]
+        w = np.moveaxis(kernel, -1, 0).reshape(kernel.shape[-1], -1)
+        w_scale = np.abs(w).max(axis=1) / 127.0
+        w_scale[w_scale == 0.0] = 1.0
+        wq = np.clip(np.round(w / w_scale[:, None]), -127, 127).astype(np.int8)
+        if last:
+            out_scale, out_zp, lo, hi = max(top, 1e-6) / 127.0, 0, -128, 127
+        else:
+            out_scale, out_zp, lo, hi = max(top, 1e-6) / 255.0, -128, -128, 127
+        bq = np.round(bias / (in_scale * w_scale)) - in_zp * wq.astype(np.int64).sum(axis=1)
+        mult, shift = quantize_multiplier(in_scale * w_scale / out_scale)
+        quant.append(dict(w=wq, b=bq.astype(np.int32), mult=mult, shift=shift,
+                          zp=out_zp, lo=lo, hi=hi, scale=out_scale))
+        in_scale, in_zp = out_scale, out_zp
+    return quant, quant[-1]['scale'], quant[-1]['zp']
+
+
+def requantize(acc, q):
+    shift = (31 - q['shift'].astype(np.int64))
+    v = (acc.astype(np.int64) * q['mult'].astype(np.int64) + (np.int64(1) << (shift - 1))) >> shift
+    return np.clip(v + q['zp'], q['lo'], q['hi']).astype(np.int8)
+
+
+def int8_forward(quant, images):
+    """The arithmetic of nn_kernels.c; returns the int8 logits.
+
+    The products are summed in float64, which is exact for these sizes
+    (below 2^36) and lets numpy use BLAS."""
+    x = images[..., None].astype(np.float64) + INPUT_ZP
+    for i, q in enumerate(quant):
+        w = q['w'].astype(np.float64)
+        if i < CONVS:
+            cols = patches(x).reshape(x.shape[0], x.shape[1] - 2, x.shape[2] - 2, -1)
+            x = requantize((cols @ w.T).astype(np.int64) + q['b'], q).astype(np.float64)
+            if i > 0:
+                x = pool(x)
+        else:
+            x = requantize((x.reshape(len(x), -1) @ w.T).astype(np.int64) + q['b'], q).astype(np.float64)
+    return x.astype(np.int8)
+
+
+def blob(quant, logit_scale, logit_zp):
+    records, data = [], bytearray()
+    base = HEADER.size + LAYER.size * len(quant)
+
+    def put(array):
+        while len(data) % 4:
+            data.append(0)
+        off = base + len(data)
+        data.extend(np.ascontiguousarray(array).astype(array.dtype.newbyteorder('<')).tobytes())
+        return off
+
+    for q in quant:
+        cout, k = q['w'].shape
+        cin = k // 9 if len(records) < CONVS else k
+        offs = [put(q['w']), put(q['b']), put(q['mult']), put(q['shift'])]
+        records.append(LAYER.pack(cin, cout, q['zp'], q['lo'], q['hi'], *offs))
+    body = b''.join(records) + bytes(data)
+    size = HEADER.size + len(body)
+    head = bytearray(HEADER.pack(MAGIC, size, 0, len(quant), logit_scale, logit_zp))
+    crc = binascii.crc_hqx(bytes(head[CRC_FROM:]) + body, 0xFFFF)
+    struct.pack_into('<H', head, 8, crc)
+    return bytes(head) + body
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument('--weights', default='model.h5', help='weights saved by emotion_2.py --mode train')
+    ap.add_argument('--calib', default='data/test', help='fer2013.fer, or <class>/*.png calibration images')
+    ap.add_argument('--count', type=int, default=500, help='calibration images to use')
+    ap.add_argument('--percentile', type=float, default=99.99, help='activation range, percent of values kept')
+    ap.add_argument('--out', default='emotion_net.bin')
+    ap.add_argument('--vectors', help='write <count> images and their expected int8 logits')
+    args = ap.parse_args()
+
+    layers = load_weights(args.weights)
+    images = load_images(args.calib, args.count)
+    ranges, scores = calibrate(layers, images, args.percentile)
+    quant, logit_scale, logit_zp = quantize(layers, ranges)
+
+    data = blob(quant, logit_scale, logit_zp)
+    with open(args.out, 'wb') as f:
+        f.write(data)
+
+    logits = np.concatenate([int8_forward(quant, images[i:i + BATCH]) for i in range(0, len(images), BATCH)])
+    agree = np.mean(np.argmax(logits, axis=1) == np.argmax(scores, axis=1))
+    for i, q in enumerate(quant):
+        print('layer %d  %5d x %-5d  out scale %.6g  zp %d' % (i, q['w'].shape[1], q['w'].shape[0], q['scale'], q['zp']))
+    print('%s: %d bytes, int8 and float agree on %.1f%% of %d images'
+          % (args.out, len(data), 100.0 * agree, len(images)))
+
+    if args.vectors:
+        with open(args.vectors, 'wb') as f:
+            for image, row in zip(images, logits):
+                f.write(image.tobytes() + row.tobytes())
+
+
+if __name__ == '__main__':
+    main()
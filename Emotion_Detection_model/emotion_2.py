@@ -9,12 +9,19 @@ from tensorflow.keras.optimizers import Adam
 from tensorflow.keras.layers import MaxPooling2D
 from tensorflow.keras.preprocessing.image import ImageDataGenerator
 import os
+import fer_loader
 os.environ['TF_CPP_MIN_LOG_LEVEL'] = '2'
 
 # command line argument
 ap = argparse.ArgumentParser()
 ap.add_argument("--mode",help="train/display")
-mode = ap.parse_args().mode
+ap.add_argument("--data",default="fer2013.fer",help="packed dataset from dataset_prepare_1.py")
+ap.add_argument("--source",default="0",help="display: camera index, video file or image sequence (img_%%03d.png)")
+ap.add_argument("--cascade",default="haarcascade_frontalface_default.xml",help="display: face detector")
+ap.add_argument("--detector",default="opencv",choices=["opencv","native"],help="display: run the cascade in OpenCV or in native/fer_detect.c")
+ap.add_argument("--size",default=None,help="display: window size as WxH, e.g. 1600x960; the frame size if not given")
+args = ap.parse_args()
+mode = args.mode
 
 # plots accuracy and loss curves
 def plot_model_history(model_history):
@@ -49,23 +56,33 @@ num_train = 28709
 num_val = 7178
 batch_size = 64
 num_epoch = 50
-
-train_datagen = ImageDataGenerator(rescale=1./255)
-val_datagen = ImageDataGenerator(rescale=1./255)
-
-train_generator = train_datagen.flow_from_directory(
-        train_dir,
-        target_size=(48,48),
-        batch_size=batch_size,
-        color_mode="grayscale",
-        class_mode='categorical')
-
-validation_generator = val_datagen.flow_from_directory(
-        val_dir,
-        target_size=(48,48),
-        batch_size=batch_size,
-        color_mode="grayscale",
-        class_mode='categorical')
+queue_size = 2
+
+if mode == "train" and os.path.exists(args.data):
+    # batches prefetched by the native loader from the memory-mapped packed
+    # file; Keras may queue queue_size of them, the loader keeps them valid
+    train_generator = fer_loader.Loader(args.data, 'train', batch_size, shuffle=True, hold=queue_size + 2)
+    validation_generator = fer_loader.Loader(args.data, 'test', batch_size, shuffle=False, drop_last=True,
+                                             hold=queue_size + 2)
+    num_train, num_val = train_generator.images, validation_generator.images
+elif mode == "train":
+    # PNG folders from dataset_prepare_1.py --png
+    train_datagen = ImageDataGenerator(rescale=1./255)
+    val_datagen = ImageDataGenerator(rescale=1./255)
+
+    train_generator = train_datagen.flow_from_directory(
+            train_dir,
+            target_size=(48,48),
+            batch_size=batch_size,
+            color_mode="grayscale",
+            class_mode='categorical')
+
+    validation_generator = val_datagen.flow_from_directory(
+            val_dir,
+            target_size=(48,48),
+            batch_size=batch_size,
+            color_mode="grayscale",
+            class_mode='categorical')
 
 # Create the model
 model = Sequential()
@@ -94,7 +111,8 @@ if mode == "train":
             steps_per_epoch=num_train // batch_size,
             epochs=num_epoch,
             validation_data=validation_generator,
-            validation_steps=num_val // batch_size)
+            validation_steps=num_val // batch_size,
+            max_queue_size=queue_size)
     plot_model_history(model_info)
     model.save_weights('model.h5')
 
@@ -108,26 +126,38 @@ elif mode == "display":
     # dictionary which assigns each label an emotion (alphabetical order)
     emotion_dict = {0: "Angry", 1: "Disgusted", 2: "Fearful", 3: "Happy", 4: "Neutral", 5: "Sad", 6: "Surprised"}
 
-    # start the webcam feed
-    cap = cv2.imread("im.png", cv2.IMREAD_COLOR)
+    # the face detector is loaded once, not per frame
+    if args.detector == "native":
+        import fer_detect
+        facecasc = fer_detect.Detector(args.cascade)
+        detect = lambda gray: facecasc.detect(gray, scale_factor=1.3, min_neighbors=5)
+    else:
+        facecasc = cv2.CascadeClassifier(args.cascade)
+        if facecasc.empty():
+            raise SystemExit('%s: cannot load the face detector' % args.cascade)
+        detect = lambda gray: facecasc.detectMultiScale(gray,scaleFactor=1.3, minNeighbors=5)
+    size = tuple(int(v) for v in args.size.split('x')) if args.size else None
+
+    # the webcam feed, or a video file or image sequence to test without one
+    # (native/build/fer_stream runs the same on a pipeline of threads)
+    cap = cv2.VideoCapture(int(args.source) if args.source.isdigit() else args.source)
     while True:
-        # Find haar cascade to draw bounding box around face
         ret, frame = cap.read()
         if not ret:
             break
-        facecasc = cv2.CascadeClassifier('haarcascade_frontalface_default.xml')
         gray = cv2.cvtColor(frame, cv2.COLOR_BGR2GRAY)
-        faces = facecasc.detectMultiScale(gray,scaleFactor=1.3, minNeighbors=5)
-
-        for (x, y, w, h) in faces:
-            cv2.rectangle(frame, (x, y-50), (x+w, y+h+10), (255, 0, 0), 2)
-            roi_gray = gray[y:y + h, x:x + w]
-            cropped_img = np.expand_dims(np.expand_dims(cv2.resize(roi_gray, (48, 48)), -1), 0)
-            prediction = model.predict(cropped_img)
-            maxindex = int(np.argmax(prediction))
-            cv2.putText(frame, emotion_dict[maxindex], (x+20, y-60), cv2.FONT_HERSHEY_SIMPLEX, 1, (255, 255, 255), 2, cv2.LINE_AA)
-
-        cv2.imshow('Video', cv2.resize(frame,(1600,960),interpolation = cv2.INTER_CUBIC))
+        faces = detect(gray)
+
+        # every face of the frame in one batch
+        if len(faces):
+            crops = np.stack([cv2.resize(gray[y:y + h, x:x + w], (48, 48)) for (x, y, w, h) in faces])
+            predictions = model.predict(np.expand_dims(crops, -1), batch_size=len(faces))
+            for (x, y, w, h), prediction in zip(faces, predictions):
+                maxindex = int(np.argmax(prediction))
+                cv2.rectangle(frame, (x, y-50), (x+w, y+h+10), (255, 0, 0), 2)
+                cv2.putText(frame, emotion_dict[maxindex], (x+20, y-60), cv2.FONT_HERSHEY_SIMPLEX, 1, (255, 255, 255), 2, cv2.LINE_AA)
+
+        cv2.imshow('Video', cv2.resize(frame,size,interpolation = cv2.INTER_CUBIC) if size else frame)
         if cv2.waitKey(1) & 0xFF == ord('q'):
             break
 
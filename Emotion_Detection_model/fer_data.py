@@ -0,0 +1,62 @@
+"""
+Zero-copy access to the packed FER2013 file written by native/fer_pack
+(layout in native/fer_pack.h).
+
+    cd native && make && ./build/fer_pack -o ../fer2013.fer ../fer2013.csv
+
+    data = fer_data.open_packed('fer2013.fer')
+    images, labels = data.split('train')        # uint8 (n, 48, 48), (n,)
+
+The arrays are views of one read-only memory map: nothing is decoded or
+copied until a batch is taken from them. Labels are in the order of the
+model (Angry, Disgusted, Fearful, Happy, Neutral, Sad, Surprised), like
+the folders dataset_prepare_1.py writes.
+"""
+import struct
+
+import numpy as np
+
+MAGIC = 0x31524546          # "FER1"
+HEADER = struct.Struct('<IIIHHQQQQ3I3I21I4x')
+CLASSES = ('angry', 'disgusted', 'fearful', 'happy', 'neutral', 'sad', 'surprised')
+USAGES = ('Training', 'PublicTest', 'PrivateTest')
+
+# emotion_2.py validates on every image that is not for training
+SPLITS = {'train': (0,), 'test': (1, 2), 'public': (1,), 'private': (2,)}
+
+
+class Packed:
+    """A packed dataset file, mapped read-only."""
+
+    def __init__(self, path):
+        self.path = path
+        self.map = np.memmap(path, dtype=np.uint8, mode='r')
+        if len(self.map) < HEADER.size:
+            raise ValueError('%s: not a packed FER2013 file' % path)
+        fields = HEADER.unpack_from(self.map[:HEADER.size].tobytes())
+        magic, header_bytes, count, height, width, labels, usage, pixels, size = fields[:9]
+        if magic != MAGIC or header_bytes != HEADER.size or size != len(self.map) \
+                or pixels + count * height * width != size:
+            raise ValueError('%s: not a packed FER2013 file' % path)
+        self.first = fields[9:12]
+        self.counts = fields[12:15]
+        self.per_class = np.array(fields[15:36], dtype=np.int64).reshape(len(USAGES), len(CLASSES))
+        self.images = self.map[pixels:size].reshape(count, height, width)
+        self.labels = self.map[labels:labels + count]
+        self.usage = self.map[usage:usage + count]
+
+    def __len__(self):
+        return len(self.labels)
+
+    def split(self, name):
+        """(images, labels) of 'train', 'test' (public + private), 'public'
+        or 'private'; the usage groups are stored in that order, so every
+        split is a slice of the map."""
+        groups = SPLITS[name]
+        start = self.first[groups[0]]
+        stop = self.first[groups[-1]] + self.counts[groups[-1]]
+        return self.images[start:stop], self.labels[start:stop]
+
+
+def open_packed(path):
+    return Packed(path)
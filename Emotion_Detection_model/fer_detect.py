@@ -0,0 +1,150 @@
+"""
+Haar cascade face detection without OpenCV, from the native detector
+(native/fer_detect.c, built as native/build/libfer_detect.so by make).
+
+    detector = fer_detect.Detector('haarcascade_frontalface_default.xml')
+    faces = detector.detect(gray, scale_factor=1.3, min_neighbors=5)
+
+gray is a 2-D uint8 array; faces is (n, 4) of x, y, w, h, as
+cv2.CascadeClassifier.detectMultiScale gives them. The cascade is read
+once and each call shares the frame between the detector's threads.
+
+    python fer_detect.py cascade.xml image...    faces of PGM/PNG/JPEG
+                                                 images, their timing and
+                                                 where the stages reject
+"""
+import ctypes
+import os
+import sys
+import time
+
+import numpy as np
+
+LIB = os.environ.get('FER_DETECT_LIB', os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                   'native', 'build', 'libfer_detect.so'))
+STAGES_MAX = 64
+FACES_MAX = 256
+
+
+class _Rect(ctypes.Structure):
+    _fields_ = [('x', ctypes.c_int32), ('y', ctypes.c_int32), ('width', ctypes.c_int32),
+                ('height', ctypes.c_int32)]
+
+
+class _Params(ctypes.Structure):
+    _fields_ = [('scale_factor', ctypes.c_float), ('min_neighbors', ctypes.c_uint32),
+                ('min_size', ctypes.c_uint32), ('max_size', ctypes.c_uint32)]
+
+
+class _Stats(ctypes.Structure):
+    _fields_ = [('frames', ctypes.c_uint64), ('windows', ctypes.c_uint64), ('weak', ctypes.c_uint64),
+                ('passed', ctypes.c_uint64), ('faces', ctypes.c_uint64), ('stages', ctypes.c_uint32),
+                ('rejected', ctypes.c_uint64 * STAGES_MAX)]
+
+
+_lib = None
+
+
+def _library():
+    global _lib
+    if _lib is None:
+        if not os.path.exists(LIB):
+            raise OSError('%s missing: run make in %s' % (LIB, os.path.dirname(os.path.dirname(LIB))))
+        _lib = ctypes.CDLL(LIB)
+        _lib.FerDetect_Load.restype = ctypes.c_void_p
+        _lib.FerDetect_Load.argtypes = [ctypes.c_char_p]
+        _lib.FerDetect_Free.argtypes = [ctypes.c_void_p]
+        _lib.FerDetect_WorkNew.restype = ctypes.c_void_p
+        _lib.FerDetect_WorkNew.argtypes = [ctypes.c_uint32]
+        _lib.FerDetect_WorkFree.argtypes = [ctypes.c_void_p]
+        _lib.FerDetect_Run.restype = ctypes.c_int
+        _lib.FerDetect_Run.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Params), ctypes.c_void_p,
+                                       ctypes.c_uint32, ctypes.c_uint32, ctypes.c_uint32, ctypes.c_void_p,
+                                       ctypes.POINTER(_Rect), ctypes.c_uint32]
+        _lib.FerDetect_Stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Stats)]
+        _lib.FerDetect_StatsReset.argtypes = [ctypes.c_void_p]
+        _lib.FerDetect_Isa.restype = ctypes.c_char_p
+    return _lib
+
+
+class Detector:
+    """detectMultiScale of one cascade, on threads of its own."""
+
+    def __init__(self, cascade, threads=None):
+        lib = _library()
+        self._lib = lib
+        self._work = None
+        self._cascade = lib.FerDetect_Load(os.fsencode(cascade))
+        if not self._cascade:
+            raise ValueError('%s: cannot load the face detector' % cascade)
+        self._work = lib.FerDetect_WorkNew(threads or os.cpu_count() or 1)
+        if not self._work:
+            raise RuntimeError('cannot start the detector threads')
+        self._faces = (_Rect * FACES_MAX)()
+
+    def detect(self, gray, scale_factor=1.3, min_neighbors=5, min_size=0, max_size=0):
+        """(n, 4) int32 faces of a 2-D uint8 frame."""
+        gray = np.asarray(gray)
+        if gray.dtype != np.uint8 or gray.ndim != 2 or gray.strides[1] != 1:
+            gray = np.ascontiguousarray(gray, dtype=np.uint8)
+        params = _Params(scale_factor, min_neighbors, min_size, max_size)
+        n = self._lib.FerDetect_Run(self._cascade, ctypes.byref(params), gray.ctypes.data, gray.shape[1],
+                                    gray.shape[0], gray.strides[0], self._work, self._faces, FACES_MAX)
+        if n < 0:
+            raise MemoryError('the detector could not grow its work area')
+        return np.ctypeslib.as_array(self._faces)[:n].view(np.int32).reshape(n, 4).copy()
+
+    def stats(self, reset=False):
+        """Frames, windows, weak classifiers and windows rejected per stage
+        since the last reset."""
+        stats = _Stats()
+        self._lib.FerDetect_Stats(self._work, ctypes.byref(stats))
+        if reset:
+            self._lib.FerDetect_StatsReset(self._work)
+        return {'frames': stats.frames, 'windows': stats.windows, 'weak': stats.weak, 'passed': stats.passed,
+                'faces': stats.faces, 'rejected': list(stats.rejected[:stats.stages])}
+
+    def close(self):
+        if self._work:
+            self._lib.FerDetect_WorkFree(self._work)
+            self._work = None
+        if self._cascade:
+            self._lib.FerDetect_Free(self._cascade)
+            self._cascade = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+
+def main(cascade, paths):
+    from PIL import Image
+
+    with Detector(cascade) as detector:
+        elapsed = 0.0
+        for path in paths:
+            gray = np.asarray(Image.open(path).convert('L'))
+            start = time.perf_counter()
+            faces = detector.detect(gray)
+            elapsed += time.perf_counter() - start
+            print('%s: %d faces %s' % (path, len(faces), ' '.join('%d,%d,%dx%d' % tuple(f) for f in faces)))
+        stats = detector.stats()
+        print('%.2f ms/frame (%s), %.0f windows/frame, %.2f weak/window'
+              % (1e3 * elapsed / max(len(paths), 1), _library().FerDetect_Isa().decode(),
+                 stats['windows'] / max(stats['frames'], 1), stats['weak'] / max(stats['windows'], 1)))
+        left = stats['windows']
+        for stage, rejected in enumerate(stats['rejected']):
+            if left:
+                print('stage %2d rejects %6.2f%% of the windows reaching it' % (stage, 100.0 * rejected / left))
+                left -= rejected
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        raise SystemExit('usage: fer_detect.py cascade.xml image...')
+    main(sys.argv[1], sys.argv[2:])
@@ -0,0 +1,154 @@
+"""
+Training batches of the packed FER2013 file from the native loader
+(native/fer_loader.c, built as native/build/libfer_loader.so by make).
+
+    loader = fer_loader.Loader('fer2013.fer', 'train', batch_size=64)
+    for x, y in loader:         # endless, a new shuffle every epoch
+        ...
+
+Worker threads gather the images of the next batches straight from the
+memory-mapped file and scale them to float32 while the model trains; x is
+(n, 48, 48, 1) and y one-hot (n, 7), as flow_from_directory gives them.
+The arrays are views of the loader's batch buffers, not copies: a batch
+stays valid until `hold` more batches have been taken, so whoever queues
+batches (Keras' max_queue_size) must hold fewer than that.
+
+    python fer_loader.py fer2013.fer    checks the batches against
+                                        fer_data.py and times them
+"""
+import ctypes
+import os
+import sys
+import time
+
+import numpy as np
+
+import fer_data
+
+LIB = os.environ.get('FER_LOADER_LIB', os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                   'native', 'build', 'libfer_loader.so'))
+PIXELS = 48 * 48
+CLASSES = len(fer_data.CLASSES)
+
+
+class _Config(ctypes.Structure):
+    _fields_ = [('path', ctypes.c_char_p), ('usages', ctypes.c_uint32), ('batch', ctypes.c_uint32),
+                ('workers', ctypes.c_uint32), ('slots', ctypes.c_uint32), ('shuffle', ctypes.c_uint32),
+                ('drop_last', ctypes.c_uint32), ('seed', ctypes.c_uint64), ('scale', ctypes.c_float),
+                ('offset', ctypes.c_float)]
+
+
+class _Batch(ctypes.Structure):
+    _fields_ = [('slot', ctypes.c_uint32), ('count', ctypes.c_uint32), ('index', ctypes.c_uint64),
+                ('epoch', ctypes.c_uint32), ('x', ctypes.POINTER(ctypes.c_float)),
+                ('y', ctypes.POINTER(ctypes.c_float)), ('labels', ctypes.POINTER(ctypes.c_uint8))]
+
+
+_lib = None
+
+
+def _library():
+    global _lib
+    if _lib is None:
+        if not os.path.exists(LIB):
+            raise OSError('%s missing: run make in %s' % (LIB, os.path.dirname(os.path.dirname(LIB))))
+        _lib = ctypes.CDLL(LIB)
+        _lib.FerLoader_Open.restype = ctypes.c_void_p
+        _lib.FerLoader_Open.argtypes = [ctypes.POINTER(_Config)]
+        for name in ('FerLoader_Images', 'FerLoader_BatchesPerEpoch'):
+            getattr(_lib, name).restype = ctypes.c_uint32
+            getattr(_lib, name).argtypes = [ctypes.c_void_p]
+        _lib.FerLoader_Next.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Batch)]
+        _lib.FerLoader_Release.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+        _lib.FerLoader_Close.argtypes = [ctypes.c_void_p]
+        _lib.FerLoader_Image.restype = ctypes.c_uint32
+        _lib.FerLoader_Image.argtypes = [ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint32]
+        _lib.FerLoader_Isa.restype = ctypes.c_char_p
+    return _lib
+
+
+class Loader:
+    """Batches of one split ('train', 'test', 'public' or 'private')."""
+
+    def __init__(self, path, split='train', batch_size=64, shuffle=True, drop_last=None, seed=0,
+                 workers=None, prefetch=8, hold=2, scale=1.0 / 255.0, offset=0.0):
+        lib = _library()
+        usages = sum(1 << u for u in fer_data.SPLITS[split])
+        config = _Config(os.fsencode(path), usages, batch_size, workers or os.cpu_count() or 1,
+                         prefetch + hold, int(shuffle), int(shuffle if drop_last is None else drop_last),
+                         seed, scale, offset)
+        self.hold = hold
+        self._lib = lib
+        self._held = []
+        self._handle = lib.FerLoader_Open(ctypes.byref(config))
+        if not self._handle:
+            raise ValueError('%s: cannot load the %s split' % (path, split))
+        self.images = lib.FerLoader_Images(self._handle)
+        self.batches_per_epoch = lib.FerLoader_BatchesPerEpoch(self._handle)
+
+    def __iter__(self):
+        return self
+
+    def __next__(self):
+        x, y, _ = self.next_batch()
+        return x, y
+
+    def next_batch(self):
+        """(x, y, labels) of the next batch."""
+        batch = _Batch()
+        while len(self._held) >= self.hold:
+            self._lib.FerLoader_Release(self._handle, self._held.pop(0))
+        if self._lib.FerLoader_Next(self._handle, ctypes.byref(batch)) != 0:
+            raise RuntimeError('every batch buffer is held')
+        self._held.append(batch.slot)
+        self.epoch = batch.epoch
+        n = batch.count
+        return (np.ctypeslib.as_array(batch.x, shape=(n, 48, 48, 1)),
+                np.ctypeslib.as_array(batch.y, shape=(n, CLASSES)),
+                np.ctypeslib.as_array(batch.labels, shape=(n,)))
+
+    def image(self, epoch, position):
+        """Index in the split of the image at a position of an epoch."""
+        return self._lib.FerLoader_Image(self._handle, epoch, position)
+
+    def close(self):
+        if self._handle:
+            self._lib.FerLoader_Close(self._handle)
+            self._handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+
+def main(path):
+    data = fer_data.open_packed(path)
+    images, labels = data.split('train')
+    scale = np.float32(1.0 / 255.0)
+    with Loader(path, 'train', batch_size=64, seed=7) as loader:
+        for epoch in range(2):
+            position = 0
+            for _ in range(loader.batches_per_epoch):
+                x, y, got = loader.next_batch()
+                index = [loader.image(epoch, position + i) for i in range(len(got))]
+                if not (np.array_equal(x[..., 0], images[index].astype(np.float32) * scale)
+                        and np.array_equal(got, labels[index]) and np.array_equal(y.argmax(axis=1), got)):
+                    raise SystemExit('epoch %d: batch at %d differs from fer_data' % (epoch, position))
+                position += len(got)
+        print('%s: %d batches of %d images match fer_data (%s)'
+              % (path, 2 * loader.batches_per_epoch, len(got), _library().FerLoader_Isa().decode()))
+
+        steps = 4 * loader.batches_per_epoch
+        start = time.perf_counter()
+        for _ in range(steps):
+            x, y = next(loader)
+        print('%.0f batches/s through Python' % (steps / (time.perf_counter() - start)))
+
+
+if __name__ == '__main__':
+    main(sys.argv[1] if len(sys.argv) > 1 else 'fer2013.fer')
@@ -0,0 +1,1361 @@
+/**
+  ******************************************************************************
+  * @file           : fer_detect.c
+  * @brief          : Haar cascade face detector, OpenCV's detectMultiScale
+  *                   without OpenCV.
+  *
+  *                   FerDetect_Load() reads a cascade in the XML format of
+  *                   opencv_traincascade (BOOST stages of HAAR stumps, as
+  *                   haarcascade_frontalface_default.xml) once; the
+  *                   cascade is then read-only and may be shared.
+  *
+  *                   FerDetect_Run() follows cv::CascadeClassifier:
+  *                     - the frame is shrunk by scale_factor^k with
+  *                       bilinear resizing until it is smaller than the
+  *                       cascade window, and windows outside
+  *                       [min_size, max_size] are skipped
+  *                     - on each scale the 24x24 window slides by 2 pixels
+  *                       (by 1 once the frame is shrunk more than twice)
+  *                       over the integral image; its features are scaled
+  *                       by 1 / (area * stddev) of the window inside a one
+  *                       pixel border, and the stages reject it as soon as
+  *                       their sum falls below their threshold
+  *                     - the hits are grouped as by cv::groupRectangles:
+  *                       clusters of similar rectangles (eps 0.2) are
+  *                       averaged, those with min_neighbors hits or fewer
+  *                       dropped, and so are faces inside a stronger one.
+  *
+  *                   As OpenCV, every scale is laid out on one canvas with
+  *                   the row stride of the frame, so the corners of every
+  *                   rectangle of every weak classifier are bound once to
+  *                   offsets valid on all scales. The bound cascade is
+  *                   kept as arrays per field in stage order: the first
+  *                   stages, which end most windows, stay in L1.
+  *
+  *                   The integral and squared integral images are 32-bit:
+  *                   a window sum is exact modulo 2^32, and no window sum
+  *                   comes near it. Their rows are prefix-summed 8 pixels
+  *                   at a time with SSE2, and 4 neighbouring windows go
+  *                   through the stages together, until all of them are
+  *                   rejected; FER_DETECT_GENERIC builds the plain C one
+  *                   window at a time, with the same results.
+  *
+  *                   The threads of the work area share each run: first
+  *                   the scales, each resized and integrated by one, then
+  *                   bands of window rows of every scale, each thread
+  *                   keeping its hits per band so that they are merged in
+  *                   the same order whatever the number of threads.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "fer_detect.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__) && !defined(FER_DETECT_GENERIC)
+#include <emmintrin.h>
+#define FER_DETECT_SSE2
+#endif
+
+/* Private define ------------------------------------------------------------*/
+#define DETECT_RECTS        3U          /* per feature                     */
+#define DETECT_EPS          0.2         /* groupRectangles                 */
+#define DETECT_STAGE_EPS    1e-5f       /* OpenCV's THRESHOLD_EPS          */
+#define DETECT_RESIZE_BITS  11U         /* bilinear weights, as OpenCV     */
+#define DETECT_RESIZE_ONE   (1 << DETECT_RESIZE_BITS)
+#define DETECT_BAND         8U          /* window rows per task            */
+#define DETECT_LANES        4U          /* windows evaluated together      */
+#define DETECT_PAD          16U         /* cells read past the canvas by
+                                           the last, partial group         */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t first;           /* weak classifier                             */
+  uint32_t count;
+  float threshold;
+} Detect_StageTypeDef;
+
+typedef struct
+{
+  uint32_t rects;
+  struct
+  {
+    uint8_t x;
+    uint8_t y;
+    uint8_t width;
+    uint8_t height;
+    float weight;
+  } rect[DETECT_RECTS];
+} Detect_FeatureTypeDef;
+
+struct FerDetect_Cascade
+{
+  uint32_t width;           /* of the window                               */
+  uint32_t height;
+  uint32_t stages;
+  uint32_t stumps;
+  uint32_t features;
+  Detect_StageTypeDef *stage;
+  /* weak classifiers in stage order */
+  uint32_t *feature;
+  float *threshold;
+  float *left;              /* added when the feature is below threshold   */
+  float *right;
+  Detect_FeatureTypeDef *geometry;
+};
+
+/* The cascade on a row stride */
+typedef struct
+{
+  const FerDetect_CascadeTypeDef *cascade;
+  uint32_t stride;          /* 0 before the first run                      */
+  uint32_t stumps_max;
+  int32_t *corner;          /* [stump][rect]: top left, top right, bottom
+                               left, bottom right                          */
+  float *weight;            /* [stump][rect]                               */
+  uint8_t *rects;           /* [stump]                                     */
+  int32_t norm[4];          /* corners inside the one pixel border         */
+  double area;              /* inside the border                           */
+} Detect_BoundTypeDef;
+
+typedef struct
+{
+  double factor;
+  uint32_t width;           /* of the shrunk frame                         */
+  uint32_t height;
+  uint32_t xs;              /* window positions below xs, ys               */
+  uint32_t ys;
+  uint32_t step;
+  int32_t window_width;     /* in the frame                                */
+  int32_t window_height;
+  size_t base;              /* integral cell (0, 0) on the canvas          */
+} Detect_ScaleTypeDef;
+
+typedef struct
+{
+  uint32_t scale;
+  uint32_t y0;              /* window rows [y0, y1) of the scale           */
+  uint32_t y1;
+  uint32_t thread;          /* that scanned it, and where its hits are     */
+  uint32_t first;
+  uint32_t count;
+} Detect_TaskTypeDef;
+
+typedef struct
+{
+  FerDetect_WorkTypeDef *work;
+  uint32_t id;
+  pthread_t thread;
+  int failed;
+  uint8_t *row;             /* one shrunk row                              */
+  int32_t *x0;              /* bilinear source column and weight           */
+  int32_t *xw;
+  uint32_t row_max;
+  FerDetect_RectTypeDef *hits;
+  uint32_t count;
+  uint32_t hits_max;
+  uint64_t windows;
+  uint64_t weak;
+  uint64_t passed;
+  uint64_t rejected[FER_DETECT_STAGES_MAX];
+} Detect_ThreadTypeDef;
+
+struct FerDetect_Work
+{
+  uint32_t threads;
+  Detect_ThreadTypeDef thread[FER_DETECT_THREADS_MAX];
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  uint32_t generation;      /* of the job                                  */
+  uint32_t busy;            /* helpers still on it                         */
+  uint32_t stop;
+  void (*job)(Detect_ThreadTypeDef *t);
+  atomic_uint next;         /* scale or task to take                       */
+
+  /* the run */
+  const FerDetect_CascadeTypeDef *cascade;
+  const uint8_t *gray;
+  uint32_t width;
+  uint32_t height;
+  uint32_t gray_stride;
+  Detect_ScaleTypeDef *scale;
+  uint32_t scales;
+  uint32_t scales_max;
+  Detect_TaskTypeDef *task;
+  uint32_t tasks;
+  uint32_t tasks_max;
+  uint32_t *sum;            /* integral images of every scale              */
+  uint32_t *sqsum;
+  size_t cells;
+  Detect_BoundTypeDef bound;
+
+  /* the hits of every band, merged, and their grouping */
+  FerDetect_RectTypeDef *hits;
+  uint32_t *label;          /* cluster of each hit                         */
+  int32_t *group;           /* x, y, width, height, hits per cluster       */
+  uint32_t hits_max;
+  uint32_t count;
+
+  FerDetect_StatsTypeDef stats;
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static char *Detect_ReadFile(const char *path);
+static const char *Detect_Tag(const char *p, const char *tag, const char *limit);
+static int Detect_Numbers(const char **p, double *out, uint32_t n);
+static int Detect_Parse(FerDetect_CascadeTypeDef *c, const char *xml);
+static int Detect_Plan(FerDetect_WorkTypeDef *work, const FerDetect_ParamsTypeDef *params);
+static int Detect_Bind(FerDetect_WorkTypeDef *work);
+static void *Detect_Helper(void *arg);
+static void Detect_Parallel(FerDetect_WorkTypeDef *work, void (*job)(Detect_ThreadTypeDef *t));
+static void Detect_Prepare(Detect_ThreadTypeDef *t);
+static void Detect_Scan(Detect_ThreadTypeDef *t);
+static void Detect_Coefficient(float scale, uint32_t i, uint32_t src_len, int32_t *i0, int32_t *weight);
+static void Detect_IntegralRow(const uint8_t *row, uint32_t width, const uint32_t *sum_up, const uint32_t *sqsum_up,
+                               uint32_t *sum, uint32_t *sqsum);
+static float Detect_Norm(const Detect_BoundTypeDef *b, const uint32_t *sum, const uint32_t *sqsum);
+static uint32_t Detect_Windows(const FerDetect_CascadeTypeDef *c, const Detect_BoundTypeDef *b, const uint32_t *sum,
+                               const uint32_t *sqsum, uint32_t step, uint32_t lanes, Detect_ThreadTypeDef *t);
+static int Detect_Hit(FerDetect_RectTypeDef **hits, uint32_t *count, uint32_t *max, FerDetect_RectTypeDef r);
+static int Detect_Merge(FerDetect_WorkTypeDef *work);
+static uint32_t Detect_Group(FerDetect_WorkTypeDef *work, uint32_t min_neighbors, FerDetect_RectTypeDef *faces,
+                             uint32_t max_faces);
+static int Detect_Similar(const FerDetect_RectTypeDef *a, const FerDetect_RectTypeDef *b);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  Read a cascade XML file.
+  * @param  path: cascade written by opencv_traincascade
+  * @retval Cascade, NULL if unreadable or not of BOOST HAAR stumps
+  */
+FerDetect_CascadeTypeDef *FerDetect_Load(const char *path)
+{
+  FerDetect_CascadeTypeDef *c = calloc(1U, sizeof(*c));
+  char *xml = Detect_ReadFile(path);
+
+  if ((c == NULL) || (xml == NULL) || (Detect_Parse(c, xml) != 0))
+  {
+    fprintf(stderr, "%s: not a HAAR cascade of stumps\n", path);
+    FerDetect_Free(c);
+    c = NULL;
+  }
+  free(xml);
+  return c;
+}
+
+void FerDetect_Free(FerDetect_CascadeTypeDef *cascade)
+{
+  if (cascade != NULL)
+  {
+    free(cascade->stage);
+    free(cascade->feature);
+    free(cascade->threshold);
+    free(cascade->left);
+    free(cascade->right);
+    free(cascade->geometry);
+    free(cascade);
+  }
+}
+
+/**
+  * @brief  Side of the cascade window, the smallest face it finds.
+  */
+uint32_t FerDetect_WindowSize(const FerDetect_CascadeTypeDef *cascade)
+{
+  return cascade->width;
+}
+
+/**
+  * @brief  Work area for a run at a time.
+  * @param  threads: sharing each run, the caller's included
+  * @retval Work area, NULL if a thread could not start
+  */
+FerDetect_WorkTypeDef *FerDetect_WorkNew(uint32_t threads)
+{
+  FerDetect_WorkTypeDef *work = calloc(1U, sizeof(*work));
+
+  if (work == NULL)
+  {
+    return NULL;
+  }
+  work->threads = (threads == 0U) ? 1U : ((threads > FER_DETECT_THREADS_MAX) ? FER_DETECT_THREADS_MAX : threads);
+  pthread_mutex_init(&work->lock, NULL);
+  pthread_cond_init(&work->wake, NULL);
+  pthread_cond_init(&work->done, NULL);
+  atomic_init(&work->next, 0U);
+  for (uint32_t i = 0U; i < work->threads; i++)
+  {
+    work->thread[i].work = work;
+    work->thread[i].id = i;
+    if ((i > 0U) && (pthread_create(&work->thread[i].thread, NULL, Detect_Helper, &work->thread[i]) != 0))
+    {
+      work->threads = i;
+      FerDetect_WorkFree(work);
+      return NULL;
+    }
+  }
+  return work;
+}
+
+void FerDetect_WorkFree(FerDetect_WorkTypeDef *work)
+{
+  if (work == NULL)
+  {
+    return;
+  }
+  pthread_mutex_lock(&work->lock);
+  work->stop = 1U;
+  pthread_cond_broadcast(&work->wake);
+  pthread_mutex_unlock(&work->lock);
+  for (uint32_t i = 0U; i < work->threads; i++)
+  {
+    Detect_ThreadTypeDef *t = &work->thread[i];
+
+    if (i > 0U)
+    {
+      (void)pthread_join(t->thread, NULL);
+    }
+    free(t->row);
+    free(t->x0);
+    free(t->xw);
+    free(t->hits);
+  }
+  pthread_mutex_destroy(&work->lock);
+  pthread_cond_destroy(&work->wake);
+  pthread_cond_destroy(&work->done);
+  free(work->scale);
+  free(work->task);
+  free(work->sum);
+  free(work->sqsum);
+  free(work->bound.corner);
+  free(work->bound.weight);
+  free(work->bound.rects);
+  free(work->hits);
+  free(work->label);
+  free(work->group);
+  free(work);
+}
+
+/**
+  * @brief  Bilinear resize with pixel centres aligned, as cv::resize
+  *         INTER_LINEAR: 11-bit weights, source clamped at the edges.
+  * @param  src: top left pixel, rows src_stride bytes apart
+  * @param  dst: dst_width x dst_height, packed
+  */
+void FerDetect_Resize(const uint8_t *src, uint32_t src_width, uint32_t src_height, uint32_t src_stride,
+                      uint8_t *dst, uint32_t dst_width, uint32_t dst_height)
+{
+  const float sx = (float)src_width / (float)dst_width;
+  const float sy = (float)src_height / (float)dst_height;
+
+  for (uint32_t y = 0U; y < dst_height; y++)
+  {
+    int32_t y0;
+    int32_t b;
+    const uint8_t *r0;
+    const uint8_t *r1;
+
+    Detect_Coefficient(sy, y, src_height, &y0, &b);
+    r0 = &src[(size_t)y0 * src_stride];
+    r1 = (b != 0) ? (r0 + src_stride) : r0;
+    for (uint32_t x = 0U; x < dst_width; x++)
+    {
+      int32_t x0;
+      int32_t a;
+      int32_t x1;
+      int32_t top;
+      int32_t bottom;
+
+      Detect_Coefficient(sx, x, src_width, &x0, &a);
+      x1 = (a != 0) ? (x0 + 1) : x0;
+      top = ((int32_t)r0[x0] * (DETECT_RESIZE_ONE - a)) + ((int32_t)r0[x1] * a);
+      bottom = ((int32_t)r1[x0] * (DETECT_RESIZE_ONE - a)) + ((int32_t)r1[x1] * a);
+      dst[((size_t)y * dst_width) + x] =
+        (uint8_t)(((top * (DETECT_RESIZE_ONE - b)) + (bottom * b) + (1 << ((2U * DETECT_RESIZE_BITS) - 1U)))
+                  >> (2U * DETECT_RESIZE_BITS));
+    }
+  }
+}
+
+/**
+  * @brief  Faces of a gray frame, as detectMultiScale.
+  * @param  gray: top left pixel, rows stride bytes apart
+  * @param  work: used by one run at a time
+  * @param  faces: the first max_faces faces found
+  * @retval Faces written, -1 if the work area could not grow
+  */
+int FerDetect_Run(const FerDetect_CascadeTypeDef *cascade, const FerDetect_ParamsTypeDef *params,
+                  const uint8_t *gray, uint32_t width, uint32_t height, uint32_t stride,
+                  FerDetect_WorkTypeDef *work, FerDetect_RectTypeDef *faces, uint32_t max_faces)
+{
+  int failed = 0;
+  uint32_t found;
+
+  work->cascade = cascade;
+  work->gray = gray;
+  work->width = width;
+  work->height = height;
+  work->gray_stride = stride;
+  work->count = 0U;
+  if ((Detect_Plan(work, params) != 0) || (Detect_Bind(work) != 0))
+  {
+    return -1;
+  }
+  Detect_Parallel(work, Detect_Prepare);
+  Detect_Parallel(work, Detect_Scan);
+
+  work->stats.frames++;
+  work->stats.stages = cascade->stages;
+  for (uint32_t i = 0U; i < work->threads; i++)
+  {
+    Detect_ThreadTypeDef *t = &work->thread[i];
+
+    failed |= t->failed;
+    work->stats.windows += t->windows;
+    work->stats.weak += t->weak;
+    work->stats.passed += t->passed;
+    for (uint32_t s = 0U; s < cascade->stages; s++)
+    {
+      work->stats.rejected[s] += t->rejected[s];
+    }
+  }
+  if ((failed != 0) || (Detect_Merge(work) != 0))
+  {
+    return -1;
+  }
+  found = Detect_Group(work, params->min_neighbors, faces, max_faces);
+  work->stats.faces += found;
+  return (int)found;
+}
+
+/**
+  * @brief  Rejection statistics of the runs since the work area was made
+  *         or FerDetect_StatsReset().
+  */
+void FerDetect_Stats(const FerDetect_WorkTypeDef *work, FerDetect_StatsTypeDef *stats)
+{
+  *stats = work->stats;
+}
+
+void FerDetect_StatsReset(FerDetect_WorkTypeDef *work)
+{
+  memset(&work->stats, 0, sizeof(work->stats));
+}
+
+/**
+  * @brief  Instructions the windows are evaluated with.
+  */
+const char *FerDetect_Isa(void)
+{
+#if defined(FER_DETECT_SSE2)
+  return "sse2";
+#else
+  return "generic";
+#endif
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static char *Detect_ReadFile(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  char *text;
+  long len;
+
+  if (f == NULL)
+  {
+    perror(path);
+    return NULL;
+  }
+  (void)fseek(f, 0L, SEEK_END);
+  len = ftell(f);
+  rewind(f);
+  text = (len > 0) ? malloc((size_t)len + 1U) : NULL;
+  if ((text == NULL) || (fread(text, 1U, (size_t)len, f) != (size_t)len))
+  {
+    free(text);
+    text = NULL;
+  }
+  else
+  {
+    text[len] = '\0';
+  }
+  fclose(f);
+  return text;
+}
+
+/* Just after the next <tag> before limit, NULL if none */
+static const char *Detect_Tag(const char *p, const char *tag, const char *limit)
+{
+  const char *at = strstr(p, tag);
+
+  return ((at == NULL) || ((limit != NULL) && (at > limit))) ? NULL : (at + strlen(tag));
+}
+
+static int Detect_Numbers(const char **p, double *out, uint32_t n)
+{
+  for (uint32_t i = 0U; i < n; i++)
+  {
+    char *end;
+
+    out[i] = strtod(*p, &end);
+    if (end == *p)
+    {
+      return 1;
+    }
+    *p = end;
+  }
+  return 0;
+}
+
+static int Detect_Parse(FerDetect_CascadeTypeDef *c, const char *xml)
+{
+  const char *p;
+  const char *end;
+  double v[5];
+  uint32_t stumps_max = 0U;
+  uint32_t features_max = 0U;
+
+  if ((Detect_Tag(xml, "<stageType>BOOST", NULL) == NULL) || (Detect_Tag(xml, "<featureType>HAAR", NULL) == NULL)
+      || ((p = Detect_Tag(xml, "<height>", NULL)) == NULL) || (Detect_Numbers(&p, &v[0], 1U) != 0)
+      || ((p = Detect_Tag(xml, "<width>", NULL)) == NULL) || (Detect_Numbers(&p, &v[1], 1U) != 0)
+      || ((p = Detect_Tag(xml, "<stageNum>", NULL)) == NULL) || (Detect_Numbers(&p, &v[2], 1U) != 0)
+      || (v[0] < 3.0) || (v[0] > 255.0) || (v[1] < 3.0) || (v[1] > 255.0) || (v[2] < 1.0)
+      || (v[2] > (double)FER_DETECT_STAGES_MAX))
+  {
+    return 1;
+  }
+  c->height = (uint32_t)v[0];
+  c->width = (uint32_t)v[1];
+  c->stage = calloc((size_t)v[2], sizeof(Detect_StageTypeDef));
+  if (((p = Detect_Tag(p, "<stages>", NULL)) == NULL) || ((end = strstr(p, "</stages>")) == NULL)
+      || (c->stage == NULL))
+  {
+    return 1;
+  }
+
+  /* <_> <maxWeakCount> <stageThreshold> <weakClassifiers> <_>
+     <internalNodes>left right feature threshold <leafValues>left right */
+  while ((c->stages < (uint32_t)v[2]) && ((p = Detect_Tag(p, "<maxWeakCount>", end)) != NULL))
+  {
+    Detect_StageTypeDef *stage = &c->stage[c->stages];
+    double n[2];
+
+    if ((Detect_Numbers(&p, &n[0], 1U) != 0) || ((p = Detect_Tag(p, "<stageThreshold>", end)) == NULL)
+        || (Detect_Numbers(&p, &n[1], 1U) != 0) || (n[0] < 1.0))
+    {
+      return 1;
+    }
+    stage->first = c->stumps;
+    stage->count = (uint32_t)n[0];
+    stage->threshold = (float)n[1] - DETECT_STAGE_EPS;
+    if ((c->stumps + stage->count) > stumps_max)
+    {
+      stumps_max = 2U * (c->stumps + stage->count);
+      if (((c->feature = realloc(c->feature, stumps_max * sizeof(uint32_t))) == NULL)
+          || ((c->threshold = realloc(c->threshold, stumps_max * sizeof(float))) == NULL)
+          || ((c->left = realloc(c->left, stumps_max * sizeof(float))) == NULL)
+          || ((c->right = realloc(c->right, stumps_max * sizeof(float))) == NULL))
+      {
+        return 1;
+      }
+    }
+    for (uint32_t i = 0U; i < stage->count; i++)
+    {
+      const uint32_t s = c->stumps++;
+      double node[4];
+      double leaf[2];
+      const char *close;
+
+      if (((p = Detect_Tag(p, "<internalNodes>", end)) == NULL) || (Detect_Numbers(&p, node, 4U) != 0)
+          || ((close = strstr(p, "</internalNodes>")) == NULL) || (strspn(p, " \t\r\n") != (size_t)(close - p))
+          || (node[0] != 0.0) || (node[1] != -1.0) || (node[2] < 0.0)
+          || ((p = Detect_Tag(p, "<leafValues>", end)) == NULL) || (Detect_Numbers(&p, leaf, 2U) != 0))
+      {
+        return 1;               /* trees deeper than a stump */
+      }
+      c->feature[s] = (uint32_t)node[2];
+      c->threshold[s] = (float)node[3];
+      c->left[s] = (float)leaf[0];
+      c->right[s] = (float)leaf[1];
+    }
+    c->stages++;
+  }
+  if (c->stages != (uint32_t)v[2])
+  {
+    return 1;
+  }
+
+  /* <features> <_> <rects> <_>x y width height weight</_> ... </rects>
+     [<tilted>0</tilted>] </_> */
+  if (((p = Detect_Tag(end, "<features>", NULL)) == NULL) || ((end = strstr(p, "</features>")) == NULL))
+  {
+    return 1;
+  }
+  while ((p = Detect_Tag(p, "<rects>", end)) != NULL)
+  {
+    const char *close = strstr(p, "</rects>");
+    const char *tilted;
+    Detect_FeatureTypeDef *f;
+
+    if (c->features == features_max)
+    {
+      Detect_FeatureTypeDef *grown;
+
+      features_max = (features_max != 0U) ? (2U * features_max) : 1024U;
+      grown = realloc(c->geometry, features_max * sizeof(*grown));
+      if (grown == NULL)
+      {
+        return 1;
+      }
+      c->geometry = grown;
+    }
+    f = &c->geometry[c->features++];
+    f->rects = 0U;
+    while ((close != NULL) && ((p = Detect_Tag(p, "<_>", close)) != NULL))
+    {
+      if ((f->rects == DETECT_RECTS) || (Detect_Numbers(&p, v, 5U) != 0) || (v[0] < 0.0) || (v[1] < 0.0)
+          || (v[2] < 1.0) || (v[3] < 1.0) || ((v[0] + v[2]) > (double)c->width)
+          || ((v[1] + v[3]) > (double)c->height))
+      {
+        return 1;
+      }
+      f->rect[f->rects].x = (uint8_t)v[0];
+      f->rect[f->rects].y = (uint8_t)v[1];
+      f->rect[f->rects].width = (uint8_t)v[2];
+      f->rect[f->rects].height = (uint8_t)v[3];
+      f->rect[f->rects].weight = (float)v[4];
+      f->rects++;
+    }
+    if ((close == NULL) || (f->rects == 0U))
+    {
+      return 1;
+    }
+    p = close;
+    tilted = Detect_Tag(p, "<tilted>", strstr(p + 1, "</_>"));
+    if ((tilted != NULL) && (atoi(tilted) != 0))
+    {
+      return 1;                 /* rotated features are not supported */
+    }
+  }
+  for (uint32_t i = 0U; i < c->stumps; i++)
+  {
+    if (c->feature[i] >= c->features)
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* The scales, the canvas holding their integral images and the bands of
+   window rows to scan */
+static int Detect_Plan(FerDetect_WorkTypeDef *work, const FerDetect_ParamsTypeDef *params)
+{
+  const FerDetect_CascadeTypeDef *c = work->cascade;
+  const uint32_t stride = work->width + 1U;
+  const uint32_t max_size = (params->max_size != 0U) ? params->max_size
+                                                     : ((work->width > work->height) ? work->width : work->height);
+  size_t cells = 0U;
+
+  work->scales = 0U;
+  work->tasks = 0U;
+  if (params->scale_factor <= 1.0f)
+  {
+    return 1;
+  }
+  for (double factor = 1.0; ; factor *= (double)params->scale_factor)
+  {
+    Detect_ScaleTypeDef s;
+
+    s.factor = factor;
+    s.window_width = (int32_t)lrint((double)c->width * factor);
+    s.window_height = (int32_t)lrint((double)c->height * factor);
+    s.width = (uint32_t)lrint((double)work->width / factor);
+    s.height = (uint32_t)lrint((double)work->height / factor);
+    if ((s.width <= c->width) || (s.height <= c->height) || (s.window_width > (int32_t)max_size)
+        || (s.window_height > (int32_t)max_size))
+    {
+      break;
+    }
+    if ((s.window_width < (int32_t)params->min_size) || (s.window_height < (int32_t)params->min_size))
+    {
+      continue;
+    }
+    s.xs = s.width - c->width;
+    s.ys = s.height - c->height;
+    s.step = (factor > 2.0) ? 1U : 2U;
+    s.base = cells;
+    cells += ((size_t)s.height + 1U) * stride;
+    if (work->scales == work->scales_max)
+    {
+      const uint32_t max = (work->scales_max != 0U) ? (2U * work->scales_max) : 32U;
+      Detect_ScaleTypeDef *grown = realloc(work->scale, max * sizeof(*grown));
+
+      if (grown == NULL)
+      {
+        return 1;
+      }
+      work->scale = grown;
+      work->scales_max = max;
+    }
+    work->scale[work->scales++] = s;
+    for (uint32_t y0 = 0U; y0 < s.ys; y0 += DETECT_BAND * s.step)
+    {
+      if (work->tasks == work->tasks_max)
+      {
+        const uint32_t max = (work->tasks_max != 0U) ? (2U * work->tasks_max) : 256U;
+        Detect_TaskTypeDef *grown = realloc(work->task, max * sizeof(*grown));
+
+        if (grown == NULL)
+        {
+          return 1;
+        }
+        work->task = grown;
+        work->tasks_max = max;
+      }
+      work->task[work->tasks++] = (Detect_TaskTypeDef){ work->scales - 1U, y0,
+                                                        ((y0 + (DETECT_BAND * s.step)) < s.ys)
+                                                        ? (y0 + (DETECT_BAND * s.step)) : s.ys, 0U, 0U, 0U };
+    }
+  }
+
+  cells += DETECT_PAD;
+  if (cells > work->cells)
+  {
+    free(work->sum);
+    free(work->sqsum);
+    work->sum = calloc(cells, sizeof(uint32_t));
+    work->sqsum = calloc(cells, sizeof(uint32_t));
+    work->cells = cells;
+    if ((work->sum == NULL) || (work->sqsum == NULL))
+    {
+      work->cells = 0U;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Corner offsets of every rectangle on the canvas stride, when the frame
+   width or the cascade changed */
+static int Detect_Bind(FerDetect_WorkTypeDef *work)
+{
+  const FerDetect_CascadeTypeDef *c = work->cascade;
+  Detect_BoundTypeDef *b = &work->bound;
+  const int32_t stride = (int32_t)work->width + 1;
+
+  if ((b->cascade == c) && (b->stride == (uint32_t)stride))
+  {
+    return 0;
+  }
+  if (c->stumps > b->stumps_max)
+  {
+    free(b->corner);
+    free(b->weight);
+    free(b->rects);
+    b->corner = malloc((size_t)c->stumps * DETECT_RECTS * 4U * sizeof(int32_t));
+    b->weight = malloc((size_t)c->stumps * DETECT_RECTS * sizeof(float));
+    b->rects = malloc(c->stumps);
+    b->stumps_max = c->stumps;
+    if ((b->corner == NULL) || (b->weight == NULL) || (b->rects == NULL))
+    {
+      b->stumps_max = 0U;
+      b->stride = 0U;
+      return 1;
+    }
+  }
+  for (uint32_t i = 0U; i < c->stumps; i++)
+  {
+    const Detect_FeatureTypeDef *f = &c->geometry[c->feature[i]];
+
+    b->rects[i] = (uint8_t)f->rects;
+    for (uint32_t r = 0U; r < DETECT_RECTS; r++)
+    {
+      int32_t *corner = &b->corner[((i * DETECT_RECTS) + r) * 4U];
+
+      if (r < f->rects)
+      {
+        corner[0] = ((int32_t)f->rect[r].y * stride) + (int32_t)f->rect[r].x;
+        corner[1] = corner[0] + (int32_t)f->rect[r].width;
+        corner[2] = corner[0] + ((int32_t)f->rect[r].height * stride);
+        corner[3] = corner[2] + (int32_t)f->rect[r].width;
+        b->weight[(i * DETECT_RECTS) + r] = f->rect[r].weight;
+      }
+      else
+      {
+        memset(corner, 0, 4U * sizeof(int32_t));
+        b->weight[(i * DETECT_RECTS) + r] = 0.0f;
+      }
+    }
+  }
+  b->norm[0] = stride + 1;
+  b->norm[1] = stride + ((int32_t)c->width - 1);
+  b->norm[2] = (((int32_t)c->height - 1) * stride) + 1;
+  b->norm[3] = (((int32_t)c->height - 1) * stride) + ((int32_t)c->width - 1);
+  b->area = (double)(c->width - 2U) * (double)(c->height - 2U);
+  b->cascade = c;
+  b->stride = (uint32_t)stride;
+  return 0;
+}
+
+/* A helper thread: the jobs of the runs until the work area is freed */
+static void *Detect_Helper(void *arg)
+{
+  Detect_ThreadTypeDef *t = arg;
+  FerDetect_WorkTypeDef *work = t->work;
+  uint32_t seen = 0U;
+
+  pthread_mutex_lock(&work->lock);
+  for (;;)
+  {
+    void (*job)(Detect_ThreadTypeDef *t);
+
+    while ((work->stop == 0U) && (work->generation == seen))
+    {
+      pthread_cond_wait(&work->wake, &work->lock);
+    }
+    if (work->stop != 0U)
+    {
+      break;
+    }
+    seen = work->generation;
+    job = work->job;
+    pthread_mutex_unlock(&work->lock);
+    job(t);
+    pthread_mutex_lock(&work->lock);
+    if (--work->busy == 0U)
+    {
+      pthread_cond_signal(&work->done);
+    }
+  }
+  pthread_mutex_unlock(&work->lock);
+  return NULL;
+}
+
+/* Every thread on job until it runs out of scales or tasks */
+static void Detect_Parallel(FerDetect_WorkTypeDef *work, void (*job)(Detect_ThreadTypeDef *t))
+{
+  atomic_store(&work->next, 0U);
+  if (work->threads > 1U)
+  {
+    pthread_mutex_lock(&work->lock);
+    work->job = job;
+    work->busy = work->threads - 1U;
+    work->generation++;
+    pthread_cond_broadcast(&work->wake);
+    pthread_mutex_unlock(&work->lock);
+  }
+  job(&work->thread[0]);
+  if (work->threads > 1U)
+  {
+    pthread_mutex_lock(&work->lock);
+    while (work->busy != 0U)
+    {
+      pthread_cond_wait(&work->done, &work->lock);
+    }
+    pthread_mutex_unlock(&work->lock);
+  }
+}
+
+/* Shrink the frame to a scale a row at a time, integrating each row as it
+   comes */
+static void Detect_Prepare(Detect_ThreadTypeDef *t)
+{
+  FerDetect_WorkTypeDef *work = t->work;
+  const uint32_t stride = work->width + 1U;
+  uint32_t k;
+
+  t->failed = 0;
+  if (work->width > t->row_max)
+  {
+    free(t->row);
+    free(t->x0);
+    free(t->xw);
+    t->row = malloc((size_t)work->width + 16U);
+    t->x0 = malloc((size_t)work->width * sizeof(int32_t));
+    t->xw = malloc((size_t)work->width * sizeof(int32_t));
+    t->row_max = work->width;
+    if ((t->row == NULL) || (t->x0 == NULL) || (t->xw == NULL))
+    {
+      t->row_max = 0U;
+      t->failed = 1;
+    }
+  }
+  while ((k = atomic_fetch_add(&work->next, 1U)) < work->scales)
+  {
+    const Detect_ScaleTypeDef *s = &work->scale[k];
+    const float sx = (float)work->width / (float)s->width;
+    const float sy = (float)work->height / (float)s->height;
+    uint32_t *sum = &work->sum[s->base];
+    uint32_t *sqsum = &work->sqsum[s->base];
+
+    if (t->failed != 0)
+    {
+      continue;
+    }
+    for (uint32_t x = 0U; x < s->width; x++)
+    {
+      Detect_Coefficient(sx, x, work->width, &t->x0[x], &t->xw[x]);
+    }
+    memset(sum, 0, stride * sizeof(uint32_t));
+    memset(sqsum, 0, stride * sizeof(uint32_t));
+    for (uint32_t y = 0U; y < s->height; y++)
+    {
+      int32_t y0;
+      int32_t b;
+      const uint8_t *r0;
+      const uint8_t *r1;
+
+      /* as FerDetect_Resize() */
+      Detect_Coefficient(sy, y, work->height, &y0, &b);
+      r0 = &work->gray[(size_t)y0 * work->gray_stride];
+      r1 = (b != 0) ? (r0 + work->gray_stride) : r0;
+      for (uint32_t x = 0U; x < s->width; x++)
+      {
+        const int32_t x0 = t->x0[x];
+        const int32_t a = t->xw[x];
+        const int32_t x1 = (a != 0) ? (x0 + 1) : x0;
+        const int32_t top = ((int32_t)r0[x0] * (DETECT_RESIZE_ONE - a)) + ((int32_t)r0[x1] * a);
+        const int32_t bottom = ((int32_t)r1[x0] * (DETECT_RESIZE_ONE - a)) + ((int32_t)r1[x1] * a);
+
+        t->row[x] = (uint8_t)(((top * (DETECT_RESIZE_ONE - b)) + (bottom * b)
+                               + (1 << ((2U * DETECT_RESIZE_BITS) - 1U))) >> (2U * DETECT_RESIZE_BITS));
+      }
+      Detect_IntegralRow(t->row, s->width, &sum[(size_t)y * stride], &sqsum[(size_t)y * stride],
+                         &sum[((size_t)y + 1U) * stride], &sqsum[((size_t)y + 1U) * stride]);
+    }
+  }
+}
+
+/* Slide the window over bands of rows, keeping the hits per band */
+static void Detect_Scan(Detect_ThreadTypeDef *t)
+{
+  FerDetect_WorkTypeDef *work = t->work;
+  const FerDetect_CascadeTypeDef *c = work->cascade;
+  const uint32_t stride = work->width + 1U;
+  const uint32_t lanes_max =
+#if defined(FER_DETECT_SSE2)
+    DETECT_LANES;
+#else
+    1U;
+#endif
+  uint32_t k;
+
+  t->count = 0U;
+  t->windows = 0U;
+  t->weak = 0U;
+  t->passed = 0U;
+  memset(t->rejected, 0, sizeof(t->rejected));
+  while ((k = atomic_fetch_add(&work->next, 1U)) < work->tasks)
+  {
+    Detect_TaskTypeDef *task = &work->task[k];
+    const Detect_ScaleTypeDef *s = &work->scale[task->scale];
+
+    task->thread = t->id;
+    task->first = t->count;
+    for (uint32_t y = task->y0; (y < task->y1) && (t->failed == 0); y += s->step)
+    {
+      const size_t row = s->base + ((size_t)y * stride);
+
+      for (uint32_t x = 0U; x < s->xs; x += lanes_max * s->step)
+      {
+        const uint32_t left = ((s->xs - x) + s->step - 1U) / s->step;
+        const uint32_t lanes = (left < lanes_max) ? left : lanes_max;
+        uint32_t pass = Detect_Windows(c, &work->bound, &work->sum[row + x], &work->sqsum[row + x], s->step, lanes, t);
+
+        for (uint32_t l = 0U; pass != 0U; l++, pass >>= 1)
+        {
+          const FerDetect_RectTypeDef r =
+          {
+            (int32_t)lrint((double)(x + (l * s->step)) * s->factor), (int32_t)lrint((double)y * s->factor),
+            s->window_width, s->window_height,
+          };
+
+          if (((pass & 1U) != 0U) && (Detect_Hit(&t->hits, &t->count, &t->hits_max, r) != 0))
+          {
+            t->failed = 1;
+          }
+        }
+      }
+    }
+    task->count = t->count - task->first;
+  }
+}
+
+/* Source index and 11-bit weight of the next one for destination i, the
+   pixel centres aligned and the source clamped */
+static void Detect_Coefficient(float scale, uint32_t i, uint32_t src_len, int32_t *i0, int32_t *weight)
+{
+  const float f = (((float)i + 0.5f) * scale) - 0.5f;
+  int32_t at = (int32_t)floorf(f);
+  int32_t w = (int32_t)lrintf((f - (float)at) * (float)DETECT_RESIZE_ONE);
+
+  if (at < 0)
+  {
+    at = 0;
+    w = 0;
+  }
+  if (at >= ((int32_t)src_len - 1))
+  {
+    at = (int32_t)src_len - 1;
+    w = 0;
+  }
+  *i0 = at;
+  *weight = w;
+}
+
+/* Row y + 1 of the integral images from row y and the pixels of row y */
+static void Detect_IntegralRow(const uint8_t *row, uint32_t width, const uint32_t *sum_up, const uint32_t *sqsum_up,
+                               uint32_t *sum, uint32_t *sqsum)
+{
+  uint32_t line = 0U;
+  uint32_t sqline = 0U;
+  uint32_t x = 0U;
+
+  sum[0] = 0U;
+  sqsum[0] = 0U;
+#if defined(FER_DETECT_SSE2)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i carry = zero;
+    __m128i sqcarry = zero;
+
+    for (; (x + 8U) <= width; x += 8U)
+    {
+      const __m128i p16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)&row[x]), zero);
+      const __m128i q16 = _mm_mullo_epi16(p16, p16);          /* < 2^16 */
+      __m128i v[4] =
+      {
+        _mm_unpacklo_epi16(p16, zero), _mm_unpackhi_epi16(p16, zero),
+        _mm_unpacklo_epi16(q16, zero), _mm_unpackhi_epi16(q16, zero),
+      };
+
+      /* prefix sums of 4 lanes, plus the sum of the row so far */
+      for (uint32_t i = 0U; i < 4U; i++)
+      {
+        v[i] = _mm_add_epi32(v[i], _mm_slli_si128(v[i], 4));
+        v[i] = _mm_add_epi32(v[i], _mm_slli_si128(v[i], 8));
+      }
+      v[0] = _mm_add_epi32(v[0], carry);
+      v[1] = _mm_add_epi32(v[1], _mm_shuffle_epi32(v[0], 0xFF));
+      carry = _mm_shuffle_epi32(v[1], 0xFF);
+      v[2] = _mm_add_epi32(v[2], sqcarry);
+      v[3] = _mm_add_epi32(v[3], _mm_shuffle_epi32(v[2], 0xFF));
+      sqcarry = _mm_shuffle_epi32(v[3], 0xFF);
+
+      _mm_storeu_si128((__m128i *)&sum[x + 1U],
+                       _mm_add_epi32(v[0], _mm_loadu_si128((const __m128i *)&sum_up[x + 1U])));
+      _mm_storeu_si128((__m128i *)&sum[x + 5U],
+                       _mm_add_epi32(v[1], _mm_loadu_si128((const __m128i *)&sum_up[x + 5U])));
+      _mm_storeu_si128((__m128i *)&sqsum[x + 1U],
+                       _mm_add_epi32(v[2], _mm_loadu_si128((const __m128i *)&sqsum_up[x + 1U])));
+      _mm_storeu_si128((__m128i *)&sqsum[x + 5U],
+                       _mm_add_epi32(v[3], _mm_loadu_si128((const __m128i *)&sqsum_up[x + 5U])));
+    }
+    line = (uint32_t)_mm_cvtsi128_si32(carry);
+    sqline = (uint32_t)_mm_cvtsi128_si32(sqcarry);
+  }
+#endif
+  for (; x < width; x++)
+  {
+    line += row[x];
+    sqline += (uint32_t)row[x] * row[x];
+    sum[x + 1U] = sum_up[x + 1U] + line;
+    sqsum[x + 1U] = sqsum_up[x + 1U] + sqline;
+  }
+}
+
+/* 1 / (area * stddev) of the window inside its one pixel border */
+static float Detect_Norm(const Detect_BoundTypeDef *b, const uint32_t *sum, const uint32_t *sqsum)
+{
+  const uint32_t valsum = (sum[b->norm[3]] - sum[b->norm[2]]) - (sum[b->norm[1]] - sum[b->norm[0]]);
+  const uint32_t sq = (sqsum[b->norm[3]] - sqsum[b->norm[2]]) - (sqsum[b->norm[1]] - sqsum[b->norm[0]]);
+  double nf = (b->area * (double)sq) - ((double)valsum * (double)valsum);
+
+  nf = (nf > 0.0) ? sqrt(nf) : 1.0;
+  return (float)(1.0 / nf);
+}
+
+/**
+  * The windows at sum, sum + step, ... through the cascade.
+  * @retval Bit l set if window l passed every stage
+  */
+static uint32_t Detect_Windows(const FerDetect_CascadeTypeDef *c, const Detect_BoundTypeDef *b, const uint32_t *sum,
+                               const uint32_t *sqsum, uint32_t step, uint32_t lanes, Detect_ThreadTypeDef *t)
+{
+  uint32_t alive = (1U << lanes) - 1U;
+
+  t->windows += lanes;
+#if defined(FER_DETECT_SSE2)
+  {
+    float norm[DETECT_LANES] = { 0.0f };
+    __m128 vnorm;
+
+    for (uint32_t l = 0U; l < lanes; l++)
+    {
+      norm[l] = Detect_Norm(b, &sum[l * step], &sqsum[l * step]);
+    }
+    vnorm = _mm_loadu_ps(norm);
+    for (uint32_t s = 0U; (s < c->stages) && (alive != 0U); s++)
+    {
+      const Detect_StageTypeDef *stage = &c->stage[s];
+      __m128 total = _mm_setzero_ps();
+      uint32_t now;
+
+      for (uint32_t i = stage->first; i < (stage->first + stage->count); i++)
+      {
+        __m128 value = _mm_setzero_ps();
+        __m128 below;
+
+        for (uint32_t r = 0U; r < b->rects[i]; r++)
+        {
+          const int32_t *corner = &b->corner[((i * DETECT_RECTS) + r) * 4U];
+          __m128i v[4];
+
+          /* the corner of 4 windows step cells apart */
+          for (uint32_t k = 0U; k < 4U; k++)
+          {
+            const __m128i *p = (const __m128i *)&sum[corner[k]];
+
+            v[k] = (step == 1U) ? _mm_loadu_si128(p)
+                   : _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(_mm_loadu_si128(p)),
+                                                     _mm_castsi128_ps(_mm_loadu_si128(p + 1)),
+                                                     _MM_SHUFFLE(2, 0, 2, 0)));
+          }
+          value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(b->weight[(i * DETECT_RECTS) + r]),
+                                               _mm_cvtepi32_ps(_mm_sub_epi32(_mm_sub_epi32(v[0], v[1]),
+                                                                             _mm_sub_epi32(v[2], v[3])))));
+        }
+        below = _mm_cmplt_ps(_mm_mul_ps(value, vnorm), _mm_set1_ps(c->threshold[i]));
+        total = _mm_add_ps(total, _mm_or_ps(_mm_and_ps(below, _mm_set1_ps(c->left[i])),
+                                            _mm_andnot_ps(below, _mm_set1_ps(c->right[i]))));
+      }
+      now = alive & ~(uint32_t)_mm_movemask_ps(_mm_cmplt_ps(total, _mm_set1_ps(stage->threshold)));
+      t->weak += (uint64_t)__builtin_popcount(alive) * stage->count;
+      t->rejected[s] += (uint64_t)__builtin_popcount(alive & ~now);
+      alive = now;
+    }
+  }
+#else
+  {
+    const float norm = Detect_Norm(b, sum, sqsum);
+
+    (void)step;
+    for (uint32_t s = 0U; (s < c->stages) && (alive != 0U); s++)
+    {
+      const Detect_StageTypeDef *stage = &c->stage[s];
+      float total = 0.0f;
+
+      for (uint32_t i = stage->first; i < (stage->first + stage->count); i++)
+      {
+        float value = 0.0f;
+
+        for (uint32_t r = 0U; r < b->rects[i]; r++)
+        {
+          const int32_t *corner = &b->corner[((i * DETECT_RECTS) + r) * 4U];
+          const int32_t area_sum = (int32_t)((sum[corner[0]] - sum[corner[1]]) - (sum[corner[2]] - sum[corner[3]]));
+
+          value = value + (b->weight[(i * DETECT_RECTS) + r] * (float)area_sum);
+        }
+        total = total + (((value * norm) < c->threshold[i]) ? c->left[i] : c->right[i]);
+      }
+      t->weak += stage->count;
+      if (total < stage->threshold)
+      {
+        t->rejected[s]++;
+        alive = 0U;
+      }
+    }
+  }
+#endif
+  t->passed += (uint64_t)__builtin_popcount(alive);
+  return alive;
+}
+
+static int Detect_Hit(FerDetect_RectTypeDef **hits, uint32_t *count, uint32_t *max, FerDetect_RectTypeDef r)
+{
+  if (*count == *max)
+  {
+    const uint32_t grown_max = (*max != 0U) ? (2U * *max) : 256U;
+    FerDetect_RectTypeDef *grown = realloc(*hits, grown_max * sizeof(*grown));
+
+    if (grown == NULL)
+    {
+      return 1;
+    }
+    *hits = grown;
+    *max = grown_max;
+  }
+  (*hits)[(*count)++] = r;
+  return 0;
+}
+
+/* The hits of every band in band order, as one thread would find them */
+static int Detect_Merge(FerDetect_WorkTypeDef *work)
+{
+  uint32_t total = 0U;
+
+  for (uint32_t k = 0U; k < work->tasks; k++)
+  {
+    total += work->task[k].count;
+  }
+  if (total > work->hits_max)
+  {
+    FerDetect_RectTypeDef *hits = realloc(work->hits, total * sizeof(*hits));
+    uint32_t *label = realloc(work->label, total * sizeof(*label));
+    int32_t *group = realloc(work->group, total * 5U * sizeof(*group));
+
+    work->hits = (hits != NULL) ? hits : work->hits;
+    work->label = (label != NULL) ? label : work->label;
+    work->group = (group != NULL) ? group : work->group;
+    if ((hits == NULL) || (label == NULL) || (group == NULL))
+    {
+      return 1;
+    }
+    work->hits_max = total;
+  }
+  for (uint32_t k = 0U; k < work->tasks; k++)
+  {
+    const Detect_TaskTypeDef *task = &work->task[k];
+
+    if (task->count != 0U)
+    {
+      memcpy(&work->hits[work->count], &work->thread[task->thread].hits[task->first],
+             task->count * sizeof(FerDetect_RectTypeDef));
+      work->count += task->count;
+    }
+  }
+  return 0;
+}
+
+/* cv::groupRectangles(hits, min_neighbors, 0.2) */
+static uint32_t Detect_Group(FerDetect_WorkTypeDef *work, uint32_t min_neighbors, FerDetect_RectTypeDef *faces,
+                             uint32_t max_faces)
+{
+  const uint32_t n = work->count;
+  uint32_t clusters = 0U;
+  uint32_t found = 0U;
+
+  /* label each hit with the first earlier hit it is similar to, through
+     any chain of similar hits */
+  for (uint32_t i = 0U; i < n; i++)
+  {
+    work->label[i] = i;
+  }
+  for (uint32_t i = 0U; i < n; i++)
+  {
+    for (uint32_t j = 0U; j < i; j++)
+    {
+      if (Detect_Similar(&work->hits[i], &work->hits[j]) != 0)
+      {
+        uint32_t a = i;
+        uint32_t b = j;
+
+        while (work->label[a] != a)
+        {
+          a = work->label[a];
+        }
+        while (work->label[b] != b)
+        {
+          b = work->label[b];
+        }
+        if (a != b)
+        {
+          work->label[(a > b) ? a : b] = (a > b) ? b : a;
+        }
+      }
+    }
+  }
+
+  /* sum each cluster in the slot of its root */
+  if (n == 0U)
+  {
+    return 0U;
+  }
+  memset(work->group, 0, (size_t)n * 5U * sizeof(int32_t));
+  for (uint32_t i = 0U; i < n; i++)
+  {
+    uint32_t root = i;
+    int32_t *g;
+
+    while (work->label[root] != root)
+    {
+      root = work->label[root];
+    }
+    g = &work->group[root * 5U];
+    g[0] += work->hits[i].x;
+    g[1] += work->hits[i].y;
+    g[2] += work->hits[i].width;
+    g[3] += work->hits[i].height;
+    g[4]++;
+  }
+  for (uint32_t i = 0U; i < n; i++)
+  {
+    int32_t *g = &work->group[i * 5U];
+
+    if (g[4] != 0)
+    {
+      const float s = 1.0f / (float)g[4];
+      int32_t *out = &work->group[clusters * 5U];
+      const int32_t hits = g[4];
+
+      out[0] = (int32_t)lrintf((float)g[0] * s);
+      out[1] = (int32_t)lrintf((float)g[1] * s);
+      out[2] = (int32_t)lrintf((float)g[2] * s);
+      out[3] = (int32_t)lrintf((float)g[3] * s);
+      out[4] = hits;
+      clusters++;
+    }
+  }
+
+  /* keep the clusters with enough hits that are not inside a stronger one */
+  for (uint32_t i = 0U; (i < clusters) && (found < max_faces); i++)
+  {
+    const int32_t *r1 = &work->group[i * 5U];
+    uint32_t j;
+
+    if (r1[4] <= (int32_t)min_neighbors)
+    {
+      continue;
+    }
+    for (j = 0U; j < clusters; j++)
+    {
+      const int32_t *r2 = &work->group[j * 5U];
+      const int32_t dx = (int32_t)lrint((double)r2[2] * DETECT_EPS);
+      const int32_t dy = (int32_t)lrint((double)r2[3] * DETECT_EPS);
+
+      if ((j != i) && (r2[4] > (int32_t)min_neighbors) && (r1[0] >= (r2[0] - dx)) && (r1[1] >= (r2[1] - dy))
+          && ((r1[0] + r1[2]) <= (r2[0] + r2[2] + dx)) && ((r1[1] + r1[3]) <= (r2[1] + r2[3] + dy))
+          && ((r2[4] > ((r1[4] > 3) ? r1[4] : 3)) || (r1[4] < 3)))
+      {
+        break;
+      }
+    }
+    if (j == clusters)
+    {
+      faces[found++] = (FerDetect_RectTypeDef){ r1[0], r1[1], r1[2], r1[3] };
+    }
+  }
+  return found;
+}
+
+/* cv::SimilarRects */
+static int Detect_Similar(const FerDetect_RectTypeDef *a, const FerDetect_RectTypeDef *b)
+{
+  const double delta = DETECT_EPS * (double)(((a->width < b->width) ? a->width : b->width)
+                                             + ((a->height < b->height) ? a->height : b->height)) * 0.5;
+
+  return (fabs((double)(a->x - b->x)) <= delta) && (fabs((double)(a->y - b->y)) <= delta)
+         && (fabs((double)((a->x + a->width) - (b->x + b->width))) <= delta)
+         && (fabs((double)((a->y + a->height) - (b->y + b->height))) <= delta);
+}
@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file           : fer_detect.h
+  * @brief          : Header for fer_detect.c file.
+  *                   Haar cascade face detector reading the OpenCV cascade
+  *                   XML (haarcascade_frontalface_default.xml) once, and
+  *                   running detectMultiScale on 8-bit gray frames with a
+  *                   reusable work area and its own threads; built into
+  *                   fer_stream and as libfer_detect.so for fer_detect.py.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FER_DETECT_H
+#define __FER_DETECT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define FER_DETECT_STAGES_MAX       64U
+#define FER_DETECT_THREADS_MAX      32U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  int32_t x;
+  int32_t y;
+  int32_t width;
+  int32_t height;
+} FerDetect_RectTypeDef;
+
+/* detectMultiScale() arguments; emotion_2.py uses 1.3 and 5 */
+typedef struct
+{
+  float scale_factor;       /* window growth between scales, > 1           */
+  uint32_t min_neighbors;   /* raw hits a face needs to be kept            */
+  uint32_t min_size;        /* smallest window in pixels, 0 for any        */
+  uint32_t max_size;        /* largest window in pixels, 0 for the frame   */
+} FerDetect_ParamsTypeDef;
+
+/* Where the cascade rejects windows, summed over the runs of a work area */
+typedef struct
+{
+  uint64_t frames;
+  uint64_t windows;         /* evaluated, every scale                      */
+  uint64_t weak;            /* weak classifiers evaluated over them        */
+  uint64_t passed;          /* windows through every stage                 */
+  uint64_t faces;           /* after grouping                              */
+  uint32_t stages;
+  uint64_t rejected[FER_DETECT_STAGES_MAX];     /* windows each stage ended */
+} FerDetect_StatsTypeDef;
+
+typedef struct FerDetect_Cascade FerDetect_CascadeTypeDef;
+
+/* Image pyramid, integral images, cascade bound to their row stride, hits
+   and threads, grown on demand so that a stream of frames of one size
+   allocates nothing after the first */
+typedef struct FerDetect_Work FerDetect_WorkTypeDef;
+
+#define FER_DETECT_PARAMS_DEFAULT   { 1.3f, 5U, 0U, 0U }
+
+/* Exported functions prototypes ---------------------------------------------*/
+FerDetect_CascadeTypeDef *FerDetect_Load(const char *path);
+void FerDetect_Free(FerDetect_CascadeTypeDef *cascade);
+uint32_t FerDetect_WindowSize(const FerDetect_CascadeTypeDef *cascade);
+FerDetect_WorkTypeDef *FerDetect_WorkNew(uint32_t threads);
+void FerDetect_WorkFree(FerDetect_WorkTypeDef *work);
+void FerDetect_Resize(const uint8_t *src, uint32_t src_width, uint32_t src_height, uint32_t src_stride,
+                      uint8_t *dst, uint32_t dst_width, uint32_t dst_height);
+int FerDetect_Run(const FerDetect_CascadeTypeDef *cascade, const FerDetect_ParamsTypeDef *params,
+                  const uint8_t *gray, uint32_t width, uint32_t height, uint32_t stride,
+                  FerDetect_WorkTypeDef *work, FerDetect_RectTypeDef *faces, uint32_t max_faces);
+void FerDetect_Stats(const FerDetect_WorkTypeDef *work, FerDetect_StatsTypeDef *stats);
+void FerDetect_StatsReset(FerDetect_WorkTypeDef *work);
+const char *FerDetect_Isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FER_DETECT_H */
@@ -0,0 +1,465 @@
+/**
+  ******************************************************************************
+  * @file           : fer_loader.c
+  * @brief          : Batches from a memory-mapped packed FER2013 file.
+  *
+  *                   The file is mapped read-only and never copied: the
+  *                   workers gather the images of a batch straight from
+  *                   the map, convert them to float and write them into
+  *                   one of `slots` batch buffers allocated at open. Batch
+  *                   k goes to slot k % slots; the caller takes batches in
+  *                   order and hands each slot back when done with it, so
+  *                   up to slots batches are prefetched while it trains.
+  *
+  *                   Shuffling needs no per-epoch array either: image
+  *                   position p of epoch e is a keyed permutation of p, a
+  *                   4-round Feistel network on the next even power of two
+  *                   with cycle walking back into [0, images). Any worker
+  *                   computes it for any batch, and the same seed gives
+  *                   the same batches whatever the number of workers.
+  *
+  *                   The u8 -> float conversion runs 8 pixels at a time
+  *                   with AVX2, 16 with SSE2, or one at a time on plain C
+  *                   (FER_LOADER_GENERIC).
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "fer_loader.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__AVX2__) && !defined(FER_LOADER_GENERIC)
+#include <immintrin.h>
+#define FER_LOADER_AVX2
+#elif defined(__SSE2__) && !defined(FER_LOADER_GENERIC)
+#include <emmintrin.h>
+#define FER_LOADER_SSE2
+#endif
+
+/* Private define ------------------------------------------------------------*/
+#define LOADER_FREE         0U
+#define LOADER_FILLING      1U
+#define LOADER_READY        2U
+#define LOADER_TAKEN        3U
+
+#define LOADER_ROUNDS       4U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t state;           /* LOADER_*                                    */
+  uint64_t index;           /* batch it holds                              */
+  uint32_t count;
+  float *x;
+  float *y;
+  uint8_t *labels;
+} Loader_SlotTypeDef;
+
+struct FerLoader_Handle
+{
+  FerLoader_ConfigTypeDef config;
+  const uint8_t *map;
+  size_t map_size;
+  const uint8_t *pixels;    /* of the first image of the split             */
+  const uint8_t *labels;
+  uint32_t images;
+  uint32_t batches;         /* per epoch                                   */
+  uint32_t half_bits;       /* of the Feistel network                      */
+  Loader_SlotTypeDef slots[FER_LOADER_SLOTS_MAX];
+  pthread_t workers[FER_LOADER_WORKERS_MAX];
+  uint32_t started;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;     /* a slot was filled                           */
+  pthread_cond_t released;  /* a slot was handed back                      */
+  uint64_t next_fill;
+  uint64_t next_take;
+  int stop;
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void *Loader_Worker(void *arg);
+static void Loader_Fill(FerLoader_HandleTypeDef *loader, Loader_SlotTypeDef *slot);
+static void Loader_Convert(const uint8_t *in, float *out, float scale, float offset);
+static uint64_t Loader_Mix(uint64_t x);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Map a packed file and start the workers.
+  * @param  config: see FerLoader_ConfigTypeDef; slots, workers and batch
+  *         are clamped to their limits
+  * @retval Loader, NULL if the file cannot be used or nothing is selected
+  */
+FerLoader_HandleTypeDef *FerLoader_Open(const FerLoader_ConfigTypeDef *config)
+{
+  FerLoader_HandleTypeDef *loader = calloc(1U, sizeof(*loader));
+  FerPack_HeaderTypeDef hdr;
+  struct stat st;
+  uint32_t first = UINT32_MAX;
+  uint32_t last = 0U;
+  int fd;
+
+  if ((loader == NULL) || (config == NULL) || (config->path == NULL) || (config->batch == 0U))
+  {
+    free(loader);
+    return NULL;
+  }
+  loader->config = *config;
+  loader->config.workers = (config->workers == 0U) ? 1U
+                           : ((config->workers > FER_LOADER_WORKERS_MAX) ? FER_LOADER_WORKERS_MAX : config->workers);
+  loader->config.slots = (config->slots < 2U) ? 2U
+                         : ((config->slots > FER_LOADER_SLOTS_MAX) ? FER_LOADER_SLOTS_MAX : config->slots);
+
+  fd = open(config->path, O_RDONLY);
+  if ((fd < 0) || (fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(hdr)))
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    free(loader);
+    return NULL;
+  }
+  loader->map_size = (size_t)st.st_size;
+  loader->map = mmap(NULL, loader->map_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (loader->map == MAP_FAILED)
+  {
+    free(loader);
+    return NULL;
+  }
+  memcpy(&hdr, loader->map, sizeof(hdr));
+  if ((hdr.magic != FER_PACK_MAGIC) || (hdr.header_bytes != sizeof(hdr)) || (hdr.size != loader->map_size)
+      || (hdr.height != FER_PACK_SIZE) || (hdr.width != FER_PACK_SIZE)
+      || ((hdr.pixels + ((uint64_t)hdr.count * FER_PACK_PIXELS)) != hdr.size))
+  {
+    FerLoader_Close(loader);
+    return NULL;
+  }
+
+  /* the selected usage groups, one slice of the file */
+  for (uint32_t u = 0U; u < FER_PACK_USAGES; u++)
+  {
+    if ((config->usages & (1U << u)) != 0U)
+    {
+      first = (u < first) ? u : first;
+      last = u;
+    }
+  }
+  for (uint32_t u = first; u <= last; u++)
+  {
+    if ((config->usages & (1U << u)) == 0U)
+    {
+      FerLoader_Close(loader);
+      return NULL;
+    }
+    loader->images += hdr.images[u];
+  }
+  if (loader->images == 0U)
+  {
+    FerLoader_Close(loader);
+    return NULL;
+  }
+  loader->pixels = &loader->map[hdr.pixels + ((uint64_t)hdr.first[first] * FER_PACK_PIXELS)];
+  loader->labels = &loader->map[hdr.labels + hdr.first[first]];
+  loader->config.batch = (config->batch > loader->images) ? loader->images : config->batch;
+  loader->batches = (config->drop_last != 0U) ? (loader->images / loader->config.batch)
+                    : ((loader->images + loader->config.batch - 1U) / loader->config.batch);
+  while ((1ULL << (2U * loader->half_bits)) < loader->images)
+  {
+    loader->half_bits++;
+  }
+  (void)madvise((void *)loader->map, loader->map_size, config->shuffle ? MADV_RANDOM : MADV_SEQUENTIAL);
+
+  /* batch buffers, the only allocations */
+  for (uint32_t s = 0U; s < loader->config.slots; s++)
+  {
+    Loader_SlotTypeDef *slot = &loader->slots[s];
+
+    slot->x = aligned_alloc(64U, (((size_t)loader->config.batch * FER_PACK_PIXELS * sizeof(float)) + 63U) & ~(size_t)63U);
+    slot->y = malloc((size_t)loader->config.batch * FER_PACK_CLASSES * sizeof(float));
+    slot->labels = malloc(loader->config.batch);
+    if ((slot->x == NULL) || (slot->y == NULL) || (slot->labels == NULL))
+    {
+      FerLoader_Close(loader);
+      return NULL;
+    }
+  }
+
+  pthread_mutex_init(&loader->lock, NULL);
+  pthread_cond_init(&loader->ready, NULL);
+  pthread_cond_init(&loader->released, NULL);
+  for (uint32_t w = 0U; w < loader->config.workers; w++)
+  {
+    if (pthread_create(&loader->workers[w], NULL, Loader_Worker, loader) != 0)
+    {
+      FerLoader_Close(loader);
+      return NULL;
+    }
+    loader->started++;
+  }
+  return loader;
+}
+
+/**
+  * @brief  Images in the selected split.
+  */
+uint32_t FerLoader_Images(const FerLoader_HandleTypeDef *loader)
+{
+  return loader->images;
+}
+
+/**
+  * @brief  Batches per epoch.
+  */
+uint32_t FerLoader_BatchesPerEpoch(const FerLoader_HandleTypeDef *loader)
+{
+  return loader->batches;
+}
+
+/**
+  * @brief  Wait for the next batch; the stream runs over epochs forever.
+  *         Batches come in order, to a single consumer thread.
+  * @param  batch: filled in; its buffers are the caller's until
+  *         FerLoader_Release(batch->slot)
+  * @retval 0, -1 if every slot is already held by the caller
+  */
+int FerLoader_Next(FerLoader_HandleTypeDef *loader, FerLoader_BatchTypeDef *batch)
+{
+  Loader_SlotTypeDef *slot;
+  const uint64_t k = loader->next_take;
+
+  pthread_mutex_lock(&loader->lock);
+  slot = &loader->slots[k % loader->config.slots];
+  if (slot->state == LOADER_TAKEN)
+  {
+    pthread_mutex_unlock(&loader->lock);
+    return -1;
+  }
+  while ((slot->state != LOADER_READY) || (slot->index != k))
+  {
+    pthread_cond_wait(&loader->ready, &loader->lock);
+  }
+  slot->state = LOADER_TAKEN;
+  loader->next_take++;
+  pthread_mutex_unlock(&loader->lock);
+
+  batch->slot = (uint32_t)(k % loader->config.slots);
+  batch->count = slot->count;
+  batch->index = k;
+  batch->epoch = (uint32_t)(k / loader->batches);
+  batch->x = slot->x;
+  batch->y = slot->y;
+  batch->labels = slot->labels;
+  return 0;
+}
+
+/**
+  * @brief  Hand a batch's buffers back for prefetching.
+  */
+void FerLoader_Release(FerLoader_HandleTypeDef *loader, uint32_t slot)
+{
+  if (slot < loader->config.slots)
+  {
+    pthread_mutex_lock(&loader->lock);
+    if (loader->slots[slot].state == LOADER_TAKEN)
+    {
+      loader->slots[slot].state = LOADER_FREE;
+      pthread_cond_broadcast(&loader->released);
+    }
+    pthread_mutex_unlock(&loader->lock);
+  }
+}
+
+/**
+  * @brief  Stop the workers, free the buffers and unmap the file.
+  */
+void FerLoader_Close(FerLoader_HandleTypeDef *loader)
+{
+  if (loader == NULL)
+  {
+    return;
+  }
+  if (loader->started != 0U)
+  {
+    pthread_mutex_lock(&loader->lock);
+    loader->stop = 1;
+    pthread_cond_broadcast(&loader->released);
+    pthread_mutex_unlock(&loader->lock);
+    for (uint32_t w = 0U; w < loader->started; w++)
+    {
+      pthread_join(loader->workers[w], NULL);
+    }
+    pthread_cond_destroy(&loader->released);
+    pthread_cond_destroy(&loader->ready);
+    pthread_mutex_destroy(&loader->lock);
+  }
+  for (uint32_t s = 0U; s < FER_LOADER_SLOTS_MAX; s++)
+  {
+    free(loader->slots[s].x);
+    free(loader->slots[s].y);
+    free(loader->slots[s].labels);
+  }
+  if ((loader->map != NULL) && (loader->map != MAP_FAILED))
+  {
+    munmap((void *)loader->map, loader->map_size);
+  }
+  free(loader);
+}
+
+/**
+  * @brief  Image of the split at a position of an epoch.
+  * @retval Index in the split; the position itself without shuffling
+  */
+uint32_t FerLoader_Image(const FerLoader_HandleTypeDef *loader, uint32_t epoch, uint32_t position)
+{
+  const uint32_t half = loader->half_bits;
+  const uint64_t mask = (1ULL << half) - 1U;
+  uint64_t x = position;
+
+  if (loader->config.shuffle == 0U)
+  {
+    return position;
+  }
+  do
+  {
+    uint64_t l = x >> half;
+    uint64_t r = x & mask;
+
+    for (uint32_t i = 0U; i < LOADER_ROUNDS; i++)
+    {
+      const uint64_t key = Loader_Mix(loader->config.seed ^ ((uint64_t)epoch << 8) ^ i);
+      const uint64_t f = Loader_Mix(r ^ key) & mask;
+      const uint64_t t = r;
+
+      r = l ^ f;
+      l = t;
+    }
+    x = (l << half) | r;
+  } while (x >= loader->images);
+  return (uint32_t)x;
+}
+
+/**
+  * @brief  Conversion in use: "avx2", "sse2" or "generic".
+  */
+const char *FerLoader_Isa(void)
+{
+#if defined(FER_LOADER_AVX2)
+  return "avx2";
+#elif defined(FER_LOADER_SSE2)
+  return "sse2";
+#else
+  return "generic";
+#endif
+}
+
+/* Take the next batch number, wait for its slot, fill it */
+static void *Loader_Worker(void *arg)
+{
+  FerLoader_HandleTypeDef *loader = arg;
+
+  for (;;)
+  {
+    Loader_SlotTypeDef *slot;
+
+    pthread_mutex_lock(&loader->lock);
+    slot = &loader->slots[loader->next_fill % loader->config.slots];
+    while ((loader->stop == 0) && (slot->state != LOADER_FREE))
+    {
+      pthread_cond_wait(&loader->released, &loader->lock);
+      slot = &loader->slots[loader->next_fill % loader->config.slots];
+    }
+    if (loader->stop != 0)
+    {
+      pthread_mutex_unlock(&loader->lock);
+      return NULL;
+    }
+    slot->state = LOADER_FILLING;
+    slot->index = loader->next_fill++;
+    pthread_mutex_unlock(&loader->lock);
+
+    Loader_Fill(loader, slot);
+
+    pthread_mutex_lock(&loader->lock);
+    slot->state = LOADER_READY;
+    pthread_cond_broadcast(&loader->ready);
+    pthread_mutex_unlock(&loader->lock);
+  }
+}
+
+static void Loader_Fill(FerLoader_HandleTypeDef *loader, Loader_SlotTypeDef *slot)
+{
+  const FerLoader_ConfigTypeDef *cfg = &loader->config;
+  const uint32_t epoch = (uint32_t)(slot->index / loader->batches);
+  const uint32_t start = (uint32_t)(slot->index % loader->batches) * cfg->batch;
+
+  slot->count = ((loader->images - start) < cfg->batch) ? (loader->images - start) : cfg->batch;
+  memset(slot->y, 0, (size_t)slot->count * FER_PACK_CLASSES * sizeof(float));
+  for (uint32_t i = 0U; i < slot->count; i++)
+  {
+    const uint32_t image = FerLoader_Image(loader, epoch, start + i);
+    const uint8_t label = loader->labels[image];
+
+    Loader_Convert(&loader->pixels[(uint64_t)image * FER_PACK_PIXELS], &slot->x[(size_t)i * FER_PACK_PIXELS],
+                   cfg->scale, cfg->offset);
+    slot->labels[i] = label;
+    if (label < FER_PACK_CLASSES)
+    {
+      slot->y[((size_t)i * FER_PACK_CLASSES) + label] = 1.0f;
+    }
+  }
+}
+
+/* One image, pixel * scale + offset */
+static void Loader_Convert(const uint8_t *in, float *out, float scale, float offset)
+{
+#if defined(FER_LOADER_AVX2)
+  const __m256 s = _mm256_set1_ps(scale);
+  const __m256 o = _mm256_set1_ps(offset);
+
+  for (uint32_t i = 0U; i < FER_PACK_PIXELS; i += 8U)
+  {
+    const __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(const void *)&in[i]));
+
+    _mm256_storeu_ps(&out[i], _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(v), s), o));
+  }
+#elif defined(FER_LOADER_SSE2)
+  const __m128 s = _mm_set1_ps(scale);
+  const __m128 o = _mm_set1_ps(offset);
+  const __m128i zero = _mm_setzero_si128();
+
+  for (uint32_t i = 0U; i < FER_PACK_PIXELS; i += 16U)
+  {
+    const __m128i v = _mm_loadu_si128((const __m128i *)(const void *)&in[i]);
+    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+    const __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+    _mm_storeu_ps(&out[i], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), s), o));
+    _mm_storeu_ps(&out[i + 4U], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), s), o));
+    _mm_storeu_ps(&out[i + 8U], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), s), o));
+    _mm_storeu_ps(&out[i + 12U], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), s), o));
+  }
+#else
+  for (uint32_t i = 0U; i < FER_PACK_PIXELS; i++)
+  {
+    out[i] = ((float)in[i] * scale) + offset;
+  }
+#endif
+}
+
+/* splitmix64 finalizer */
+static uint64_t Loader_Mix(uint64_t x)
+{
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file           : fer_loader.h
+  * @brief          : Header for fer_loader.c file.
+  *                   Shuffled training batches served from a memory-mapped
+  *                   packed FER2013 file (fer_pack.h) by prefetching
+  *                   worker threads; built as libfer_loader.so and used
+  *                   from Python through fer_loader.py.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FER_LOADER_H
+#define __FER_LOADER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "fer_pack.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define FER_LOADER_SLOTS_MAX    64U
+#define FER_LOADER_WORKERS_MAX  32U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  const char *path;         /* packed file                                 */
+  uint32_t usages;          /* bit (1 << FER_PACK_*) per usage group; they
+                               must be adjacent in the file               */
+  uint32_t batch;           /* images per batch                            */
+  uint32_t workers;         /* filling threads                             */
+  uint32_t slots;           /* batches in flight, filled or being filled   */
+  uint32_t shuffle;         /* new order every epoch                       */
+  uint32_t drop_last;       /* skip the last, partial batch of an epoch    */
+  uint64_t seed;
+  float scale;              /* x = pixel * scale + offset                  */
+  float offset;
+} FerLoader_ConfigTypeDef;
+
+/* One batch, owned by the caller from FerLoader_Next() until
+   FerLoader_Release() */
+typedef struct
+{
+  uint32_t slot;
+  uint32_t count;           /* images, batch or fewer at the end of an epoch */
+  uint64_t index;           /* batches served before this one              */
+  uint32_t epoch;
+  float *x;                 /* [count][48][48][1]                          */
+  float *y;                 /* [count][FER_PACK_CLASSES], one-hot          */
+  uint8_t *labels;          /* [count]                                     */
+} FerLoader_BatchTypeDef;
+
+typedef struct FerLoader_Handle FerLoader_HandleTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+FerLoader_HandleTypeDef *FerLoader_Open(const FerLoader_ConfigTypeDef *config);
+uint32_t FerLoader_Images(const FerLoader_HandleTypeDef *loader);
+uint32_t FerLoader_BatchesPerEpoch(const FerLoader_HandleTypeDef *loader);
+int FerLoader_Next(FerLoader_HandleTypeDef *loader, FerLoader_BatchTypeDef *batch);
+void FerLoader_Release(FerLoader_HandleTypeDef *loader, uint32_t slot);
+void FerLoader_Close(FerLoader_HandleTypeDef *loader);
+uint32_t FerLoader_Image(const FerLoader_HandleTypeDef *loader, uint32_t epoch, uint32_t position);
+const char *FerLoader_Isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FER_LOADER_H */
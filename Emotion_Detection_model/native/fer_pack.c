@@ -0,0 +1,644 @@
+/**
+  ******************************************************************************
+  * @file           : fer_pack.c
+  * @brief          : fer2013.csv -> packed dataset file (fer_pack.h).
+  *
+  *                     fer_pack [-j threads] [-t train] [-o out.fer] fer2013.csv
+  *                     fer_pack -c out.fer fer2013.csv
+  *
+  *                   The CSV is read in one go and cut into one slice of
+  *                   whole lines per thread. A first pass counts the lines
+  *                   of each usage in every slice, which fixes where each
+  *                   line lands in the output; a second pass parses the
+  *                   slices in parallel straight into the memory-mapped
+  *                   output file. The pixel strings are scanned 16 bytes
+  *                   at a time with SSE2: one compare gives the digit mask,
+  *                   the starts of the numbers are the digits not preceded
+  *                   by one, and only those positions are converted.
+  *
+  *                   Files without a Usage column are split by row as
+  *                   dataset_prepare_1.py used to: the first -t rows
+  *                   (28709) train, the rest is the public test.
+  *
+  *                   -c re-reads the CSV with a plain strtol parser and
+  *                   checks a packed file against it.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "fer_pack.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__SSE2__) && !defined(FER_PACK_GENERIC)
+#include <emmintrin.h>
+#endif
+
+/* Private define ------------------------------------------------------------*/
+#define PACK_THREADS_MAX    64U
+#define PACK_PAD            64U         /* readable bytes past the CSV     */
+#define PACK_TRAIN_ROWS     28709U
+#define PACK_ALIGN(n)       (((n) + (FER_PACK_ALIGN - 1U)) & ~(uint64_t)(FER_PACK_ALIGN - 1U))
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char *data;         /* CSV, PACK_PAD zero bytes after the end      */
+  size_t size;
+  const char *body;         /* first line after the header                 */
+  int has_usage;
+  uint32_t train_rows;      /* split when there is no Usage column         */
+} Pack_CsvTypeDef;
+
+typedef struct
+{
+  const Pack_CsvTypeDef *csv;
+  const char *begin;        /* whole lines                                 */
+  const char *end;
+  uint32_t first_row;       /* of the slice, in the CSV                    */
+  uint32_t rows;
+  uint32_t count[FER_PACK_USAGES];
+  uint32_t next[FER_PACK_USAGES];   /* output image of its next line       */
+  uint8_t *out;             /* mapped file                                 */
+  const FerPack_HeaderTypeDef *hdr;
+  uint32_t per_class[FER_PACK_USAGES][FER_PACK_CLASSES];
+  uint32_t bad_row;         /* first malformed row, UINT32_MAX if none     */
+} Pack_SliceTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+/* CSV emotion code -> model class */
+static const uint8_t pack_classes[FER_PACK_CLASSES] =
+{
+  FER_PACK_ANGRY, FER_PACK_DISGUSTED, FER_PACK_FEARFUL, FER_PACK_HAPPY, FER_PACK_SAD, FER_PACK_SURPRISED,
+  FER_PACK_NEUTRAL,
+};
+
+static const char *const pack_usages[FER_PACK_USAGES] = { "Training", "PublicTest", "PrivateTest" };
+
+/* Private function prototypes -----------------------------------------------*/
+static int Pack_Load(const char *path, Pack_CsvTypeDef *csv, uint32_t train_rows);
+static const char *Pack_LineEnd(const char *p, const char *end);
+static int Pack_Group(const Pack_CsvTypeDef *csv, const char *line, const char *eol, uint32_t row);
+static uint32_t Pack_Pixels(const char *p, const char *end, uint8_t *out);
+static int Pack_Line(const char *line, const char *eol, uint8_t *label, uint8_t *pixels);
+static void *Pack_Count(void *arg);
+static void *Pack_Fill(void *arg);
+static int Pack_Write(const Pack_CsvTypeDef *csv, const char *path, uint32_t threads);
+static int Pack_Check(const Pack_CsvTypeDef *csv, const char *path);
+static double Pack_Now(void);
+static void Pack_Help(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  Pack_CsvTypeDef csv;
+  const char *out = "fer2013.fer";
+  const char *check = NULL;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  long train_rows = PACK_TRAIN_ROWS;
+  int failed;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:t:o:c:h")) != -1)
+  {
+    switch (opt)
+    {
+      case 'j':
+        threads = strtol(optarg, NULL, 0);
+        break;
+      case 't':
+        train_rows = strtol(optarg, NULL, 0);
+        break;
+      case 'o':
+        out = optarg;
+        break;
+      case 'c':
+        check = optarg;
+        break;
+      default:
+        Pack_Help(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((optind != (argc - 1)) || (threads < 1) || (train_rows < 0))
+  {
+    Pack_Help(argv[0]);
+    return EXIT_FAILURE;
+  }
+  threads = (threads > (long)PACK_THREADS_MAX) ? (long)PACK_THREADS_MAX : threads;
+
+  if (Pack_Load(argv[optind], &csv, (uint32_t)train_rows) != 0)
+  {
+    return EXIT_FAILURE;
+  }
+  if (check != NULL)
+  {
+    failed = Pack_Check(&csv, check);
+  }
+  else
+  {
+    failed = Pack_Write(&csv, out, (uint32_t)threads);
+  }
+  free((void *)csv.data);
+  return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Read the whole CSV and find its columns */
+static int Pack_Load(const char *path, Pack_CsvTypeDef *csv, uint32_t train_rows)
+{
+  FILE *f = fopen(path, "rb");
+  struct stat st;
+  char *data;
+  const char *eol;
+
+  if ((f == NULL) || (fstat(fileno(f), &st) != 0))
+  {
+    perror(path);
+    if (f != NULL)
+    {
+      fclose(f);
+    }
+    return 1;
+  }
+  data = calloc((size_t)st.st_size + PACK_PAD, 1U);
+  if ((data == NULL) || (fread(data, 1U, (size_t)st.st_size, f) != (size_t)st.st_size))
+  {
+    perror(path);
+    free(data);
+    fclose(f);
+    return 1;
+  }
+  fclose(f);
+
+  csv->data = data;
+  csv->size = (size_t)st.st_size;
+  csv->train_rows = train_rows;
+  csv->has_usage = 0;
+  csv->body = data;
+  if ((csv->size > 0U) && ((data[0] < '0') || (data[0] > '9')))
+  {
+    /* header: emotion,pixels[,Usage] */
+    eol = Pack_LineEnd(data, data + csv->size);
+    csv->has_usage = (memmem(data, (size_t)(eol - data), ",Usage", 6U) != NULL);
+    csv->body = (eol < (data + csv->size)) ? (eol + 1) : eol;
+  }
+  return 0;
+}
+
+/* End of the line at p: its '\n', or end */
+static const char *Pack_LineEnd(const char *p, const char *end)
+{
+  const char *nl = memchr(p, '\n', (size_t)(end - p));
+
+  return (nl != NULL) ? nl : end;
+}
+
+/* Usage group of a line, -1 if unknown */
+static int Pack_Group(const Pack_CsvTypeDef *csv, const char *line, const char *eol, uint32_t row)
+{
+  const char *field;
+
+  if (csv->has_usage == 0)
+  {
+    return (row < csv->train_rows) ? (int)FER_PACK_TRAINING : (int)FER_PACK_PUBLIC_TEST;
+  }
+  while ((eol > line) && ((eol[-1] == '\r') || (eol[-1] == '"')))
+  {
+    eol--;
+  }
+  field = eol;
+  while ((field > line) && (field[-1] != ','))
+  {
+    field--;
+  }
+  if (field[0] == '"')
+  {
+    field++;
+  }
+  for (uint32_t u = 0U; u < FER_PACK_USAGES; u++)
+  {
+    const size_t len = strlen(pack_usages[u]);
+
+    if (((size_t)(eol - field) == len) && (memcmp(field, pack_usages[u], len) == 0))
+    {
+      return (int)u;
+    }
+  }
+  return -1;
+}
+
+/* Space-separated values 0..255 in [p, end) -> out; returns how many, or
+   UINT32_MAX if anything else is found or there are more than
+   FER_PACK_PIXELS. Reads up to 15 bytes past end. */
+static uint32_t Pack_Pixels(const char *p, const char *end, uint8_t *out)
+{
+  uint32_t n = 0U;
+
+#if defined(__SSE2__) && !defined(FER_PACK_GENERIC)
+  const __m128i zero = _mm_set1_epi8('0' - 1);
+  const __m128i nine = _mm_set1_epi8('9' + 1);
+  const __m128i space = _mm_set1_epi8(' ');
+  uint32_t carry = 0U;
+
+  for (; p < end; p += 16)
+  {
+    const __m128i v = _mm_loadu_si128((const __m128i *)(const void *)p);
+    const uint32_t valid = ((end - p) >= 16) ? 0xFFFFU : ((1U << (end - p)) - 1U);
+    const uint32_t digits = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(v, zero),
+                                                                      _mm_cmplt_epi8(v, nine))) & valid;
+    const uint32_t spaces = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, space)) & valid;
+    uint32_t starts = digits & ~((digits << 1) | carry);
+
+    if ((digits | spaces) != valid)
+    {
+      return UINT32_MAX;
+    }
+    carry = (digits >> 15) & 1U;
+    while (starts != 0U)
+    {
+      const char *q = p + __builtin_ctz(starts);
+      uint32_t value = (uint32_t)(q[0] - '0');
+
+      starts &= starts - 1U;
+      for (uint32_t k = 1U; ((q + k) < end) && (q[k] >= '0') && (q[k] <= '9'); k++)
+      {
+        value = (value * 10U) + (uint32_t)(q[k] - '0');
+        if ((k == 3U) || (value > 255U))
+        {
+          return UINT32_MAX;
+        }
+      }
+      if (n == FER_PACK_PIXELS)
+      {
+        return UINT32_MAX;
+      }
+      out[n++] = (uint8_t)value;
+    }
+  }
+#else
+  uint32_t value = 0U;
+  uint32_t digits = 0U;
+
+  for (; p <= end; p++)
+  {
+    const char c = (p < end) ? *p : ' ';
+
+    if ((c >= '0') && (c <= '9'))
+    {
+      value = (value * 10U) + (uint32_t)(c - '0');
+      if ((++digits > 3U) || (value > 255U))
+      {
+        return UINT32_MAX;
+      }
+    }
+    else if (c == ' ')
+    {
+      if (digits != 0U)
+      {
+        if (n == FER_PACK_PIXELS)
+        {
+          return UINT32_MAX;
+        }
+        out[n++] = (uint8_t)value;
+      }
+      value = 0U;
+      digits = 0U;
+    }
+    else
+    {
+      return UINT32_MAX;
+    }
+  }
+#endif
+  return n;
+}
+
+/* Label and pixels of one line; 0 if well formed */
+static int Pack_Line(const char *line, const char *eol, uint8_t *label, uint8_t *pixels)
+{
+  const char *p = line;
+  const char *end;
+
+  if ((p >= eol) || (*p < '0') || (*p > '6') || (p[1] != ','))
+  {
+    return 1;
+  }
+  *label = pack_classes[*p - '0'];
+  p += 2;
+  if (*p == '"')
+  {
+    p++;
+  }
+  end = memchr(p, ',', (size_t)(eol - p));
+  end = (end != NULL) ? end : eol;
+  while ((end > p) && ((end[-1] == '\r') || (end[-1] == '"')))
+  {
+    end--;
+  }
+  return (Pack_Pixels(p, end, pixels) == FER_PACK_PIXELS) ? 0 : 1;
+}
+
+/* Pass 1: lines of each usage in a slice */
+static void *Pack_Count(void *arg)
+{
+  Pack_SliceTypeDef *s = arg;
+
+  for (const char *line = s->begin; line < s->end;)
+  {
+    const char *eol = Pack_LineEnd(line, s->end);
+
+    if ((eol - line) > 1)
+    {
+      if (s->csv->has_usage != 0)
+      {
+        const int u = Pack_Group(s->csv, line, eol, 0U);
+
+        if (u < 0)
+        {
+          s->bad_row = (s->bad_row == UINT32_MAX) ? s->rows : s->bad_row;
+        }
+        else
+        {
+          s->count[u]++;
+        }
+      }
+      s->rows++;
+    }
+    line = eol + 1;
+  }
+  return NULL;
+}
+
+/* Pass 2: parse a slice into its places in the output */
+static void *Pack_Fill(void *arg)
+{
+  Pack_SliceTypeDef *s = arg;
+  uint8_t *labels = &s->out[s->hdr->labels];
+  uint8_t *usage = &s->out[s->hdr->usage];
+  uint8_t *pixels = &s->out[s->hdr->pixels];
+  uint32_t row = s->first_row;
+
+  for (const char *line = s->begin; line < s->end;)
+  {
+    const char *eol = Pack_LineEnd(line, s->end);
+
+    if ((eol - line) > 1)
+    {
+      const int u = Pack_Group(s->csv, line, eol, row);
+      const uint32_t at = (u >= 0) ? s->next[u]++ : 0U;
+
+      if ((u < 0) || (Pack_Line(line, eol, &labels[at], &pixels[(uint64_t)at * FER_PACK_PIXELS]) != 0))
+      {
+        s->bad_row = row;
+        return NULL;
+      }
+      usage[at] = (uint8_t)u;
+      s->per_class[u][labels[at]]++;
+      row++;
+    }
+    line = eol + 1;
+  }
+  return NULL;
+}
+
+static int Pack_Write(const Pack_CsvTypeDef *csv, const char *path, uint32_t threads)
+{
+  static Pack_SliceTypeDef slices[PACK_THREADS_MAX];
+  pthread_t tids[PACK_THREADS_MAX];
+  FerPack_HeaderTypeDef hdr;
+  const char *end = csv->data + csv->size;
+  const double start = Pack_Now();
+  char tmp[4096];
+  uint32_t rows = 0U;
+  uint8_t *map;
+  int fd;
+
+  /* slices of whole lines */
+  memset(slices, 0, sizeof(slices));
+  for (uint32_t t = 0U; t < threads; t++)
+  {
+    const char *cut = csv->body + ((size_t)(end - csv->body) * (t + 1U) / threads);
+
+    slices[t].csv = csv;
+    slices[t].begin = (t == 0U) ? csv->body : slices[t - 1U].end;
+    slices[t].end = (t == (threads - 1U)) ? end : Pack_LineEnd((cut > slices[t].begin) ? cut : slices[t].begin, end);
+    slices[t].end += ((slices[t].end < end) && (t != (threads - 1U))) ? 1 : 0;
+    slices[t].bad_row = UINT32_MAX;
+    pthread_create(&tids[t], NULL, Pack_Count, &slices[t]);
+  }
+  for (uint32_t t = 0U; t < threads; t++)
+  {
+    pthread_join(tids[t], NULL);
+    if (slices[t].bad_row != UINT32_MAX)
+    {
+      fprintf(stderr, "line %lu: unknown usage\n", (unsigned long)(rows + slices[t].bad_row + 2U));
+      return 1;
+    }
+    slices[t].first_row = rows;
+    rows += slices[t].rows;
+    if (csv->has_usage == 0)
+    {
+      /* split by row number */
+      const uint32_t train = (rows < csv->train_rows) ? rows : csv->train_rows;
+      const uint32_t before = (slices[t].first_row < csv->train_rows) ? slices[t].first_row : csv->train_rows;
+
+      slices[t].count[FER_PACK_TRAINING] = train - before;
+      slices[t].count[FER_PACK_PUBLIC_TEST] = slices[t].rows - (train - before);
+    }
+  }
+
+  /* layout: usage groups in order, slices in order within a group */
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = FER_PACK_MAGIC;
+  hdr.header_bytes = sizeof(hdr);
+  hdr.count = rows;
+  hdr.height = FER_PACK_SIZE;
+  hdr.width = FER_PACK_SIZE;
+  hdr.labels = PACK_ALIGN(sizeof(hdr));
+  hdr.usage = PACK_ALIGN(hdr.labels + rows);
+  hdr.pixels = PACK_ALIGN(hdr.usage + rows);
+  hdr.size = hdr.pixels + ((uint64_t)rows * FER_PACK_PIXELS);
+  for (uint32_t u = 0U, at = 0U; u < FER_PACK_USAGES; u++)
+  {
+    hdr.first[u] = at;
+    for (uint32_t t = 0U; t < threads; t++)
+    {
+      slices[t].next[u] = at;
+      at += slices[t].count[u];
+    }
+    hdr.images[u] = at - hdr.first[u];
+  }
+
+  /* written under a temporary name, renamed when complete */
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if ((fd < 0) || (ftruncate(fd, (off_t)hdr.size) != 0))
+  {
+    perror(tmp);
+    return 1;
+  }
+  map = mmap(NULL, (size_t)hdr.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED)
+  {
+    perror(tmp);
+    close(fd);
+    return 1;
+  }
+  for (uint32_t t = 0U; t < threads; t++)
+  {
+    slices[t].out = map;
+    slices[t].hdr = &hdr;
+    pthread_create(&tids[t], NULL, Pack_Fill, &slices[t]);
+  }
+  for (uint32_t t = 0U; t < threads; t++)
+  {
+    pthread_join(tids[t], NULL);
+  }
+  for (uint32_t t = 0U; t < threads; t++)
+  {
+    if (slices[t].bad_row != UINT32_MAX)
+    {
+      fprintf(stderr, "line %lu: malformed\n", (unsigned long)slices[t].bad_row + 2UL);
+      munmap(map, (size_t)hdr.size);
+      close(fd);
+      unlink(tmp);
+      return 1;
+    }
+    for (uint32_t u = 0U; u < FER_PACK_USAGES; u++)
+    {
+      for (uint32_t c = 0U; c < FER_PACK_CLASSES; c++)
+      {
+        hdr.per_class[u][c] += slices[t].per_class[u][c];
+      }
+    }
+  }
+  memcpy(map, &hdr, sizeof(hdr));
+  if ((munmap(map, (size_t)hdr.size) != 0) || (close(fd) != 0) || (rename(tmp, path) != 0))
+  {
+    perror(path);
+    return 1;
+  }
+
+  {
+    const double s = Pack_Now() - start;
+
+    printf("%s: %lu images (training %lu, public test %lu, private test %lu), %lu bytes\n", path,
+           (unsigned long)rows, (unsigned long)hdr.images[0], (unsigned long)hdr.images[1],
+           (unsigned long)hdr.images[2], (unsigned long)hdr.size);
+    printf("%lu threads, %.3f s, %.0f MB/s of CSV\n", (unsigned long)threads, s,
+           (s > 0.0) ? ((double)csv->size / 1e6 / s) : 0.0);
+  }
+  return 0;
+}
+
+/* Compare a packed file with the CSV, parsed the slow way */
+static int Pack_Check(const Pack_CsvTypeDef *csv, const char *path)
+{
+  const char *end = csv->data + csv->size;
+  FerPack_HeaderTypeDef hdr;
+  uint32_t next[FER_PACK_USAGES];
+  uint32_t per_class[FER_PACK_USAGES][FER_PACK_CLASSES] = { { 0U } };
+  uint32_t row = 0U;
+  struct stat st;
+  const uint8_t *map;
+  int fd = open(path, O_RDONLY);
+
+  if ((fd < 0) || (fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(hdr)))
+  {
+    perror(path);
+    return 1;
+  }
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    perror(path);
+    return 1;
+  }
+  memcpy(&hdr, map, sizeof(hdr));
+  if ((hdr.magic != FER_PACK_MAGIC) || (hdr.header_bytes != sizeof(hdr)) || (hdr.size != (uint64_t)st.st_size)
+      || (hdr.height != FER_PACK_SIZE) || (hdr.width != FER_PACK_SIZE)
+      || (hdr.pixels + ((uint64_t)hdr.count * FER_PACK_PIXELS) != hdr.size))
+  {
+    fprintf(stderr, "%s: bad header\n", path);
+    return 1;
+  }
+  memcpy(next, hdr.first, sizeof(next));
+
+  for (const char *line = csv->body; line < end;)
+  {
+    const char *eol = Pack_LineEnd(line, end);
+    char *p;
+
+    if ((eol - line) > 1)
+    {
+      const int u = Pack_Group(csv, line, eol, row);
+      const long code = strtol(line, &p, 10);
+      const uint32_t at = (u >= 0) ? next[u]++ : 0U;
+
+      if ((u < 0) || (code < 0) || (code >= (long)FER_PACK_CLASSES) || (at >= hdr.count)
+          || (map[hdr.labels + at] != pack_classes[code]) || (map[hdr.usage + at] != (uint8_t)u))
+      {
+        fprintf(stderr, "line %lu: label or usage differs\n", (unsigned long)row + 2UL);
+        return 1;
+      }
+      per_class[u][pack_classes[code]]++;
+      p += (p[1] == '"') ? 2 : 1;
+      for (uint32_t i = 0U; i < FER_PACK_PIXELS; i++)
+      {
+        if (strtol(p, &p, 10) != (long)map[hdr.pixels + ((uint64_t)at * FER_PACK_PIXELS) + i])
+        {
+          fprintf(stderr, "line %lu: pixel %lu differs\n", (unsigned long)row + 2UL, (unsigned long)i);
+          return 1;
+        }
+      }
+      row++;
+    }
+    line = eol + 1;
+  }
+  if ((row != hdr.count) || (memcmp(per_class, hdr.per_class, sizeof(per_class)) != 0))
+  {
+    fprintf(stderr, "%s: %lu images, the CSV has %lu\n", path, (unsigned long)hdr.count, (unsigned long)row);
+    return 1;
+  }
+  for (uint32_t u = 0U; u < FER_PACK_USAGES; u++)
+  {
+    if (next[u] != (hdr.first[u] + hdr.images[u]))
+    {
+      fprintf(stderr, "%s: %s group size differs\n", path, pack_usages[u]);
+      return 1;
+    }
+  }
+  printf("%s: %lu images match the CSV\n", path, (unsigned long)row);
+  return 0;
+}
+
+static double Pack_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static void Pack_Help(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-j threads] [-t train] [-o out.fer] fer2013.csv\n"
+          "       %s -c out.fer fer2013.csv\n"
+          "  -j     parsing threads (all cores)\n"
+          "  -t     training rows when the CSV has no Usage column (28709)\n"
+          "  -o     packed file (fer2013.fer)\n"
+          "  -c     check a packed file against the CSV\n",
+          argv0, argv0);
+}
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file           : fer_pack.h
+  * @brief          : Packed FER2013 dataset file, written by fer_pack from
+  *                   fer2013.csv and read in place (memory-mapped) by the
+  *                   training and evaluation code.
+  *
+  *                   Layout, little endian, every section 64-byte aligned:
+  *                     header    FerPack_HeaderTypeDef
+  *                     labels    uint8 [count], class in model order
+  *                     usage     uint8 [count], FER_PACK_TRAINING ...
+  *                     pixels    uint8 [count][48][48], rows top to bottom
+  *                   Images are grouped by usage (training, public test,
+  *                   private test), in CSV order within a group, so every
+  *                   split is one contiguous slice of the file.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FER_PACK_H
+#define __FER_PACK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define FER_PACK_MAGIC          0x31524546U     /* "FER1" */
+#define FER_PACK_ALIGN          64U
+
+#define FER_PACK_SIZE           48U
+#define FER_PACK_PIXELS         (FER_PACK_SIZE * FER_PACK_SIZE)
+
+/* Classes in the order of the model (the alphabetical folders of
+   dataset_prepare_1.py), not the emotion codes of the CSV */
+#define FER_PACK_ANGRY          0U
+#define FER_PACK_DISGUSTED      1U
+#define FER_PACK_FEARFUL        2U
+#define FER_PACK_HAPPY          3U
+#define FER_PACK_NEUTRAL        4U
+#define FER_PACK_SAD            5U
+#define FER_PACK_SURPRISED      6U
+#define FER_PACK_CLASSES        7U
+
+/* Usage column of the CSV */
+#define FER_PACK_TRAINING       0U
+#define FER_PACK_PUBLIC_TEST    1U
+#define FER_PACK_PRIVATE_TEST   2U
+#define FER_PACK_USAGES         3U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t magic;
+  uint32_t header_bytes;    /* sizeof(FerPack_HeaderTypeDef)               */
+  uint32_t count;           /* images                                      */
+  uint16_t height;
+  uint16_t width;
+  uint64_t labels;          /* section offsets                             */
+  uint64_t usage;
+  uint64_t pixels;
+  uint64_t size;            /* of the file                                 */
+  uint32_t first[FER_PACK_USAGES];                  /* of each usage group */
+  uint32_t images[FER_PACK_USAGES];
+  uint32_t per_class[FER_PACK_USAGES][FER_PACK_CLASSES];
+  uint8_t reserved[4];
+} FerPack_HeaderTypeDef;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FER_PACK_H */
@@ -0,0 +1,879 @@
+/**
+  ******************************************************************************
+  * @file           : fer_stream.c
+  * @brief          : Real-time face detection and emotion classification of a
+  *                   video or an image sequence, as emotion_2.py --mode
+  *                   display, on a pipeline of threads.
+  *
+  *                     fer_stream -c cascade.xml [-m emotion_net.bin]
+  *                                [-r WxH] [-o results.txt] [-q depth] [-p]
+  *                                [-n frames] [-f scale] [-k neighbors]
+  *                                [-z min_size] [-t threads] source...
+  *
+  *                   Sources are read in order, "-" being stdin. Each one
+  *                   holds one or more binary PGM (P5) or PPM (P6) images,
+  *                   so an image sequence is a list of files and a video
+  *                   is piped in by ffmpeg:
+  *
+  *                     ffmpeg -i clip.mp4 -f image2pipe -vcodec pgm - |
+  *                       fer_stream -c haarcascade_frontalface_default.xml
+  *                                  -m emotion_net.bin -
+  *
+  *                   With -r the sources are raw 8-bit gray frames of that
+  *                   size instead (ffmpeg -f rawvideo -pix_fmt gray).
+  *
+  *                   Four stages run on their own threads, pinned to their
+  *                   own core with -p, each frame passing through them in
+  *                   order:
+  *                     decode    read the next frame, colour to gray
+  *                     detect    Haar cascade of fer_detect.c, loaded once,
+  *                               on -t threads of its own
+  *                     crop      each face to 48x48, bilinear
+  *                     classify  every face of the frame through the int8
+  *                               CNN of srcs/emotion_net.c in one step
+  *                   The stages hand frames over through bounded lock-free
+  *                   single-producer single-consumer rings of -q frames;
+  *                   the main thread writes the results and gives each
+  *                   frame back to decode through one more ring, so frames
+  *                   are allocated once and a slow stage holds the others
+  *                   back instead of letting frames pile up.
+  *
+  *                   The results, one line per frame, go to -o:
+  *                     frame faces [x y width height label probability]...
+  *                   and the timing to stdout: per stage the frames per
+  *                   second it would sustain alone, its share of the wall
+  *                   time, its latency percentiles and the time it waited
+  *                   for frames and for room downstream; then the frames
+  *                   per second and the end-to-end latency of the stream,
+  *                   and where the cascade rejected the windows.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE
+
+/* Includes ------------------------------------------------------------------*/
+#include "fer_detect.h"
+#include "emotion_net.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define STREAM_DECODE       0U
+#define STREAM_DETECT       1U
+#define STREAM_CROP         2U
+#define STREAM_CLASSIFY     3U
+#define STREAM_STAGES       4U
+
+#define STREAM_FACES_MAX    16U         /* per frame                       */
+#define STREAM_DEPTH_MAX    64U         /* frames per ring                 */
+#define STREAM_POOL_MAX     ((STREAM_DEPTH_MAX * (STREAM_STAGES + 1U)) + STREAM_STAGES + 1U)
+#define STREAM_SPINS        256U        /* before yielding the core        */
+#define STREAM_YIELDS       64U         /* before sleeping                 */
+#define STREAM_NAP_NS       50000L
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint64_t index;           /* in the stream                               */
+  uint32_t last;            /* end of the stream, carries no image         */
+  uint32_t width;
+  uint32_t height;
+  uint8_t *gray;
+  size_t capacity;
+  uint32_t faces;
+  FerDetect_RectTypeDef face[STREAM_FACES_MAX];
+  uint8_t crop[STREAM_FACES_MAX][EMOTION_NET_INPUT_BYTES];
+  EmotionNet_ResultTypeDef result[STREAM_FACES_MAX];
+  double start[STREAM_STAGES];
+  double end[STREAM_STAGES];
+} Stream_FrameTypeDef;
+
+/* One producer and one consumer; head and tail on their own cache lines */
+typedef struct
+{
+  _Alignas(64) atomic_uint_fast64_t head;       /* next to take            */
+  _Alignas(64) atomic_uint_fast64_t tail;       /* next to fill            */
+  _Alignas(64) uint32_t size;
+  Stream_FrameTypeDef *slot[STREAM_POOL_MAX];
+} Stream_QueueTypeDef;
+
+typedef struct Stream_Stage Stream_StageTypeDef;
+
+struct Stream_Stage
+{
+  const char *name;
+  int (*step)(Stream_StageTypeDef *stage, Stream_FrameTypeDef *frame);
+  Stream_QueueTypeDef *in;
+  Stream_QueueTypeDef *out;
+  int cpu;                  /* -1 when not pinned                          */
+  double wait_in;           /* seconds without a frame to work on          */
+  double wait_out;          /* seconds without room downstream             */
+  pthread_t thread;
+};
+
+typedef struct
+{
+  double *ms;               /* [STREAM_STAGES + 1][frames], the last row
+                               end-to-end                                  */
+  uint64_t frames;
+  uint64_t capacity;
+  uint64_t faces;
+} Stream_StatsTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+/* decode */
+static char **stream_sources;
+static int stream_source_count;
+static int stream_source_next;
+static FILE *stream_file;
+static uint32_t stream_raw_width;
+static uint32_t stream_raw_height;
+static uint64_t stream_frames_max = UINT64_MAX;
+static uint64_t stream_decoded;
+
+/* detect */
+static FerDetect_CascadeTypeDef *stream_cascade;
+static FerDetect_WorkTypeDef *stream_work;
+static FerDetect_ParamsTypeDef stream_params = FER_DETECT_PARAMS_DEFAULT;
+static uint32_t stream_detect_threads = 1U;
+
+/* classify */
+static uint8_t *stream_blob;
+
+static atomic_int stream_failed;
+
+/* Private function prototypes -----------------------------------------------*/
+static void *Stream_Thread(void *arg);
+static int Stream_Decode(Stream_StageTypeDef *stage, Stream_FrameTypeDef *frame);
+static int Stream_Detect(Stream_StageTypeDef *stage, Stream_FrameTypeDef *frame);
+static int Stream_Crop(Stream_StageTypeDef *stage, Stream_FrameTypeDef *frame);
+static int Stream_Classify(Stream_StageTypeDef *stage, Stream_FrameTypeDef *frame);
+static int Stream_ReadPnm(FILE *f, const char *name, Stream_FrameTypeDef *frame);
+static int Stream_ReadRaw(FILE *f, const char *name, Stream_FrameTypeDef *frame);
+static int Stream_Reserve(Stream_FrameTypeDef *frame, uint32_t width, uint32_t height, uint32_t channels);
+static int Stream_HeaderField(FILE *f, uint32_t *value);
+static void Stream_Push(Stream_QueueTypeDef *q, Stream_FrameTypeDef *frame, double *waited);
+static Stream_FrameTypeDef *Stream_Pop(Stream_QueueTypeDef *q, double *waited);
+static void Stream_Wait(uint32_t *tries);
+static int Stream_Record(Stream_StatsTypeDef *stats, const Stream_FrameTypeDef *frame);
+static void Stream_Report(const Stream_StatsTypeDef *stats, const Stream_StageTypeDef *stages, double wall);
+static void Stream_ReportDetect(void);
+static void Stream_Percentiles(double *ms, uint64_t n, double *p50, double *p90, double *p99, double *max);
+static int Stream_Compare(const void *a, const void *b);
+static uint8_t *Stream_ReadFile(const char *path, uint32_t *size);
+static double Stream_Now(void);
+static void Stream_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  static Stream_QueueTypeDef queues[STREAM_STAGES + 1U];
+  Stream_StageTypeDef stages[STREAM_STAGES] =
+  {
+    { .name = "decode", .step = Stream_Decode },
+    { .name = "detect", .step = Stream_Detect },
+    { .name = "crop", .step = Stream_Crop },
+    { .name = "classify", .step = Stream_Classify },
+  };
+  const char *cascade = NULL;
+  const char *model = NULL;
+  const char *results = NULL;
+  uint32_t depth = 4U;
+  int pin = 0;
+  Stream_FrameTypeDef *pool;
+  uint32_t pool_size;
+  Stream_StatsTypeDef stats = { 0 };
+  FILE *out = NULL;
+  cpu_set_t cpus;
+  int cpu = 0;
+  double start;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "c:m:r:o:q:pn:f:k:z:t:h")) != -1)
+  {
+    switch (opt)
+    {
+      case 'c':
+        cascade = optarg;
+        break;
+      case 'm':
+        model = optarg;
+        break;
+      case 'r':
+        if ((sscanf(optarg, "%ux%u", &stream_raw_width, &stream_raw_height) != 2) || (stream_raw_width == 0U)
+            || (stream_raw_height == 0U))
+        {
+          Stream_Usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'o':
+        results = optarg;
+        break;
+      case 'q':
+        depth = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'p':
+        pin = 1;
+        break;
+      case 'n':
+        stream_frames_max = strtoull(optarg, NULL, 0);
+        break;
+      case 'f':
+        stream_params.scale_factor = strtof(optarg, NULL);
+        break;
+      case 'k':
+        stream_params.min_neighbors = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'z':
+        stream_params.min_size = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 't':
+        stream_detect_threads = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        Stream_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((cascade == NULL) || (optind == argc) || (depth == 0U) || (depth > STREAM_DEPTH_MAX)
+      || (stream_params.scale_factor <= 1.0f) || (stream_detect_threads == 0U)
+      || (stream_detect_threads > FER_DETECT_THREADS_MAX))
+  {
+    Stream_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  stream_sources = &argv[optind];
+  stream_source_count = argc - optind;
+
+  /* everything a stage needs is loaded before the first frame */
+  stream_cascade = FerDetect_Load(cascade);
+  stream_work = FerDetect_WorkNew(stream_detect_threads);
+  if ((stream_cascade == NULL) || (stream_work == NULL))
+  {
+    return EXIT_FAILURE;
+  }
+  if (model != NULL)
+  {
+    uint32_t size;
+
+    stream_blob = Stream_ReadFile(model, &size);
+    if ((stream_blob == NULL) || (EmotionNet_Init(stream_blob, size) != HAL_OK))
+    {
+      fprintf(stderr, "%s: not an emotion_net blob\n", model);
+      return EXIT_FAILURE;
+    }
+  }
+  if (results != NULL)
+  {
+    out = (strcmp(results, "-") == 0) ? stdout : fopen(results, "w");
+    if (out == NULL)
+    {
+      perror(results);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* ring k feeds stage k, the last one the main thread; a frame is in a
+     ring, in a stage or in the main thread */
+  pool_size = (depth * (STREAM_STAGES + 1U)) + STREAM_STAGES + 1U;    /* STREAM_POOL_MAX at most */
+  pool = calloc(pool_size, sizeof(*pool));
+  if (pool == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+  for (uint32_t q = 0U; q <= STREAM_STAGES; q++)
+  {
+    queues[q].size = (q == 0U) ? pool_size : depth;
+    atomic_init(&queues[q].head, 0U);
+    atomic_init(&queues[q].tail, 0U);
+  }
+  for (uint32_t i = 0U; i < pool_size; i++)
+  {
+    Stream_Push(&queues[0], &pool[i], NULL);
+  }
+
+  CPU_ZERO(&cpus);
+  (void)sched_getaffinity(0, sizeof(cpus), &cpus);
+  start = Stream_Now();
+  for (uint32_t s = 0U; s < STREAM_STAGES; s++)
+  {
+    stages[s].in = &queues[s];
+    stages[s].out = &queues[s + 1U];
+    stages[s].cpu = -1;
+    if (pin != 0)
+    {
+      /* the next allowed core, round robin when there are fewer cores
+         than stages */
+      for (uint32_t tries = 0U; tries < CPU_SETSIZE; tries++, cpu = (cpu + 1) % CPU_SETSIZE)
+      {
+        if (CPU_ISSET(cpu, &cpus))
+        {
+          stages[s].cpu = cpu;
+          cpu = (cpu + 1) % CPU_SETSIZE;
+          break;
+        }
+      }
+    }
+    if (pthread_create(&stages[s].thread, NULL, Stream_Thread, &stages[s]) != 0)
+    {
+      fprintf(stderr, "cannot start the %s stage\n", stages[s].name);
+      return EXIT_FAILURE;
+    }
+  }
+
+  for (;;)
+  {
+    Stream_FrameTypeDef *frame = Stream_Pop(&queues[STREAM_STAGES], NULL);
+
+    if (frame->last != 0U)
+    {
+      break;
+    }
+    if (Stream_Record(&stats, frame) != 0)
+    {
+      atomic_store(&stream_failed, 1);
+    }
+    if (out != NULL)
+    {
+      fprintf(out, "%llu %lu", (unsigned long long)frame->index, (unsigned long)frame->faces);
+      for (uint32_t i = 0U; i < frame->faces; i++)
+      {
+        const FerDetect_RectTypeDef *r = &frame->face[i];
+
+        fprintf(out, " %ld %ld %ld %ld", (long)r->x, (long)r->y, (long)r->width, (long)r->height);
+        if (stream_blob != NULL)
+        {
+          fprintf(out, " %s %.3f", EmotionNet_LabelName(frame->result[i].label),
+                  (double)frame->result[i].probability[frame->result[i].label]);
+        }
+        else
+        {
+          fprintf(out, " - 0");
+        }
+      }
+      fputc('\n', out);
+    }
+    Stream_Push(&queues[0], frame, NULL);
+  }
+  for (uint32_t s = 0U; s < STREAM_STAGES; s++)
+  {
+    (void)pthread_join(stages[s].thread, NULL);
+  }
+  Stream_Report(&stats, stages, Stream_Now() - start);
+  Stream_ReportDetect();
+
+  if ((out != NULL) && (out != stdout) && (fclose(out) != 0))
+  {
+    perror(results);
+    atomic_store(&stream_failed, 1);
+  }
+  for (uint32_t i = 0U; i < pool_size; i++)
+  {
+    free(pool[i].gray);
+  }
+  free(pool);
+  free(stats.ms);
+  free(stream_blob);
+  FerDetect_WorkFree(stream_work);
+  FerDetect_Free(stream_cascade);
+  return (atomic_load(&stream_failed) != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* A stage: take a frame, work on it, pass it on, until the last frame */
+static void *Stream_Thread(void *arg)
+{
+  Stream_StageTypeDef *stage = arg;
+  uint32_t last = 0U;
+
+  if (stage->cpu >= 0)
+  {
+    cpu_set_t one;
+
+    CPU_ZERO(&one);
+    CPU_SET(stage->cpu, &one);
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+  }
+  while (last == 0U)
+  {
+    Stream_FrameTypeDef *frame = Stream_Pop(stage->in, &stage->wait_in);
+
+    /* after a failure the frames in flight still go round, and decode
+       ends the stream */
+    if ((frame->last == 0U) && (stage->step(stage, frame) != 0))
+    {
+      atomic_store(&stream_failed, 1);
+    }
+    last = frame->last;
+    Stream_Push(stage->out, frame, &stage->wait_out);
+  }
+  return NULL;
+}
+
+static int Stream_Decode(Stream_StageTypeDef *stage, Stream_FrameTypeDef *frame)
+{
+  (void)stage;
+  frame->start[STREAM_DECODE] = Stream_Now();
+  frame->faces = 0U;
+  while ((stream_decoded < stream_frames_max) && (atomic_load(&stream_failed) == 0))
+  {
+    int got;
+
+    if (stream_file == NULL)
+    {
+      const char *name;
+
+      if (stream_source_next == stream_source_count)
+      {
+        break;
+      }
+      name = stream_sources[stream_source_next];
+      stream_file = (strcmp(name, "-") == 0) ? stdin : fopen(name, "rb");
+      if (stream_file == NULL)
+      {
+        perror(name);
+        frame->last = 1U;
+        return 1;
+      }
+    }
+    got = (stream_raw_width != 0U) ? Stream_ReadRaw(stream_file, stream_sources[stream_source_next], frame)
+                                   : Stream_ReadPnm(stream_file, stream_sources[stream_source_next], frame);
+    if (got > 0)
+    {
+      frame->index = stream_decoded++;
+      frame->end[STREAM_DECODE] = Stream_Now();
+      return 0;
+    }
+    if (stream_file != stdin)
+    {
+      fclose(stream_file);
+    }
+    stream_file = NULL;
+    stream_source_next++;
+    if (got < 0)
+    {
+      frame->last = 1U;
+      return 1;
+    }
+  }
+  if ((stream_file != NULL) && (stream_file != stdin))
+  {
+    fclose(stream_file);
+  }
+  stream_file = NULL;
+  frame->last = 1U;
+  return 0;
+}
+
+static int Stream_Detect(Stream_StageTypeDef *stage, Stream_FrameTypeDef *frame)
+{
+  int found;
+
+  (void)stage;
+  frame->start[STREAM_DETECT] = Stream_Now();
+  found = FerDetect_Run(stream_cascade, &stream_params, frame->gray, frame->width, frame->height, frame->width,
+                        stream_work, frame->face, STREAM_FACES_MAX);
+  frame->faces = (found > 0) ? (uint32_t)found : 0U;
+  frame->end[STREAM_DETECT] = Stream_Now();
+  return (found < 0);
+}
+
+/* Faces to 48x48, as cv2.resize(gray[y:y + h, x:x + w], (48, 48)) with
+   the box clipped to the frame */
+static int Stream_Crop(Stream_StageTypeDef *stage, Stream_FrameTypeDef *frame)
+{
+  (void)stage;
+  frame->start[STREAM_CROP] = Stream_Now();
+  for (uint32_t i = 0U; i < frame->faces; i++)
+  {
+    const FerDetect_RectTypeDef *r = &frame->face[i];
+    const int32_t x0 = (r->x > 0) ? r->x : 0;
+    const int32_t y0 = (r->y > 0) ? r->y : 0;
+    const int32_t x1 = ((r->x + r->width) < (int32_t)frame->width) ? (r->x + r->width) : (int32_t)frame->width;
+    const int32_t y1 = ((r->y + r->height) < (int32_t)frame->height) ? (r->y + r->height) : (int32_t)frame->height;
+
+    FerDetect_Resize(&frame->gray[((size_t)y0 * frame->width) + (size_t)x0], (uint32_t)(x1 - x0),
+                     (uint32_t)(y1 - y0), frame->width, frame->crop[i], EMOTION_NET_INPUT_SIZE,
+                     EMOTION_NET_INPUT_SIZE);
+  }
+  frame->end[STREAM_CROP] = Stream_Now();
+  return 0;
+}
+
+/* All the faces of the frame back to back, the weights staying in cache */
+static int Stream_Classify(Stream_StageTypeDef *stage, Stream_FrameTypeDef *frame)
+{
+  int failed = 0;
+
+  (void)stage;
+  frame->start[STREAM_CLASSIFY] = Stream_Now();
+  for (uint32_t i = 0U; (i < frame->faces) && (stream_blob != NULL); i++)
+  {
+    failed |= (EmotionNet_Run(frame->crop[i], &frame->result[i]) != HAL_OK);
+  }
+  frame->end[STREAM_CLASSIFY] = Stream_Now();
+  return failed;
+}
+
+/* Next P5 or P6 image of a stream: 1 read, 0 at the end, -1 if damaged */
+static int Stream_ReadPnm(FILE *f, const char *name, Stream_FrameTypeDef *frame)
+{
+  int c;
+  uint32_t width;
+  uint32_t height;
+  uint32_t maxval;
+  uint32_t channels;
+
+  do
+  {
+    c = fgetc(f);
+  } while ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'));
+  if (c == EOF)
+  {
+    return 0;
+  }
+  c = (c == 'P') ? fgetc(f) : EOF;
+  channels = (c == '5') ? 1U : ((c == '6') ? 3U : 0U);
+  if ((channels == 0U) || (Stream_HeaderField(f, &width) != 0) || (Stream_HeaderField(f, &height) != 0)
+      || (Stream_HeaderField(f, &maxval) != 0) || (maxval == 0U) || (maxval > 255U) || (width == 0U)
+      || (height == 0U) || (width > 16384U) || (height > 16384U) || (Stream_Reserve(frame, width, height, channels) != 0)
+      || (fread(frame->gray, channels, (size_t)width * height, f) != ((size_t)width * height)))
+  {
+    fprintf(stderr, "%s: not a binary PGM or PPM image\n", name);
+    return -1;
+  }
+  if (channels == 3U)
+  {
+    /* cv2.COLOR_RGB2GRAY, in place */
+    for (size_t i = 0U; i < ((size_t)width * height); i++)
+    {
+      const uint8_t *rgb = &frame->gray[3U * i];
+
+      frame->gray[i] = (uint8_t)(((rgb[0] * 4899U) + (rgb[1] * 9617U) + (rgb[2] * 1868U) + 8192U) >> 14);
+    }
+  }
+  frame->width = width;
+  frame->height = height;
+  return 1;
+}
+
+static int Stream_ReadRaw(FILE *f, const char *name, Stream_FrameTypeDef *frame)
+{
+  const size_t bytes = (size_t)stream_raw_width * stream_raw_height;
+  size_t got;
+
+  if (Stream_Reserve(frame, stream_raw_width, stream_raw_height, 1U) != 0)
+  {
+    return -1;
+  }
+  got = fread(frame->gray, 1U, bytes, f);
+  if (got == 0U)
+  {
+    return 0;
+  }
+  if (got != bytes)
+  {
+    fprintf(stderr, "%s: last frame cut short\n", name);
+    return -1;
+  }
+  frame->width = stream_raw_width;
+  frame->height = stream_raw_height;
+  return 1;
+}
+
+/* Frames only grow: a stream of one size allocates on its first frames */
+static int Stream_Reserve(Stream_FrameTypeDef *frame, uint32_t width, uint32_t height, uint32_t channels)
+{
+  const size_t bytes = (size_t)width * height * channels;
+
+  if (bytes > frame->capacity)
+  {
+    uint8_t *grown = realloc(frame->gray, bytes);
+
+    if (grown == NULL)
+    {
+      return 1;
+    }
+    frame->gray = grown;
+    frame->capacity = bytes;
+  }
+  return 0;
+}
+
+/* Decimal field of a PNM header after whitespace and # comments; the last
+   one eats the single whitespace before the pixels */
+static int Stream_HeaderField(FILE *f, uint32_t *value)
+{
+  int c = fgetc(f);
+  uint32_t v = 0U;
+  uint32_t digits = 0U;
+
+  for (;;)
+  {
+    if (c == '#')
+    {
+      while ((c != '\n') && (c != EOF))
+      {
+        c = fgetc(f);
+      }
+    }
+    else if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'))
+    {
+      c = fgetc(f);
+    }
+    else
+    {
+      break;
+    }
+  }
+  while ((c >= '0') && (c <= '9') && (digits < 9U))
+  {
+    v = (v * 10U) + (uint32_t)(c - '0');
+    digits++;
+    c = fgetc(f);
+  }
+  *value = v;
+  return ((digits == 0U) || ((c != ' ') && (c != '\t') && (c != '\r') && (c != '\n')));
+}
+
+static void Stream_Push(Stream_QueueTypeDef *q, Stream_FrameTypeDef *frame, double *waited)
+{
+  const uint_fast64_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+  if ((tail - atomic_load_explicit(&q->head, memory_order_acquire)) == q->size)
+  {
+    const double t = Stream_Now();
+    uint32_t tries = 0U;
+
+    while ((tail - atomic_load_explicit(&q->head, memory_order_acquire)) == q->size)
+    {
+      Stream_Wait(&tries);
+    }
+    if (waited != NULL)
+    {
+      *waited += Stream_Now() - t;
+    }
+  }
+  q->slot[tail % q->size] = frame;
+  atomic_store_explicit(&q->tail, tail + 1U, memory_order_release);
+}
+
+static Stream_FrameTypeDef *Stream_Pop(Stream_QueueTypeDef *q, double *waited)
+{
+  const uint_fast64_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+  Stream_FrameTypeDef *frame;
+
+  if (atomic_load_explicit(&q->tail, memory_order_acquire) == head)
+  {
+    const double t = Stream_Now();
+    uint32_t tries = 0U;
+
+    while (atomic_load_explicit(&q->tail, memory_order_acquire) == head)
+    {
+      Stream_Wait(&tries);
+    }
+    if (waited != NULL)
+    {
+      *waited += Stream_Now() - t;
+    }
+  }
+  frame = q->slot[head % q->size];
+  atomic_store_explicit(&q->head, head + 1U, memory_order_release);
+  return frame;
+}
+
+/* Spin while the other side is likely to answer soon, then give the core
+   away: there may be fewer cores than stages */
+static void Stream_Wait(uint32_t *tries)
+{
+  if (*tries < STREAM_SPINS)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+  else if (*tries < (STREAM_SPINS + STREAM_YIELDS))
+  {
+    (void)sched_yield();
+  }
+  else
+  {
+    const struct timespec nap = { 0, STREAM_NAP_NS };
+
+    (void)nanosleep(&nap, NULL);
+    return;
+  }
+  (*tries)++;
+}
+
+static int Stream_Record(Stream_StatsTypeDef *stats, const Stream_FrameTypeDef *frame)
+{
+  if (stats->frames == stats->capacity)
+  {
+    const uint64_t capacity = (stats->capacity != 0U) ? (2U * stats->capacity) : 1024U;
+    double *ms = malloc((size_t)capacity * (STREAM_STAGES + 1U) * sizeof(double));
+
+    if (ms == NULL)
+    {
+      return 1;
+    }
+    for (uint32_t s = 0U; s <= STREAM_STAGES; s++)
+    {
+      if (stats->frames != 0U)
+      {
+        memcpy(&ms[s * capacity], &stats->ms[s * stats->capacity], (size_t)stats->frames * sizeof(double));
+      }
+    }
+    free(stats->ms);
+    stats->ms = ms;
+    stats->capacity = capacity;
+  }
+  for (uint32_t s = 0U; s < STREAM_STAGES; s++)
+  {
+    stats->ms[(s * stats->capacity) + stats->frames] = (frame->end[s] - frame->start[s]) * 1e3;
+  }
+  stats->ms[(STREAM_STAGES * stats->capacity) + stats->frames] =
+    (frame->end[STREAM_CLASSIFY] - frame->start[STREAM_DECODE]) * 1e3;
+  stats->faces += frame->faces;
+  stats->frames++;
+  return 0;
+}
+
+static void Stream_Report(const Stream_StatsTypeDef *stats, const Stream_StageTypeDef *stages, double wall)
+{
+  double p50;
+  double p90;
+  double p99;
+  double max;
+
+  printf("%llu frames, %llu faces in %.3f s: %.1f frames/s\n", (unsigned long long)stats->frames,
+         (unsigned long long)stats->faces, wall, (double)stats->frames / wall);
+  if (stats->frames == 0U)
+  {
+    return;
+  }
+  printf("stage      alone fps  busy    p50 ms    p90 ms    p99 ms    max ms  wait in  wait out  cpu\n");
+  for (uint32_t s = 0U; s <= STREAM_STAGES; s++)
+  {
+    double *ms = &stats->ms[s * stats->capacity];
+    double busy = 0.0;
+
+    for (uint64_t i = 0U; i < stats->frames; i++)
+    {
+      busy += ms[i];
+    }
+    Stream_Percentiles(ms, stats->frames, &p50, &p90, &p99, &max);
+    if (s < STREAM_STAGES)
+    {
+      printf("%-9s %10.1f %4.0f%% %9.3f %9.3f %9.3f %9.3f %7.3fs %8.3fs  %3d\n", stages[s].name,
+             (busy > 0.0) ? ((double)stats->frames * 1e3 / busy) : 0.0, busy / wall / 10.0, p50, p90, p99, max,
+             stages[s].wait_in, stages[s].wait_out, stages[s].cpu);
+    }
+    else
+    {
+      printf("%-9s %16s %9.3f %9.3f %9.3f %9.3f\n", "end-to-end", "", p50, p90, p99, max);
+    }
+  }
+}
+
+/* Windows per frame, the share each stage of the cascade rejected and the
+   weak classifiers a window cost on average */
+static void Stream_ReportDetect(void)
+{
+  FerDetect_StatsTypeDef ds;
+  uint64_t left;
+
+  FerDetect_Stats(stream_work, &ds);
+  if ((ds.frames == 0U) || (ds.windows == 0U))
+  {
+    return;
+  }
+  printf("detect    %s, %u threads: %.0f windows/frame, %.2f weak/window, %.4f%% passed\n", FerDetect_Isa(),
+         stream_detect_threads, (double)ds.windows / (double)ds.frames, (double)ds.weak / (double)ds.windows,
+         100.0 * (double)ds.passed / (double)ds.windows);
+  printf("stage  rejected  of reaching\n");
+  left = ds.windows;
+  for (uint32_t s = 0U; (s < ds.stages) && (left != 0U); s++)
+  {
+    printf("%5u %8.3f%% %10.3f%%\n", s, 100.0 * (double)ds.rejected[s] / (double)ds.windows,
+           100.0 * (double)ds.rejected[s] / (double)left);
+    left -= ds.rejected[s];
+  }
+}
+
+/* Nearest-rank percentiles; sorts ms */
+static void Stream_Percentiles(double *ms, uint64_t n, double *p50, double *p90, double *p99, double *max)
+{
+  qsort(ms, (size_t)n, sizeof(double), Stream_Compare);
+  *p50 = ms[((n * 50U) + 99U) / 100U - 1U];
+  *p90 = ms[((n * 90U) + 99U) / 100U - 1U];
+  *p99 = ms[((n * 99U) + 99U) / 100U - 1U];
+  *max = ms[n - 1U];
+}
+
+static int Stream_Compare(const void *a, const void *b)
+{
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+
+  return (x > y) - (x < y);
+}
+
+static uint8_t *Stream_ReadFile(const char *path, uint32_t *size)
+{
+  FILE *f = fopen(path, "rb");
+  uint8_t *data;
+  long len;
+
+  if (f == NULL)
+  {
+    perror(path);
+    return NULL;
+  }
+  (void)fseek(f, 0L, SEEK_END);
+  len = ftell(f);
+  rewind(f);
+  /* EmotionNet_Init() wants it word aligned, malloc gives more */
+  data = (len > 0) ? malloc((size_t)len) : NULL;
+  if ((data == NULL) || (fread(data, 1U, (size_t)len, f) != (size_t)len))
+  {
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  *size = (uint32_t)len;
+  return data;
+}
+
+static double Stream_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static void Stream_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s -c cascade.xml [-m emotion_net.bin] [-r WxH] [-o results.txt] [-q depth] [-p]\n"
+          "          [-n frames] [-f scale] [-k neighbors] [-z min_size] [-t threads] source...\n"
+          "  -c     OpenCV Haar cascade, haarcascade_frontalface_default.xml\n"
+          "  -m     blob of convert_model.py; faces are not classified without\n"
+          "  -r     sources are raw 8-bit gray frames of that size, not PGM/PPM\n"
+          "  -o     one line per frame: index faces [x y w h label probability]..., - for stdout\n"
+          "  -q     frames per ring between stages (4, at most %u)\n"
+          "  -p     pin each stage to its own core\n"
+          "  -n     stop after that many frames\n"
+          "  -f -k -z  detectMultiScale scaleFactor (1.3), minNeighbors (5), minSize (0)\n"
+          "  -t     threads of the detect stage (1, at most %u)\n"
+          "  source PGM/PPM files or streams of them, - for stdin\n",
+          argv0, STREAM_DEPTH_MAX, FER_DETECT_THREADS_MAX);
+}
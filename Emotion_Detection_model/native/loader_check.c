@@ -0,0 +1,278 @@
+/**
+  ******************************************************************************
+  * @file           : loader_check.c
+  * @brief          : Check and time fer_loader on a packed file.
+  *
+  *                     loader_check [-b batch] [-w workers] [-e epochs] file.fer
+  *
+  *                   Reads the training split shuffled and the test split in
+  *                   order, and checks that:
+  *                     - every image comes exactly once per epoch, the last
+  *                       batch being partial unless it is dropped
+  *                     - x is pixel / 255 of the image, y its one-hot label
+  *                     - the shuffled order changes every epoch and follows
+  *                       FerLoader_Image() whatever the number of workers
+  *                     - a caller holding every slot is refused a batch
+  *                   then reports batches per second from 1 to -w workers.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "fer_loader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK_SCALE         (1.0f / 255.0f)
+
+/* Private variables ---------------------------------------------------------*/
+static FerPack_HeaderTypeDef check_hdr;
+static uint8_t *check_file;
+
+/* Private function prototypes -----------------------------------------------*/
+static int Check_Load(const char *path);
+static int Check_Split(const char *path, uint32_t usages, uint32_t batch, uint32_t workers, uint32_t epochs,
+                       uint32_t shuffle, uint32_t drop_last);
+static int Check_Hold(const char *path);
+static void Check_Time(const char *path, uint32_t batch, uint32_t workers);
+static double Check_Now(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  uint32_t batch = 64U;
+  uint32_t workers = 4U;
+  uint32_t epochs = 3U;
+  int failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "b:w:e:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'b':
+        batch = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'w':
+        workers = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'e':
+        epochs = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-b batch] [-w workers] [-e epochs] file.fer\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if ((optind != (argc - 1)) || (Check_Load(argv[optind]) != 0))
+  {
+    fprintf(stderr, "usage: %s [-b batch] [-w workers] [-e epochs] file.fer\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  printf("conversion: %s\n", FerLoader_Isa());
+  failed |= Check_Split(argv[optind], 1U << FER_PACK_TRAINING, batch, 1U, epochs, 1U, 1U);
+  failed |= Check_Split(argv[optind], 1U << FER_PACK_TRAINING, batch, workers, epochs, 1U, 0U);
+  failed |= Check_Split(argv[optind], (1U << FER_PACK_PUBLIC_TEST) | (1U << FER_PACK_PRIVATE_TEST), batch, workers,
+                        1U, 0U, 0U);
+  failed |= Check_Hold(argv[optind]);
+  if (failed == 0)
+  {
+    for (uint32_t w = 1U; w <= workers; w *= 2U)
+    {
+      Check_Time(argv[optind], batch, w);
+    }
+  }
+  return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* The packed file, read the plain way */
+static int Check_Load(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  long size;
+
+  if ((f == NULL) || (fseek(f, 0, SEEK_END) != 0) || ((size = ftell(f)) < (long)sizeof(check_hdr)))
+  {
+    perror(path);
+    return 1;
+  }
+  rewind(f);
+  check_file = malloc((size_t)size);
+  if ((check_file == NULL) || (fread(check_file, 1U, (size_t)size, f) != (size_t)size))
+  {
+    perror(path);
+    fclose(f);
+    return 1;
+  }
+  fclose(f);
+  memcpy(&check_hdr, check_file, sizeof(check_hdr));
+  return 0;
+}
+
+static int Check_Split(const char *path, uint32_t usages, uint32_t batch, uint32_t workers, uint32_t epochs,
+                       uint32_t shuffle, uint32_t drop_last)
+{
+  const FerLoader_ConfigTypeDef config =
+  {
+    .path = path, .usages = usages, .batch = batch, .workers = workers, .slots = 8U,
+    .shuffle = shuffle, .drop_last = drop_last, .seed = 1234U, .scale = CHECK_SCALE, .offset = 0.0f,
+  };
+  FerLoader_HandleTypeDef *loader = FerLoader_Open(&config);
+  const uint32_t first = check_hdr.first[__builtin_ctz(usages)];
+  uint32_t images;
+  uint32_t batches;
+  uint8_t *seen;
+  uint32_t *order;
+  uint32_t moved = 0U;
+
+  if (loader == NULL)
+  {
+    printf("%s: cannot open\n", path);
+    return 1;
+  }
+  images = FerLoader_Images(loader);
+  batches = FerLoader_BatchesPerEpoch(loader);
+  seen = calloc(images, 1U);
+  order = calloc(images, sizeof(uint32_t));
+  for (uint32_t e = 0U; e < epochs; e++)
+  {
+    uint32_t served = 0U;
+
+    memset(seen, 0, images);
+    for (uint32_t b = 0U; b < batches; b++)
+    {
+      FerLoader_BatchTypeDef got;
+
+      if ((FerLoader_Next(loader, &got) != 0) || (got.epoch != e) || (got.index != ((uint64_t)e * batches) + b))
+      {
+        printf("batch %lu of epoch %lu out of order\n", (unsigned long)b, (unsigned long)e);
+        return 1;
+      }
+      for (uint32_t i = 0U; i < got.count; i++)
+      {
+        const uint32_t image = FerLoader_Image(loader, e, served + i);
+        const uint8_t *pixels = &check_file[check_hdr.pixels + ((uint64_t)(first + image) * FER_PACK_PIXELS)];
+        const uint8_t label = check_file[check_hdr.labels + first + image];
+
+        if ((image >= images) || (seen[image] != 0U) || (got.labels[i] != label)
+            || (got.y[(i * FER_PACK_CLASSES) + label] != 1.0f))
+        {
+          printf("epoch %lu: image %lu repeated or mislabeled\n", (unsigned long)e, (unsigned long)image);
+          return 1;
+        }
+        seen[image] = 1U;
+        for (uint32_t c = 0U; c < FER_PACK_CLASSES; c++)
+        {
+          if ((c != label) && (got.y[(i * FER_PACK_CLASSES) + c] != 0.0f))
+          {
+            printf("epoch %lu: image %lu label not one-hot\n", (unsigned long)e, (unsigned long)image);
+            return 1;
+          }
+        }
+        for (uint32_t p = 0U; p < FER_PACK_PIXELS; p++)
+        {
+          if (got.x[((size_t)i * FER_PACK_PIXELS) + p] != ((float)pixels[p] * CHECK_SCALE))
+          {
+            printf("epoch %lu: image %lu pixel %lu differs\n", (unsigned long)e, (unsigned long)image,
+                   (unsigned long)p);
+            return 1;
+          }
+        }
+        if ((e > 0U) && (order[served + i] != image))
+        {
+          moved++;
+        }
+        order[served + i] = image;
+      }
+      served += got.count;
+      FerLoader_Release(loader, got.slot);
+    }
+    if (served != ((drop_last != 0U) ? ((images / batch) * batch) : images))
+    {
+      printf("epoch %lu: %lu images served of %lu\n", (unsigned long)e, (unsigned long)served,
+             (unsigned long)images);
+      return 1;
+    }
+  }
+  if ((shuffle != 0U) && (epochs > 1U) && (moved < (images / 2U)))
+  {
+    printf("shuffled order barely changes between epochs\n");
+    return 1;
+  }
+  if ((shuffle == 0U) && (FerLoader_Image(loader, 0U, images - 1U) != (images - 1U)))
+  {
+    printf("unshuffled order is not the file order\n");
+    return 1;
+  }
+  printf("%lu images x %lu epochs, batch %lu, %lu workers%s%s: ok\n", (unsigned long)images,
+         (unsigned long)epochs, (unsigned long)batch, (unsigned long)workers, shuffle ? ", shuffled" : "",
+         drop_last ? ", last batch dropped" : "");
+  free(seen);
+  free(order);
+  FerLoader_Close(loader);
+  return 0;
+}
+
+/* Holding every slot: the next batch would wait forever, so it is refused */
+static int Check_Hold(const char *path)
+{
+  const FerLoader_ConfigTypeDef config =
+  {
+    .path = path, .usages = 1U << FER_PACK_TRAINING, .batch = 16U, .workers = 2U, .slots = 4U,
+    .shuffle = 1U, .scale = CHECK_SCALE,
+  };
+  FerLoader_HandleTypeDef *loader = FerLoader_Open(&config);
+  FerLoader_BatchTypeDef got;
+  int failed = 0;
+
+  for (uint32_t s = 0U; s < 4U; s++)
+  {
+    failed |= (FerLoader_Next(loader, &got) != 0);
+  }
+  failed |= (FerLoader_Next(loader, &got) == 0);
+  FerLoader_Release(loader, 0U);
+  failed |= ((FerLoader_Next(loader, &got) != 0) || (got.slot != 0U) || (got.index != 4U));
+  FerLoader_Close(loader);
+  printf("holding every slot: %s\n", (failed != 0) ? "FAILED" : "refused");
+  return failed;
+}
+
+static void Check_Time(const char *path, uint32_t batch, uint32_t workers)
+{
+  const FerLoader_ConfigTypeDef config =
+  {
+    .path = path, .usages = 1U << FER_PACK_TRAINING, .batch = batch, .workers = workers, .slots = 16U,
+    .shuffle = 1U, .drop_last = 1U, .seed = 1U, .scale = CHECK_SCALE,
+  };
+  FerLoader_HandleTypeDef *loader = FerLoader_Open(&config);
+  const uint32_t batches = 4U * FerLoader_BatchesPerEpoch(loader);
+  const double start = Check_Now();
+  double s;
+
+  for (uint32_t b = 0U; b < batches; b++)
+  {
+    FerLoader_BatchTypeDef got;
+
+    (void)FerLoader_Next(loader, &got);
+    FerLoader_Release(loader, got.slot);
+  }
+  s = Check_Now() - start;
+  printf("%2lu workers: %8.0f batches/s, %6.2f GB/s of float32\n", (unsigned long)workers, (double)batches / s,
+         (double)batches * batch * FER_PACK_PIXELS * sizeof(float) / 1e9 / s);
+  FerLoader_Close(loader);
+}
+
+static double Check_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
@@ -0,0 +1,454 @@
+/**
+  ******************************************************************************
+  * @file           : stream_check.c
+  * @brief          : Test material for fer_stream, and the check of its
+  *                   results.
+  *
+  *                     stream_check -g dir [-n frames]
+  *                     stream_check truth.txt results.txt
+  *
+  *                   -g writes into dir:
+  *                     cascade.xml      a two-stage HAAR cascade in the
+  *                                      OpenCV format that finds "faces":
+  *                                      squares with a dark border a sixth
+  *                                      of their side thick around a
+  *                                      bright centre
+  *                     frame_NNN.pgm    320x240 frames of noise holding 0 to
+  *                     frame_NNN.ppm    3 such faces of 48 to 132 pixels,
+  *                                      every other one in colour
+  *                     stream.pgm       the frames one after the other, as
+  *                                      ffmpeg -f image2pipe -vcodec pgm
+  *                     stream.raw       the frames as raw gray video
+  *                     truth.txt        frame faces [x y width height]...
+  *
+  *                   The second form checks fer_stream -o results against
+  *                   the truth: every frame in order, and in each exactly
+  *                   the planted faces, each found once with an overlap
+  *                   (intersection over union) of 0.5 or more, classified
+  *                   when the results carry labels.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK_WIDTH         320U
+#define CHECK_HEIGHT        240U
+#define CHECK_FACES_MAX     3U
+#define CHECK_IOU           0.5
+#define CHECK_LINE          4096U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  int x;
+  int y;
+  int width;
+  int height;
+} Check_RectTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t check_seed = 2024U;
+
+/* Feature 0 weighs the centre against the window, 1 to 4 each border
+   strip against the strip inside it */
+static const char *const check_cascade =
+  "<?xml version=\"1.0\"?>\n"
+  "<opencv_storage>\n"
+  "<cascade type_id=\"opencv-cascade-classifier\"><stageType>BOOST</stageType>\n"
+  "  <featureType>HAAR</featureType>\n"
+  "  <height>24</height>\n"
+  "  <width>24</width>\n"
+  "  <stageParams>\n"
+  "    <maxWeakCount>4</maxWeakCount></stageParams>\n"
+  "  <featureParams>\n"
+  "    <maxCatCount>0</maxCatCount></featureParams>\n"
+  "  <stageNum>2</stageNum>\n"
+  "  <stages>\n"
+  "    <_>\n"
+  "      <maxWeakCount>1</maxWeakCount>\n"
+  "      <stageThreshold>0.</stageThreshold>\n"
+  "      <weakClassifiers>\n"
+  "        <_>\n"
+  "          <internalNodes>\n"
+  "            0 -1 0 5.9999999999999998e-01</internalNodes>\n"
+  "          <leafValues>\n"
+  "            -1. 1.</leafValues></_></weakClassifiers></_>\n"
+  "    <!-- stage 1 -->\n"
+  "    <_>\n"
+  "      <maxWeakCount>4</maxWeakCount>\n"
+  "      <stageThreshold>3.5</stageThreshold>\n"
+  "      <weakClassifiers>\n"
+  "        <_>\n"
+  "          <internalNodes>\n"
+  "            0 -1 1 4.0000000000000001e-02</internalNodes>\n"
+  "          <leafValues>\n"
+  "            -1. 1.</leafValues></_>\n"
+  "        <_>\n"
+  "          <internalNodes>\n"
+  "            0 -1 2 4.0000000000000001e-02</internalNodes>\n"
+  "          <leafValues>\n"
+  "            -1. 1.</leafValues></_>\n"
+  "        <_>\n"
+  "          <internalNodes>\n"
+  "            0 -1 3 4.0000000000000001e-02</internalNodes>\n"
+  "          <leafValues>\n"
+  "            -1. 1.</leafValues></_>\n"
+  "        <_>\n"
+  "          <internalNodes>\n"
+  "            0 -1 4 4.0000000000000001e-02</internalNodes>\n"
+  "          <leafValues>\n"
+  "            -1. 1.</leafValues></_></weakClassifiers></_></stages>\n"
+  "  <features>\n"
+  "    <_>\n"
+  "      <rects>\n"
+  "        <_>\n"
+  "          0 0 24 24 -1.</_>\n"
+  "        <_>\n"
+  "          4 4 16 16 2.25</_></rects></_>\n"
+  "    <_>\n"
+  "      <rects>\n"
+  "        <_>\n"
+  "          4 0 16 4 -1.</_>\n"
+  "        <_>\n"
+  "          4 4 16 4 1.</_></rects></_>\n"
+  "    <_>\n"
+  "      <rects>\n"
+  "        <_>\n"
+  "          4 20 16 4 -1.</_>\n"
+  "        <_>\n"
+  "          4 16 16 4 1.</_></rects>\n"
+  "      <tilted>0</tilted></_>\n"
+  "    <_>\n"
+  "      <rects>\n"
+  "        <_>\n"
+  "          0 4 4 16 -1.</_>\n"
+  "        <_>\n"
+  "          4 4 4 16 1.</_></rects></_>\n"
+  "    <_>\n"
+  "      <rects>\n"
+  "        <_>\n"
+  "          20 4 4 16 -1.</_>\n"
+  "        <_>\n"
+  "          16 4 4 16 1.</_></rects></_></features></cascade>\n"
+  "</opencv_storage>\n";
+
+static const int check_sizes[] = { 48, 60, 72, 90, 108, 132 };
+
+/* Private function prototypes -----------------------------------------------*/
+static int Check_Generate(const char *dir, uint32_t frames);
+static uint32_t Check_Plant(uint8_t *image, uint32_t index, Check_RectTypeDef *faces);
+static int Check_Results(const char *truth_path, const char *results_path);
+static int Check_Overlaps(const Check_RectTypeDef *a, const Check_RectTypeDef *b, int margin);
+static double Check_Iou(const Check_RectTypeDef *a, const Check_RectTypeDef *b);
+static FILE *Check_Open(const char *dir, const char *name);
+static uint32_t Check_Random(void);
+static void Check_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  const char *dir = NULL;
+  uint32_t frames = 24U;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "g:n:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'g':
+        dir = optarg;
+        break;
+      case 'n':
+        frames = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        Check_Usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if (dir != NULL)
+  {
+    return (optind == argc) ? Check_Generate(dir, frames) : (Check_Usage(argv[0]), EXIT_FAILURE);
+  }
+  if (optind != (argc - 2))
+  {
+    Check_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  return Check_Results(argv[optind], argv[optind + 1]);
+}
+
+static int Check_Generate(const char *dir, uint32_t frames)
+{
+  static uint8_t image[CHECK_HEIGHT][CHECK_WIDTH];
+  static uint8_t rgb[CHECK_HEIGHT][CHECK_WIDTH][3];
+  FILE *cascade = Check_Open(dir, "cascade.xml");
+  FILE *truth = Check_Open(dir, "truth.txt");
+  FILE *stream = Check_Open(dir, "stream.pgm");
+  FILE *raw = Check_Open(dir, "stream.raw");
+  int failed = 0;
+
+  if ((cascade == NULL) || (truth == NULL) || (stream == NULL) || (raw == NULL))
+  {
+    return EXIT_FAILURE;
+  }
+  failed |= (fputs(check_cascade, cascade) == EOF);
+  for (uint32_t i = 0U; i < frames; i++)
+  {
+    Check_RectTypeDef faces[CHECK_FACES_MAX];
+    const uint32_t n = Check_Plant(&image[0][0], i, faces);
+    char name[32];
+    FILE *f;
+
+    fprintf(truth, "%lu %lu", (unsigned long)i, (unsigned long)n);
+    for (uint32_t k = 0U; k < n; k++)
+    {
+      fprintf(truth, " %d %d %d %d", faces[k].x, faces[k].y, faces[k].width, faces[k].height);
+    }
+    fputc('\n', truth);
+
+    snprintf(name, sizeof(name), "frame_%03lu.%s", (unsigned long)i, ((i & 1U) != 0U) ? "ppm" : "pgm");
+    f = Check_Open(dir, name);
+    if (f == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+    if ((i & 1U) != 0U)
+    {
+      /* equal channels, so that the gray of the colour frame is exact */
+      for (uint32_t y = 0U; y < CHECK_HEIGHT; y++)
+      {
+        for (uint32_t x = 0U; x < CHECK_WIDTH; x++)
+        {
+          memset(rgb[y][x], image[y][x], 3U);
+        }
+      }
+      fprintf(f, "P6\n# frame %lu\n%u %u\n255\n", (unsigned long)i, CHECK_WIDTH, CHECK_HEIGHT);
+      failed |= (fwrite(rgb, sizeof(rgb), 1U, f) != 1U);
+    }
+    else
+    {
+      fprintf(f, "P5 %u %u 255\n", CHECK_WIDTH, CHECK_HEIGHT);
+      failed |= (fwrite(image, sizeof(image), 1U, f) != 1U);
+    }
+    failed |= (fclose(f) != 0);
+    fprintf(stream, "P5\n%u %u\n255\n", CHECK_WIDTH, CHECK_HEIGHT);
+    failed |= (fwrite(image, sizeof(image), 1U, stream) != 1U);
+    failed |= (fwrite(image, sizeof(image), 1U, raw) != 1U);
+  }
+  failed |= (fclose(cascade) != 0);
+  failed |= (fclose(truth) != 0);
+  failed |= (fclose(stream) != 0);
+  failed |= (fclose(raw) != 0);
+  if (failed != 0)
+  {
+    fprintf(stderr, "%s: cannot write\n", dir);
+    return EXIT_FAILURE;
+  }
+  printf("%lu frames of %ux%u in %s\n", (unsigned long)frames, CHECK_WIDTH, CHECK_HEIGHT, dir);
+  return EXIT_SUCCESS;
+}
+
+/* Noise, then index % 4 faces that neither overlap nor touch */
+static uint32_t Check_Plant(uint8_t *image, uint32_t index, Check_RectTypeDef *faces)
+{
+  const uint32_t want = index % (CHECK_FACES_MAX + 1U);
+  uint32_t n = 0U;
+
+  for (uint32_t i = 0U; i < (CHECK_WIDTH * CHECK_HEIGHT); i++)
+  {
+    image[i] = (uint8_t)(100U + (Check_Random() % 61U));
+  }
+  for (uint32_t tries = 0U; (n < want) && (tries < 1000U); tries++)
+  {
+    const int side = check_sizes[Check_Random() % (sizeof(check_sizes) / sizeof(check_sizes[0]))];
+    const Check_RectTypeDef r =
+    {
+      (int)(Check_Random() % (CHECK_WIDTH - (uint32_t)side)), (int)(Check_Random() % (CHECK_HEIGHT - (uint32_t)side)),
+      side, side,
+    };
+    uint32_t k;
+
+    for (k = 0U; (k < n) && (Check_Overlaps(&r, &faces[k], 16) == 0); k++)
+    {
+    }
+    if (k < n)
+    {
+      continue;
+    }
+    faces[n++] = r;
+    for (int y = 0; y < side; y++)
+    {
+      for (int x = 0; x < side; x++)
+      {
+        const int ring = side / 6;
+        const int inside = (x >= ring) && (x < (side - ring)) && (y >= ring) && (y < (side - ring));
+
+        image[((r.y + y) * (int)CHECK_WIDTH) + r.x + x] =
+          (uint8_t)((inside ? 215U : 25U) + (Check_Random() % 16U));
+      }
+    }
+  }
+  return n;
+}
+
+static int Check_Results(const char *truth_path, const char *results_path)
+{
+  FILE *truth = fopen(truth_path, "r");
+  FILE *results = fopen(results_path, "r");
+  static char want[CHECK_LINE];
+  static char got[CHECK_LINE];
+  uint32_t frames = 0U;
+  uint32_t faces = 0U;
+  uint32_t labeled = 0U;
+
+  if ((truth == NULL) || (results == NULL))
+  {
+    perror((truth == NULL) ? truth_path : results_path);
+    return EXIT_FAILURE;
+  }
+  while (fgets(want, sizeof(want), truth) != NULL)
+  {
+    Check_RectTypeDef planted[CHECK_FACES_MAX];
+    uint8_t found[CHECK_FACES_MAX] = { 0 };
+    unsigned long index;
+    unsigned long n;
+    unsigned long got_index;
+    unsigned long got_n;
+    char *p = want;
+    char *q = got;
+    int used;
+
+    if ((sscanf(p, "%lu %lu%n", &index, &n, &used) != 2) || (n > CHECK_FACES_MAX))
+    {
+      printf("%s: damaged line %lu\n", truth_path, (unsigned long)frames + 1UL);
+      return EXIT_FAILURE;
+    }
+    p += used;
+    for (unsigned long k = 0U; k < n; k++)
+    {
+      if (sscanf(p, "%d %d %d %d%n", &planted[k].x, &planted[k].y, &planted[k].width, &planted[k].height,
+                 &used) != 4)
+      {
+        printf("%s: damaged line %lu\n", truth_path, (unsigned long)frames + 1UL);
+        return EXIT_FAILURE;
+      }
+      p += used;
+    }
+    if ((fgets(got, sizeof(got), results) == NULL) || (sscanf(q, "%lu %lu%n", &got_index, &got_n, &used) != 2)
+        || (got_index != index))
+    {
+      printf("frame %lu: missing or out of order\n", index);
+      return EXIT_FAILURE;
+    }
+    q += used;
+    for (unsigned long k = 0U; k < got_n; k++)
+    {
+      Check_RectTypeDef r;
+      char label[32];
+      double probability;
+      unsigned long match = n;
+
+      if (sscanf(q, "%d %d %d %d %31s %lf%n", &r.x, &r.y, &r.width, &r.height, label, &probability, &used) != 6)
+      {
+        printf("frame %lu: damaged face %lu\n", index, k);
+        return EXIT_FAILURE;
+      }
+      q += used;
+      for (unsigned long t = 0U; t < n; t++)
+      {
+        if ((found[t] == 0U) && (Check_Iou(&r, &planted[t]) >= CHECK_IOU))
+        {
+          match = t;
+        }
+      }
+      if (match == n)
+      {
+        printf("frame %lu: face %d %d %d %d was not planted\n", index, r.x, r.y, r.width, r.height);
+        return EXIT_FAILURE;
+      }
+      found[match] = 1U;
+      if (strcmp(label, "-") != 0)
+      {
+        if ((probability <= 0.0) || (probability > 1.0))
+        {
+          printf("frame %lu: face %lu is %s with probability %g\n", index, k, label, probability);
+          return EXIT_FAILURE;
+        }
+        labeled++;
+      }
+    }
+    for (unsigned long t = 0U; t < n; t++)
+    {
+      if (found[t] == 0U)
+      {
+        printf("frame %lu: face %d %d %d %d not found\n", index, planted[t].x, planted[t].y, planted[t].width,
+               planted[t].height);
+        return EXIT_FAILURE;
+      }
+    }
+    frames++;
+    faces += (uint32_t)n;
+  }
+  if (fgets(got, sizeof(got), results) != NULL)
+  {
+    printf("%s: more frames than planted\n", results_path);
+    return EXIT_FAILURE;
+  }
+  fclose(truth);
+  fclose(results);
+  printf("%s: %lu frames, %lu faces found, %lu classified: ok\n", results_path, (unsigned long)frames,
+         (unsigned long)faces, (unsigned long)labeled);
+  return EXIT_SUCCESS;
+}
+
+static int Check_Overlaps(const Check_RectTypeDef *a, const Check_RectTypeDef *b, int margin)
+{
+  return ((a->x - margin) < (b->x + b->width)) && ((b->x - margin) < (a->x + a->width))
+         && ((a->y - margin) < (b->y + b->height)) && ((b->y - margin) < (a->y + a->height));
+}
+
+static double Check_Iou(const Check_RectTypeDef *a, const Check_RectTypeDef *b)
+{
+  const int x0 = (a->x > b->x) ? a->x : b->x;
+  const int y0 = (a->y > b->y) ? a->y : b->y;
+  const int x1 = ((a->x + a->width) < (b->x + b->width)) ? (a->x + a->width) : (b->x + b->width);
+  const int y1 = ((a->y + a->height) < (b->y + b->height)) ? (a->y + a->height) : (b->y + b->height);
+  const double inter = ((x1 > x0) && (y1 > y0)) ? ((double)(x1 - x0) * (double)(y1 - y0)) : 0.0;
+
+  return inter / (((double)a->width * a->height) + ((double)b->width * b->height) - inter);
+}
+
+static FILE *Check_Open(const char *dir, const char *name)
+{
+  char path[4096];
+  FILE *f;
+
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  f = fopen(path, "wb");
+  if (f == NULL)
+  {
+    perror(path);
+  }
+  return f;
+}
+
+static uint32_t Check_Random(void)
+{
+  check_seed = (check_seed * 1664525U) + 1013904223U;
+  return check_seed >> 8;
+}
+
+static void Check_Usage(const char *argv0)
+{
+  fprintf(stderr, "usage: %s -g dir [-n frames]\n       %s truth.txt results.txt\n", argv0, argv0);
+}
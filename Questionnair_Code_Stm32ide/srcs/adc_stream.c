@@ -0,0 +1,411 @@
+/**
+  ******************************************************************************
+  * @file           : adc_stream.c
+  * @brief          : Timer-triggered, DMA-backed lux acquisition.
+  *
+  *                   TIM6 update events trigger ADC1 conversions on
+  *                   ADC_CHANNEL_2. DMA1 Channel1 moves every result into a
+  *                   circular buffer split in two halves; the half/full
+  *                   transfer callbacks hand a completed half over to the
+  *                   application while the DMA keeps filling the other one.
+  *                   The CPU never polls the converter.
+  *
+  *                   Each trigger runs 16 conversions of 47.5 cycles that
+  *                   the hardware oversampler averages into one 12-bit
+  *                   result. The analog watchdog AWD1 watches the results
+  *                   against the window of AdcStream_SetWatchdog(); its
+  *                   interrupt only raises a flag for the next block and
+  *                   stays off until the flag is taken, so a level that
+  *                   stays outside costs one interrupt per block.
+  *
+  *                   TIM6 is driven through its registers because the TIM
+  *                   HAL module is not enabled in stm32l4xx_hal_conf.h.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "adc_stream.h"
+#include "log_ring.h"
+
+/* Private define ------------------------------------------------------------*/
+#define ADC_STREAM_BUF_LEN   (2U * ADC_STREAM_HALF_LEN)
+
+/* Private variables ---------------------------------------------------------*/
+DMA_HandleTypeDef hdma_adc1;
+
+static ADC_HandleTypeDef *stream_hadc;
+static uint16_t adc_buf[ADC_STREAM_BUF_LEN];
+
+/* One flag per half so that the DMA callbacks and the application never
+   read-modify-write the same byte. */
+static volatile uint8_t half_ready[2];
+static volatile uint8_t last_half;
+static uint8_t next_half;
+
+static volatile uint32_t stream_blocks;
+static volatile uint32_t stream_overruns;
+static uint32_t stream_rate_hz;
+static volatile uint8_t stream_woke;
+static volatile uint32_t stream_watchdog;
+
+/* Private function prototypes -----------------------------------------------*/
+static void AdcStream_Publish(uint8_t half);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Configure DMA1 Channel1, TIM6 and re-initialise ADC1 for
+  *         externally triggered circular DMA conversions.
+  * @note   Call after MX_ADC1_Init(); only the trigger, DMA, overrun,
+  *         oversampling and sampling time settings generated by CubeMX are
+  *         overridden. The watchdog window starts at the full scale.
+  * @param  hadc: ADC handle initialised by MX_ADC1_Init
+  * @param  rate_hz: conversion rate on ADC_CHANNEL_2
+  * @retval HAL status
+  */
+HAL_StatusTypeDef AdcStream_Init(ADC_HandleTypeDef *hadc, uint32_t rate_hz)
+{
+  ADC_ChannelConfTypeDef channel = {0};
+
+  stream_hadc = hadc;
+
+  /* DMA1 Channel1 is hard-wired to ADC1 on the STM32L475 (request 0) */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  hdma_adc1.Instance = DMA1_Channel1;
+  hdma_adc1.Init.Request = DMA_REQUEST_0;
+  hdma_adc1.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_adc1.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_adc1.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_adc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_adc1.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_adc1.Init.Mode = DMA_CIRCULAR;
+  hdma_adc1.Init.Priority = DMA_PRIORITY_HIGH;
+  if (HAL_DMA_Init(&hdma_adc1) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  __HAL_LINKDMA(hadc, DMA_Handle, hdma_adc1);
+
+  HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+
+  /* Conversions are started by the TIM6 TRGO instead of software */
+  hadc->Init.ExternalTrigConv = ADC_EXTERNALTRIG_T6_TRGO;
+  hadc->Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+  hadc->Init.DMAContinuousRequests = ENABLE;
+  hadc->Init.Overrun = ADC_OVR_DATA_OVERWRITTEN;
+  /* 16 conversions per trigger, summed and shifted back to 12 bits */
+  hadc->Init.OversamplingMode = ENABLE;
+  hadc->Init.Oversampling.Ratio = ADC_OVERSAMPLING_RATIO_16;
+  hadc->Init.Oversampling.RightBitShift = ADC_RIGHTBITSHIFT_4;
+  hadc->Init.Oversampling.TriggeredMode = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
+  hadc->Init.Oversampling.OversamplingStopReset = ADC_REGOVERSAMPLING_CONTINUED_MODE;
+  if (HAL_ADC_Init(hadc) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  /* the photodiode output is high impedance, give it time to settle */
+  channel.Channel = ADC_CHANNEL_2;
+  channel.Rank = ADC_REGULAR_RANK_1;
+  channel.SamplingTime = ADC_SAMPLETIME_47CYCLES_5;
+  channel.SingleDiff = ADC_SINGLE_ENDED;
+  channel.OffsetNumber = ADC_OFFSET_NONE;
+  channel.Offset = 0U;
+  if (HAL_ADC_ConfigChannel(hadc, &channel) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  if (HAL_ADCEx_Calibration_Start(hadc, ADC_SINGLE_ENDED) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  /* TIM6: basic timer, update event routed to TRGO */
+  __HAL_RCC_TIM6_CLK_ENABLE();
+  TIM6->CR1 = 0U;
+  TIM6->CR2 = TIM_CR2_MMS_1;
+
+  HAL_NVIC_SetPriority(ADC1_2_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(ADC1_2_IRQn);
+  stream_watchdog = 0U;
+  if (AdcStream_SetWatchdog(0U, 0x0FFFU) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  return AdcStream_SetRate(rate_hz);
+}
+
+/**
+  * @brief  Program the AWD1 window on ADC_CHANNEL_2 and re-arm its
+  *         interrupt.
+  * @note   TR1 may only be written with ADSTART clear (RM0351), so while
+  *         streaming the regular conversions are stopped around the write
+  *         and restarted on the next TIM6 trigger. The DMA is left running
+  *         and keeps its place in the buffer; a trigger that falls in the
+  *         gap is not converted.
+  * @param  low: lowest result inside the window
+  * @param  high: highest result inside the window
+  * @retval HAL status
+  */
+HAL_StatusTypeDef AdcStream_SetWatchdog(uint16_t low, uint16_t high)
+{
+  ADC_AnalogWDGConfTypeDef awd = {0};
+  HAL_StatusTypeDef status;
+  uint32_t streaming;
+
+  if ((stream_hadc == NULL) || (low > high))
+  {
+    return HAL_ERROR;
+  }
+  streaming = stream_hadc->Instance->CR & ADC_CR_ADSTART;
+  if ((streaming != 0U) && (ADC_ConversionStop(stream_hadc, ADC_REGULAR_GROUP) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  awd.WatchdogNumber = ADC_ANALOGWATCHDOG_1;
+  awd.WatchdogMode = ADC_ANALOGWATCHDOG_SINGLE_REG;
+  awd.Channel = ADC_CHANNEL_2;
+  awd.ITMode = ENABLE;
+  awd.HighThreshold = high;
+  awd.LowThreshold = low;
+  status = HAL_ADC_AnalogWDGConfig(stream_hadc, &awd);
+  if (status == HAL_OK)
+  {
+    __HAL_ADC_CLEAR_FLAG(stream_hadc, ADC_FLAG_AWD1);
+    __HAL_ADC_ENABLE_IT(stream_hadc, ADC_IT_AWD1);
+  }
+  stream_hadc->Instance->CR |= streaming;
+  return status;
+}
+
+/**
+  * @brief  Take the watchdog flag and re-arm its interrupt.
+  * @retval 1 if a result fell outside the window since the last call
+  */
+uint8_t AdcStream_TakeWatchdog(void)
+{
+  uint8_t woke;
+
+  __disable_irq();
+  woke = stream_woke;
+  stream_woke = 0U;
+  __enable_irq();
+  if (woke != 0U)
+  {
+    __HAL_ADC_CLEAR_FLAG(stream_hadc, ADC_FLAG_AWD1);
+    __HAL_ADC_ENABLE_IT(stream_hadc, ADC_IT_AWD1);
+  }
+  return woke;
+}
+
+/**
+  * @brief  Program TIM6 so that it triggers one conversion every 1/rate_hz.
+  * @note   May be called while streaming; the new period is buffered by the
+  *         auto-reload preload and applies from the next update event.
+  * @param  rate_hz: requested conversion rate, 1 Hz .. timer clock
+  * @retval HAL status
+  */
+HAL_StatusTypeDef AdcStream_SetRate(uint32_t rate_hz)
+{
+  uint32_t tim_clk = HAL_RCC_GetPCLK1Freq();
+  uint32_t ticks;
+  uint32_t psc;
+  uint32_t arr;
+
+  /* The APB1 timers run at twice PCLK1 whenever APB1 is divided */
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1)
+  {
+    tim_clk *= 2U;
+  }
+  if ((rate_hz == 0U) || (rate_hz > tim_clk))
+  {
+    return HAL_ERROR;
+  }
+
+  ticks = tim_clk / rate_hz;
+  psc = (ticks - 1U) / 0x10000U;
+  arr = (ticks / (psc + 1U)) - 1U;
+  if (arr == 0U)
+  {
+    arr = 1U;
+  }
+
+  TIM6->PSC = psc;
+  TIM6->ARR = arr;
+  TIM6->CR1 |= TIM_CR1_ARPE;
+
+  stream_rate_hz = tim_clk / ((psc + 1U) * (arr + 1U));
+  return HAL_OK;
+}
+
+/**
+  * @brief  Start circular DMA conversions and the trigger timer.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef AdcStream_Start(void)
+{
+  half_ready[0] = 0U;
+  half_ready[1] = 0U;
+  next_half = 0U;
+  last_half = 1U;
+
+  if (HAL_ADC_Start_DMA(stream_hadc, (uint32_t *)adc_buf, ADC_STREAM_BUF_LEN) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  TIM6->EGR = TIM_EGR_UG;
+  TIM6->SR = 0U;
+  TIM6->CR1 |= TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Stop the trigger timer and the DMA transfer.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef AdcStream_Stop(void)
+{
+  TIM6->CR1 &= ~TIM_CR1_CEN;
+  return HAL_ADC_Stop_DMA(stream_hadc);
+}
+
+/**
+  * @brief  Oldest completed half-buffer not yet released by the application.
+  * @retval Pointer to ADC_STREAM_HALF_LEN samples, or NULL if none is ready.
+  *         The block stays valid until AdcStream_ReleaseBlock() is called
+  *         or until the DMA wraps around onto it (counted as an overrun).
+  */
+const uint16_t *AdcStream_GetBlock(void)
+{
+  if (half_ready[next_half] == 0U)
+  {
+    return NULL;
+  }
+  return &adc_buf[next_half * ADC_STREAM_HALF_LEN];
+}
+
+/**
+  * @brief  Give the block returned by AdcStream_GetBlock() back to the DMA.
+  * @retval None
+  */
+void AdcStream_ReleaseBlock(void)
+{
+  if (half_ready[next_half] != 0U)
+  {
+    half_ready[next_half] = 0U;
+    next_half ^= 1U;
+  }
+}
+
+/**
+  * @brief  Most recent converted sample, without consuming any block.
+  * @retval 12-bit ADC value
+  */
+uint16_t AdcStream_Latest(void)
+{
+  return adc_buf[(last_half * ADC_STREAM_HALF_LEN) + (ADC_STREAM_HALF_LEN - 1U)];
+}
+
+/**
+  * @brief  Snapshot of the hand-off counters.
+  * @param  stats: destination
+  * @retval None
+  */
+void AdcStream_GetStats(AdcStream_StatsTypeDef *stats)
+{
+  stats->blocks = stream_blocks;
+  stats->overruns = stream_overruns;
+  stats->rate_hz = stream_rate_hz;
+  stats->watchdog = stream_watchdog;
+}
+
+/**
+  * @brief  First half of the circular buffer has been filled.
+  * @retval None
+  */
+void AdcStream_HalfCpltHandler(void)
+{
+  AdcStream_Publish(0U);
+}
+
+/**
+  * @brief  Second half of the circular buffer has been filled.
+  * @retval None
+  */
+void AdcStream_CpltHandler(void)
+{
+  AdcStream_Publish(1U);
+}
+
+static void AdcStream_Publish(uint8_t half)
+{
+  if (half_ready[half] != 0U)
+  {
+    stream_overruns++;
+    LogRing_Record(LOG_ADC_OVERRUN, stream_blocks, stream_overruns);
+  }
+  half_ready[half] = 1U;
+  last_half = half;
+  stream_blocks++;
+}
+
+/**
+  * @brief  Conversion DMA half transfer callback.
+  * @param  hadc: ADC handle
+  * @retval None
+  */
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+  if (hadc == stream_hadc)
+  {
+    AdcStream_HalfCpltHandler();
+  }
+}
+
+/**
+  * @brief  Conversion DMA transfer complete callback.
+  * @param  hadc: ADC handle
+  * @retval None
+  */
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+  if (hadc == stream_hadc)
+  {
+    AdcStream_CpltHandler();
+  }
+}
+
+/**
+  * @brief  Analog watchdog 1 callback: flag the stream and mask the
+  *         interrupt until the flag is taken.
+  * @param  hadc: ADC handle
+  * @retval None
+  */
+void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef *hadc)
+{
+  if (hadc == stream_hadc)
+  {
+    __HAL_ADC_DISABLE_IT(hadc, ADC_IT_AWD1);
+    stream_woke = 1U;
+    stream_watchdog++;
+  }
+}
+
+/**
+  * @brief This function handles ADC1 and ADC2 global interrupt.
+  */
+void ADC1_2_IRQHandler(void)
+{
+  HAL_ADC_IRQHandler(stream_hadc);
+}
+
+/**
+  * @brief This function handles DMA1 channel1 global interrupt.
+  */
+void DMA1_Channel1_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_adc1);
+}
@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file           : adc_stream.h
+  * @brief          : Header for adc_stream.c file.
+  *                   Timer-triggered, DMA-backed acquisition of the lux
+  *                   photodiode on ADC1 / ADC_CHANNEL_2, oversampled in
+  *                   hardware and watched by the analog watchdog.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ADC_STREAM_H
+#define __ADC_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Samples per half of the circular DMA buffer. The DMA writes one half while
+   the application owns the other one. */
+#define ADC_STREAM_HALF_LEN          32U
+
+/* Default TIM6 trigger rate used by the questionnaire application. */
+#define ADC_STREAM_DEFAULT_RATE_HZ   1000U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t blocks;      /* half-buffers completed by the DMA            */
+  uint32_t overruns;    /* half-buffers overwritten before being read   */
+  uint32_t rate_hz;     /* effective trigger rate after timer rounding  */
+  uint32_t watchdog;    /* analog watchdog interrupts                   */
+} AdcStream_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef AdcStream_Init(ADC_HandleTypeDef *hadc, uint32_t rate_hz);
+HAL_StatusTypeDef AdcStream_Start(void);
+HAL_StatusTypeDef AdcStream_Stop(void);
+HAL_StatusTypeDef AdcStream_SetRate(uint32_t rate_hz);
+HAL_StatusTypeDef AdcStream_SetWatchdog(uint16_t low, uint16_t high);
+uint8_t AdcStream_TakeWatchdog(void);
+
+const uint16_t *AdcStream_GetBlock(void);
+void AdcStream_ReleaseBlock(void);
+uint16_t AdcStream_Latest(void);
+void AdcStream_GetStats(AdcStream_StatsTypeDef *stats);
+
+/* Buffer hand-off, called from the DMA half/full transfer callbacks */
+void AdcStream_HalfCpltHandler(void);
+void AdcStream_CpltHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ADC_STREAM_H */
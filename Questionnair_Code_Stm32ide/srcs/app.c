@@ -0,0 +1,415 @@
+/**
+  ******************************************************************************
+  * @file           : app.c
+  * @brief          : Questionnaire application superloop.
+  *
+  *                   One App_Step() is one pass of the main loop: refresh the
+  *                   lux value from the ADC stream, score the answers
+  *                   captured by EXTI, show the result band and idle until
+  *                   the next event. The HAL hooks the application relies on
+  *                   live here too, so the host simulation runs the exact
+  *                   code flashed on the board.
+  *
+  *                   Each session leaves its summary and its lux trace in
+  *                   the QSPI session store; the summary is kept across
+  *                   compactions, the trace only until its sector is
+  *                   reused.
+  *
+  *                   Every scored answer is followed by a CONTEXT
+  *                   telemetry record with the sensor hub readings of the
+  *                   moment: temperature, humidity, magnetic field and
+  *                   whether someone stands in front of the board.
+  *
+  *                   While a session runs, the microphone is captured for
+  *                   APP_LISTEN_MS of every APP_LISTEN_PERIOD_MS and
+  *                   reduced to frame features as its blocks arrive; the
+  *                   session summary logs how many frames were voiced.
+  *                   The capture keeps the core out of Stop2, so it is
+  *                   duty-cycled rather than left running: the listening
+  *                   periods start on the wake-up that follows their due
+  *                   time, at most one LPTIM1 sample period late.
+  *
+  *                   The stages of App_Step() and the SysTick blink engine
+  *                   are profiled per session (profile.c); their cycle
+  *                   counts follow the END telemetry record.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "app.h"
+#include "adc_stream.h"
+#include "lux_filter.h"
+#include "led_pattern.h"
+#include "power_mgr.h"
+#include "log_ring.h"
+#include "telemetry.h"
+#include "flash_log.h"
+#include "sensor_hub.h"
+#include "audio_capture.h"
+#include "profile.h"
+#include "emotion_net.h"
+#include <stddef.h>
+
+/* Private define ------------------------------------------------------------*/
+#define APP_TRACE_LEN(n)   ((uint16_t)(offsetof(App_TraceRecordTypeDef, lux) + ((n) * sizeof(uint16_t))))
+
+_Static_assert((APP_STORE_QSPI_BASE + APP_STORE_QSPI_SIZE) <= EMOTION_NET_QSPI_BASE,
+               "APP_STORE_QSPI_SIZE: the session store overlaps the emotion CNN weights");
+
+/* Private variables ---------------------------------------------------------*/
+static uint16_t app_lux;
+static uint8_t app_lux_fresh;     /* a block arrived since the last Stop2 */
+static uint8_t app_reported;      /* END telemetry record sent */
+static Questionnaire_AgeTypeDef app_age;
+static uint32_t app_start_tick;
+static App_TraceRecordTypeDef app_trace;
+static uint8_t app_question;      /* answers the context was sent for */
+static AudioFeatures_FrameTypeDef app_audio;
+static uint32_t app_frames;       /* audio frames this session */
+static uint32_t app_voiced;       /* of which voiced */
+static uint32_t app_listen_tick;  /* start of the current listening period */
+
+/* Private function prototypes -----------------------------------------------*/
+static void App_Report(uint8_t result);
+static void App_LuxWindow(void);
+static void App_Trace(uint16_t lux);
+static void App_TraceStore(void);
+static void App_Context(uint8_t question);
+static void App_Audio(const AudioFeatures_FrameTypeDef *frame);
+static void App_Listen(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Start a questionnaire session.
+  * @note   AdcStream, LedPattern, Power and Telemetry must already be
+  *         initialised; FlashLog too, or the session is not stored, and
+  *         SensorHub, or answers go without their context, and
+  *         AudioCapture, or the session is not listened to.
+  * @param  age: age group selecting the scoring profile
+  * @retval None
+  */
+void App_Init(Questionnaire_AgeTypeDef age)
+{
+  FlashLog_StatsTypeDef store;
+
+  app_lux = 0U;
+  app_lux_fresh = 0U;
+  app_reported = 0U;
+  app_age = age;
+  app_start_tick = HAL_GetTick();
+  app_trace.count = 0U;
+  app_question = 0U;
+  app_frames = 0U;
+  app_voiced = 0U;
+  app_listen_tick = app_start_tick;
+  Questionnaire_Init(age);
+  Questionnaire_ConfigExti();
+  LuxFilter_Init(Questionnaire_LuxThreshold());
+  App_LuxWindow();
+  LogRing_Record(LOG_BOOT, (uint32_t)age, 0U);
+  FlashLog_GetStats(&store);
+  LogRing_Record(LOG_STORE, store.next_record, store.max_erase_count);
+  Telemetry_Begin((uint8_t)age);
+  Profile_Reset();
+  AudioFeatures_Reset();
+  (void)AudioCapture_Start();
+}
+
+/**
+  * @brief  One pass of the superloop.
+  * @retval HAL_OK when the result pattern was queued during this pass,
+  *         HAL_BUSY otherwise
+  */
+HAL_StatusTypeDef App_Step(void)
+{
+  const uint16_t *lux_block;
+  const int16_t *audio_block;
+  HAL_StatusTypeDef shown = HAL_BUSY;
+  Questionnaire_StateTypeDef state;
+  uint32_t step = Profile_Begin();
+  uint32_t t0;
+
+  /* lux is streamed by TIM6 + DMA, oversampled by the ADC; the filter
+     only looks into the blocks the analog watchdog woke it for */
+  while ((lux_block = AdcStream_GetBlock()) != NULL)
+  {
+    LuxFilter_EventTypeDef event;
+
+    t0 = Profile_Begin();
+    event = LuxFilter_Block(lux_block, AdcStream_TakeWatchdog());
+    Profile_End(PROFILE_LUX_FILTER, t0);
+    AdcStream_ReleaseBlock();
+    if (event != LUX_FILTER_NONE)
+    {
+      App_LuxWindow();
+    }
+    app_lux = LuxFilter_Value();
+    app_lux_fresh = 1U;
+    Telemetry_Sample(app_lux);
+    App_Trace(app_lux);
+  }
+  t0 = Profile_Begin();
+  Questionnaire_OnLux(LuxFilter_High(), app_lux, HAL_GetTick());
+  Profile_End(PROFILE_LUX, t0);
+
+  /* microphone blocks are one feature hop each */
+  while ((audio_block = AudioCapture_GetBlock()) != NULL)
+  {
+    t0 = Profile_Begin();
+    AudioFeatures_Push(audio_block, &app_audio);
+    Profile_End(PROFILE_AUDIO, t0);
+    AudioCapture_ReleaseBlock();
+    App_Audio(&app_audio);
+  }
+  App_Listen();
+  t0 = Profile_Begin();
+  SensorHub_Process();
+  Profile_End(PROFILE_SENSORS, t0);
+
+  /* answers arrive through EXTI; show the result band once all are scored */
+  t0 = Profile_Begin();
+  state = Questionnaire_Process();
+  Profile_End(PROFILE_SCORE, t0);
+  if ((state == QUESTIONNAIRE_DONE) && (LedPattern_Busy() == 0U))
+  {
+    LedPattern_IdTypeDef pattern;
+    HAL_StatusTypeDef result = Questionnaire_GetResult(&pattern);
+
+    if ((result == HAL_OK) && (LedPattern_Enqueue(pattern) == HAL_OK))
+    {
+      LogRing_Record(LOG_RESULT, (uint32_t)pattern, Questionnaire_Score());
+      shown = HAL_OK;
+    }
+    if ((app_reported == 0U) && ((shown == HAL_OK) || (result == HAL_ERROR)))
+    {
+      App_Report((result == HAL_OK) ? (uint8_t)pattern : TELEMETRY_NO_RESULT);
+    }
+  }
+
+  while (app_question < Questionnaire_Index())
+  {
+    App_Context(++app_question);
+  }
+
+  LogRing_Flush();
+  Telemetry_Flush();
+  Profile_End(PROFILE_STEP, step);
+
+  /* stop the clocks once the lux value is refreshed, nothing blinks, the
+     log and telemetry are drained, the sensor bus is idle and the
+     microphone is between two listening periods; the LPTIM1 sample tick,
+     an answer button or a sensor data-ready line wakes the core again */
+  if ((LedPattern_Busy() != 0U) || (app_lux_fresh == 0U) || (LogRing_Busy() != 0U)
+      || (Telemetry_Busy() != 0U) || (SensorHub_Busy() != 0U) || (AudioCapture_Running() != 0U))
+  {
+    Power_Idle(POWER_IDLE_SLEEP);
+  }
+  else
+  {
+    app_lux_fresh = 0U;
+    Power_Idle(POWER_IDLE_STOP2);
+  }
+
+  return shown;
+}
+
+/**
+  * @brief  Filtered lux value at the end of the last block.
+  * @retval 12-bit ADC value
+  */
+uint16_t App_Lux(void)
+{
+  return app_lux;
+}
+
+/**
+  * @brief  Whether the session summary has been sent.
+  * @retval 1 once App_Report() ran for this session, 0 before
+  */
+uint8_t App_Reported(void)
+{
+  return app_reported;
+}
+
+/**
+  * @brief  SysTick time base hook, overrides the weak HAL implementation.
+  *         Keeps the HAL tick and runs the tick-driven application engines.
+  * @retval None
+  */
+void HAL_IncTick(void)
+{
+  uint32_t t0 = Profile_Begin();
+
+  uwTick += (uint32_t)uwTickFreq;
+  LedPattern_Tick();
+  Profile_End(PROFILE_LED_TICK, t0);
+}
+
+/**
+  * @brief  Tx Transfer completed callback, shared by the USART1 log and the
+  *         USART2 telemetry streams.
+  * @param  huart: UART handle
+  * @retval None
+  */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  LogRing_TxCpltHandler(huart);
+  Telemetry_TxCpltHandler(huart);
+}
+
+/**
+  * @brief  EXTI line detection callback.
+  * @param  GPIO_Pin: pin whose EXTI line fired
+  * @retval None
+  */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  if ((GPIO_Pin & QUESTIONNAIRE_PINS) != 0U)
+  {
+    Questionnaire_OnEdge(GPIO_Pin, HAL_GPIO_ReadPin(QUESTIONNAIRE_PORT, GPIO_Pin), HAL_GetTick());
+  }
+  if ((GPIO_Pin & SENSOR_HUB_DRDY_PINS) != 0U)
+  {
+    SensorHub_OnDrdy(GPIO_Pin);
+  }
+}
+
+/* Session summary for the telemetry stream, sent once per session */
+static void App_Report(uint8_t result)
+{
+  Questionnaire_StatsTypeDef stats;
+  Telemetry_SessionTypeDef session;
+  App_SessionRecordTypeDef record;
+  SensorHub_StatsTypeDef sensors;
+
+  Questionnaire_GetStats(&stats);
+  SensorHub_GetStats(&sensors);
+  LogRing_Record(LOG_SENSORS, SensorHub_Present(), sensors.errors);
+  (void)AudioCapture_Stop();
+  if (app_frames != 0U)
+  {
+    LogRing_Record(LOG_AUDIO, app_frames, app_voiced);
+  }
+  session.answers = Questionnaire_Index();
+  session.result = result;
+  session.score = Questionnaire_Score();
+  session.max_latency_ms = stats.max_latency_ms;
+  session.bounces = stats.bounces;
+  session.presses_dropped = stats.dropped;
+  Telemetry_End(&session);
+  Profile_Export();
+  app_reported = 1U;
+
+  /* The summary is made durable with the trace that led to it */
+  record.age = (uint8_t)app_age;
+  record.reserved[0] = 0U;
+  record.reserved[1] = 0U;
+  record.reserved[2] = 0U;
+  record.start_tick = app_start_tick;
+  record.summary = session;
+  App_TraceStore();
+  (void)FlashLog_Append(APP_RECORD_SESSION, &record, sizeof(record), FLASH_LOG_KEEP);
+  (void)FlashLog_Sync();
+}
+
+/* Watch the lux stream for the next crossing of the filter */
+static void App_LuxWindow(void)
+{
+  uint16_t low;
+  uint16_t high;
+
+  LuxFilter_Window(&low, &high);
+  if (AdcStream_SetWatchdog(low, high) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/* Batch filtered lux values into trace records; pages are programmed as the
+   store fills them, not per sample */
+static void App_Trace(uint16_t lux)
+{
+  if (app_trace.count == 0U)
+  {
+    app_trace.tick = HAL_GetTick();
+  }
+  app_trace.lux[app_trace.count++] = lux;
+  if (app_trace.count == APP_TRACE_SAMPLES)
+  {
+    App_TraceStore();
+  }
+}
+
+static void App_TraceStore(void)
+{
+  if (app_trace.count != 0U)
+  {
+    app_trace.reserved = 0U;
+    (void)FlashLog_Append(APP_RECORD_TRACE, &app_trace, APP_TRACE_LEN(app_trace.count), 0U);
+    app_trace.count = 0U;
+  }
+}
+
+/* Sensor context of the answer just scored, if any sensor answers */
+static void App_Context(uint8_t question)
+{
+  SensorHub_ContextTypeDef ctx;
+  Telemetry_ContextTypeDef context;
+
+  if (SensorHub_Present() == 0U)
+  {
+    return;
+  }
+  SensorHub_GetContext(&ctx);
+  context.question = question;
+  context.valid = ctx.valid;
+  context.presence = ctx.presence;
+  context.handled = ctx.handled;
+  context.temperature_cdeg = ctx.temperature_cdeg;
+  context.humidity_permille = ctx.humidity_permille;
+  context.mag_mgauss[0] = ctx.mag_mgauss[0];
+  context.mag_mgauss[1] = ctx.mag_mgauss[1];
+  context.mag_mgauss[2] = ctx.mag_mgauss[2];
+  context.range_mm = ctx.range_mm;
+  context.env_age_ms = ctx.env_age_ms;
+  context.mag_age_ms = ctx.mag_age_ms;
+  context.range_age_ms = ctx.range_age_ms;
+  context.reserved = 0U;
+  Telemetry_Context(&context);
+}
+
+/* Count the frames that carry voice */
+static void App_Audio(const AudioFeatures_FrameTypeDef *frame)
+{
+  app_frames++;
+  if ((frame->log_energy > APP_VOICED_LOG_ENERGY) && (frame->zero_crossings < APP_VOICED_CROSSINGS))
+  {
+    app_voiced++;
+  }
+}
+
+/* Microphone duty cycle, until the session is reported */
+static void App_Listen(void)
+{
+  uint32_t elapsed = HAL_GetTick() - app_listen_tick;
+
+  if (app_reported != 0U)
+  {
+    return;
+  }
+  if (AudioCapture_Running() != 0U)
+  {
+    if (elapsed >= APP_LISTEN_MS)
+    {
+      (void)AudioCapture_Stop();
+    }
+  }
+  else if (elapsed >= APP_LISTEN_PERIOD_MS)
+  {
+    /* A new stream: the first frame does not overlap the last period */
+    app_listen_tick += APP_LISTEN_PERIOD_MS * (elapsed / APP_LISTEN_PERIOD_MS);
+    AudioFeatures_Reset();
+    (void)AudioCapture_Start();
+  }
+}
@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file           : app.h
+  * @brief          : Header for app.c file.
+  *                   Questionnaire application superloop, shared by the
+  *                   firmware main() and the host simulation runner.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __APP_H
+#define __APP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "questionnaire.h"
+#include "telemetry.h"
+#include "audio_features.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Record types of the session store (flash_log.c) */
+#define APP_RECORD_SESSION     1U      /* App_SessionRecordTypeDef, KEEP */
+#define APP_RECORD_TRACE       2U      /* App_TraceRecordTypeDef         */
+
+/* QSPI region of the session store, from the bottom of the chip up to the
+   emotion CNN weights (EMOTION_NET_QSPI_BASE) */
+#define APP_STORE_QSPI_BASE    0U
+#define APP_STORE_QSPI_SIZE    0x500000U
+
+/* Filtered lux values, one per block, per trace record */
+#define APP_TRACE_SAMPLES      64U
+
+/* Audio frame counted as voiced: louder than about -63 dBFS, with fewer
+   zero crossings than fricatives and noise give */
+#define APP_VOICED_LOG_ENERGY  (8 * AUDIO_FEATURES_LOG_ONE)
+#define APP_VOICED_CROSSINGS   120U
+
+/* DFSDM1 stops in Stop2: a session is listened to for APP_LISTEN_MS out of
+   every APP_LISTEN_PERIOD_MS, and the core may stop for the rest */
+#define APP_LISTEN_MS          1000U
+#define APP_LISTEN_PERIOD_MS   4000U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint8_t age;
+  uint8_t reserved[3];
+  uint32_t start_tick;                 /* HAL tick at App_Init           */
+  Telemetry_SessionTypeDef summary;
+} App_SessionRecordTypeDef;
+
+typedef struct
+{
+  uint32_t tick;                       /* HAL tick of lux[0]             */
+  uint16_t count;
+  uint16_t reserved;
+  uint16_t lux[APP_TRACE_SAMPLES];     /* only count are stored          */
+} App_TraceRecordTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void App_Init(Questionnaire_AgeTypeDef age);
+HAL_StatusTypeDef App_Step(void);
+uint16_t App_Lux(void);
+uint8_t App_Reported(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APP_H */
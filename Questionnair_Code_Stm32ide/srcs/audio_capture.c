@@ -0,0 +1,274 @@
+/**
+  ******************************************************************************
+  * @file           : audio_capture.c
+  * @brief          : DMA-backed acquisition of the MEMS microphone.
+  *
+  *                   The MP34DT01 is clocked from DFSDM1_CKOUT (PE9) and
+  *                   its PDM stream enters on DATIN2 (PE7), which CubeMX
+  *                   routes to DFSDM1 Channel1. Filter 2 decimates it to
+  *                   16-bit PCM at AUDIO_FEATURES_RATE_HZ in continuous
+  *                   mode, and DMA1 Channel6 moves the results into a
+  *                   circular buffer split in two halves; the half/full
+  *                   transfer callbacks hand a completed half over to the
+  *                   application while the DMA keeps filling the other one.
+  *
+  *                   Filter 2 is used because its DMA request (DMA1
+  *                   Channel6, request 0) is the only DFSDM one left free
+  *                   by the log, sensor bus and telemetry channels.
+  *
+  *                   DFSDM stops in Stop2: the application keeps the core
+  *                   in Sleep while the capture runs.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "audio_capture.h"
+#include "log_ring.h"
+
+/* Private define ------------------------------------------------------------*/
+#define AUDIO_CAPTURE_BUF_LEN   (2U * AUDIO_CAPTURE_HALF_LEN)
+
+/* Private variables ---------------------------------------------------------*/
+DFSDM_Filter_HandleTypeDef hdfsdm1_filter2;
+DMA_HandleTypeDef hdma_dfsdm1_flt2;
+
+static DFSDM_Channel_HandleTypeDef *capture_hchannel;
+static int16_t capture_buf[AUDIO_CAPTURE_BUF_LEN];
+static uint8_t capture_running;
+
+/* One flag per half so that the DMA callbacks and the application never
+   read-modify-write the same byte. */
+static volatile uint8_t capture_ready[2];
+static uint8_t capture_next;
+
+static volatile uint32_t capture_blocks;
+static volatile uint32_t capture_overruns;
+
+/* Private function prototypes -----------------------------------------------*/
+static void AudioCapture_Publish(uint8_t half);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Re-initialise the microphone channel for a PDM clock the
+  *         MP34DT01 accepts, then configure filter 2 and its DMA channel.
+  * @note   Call after MX_DFSDM1_Init(); only the output clock divider and
+  *         the right shift generated by CubeMX are overridden.
+  * @param  hchannel: channel handle initialised by MX_DFSDM1_Init
+  * @retval HAL status
+  */
+HAL_StatusTypeDef AudioCapture_Init(DFSDM_Channel_HandleTypeDef *hchannel)
+{
+  capture_running = 0U;
+
+  /* The clock divider is global to DFSDM1 and only taken from the first
+     channel initialised, so the channel goes through a full de-init */
+  if (HAL_DFSDM_ChannelDeInit(hchannel) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  hchannel->Init.OutputClock.Divider = AUDIO_CAPTURE_CKOUT_DIVIDER;
+  hchannel->Init.RightBitShift = AUDIO_CAPTURE_RIGHT_SHIFT;
+  if (HAL_DFSDM_ChannelInit(hchannel) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  /* DMA1 Channel6 request 0 is DFSDM1_FLT2 on the STM32L475 */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  hdma_dfsdm1_flt2.Instance = DMA1_Channel6;
+  hdma_dfsdm1_flt2.Init.Request = DMA_REQUEST_0;
+  hdma_dfsdm1_flt2.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_dfsdm1_flt2.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_dfsdm1_flt2.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_dfsdm1_flt2.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_dfsdm1_flt2.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_dfsdm1_flt2.Init.Mode = DMA_CIRCULAR;
+  hdma_dfsdm1_flt2.Init.Priority = DMA_PRIORITY_HIGH;
+  if (HAL_DMA_Init(&hdma_dfsdm1_flt2) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  hdfsdm1_filter2.Instance = DFSDM1_Filter2;
+  hdfsdm1_filter2.Init.RegularParam.Trigger = DFSDM_FILTER_SW_TRIGGER;
+  hdfsdm1_filter2.Init.RegularParam.FastMode = ENABLE;
+  hdfsdm1_filter2.Init.RegularParam.DmaMode = ENABLE;
+  hdfsdm1_filter2.Init.InjectedParam.Trigger = DFSDM_FILTER_SW_TRIGGER;
+  hdfsdm1_filter2.Init.InjectedParam.ScanMode = DISABLE;
+  hdfsdm1_filter2.Init.InjectedParam.DmaMode = DISABLE;
+  hdfsdm1_filter2.Init.InjectedParam.ExtTrigger = DFSDM_FILTER_EXT_TRIG_TIM1_TRGO;
+  hdfsdm1_filter2.Init.InjectedParam.ExtTriggerEdge = DFSDM_FILTER_EXT_TRIG_RISING_EDGE;
+  hdfsdm1_filter2.Init.FilterParam.SincOrder = DFSDM_FILTER_SINC4_ORDER;
+  hdfsdm1_filter2.Init.FilterParam.Oversampling = AUDIO_CAPTURE_SINC_OSR;
+  hdfsdm1_filter2.Init.FilterParam.IntOversampling = 1;
+  if (HAL_DFSDM_FilterInit(&hdfsdm1_filter2) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  __HAL_LINKDMA(&hdfsdm1_filter2, hdmaReg, hdma_dfsdm1_flt2);
+  if (HAL_DFSDM_FilterConfigRegChannel(&hdfsdm1_filter2, DFSDM_CHANNEL_1, DFSDM_CONTINUOUS_CONV_ON) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  HAL_NVIC_SetPriority(DMA1_Channel6_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+
+  AudioFeatures_Init();
+  capture_hchannel = hchannel;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Start continuous conversions into the circular buffer.
+  * @retval HAL status, HAL_ERROR if AudioCapture_Init() did not succeed
+  */
+HAL_StatusTypeDef AudioCapture_Start(void)
+{
+  if (capture_hchannel == NULL)
+  {
+    return HAL_ERROR;
+  }
+  if (capture_running != 0U)
+  {
+    return HAL_OK;
+  }
+  capture_ready[0] = 0U;
+  capture_ready[1] = 0U;
+  capture_next = 0U;
+
+  /* the 16 MSBs of each 24-bit result, as halfwords */
+  if (HAL_DFSDM_FilterRegularMsbStart_DMA(&hdfsdm1_filter2, capture_buf, AUDIO_CAPTURE_BUF_LEN) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  capture_running = 1U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Stop the conversions and the DMA transfer.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef AudioCapture_Stop(void)
+{
+  if (capture_running == 0U)
+  {
+    return HAL_OK;
+  }
+  capture_running = 0U;
+  return HAL_DFSDM_FilterRegularStop_DMA(&hdfsdm1_filter2);
+}
+
+/**
+  * @brief  Whether the microphone is being sampled.
+  * @retval 1 between AudioCapture_Start() and AudioCapture_Stop()
+  */
+uint8_t AudioCapture_Running(void)
+{
+  return capture_running;
+}
+
+/**
+  * @brief  Oldest completed half-buffer not yet released by the application.
+  * @retval Pointer to AUDIO_CAPTURE_HALF_LEN samples, or NULL if none is
+  *         ready. The block stays valid until AudioCapture_ReleaseBlock()
+  *         is called or until the DMA wraps around onto it (counted as an
+  *         overrun).
+  */
+const int16_t *AudioCapture_GetBlock(void)
+{
+  if (capture_ready[capture_next] == 0U)
+  {
+    return NULL;
+  }
+  return &capture_buf[capture_next * AUDIO_CAPTURE_HALF_LEN];
+}
+
+/**
+  * @brief  Give the block returned by AudioCapture_GetBlock() back to the DMA.
+  * @retval None
+  */
+void AudioCapture_ReleaseBlock(void)
+{
+  if (capture_ready[capture_next] != 0U)
+  {
+    capture_ready[capture_next] = 0U;
+    capture_next ^= 1U;
+  }
+}
+
+/**
+  * @brief  Snapshot of the hand-off counters.
+  * @param  stats: destination
+  * @retval None
+  */
+void AudioCapture_GetStats(AudioCapture_StatsTypeDef *stats)
+{
+  stats->blocks = capture_blocks;
+  stats->overruns = capture_overruns;
+}
+
+/**
+  * @brief  First half of the circular buffer has been filled.
+  * @retval None
+  */
+void AudioCapture_HalfCpltHandler(void)
+{
+  AudioCapture_Publish(0U);
+}
+
+/**
+  * @brief  Second half of the circular buffer has been filled.
+  * @retval None
+  */
+void AudioCapture_CpltHandler(void)
+{
+  AudioCapture_Publish(1U);
+}
+
+static void AudioCapture_Publish(uint8_t half)
+{
+  if (capture_ready[half] != 0U)
+  {
+    capture_overruns++;
+    LogRing_Record(LOG_AUDIO_OVERRUN, capture_blocks, capture_overruns);
+  }
+  capture_ready[half] = 1U;
+  capture_blocks++;
+}
+
+/**
+  * @brief  Regular conversion DMA half transfer callback.
+  * @param  hdfsdm_filter: DFSDM filter handle
+  * @retval None
+  */
+void HAL_DFSDM_FilterRegConvHalfCpltCallback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
+{
+  if (hdfsdm_filter == &hdfsdm1_filter2)
+  {
+    AudioCapture_HalfCpltHandler();
+  }
+}
+
+/**
+  * @brief  Regular conversion DMA transfer complete callback.
+  * @param  hdfsdm_filter: DFSDM filter handle
+  * @retval None
+  */
+void HAL_DFSDM_FilterRegConvCpltCallback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
+{
+  if (hdfsdm_filter == &hdfsdm1_filter2)
+  {
+    AudioCapture_CpltHandler();
+  }
+}
+
+/**
+  * @brief This function handles DMA1 channel6 global interrupt.
+  */
+void DMA1_Channel6_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_dfsdm1_flt2);
+}
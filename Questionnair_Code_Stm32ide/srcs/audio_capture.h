@@ -0,0 +1,61 @@
+/**
+  ******************************************************************************
+  * @file           : audio_capture.h
+  * @brief          : Header for audio_capture.c file.
+  *                   DMA-backed acquisition of the MP34DT01 MEMS microphone
+  *                   through DFSDM1.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __AUDIO_CAPTURE_H
+#define __AUDIO_CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "audio_features.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Samples per half of the circular DMA buffer: one feature hop, 16 ms */
+#define AUDIO_CAPTURE_HALF_LEN       AUDIO_FEATURES_HOP_LEN
+
+/* PDM clock and decimation: 80 MHz / 40 = 2 MHz on CKOUT, Sinc4 filter
+   decimating by 125 gives AUDIO_FEATURES_RATE_HZ */
+#define AUDIO_CAPTURE_CKOUT_DIVIDER  40U
+#define AUDIO_CAPTURE_SINC_OSR       125U
+
+/* Sinc4 at OSR 125 has a gain of 125^4 (~2^27.9); the channel shifts it
+   down to 24 bits and the DMA keeps the 16 MSBs, so full scale is about
+   +/-29800 */
+#define AUDIO_CAPTURE_RIGHT_SHIFT    5U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t blocks;      /* half-buffers completed by the DMA            */
+  uint32_t overruns;    /* half-buffers overwritten before being read   */
+} AudioCapture_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef AudioCapture_Init(DFSDM_Channel_HandleTypeDef *hchannel);
+HAL_StatusTypeDef AudioCapture_Start(void);
+HAL_StatusTypeDef AudioCapture_Stop(void);
+uint8_t AudioCapture_Running(void);
+
+const int16_t *AudioCapture_GetBlock(void);
+void AudioCapture_ReleaseBlock(void);
+void AudioCapture_GetStats(AudioCapture_StatsTypeDef *stats);
+
+/* Buffer hand-off, called from the DMA half/full transfer callbacks */
+void AudioCapture_HalfCpltHandler(void);
+void AudioCapture_CpltHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_CAPTURE_H */
@@ -0,0 +1,459 @@
+/**
+  ******************************************************************************
+  * @file           : audio_features.c
+  * @brief          : Fixed-point frame features of the microphone stream.
+  *
+  *                   Every AUDIO_FEATURES_HOP_LEN block from AudioCapture
+  *                   goes through a DC blocker into a sliding
+  *                   AUDIO_FEATURES_FRAME_LEN window, which yields one frame
+  *                   of features: mean square energy, zero crossings and 24
+  *                   log-mel band energies from a 512-point FFT.
+  *
+  *                   Samples are handled as packed 16-bit pairs so that the
+  *                   Cortex-M4 DSP instructions do two lanes at a time: dual
+  *                   multiply-accumulate for the energy, halving dual
+  *                   add/subtract for the FFT butterflies, cross multiplies
+  *                   for the twiddles and the power spectrum. Without
+  *                   __ARM_FEATURE_DSP the same operations are plain C with
+  *                   identical results, which is what the host bench runs.
+  *
+  *                   The FFT halves its data at every stage so nothing can
+  *                   overflow; to keep the resolution of quiet frames, the
+  *                   frame is shifted up to its peak before the window and
+  *                   the shift is taken back out in the log domain.
+  *
+  *                   The tables (twiddles, Hann window, mel filters) are
+  *                   computed once by AudioFeatures_Init(); a new stream
+  *                   only needs AudioFeatures_Reset().
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "audio_features.h"
+#include <math.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define AF_N              AUDIO_FEATURES_FRAME_LEN
+#define AF_LOG2_N         9U
+#define AF_HOP            AUDIO_FEATURES_HOP_LEN
+#define AF_BINS           AUDIO_FEATURES_BINS
+#define AF_BANDS          AUDIO_FEATURES_MEL_BANDS
+#define AF_DC_POLE        32604        /* 0.995 in Q15, corner near 13 Hz */
+#define AF_DC_FRAC        8U           /* fraction bits of the DC state */
+#define AF_Q15            32767.0
+#define AF_PI             3.14159265358979323846
+
+/* Packed 16-bit pair helpers ------------------------------------------------*/
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#define AF_SMLALD(x, y, acc)   __SMLALD((x), (y), (acc))
+#define AF_SMUAD(x, y)         __SMUAD((x), (y))
+#define AF_SMLSD(x, y, acc)    __SMLSD((x), (y), (acc))
+#define AF_SMLADX(x, y, acc)   __SMLADX((x), (y), (acc))
+#define AF_SHADD16(x, y)       __SHADD16((x), (y))
+#define AF_SHSUB16(x, y)       __SHSUB16((x), (y))
+#define AF_PKHBT(x, y, s)      __PKHBT((x), (y), (s))
+#define AF_CLZ(x)              __CLZ(x)
+#else
+static inline int32_t AF_Lo(uint32_t x)
+{
+  return (int32_t)(int16_t)(uint16_t)(x & 0xFFFFU);
+}
+
+static inline int32_t AF_Hi(uint32_t x)
+{
+  return (int32_t)(int16_t)(uint16_t)(x >> 16);
+}
+
+static inline uint64_t AF_SMLALD(uint32_t x, uint32_t y, uint64_t acc)
+{
+  return (uint64_t)((int64_t)acc + (int64_t)(AF_Lo(x) * AF_Lo(y)) + (int64_t)(AF_Hi(x) * AF_Hi(y)));
+}
+
+static inline uint32_t AF_SMUAD(uint32_t x, uint32_t y)
+{
+  return (uint32_t)((int64_t)(AF_Lo(x) * AF_Lo(y)) + (int64_t)(AF_Hi(x) * AF_Hi(y)));
+}
+
+static inline uint32_t AF_SMLSD(uint32_t x, uint32_t y, uint32_t acc)
+{
+  return (uint32_t)((int32_t)acc + ((AF_Lo(x) * AF_Lo(y)) - (AF_Hi(x) * AF_Hi(y))));
+}
+
+static inline uint32_t AF_SMLADX(uint32_t x, uint32_t y, uint32_t acc)
+{
+  return (uint32_t)((int64_t)(int32_t)acc + (int64_t)(AF_Lo(x) * AF_Hi(y)) + (int64_t)(AF_Hi(x) * AF_Lo(y)));
+}
+
+static inline uint32_t AF_PKHBT(uint32_t x, uint32_t y, uint32_t s)
+{
+  return (x & 0xFFFFU) | ((y << s) & 0xFFFF0000U);
+}
+
+static inline uint32_t AF_SHADD16(uint32_t x, uint32_t y)
+{
+  return AF_PKHBT((uint32_t)((AF_Lo(x) + AF_Lo(y)) >> 1), (uint32_t)((AF_Hi(x) + AF_Hi(y)) >> 1), 16U);
+}
+
+static inline uint32_t AF_SHSUB16(uint32_t x, uint32_t y)
+{
+  return AF_PKHBT((uint32_t)((AF_Lo(x) - AF_Lo(y)) >> 1), (uint32_t)((AF_Hi(x) - AF_Hi(y)) >> 1), 16U);
+}
+
+static inline uint32_t AF_CLZ(uint32_t x)
+{
+  uint32_t n = 0U;
+
+  if (x == 0U)
+  {
+    return 32U;
+  }
+  while ((x & 0x80000000U) == 0U)
+  {
+    x <<= 1;
+    n++;
+  }
+  return n;
+}
+#endif
+
+/* Two consecutive samples as one word, low half first */
+static inline uint32_t AF_Pair(const int16_t *p)
+{
+  uint32_t v;
+
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t af_twiddle[AF_N / 2U];      /* exp(-j2pik/N), im:re Q15 */
+static int16_t af_window[AF_N];             /* periodic Hann, Q15 */
+static uint16_t af_reverse[AF_N];           /* bit-reversed index */
+static int16_t af_mel_w[2U * AF_BINS];      /* every band's weights, Q15 */
+static uint16_t af_mel_first[AF_BANDS];
+static uint16_t af_mel_count[AF_BANDS];
+static uint16_t af_mel_offset[AF_BANDS];
+
+static int16_t af_frame[AF_N];              /* DC-free signal, oldest first */
+static uint32_t af_fft[AF_N];               /* im:re pairs */
+static uint32_t af_power[AF_BINS];
+static int16_t af_dc_x;
+static int32_t af_dc_y;
+static uint32_t af_index;
+
+/* Private function prototypes -----------------------------------------------*/
+static void AudioFeatures_DcBlock(const int16_t *hop, int16_t *out);
+static uint32_t AudioFeatures_Peak(const int16_t *x, uint32_t n);
+static void AudioFeatures_Fft(void);
+static void AudioFeatures_Mel(int32_t scale, int16_t *log_mel);
+static double AudioFeatures_HzToMel(double hz);
+static double AudioFeatures_MelToHz(double mel);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Build the tables and clear the stream state.
+  * @retval None
+  */
+void AudioFeatures_Init(void)
+{
+  double edge[AF_BANDS + 2U];
+  double mel_low = AudioFeatures_HzToMel((double)AUDIO_FEATURES_MEL_LOW_HZ);
+  double mel_high = AudioFeatures_HzToMel((double)AUDIO_FEATURES_MEL_HIGH_HZ);
+  uint32_t used = 0U;
+
+  for (uint32_t k = 0U; k < (AF_N / 2U); k++)
+  {
+    double phase = (2.0 * AF_PI * (double)k) / (double)AF_N;
+    int32_t re = (int32_t)lround(cos(phase) * AF_Q15);
+    int32_t im = (int32_t)lround(-sin(phase) * AF_Q15);
+
+    af_twiddle[k] = AF_PKHBT((uint32_t)re, (uint32_t)im, 16U);
+  }
+
+  for (uint32_t n = 0U; n < AF_N; n++)
+  {
+    uint32_t r = 0U;
+
+    af_window[n] = (int16_t)lround((0.5 - (0.5 * cos((2.0 * AF_PI * (double)n) / (double)AF_N))) * AF_Q15);
+    for (uint32_t b = 0U; b < AF_LOG2_N; b++)
+    {
+      r |= ((n >> b) & 1U) << (AF_LOG2_N - 1U - b);
+    }
+    af_reverse[n] = (uint16_t)r;
+  }
+
+  /* filter edges as fractional FFT bins */
+  for (uint32_t m = 0U; m < (AF_BANDS + 2U); m++)
+  {
+    double mel = mel_low + (((mel_high - mel_low) * (double)m) / (double)(AF_BANDS + 1U));
+
+    edge[m] = (AudioFeatures_MelToHz(mel) * (double)AF_N) / (double)AUDIO_FEATURES_RATE_HZ;
+  }
+  for (uint32_t b = 0U; b < AF_BANDS; b++)
+  {
+    uint32_t first = (uint32_t)floor(edge[b]) + 1U;
+    uint32_t last = (uint32_t)ceil(edge[b + 2U]) - 1U;
+
+    af_mel_first[b] = (uint16_t)first;
+    af_mel_offset[b] = (uint16_t)used;
+    for (uint32_t k = first; k <= last; k++)
+    {
+      double w = ((double)k <= edge[b + 1U]) ? (((double)k - edge[b]) / (edge[b + 1U] - edge[b]))
+                                             : ((edge[b + 2U] - (double)k) / (edge[b + 2U] - edge[b + 1U]));
+
+      af_mel_w[used++] = (int16_t)lround(w * AF_Q15);
+    }
+    af_mel_count[b] = (uint16_t)(last + 1U - first);
+  }
+
+  AudioFeatures_Reset();
+}
+
+/**
+  * @brief  Forget the stream: the next frame starts from silence.
+  * @retval None
+  */
+void AudioFeatures_Reset(void)
+{
+  memset(af_frame, 0, sizeof(af_frame));
+  af_dc_x = 0;
+  af_dc_y = 0;
+  af_index = 0U;
+}
+
+/**
+  * @brief  Take the next hop of the stream and compute the frame ending
+  *         with it. The frame before the first hop is silence.
+  * @param  hop: AUDIO_FEATURES_HOP_LEN samples at AUDIO_FEATURES_RATE_HZ
+  * @param  frame: destination
+  * @retval None
+  */
+void AudioFeatures_Push(const int16_t *hop, AudioFeatures_FrameTypeDef *frame)
+{
+  uint64_t energy;
+  uint32_t peak;
+  int32_t shift;
+
+  memmove(af_frame, &af_frame[AF_HOP], (AF_N - AF_HOP) * sizeof(int16_t));
+  AudioFeatures_DcBlock(hop, &af_frame[AF_N - AF_HOP]);
+
+  energy = AudioFeatures_Energy(af_frame, AF_N);
+  frame->index = af_index++;
+  frame->mean_square = (uint32_t)(energy >> AF_LOG2_N);
+  frame->log_energy = (energy == 0U) ? (int16_t)AUDIO_FEATURES_LOG_FLOOR
+                      : (int16_t)(AudioFeatures_Log2(energy) - (int32_t)(AF_LOG2_N * AUDIO_FEATURES_LOG_ONE));
+  frame->zero_crossings = (uint16_t)AudioFeatures_ZeroCrossings(af_frame, AF_N);
+
+  peak = AudioFeatures_Peak(af_frame, AF_N);
+  if (peak == 0U)
+  {
+    for (uint32_t b = 0U; b < AF_BANDS; b++)
+    {
+      frame->log_mel[b] = (int16_t)AUDIO_FEATURES_LOG_FLOOR;
+    }
+    return;
+  }
+
+  /* bring the peak to 0.5..1 of full scale, window and load bit-reversed */
+  shift = (int32_t)AF_CLZ(peak) - 17;
+  if (shift < 0)
+  {
+    shift = 0;
+  }
+  for (uint32_t n = 0U; n < AF_N; n++)
+  {
+    int32_t x = (int32_t)af_frame[n] * (1 << shift);
+
+    af_fft[af_reverse[n]] = (uint32_t)(uint16_t)(int16_t)((x * af_window[n]) >> 15);
+  }
+  AudioFeatures_Fft();
+
+  for (uint32_t k = 0U; k < AF_BINS; k++)
+  {
+    af_power[k] = AF_SMUAD(af_fft[k], af_fft[k]);
+  }
+
+  /* the FFT scaled every bin by 1/N and the input by 2^shift */
+  AudioFeatures_Mel(2 * ((int32_t)AF_LOG2_N - shift), frame->log_mel);
+}
+
+/**
+  * @brief  Sum of squares.
+  * @param  x: samples, n even
+  * @param  n: number of samples
+  * @retval Sum in LSB^2
+  */
+uint64_t AudioFeatures_Energy(const int16_t *x, uint32_t n)
+{
+  uint64_t acc = 0U;
+
+  for (uint32_t i = 0U; i < n; i += 2U)
+  {
+    uint32_t v = AF_Pair(&x[i]);
+
+    acc = AF_SMLALD(v, v, acc);
+  }
+  return acc;
+}
+
+/**
+  * @brief  Sign changes between consecutive samples, zero counting as
+  *         positive.
+  * @param  x: samples, n even
+  * @param  n: number of samples
+  * @retval Crossings among the n - 1 pairs
+  */
+uint32_t AudioFeatures_ZeroCrossings(const int16_t *x, uint32_t n)
+{
+  uint32_t count = ((uint16_t)(x[0] ^ x[1])) >> 15;
+
+  /* x[i-1]:x[i] against x[i]:x[i+1], two sign comparisons per word */
+  for (uint32_t i = 2U; i < n; i += 2U)
+  {
+    uint32_t d = AF_Pair(&x[i - 1U]) ^ AF_Pair(&x[i]);
+
+    count += ((d >> 15) & 1U) + (d >> 31);
+  }
+  return count;
+}
+
+/**
+  * @brief  Base-2 logarithm.
+  * @param  value: > 0
+  * @retval floor(log2(value) * 256), AUDIO_FEATURES_LOG_FLOOR for 0
+  */
+int16_t AudioFeatures_Log2(uint64_t value)
+{
+  uint32_t hi = (uint32_t)(value >> 32);
+  uint32_t exponent;
+  uint64_t m;
+  uint32_t frac = 0U;
+
+  if (value == 0U)
+  {
+    return (int16_t)AUDIO_FEATURES_LOG_FLOOR;
+  }
+  exponent = (hi != 0U) ? (63U - AF_CLZ(hi)) : (31U - AF_CLZ((uint32_t)value));
+
+  /* mantissa in [1, 2) as Q30; each squaring yields one fraction bit */
+  m = (exponent >= 30U) ? (value >> (exponent - 30U)) : (value << (30U - exponent));
+  for (uint32_t bit = 0x80U; bit != 0U; bit >>= 1)
+  {
+    m = (m * m) >> 30;
+    if (m >= (2ULL << 30))
+    {
+      frac |= bit;
+      m >>= 1;
+    }
+  }
+  return (int16_t)((exponent << 8) | frac);
+}
+
+/**
+  * @brief  Triangular weights of one mel band.
+  * @param  band: 0 .. AUDIO_FEATURES_MEL_BANDS - 1
+  * @param  first: first FFT bin of the band
+  * @param  count: number of bins
+  * @param  weights: count Q15 weights
+  * @retval None
+  */
+void AudioFeatures_MelWeights(uint32_t band, uint32_t *first, uint32_t *count, const int16_t **weights)
+{
+  *first = af_mel_first[band];
+  *count = af_mel_count[band];
+  *weights = &af_mel_w[af_mel_offset[band]];
+}
+
+/* y[n] = x[n] - x[n-1] + 0.995 y[n-1], with the state kept in Q8 */
+static void AudioFeatures_DcBlock(const int16_t *hop, int16_t *out)
+{
+  int32_t x1 = af_dc_x;
+  int32_t y = af_dc_y;
+
+  for (uint32_t n = 0U; n < AF_HOP; n++)
+  {
+    int32_t v;
+
+    y = (((int32_t)hop[n] - x1) * (1 << AF_DC_FRAC)) + (int32_t)(((int64_t)y * AF_DC_POLE) >> 15);
+    x1 = hop[n];
+    v = (y + (1 << (AF_DC_FRAC - 1U))) >> AF_DC_FRAC;
+    out[n] = (int16_t)((v > 32767) ? 32767 : ((v < -32768) ? -32768 : v));
+  }
+  af_dc_x = (int16_t)x1;
+  af_dc_y = y;
+}
+
+static uint32_t AudioFeatures_Peak(const int16_t *x, uint32_t n)
+{
+  int32_t hi = 0;
+  int32_t lo = 0;
+
+  for (uint32_t i = 0U; i < n; i++)
+  {
+    hi = (x[i] > hi) ? x[i] : hi;
+    lo = (x[i] < lo) ? x[i] : lo;
+  }
+  return (uint32_t)((-lo > hi) ? -lo : hi);
+}
+
+/* Radix-2 decimation in time on bit-reversed input, halving every stage:
+   the result is the DFT divided by AUDIO_FEATURES_FRAME_LEN */
+static void AudioFeatures_Fft(void)
+{
+  for (uint32_t half = 1U, step = AF_N / 2U; half < AF_N; half <<= 1, step >>= 1)
+  {
+    for (uint32_t start = 0U; start < AF_N; start += 2U * half)
+    {
+      uint32_t *a = &af_fft[start];
+      uint32_t *b = &af_fft[start + half];
+
+      for (uint32_t k = 0U; k < half; k++)
+      {
+        uint32_t w = af_twiddle[k * step];
+        int32_t re = (int32_t)AF_SMLSD(b[k], w, 0x4000U) >> 15;
+        int32_t im = (int32_t)AF_SMLADX(b[k], w, 0x4000U) >> 15;
+        uint32_t t = AF_PKHBT((uint32_t)re, (uint32_t)im, 16U);
+
+        b[k] = AF_SHSUB16(a[k], t);
+        a[k] = AF_SHADD16(a[k], t);
+      }
+    }
+  }
+}
+
+/* Filter bank over af_power; scale is the log2 of the factor taking the
+   power spectrum back to LSB^2 */
+static void AudioFeatures_Mel(int32_t scale, int16_t *log_mel)
+{
+  for (uint32_t b = 0U; b < AF_BANDS; b++)
+  {
+    const uint32_t *p = &af_power[af_mel_first[b]];
+    const int16_t *w = &af_mel_w[af_mel_offset[b]];
+    uint64_t acc = 0U;
+    int32_t v;
+
+    for (uint32_t k = 0U; k < af_mel_count[b]; k++)
+    {
+      acc += (uint64_t)p[k] * (uint32_t)w[k];
+    }
+    if (acc == 0U)
+    {
+      log_mel[b] = (int16_t)AUDIO_FEATURES_LOG_FLOOR;
+      continue;
+    }
+    v = (int32_t)AudioFeatures_Log2(acc) + ((scale - 15) * AUDIO_FEATURES_LOG_ONE);
+    log_mel[b] = (int16_t)((v < AUDIO_FEATURES_LOG_FLOOR) ? AUDIO_FEATURES_LOG_FLOOR : v);
+  }
+}
+
+static double AudioFeatures_HzToMel(double hz)
+{
+  return 2595.0 * log10(1.0 + (hz / 700.0));
+}
+
+static double AudioFeatures_MelToHz(double mel)
+{
+  return 700.0 * (pow(10.0, mel / 2595.0) - 1.0);
+}
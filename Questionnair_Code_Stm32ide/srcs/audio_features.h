@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file           : audio_features.h
+  * @brief          : Header for audio_features.c file.
+  *                   Fixed-point frame features of the microphone stream:
+  *                   energy, zero crossings and log-mel band energies.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __AUDIO_FEATURES_H
+#define __AUDIO_FEATURES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define AUDIO_FEATURES_RATE_HZ      16000U
+#define AUDIO_FEATURES_FRAME_LEN    512U      /* 32 ms, FFT size          */
+#define AUDIO_FEATURES_HOP_LEN      256U      /* 16 ms between frames     */
+#define AUDIO_FEATURES_BINS         ((AUDIO_FEATURES_FRAME_LEN / 2U) + 1U)
+
+/* Triangular filters evenly spaced on the mel scale */
+#define AUDIO_FEATURES_MEL_BANDS    24U
+#define AUDIO_FEATURES_MEL_LOW_HZ   125U
+#define AUDIO_FEATURES_MEL_HIGH_HZ  7500U
+
+/* Log values are log2 in Q8; an empty frame or band reads as the floor */
+#define AUDIO_FEATURES_LOG_ONE      256
+#define AUDIO_FEATURES_LOG_FLOOR    (-32 * AUDIO_FEATURES_LOG_ONE)
+
+/* Exported types ------------------------------------------------------------*/
+/* Features of one AUDIO_FEATURES_FRAME_LEN frame of the DC-free signal.
+   log_mel is the log2 of the filter bank output over |FFT|^2 of the
+   Hann-windowed frame, in LSB^2. */
+typedef struct
+{
+  uint32_t index;                                 /* frames since Init     */
+  uint32_t mean_square;                           /* LSB^2                 */
+  int16_t log_energy;                             /* log2(mean_square), Q8 */
+  uint16_t zero_crossings;                        /* in the frame          */
+  int16_t log_mel[AUDIO_FEATURES_MEL_BANDS];      /* Q8                    */
+} AudioFeatures_FrameTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void AudioFeatures_Init(void);
+void AudioFeatures_Reset(void);
+void AudioFeatures_Push(const int16_t *hop, AudioFeatures_FrameTypeDef *frame);
+
+/* Kernels, exported for the host bench */
+uint64_t AudioFeatures_Energy(const int16_t *x, uint32_t n);
+uint32_t AudioFeatures_ZeroCrossings(const int16_t *x, uint32_t n);
+int16_t AudioFeatures_Log2(uint64_t value);
+void AudioFeatures_MelWeights(uint32_t band, uint32_t *first, uint32_t *count, const int16_t **weights);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_FEATURES_H */
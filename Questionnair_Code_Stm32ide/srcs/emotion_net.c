@@ -0,0 +1,292 @@
+/**
+  ******************************************************************************
+  * @file           : emotion_net.c
+  * @brief          : Int8 inference of the facial emotion CNN.
+  *
+  *                   The graph is the one of emotion_2.py, fixed here:
+  *                     48x48x1  conv3x3 32 relu   -> 46x46x32
+  *                              conv3x3 64 relu   -> 44x44x64
+  *                              maxpool 2x2       -> 22x22x64
+  *                              conv3x3 128 relu  -> 20x20x128
+  *                              maxpool 2x2       -> 10x10x128
+  *                              conv3x3 128 relu  -> 8x8x128
+  *                              maxpool 2x2       -> 4x4x128
+  *                              dense 1024 relu   (flattened HWC, 2048)
+  *                              dense 7           -> softmax
+  *                   Dropout does nothing at inference time and Flatten is
+  *                   a no-op on the HWC layout. Only the weights and the
+  *                   quantization come from the blob, which
+  *                   EmotionNet_Init() checks against this graph before
+  *                   using it in place.
+  *
+  *                   Activations live in one static arena laid out by
+  *                   host/nn_plan (emotion_net_plan.h). Most tensors keep
+  *                   only the 3 or 2 rows the next conv or pool reads, so
+  *                   the network is run by pulling rows: asking for a row
+  *                   of a tensor first produces the input rows it needs,
+  *                   down to the image. The convolutions and pools then
+  *                   run interleaved row by row and no feature map is
+  *                   ever whole; the dense layers wait for their input.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "emotion_net.h"
+#include "frame.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define EN_CRC_FROM             (offsetof(EmotionNet_BlobHeaderTypeDef, crc) + sizeof(uint16_t))
+
+/* Private variables ---------------------------------------------------------*/
+static const EmotionNet_TensorTypeDef en_tensors[EMOTION_NET_TENSORS] = EMOTION_NET_PLAN_TENSORS;
+static const EmotionNet_OpTypeDef en_ops[EMOTION_NET_OPS] = EMOTION_NET_PLAN_OPS;
+
+static const char *const en_names[EMOTION_NET_CLASSES] =
+{
+  "Angry", "Disgusted", "Fearful", "Happy", "Neutral", "Sad", "Surprised",
+};
+
+static NnKernels_LayerTypeDef en_layers[EMOTION_NET_LAYERS];
+static float en_logit_scale;
+static int8_t en_logit_zp;
+static uint8_t en_ready;
+
+static uint32_t en_arena_words[(EMOTION_NET_ARENA_BYTES + 3U) / 4U];
+static uint8_t *const en_arena = (uint8_t *)en_arena_words;
+static uint16_t en_done[EMOTION_NET_TENSORS];  /* rows produced this run   */
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef EmotionNet_Check(const EmotionNet_BlobLayerTypeDef *rec, const EmotionNet_OpTypeDef *op,
+                                          uint32_t size);
+static void EmotionNet_Row(uint32_t tensor, uint32_t row);
+static int8_t *EmotionNet_Slot(uint32_t tensor, uint32_t row);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Check a weight blob against the graph and bind the layers to it.
+  * @param  blob: start of the blob, 4-byte aligned; it must stay readable
+  *         while the network is used
+  * @param  size: bytes available at blob
+  * @retval HAL status, HAL_ERROR if the blob is missing or does not match
+  */
+HAL_StatusTypeDef EmotionNet_Init(const uint8_t *blob, uint32_t size)
+{
+  EmotionNet_BlobHeaderTypeDef hdr;
+  EmotionNet_BlobLayerTypeDef rec;
+
+  en_ready = 0U;
+  if ((blob == NULL) || (((uintptr_t)blob & 3U) != 0U) || (size < sizeof(hdr)))
+  {
+    return HAL_ERROR;
+  }
+  memcpy(&hdr, blob, sizeof(hdr));
+  if ((hdr.magic != EMOTION_NET_MAGIC) || (hdr.size > size)
+      || (hdr.size < (sizeof(hdr) + (EMOTION_NET_LAYERS * sizeof(rec))))
+      || (hdr.layers != EMOTION_NET_LAYERS) || !(hdr.logit_scale > 0.0f))
+  {
+    return HAL_ERROR;
+  }
+  if (Frame_Crc16(&blob[EN_CRC_FROM], hdr.size - EN_CRC_FROM) != hdr.crc)
+  {
+    return HAL_ERROR;
+  }
+
+  for (uint32_t i = 0U; i < EMOTION_NET_OPS; i++)
+  {
+    const EmotionNet_OpTypeDef *op = &en_ops[i];
+    NnKernels_LayerTypeDef *layer = &en_layers[op->layer];
+
+    if ((op->kind != EMOTION_NET_OP_CONV) && (op->kind != EMOTION_NET_OP_DENSE))
+    {
+      continue;
+    }
+    memcpy(&rec, &blob[sizeof(hdr) + (op->layer * sizeof(rec))], sizeof(rec));
+    if (EmotionNet_Check(&rec, op, hdr.size) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+    layer->in_ch = rec.in_ch;
+    layer->out_ch = rec.out_ch;
+    layer->weights = (const int8_t *)&blob[rec.weights];
+    layer->bias = (const int32_t *)(const void *)&blob[rec.bias];
+    layer->multiplier = (const int32_t *)(const void *)&blob[rec.multiplier];
+    layer->shift = (const int8_t *)&blob[rec.shift];
+    layer->output_zp = rec.output_zp;
+    layer->act_min = rec.act_min;
+    layer->act_max = rec.act_max;
+    for (uint32_t o = 0U; o < rec.out_ch; o++)
+    {
+      if ((layer->shift[o] < NN_KERNELS_SHIFT_MIN) || (layer->shift[o] > NN_KERNELS_SHIFT_MAX))
+      {
+        return HAL_ERROR;
+      }
+    }
+  }
+
+  en_logit_scale = hdr.logit_scale;
+  en_logit_zp = hdr.logit_zp;
+  en_ready = 1U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Score one face.
+  * @param  image: EMOTION_NET_INPUT_BYTES grayscale pixels
+  * @param  result: class, logits and probabilities
+  * @retval HAL status, HAL_ERROR if no blob was loaded
+  */
+HAL_StatusTypeDef EmotionNet_Run(const uint8_t *image, EmotionNet_ResultTypeDef *result)
+{
+  const int8_t *logits;
+  float peak;
+  float sum = 0.0f;
+
+  if (en_ready == 0U)
+  {
+    return HAL_ERROR;
+  }
+
+  memset(en_done, 0, sizeof(en_done));
+  {
+    int8_t *in = EmotionNet_Slot(0U, 0U);
+
+    for (uint32_t i = 0U; i < EMOTION_NET_INPUT_BYTES; i++)
+    {
+      in[i] = (int8_t)((int32_t)image[i] + EMOTION_NET_INPUT_ZP);
+    }
+    en_done[0] = en_tensors[0].height;
+  }
+
+  EmotionNet_Row(EMOTION_NET_OUTPUT, 0U);
+  logits = EmotionNet_Slot(EMOTION_NET_OUTPUT, 0U);
+  result->label = 0U;
+  for (uint32_t c = 0U; c < EMOTION_NET_CLASSES; c++)
+  {
+    result->logits[c] = logits[c];
+    if (logits[c] > logits[result->label])
+    {
+      result->label = (uint8_t)c;
+    }
+  }
+  peak = en_logit_scale * (float)(logits[result->label] - en_logit_zp);
+  for (uint32_t c = 0U; c < EMOTION_NET_CLASSES; c++)
+  {
+    result->probability[c] = expf((en_logit_scale * (float)(logits[c] - en_logit_zp)) - peak);
+    sum += result->probability[c];
+  }
+  for (uint32_t c = 0U; c < EMOTION_NET_CLASSES; c++)
+  {
+    result->probability[c] /= sum;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Display name of a class, as in emotion_2.py.
+  * @param  label: EMOTION_NET_ANGRY .. EMOTION_NET_SURPRISED
+  * @retval Name, "?" if out of range
+  */
+const char *EmotionNet_LabelName(uint32_t label)
+{
+  return (label < EMOTION_NET_CLASSES) ? en_names[label] : "?";
+}
+
+/**
+  * @brief  Layer with weights number `index`, as bound by EmotionNet_Init().
+  * @param  index: 0 .. EMOTION_NET_LAYERS - 1
+  * @retval Layer, NULL if out of range or no blob was loaded
+  */
+const NnKernels_LayerTypeDef *EmotionNet_Layer(uint32_t index)
+{
+  return ((en_ready != 0U) && (index < EMOTION_NET_LAYERS)) ? &en_layers[index] : NULL;
+}
+
+/* Produce the rows of a tensor up to `row`, and first the input rows they
+   are made from. A ring tensor's older rows are overwritten on the way,
+   which the plan guarantees its reader is done with. */
+static void EmotionNet_Row(uint32_t tensor, uint32_t row)
+{
+  const EmotionNet_TensorTypeDef *dst = &en_tensors[tensor];
+
+  while (en_done[tensor] <= row)
+  {
+    const uint32_t y = en_done[tensor];
+    const EmotionNet_OpTypeDef *op = &en_ops[dst->producer];
+    const EmotionNet_TensorTypeDef *src = &en_tensors[op->input];
+    int16_t *scratch = (int16_t *)(void *)&en_arena[EMOTION_NET_SCRATCH_OFFSET];
+
+    switch (op->kind)
+    {
+      case EMOTION_NET_OP_CONV:
+      {
+        const int8_t *const rows[3] =
+        {
+          EmotionNet_Slot(op->input, y), EmotionNet_Slot(op->input, y + 1U), EmotionNet_Slot(op->input, y + 2U),
+        };
+
+        EmotionNet_Row(op->input, y + 2U);
+        NnKernels_Conv3x3Row(&en_layers[op->layer], rows, src->width, EmotionNet_Slot(tensor, y), scratch);
+        break;
+      }
+      case EMOTION_NET_OP_POOL:
+        EmotionNet_Row(op->input, (2U * y) + 1U);
+        NnKernels_MaxPool2x2Row(EmotionNet_Slot(op->input, 2U * y), EmotionNet_Slot(op->input, (2U * y) + 1U),
+                                src->width, src->channels, EmotionNet_Slot(tensor, y));
+        break;
+      case EMOTION_NET_OP_DENSE:
+        EmotionNet_Row(op->input, src->height - 1U);
+        NnKernels_Dense(&en_layers[op->layer], EmotionNet_Slot(op->input, 0U), EmotionNet_Slot(tensor, 0U),
+                        scratch);
+        break;
+      default:
+        /* in place: Dropout row by row, Flatten once its input is whole */
+        EmotionNet_Row(op->input, (src->height == dst->height) ? y : (src->height - 1U));
+        break;
+    }
+    en_done[tensor]++;
+  }
+}
+
+/* Where row `row` of a tensor is kept */
+static int8_t *EmotionNet_Slot(uint32_t tensor, uint32_t row)
+{
+  const EmotionNet_TensorTypeDef *t = &en_tensors[tensor];
+
+  return (int8_t *)&en_arena[t->offset + ((row % t->rows) * t->width * t->channels)];
+}
+
+/* Shape, bounds and alignment of the record of a layer with weights */
+static HAL_StatusTypeDef EmotionNet_Check(const EmotionNet_BlobLayerTypeDef *rec, const EmotionNet_OpTypeDef *op,
+                                          uint32_t size)
+{
+  const EmotionNet_TensorTypeDef *in = &en_tensors[op->input];
+  const uint32_t taps = (op->kind == EMOTION_NET_OP_CONV) ? 9U : 1U;
+  const uint32_t in_ch = (op->kind == EMOTION_NET_OP_CONV) ? in->channels
+                         : ((uint32_t)in->height * in->width * in->channels);
+  const uint32_t out = rec->out_ch;
+  const uint32_t spans[4][2] =
+  {
+    { rec->weights, taps * rec->in_ch * out },
+    { rec->bias, 4U * out },
+    { rec->multiplier, 4U * out },
+    { rec->shift, out },
+  };
+
+  if ((rec->in_ch != in_ch) || (rec->out_ch != en_tensors[op->output].channels)
+      || (rec->act_min > rec->act_max))
+  {
+    return HAL_ERROR;
+  }
+  for (uint32_t i = 0U; i < 4U; i++)
+  {
+    if (((spans[i][0] & 3U) != 0U) || (spans[i][0] > size) || (spans[i][1] > (size - spans[i][0])))
+    {
+      return HAL_ERROR;
+    }
+  }
+  return HAL_OK;
+}
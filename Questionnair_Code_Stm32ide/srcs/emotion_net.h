@@ -0,0 +1,131 @@
+/**
+  ******************************************************************************
+  * @file           : emotion_net.h
+  * @brief          : Header for emotion_net.c file.
+  *                   Int8 inference of the facial emotion CNN trained by
+  *                   Emotion_Detection_model/emotion_2.py, from a weight
+  *                   blob written by convert_model.py.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __EMOTION_NET_H
+#define __EMOTION_NET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "nn_kernels.h"
+#include "emotion_net_plan.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* 48x48 grayscale face, one byte per pixel, rows top to bottom */
+#define EMOTION_NET_INPUT_SIZE      48U
+#define EMOTION_NET_INPUT_BYTES     (EMOTION_NET_INPUT_SIZE * EMOTION_NET_INPUT_SIZE)
+
+/* The network sees pixel / 255 (the training rescale), which is the int8
+   value pixel - 128 with this zero point and a scale of 1/255 */
+#define EMOTION_NET_INPUT_ZP        (-128)
+
+/* Classes, in the alphabetical order of the training folders */
+#define EMOTION_NET_ANGRY           0U
+#define EMOTION_NET_DISGUSTED       1U
+#define EMOTION_NET_FEARFUL         2U
+#define EMOTION_NET_HAPPY           3U
+#define EMOTION_NET_NEUTRAL         4U
+#define EMOTION_NET_SAD             5U
+#define EMOTION_NET_SURPRISED       6U
+#define EMOTION_NET_CLASSES         7U
+
+/* Layers with weights: four 3x3 convolutions and two dense layers */
+#define EMOTION_NET_LAYERS          6U
+
+/* Weight blob --------------------------------------------------------------*/
+#define EMOTION_NET_MAGIC           0x314E4D45U     /* "EMN1" */
+
+/* The blob is about 2.3 MB, more than the internal flash: on the board it
+   is programmed into the top of the QSPI flash, above the record log, and
+   read in memory-mapped mode */
+#define EMOTION_NET_QSPI_BASE       0x500000U
+#define EMOTION_NET_QSPI_SIZE       0x300000U
+
+/* Ops of the layer graph. Dropout and Flatten are IDENTITY: they run in
+   place on their input's buffer */
+#define EMOTION_NET_OP_CONV         0U
+#define EMOTION_NET_OP_POOL         1U
+#define EMOTION_NET_OP_DENSE        2U
+#define EMOTION_NET_OP_IDENTITY     3U
+
+/* Exported types ------------------------------------------------------------*/
+/* Blob layout, little endian. The header is followed by EMOTION_NET_LAYERS
+   layer records; offsets are from the start of the blob and 4-byte
+   aligned. crc is Frame_Crc16 of everything after the crc field. */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t size;            /* bytes, header included                      */
+  uint16_t crc;
+  uint16_t layers;
+  float logit_scale;        /* of the last layer, for the softmax          */
+  int8_t logit_zp;
+  uint8_t reserved[3];
+} EmotionNet_BlobHeaderTypeDef;
+
+typedef struct
+{
+  uint16_t in_ch;
+  uint16_t out_ch;
+  int8_t output_zp;
+  int8_t act_min;
+  int8_t act_max;
+  uint8_t reserved;
+  uint32_t weights;         /* int8  [out][kh][kw][in] or [out][in]        */
+  uint32_t bias;            /* int32 [out]                                 */
+  uint32_t multiplier;      /* int32 [out]                                 */
+  uint32_t shift;           /* int8  [out]                                 */
+} EmotionNet_BlobLayerTypeDef;
+
+/* Activation tensor as placed by host/nn_plan. A tensor keeps rows of its
+   height rows in the arena: all of them, or a ring that row r shares with
+   row r + rows, refilled as its reader slides down */
+typedef struct
+{
+  uint16_t height;
+  uint16_t width;
+  uint16_t channels;
+  uint16_t rows;
+  uint32_t offset;          /* in the arena                                */
+  int32_t producer;         /* op, -1 for the input                        */
+} EmotionNet_TensorTypeDef;
+
+typedef struct
+{
+  uint8_t kind;             /* EMOTION_NET_OP_*                            */
+  uint8_t layer;            /* weights, CONV and DENSE                     */
+  uint8_t input;            /* tensors                                     */
+  uint8_t output;
+} EmotionNet_OpTypeDef;
+
+typedef struct
+{
+  uint8_t label;                                  /* most likely class     */
+  int8_t logits[EMOTION_NET_CLASSES];             /* last layer, int8      */
+  float probability[EMOTION_NET_CLASSES];         /* softmax               */
+} EmotionNet_ResultTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef EmotionNet_Init(const uint8_t *blob, uint32_t size);
+HAL_StatusTypeDef EmotionNet_Run(const uint8_t *image, EmotionNet_ResultTypeDef *result);
+const char *EmotionNet_LabelName(uint32_t label);
+
+/* Layers as loaded from the blob, exported for the host bench */
+const NnKernels_LayerTypeDef *EmotionNet_Layer(uint32_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EMOTION_NET_H */
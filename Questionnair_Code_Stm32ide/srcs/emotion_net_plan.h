@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file           : emotion_net_plan.h
+  * @brief          : Activation plan of the emotion CNN, generated by
+  *                   host/nn_plan (liveness + in-place + row tiling).
+  *                   Run make plan in srcs/host after changing the graph;
+  *                   do not edit.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __EMOTION_NET_PLAN_H
+#define __EMOTION_NET_PLAN_H
+
+/* Exported constants --------------------------------------------------------*/
+/* 34240 bytes, the lower bound is 34240 */
+#define EMOTION_NET_ARENA_BYTES     34240U
+#define EMOTION_NET_SCRATCH_OFFSET  10752U
+#define EMOTION_NET_TENSORS         14U
+#define EMOTION_NET_OPS             13U
+#define EMOTION_NET_OUTPUT          13U
+
+/* height, width, channels, rows kept, arena offset, producing op */
+#define EMOTION_NET_PLAN_TENSORS \
+{ \
+  { 48U, 48U, 1U, 48U, 27840U, -1 },           /* input            */ \
+  { 46U, 46U, 32U, 3U, 15360U, 0 },            /* conv2d           */ \
+  { 44U, 44U, 64U, 2U, 0U, 1 },                /* conv2d_1         */ \
+  { 22U, 22U, 64U, 3U, 19776U, 2 },            /* max_pooling2d    */ \
+  { 22U, 22U, 64U, 3U, 19776U, 3 },            /* dropout          */ \
+  { 20U, 20U, 128U, 2U, 5632U, 4 },            /* conv2d_2         */ \
+  { 10U, 10U, 128U, 3U, 24000U, 5 },           /* max_pooling2d_1  */ \
+  { 8U, 8U, 128U, 2U, 30144U, 6 },             /* conv2d_3         */ \
+  { 4U, 4U, 128U, 4U, 32192U, 7 },             /* max_pooling2d_2  */ \
+  { 4U, 4U, 128U, 4U, 32192U, 8 },             /* dropout_1        */ \
+  { 1U, 1U, 2048U, 1U, 32192U, 9 },            /* flatten          */ \
+  { 1U, 1U, 1024U, 1U, 0U, 10 },               /* dense            */ \
+  { 1U, 1U, 1024U, 1U, 0U, 11 },               /* dropout_2        */ \
+  { 1U, 1U, 7U, 1U, 1024U, 12 },               /* dense_1          */ \
+}
+
+/* kind, layer with weights, input tensor, output tensor; bytes live */
+#define EMOTION_NET_PLAN_OPS \
+{ \
+  { EMOTION_NET_OP_CONV, 0U, 0U, 1U },         /* conv2d            34240 */ \
+  { EMOTION_NET_OP_CONV, 1U, 1U, 2U },         /* conv2d_1          34240 */ \
+  { EMOTION_NET_OP_POOL, 0U, 2U, 3U },         /* max_pooling2d     34240 */ \
+  { EMOTION_NET_OP_IDENTITY, 0U, 3U, 4U },     /* dropout           34240 */ \
+  { EMOTION_NET_OP_CONV, 2U, 4U, 5U },         /* conv2d_2          34240 */ \
+  { EMOTION_NET_OP_POOL, 0U, 5U, 6U },         /* max_pooling2d_1   34240 */ \
+  { EMOTION_NET_OP_CONV, 3U, 6U, 7U },         /* conv2d_3          34240 */ \
+  { EMOTION_NET_OP_POOL, 0U, 7U, 8U },         /* max_pooling2d_2   34240 */ \
+  { EMOTION_NET_OP_IDENTITY, 0U, 8U, 9U },     /* dropout_1         34240 */ \
+  { EMOTION_NET_OP_IDENTITY, 0U, 9U, 10U },    /* flatten           34240 */ \
+  { EMOTION_NET_OP_DENSE, 4U, 10U, 11U },      /* dense              7680 */ \
+  { EMOTION_NET_OP_IDENTITY, 0U, 11U, 12U },   /* dropout_2          7680 */ \
+  { EMOTION_NET_OP_DENSE, 5U, 12U, 13U },      /* dense_1            5640 */ \
+}
+
+#endif /* __EMOTION_NET_PLAN_H */
@@ -0,0 +1,647 @@
+/**
+  ******************************************************************************
+  * @file           : flash_log.c
+  * @brief          : Append-only record log on the QSPI NOR flash.
+  *
+  *                   The region is a ring of 4 KB sectors filled strictly in
+  *                   order, so every sector is erased once per pass over the
+  *                   flash: wear leveling comes from the layout itself.
+  *                   Each sector starts with a header carrying its erase
+  *                   count and a sequence number; records follow, each
+  *                   with its own CRC, and never straddle two sectors.
+  *
+  *                   Appends are staged in a one-page RAM buffer and
+  *                   programmed a page at a time; FlashLog_Sync() programs
+  *                   the partial page, and a record is durable once it
+  *                   returns. Reads walk the memory-mapped flash directly.
+  *
+  *                   Two sectors are kept erased ahead of the head. When
+  *                   the ring would close in on the oldest sector, that
+  *                   sector is compacted: its FLASH_LOG_KEEP records (the
+  *                   session results) are copied to the head, everything
+  *                   else (raw traces) is dropped, then it is erased.
+  *                   A KEEP record is never dropped: once a whole turn of
+  *                   the ring frees nothing, the log is full and appends
+  *                   fail, while the records stay readable.
+  *
+  *                   Power-fail safety rests on three rules: a torn record
+  *                   fails its CRC and closes its sector; a sector only
+  *                   counts once its header is complete, and its erase
+  *                   count only once the CRC of the erase part matches,
+  *                   the highest count of the region standing in for a
+  *                   torn one; a compacted
+  *                   sector is erased only after all of its copies are
+  *                   programmed, and each copy names the sector it came
+  *                   from, so FlashLog_Init() resumes an interrupted
+  *                   compaction exactly where it stopped.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "flash_log.h"
+#include "frame.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define FLASH_LOG_ERASE_MAGIC    0x5245U       /* "ER" */
+#define FLASH_LOG_ERASE_LEN      8U            /* erase part of the header */
+#define FLASH_LOG_MAGIC          0x474F4C51U   /* "QLOG" */
+#define FLASH_LOG_NONE           0xFFFFFFFFU
+#define FLASH_LOG_HEADER_LEN     ((uint32_t)sizeof(FlashLog_SectorTypeDef))
+#define FLASH_LOG_RECORD_LEN     ((uint32_t)sizeof(FlashLog_RecordTypeDef))
+#define FLASH_LOG_ALIGN(n)       (((uint32_t)(n) + 3U) & ~3U)
+
+/* Erased sectors kept ahead of the head: one for appends, one for the
+   copies of a compaction resumed after a power failure */
+#define FLASH_LOG_SPARE          2U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  FLASH_LOG_WALK_OK = 0,
+  FLASH_LOG_WALK_END,       /* erased: no more records in the sector */
+  FLASH_LOG_WALK_TORN       /* damaged record: the sector is closed  */
+} FlashLog_WalkTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t fl_base;
+static uint32_t fl_sectors;
+static uint32_t fl_head = FLASH_LOG_NONE;
+static uint32_t fl_head_seq;
+static uint32_t fl_oldest;
+static uint32_t fl_used;
+static uint32_t fl_off;                     /* append offset in the head   */
+static uint32_t fl_next_record;
+static uint32_t fl_max_erase;
+static uint8_t fl_ready;
+static uint8_t fl_reclaiming;
+static uint8_t fl_full;                     /* only KEEP records left      */
+
+/* Page write buffer */
+static uint8_t fl_page[QSPI_FLASH_PAGE_SIZE];
+static uint32_t fl_page_addr;
+static uint32_t fl_page_fill;               /* bytes staged                */
+static uint32_t fl_page_prog;               /* bytes already programmed    */
+
+/* A record being relocated; the flash is not mapped while programming */
+static uint8_t fl_copy[FLASH_LOG_RECORD_MAX];
+
+static FlashLog_StatsTypeDef fl_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef FlashLog_Put(const FlashLog_RecordTypeDef *rec, const void *data);
+static HAL_StatusTypeDef FlashLog_Open(void);
+static HAL_StatusTypeDef FlashLog_Compact(void);
+static HAL_StatusTypeDef FlashLog_Reclaim(void);
+static HAL_StatusTypeDef FlashLog_Erase(uint32_t sector, uint32_t erase_count);
+static HAL_StatusTypeDef FlashLog_Write(const void *data, uint32_t len);
+static void FlashLog_Seek(uint32_t addr);
+static FlashLog_WalkTypeDef FlashLog_Walk(const uint8_t *map, uint32_t sector, uint32_t *off,
+                                          const FlashLog_RecordTypeDef **rec);
+static const FlashLog_SectorTypeDef *FlashLog_Header(const uint8_t *map, uint32_t sector);
+static uint8_t FlashLog_Valid(const FlashLog_SectorTypeDef *header);
+static uint8_t FlashLog_Counted(const FlashLog_SectorTypeDef *header);
+static uint16_t FlashLog_RecordCrc(const FlashLog_RecordTypeDef *rec, const uint8_t *payload);
+static uint8_t FlashLog_Blank(const uint8_t *p, uint32_t len);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Mount the log, recovering from any interrupted write.
+  * @note   Call after MX_QUADSPI_Init(). An erased or foreign region is
+  *         taken as an empty log; sectors are erased only when reused. A
+  *         full log mounts for replay, but takes no more appends.
+  * @param  hqspi: handle initialised by MX_QUADSPI_Init
+  * @param  base: first byte of the region, sector aligned
+  * @param  size: region size, a multiple of QSPI_FLASH_SECTOR_SIZE
+  * @retval HAL status
+  */
+HAL_StatusTypeDef FlashLog_Init(QSPI_HandleTypeDef *hqspi, uint32_t base, uint32_t size)
+{
+  const uint8_t *map;
+  const FlashLog_RecordTypeDef *rec;
+  FlashLog_WalkTypeDef walk;
+  uint32_t off;
+
+  fl_ready = 0U;
+  fl_reclaiming = 0U;
+  fl_full = 0U;
+  memset(&fl_stats, 0, sizeof(fl_stats));
+  if (((base % QSPI_FLASH_SECTOR_SIZE) != 0U) || ((size % QSPI_FLASH_SECTOR_SIZE) != 0U)
+      || ((size / QSPI_FLASH_SECTOR_SIZE) < FLASH_LOG_MIN_SECTORS) || (size > (QSPI_FLASH_SIZE - base))
+      || (QspiFlash_Init(hqspi) != HAL_OK) || ((map = QspiFlash_Map()) == NULL))
+  {
+    return HAL_ERROR;
+  }
+  fl_base = base;
+  fl_sectors = size / QSPI_FLASH_SECTOR_SIZE;
+  FlashLog_Seek(base);
+
+  /* The head is the valid sector with the highest sequence number */
+  fl_head = FLASH_LOG_NONE;
+  fl_max_erase = 0U;
+  for (uint32_t n = 0U; n < fl_sectors; n++)
+  {
+    const FlashLog_SectorTypeDef *h = FlashLog_Header(map, n);
+
+    if ((FlashLog_Counted(h) != 0U) && (h->erase_count > fl_max_erase))
+    {
+      fl_max_erase = h->erase_count;
+    }
+    if ((FlashLog_Valid(h) != 0U)
+        && ((fl_head == FLASH_LOG_NONE) || ((int32_t)(h->seq - fl_head_seq) > 0)))
+    {
+      fl_head = n;
+      fl_head_seq = h->seq;
+    }
+  }
+
+  fl_used = 0U;
+  fl_oldest = 0U;
+  fl_off = QSPI_FLASH_SECTOR_SIZE;
+  fl_next_record = 0U;
+  if (fl_head != FLASH_LOG_NONE)
+  {
+    /* Live sectors run backwards from the head with consecutive numbers */
+    fl_oldest = fl_head;
+    fl_used = 1U;
+    while (fl_used < fl_sectors)
+    {
+      uint32_t prev = (fl_oldest + fl_sectors - 1U) % fl_sectors;
+      const FlashLog_SectorTypeDef *h = FlashLog_Header(map, prev);
+
+      if ((FlashLog_Valid(h) == 0U) || (h->seq != (FlashLog_Header(map, fl_oldest)->seq - 1U)))
+      {
+        break;
+      }
+      fl_oldest = prev;
+      fl_used++;
+    }
+
+    /* Find the append point; a torn record or stray bits close the head */
+    off = FLASH_LOG_HEADER_LEN;
+    fl_next_record = FlashLog_Header(map, fl_head)->first_record;
+    while ((walk = FlashLog_Walk(map, fl_head, &off, &rec)) == FLASH_LOG_WALK_OK)
+    {
+      if (((rec->flags & FLASH_LOG_RELOCATED) == 0U) && ((int32_t)(rec->seq - fl_next_record) >= 0))
+      {
+        fl_next_record = rec->seq + 1U;
+      }
+    }
+    if ((walk == FLASH_LOG_WALK_TORN)
+        || (FlashLog_Blank(&map[fl_base + (fl_head * QSPI_FLASH_SECTOR_SIZE) + off],
+                           QSPI_FLASH_SECTOR_SIZE - off) == 0U))
+    {
+      fl_stats.torn++;
+      off = QSPI_FLASH_SECTOR_SIZE;
+    }
+    fl_off = off;
+    FlashLog_Seek(fl_base + (fl_head * QSPI_FLASH_SECTOR_SIZE) + off);
+  }
+  fl_ready = 1U;
+
+  /* Spares used up: a compaction was interrupted */
+  if ((FlashLog_Compact() != HAL_OK) && (fl_full == 0U))
+  {
+    fl_ready = 0U;
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Append one record. It is staged in RAM until its page fills or
+  *         FlashLog_Sync() is called.
+  * @param  type: application record type
+  * @param  data: payload
+  * @param  len: payload bytes, up to FLASH_LOG_RECORD_MAX
+  * @param  flags: FLASH_LOG_KEEP to survive compaction, 0 otherwise
+  * @retval HAL status, HAL_ERROR once the log is full of KEEP records
+  */
+HAL_StatusTypeDef FlashLog_Append(uint8_t type, const void *data, uint16_t len, uint8_t flags)
+{
+  FlashLog_RecordTypeDef rec;
+
+  if ((fl_ready == 0U) || (fl_full != 0U) || (len > FLASH_LOG_RECORD_MAX))
+  {
+    return HAL_ERROR;
+  }
+  rec.len = len;
+  rec.type = type;
+  rec.flags = flags & FLASH_LOG_KEEP;
+  rec.seq = fl_next_record;
+  rec.origin = FLASH_LOG_NONE;
+  if (FlashLog_Put(&rec, data) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  fl_next_record++;
+  fl_stats.appended++;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Program the staged partial page: every record appended so far
+  *         survives a power failure once this returns.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef FlashLog_Sync(void)
+{
+  if (fl_page_fill > fl_page_prog)
+  {
+    if (QspiFlash_Program(fl_page_addr + fl_page_prog, &fl_page[fl_page_prog], fl_page_fill - fl_page_prog) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+    fl_page_prog = fl_page_fill;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Visit every record, oldest sector first. Relocated records come
+  *         after newer ones; order by seq if it matters.
+  * @param  visit: called once per record
+  * @param  ctx: passed to visit
+  * @retval Number of records visited
+  */
+uint32_t FlashLog_Replay(FlashLog_VisitTypeDef visit, void *ctx)
+{
+  const uint8_t *map;
+  const FlashLog_RecordTypeDef *rec;
+  uint32_t count = 0U;
+
+  if ((fl_ready == 0U) || (FlashLog_Sync() != HAL_OK) || ((map = QspiFlash_Map()) == NULL))
+  {
+    return 0U;
+  }
+  for (uint32_t n = 0U; n < fl_used; n++)
+  {
+    uint32_t sector = (fl_oldest + n) % fl_sectors;
+    uint32_t off = FLASH_LOG_HEADER_LEN;
+
+    while (FlashLog_Walk(map, sector, &off, &rec) == FLASH_LOG_WALK_OK)
+    {
+      visit(rec, (const uint8_t *)&rec[1], ctx);
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+  * @brief  Snapshot of the log state, with the wear spread of the region.
+  * @param  stats: destination
+  * @retval None
+  */
+void FlashLog_GetStats(FlashLog_StatsTypeDef *stats)
+{
+  const uint8_t *map = (fl_ready != 0U) ? QspiFlash_Map() : NULL;
+
+  /* A sector with no erase count takes the highest, as FlashLog_Open() gives it */
+  *stats = fl_stats;
+  stats->full = fl_full;
+  stats->sectors = fl_sectors;
+  stats->used_sectors = fl_used;
+  stats->next_record = fl_next_record;
+  stats->min_erase_count = 0xFFFFFFFFU;
+  stats->max_erase_count = 0U;
+  for (uint32_t n = 0U; (map != NULL) && (n < fl_sectors); n++)
+  {
+    const FlashLog_SectorTypeDef *h = FlashLog_Header(map, n);
+    uint32_t count = (FlashLog_Counted(h) != 0U) ? h->erase_count : fl_max_erase;
+
+    stats->min_erase_count = (count < stats->min_erase_count) ? count : stats->min_erase_count;
+    stats->max_erase_count = (count > stats->max_erase_count) ? count : stats->max_erase_count;
+  }
+  if (stats->min_erase_count > stats->max_erase_count)
+  {
+    stats->min_erase_count = 0U;
+  }
+}
+
+/* Stage a record at the head, opening the next sector if it does not fit */
+static HAL_StatusTypeDef FlashLog_Put(const FlashLog_RecordTypeDef *rec, const void *data)
+{
+  static const uint8_t pad[3] = { QSPI_FLASH_ERASED, QSPI_FLASH_ERASED, QSPI_FLASH_ERASED };
+  FlashLog_RecordTypeDef hdr = *rec;
+  uint32_t size = FLASH_LOG_RECORD_LEN + FLASH_LOG_ALIGN(rec->len);
+
+  if ((fl_head == FLASH_LOG_NONE) || ((fl_off + size) > QSPI_FLASH_SECTOR_SIZE))
+  {
+    if (FlashLog_Open() != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+  }
+  hdr.reserved = 0xFFFFU;
+  hdr.crc = FlashLog_RecordCrc(&hdr, data);
+  if ((FlashLog_Write(&hdr, FLASH_LOG_RECORD_LEN) != HAL_OK) || (FlashLog_Write(data, hdr.len) != HAL_OK)
+      || (FlashLog_Write(pad, FLASH_LOG_ALIGN(hdr.len) - hdr.len) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  fl_off += size;
+  return HAL_OK;
+}
+
+/* Make the next sector of the ring the head. Unless this is a spill of
+   the copies, the ring is compacted first, so the new head starts empty. */
+static HAL_StatusTypeDef FlashLog_Open(void)
+{
+  uint32_t next;
+  uint32_t addr;
+  const FlashLog_SectorTypeDef *h;
+  const uint8_t *map;
+  FlashLog_SectorTypeDef header;
+  uint32_t from = 0U;
+
+  if ((fl_reclaiming == 0U) && (FlashLog_Compact() != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+
+  /* Never wrap onto live data; compaction keeps spares for this */
+  if ((fl_used >= fl_sectors) || (FlashLog_Sync() != HAL_OK) || ((map = QspiFlash_Map()) == NULL))
+  {
+    return HAL_ERROR;
+  }
+  next = (fl_head == FLASH_LOG_NONE) ? 0U : ((fl_head + 1U) % fl_sectors);
+  addr = fl_base + (next * QSPI_FLASH_SECTOR_SIZE);
+  h = FlashLog_Header(map, next);
+  header.erase_count = (FlashLog_Counted(h) != 0U) ? h->erase_count : fl_max_erase;
+
+  if ((FlashLog_Counted(h) != 0U)
+      && (FlashLog_Blank(&map[addr + FLASH_LOG_ERASE_LEN], QSPI_FLASH_SECTOR_SIZE - FLASH_LOG_ERASE_LEN) != 0U))
+  {
+    /* Erased by a compaction, erase record in place */
+    from = FLASH_LOG_ERASE_LEN;
+  }
+  else if (FlashLog_Blank(&map[addr], QSPI_FLASH_SECTOR_SIZE) == 0U)
+  {
+    fl_stats.reerased++;
+    header.erase_count++;
+    if (FlashLog_Erase(next, header.erase_count) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+    from = FLASH_LOG_ERASE_LEN;
+  }
+  header.erase_magic = FLASH_LOG_ERASE_MAGIC;
+  header.erase_crc = Frame_Crc16((const uint8_t *)&header.erase_count, sizeof(header.erase_count));
+  header.magic = FLASH_LOG_MAGIC;
+  header.seq = fl_head_seq + 1U;
+  header.first_record = fl_next_record;
+  header.crc = Frame_Crc16((const uint8_t *)&header.erase_count, 16U);
+  header.reserved = 0xFFFFU;
+  if (QspiFlash_Program(addr + from, (const uint8_t *)&header + from, FLASH_LOG_HEADER_LEN - from) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  if (fl_head == FLASH_LOG_NONE)
+  {
+    fl_oldest = next;
+  }
+  fl_head = next;
+  fl_head_seq = header.seq;
+  fl_used++;
+  fl_off = FLASH_LOG_HEADER_LEN;
+  FlashLog_Seek(addr + FLASH_LOG_HEADER_LEN);
+  return HAL_OK;
+}
+
+/* Reclaim the oldest sectors until opening one more leaves the spares.
+   A sector of KEEP records only moves to the head; when every live sector
+   has moved without one being freed, nothing can be, and the log is full. */
+static HAL_StatusTypeDef FlashLog_Compact(void)
+{
+  uint32_t stalls = 0U;
+
+  while ((fl_used + FLASH_LOG_SPARE) >= fl_sectors)
+  {
+    uint32_t used = fl_used;
+
+    if ((fl_full != 0U) || (stalls >= fl_used))
+    {
+      fl_full = 1U;
+      return HAL_ERROR;
+    }
+    if (FlashLog_Reclaim() != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+    stalls = (fl_used >= used) ? (stalls + 1U) : 0U;
+  }
+  return HAL_OK;
+}
+
+/* Carry the KEEP records of the oldest sector to the head, spilling into a
+   spare if they do not fit, then erase it */
+static HAL_StatusTypeDef FlashLog_Reclaim(void)
+{
+  uint32_t src = fl_oldest;
+  const FlashLog_RecordTypeDef *rec;
+  const uint8_t *map;
+  uint32_t src_seq;
+  uint32_t src_erase;
+  uint32_t resume = 0U;
+  uint8_t skipping = 0U;
+  uint32_t off;
+
+  if ((FlashLog_Sync() != HAL_OK) || ((map = QspiFlash_Map()) == NULL))
+  {
+    return HAL_ERROR;
+  }
+  src_seq = FlashLog_Header(map, src)->seq;
+  src_erase = FlashLog_Header(map, src)->erase_count;
+
+  /* Copies already made before a power failure sit in the newest sectors;
+     carry on after the last one */
+  for (uint32_t back = FLASH_LOG_SPARE + 1U; back-- != 0U;)
+  {
+    uint32_t sector = (fl_head + fl_sectors - back) % fl_sectors;
+
+    if ((back >= (fl_used - 1U)) || (fl_head == FLASH_LOG_NONE))
+    {
+      continue;
+    }
+    off = FLASH_LOG_HEADER_LEN;
+    while (FlashLog_Walk(map, sector, &off, &rec) == FLASH_LOG_WALK_OK)
+    {
+      if (((rec->flags & FLASH_LOG_RELOCATED) != 0U) && (rec->origin == src_seq))
+      {
+        resume = rec->seq;
+        skipping = 1U;
+      }
+    }
+  }
+
+  fl_reclaiming = 1U;
+  off = FLASH_LOG_HEADER_LEN;
+  for (;;)
+  {
+    FlashLog_RecordTypeDef copy;
+
+    if ((map = QspiFlash_Map()) == NULL)
+    {
+      fl_reclaiming = 0U;
+      return HAL_ERROR;
+    }
+    if (FlashLog_Walk(map, src, &off, &rec) != FLASH_LOG_WALK_OK)
+    {
+      break;
+    }
+    if (skipping != 0U)
+    {
+      skipping = (rec->seq == resume) ? 0U : 1U;
+      continue;
+    }
+    if ((rec->flags & FLASH_LOG_KEEP) == 0U)
+    {
+      continue;
+    }
+    copy = *rec;
+    copy.flags |= FLASH_LOG_RELOCATED;
+    copy.origin = src_seq;
+    memcpy(fl_copy, &rec[1], rec->len);
+    if (FlashLog_Put(&copy, fl_copy) != HAL_OK)
+    {
+      fl_reclaiming = 0U;
+      return HAL_ERROR;
+    }
+    fl_stats.relocated++;
+  }
+  fl_reclaiming = 0U;
+
+  if ((FlashLog_Sync() != HAL_OK) || (FlashLog_Erase(src, src_erase + 1U) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  fl_oldest = (src + 1U) % fl_sectors;
+  fl_used--;
+  return HAL_OK;
+}
+
+/* Erase a sector and record its wear right away. A cut leaves the erase
+   part torn, failing its CRC, or blank. */
+static HAL_StatusTypeDef FlashLog_Erase(uint32_t sector, uint32_t erase_count)
+{
+  uint32_t addr = fl_base + (sector * QSPI_FLASH_SECTOR_SIZE);
+  FlashLog_SectorTypeDef record;
+
+  record.erase_magic = FLASH_LOG_ERASE_MAGIC;
+  record.erase_count = erase_count;
+  record.erase_crc = Frame_Crc16((const uint8_t *)&record.erase_count, sizeof(record.erase_count));
+  if ((QspiFlash_EraseSector(addr) != HAL_OK)
+      || (QspiFlash_Program(addr, (const uint8_t *)&record, FLASH_LOG_ERASE_LEN) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  fl_max_erase = (erase_count > fl_max_erase) ? erase_count : fl_max_erase;
+  return HAL_OK;
+}
+
+/* Stage bytes in the page buffer, programming each page as it fills */
+static HAL_StatusTypeDef FlashLog_Write(const void *data, uint32_t len)
+{
+  const uint8_t *p = (const uint8_t *)data;
+
+  while (len != 0U)
+  {
+    uint32_t chunk = QSPI_FLASH_PAGE_SIZE - fl_page_fill;
+
+    chunk = (chunk > len) ? len : chunk;
+    memcpy(&fl_page[fl_page_fill], p, chunk);
+    fl_page_fill += chunk;
+    p += chunk;
+    len -= chunk;
+    if (fl_page_fill == QSPI_FLASH_PAGE_SIZE)
+    {
+      if (FlashLog_Sync() != HAL_OK)
+      {
+        return HAL_ERROR;
+      }
+      fl_page_addr += QSPI_FLASH_PAGE_SIZE;
+      fl_page_fill = 0U;
+      fl_page_prog = 0U;
+    }
+  }
+  return HAL_OK;
+}
+
+/* Point the page buffer at an append address; earlier bytes of the page
+   are already programmed */
+static void FlashLog_Seek(uint32_t addr)
+{
+  fl_page_addr = addr & ~(QSPI_FLASH_PAGE_SIZE - 1U);
+  fl_page_fill = addr - fl_page_addr;
+  fl_page_prog = fl_page_fill;
+}
+
+static FlashLog_WalkTypeDef FlashLog_Walk(const uint8_t *map, uint32_t sector, uint32_t *off,
+                                          const FlashLog_RecordTypeDef **rec)
+{
+  const uint8_t *base = &map[fl_base + (sector * QSPI_FLASH_SECTOR_SIZE)];
+  const FlashLog_RecordTypeDef *r = (const FlashLog_RecordTypeDef *)&base[*off];
+
+  if ((*off + FLASH_LOG_RECORD_LEN) > QSPI_FLASH_SECTOR_SIZE)
+  {
+    return FLASH_LOG_WALK_END;
+  }
+  if (FlashLog_Blank(&base[*off], FLASH_LOG_RECORD_LEN) != 0U)
+  {
+    return FLASH_LOG_WALK_END;
+  }
+  if ((r->len > FLASH_LOG_RECORD_MAX)
+      || ((*off + FLASH_LOG_RECORD_LEN + FLASH_LOG_ALIGN(r->len)) > QSPI_FLASH_SECTOR_SIZE)
+      || (FlashLog_RecordCrc(r, (const uint8_t *)&r[1]) != r->crc))
+  {
+    return FLASH_LOG_WALK_TORN;
+  }
+  *rec = r;
+  *off += FLASH_LOG_RECORD_LEN + FLASH_LOG_ALIGN(r->len);
+  return FLASH_LOG_WALK_OK;
+}
+
+static const FlashLog_SectorTypeDef *FlashLog_Header(const uint8_t *map, uint32_t sector)
+{
+  return (const FlashLog_SectorTypeDef *)&map[fl_base + (sector * QSPI_FLASH_SECTOR_SIZE)];
+}
+
+static uint8_t FlashLog_Valid(const FlashLog_SectorTypeDef *header)
+{
+  return ((FlashLog_Counted(header) != 0U) && (header->magic == FLASH_LOG_MAGIC)
+          && (Frame_Crc16((const uint8_t *)&header->erase_count, 16U) == header->crc)) ? 1U : 0U;
+}
+
+/* The erase part is complete: erase_count can be trusted */
+static uint8_t FlashLog_Counted(const FlashLog_SectorTypeDef *header)
+{
+  return ((header->erase_magic == FLASH_LOG_ERASE_MAGIC)
+          && (Frame_Crc16((const uint8_t *)&header->erase_count, sizeof(header->erase_count)) == header->erase_crc))
+         ? 1U : 0U;
+}
+
+static uint16_t FlashLog_RecordCrc(const FlashLog_RecordTypeDef *rec, const uint8_t *payload)
+{
+  uint16_t crc = Frame_Crc16((const uint8_t *)&rec->len, sizeof(rec->len));
+
+  crc = Frame_Crc16Update(crc, &rec->type, FLASH_LOG_RECORD_LEN - 4U);
+  return Frame_Crc16Update(crc, payload, rec->len);
+}
+
+/* Whole words still erased; len is a multiple of 4 */
+static uint8_t FlashLog_Blank(const uint8_t *p, uint32_t len)
+{
+  const uint32_t *w = (const uint32_t *)p;
+
+  for (uint32_t n = 0U; n < (len / 4U); n++)
+  {
+    if (w[n] != 0xFFFFFFFFU)
+    {
+      return 0U;
+    }
+  }
+  return 1U;
+}
@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file           : flash_log.h
+  * @brief          : Header for flash_log.c file.
+  *                   Append-only, wear-leveled, power-fail-safe record log
+  *                   on the QSPI NOR flash.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FLASH_LOG_H
+#define __FLASH_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "qspi_flash.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Largest payload of one record */
+#define FLASH_LOG_RECORD_MAX     1024U
+
+/* The log needs at least this many sectors: two spares, the head and one
+   older sector to compact */
+#define FLASH_LOG_MIN_SECTORS    4U
+
+/* Record flags */
+#define FLASH_LOG_KEEP           0x01U     /* carried forward by compaction */
+#define FLASH_LOG_RELOCATED      0x02U     /* copy made by compaction       */
+
+/* Exported types ------------------------------------------------------------*/
+/* Sector header. The erase part is written right after every erase, the
+   open part when the log starts filling the sector. */
+typedef struct
+{
+  uint16_t erase_magic;     /* FLASH_LOG_ERASE_MAGIC                       */
+  uint16_t erase_crc;       /* Frame_Crc16 of erase_count                  */
+  uint32_t erase_count;     /* wear of this sector                         */
+  uint32_t magic;           /* FLASH_LOG_MAGIC                             */
+  uint32_t seq;             /* sector number, +1 per sector opened         */
+  uint32_t first_record;    /* record number when the sector was opened    */
+  uint16_t crc;             /* Frame_Crc16 of erase_count .. first_record  */
+  uint16_t reserved;
+} FlashLog_SectorTypeDef;
+
+/* Record header, followed by the payload and padding to 4 bytes */
+typedef struct
+{
+  uint16_t len;             /* payload bytes, 0xFFFF: end of the sector    */
+  uint16_t crc;             /* Frame_Crc16 of len, type .. origin, payload */
+  uint8_t type;             /* application defined                         */
+  uint8_t flags;            /* FLASH_LOG_KEEP, FLASH_LOG_RELOCATED         */
+  uint16_t reserved;
+  uint32_t seq;             /* record number, kept by relocated copies     */
+  uint32_t origin;          /* relocated: sector seq of the original       */
+} FlashLog_RecordTypeDef;
+
+/* Replay visitor; payload points into the memory-mapped flash. It must not
+   append to the log. */
+typedef void (*FlashLog_VisitTypeDef)(const FlashLog_RecordTypeDef *rec, const uint8_t *payload, void *ctx);
+
+typedef struct
+{
+  uint32_t sectors;
+  uint32_t used_sectors;
+  uint32_t min_erase_count;
+  uint32_t max_erase_count;
+  uint32_t next_record;
+  uint32_t appended;        /* since FlashLog_Init                         */
+  uint32_t relocated;       /* KEEP records carried forward                */
+  uint32_t torn;            /* torn records found by recovery              */
+  uint32_t reerased;        /* sectors erased again, torn by a cut or
+                               foreign, at one extra erase each            */
+  uint8_t full;             /* only KEEP records left: appends fail        */
+} FlashLog_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef FlashLog_Init(QSPI_HandleTypeDef *hqspi, uint32_t base, uint32_t size);
+HAL_StatusTypeDef FlashLog_Append(uint8_t type, const void *data, uint16_t len, uint8_t flags);
+HAL_StatusTypeDef FlashLog_Sync(void);
+uint32_t FlashLog_Replay(FlashLog_VisitTypeDef visit, void *ctx);
+void FlashLog_GetStats(FlashLog_StatsTypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FLASH_LOG_H */
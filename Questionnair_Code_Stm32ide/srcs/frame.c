@@ -0,0 +1,123 @@
+/**
+  ******************************************************************************
+  * @file           : frame.c
+  * @brief          : COBS framing with a CRC-16 trailer.
+  *
+  *                   A frame on the wire is COBS(payload | crc16 LE) 0x00.
+  *                   Consistent Overhead Byte Stuffing removes every zero
+  *                   from the frame body, so the zero delimiter lets a
+  *                   receiver resynchronise on the next frame after any
+  *                   lost or corrupted byte; the CRC (CCITT-FALSE, poly
+  *                   0x1021, init 0xFFFF) rejects what is left of a
+  *                   damaged frame.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "frame.h"
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  CRC-16/CCITT-FALSE.
+  * @param  data: bytes
+  * @param  len: number of bytes
+  * @retval CRC
+  */
+uint16_t Frame_Crc16(const uint8_t *data, size_t len)
+{
+  return Frame_Crc16Update(0xFFFFU, data, len);
+}
+
+/**
+  * @brief  Continue a CRC-16/CCITT-FALSE over more bytes.
+  * @param  crc: value returned for the preceding bytes
+  * @param  data: bytes
+  * @param  len: number of bytes
+  * @retval CRC
+  */
+uint16_t Frame_Crc16Update(uint16_t crc, const uint8_t *data, size_t len)
+{
+  while (len-- != 0U)
+  {
+    crc ^= (uint16_t)((uint16_t)*data++ << 8);
+    for (uint32_t bit = 0U; bit < 8U; bit++)
+    {
+      crc = ((crc & 0x8000U) != 0U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+/**
+  * @brief  Build a complete frame: CRC appended, COBS encoded, delimited.
+  * @param  payload: record bytes
+  * @param  len: number of bytes
+  * @param  out: at least FRAME_ENCODED_MAX(len) bytes
+  * @retval Bytes written to out, delimiter included
+  */
+size_t Frame_Encode(const uint8_t *payload, size_t len, uint8_t *out)
+{
+  uint16_t crc = Frame_Crc16(payload, len);
+  size_t code_at = 0U;
+  size_t o = 1U;
+  uint8_t code = 1U;
+
+  for (size_t n = 0U; n < (len + FRAME_CRC_LEN); n++)
+  {
+    uint8_t b = (n < len) ? payload[n] : (uint8_t)(crc >> (8U * (n - len)));
+
+    if (b != 0U)
+    {
+      out[o++] = b;
+      code++;
+    }
+    if ((b == 0U) || (code == 0xFFU))
+    {
+      out[code_at] = code;
+      code_at = o++;
+      code = 1U;
+    }
+  }
+  out[code_at] = code;
+  out[o++] = FRAME_DELIMITER;
+  return o;
+}
+
+/**
+  * @brief  Undo Frame_Encode() on the bytes between two delimiters.
+  * @param  in: encoded frame without its delimiter
+  * @param  len: number of bytes
+  * @param  payload: at least len bytes
+  * @retval Payload length, 0 if the frame is malformed or the CRC fails
+  */
+size_t Frame_Decode(const uint8_t *in, size_t len, uint8_t *payload)
+{
+  size_t i = 0U;
+  size_t o = 0U;
+
+  while (i < len)
+  {
+    uint8_t code = in[i++];
+
+    if ((code == 0U) || ((i + code - 1U) > len))
+    {
+      return 0U;
+    }
+    for (uint8_t n = 1U; n < code; n++)
+    {
+      payload[o++] = in[i++];
+    }
+    if ((code != 0xFFU) && (i < len))
+    {
+      payload[o++] = 0U;
+    }
+  }
+  if ((o <= FRAME_CRC_LEN)
+      || (Frame_Crc16(payload, o - FRAME_CRC_LEN)
+          != (uint16_t)(payload[o - 2U] | ((uint16_t)payload[o - 1U] << 8))))
+  {
+    return 0U;
+  }
+  return o - FRAME_CRC_LEN;
+}
@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file           : frame.h
+  * @brief          : Header for frame.c file.
+  *                   COBS framing with a CRC-16 trailer, shared by the
+  *                   firmware telemetry and the host receiver.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FRAME_H
+#define __FRAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Frames are separated by a single zero byte */
+#define FRAME_DELIMITER        0x00U
+#define FRAME_CRC_LEN          2U
+
+/* Encoded size of a payload of n bytes, CRC and delimiter included */
+#define FRAME_ENCODED_MAX(n)   ((n) + FRAME_CRC_LEN + (((n) + FRAME_CRC_LEN) / 254U) + 2U)
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint16_t Frame_Crc16(const uint8_t *data, size_t len);
+uint16_t Frame_Crc16Update(uint16_t crc, const uint8_t *data, size_t len);
+size_t Frame_Encode(const uint8_t *payload, size_t len, uint8_t *out);
+size_t Frame_Decode(const uint8_t *in, size_t len, uint8_t *payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAME_H */
@@ -0,0 +1,631 @@
+/**
+  ******************************************************************************
+  * @file           : audio_bench.c
+  * @brief          : Correctness and throughput bench of the audio front end.
+  *
+  *                     audio_bench [-r repeat] [-w dir] [-v] [wav ...]
+  *
+  *                   Each recording (16-bit mono PCM WAV at
+  *                   AUDIO_FEATURES_RATE_HZ) is played through the
+  *                   simulated DFSDM1 filter one millisecond at a time;
+  *                   AudioCapture hands the DMA blocks over as on the board
+  *                   and AudioFeatures turns each one into a frame, which is
+  *                   compared with a double-precision reference of the same
+  *                   definitions:
+  *
+  *                     - log energy within AUDIO_BENCH_ENERGY_DB
+  *                     - zero crossings within AUDIO_BENCH_CROSSINGS
+  *                     - log-mel bands within AUDIO_BENCH_MEL_DB, for bands
+  *                       less than AUDIO_BENCH_MEL_RANGE_DB below the
+  *                       strongest band of the frame (the halving Q15
+  *                       FFT has its own noise about 50 dB down) and at
+  *                       least AUDIO_BENCH_MEL_SNR_DB above what rounding
+  *                       the frame to 16 bits leaves in the band
+  *                     - no block overrun, one frame per hop
+  *
+  *                   The kernels are then timed alone over the recording,
+  *                   -r times, for the frame cost and the real-time factor
+  *                   on this host.
+  *
+  *                   Without files, a built-in set of synthetic recordings
+  *                   (tones, chirp, noise, vowel, fricative, silence) is
+  *                   used; -w also writes it as WAV files into dir.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "audio_capture.h"
+#include "app.h"
+#include "hal_sim.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define AUDIO_BENCH_ENERGY_DB     0.05
+#define AUDIO_BENCH_CROSSINGS     2U
+#define AUDIO_BENCH_MEL_DB        1.0
+#define AUDIO_BENCH_MEL_RANGE_DB  40.0
+#define AUDIO_BENCH_MEL_SNR_DB    20.0
+#define AUDIO_BENCH_SYNTH_MS      2000U
+#define AUDIO_BENCH_PER_MS        (AUDIO_FEATURES_RATE_HZ / 1000U)
+#define AUDIO_BENCH_N             AUDIO_FEATURES_FRAME_LEN
+#define AUDIO_BENCH_HOP           AUDIO_FEATURES_HOP_LEN
+#define AUDIO_BENCH_BANDS         AUDIO_FEATURES_MEL_BANDS
+#define AUDIO_BENCH_DB_PER_LOG2   3.0102999566
+#define AUDIO_BENCH_PI            3.14159265358979323846
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char *name;
+  int16_t *samples;
+  uint32_t count;
+} Bench_RecordingTypeDef;
+
+/* Reference of the frame definitions, in double */
+typedef struct
+{
+  double frame[AUDIO_BENCH_N];
+  double dc_x;
+  double dc_y;
+  double cos_n[AUDIO_BENCH_N];
+  double sin_n[AUDIO_BENCH_N];
+  double mean_square;
+  uint32_t zero_crossings;
+  double mel[AUDIO_BENCH_BANDS];
+  double noise[AUDIO_BENCH_BANDS];   /* 16-bit rounding noise per band */
+} Bench_ReferenceTypeDef;
+
+typedef struct
+{
+  uint32_t frames;
+  uint32_t voiced;
+  uint32_t failures;
+  double energy_max_db;
+  uint32_t crossings_max;
+  double mel_max_db;
+  double mel_sum_db;
+  uint32_t mel_bands;
+} Bench_ResultTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static Bench_ReferenceTypeDef bench_ref;
+
+/* Private function prototypes -----------------------------------------------*/
+static int Bench_Run(const Bench_RecordingTypeDef *rec, uint32_t repeat, int verbose);
+static void Bench_Compare(const Bench_RecordingTypeDef *rec, const AudioFeatures_FrameTypeDef *frame,
+                          Bench_ResultTypeDef *res, int verbose);
+static void Bench_RefReset(void);
+static void Bench_RefPush(const int16_t *hop);
+static double Bench_Time(const Bench_RecordingTypeDef *rec, uint32_t repeat);
+static uint32_t Bench_Synthesize(Bench_RecordingTypeDef *set);
+static int Bench_ReadWav(const char *path, Bench_RecordingTypeDef *rec);
+static int Bench_WriteWav(const char *path, const Bench_RecordingTypeDef *rec);
+static uint32_t Bench_Random(uint32_t *state);
+static int16_t Bench_Clip(double v);
+static void Bench_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler at simulated tick %lu\n", (unsigned long)HAL_GetTick());
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  Bench_RecordingTypeDef synth[8];
+  Bench_RecordingTypeDef rec;
+  const char *dir = NULL;
+  uint32_t repeat = 20U;
+  int verbose = 0;
+  int failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "r:w:vh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'r':
+        repeat = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'w':
+        dir = optarg;
+        break;
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        Bench_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  AudioFeatures_Init();
+  if (optind < argc)
+  {
+    for (int n = optind; n < argc; n++)
+    {
+      if ((Bench_ReadWav(argv[n], &rec) != 0) || (Bench_Run(&rec, repeat, verbose) != 0))
+      {
+        failed = 1;
+      }
+      free(rec.samples);
+    }
+    return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+
+  for (uint32_t n = 0U, count = Bench_Synthesize(synth); n < count; n++)
+  {
+    if (dir != NULL)
+    {
+      char path[512];
+
+      snprintf(path, sizeof(path), "%s/%s.wav", dir, synth[n].name);
+      if (Bench_WriteWav(path, &synth[n]) != 0)
+      {
+        failed = 1;
+      }
+    }
+    if (Bench_Run(&synth[n], repeat, verbose) != 0)
+    {
+      failed = 1;
+    }
+    free(synth[n].samples);
+  }
+  return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Stream one recording through the simulated microphone and check every
+   frame, then time the kernels */
+static int Bench_Run(const Bench_RecordingTypeDef *rec, uint32_t repeat, int verbose)
+{
+  DFSDM_Channel_HandleTypeDef hchannel;
+  AudioCapture_StatsTypeDef stats;
+  AudioFeatures_FrameTypeDef frame;
+  Bench_ResultTypeDef res;
+  const int16_t *block;
+  double us;
+
+  memset(&res, 0, sizeof(res));
+  memset(&hchannel, 0, sizeof(hchannel));
+  hchannel.Instance = DFSDM1_Channel1;
+  hchannel.Init.OutputClock.Activation = ENABLE;
+  hchannel.Init.OutputClock.Divider = 2U;
+
+  HalSim_Reset();
+  if (AudioCapture_Init(&hchannel) != HAL_OK)
+  {
+    fprintf(stderr, "%s: AudioCapture_Init failed\n", rec->name);
+    return 1;
+  }
+  if (HalSim_MicRate() != AUDIO_FEATURES_RATE_HZ)
+  {
+    fprintf(stderr, "%s: DFSDM set up for %lu Hz, not %u Hz\n", rec->name,
+            (unsigned long)HalSim_MicRate(), AUDIO_FEATURES_RATE_HZ);
+    return 1;
+  }
+  AudioFeatures_Reset();
+  Bench_RefReset();
+  if (AudioCapture_Start() != HAL_OK)
+  {
+    fprintf(stderr, "%s: AudioCapture_Start failed\n", rec->name);
+    return 1;
+  }
+
+  for (uint32_t pos = 0U; (pos + AUDIO_BENCH_PER_MS) <= rec->count; pos += AUDIO_BENCH_PER_MS)
+  {
+    HalSim_MicPush(&rec->samples[pos], AUDIO_BENCH_PER_MS);
+    HalSim_Tick(1U);
+    while ((block = AudioCapture_GetBlock()) != NULL)
+    {
+      AudioFeatures_Push(block, &frame);
+      Bench_RefPush(block);
+      AudioCapture_ReleaseBlock();
+      Bench_Compare(rec, &frame, &res, verbose);
+    }
+  }
+  (void)AudioCapture_Stop();
+
+  AudioCapture_GetStats(&stats);
+  if ((stats.overruns != 0U) || (res.frames != ((rec->count / AUDIO_BENCH_PER_MS) * AUDIO_BENCH_PER_MS) / AUDIO_BENCH_HOP))
+  {
+    fprintf(stderr, "%s: %lu frames for %lu samples, %lu overruns\n", rec->name, (unsigned long)res.frames,
+            (unsigned long)rec->count, (unsigned long)stats.overruns);
+    res.failures++;
+  }
+
+  us = Bench_Time(rec, repeat);
+  printf("%s: %lu frames, voiced %lu; energy %.3f dB, crossings %lu, log-mel %.2f dB max %.3f dB mean (%lu bands); "
+         "%.1f us/frame, %.0fx real time%s\n",
+         rec->name, (unsigned long)res.frames, (unsigned long)res.voiced, res.energy_max_db,
+         (unsigned long)res.crossings_max, res.mel_max_db,
+         (res.mel_bands != 0U) ? (res.mel_sum_db / (double)res.mel_bands) : 0.0, (unsigned long)res.mel_bands,
+         us, (us > 0.0) ? ((1e6 * AUDIO_BENCH_HOP) / (AUDIO_FEATURES_RATE_HZ * us)) : 0.0,
+         (res.failures != 0U) ? ", FAILED" : "");
+  return (res.failures != 0U) ? 1 : 0;
+}
+
+static void Bench_Compare(const Bench_RecordingTypeDef *rec, const AudioFeatures_FrameTypeDef *frame,
+                          Bench_ResultTypeDef *res, int verbose)
+{
+  uint32_t fail = 0U;
+  uint32_t crossings;
+  double strongest = 0.0;
+
+  res->frames++;
+  if ((frame->log_energy > APP_VOICED_LOG_ENERGY) && (frame->zero_crossings < APP_VOICED_CROSSINGS))
+  {
+    res->voiced++;
+  }
+
+  /* below one LSB^2 the reference is dominated by the DC blocker rounding */
+  if (bench_ref.mean_square >= 1.0)
+  {
+    double err = fabs(((double)frame->log_energy / AUDIO_FEATURES_LOG_ONE) - log2(bench_ref.mean_square))
+                 * AUDIO_BENCH_DB_PER_LOG2;
+
+    res->energy_max_db = (err > res->energy_max_db) ? err : res->energy_max_db;
+    fail |= (err > AUDIO_BENCH_ENERGY_DB) ? 1U : 0U;
+  }
+  else if ((bench_ref.mean_square == 0.0) && (frame->log_energy != AUDIO_FEATURES_LOG_FLOOR))
+  {
+    fail |= 1U;
+  }
+
+  crossings = (frame->zero_crossings > bench_ref.zero_crossings) ? (frame->zero_crossings - bench_ref.zero_crossings)
+                                                                 : (bench_ref.zero_crossings - frame->zero_crossings);
+  res->crossings_max = (crossings > res->crossings_max) ? crossings : res->crossings_max;
+  fail |= (crossings > AUDIO_BENCH_CROSSINGS) ? 2U : 0U;
+
+  for (uint32_t b = 0U; b < AUDIO_BENCH_BANDS; b++)
+  {
+    strongest = (bench_ref.mel[b] > strongest) ? bench_ref.mel[b] : strongest;
+  }
+  for (uint32_t b = 0U; (b < AUDIO_BENCH_BANDS) && (strongest > 0.0); b++)
+  {
+    double err;
+
+    if ((bench_ref.mel[b] <= 0.0)
+        || ((10.0 * log10(strongest / bench_ref.mel[b])) > AUDIO_BENCH_MEL_RANGE_DB)
+        || ((10.0 * log10(bench_ref.mel[b] / bench_ref.noise[b])) < AUDIO_BENCH_MEL_SNR_DB))
+    {
+      continue;
+    }
+    err = fabs(((double)frame->log_mel[b] / AUDIO_FEATURES_LOG_ONE) - log2(bench_ref.mel[b])) * AUDIO_BENCH_DB_PER_LOG2;
+    res->mel_max_db = (err > res->mel_max_db) ? err : res->mel_max_db;
+    res->mel_sum_db += err;
+    res->mel_bands++;
+    fail |= (err > AUDIO_BENCH_MEL_DB) ? 4U : 0U;
+  }
+
+  if (fail != 0U)
+  {
+    res->failures++;
+    if ((verbose != 0) || (res->failures <= 3U))
+    {
+      fprintf(stderr, "%s: frame %lu off the reference (%s%s%s)\n", rec->name, (unsigned long)frame->index,
+              ((fail & 1U) != 0U) ? "energy " : "", ((fail & 2U) != 0U) ? "crossings " : "",
+              ((fail & 4U) != 0U) ? "log-mel" : "");
+    }
+  }
+}
+
+static void Bench_RefReset(void)
+{
+  double hann2 = 0.0;
+
+  memset(bench_ref.frame, 0, sizeof(bench_ref.frame));
+  bench_ref.dc_x = 0.0;
+  bench_ref.dc_y = 0.0;
+  for (uint32_t n = 0U; n < AUDIO_BENCH_N; n++)
+  {
+    bench_ref.cos_n[n] = cos((2.0 * AUDIO_BENCH_PI * (double)n) / AUDIO_BENCH_N);
+    bench_ref.sin_n[n] = sin((2.0 * AUDIO_BENCH_PI * (double)n) / AUDIO_BENCH_N);
+    hann2 += pow(0.5 - (0.5 * bench_ref.cos_n[n]), 2.0);
+  }
+
+  /* white rounding noise of 1/12 LSB^2 through the window and each filter */
+  for (uint32_t b = 0U; b < AUDIO_BENCH_BANDS; b++)
+  {
+    const int16_t *w;
+    uint32_t first;
+    uint32_t count;
+
+    AudioFeatures_MelWeights(b, &first, &count, &w);
+    bench_ref.noise[b] = 0.0;
+    for (uint32_t k = 0U; k < count; k++)
+    {
+      bench_ref.noise[b] += (hann2 / 12.0) * ((double)w[k] / 32768.0);
+    }
+  }
+}
+
+/* Same frame definitions as audio_features.c, without any rounding: DC
+   blocker, energy and crossings over the frame, DFT of the Hann-windowed
+   frame and the mel filters of the firmware */
+static void Bench_RefPush(const int16_t *hop)
+{
+  double windowed[AUDIO_BENCH_N];
+  double power[AUDIO_FEATURES_BINS];
+  double sum = 0.0;
+
+  memmove(bench_ref.frame, &bench_ref.frame[AUDIO_BENCH_HOP], (AUDIO_BENCH_N - AUDIO_BENCH_HOP) * sizeof(double));
+  for (uint32_t n = 0U; n < AUDIO_BENCH_HOP; n++)
+  {
+    bench_ref.dc_y = ((double)hop[n] - bench_ref.dc_x) + ((32604.0 / 32768.0) * bench_ref.dc_y);
+    bench_ref.dc_x = hop[n];
+    bench_ref.frame[(AUDIO_BENCH_N - AUDIO_BENCH_HOP) + n] = bench_ref.dc_y;
+  }
+
+  bench_ref.zero_crossings = 0U;
+  for (uint32_t n = 0U; n < AUDIO_BENCH_N; n++)
+  {
+    double x = bench_ref.frame[n];
+
+    sum += x * x;
+    if ((n > 0U) && ((x < 0.0) != (bench_ref.frame[n - 1U] < 0.0)))
+    {
+      bench_ref.zero_crossings++;
+    }
+    windowed[n] = x * (0.5 - (0.5 * bench_ref.cos_n[n]));
+  }
+  bench_ref.mean_square = sum / AUDIO_BENCH_N;
+
+  for (uint32_t k = 0U; k < AUDIO_FEATURES_BINS; k++)
+  {
+    double re = 0.0;
+    double im = 0.0;
+
+    for (uint32_t n = 0U; n < AUDIO_BENCH_N; n++)
+    {
+      uint32_t i = (k * n) % AUDIO_BENCH_N;
+
+      re += windowed[n] * bench_ref.cos_n[i];
+      im -= windowed[n] * bench_ref.sin_n[i];
+    }
+    power[k] = (re * re) + (im * im);
+  }
+
+  for (uint32_t b = 0U; b < AUDIO_BENCH_BANDS; b++)
+  {
+    const int16_t *w;
+    uint32_t first;
+    uint32_t count;
+
+    AudioFeatures_MelWeights(b, &first, &count, &w);
+    bench_ref.mel[b] = 0.0;
+    for (uint32_t k = 0U; k < count; k++)
+    {
+      bench_ref.mel[b] += power[first + k] * ((double)w[k] / 32768.0);
+    }
+  }
+}
+
+/* Kernel time per frame in microseconds, capture left out */
+static double Bench_Time(const Bench_RecordingTypeDef *rec, uint32_t repeat)
+{
+  AudioFeatures_FrameTypeDef frame;
+  struct timespec t0;
+  struct timespec t1;
+  uint32_t frames = 0U;
+  uint32_t sink = 0U;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (uint32_t r = 0U; r < repeat; r++)
+  {
+    AudioFeatures_Reset();
+    for (uint32_t pos = 0U; (pos + AUDIO_BENCH_HOP) <= rec->count; pos += AUDIO_BENCH_HOP)
+    {
+      AudioFeatures_Push(&rec->samples[pos], &frame);
+      sink += (uint32_t)frame.log_mel[0];
+      frames++;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  (void)sink;
+  if (frames == 0U)
+  {
+    return 0.0;
+  }
+  return (((double)(t1.tv_sec - t0.tv_sec) * 1e6) + ((double)(t1.tv_nsec - t0.tv_nsec) / 1e3)) / frames;
+}
+
+/* Built-in recordings, AUDIO_BENCH_SYNTH_MS each */
+static uint32_t Bench_Synthesize(Bench_RecordingTypeDef *set)
+{
+  static const char *const names[] =
+  {
+    "silence", "tone_1k", "tone_300_quiet", "chirp", "noise", "vowel", "fricative"
+  };
+  const uint32_t count = AUDIO_BENCH_SYNTH_MS * AUDIO_BENCH_PER_MS;
+  const double fs = AUDIO_FEATURES_RATE_HZ;
+  uint32_t seed = 12345U;
+  int32_t last = 0;
+
+  for (uint32_t s = 0U; s < (sizeof(names) / sizeof(names[0])); s++)
+  {
+    set[s].name = names[s];
+    set[s].count = count;
+    set[s].samples = calloc(count, sizeof(int16_t));
+    if (set[s].samples == NULL)
+    {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  for (uint32_t n = 0U; n < count; n++)
+  {
+    double t = n / fs;
+    double vowel = 0.0;
+    int32_t white = (int32_t)(Bench_Random(&seed) % 2001U) - 1000;
+
+    /* 1 kHz at -6 dBFS riding on a DC offset the blocker has to remove */
+    set[1].samples[n] = Bench_Clip(500.0 + (16000.0 * sin(2.0 * AUDIO_BENCH_PI * 1000.0 * t)));
+    /* 300 Hz at about -60 dBFS */
+    set[2].samples[n] = Bench_Clip(30.0 * sin(2.0 * AUDIO_BENCH_PI * 300.0 * t));
+    /* linear sweep 100 Hz .. 7.5 kHz */
+    set[3].samples[n] = Bench_Clip(8000.0 * sin(2.0 * AUDIO_BENCH_PI * (100.0 * t + (((7400.0 / 2.0) * t * t)
+                                                                           / (AUDIO_BENCH_SYNTH_MS / 1000.0)))));
+    set[4].samples[n] = (int16_t)white;
+
+    /* 140 Hz voice through /a/ formants (700, 1200, 2600 Hz), 4 syllables
+       per second */
+    for (uint32_t h = 1U; (h * 140U) < 4000U; h++)
+    {
+      double f = h * 140.0;
+      double g = (1.0 / (1.0 + pow((f - 700.0) / 150.0, 2.0))) + (0.5 / (1.0 + pow((f - 1200.0) / 200.0, 2.0)))
+                 + (0.2 / (1.0 + pow((f - 2600.0) / 300.0, 2.0)));
+
+      vowel += g * sin(2.0 * AUDIO_BENCH_PI * f * t);
+    }
+    set[5].samples[n] = Bench_Clip(4000.0 * vowel * (0.55 - (0.45 * cos(2.0 * AUDIO_BENCH_PI * 4.0 * t))));
+
+    /* first difference of white noise: energy rising to the top band */
+    set[6].samples[n] = (int16_t)((white - last) * 3);
+    last = white;
+  }
+  return (uint32_t)(sizeof(names) / sizeof(names[0]));
+}
+
+/* 16-bit mono PCM at AUDIO_FEATURES_RATE_HZ, nothing else */
+static int Bench_ReadWav(const char *path, Bench_RecordingTypeDef *rec)
+{
+  FILE *f = fopen(path, "rb");
+  uint8_t hdr[12];
+  uint8_t chunk[8];
+  uint8_t fmt[16];
+  int have_fmt = 0;
+
+  rec->name = path;
+  rec->samples = NULL;
+  rec->count = 0U;
+  if (f == NULL)
+  {
+    perror(path);
+    return 1;
+  }
+  if ((fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr)) || (memcmp(hdr, "RIFF", 4) != 0)
+      || (memcmp(&hdr[8], "WAVE", 4) != 0))
+  {
+    fprintf(stderr, "%s: not a WAV file\n", path);
+    fclose(f);
+    return 1;
+  }
+  while (fread(chunk, 1, sizeof(chunk), f) == sizeof(chunk))
+  {
+    uint32_t len = chunk[4] | ((uint32_t)chunk[5] << 8) | ((uint32_t)chunk[6] << 16) | ((uint32_t)chunk[7] << 24);
+
+    if (memcmp(chunk, "fmt ", 4) == 0)
+    {
+      if ((len < sizeof(fmt)) || (fread(fmt, 1, sizeof(fmt), f) != sizeof(fmt)))
+      {
+        break;
+      }
+      fseek(f, (long)(len - sizeof(fmt) + (len & 1U)), SEEK_CUR);
+      if ((fmt[0] != 1U) || (fmt[1] != 0U) || (fmt[2] != 1U) || (fmt[3] != 0U)
+          || ((fmt[4] | ((uint32_t)fmt[5] << 8) | ((uint32_t)fmt[6] << 16)) != AUDIO_FEATURES_RATE_HZ)
+          || (fmt[14] != 16U))
+      {
+        fprintf(stderr, "%s: need 16-bit mono PCM at %u Hz\n", path, AUDIO_FEATURES_RATE_HZ);
+        fclose(f);
+        return 1;
+      }
+      have_fmt = 1;
+    }
+    else if ((memcmp(chunk, "data", 4) == 0) && (have_fmt != 0))
+    {
+      uint8_t pair[2];
+
+      rec->samples = malloc(((len / 2U) + 1U) * sizeof(int16_t));
+      if (rec->samples == NULL)
+      {
+        break;
+      }
+      while ((rec->count < (len / 2U)) && (fread(pair, 1, 2, f) == 2))
+      {
+        rec->samples[rec->count++] = (int16_t)(pair[0] | ((uint16_t)pair[1] << 8));
+      }
+      fclose(f);
+      return 0;
+    }
+    else
+    {
+      fseek(f, (long)(len + (len & 1U)), SEEK_CUR);
+    }
+  }
+  fprintf(stderr, "%s: no PCM data\n", path);
+  fclose(f);
+  return 1;
+}
+
+static int Bench_WriteWav(const char *path, const Bench_RecordingTypeDef *rec)
+{
+  FILE *f = fopen(path, "wb");
+  uint32_t data = rec->count * 2U;
+  uint32_t rate = AUDIO_FEATURES_RATE_HZ;
+  uint8_t hdr[44] =
+  {
+    'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+    'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 16, 0,
+    'd', 'a', 't', 'a', 0, 0, 0, 0
+  };
+
+  if (f == NULL)
+  {
+    perror(path);
+    return 1;
+  }
+  for (uint32_t i = 0U; i < 4U; i++)
+  {
+    hdr[4 + i] = (uint8_t)((data + 36U) >> (8U * i));
+    hdr[24 + i] = (uint8_t)(rate >> (8U * i));
+    hdr[28 + i] = (uint8_t)((rate * 2U) >> (8U * i));
+    hdr[40 + i] = (uint8_t)(data >> (8U * i));
+  }
+  fwrite(hdr, 1, sizeof(hdr), f);
+  for (uint32_t n = 0U; n < rec->count; n++)
+  {
+    uint8_t pair[2] = { (uint8_t)((uint16_t)rec->samples[n] & 0xFFU), (uint8_t)((uint16_t)rec->samples[n] >> 8) };
+
+    fwrite(pair, 1, 2, f);
+  }
+  if (fclose(f) != 0)
+  {
+    perror(path);
+    return 1;
+  }
+  return 0;
+}
+
+static uint32_t Bench_Random(uint32_t *state)
+{
+  *state = (*state * 1664525U) + 1013904223U;
+  return *state >> 8;
+}
+
+static int16_t Bench_Clip(double v)
+{
+  long r = lround(v);
+
+  return (int16_t)((r > 32767) ? 32767 : ((r < -32768) ? -32768 : r));
+}
+
+static void Bench_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-r repeat] [-w dir] [-v] [wav ...]\n"
+          "  -r     timing passes over each recording (20)\n"
+          "  -w     write the built-in recordings as WAV files into dir\n"
+          "  -v     report every frame off the reference\n"
+          "  wav    16-bit mono PCM at %u Hz; the built-in set without\n",
+          argv0, AUDIO_FEATURES_RATE_HZ);
+}
@@ -0,0 +1,184 @@
+/**
+  ******************************************************************************
+  * @file           : exti_check.c
+  * @brief          : Checks the EXTI routing of the answer buttons.
+  *
+  *                     exti_check [-v]
+  *
+  *                   The board pins are set up as MX_GPIO_Init() does, then
+  *                   Questionnaire_ConfigExti() routes the buttons. Checked:
+  *
+  *                     - every button press on PA1..PA5 is an answer
+  *                     - edges of ISM43362_DRDY (PE1), USB_OTG_FS_OVRCR
+  *                       (PE3) and SPSGRF_915_GPIO3 (PE5), whose EXTI lines
+  *                       the buttons take, raise no interrupt
+  *                     - the other EXTI sources of the board keep theirs
+  *                     - setting the board pins up again afterwards takes
+  *                       lines 1, 3 and 5 back from the buttons, which is
+  *                       why Questionnaire_ConfigExti() comes last
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "questionnaire.h"
+#include "log_ring.h"
+#include "telemetry.h"
+#include "hal_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+/* Apart from the buttons, well past the debounce time */
+#define CHECK_GAP_MS   (4U * QUESTIONNAIRE_DEBOUNCE_MS)
+
+/* Private variables ---------------------------------------------------------*/
+UART_HandleTypeDef huart1 = { USART1, { 115200U, 0U, 0U, 0U, 0U, 0U, 0U }, NULL };
+UART_HandleTypeDef huart2 = { USART2, { 115200U, 0U, 0U, 0U, 0U, 0U, 0U }, NULL };
+
+static uint16_t check_lines;      /* EXTI lines that interrupted */
+static uint32_t check_failures;
+static int check_verbose;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Check_BoardGpio(void);
+static void Check_Pulse(GPIO_TypeDef *port, uint16_t pin);
+static void Check_That(int ok, const char *what);
+static void Check_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler at simulated tick %lu\n", (unsigned long)HAL_GetTick());
+  exit(EXIT_FAILURE);
+}
+
+/* As app.c, recording which lines fired */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  check_lines |= GPIO_Pin;
+  if ((GPIO_Pin & QUESTIONNAIRE_PINS) != 0U)
+  {
+    Questionnaire_OnEdge(GPIO_Pin, HAL_GPIO_ReadPin(QUESTIONNAIRE_PORT, GPIO_Pin), HAL_GetTick());
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  Questionnaire_StatsTypeDef stats;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "vh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'v':
+        check_verbose = 1;
+        break;
+      default:
+        Check_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (optind != argc)
+  {
+    Check_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  HalSim_Reset();
+  if ((LogRing_Init(&huart1) != HAL_OK) || (Telemetry_Init(&huart2) != HAL_OK))
+  {
+    Error_Handler();
+  }
+  Check_BoardGpio();
+  Questionnaire_Init(QUESTIONNAIRE_AGE_0);
+  Questionnaire_ConfigExti();
+
+  /* the board signals whose lines were taken */
+  check_lines = 0U;
+  Check_Pulse(GPIOE, ISM43362_DRDY_EXTI1_Pin);
+  Check_Pulse(GPIOE, USB_OTG_FS_OVRCR_EXTI3_Pin);
+  Check_Pulse(GPIOE, SPSGRF_915_GPIO3_EXTI5_Pin);
+  (void)Questionnaire_Process();
+  Check_That(check_lines == 0U, "PE1, PE3 and PE5 raise no interrupt");
+  Check_That(Questionnaire_Index() == 0U, "and answer nothing");
+
+  /* the other sources of the board */
+  Check_Pulse(VL53L0X_GPIO1_EXTI7_GPIO_Port, VL53L0X_GPIO1_EXTI7_Pin);
+  Check_Pulse(HTS221_DRDY_EXTI15_GPIO_Port, HTS221_DRDY_EXTI15_Pin);
+  Check_That(check_lines == (VL53L0X_GPIO1_EXTI7_Pin | HTS221_DRDY_EXTI15_Pin), "EXTI7 and EXTI15 kept");
+
+  /* the buttons */
+  check_lines = 0U;
+  for (uint32_t n = 0U; n < QUESTIONNAIRE_BUTTONS; n++)
+  {
+    Check_Pulse(QUESTIONNAIRE_PORT, (uint16_t)(GPIO_PIN_1 << n));
+  }
+  (void)Questionnaire_Process();
+  Questionnaire_GetStats(&stats);
+  Check_That(check_lines == QUESTIONNAIRE_PINS, "PA1..PA5 interrupt on lines 1..5");
+  Check_That((Questionnaire_Index() == QUESTIONNAIRE_BUTTONS) && (stats.answers == QUESTIONNAIRE_BUTTONS),
+             "one answer per button press");
+
+  /* the board set up again takes its lines back */
+  Check_BoardGpio();
+  check_lines = 0U;
+  Check_Pulse(QUESTIONNAIRE_PORT, GPIO_PIN_5);
+  Check_That(check_lines == 0U, "PA5 lost to PE5 when set up after the buttons");
+  Check_Pulse(QUESTIONNAIRE_PORT, GPIO_PIN_2);
+  Check_That(check_lines == GPIO_PIN_2, "PA2 kept, nothing else claims line 2");
+
+  printf("exti_check: %s\n", (check_failures != 0U) ? "FAILED" : "ok");
+  return (check_failures != 0U) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* The EXTI sources of MX_GPIO_Init() */
+static void Check_BoardGpio(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  GPIO_InitStruct.Pin = USB_OTG_FS_OVRCR_EXTI3_Pin | SPSGRF_915_GPIO3_EXTI5_Pin | ISM43362_DRDY_EXTI1_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init(GPIOE, &GPIO_InitStruct);
+
+  GPIO_InitStruct.Pin = HTS221_DRDY_EXTI15_Pin;
+  HAL_GPIO_Init(HTS221_DRDY_EXTI15_GPIO_Port, &GPIO_InitStruct);
+
+  GPIO_InitStruct.Pin = VL53L0X_GPIO1_EXTI7_Pin | LSM3MDL_DRDY_EXTI8_Pin;
+  HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+}
+
+/* High then low, each level held past the debounce time */
+static void Check_Pulse(GPIO_TypeDef *port, uint16_t pin)
+{
+  HalSim_GpioInput(port, pin, GPIO_PIN_SET);
+  HalSim_Tick(CHECK_GAP_MS);
+  HalSim_GpioInput(port, pin, GPIO_PIN_RESET);
+  HalSim_Tick(CHECK_GAP_MS);
+}
+
+static void Check_That(int ok, const char *what)
+{
+  if (ok == 0)
+  {
+    fprintf(stderr, "exti_check: %s: FAILED\n", what);
+    check_failures++;
+  }
+  else if (check_verbose != 0)
+  {
+    printf("exti_check: %s\n", what);
+  }
+}
+
+static void Check_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-v]\n"
+          "  -v     one line per check that holds\n",
+          argv0);
+}
@@ -0,0 +1,686 @@
+/**
+  ******************************************************************************
+  * @file           : fw_bench.c
+  * @brief          : Cycle bench of the firmware hot paths, under the
+  *                   simulated HAL.
+  *
+  *                     fw_bench [-n runs] [-o results.txt]
+  *                              [-c baseline.txt [-t percent]]
+  *
+  *                   Each profiled routine runs on fixed inputs, timed by
+  *                   the scopes of profile.c exactly as on the board:
+  *
+  *                     lux_filter      LuxFilter_Block on one block with
+  *                                     spikes, every sample examined
+  *                     lux             Questionnaire_OnLux on a square wave
+  *                                     crossing the age 1 threshold
+  *                     score           Questionnaire_Process of every
+  *                                     answer of a session of each age
+  *                     led_tick        LedPattern_Tick through the three
+  *                                     result patterns, once each
+  *                     audio_features  AudioFeatures_Push over a tone in
+  *                                     noise
+  *
+  *                   and each also yields a check value (filtered values,
+  *                   answers, scores, LED on time, a checksum of the
+  *                   frames) that must match what the inputs give. The
+  *                   scopes are then exported as PROFILE telemetry and the
+  *                   records read back from USART2 must carry the same
+  *                   counts.
+  *
+  *                   One line per scope goes to stdout, and with -o to a
+  *                   file:
+  *
+  *                     scope count min median mean max check hist_0 .. hist_7
+  *
+  *                   -c compares with such a file of the same -n: a
+  *                   different count or check value fails. With -t, so
+  *                   does a median more than -t percent and BENCH_SLACK
+  *                   cycles above the baseline; only worth it against a
+  *                   baseline written on the same machine. The median,
+  *                   kept by the bench from every sample, is what the
+  *                   host's own preemptions leave alone; they do show in
+  *                   the max and the mean.
+  *
+  *                   Cycles here are host time in 80 MHz HCLK cycles
+  *                   (HalSim_Cycles), comparable from run to run on one
+  *                   machine, not with the board.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "profile.h"
+#include "adc_stream.h"
+#include "lux_filter.h"
+#include "questionnaire.h"
+#include "questionnaire_plan.h"
+#include "led_pattern.h"
+#include "audio_features.h"
+#include "log_ring.h"
+#include "telemetry.h"
+#include "hal_sim.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_SLACK           64U       /* cycles a median may grow by anyway */
+#define BENCH_NO_TIMING       0xFFFFFFFFU /* no -t: medians are not compared */
+#define BENCH_LUX_LEVEL       1500U
+#define BENCH_LUX_SPIKE_EVERY 5U        /* samples between single spikes  */
+#define BENCH_LUX_PERIOD      8U        /* blocks per square wave period   */
+#define BENCH_LUX_LOW         400U
+#define BENCH_LUX_HIGH        3000U     /* above the age 1 threshold        */
+#define BENCH_ANSWER_MS       5U        /* drains the answer's log and
+                                           telemetry at 115200 baud         */
+#define BENCH_AUDIO_HOPS      64U
+#define BENCH_AUDIO_TONE_HZ   1000.0
+#define BENCH_PI              3.14159265358979323846
+#define BENCH_UART_LEN        8192U
+#define BENCH_LINE_LEN        256U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  Profile_IdTypeDef id;
+  uint32_t check;
+} Bench_ResultTypeDef;
+
+typedef struct
+{
+  uint32_t *cycles;
+  uint32_t count;
+  uint32_t capacity;
+} Bench_SamplesTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+UART_HandleTypeDef huart1 = { USART1, { 115200U, 0U, 0U, 0U, 0U, 0U, 0U }, NULL };
+UART_HandleTypeDef huart2 = { USART2, { 115200U, 0U, 0U, 0U, 0U, 0U, 0U }, NULL };
+
+static uint32_t bench_seed = 12345U;
+static Bench_SamplesTypeDef bench_samples[PROFILE_SCOPE_COUNT];
+
+/* Scores and results of a session answering button (question % 5) + 1 */
+static const uint16_t bench_scores[QUESTIONNAIRE_AGE_COUNT] = { 120U, 4U, 20U };
+static const LedPattern_IdTypeDef bench_results[QUESTIONNAIRE_AGE_COUNT] =
+{
+  LED_PATTERN_MEDIUM, LED_PATTERN_MEDIUM, LED_PATTERN_SLOW
+};
+static const Questionnaire_ProfileTypeDef bench_profiles[QUESTIONNAIRE_PROFILES] = QUESTIONNAIRE_PLAN_PROFILES;
+
+/* LED on time of each pattern, as documented in led_pattern.h */
+static const uint32_t bench_led_on_ms[LED_PATTERN_COUNT] = { 10000U, 2500U, 350U };
+
+/* Private function prototypes -----------------------------------------------*/
+static int Bench_LuxFilter(uint32_t runs, uint32_t *check);
+static int Bench_Lux(uint32_t runs, uint32_t *check);
+static int Bench_Score(uint32_t runs, uint32_t *check);
+static int Bench_LedTick(uint32_t *check);
+static int Bench_Audio(uint32_t runs, uint32_t *check);
+static int Bench_Export(void);
+static void Bench_End(Profile_IdTypeDef id, uint32_t start);
+static uint32_t Bench_Median(Profile_IdTypeDef id);
+static int Bench_Cmp(const void *a, const void *b);
+static void Bench_Drain(uint32_t ms);
+static void Bench_Print(FILE *f, const Bench_ResultTypeDef *results, uint32_t count);
+static int Bench_Compare(const char *path, const Bench_ResultTypeDef *results, uint32_t count,
+                         uint32_t tolerance);
+static uint32_t Bench_Random(void);
+static void Bench_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler\n");
+  exit(EXIT_FAILURE);
+}
+
+/* The log and telemetry streams drain as with app.c */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  LogRing_TxCpltHandler(huart);
+  Telemetry_TxCpltHandler(huart);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *output = NULL;
+  const char *baseline = NULL;
+  uint32_t runs = 2000U;
+  uint32_t tolerance = BENCH_NO_TIMING;
+  Bench_ResultTypeDef results[PROFILE_SCOPE_COUNT];
+  uint32_t count = 0U;
+  int failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:o:c:t:h")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        runs = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'c':
+        baseline = optarg;
+        break;
+      case 't':
+        tolerance = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        Bench_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((optind != argc) || (runs == 0U))
+  {
+    Bench_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  HalSim_Reset();
+  if ((LogRing_Init(&huart1) != HAL_OK) || (Telemetry_Init(&huart2) != HAL_OK))
+  {
+    Error_Handler();
+  }
+  LedPattern_Init();
+  AudioFeatures_Init();
+  Profile_Init();
+
+  results[count].id = PROFILE_LUX_FILTER;
+  failed |= Bench_LuxFilter(runs, &results[count++].check);
+  results[count].id = PROFILE_LUX;
+  failed |= Bench_Lux(runs, &results[count++].check);
+  results[count].id = PROFILE_SCORE;
+  failed |= Bench_Score(runs, &results[count++].check);
+  results[count].id = PROFILE_LED_TICK;
+  failed |= Bench_LedTick(&results[count++].check);
+  results[count].id = PROFILE_AUDIO;
+  failed |= Bench_Audio(runs, &results[count++].check);
+  failed |= Bench_Export();
+
+  printf("# cycles: host clock in %lu MHz HCLK cycles, %lu per empty scope taken off\n",
+         (unsigned long)(SystemCoreClock / 1000000U), (unsigned long)Profile_Overhead());
+  Bench_Print(stdout, results, count);
+  if (output != NULL)
+  {
+    FILE *f = fopen(output, "w");
+
+    if (f == NULL)
+    {
+      perror(output);
+      return EXIT_FAILURE;
+    }
+    Bench_Print(f, results, count);
+    fclose(f);
+  }
+  if (baseline != NULL)
+  {
+    failed |= Bench_Compare(baseline, results, count, tolerance);
+  }
+
+  printf("fw_bench: %s\n", (failed != 0) ? "FAILED" : "ok");
+  return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* One fixed block of a level with single-sample spikes, which the median
+   removes; the check sums the filtered values */
+static int Bench_LuxFilter(uint32_t runs, uint32_t *check)
+{
+  uint16_t block[ADC_STREAM_HALF_LEN];
+
+  for (uint32_t n = 0U; n < ADC_STREAM_HALF_LEN; n++)
+  {
+    block[n] = ((n % BENCH_LUX_SPIKE_EVERY) == 2U) ? LUX_FILTER_FULL_SCALE : BENCH_LUX_LEVEL;
+  }
+
+  *check = 0U;
+  LuxFilter_Init(0U);
+  for (uint32_t r = 0U; r < runs; r++)
+  {
+    uint32_t t0 = Profile_Begin();
+
+    (void)LuxFilter_Block(block, 1U);
+    Bench_End(PROFILE_LUX_FILTER, t0);
+    *check += LuxFilter_Value();
+  }
+  if (*check != (BENCH_LUX_LEVEL * runs))
+  {
+    fprintf(stderr, "lux_filter: filtered value %lu, expected %u\n", (unsigned long)(*check / runs),
+            BENCH_LUX_LEVEL);
+    return 1;
+  }
+  return 0;
+}
+
+/* A square wave around the age 1 threshold answers once per period; the
+   check counts the answers */
+static int Bench_Lux(uint32_t runs, uint32_t *check)
+{
+  *check = 0U;
+  Questionnaire_Init(QUESTIONNAIRE_AGE_1);
+  for (uint32_t r = 0U; r < runs; r++)
+  {
+    uint8_t bright = ((r % BENCH_LUX_PERIOD) < (BENCH_LUX_PERIOD / 2U)) ? 1U : 0U;
+    uint32_t t0 = Profile_Begin();
+
+    Questionnaire_OnLux(bright, (bright != 0U) ? BENCH_LUX_HIGH : BENCH_LUX_LOW, r);
+    Bench_End(PROFILE_LUX, t0);
+
+    /* score the answers before the queue fills, a session at a time */
+    if ((r % BENCH_LUX_PERIOD) == (BENCH_LUX_PERIOD - 1U))
+    {
+      (void)Questionnaire_Process();
+      Bench_Drain(1U);
+      if (Questionnaire_Index() >= bench_profiles[QUESTIONNAIRE_AGE_1].questions)
+      {
+        *check += Questionnaire_Index();
+        Questionnaire_Init(QUESTIONNAIRE_AGE_1);
+      }
+    }
+  }
+  (void)Questionnaire_Process();
+  *check += Questionnaire_Index();
+  if (*check != ((runs + (BENCH_LUX_PERIOD - 1U)) / BENCH_LUX_PERIOD))
+  {
+    fprintf(stderr, "lux: %lu answers for %lu crossings\n", (unsigned long)*check,
+            (unsigned long)((runs + (BENCH_LUX_PERIOD - 1U)) / BENCH_LUX_PERIOD));
+    return 1;
+  }
+  return 0;
+}
+
+/* Sessions of every age answering button (question % 5) + 1, each answer
+   scored as it arrives; the check sums the final scores */
+static int Bench_Score(uint32_t runs, uint32_t *check)
+{
+  uint32_t per_round = 0U;
+  uint32_t rounds;
+  int failed = 0;
+
+  for (uint32_t a = 0U; a < QUESTIONNAIRE_AGE_COUNT; a++)
+  {
+    per_round += bench_profiles[a].questions;
+  }
+  rounds = (runs + per_round - 1U) / per_round;
+
+  *check = 0U;
+  for (uint32_t r = 0U; r < rounds; r++)
+  {
+    for (uint32_t a = 0U; a < QUESTIONNAIRE_AGE_COUNT; a++)
+    {
+      LedPattern_IdTypeDef pattern = LED_PATTERN_COUNT;
+
+      Questionnaire_Init((Questionnaire_AgeTypeDef)a);
+      for (uint32_t q = 0U; q < bench_profiles[a].questions; q++)
+      {
+        uint16_t pin = (uint16_t)(GPIO_PIN_1 << (q % QUESTIONNAIRE_BUTTONS));
+        uint32_t t0;
+
+        Questionnaire_OnEdge(pin, GPIO_PIN_SET, HAL_GetTick());
+        t0 = Profile_Begin();
+        (void)Questionnaire_Process();
+        Bench_End(PROFILE_SCORE, t0);
+        Bench_Drain(BENCH_ANSWER_MS);
+        Questionnaire_OnEdge(pin, GPIO_PIN_RESET, HAL_GetTick());
+        Bench_Drain(QUESTIONNAIRE_DEBOUNCE_MS);
+      }
+      if ((Questionnaire_GetResult(&pattern) != HAL_OK) || (pattern != bench_results[a])
+          || (Questionnaire_Score() != bench_scores[a]))
+      {
+        fprintf(stderr, "score: age %lu scored %u, pattern %d, expected %u, pattern %d\n",
+                (unsigned long)a, Questionnaire_Score(), (int)pattern, bench_scores[a], (int)bench_results[a]);
+        failed = 1;
+      }
+      *check += Questionnaire_Score();
+    }
+  }
+  return failed;
+}
+
+/* Every result pattern played out tick by tick; the check is the LED on time */
+static int Bench_LedTick(uint32_t *check)
+{
+  int failed = 0;
+
+  *check = 0U;
+  for (uint32_t p = 0U; p < LED_PATTERN_COUNT; p++)
+  {
+    uint32_t on = 0U;
+
+    if (LedPattern_Enqueue((LedPattern_IdTypeDef)p) != HAL_OK)
+    {
+      fprintf(stderr, "led_tick: pattern %lu refused\n", (unsigned long)p);
+      return 1;
+    }
+    while (LedPattern_Busy() != 0U)
+    {
+      uint32_t t0 = Profile_Begin();
+
+      LedPattern_Tick();
+      Bench_End(PROFILE_LED_TICK, t0);
+      on += (HalSim_GpioOutput(LED_PATTERN_PORT, LED_PATTERN_PIN) == GPIO_PIN_SET) ? 1U : 0U;
+    }
+    if ((on != bench_led_on_ms[p]) || (HalSim_GpioOutput(LED_PATTERN_PORT, LED_PATTERN_PIN) != GPIO_PIN_RESET))
+    {
+      fprintf(stderr, "led_tick: pattern %lu on for %lu ms, expected %lu\n", (unsigned long)p,
+              (unsigned long)on, (unsigned long)bench_led_on_ms[p]);
+      failed = 1;
+    }
+    *check += on;
+  }
+  return failed;
+}
+
+/* The same hops after each reset must give the same frames; the check is
+   their FNV-1a hash */
+static int Bench_Audio(uint32_t runs, uint32_t *check)
+{
+  static int16_t hops[BENCH_AUDIO_HOPS][AUDIO_FEATURES_HOP_LEN];
+  AudioFeatures_FrameTypeDef frame;
+  uint32_t passes = (runs + BENCH_AUDIO_HOPS - 1U) / BENCH_AUDIO_HOPS;
+  int failed = 0;
+
+  for (uint32_t h = 0U; h < BENCH_AUDIO_HOPS; h++)
+  {
+    for (uint32_t n = 0U; n < AUDIO_FEATURES_HOP_LEN; n++)
+    {
+      double t = (double)((h * AUDIO_FEATURES_HOP_LEN) + n) / AUDIO_FEATURES_RATE_HZ;
+      int32_t noise = (int32_t)(Bench_Random() & 0x7FFU) - 0x400;
+
+      hops[h][n] = (int16_t)(lrint(8000.0 * sin(2.0 * BENCH_PI * BENCH_AUDIO_TONE_HZ * t)) + noise);
+    }
+  }
+
+  for (uint32_t p = 0U; p < passes; p++)
+  {
+    uint32_t hash = 2166136261U;
+
+    AudioFeatures_Reset();
+    for (uint32_t h = 0U; h < BENCH_AUDIO_HOPS; h++)
+    {
+      uint32_t t0 = Profile_Begin();
+      const uint8_t *bytes = (const uint8_t *)&frame;
+
+      AudioFeatures_Push(hops[h], &frame);
+      Bench_End(PROFILE_AUDIO, t0);
+      for (size_t i = 0U; i < sizeof(frame); i++)
+      {
+        hash = (hash ^ bytes[i]) * 16777619U;
+      }
+    }
+    if ((p != 0U) && (hash != *check))
+    {
+      fprintf(stderr, "audio_features: pass %lu hashed %08lx, pass 0 %08lx\n", (unsigned long)p,
+              (unsigned long)hash, (unsigned long)*check);
+      failed = 1;
+    }
+    *check = hash;
+  }
+  return failed;
+}
+
+/* PROFILE records read back from USART2 must match the scopes */
+static int Bench_Export(void)
+{
+  static uint8_t wire[BENCH_UART_LEN];
+  uint8_t rec[TELEMETRY_FRAME_MAX];
+  uint32_t len = 0U;
+  uint32_t records = 0U;
+  uint32_t expect = 0U;
+  uint32_t start = 0U;
+  int failed = 0;
+
+  Bench_Drain(1U);
+  while (Telemetry_Busy() != 0U)
+  {
+    Bench_Drain(1U);
+  }
+  while (HalSim_UartOutput(USART2, wire, sizeof(wire)) != 0U)
+  {
+  }
+
+  Profile_Export();
+  do
+  {
+    Telemetry_Flush();
+    HalSim_Tick(1U);
+    len += HalSim_UartOutput(USART2, &wire[len], sizeof(wire) - len);
+  } while ((Telemetry_Busy() != 0U) && (len < sizeof(wire)));
+
+  for (uint32_t i = 0U; i < len; i++)
+  {
+    Telemetry_HeaderTypeDef h;
+    Telemetry_ProfileTypeDef p;
+    Profile_ScopeTypeDef s;
+    size_t n;
+
+    if (wire[i] != FRAME_DELIMITER)
+    {
+      continue;
+    }
+    n = ((i - start) <= sizeof(rec)) ? Frame_Decode(&wire[start], i - start, rec) : 0U;
+    start = i + 1U;
+    if (n != (sizeof(h) + sizeof(p)))
+    {
+      continue;
+    }
+    memcpy(&h, rec, sizeof(h));
+    memcpy(&p, &rec[sizeof(h)], sizeof(p));
+    if (h.type != (uint8_t)TELEMETRY_PROFILE)
+    {
+      continue;
+    }
+    records++;
+    Profile_Get((Profile_IdTypeDef)p.scope, &s);
+    if ((p.count != s.count) || (p.min_cycles != s.min_cycles) || (p.max_cycles != s.max_cycles)
+        || (p.mean_cycles != Profile_Mean(&s)))
+    {
+      fprintf(stderr, "export: scope %s sent %lu runs, has %lu\n", Profile_Name((Profile_IdTypeDef)p.scope),
+              (unsigned long)p.count, (unsigned long)s.count);
+      failed = 1;
+    }
+    for (uint32_t b = 0U; b < TELEMETRY_PROFILE_BUCKETS; b++)
+    {
+      if (p.histogram[b] != ((s.histogram[b] > 0xFFFFU) ? 0xFFFFU : s.histogram[b]))
+      {
+        fprintf(stderr, "export: scope %s bucket %lu differs\n", Profile_Name((Profile_IdTypeDef)p.scope),
+                (unsigned long)b);
+        failed = 1;
+      }
+    }
+  }
+
+  for (uint32_t n = 0U; n < PROFILE_SCOPE_COUNT; n++)
+  {
+    Profile_ScopeTypeDef s;
+
+    Profile_Get((Profile_IdTypeDef)n, &s);
+    expect += (s.count != 0U) ? 1U : 0U;
+  }
+  if (records != expect)
+  {
+    fprintf(stderr, "export: %lu PROFILE records for %lu scopes\n", (unsigned long)records,
+            (unsigned long)expect);
+    failed = 1;
+  }
+  return failed;
+}
+
+/* Profile_End(), keeping the sample for the median */
+static void Bench_End(Profile_IdTypeDef id, uint32_t start)
+{
+  Bench_SamplesTypeDef *s = &bench_samples[id];
+  uint32_t cycles = PROFILE_CYCLES() - start;
+
+  cycles = (cycles > Profile_Overhead()) ? (cycles - Profile_Overhead()) : 0U;
+  Profile_Record(id, cycles);
+  if (s->count == s->capacity)
+  {
+    s->capacity = (s->capacity != 0U) ? (2U * s->capacity) : 1024U;
+    s->cycles = realloc(s->cycles, s->capacity * sizeof(uint32_t));
+    if (s->cycles == NULL)
+    {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  s->cycles[s->count++] = cycles;
+}
+
+static uint32_t Bench_Median(Profile_IdTypeDef id)
+{
+  Bench_SamplesTypeDef *s = &bench_samples[id];
+
+  if (s->count == 0U)
+  {
+    return 0U;
+  }
+  qsort(s->cycles, s->count, sizeof(uint32_t), Bench_Cmp);
+  return s->cycles[s->count / 2U];
+}
+
+static int Bench_Cmp(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+/* Let simulated time pass with the log and telemetry drained, as the idle
+   main loop would */
+static void Bench_Drain(uint32_t ms)
+{
+  uint8_t sink[512];
+
+  while (ms-- != 0U)
+  {
+    LogRing_Flush();
+    Telemetry_Flush();
+    HalSim_Tick(1U);
+  }
+  while (HalSim_UartOutput(USART1, sink, sizeof(sink)) != 0U)
+  {
+  }
+  while (HalSim_UartOutput(USART2, sink, sizeof(sink)) != 0U)
+  {
+  }
+}
+
+static void Bench_Print(FILE *f, const Bench_ResultTypeDef *results, uint32_t count)
+{
+  fprintf(f, "# scope count min median mean max check");
+  for (uint32_t b = 0U; b < PROFILE_BUCKETS; b++)
+  {
+    fprintf(f, " hist_%lu", (unsigned long)b);
+  }
+  fprintf(f, "\n");
+  for (uint32_t n = 0U; n < count; n++)
+  {
+    Profile_ScopeTypeDef s;
+
+    Profile_Get(results[n].id, &s);
+    fprintf(f, "%s %lu %lu %lu %lu %lu 0x%08lx", Profile_Name(results[n].id), (unsigned long)s.count,
+            (unsigned long)s.min_cycles, (unsigned long)Bench_Median(results[n].id),
+            (unsigned long)Profile_Mean(&s), (unsigned long)s.max_cycles, (unsigned long)results[n].check);
+    for (uint32_t b = 0U; b < PROFILE_BUCKETS; b++)
+    {
+      fprintf(f, " %lu", (unsigned long)s.histogram[b]);
+    }
+    fprintf(f, "\n");
+  }
+}
+
+/* Every scope of the baseline must be here, as correct, and with a
+   tolerance not slower */
+static int Bench_Compare(const char *path, const Bench_ResultTypeDef *results, uint32_t count,
+                         uint32_t tolerance)
+{
+  char line[BENCH_LINE_LEN];
+  FILE *f = fopen(path, "r");
+  int failed = 0;
+
+  if (f == NULL)
+  {
+    perror(path);
+    return 1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    char name[64];
+    Profile_ScopeTypeDef scope;
+    unsigned long base_count;
+    unsigned long base_median;
+    unsigned long base_check;
+    uint32_t n = 0U;
+    uint32_t median;
+    uint64_t limit;
+
+    if ((line[0] == '#')
+        || (sscanf(line, "%63s %lu %*u %lu %*u %*u %lx", name, &base_count, &base_median, &base_check) != 4))
+    {
+      continue;
+    }
+    while ((n < count) && (strcmp(Profile_Name(results[n].id), name) != 0))
+    {
+      n++;
+    }
+    if (n == count)
+    {
+      printf("%s: in the baseline, not run\n", name);
+      failed = 1;
+      continue;
+    }
+    Profile_Get(results[n].id, &scope);
+    if (scope.count != base_count)
+    {
+      printf("%s: count %lu, baseline %lu\n", name, (unsigned long)scope.count, base_count);
+      failed = 1;
+    }
+    if (results[n].check != base_check)
+    {
+      printf("%s: check 0x%08lx, baseline 0x%08lx\n", name, (unsigned long)results[n].check, base_check);
+      failed = 1;
+    }
+    if (tolerance == BENCH_NO_TIMING)
+    {
+      continue;
+    }
+    median = Bench_Median(results[n].id);
+    limit = (((uint64_t)base_median * (100U + tolerance)) / 100U) + BENCH_SLACK;
+    if (median > limit)
+    {
+      printf("%s: median %lu cycles, baseline %lu, limit %lu\n", name, (unsigned long)median,
+             base_median, (unsigned long)limit);
+      failed = 1;
+    }
+  }
+  fclose(f);
+  printf("baseline %s: %s\n", path, (failed != 0) ? "regressed" : "matched");
+  return failed;
+}
+
+static uint32_t Bench_Random(void)
+{
+  bench_seed = (bench_seed * 1664525U) + 1013904223U;
+  return bench_seed >> 8;
+}
+
+static void Bench_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-n runs] [-o results.txt] [-c baseline.txt [-t percent]]\n"
+          "  -n     timed runs of each routine, about (2000)\n"
+          "  -o     write the results\n"
+          "  -c     compare with results written by -o\n"
+          "  -t     also fail a median this many %% slower than the baseline\n",
+          argv0);
+}
@@ -0,0 +1,1592 @@
+/**
+  ******************************************************************************
+  * @file           : hal_sim.c
+  * @brief          : Host (Linux) emulation of the HAL services used by the
+  *                   application modules.
+  *
+  *                   Time: HalSim_Tick() advances the simulated wall clock
+  *                   one millisecond at a time. Each millisecond runs the
+  *                   environment hook (the test bench driving pins, lux and
+  *                   UART input), advances LPTIM1 at the LSE rate, and, unless
+  *                   the tick is suspended, plays the SysTick interrupt by
+  *                   calling HAL_IncTick(), which the application overrides
+  *                   as it does on the target. HAL_Delay() advances simulated
+  *                   time instead of sleeping.
+  *
+  *                   ADC1 + DMA1 Channel1: samples pushed with
+  *                   HalSim_AdcPush() are written into the buffer passed to
+  *                   HAL_ADC_Start_DMA() exactly as the circular DMA would,
+  *                   and the half/full transfer callbacks fire at the same
+  *                   points in the stream. Each sample is taken as the
+  *                   result of the oversampler, and one outside the analog
+  *                   watchdog 1 window runs ADC1_2_IRQHandler() when the
+  *                   AWD1 interrupt is enabled. As on the target, the
+  *                   window cannot be changed while ADSTART is set, and
+  *                   nothing is converted while ADC_ConversionStop() has
+  *                   it cleared.
+  *
+  *                   DFSDM1 Filter2 + DMA1 Channel6: HalSim_MicPush() plays
+  *                   the decimated microphone samples, taken as the 16 MSBs
+  *                   HAL_DFSDM_FilterRegularMsbStart_DMA() would store, into
+  *                   its circular buffer with the same half/full transfer
+  *                   callbacks. HalSim_MicRate() gives the output rate the
+  *                   channel clock divider and the filter oversampling
+  *                   set up.
+  *
+  *                   GPIO / EXTI: HalSim_GpioInput() drives an input pin;
+  *                   if the pin was configured in one of the interrupt
+  *                   modes, the matching edge runs HAL_GPIO_EXTI_Callback(),
+  *                   at once or when __enable_irq() unmasks interrupts.
+  *
+  *                   UART: transmitted bytes are captured per instance and
+  *                   read back with HalSim_UartOutput(); HalSim_UartInput()
+  *                   queues bytes for HAL_UART_Receive(). A DMA transmit
+  *                   completes after the time the bytes take on the wire at
+  *                   the configured baud rate.
+  *
+  *                   QSPI: an MX25R6435F kept in RAM, which HalSim_Reset()
+  *                   does not clear, like the real flash across resets.
+  *                   Program only clears bits, erase sets a whole 4 KB
+  *                   sector, memory-mapped reads see the array at QSPI_BASE,
+  *                   and program/erase take their typical time in the
+  *                   status poll. HalSim_QspiPowerCut() lets a test bench
+  *                   cut the power in the middle of a program or erase.
+  *
+  *                   I2C2 + DMA1 Channel5: devices attached with
+  *                   HalSim_I2cAttach() answer transfers started through
+  *                   CR2. Written bytes are taken from TXDR one TXIS at a
+  *                   time, read bytes go straight to the DMA buffer, and
+  *                   an absent address is NACKed. A whole transfer runs
+  *                   within the millisecond it starts in, calling
+  *                   I2C2_EV_IRQHandler() for every enabled event. Devices
+  *                   stay attached across HalSim_Reset(), like the board.
+  *
+  *                   Cycles: the DWT counter advances by a millisecond of
+  *                   HCLK per simulated millisecond the core runs, which
+  *                   is what the power accounting needs. HalSim_Cycles()
+  *                   is the host's monotonic clock in HCLK cycles, which
+  *                   fw_bench times code with; the simulator itself builds
+  *                   app.c with PROFILE_DISABLE.
+  *
+  *                   Low-power modes: Sleep lets one SysTick period pass
+  *                   with the DWT cycle counter frozen. Stop2 lets time run
+  *                   with SysTick and the core stopped until an EXTI edge or
+  *                   the LPTIM1 auto-reload match wakes the MCU. Like the
+  *                   target, it wakes on MSI with every PLL off:
+  *                   SystemClock_Config() brings HCLK back and
+  *                   PeriphCommonClock_Config() PLLSAI1, without which
+  *                   HAL_ADC_Start_DMA() fails.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include <string.h>
+#include <time.h>
+
+/* Private define ------------------------------------------------------------*/
+#define HAL_SIM_HCLK_HZ    80000000U
+#define HAL_SIM_MSI_HZ     4000000U    /* MSI range 6, the Stop2 wake-up clock */
+#define HAL_SIM_LSE_HZ     32768U
+#define HAL_SIM_UART_LEN   4096U       /* power of two */
+#define HAL_SIM_STOP_MAX_MS 4000U      /* longer than any LPTIM1 period */
+#define HAL_SIM_UART_BAUD  115200U
+#define HAL_SIM_QSPI_SIZE  0x800000U
+#define HAL_SIM_QSPI_PAGE  256U
+#define HAL_SIM_QSPI_SECTOR 4096U
+#define HAL_SIM_QSPI_PROGRAM_MS 1U     /* MX25R6435F tPP, rounded up */
+#define HAL_SIM_QSPI_ERASE_MS   40U    /* tSE */
+#define HAL_SIM_QSPI_ERASE_COST 256U   /* power budget of one erase */
+#define HAL_SIM_I2C_DEVICES 8U
+#define HAL_SIM_I2C_TXDR_EMPTY  0x100U /* TXDR not written since TXIS */
+#define HAL_SIM_I2C_EVENTS  64U        /* interrupts per transfer, at most */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  SIM_CORE_RUN = 0,
+  SIM_CORE_SLEEP,
+  SIM_CORE_STOP
+} HalSim_CoreTypeDef;
+
+typedef struct
+{
+  uint8_t data[HAL_SIM_UART_LEN];
+  uint32_t head;
+  uint32_t tail;
+} HalSim_FifoTypeDef;
+
+typedef struct
+{
+  USART_TypeDef *instance;
+  HalSim_FifoTypeDef tx;
+  HalSim_FifoTypeDef rx;
+  UART_HandleTypeDef *dma;          /* transmit DMA in flight */
+  uint32_t dma_done;
+} HalSim_UartTypeDef;
+
+typedef struct
+{
+  HalSim_I2cDeviceTypeDef dev;
+  uint8_t sub;                      /* register address last written */
+} HalSim_I2cSlotTypeDef;
+
+typedef enum
+{
+  SIM_I2C_IDLE = 0,
+  SIM_I2C_TX,
+  SIM_I2C_DONE
+} HalSim_I2cStateTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+__IO uint32_t uwTick;
+HAL_TickFreqTypeDef uwTickFreq = HAL_TICK_FREQ_1KHZ;
+
+GPIO_TypeDef HalSim_GPIOA;
+GPIO_TypeDef HalSim_GPIOB;
+GPIO_TypeDef HalSim_GPIOC;
+GPIO_TypeDef HalSim_GPIOD;
+GPIO_TypeDef HalSim_GPIOE;
+TIM_TypeDef HalSim_TIM6;
+RCC_TypeDef HalSim_RCC;
+DMA_Channel_TypeDef HalSim_DMA1_Channel1;
+DMA_Channel_TypeDef HalSim_DMA1_Channel4;
+DMA_Channel_TypeDef HalSim_DMA1_Channel5;
+DMA_Channel_TypeDef HalSim_DMA1_Channel6;
+DMA_Channel_TypeDef HalSim_DMA1_Channel7;
+DMA_Request_TypeDef HalSim_DMA1_CSELR;
+I2C_TypeDef HalSim_I2C2;
+ADC_TypeDef HalSim_ADC1;
+DFSDM_Channel_TypeDef HalSim_DFSDM1_Channel1;
+DFSDM_Filter_TypeDef HalSim_DFSDM1_Filter2;
+LPTIM_TypeDef HalSim_LPTIM1 = { .ISR = LPTIM_ISR_ARROK };
+EXTI_TypeDef HalSim_EXTI;
+DWT_Type HalSim_DWT;
+CoreDebug_Type HalSim_CoreDebug;
+USART_TypeDef HalSim_USART1;
+USART_TypeDef HalSim_USART2;
+USART_TypeDef HalSim_USART3;
+QUADSPI_TypeDef HalSim_QUADSPI;
+uint8_t HalSim_QspiMemory[HAL_SIM_QSPI_SIZE] __attribute__((aligned(8)));
+uint32_t SystemCoreClock = HAL_SIM_HCLK_HZ;
+
+static uint32_t sim_now;
+static uint32_t sim_lse_acc;
+static HalSim_CoreTypeDef sim_core;
+static uint8_t sim_irq_masked;
+static uint8_t sim_tick_suspended;
+static uint8_t sim_pllsai1_on;      /* ADC1 kernel clock */
+static HalSim_EnvironmentTypeDef sim_env;
+static void *sim_env_ctx;
+static uint32_t sim_env_next;
+static uint32_t sim_uid[3] = { 0x00470035U, 0x3437510FU, 0x20353945U };
+
+/* EXTI line n -> port and trigger mode, as selected through SYSCFG */
+static GPIO_TypeDef *sim_exti_port[16];
+static uint32_t sim_exti_mode[16];
+static uint16_t sim_exti_pending;
+
+static ADC_HandleTypeDef *sim_adc;
+static uint16_t *sim_adc_buf;
+static uint32_t sim_adc_len;
+static uint32_t sim_adc_pos;
+
+static uint32_t sim_dfsdm_divider;  /* CKOUT divider, 0 while de-initialised */
+static uint32_t sim_dfsdm_osr;      /* filter x integrator oversampling */
+static DFSDM_Filter_HandleTypeDef *sim_dfsdm;
+static int16_t *sim_dfsdm_buf;
+static uint32_t sim_dfsdm_len;
+static uint32_t sim_dfsdm_pos;
+
+static HalSim_UartTypeDef sim_uart[3] =
+{
+  { &HalSim_USART1, { {0}, 0U, 0U }, { {0}, 0U, 0U }, NULL, 0U },
+  { &HalSim_USART2, { {0}, 0U, 0U }, { {0}, 0U, 0U }, NULL, 0U },
+  { &HalSim_USART3, { {0}, 0U, 0U }, { {0}, 0U, 0U }, NULL, 0U }
+};
+
+static QSPI_CommandTypeDef sim_qspi_cmd;
+static uint8_t sim_qspi_formatted;
+static uint8_t sim_qspi_status;
+static uint8_t sim_qspi_wel;
+static uint32_t sim_qspi_busy_ms;
+static uint32_t sim_qspi_budget = 0xFFFFFFFFU;
+static uint8_t sim_qspi_powered = 1U;
+static uint32_t sim_qspi_noise = 2463534242U;
+
+static HalSim_I2cSlotTypeDef sim_i2c_dev[HAL_SIM_I2C_DEVICES];
+static HalSim_I2cStateTypeDef sim_i2c_state;
+static HalSim_I2cSlotTypeDef *sim_i2c_slot;
+static uint32_t sim_i2c_left;       /* bytes left in the transfer */
+static uint32_t sim_i2c_n;          /* bytes done */
+static uint32_t sim_i2c_cr2;
+
+/* Private function prototypes -----------------------------------------------*/
+static void HalSim_AdcWatchdog(ADC_TypeDef *adc, uint16_t sample);
+static void HalSim_LptimStep(void);
+static void HalSim_StopSkip(void);
+static void HalSim_LptimIrq(void);
+static void HalSim_ExtiIrq(void);
+static void HalSim_UartIrq(void);
+static HalSim_UartTypeDef *HalSim_Uart(const USART_TypeDef *instance);
+static void HalSim_QspiFormatOnce(void);
+static uint8_t HalSim_QspiSpend(uint32_t cost);
+static uint8_t HalSim_QspiNoise(void);
+static void HalSim_I2cStep(void);
+static uint8_t HalSim_I2cStart(void);
+static void HalSim_I2cEnd(void);
+static uint8_t HalSim_I2cIrq(void);
+
+/* Simulation control --------------------------------------------------------*/
+
+/**
+  * @brief  Return every simulated peripheral to its reset state.
+  * @note   The environment hook is kept.
+  * @retval None
+  */
+void HalSim_Reset(void)
+{
+  uwTick = 0U;
+  sim_now = 0U;
+  sim_lse_acc = 0U;
+  sim_core = SIM_CORE_RUN;
+  sim_irq_masked = 0U;
+  sim_tick_suspended = 0U;
+  sim_env_next = 0U;
+  SystemCoreClock = HAL_SIM_HCLK_HZ;
+  sim_pllsai1_on = 1U;
+
+  memset(&HalSim_GPIOA, 0, sizeof(GPIO_TypeDef));
+  memset(&HalSim_GPIOB, 0, sizeof(GPIO_TypeDef));
+  memset(&HalSim_GPIOC, 0, sizeof(GPIO_TypeDef));
+  memset(&HalSim_GPIOD, 0, sizeof(GPIO_TypeDef));
+  memset(&HalSim_GPIOE, 0, sizeof(GPIO_TypeDef));
+  memset(&HalSim_TIM6, 0, sizeof(TIM_TypeDef));
+  memset(&HalSim_RCC, 0, sizeof(RCC_TypeDef));
+  memset(&HalSim_ADC1, 0, sizeof(ADC_TypeDef));
+  memset(&HalSim_LPTIM1, 0, sizeof(LPTIM_TypeDef));
+  HalSim_LPTIM1.ISR = LPTIM_ISR_ARROK;
+  memset(&HalSim_EXTI, 0, sizeof(EXTI_TypeDef));
+  memset(&HalSim_DWT, 0, sizeof(DWT_Type));
+  memset(&HalSim_CoreDebug, 0, sizeof(CoreDebug_Type));
+  memset(sim_exti_port, 0, sizeof(sim_exti_port));
+  memset(sim_exti_mode, 0, sizeof(sim_exti_mode));
+  sim_exti_pending = 0U;
+
+  sim_adc = NULL;
+  sim_adc_pos = 0U;
+
+  sim_dfsdm_divider = 0U;
+  sim_dfsdm_osr = 0U;
+  sim_dfsdm = NULL;
+  sim_dfsdm_pos = 0U;
+
+  memset(&HalSim_DMA1_Channel5, 0, sizeof(DMA_Channel_TypeDef));
+  memset(&HalSim_DMA1_CSELR, 0, sizeof(DMA_Request_TypeDef));
+  memset(&HalSim_I2C2, 0, sizeof(I2C_TypeDef));
+  sim_i2c_state = SIM_I2C_IDLE;
+
+  for (uint32_t n = 0U; n < 3U; n++)
+  {
+    sim_uart[n].dma = NULL;
+    sim_uart[n].tx.head = sim_uart[n].tx.tail = 0U;
+    sim_uart[n].rx.head = sim_uart[n].rx.tail = 0U;
+  }
+}
+
+/**
+  * @brief  Install the test bench, called once per simulated millisecond
+  *         before SysTick fires, whatever the power mode.
+  * @param  env: hook, or NULL to remove it
+  * @param  ctx: passed back to the hook
+  * @retval None
+  */
+void HalSim_SetEnvironment(HalSim_EnvironmentTypeDef env, void *ctx)
+{
+  sim_env = env;
+  sim_env_ctx = ctx;
+  sim_env_next = 0U;
+}
+
+/**
+  * @brief  Simulated wall-clock time, which keeps running in Stop2.
+  * @retval Milliseconds since HalSim_Reset()
+  */
+uint32_t HalSim_Now(void)
+{
+  return sim_now;
+}
+
+/**
+  * @brief  Host time in cycles of the simulated HCLK, for the profiler.
+  * @retval Cycles since an arbitrary origin, wrapping like CYCCNT
+  */
+uint32_t HalSim_Cycles(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec)
+                    * (HAL_SIM_HCLK_HZ / 1000000U) / 1000U);
+}
+
+/**
+  * @brief  Set the 96-bit unique device ID, to tell simulated boards apart.
+  * @note   Kept across HalSim_Reset().
+  * @retval None
+  */
+void HalSim_SetUid(uint32_t w0, uint32_t w1, uint32_t w2)
+{
+  sim_uid[0] = w0;
+  sim_uid[1] = w1;
+  sim_uid[2] = w2;
+}
+
+uint32_t HAL_GetUIDw0(void)
+{
+  return sim_uid[0];
+}
+
+uint32_t HAL_GetUIDw1(void)
+{
+  return sim_uid[1];
+}
+
+uint32_t HAL_GetUIDw2(void)
+{
+  return sim_uid[2];
+}
+
+/* Time base -----------------------------------------------------------------*/
+__attribute__((weak)) void HAL_IncTick(void)
+{
+  uwTick += (uint32_t)uwTickFreq;
+}
+
+uint32_t HAL_GetTick(void)
+{
+  return uwTick;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+  HalSim_Tick(Delay + 1U);
+}
+
+void HAL_SuspendTick(void)
+{
+  sim_tick_suspended = 1U;
+}
+
+void HAL_ResumeTick(void)
+{
+  sim_tick_suspended = 0U;
+}
+
+/**
+  * @brief  Let simulated time pass.
+  * @param  ms: milliseconds to advance
+  * @retval None
+  */
+void HalSim_Tick(uint32_t ms)
+{
+  while (ms-- != 0U)
+  {
+    sim_now++;
+    if ((sim_core == SIM_CORE_RUN) && ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) != 0U))
+    {
+      DWT->CYCCNT += SystemCoreClock / 1000U;
+    }
+    if (sim_env != NULL)
+    {
+      sim_env_next = sim_env(sim_now, sim_env_ctx);
+    }
+    HalSim_LptimStep();
+    HalSim_UartIrq();
+    HalSim_I2cStep();
+    if ((sim_tick_suspended == 0U) && (sim_core != SIM_CORE_STOP))
+    {
+      HAL_IncTick();
+    }
+  }
+}
+
+/* GPIO ----------------------------------------------------------------------*/
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  return ((GPIOx->IDR & GPIO_Pin) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+  if (PinState != GPIO_PIN_RESET)
+  {
+    GPIOx->ODR |= GPIO_Pin;
+  }
+  else
+  {
+    GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+  }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  GPIOx->ODR ^= GPIO_Pin;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+  for (uint32_t line = 0U; line < 16U; line++)
+  {
+    if ((GPIO_Init->Pin & (1UL << line)) == 0U)
+    {
+      continue;
+    }
+    if ((GPIO_Init->Mode & 0x10000000U) != 0U)
+    {
+      sim_exti_port[line] = GPIOx;
+      sim_exti_mode[line] = GPIO_Init->Mode;
+    }
+    else if (sim_exti_port[line] == GPIOx)
+    {
+      sim_exti_port[line] = NULL;
+    }
+  }
+}
+
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin)
+{
+  HAL_GPIO_EXTI_Callback(GPIO_Pin);
+}
+
+__attribute__((weak)) void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  (void)GPIO_Pin;
+}
+
+/**
+  * @brief  Drive an input pin from the outside world.
+  * @param  GPIOx: port
+  * @param  GPIO_Pin: single pin
+  * @param  PinState: new level
+  * @retval None
+  */
+void HalSim_GpioInput(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+  uint32_t line = 0U;
+  uint32_t old = GPIOx->IDR & GPIO_Pin;
+  uint32_t edge;
+
+  if (PinState != GPIO_PIN_RESET)
+  {
+    GPIOx->IDR |= GPIO_Pin;
+  }
+  else
+  {
+    GPIOx->IDR &= ~(uint32_t)GPIO_Pin;
+  }
+  if (old == (GPIOx->IDR & GPIO_Pin))
+  {
+    return;
+  }
+
+  while ((line < 16U) && (GPIO_Pin != (uint16_t)(1UL << line)))
+  {
+    line++;
+  }
+  if ((line == 16U) || (sim_exti_port[line] != GPIOx))
+  {
+    return;
+  }
+  edge = (PinState != GPIO_PIN_RESET) ? 0x00100000U : 0x00200000U;
+  if ((sim_exti_mode[line] & edge) != 0U)
+  {
+    sim_exti_pending |= GPIO_Pin;
+    HalSim_ExtiIrq();
+  }
+}
+
+/**
+  * @brief  Current level of an output pin.
+  * @param  GPIOx: port
+  * @param  GPIO_Pin: single pin
+  * @retval Pin level last written by the application
+  */
+GPIO_PinState HalSim_GpioOutput(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  return ((GPIOx->ODR & GPIO_Pin) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+/* ADC -----------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc)
+{
+  return (hadc == NULL) ? HAL_ERROR : HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef *hadc, uint32_t SingleDiff)
+{
+  (void)SingleDiff;
+  return (hadc == NULL) ? HAL_ERROR : HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length)
+{
+  if ((hadc == NULL) || (pData == NULL) || (Length < 2U))
+  {
+    return HAL_ERROR;
+  }
+  if (sim_pllsai1_on == 0U)
+  {
+    /* No kernel clock: ADRDY never rises and ADC_Enable() times out */
+    return HAL_ERROR;
+  }
+  hadc->Instance->CR |= ADC_CR_ADSTART;
+  sim_adc = hadc;
+  sim_adc_buf = (uint16_t *)pData;
+  sim_adc_len = Length;
+  sim_adc_pos = 0U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Stop_DMA(ADC_HandleTypeDef *hadc)
+{
+  if (hadc != sim_adc)
+  {
+    return HAL_ERROR;
+  }
+  hadc->Instance->CR &= ~ADC_CR_ADSTART;
+  sim_adc = NULL;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef ADC_ConversionStop(ADC_HandleTypeDef *hadc, uint32_t ConversionGroup)
+{
+  if ((hadc == NULL) || (ConversionGroup != ADC_REGULAR_GROUP))
+  {
+    return HAL_ERROR;
+  }
+  hadc->Instance->CR &= ~ADC_CR_ADSTART;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig)
+{
+  return ((hadc == NULL) || (sConfig == NULL)) ? HAL_ERROR : HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_AnalogWDGConfig(ADC_HandleTypeDef *hadc, ADC_AnalogWDGConfTypeDef *AnalogWDGConfig)
+{
+  if ((hadc == NULL) || (AnalogWDGConfig->WatchdogNumber != ADC_ANALOGWATCHDOG_1)
+      || (AnalogWDGConfig->HighThreshold > 0x0FFFU) || (AnalogWDGConfig->LowThreshold > 0x0FFFU))
+  {
+    return HAL_ERROR;
+  }
+  if ((hadc->Instance->CR & ADC_CR_ADSTART) != 0U)
+  {
+    /* HAL_ADC_STATE_ERROR_CONFIG: TR1 and AWD1CH are write-protected */
+    return HAL_ERROR;
+  }
+  hadc->Instance->CFGR = (hadc->Instance->CFGR & ~ADC_ANALOGWATCHDOG_SINGLE_REG) | AnalogWDGConfig->WatchdogMode;
+  hadc->Instance->TR1 = AnalogWDGConfig->LowThreshold | (AnalogWDGConfig->HighThreshold << ADC_TR1_HT1_Pos);
+  if (AnalogWDGConfig->ITMode == ENABLE)
+  {
+    __HAL_ADC_ENABLE_IT(hadc, ADC_IT_AWD1);
+  }
+  else
+  {
+    __HAL_ADC_DISABLE_IT(hadc, ADC_IT_AWD1);
+  }
+  return HAL_OK;
+}
+
+void HAL_ADC_IRQHandler(ADC_HandleTypeDef *hadc)
+{
+  if (((hadc->Instance->ISR & ADC_FLAG_AWD1) != 0U) && ((hadc->Instance->IER & ADC_IT_AWD1) != 0U))
+  {
+    HAL_ADC_LevelOutOfWindowCallback(hadc);
+    __HAL_ADC_CLEAR_FLAG(hadc, ADC_FLAG_AWD1);
+  }
+}
+
+__attribute__((weak)) void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef *hadc)
+{
+  (void)hadc;
+}
+
+__attribute__((weak)) void ADC1_2_IRQHandler(void)
+{
+}
+
+__attribute__((weak)) void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+  (void)hadc;
+}
+
+__attribute__((weak)) void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+  (void)hadc;
+}
+
+/**
+  * @brief  Feed conversions into the running DMA transfer.
+  * @note   Samples are dropped while the transfer, the TIM6 trigger or
+  *         the regular conversions are stopped, as they would never be
+  *         converted on the target.
+  * @param  samples: 12-bit ADC values in conversion order
+  * @param  count: number of samples
+  * @retval None
+  */
+void HalSim_AdcPush(const uint16_t *samples, uint32_t count)
+{
+  for (uint32_t n = 0U; n < count; n++)
+  {
+    if ((sim_adc == NULL) || ((TIM6->CR1 & TIM_CR1_CEN) == 0U))
+    {
+      return;
+    }
+    if ((sim_adc->Instance->CR & ADC_CR_ADSTART) == 0U)
+    {
+      continue;
+    }
+    sim_adc_buf[sim_adc_pos++] = samples[n];
+    HalSim_AdcWatchdog(sim_adc->Instance, samples[n]);
+    if (sim_adc_pos == (sim_adc_len / 2U))
+    {
+      HAL_ADC_ConvHalfCpltCallback(sim_adc);
+    }
+    else if (sim_adc_pos == sim_adc_len)
+    {
+      sim_adc_pos = 0U;
+      HAL_ADC_ConvCpltCallback(sim_adc);
+    }
+  }
+}
+
+/* AWD1: flag a result outside [LT1, HT1] and interrupt if enabled */
+static void HalSim_AdcWatchdog(ADC_TypeDef *adc, uint16_t sample)
+{
+  uint32_t low = adc->TR1 & 0x0FFFU;
+  uint32_t high = (adc->TR1 >> ADC_TR1_HT1_Pos) & 0x0FFFU;
+
+  if (((adc->CFGR & ADC_CFGR_AWD1EN) == 0U) || ((sample >= low) && (sample <= high)))
+  {
+    return;
+  }
+  adc->ISR |= ADC_ISR_AWD1;
+  if ((adc->IER & ADC_IER_AWD1IE) != 0U)
+  {
+    ADC1_2_IRQHandler();
+  }
+}
+
+/**
+  * @brief  Index of the next buffer element the DMA will write.
+  * @retval Position in the circular buffer
+  */
+uint32_t HalSim_AdcDmaPosition(void)
+{
+  return sim_adc_pos;
+}
+
+/* DFSDM ---------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_DFSDM_ChannelInit(DFSDM_Channel_HandleTypeDef *hdfsdm_channel)
+{
+  /* CKOUTDIV is 8 bits and the data register keeps 24 of the 32 bits */
+  if ((hdfsdm_channel == NULL) || (hdfsdm_channel->Init.OutputClock.Divider < 2U)
+      || (hdfsdm_channel->Init.OutputClock.Divider > 256U) || (hdfsdm_channel->Init.RightBitShift > 31U))
+  {
+    return HAL_ERROR;
+  }
+  sim_dfsdm_divider = hdfsdm_channel->Init.OutputClock.Divider;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DFSDM_ChannelDeInit(DFSDM_Channel_HandleTypeDef *hdfsdm_channel)
+{
+  if (hdfsdm_channel == NULL)
+  {
+    return HAL_ERROR;
+  }
+  sim_dfsdm_divider = 0U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DFSDM_FilterInit(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
+{
+  const DFSDM_Filter_FilterParamTypeDef *param;
+
+  if (hdfsdm_filter == NULL)
+  {
+    return HAL_ERROR;
+  }
+  param = &hdfsdm_filter->Init.FilterParam;
+  if ((param->Oversampling == 0U) || (param->Oversampling > 1024U) || (param->IntOversampling == 0U)
+      || (param->IntOversampling > 256U) || (param->SincOrder > DFSDM_FILTER_SINC5_ORDER))
+  {
+    return HAL_ERROR;
+  }
+  sim_dfsdm_osr = param->Oversampling * param->IntOversampling;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DFSDM_FilterConfigRegChannel(DFSDM_Filter_HandleTypeDef *hdfsdm_filter,
+                                                   uint32_t Channel, uint32_t ContinuousMode)
+{
+  if ((hdfsdm_filter == NULL) || (Channel != DFSDM_CHANNEL_1))
+  {
+    return HAL_ERROR;
+  }
+  hdfsdm_filter->RegularContMode = ContinuousMode;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DFSDM_FilterRegularMsbStart_DMA(DFSDM_Filter_HandleTypeDef *hdfsdm_filter,
+                                                      int16_t *pData, uint32_t Length)
+{
+  /* the HAL rejects anything but a halfword DMA, and a circular one
+     needs continuous conversions */
+  if ((hdfsdm_filter == NULL) || (pData == NULL) || (Length < 2U) || (hdfsdm_filter->hdmaReg == NULL)
+      || (hdfsdm_filter->hdmaReg->Init.MemDataAlignment != DMA_MDATAALIGN_HALFWORD)
+      || ((hdfsdm_filter->hdmaReg->Init.Mode == DMA_CIRCULAR)
+          && (hdfsdm_filter->RegularContMode != DFSDM_CONTINUOUS_CONV_ON))
+      || (sim_dfsdm_divider == 0U) || (sim_dfsdm_osr == 0U))
+  {
+    return HAL_ERROR;
+  }
+  sim_dfsdm = hdfsdm_filter;
+  sim_dfsdm_buf = pData;
+  sim_dfsdm_len = Length;
+  sim_dfsdm_pos = 0U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DFSDM_FilterRegularStop_DMA(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
+{
+  if (hdfsdm_filter != sim_dfsdm)
+  {
+    return HAL_ERROR;
+  }
+  sim_dfsdm = NULL;
+  return HAL_OK;
+}
+
+__attribute__((weak)) void HAL_DFSDM_FilterRegConvHalfCpltCallback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
+{
+  (void)hdfsdm_filter;
+}
+
+__attribute__((weak)) void HAL_DFSDM_FilterRegConvCpltCallback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
+{
+  (void)hdfsdm_filter;
+}
+
+/**
+  * @brief  Feed decimated microphone samples into the running DMA transfer.
+  * @note   Samples are dropped while the filter is stopped.
+  * @param  samples: filter output in conversion order
+  * @param  count: number of samples
+  * @retval None
+  */
+void HalSim_MicPush(const int16_t *samples, uint32_t count)
+{
+  for (uint32_t n = 0U; n < count; n++)
+  {
+    if (sim_dfsdm == NULL)
+    {
+      return;
+    }
+    sim_dfsdm_buf[sim_dfsdm_pos++] = samples[n];
+    if (sim_dfsdm_pos == (sim_dfsdm_len / 2U))
+    {
+      HAL_DFSDM_FilterRegConvHalfCpltCallback(sim_dfsdm);
+    }
+    else if (sim_dfsdm_pos == sim_dfsdm_len)
+    {
+      sim_dfsdm_pos = 0U;
+      HAL_DFSDM_FilterRegConvCpltCallback(sim_dfsdm);
+    }
+  }
+}
+
+/**
+  * @brief  Conversion rate set by the channel clock and the filter.
+  * @retval Samples per second, 0 until both are initialised
+  */
+uint32_t HalSim_MicRate(void)
+{
+  if ((sim_dfsdm_divider == 0U) || (sim_dfsdm_osr == 0U))
+  {
+    return 0U;
+  }
+  return HAL_SIM_HCLK_HZ / (sim_dfsdm_divider * sim_dfsdm_osr);
+}
+
+/* UART ----------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  HalSim_UartTypeDef *uart;
+
+  (void)Timeout;
+  if ((huart == NULL) || (pData == NULL) || ((uart = HalSim_Uart(huart->Instance)) == NULL))
+  {
+    return HAL_ERROR;
+  }
+  for (uint32_t n = 0U; n < Size; n++)
+  {
+    if ((uart->tx.head - uart->tx.tail) == HAL_SIM_UART_LEN)
+    {
+      /* Nobody reads the line: keep the newest bytes */
+      uart->tx.tail++;
+    }
+    uart->tx.data[uart->tx.head++ & (HAL_SIM_UART_LEN - 1U)] = pData[n];
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  HalSim_UartTypeDef *uart;
+
+  (void)Timeout;
+  if ((huart == NULL) || (pData == NULL) || ((uart = HalSim_Uart(huart->Instance)) == NULL))
+  {
+    return HAL_ERROR;
+  }
+  if ((uart->rx.head - uart->rx.tail) < Size)
+  {
+    return HAL_TIMEOUT;
+  }
+  for (uint32_t n = 0U; n < Size; n++)
+  {
+    pData[n] = uart->rx.data[uart->rx.tail++ & (HAL_SIM_UART_LEN - 1U)];
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+  HalSim_UartTypeDef *uart;
+  uint32_t baud;
+
+  if ((huart == NULL) || ((uart = HalSim_Uart(huart->Instance)) == NULL))
+  {
+    return HAL_ERROR;
+  }
+  if (uart->dma != NULL)
+  {
+    return HAL_BUSY;
+  }
+  if ((Size == 0U) || (HAL_UART_Transmit(huart, pData, Size, 0U) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  /* 10 bits per byte on the wire, complete at the end of the millisecond */
+  baud = (huart->Init.BaudRate != 0U) ? huart->Init.BaudRate : HAL_SIM_UART_BAUD;
+  uart->dma = huart;
+  uart->dma_done = sim_now + (((uint32_t)Size * 10000U) + baud - 1U) / baud;
+  return HAL_OK;
+}
+
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart)
+{
+  (void)huart;
+}
+
+__attribute__((weak)) void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  (void)huart;
+}
+
+static void HalSim_UartIrq(void)
+{
+  if ((sim_irq_masked != 0U) || (sim_core == SIM_CORE_STOP))
+  {
+    return;
+  }
+  for (uint32_t n = 0U; n < 3U; n++)
+  {
+    UART_HandleTypeDef *huart = sim_uart[n].dma;
+
+    if ((huart != NULL) && ((int32_t)(sim_now - sim_uart[n].dma_done) >= 0))
+    {
+      sim_uart[n].dma = NULL;
+      HAL_UART_TxCpltCallback(huart);
+    }
+  }
+}
+
+/**
+  * @brief  Queue bytes on the RX line of a UART.
+  * @param  instance: USART1 .. USART3
+  * @param  data: bytes
+  * @param  count: number of bytes
+  * @retval Number of bytes queued
+  */
+uint32_t HalSim_UartInput(USART_TypeDef *instance, const uint8_t *data, uint32_t count)
+{
+  HalSim_UartTypeDef *uart = HalSim_Uart(instance);
+  uint32_t n = 0U;
+
+  while ((uart != NULL) && (n < count) && ((uart->rx.head - uart->rx.tail) < HAL_SIM_UART_LEN))
+  {
+    uart->rx.data[uart->rx.head++ & (HAL_SIM_UART_LEN - 1U)] = data[n++];
+  }
+  return n;
+}
+
+/**
+  * @brief  Collect the bytes the application transmitted on a UART.
+  * @param  instance: USART1 .. USART3
+  * @param  data: destination
+  * @param  max: size of the destination
+  * @retval Number of bytes copied
+  */
+uint32_t HalSim_UartOutput(USART_TypeDef *instance, uint8_t *data, uint32_t max)
+{
+  HalSim_UartTypeDef *uart = HalSim_Uart(instance);
+  uint32_t n = 0U;
+
+  while ((uart != NULL) && (n < max) && (uart->tx.tail != uart->tx.head))
+  {
+    data[n++] = uart->tx.data[uart->tx.tail++ & (HAL_SIM_UART_LEN - 1U)];
+  }
+  return n;
+}
+
+static HalSim_UartTypeDef *HalSim_Uart(const USART_TypeDef *instance)
+{
+  for (uint32_t n = 0U; n < 3U; n++)
+  {
+    if (sim_uart[n].instance == instance)
+    {
+      return &sim_uart[n];
+    }
+  }
+  return NULL;
+}
+
+/* QSPI ----------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_QSPI_Command(QSPI_HandleTypeDef *hqspi, QSPI_CommandTypeDef *cmd, uint32_t Timeout)
+{
+  (void)Timeout;
+  if ((hqspi == NULL) || (cmd == NULL))
+  {
+    return HAL_ERROR;
+  }
+  HalSim_QspiFormatOnce();
+  sim_qspi_cmd = *cmd;
+  if (cmd->DataMode != QSPI_DATA_NONE)
+  {
+    return HAL_OK;
+  }
+
+  switch (cmd->Instruction)
+  {
+    case 0x06U:   /* write enable */
+      sim_qspi_wel = 1U;
+      break;
+    case 0x04U:   /* write disable */
+    case 0x99U:   /* reset */
+      sim_qspi_wel = 0U;
+      break;
+    case 0x20U:   /* sector erase */
+      if ((sim_qspi_wel != 0U) && (cmd->Address < HAL_SIM_QSPI_SIZE))
+      {
+        uint8_t *sector = &HalSim_QspiMemory[cmd->Address & ~(HAL_SIM_QSPI_SECTOR - 1U)];
+        uint8_t powered = sim_qspi_powered;
+
+        if (HalSim_QspiSpend(HAL_SIM_QSPI_ERASE_COST) != 0U)
+        {
+          memset(sector, 0xFF, HAL_SIM_QSPI_SECTOR);
+        }
+        else if (powered != 0U)
+        {
+          /* Cut mid-erase: every bit is somewhere on its way to 1 */
+          for (uint32_t n = 0U; n < HAL_SIM_QSPI_SECTOR; n++)
+          {
+            sector[n] |= HalSim_QspiNoise();
+          }
+        }
+        sim_qspi_busy_ms = HAL_SIM_QSPI_ERASE_MS;
+      }
+      sim_qspi_wel = 0U;
+      break;
+    default:
+      break;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_Transmit(QSPI_HandleTypeDef *hqspi, uint8_t *pData, uint32_t Timeout)
+{
+  const QSPI_CommandTypeDef *cmd = &sim_qspi_cmd;
+
+  (void)Timeout;
+  if ((hqspi == NULL) || (pData == NULL))
+  {
+    return HAL_ERROR;
+  }
+  if ((cmd->Instruction == 0x01U) && (sim_qspi_wel != 0U))
+  {
+    sim_qspi_status = pData[0] & 0xFCU;
+  }
+  else if (((cmd->Instruction == 0x02U) || (cmd->Instruction == 0x38U)) && (sim_qspi_wel != 0U)
+           && (cmd->Address < HAL_SIM_QSPI_SIZE))
+  {
+    /* Page program: bits go 1 -> 0, addresses wrap inside the page */
+    uint32_t page = cmd->Address & ~(HAL_SIM_QSPI_PAGE - 1U);
+    uint32_t off = cmd->Address - page;
+    uint8_t powered = sim_qspi_powered;
+
+    for (uint32_t n = 0U; n < cmd->NbData; n++)
+    {
+      uint8_t *cell = &HalSim_QspiMemory[page + ((off + n) & (HAL_SIM_QSPI_PAGE - 1U))];
+
+      if (HalSim_QspiSpend(1U) != 0U)
+      {
+        *cell &= pData[n];
+      }
+      else
+      {
+        /* Cut mid-program: the byte being written is half done */
+        if (powered != 0U)
+        {
+          *cell &= (uint8_t)(pData[n] | HalSim_QspiNoise());
+        }
+        break;
+      }
+    }
+    sim_qspi_busy_ms = HAL_SIM_QSPI_PROGRAM_MS;
+  }
+  sim_qspi_wel = 0U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_Receive(QSPI_HandleTypeDef *hqspi, uint8_t *pData, uint32_t Timeout)
+{
+  const QSPI_CommandTypeDef *cmd = &sim_qspi_cmd;
+
+  (void)Timeout;
+  if ((hqspi == NULL) || (pData == NULL))
+  {
+    return HAL_ERROR;
+  }
+  if (cmd->Instruction == 0x05U)
+  {
+    pData[0] = (uint8_t)(sim_qspi_status | (sim_qspi_wel << 1));
+  }
+  else if ((cmd->Address < HAL_SIM_QSPI_SIZE) && (cmd->NbData <= (HAL_SIM_QSPI_SIZE - cmd->Address)))
+  {
+    memcpy(pData, &HalSim_QspiMemory[cmd->Address], cmd->NbData);
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_AutoPolling(QSPI_HandleTypeDef *hqspi, QSPI_CommandTypeDef *cmd,
+                                       QSPI_AutoPollingTypeDef *cfg, uint32_t Timeout)
+{
+  uint8_t status;
+
+  (void)cmd;
+  if ((hqspi == NULL) || (cfg == NULL))
+  {
+    return HAL_ERROR;
+  }
+  /* The operation in progress completes while the controller polls */
+  if (sim_qspi_busy_ms != 0U)
+  {
+    if (sim_qspi_busy_ms > Timeout)
+    {
+      return HAL_TIMEOUT;
+    }
+    HalSim_Tick(sim_qspi_busy_ms);
+    sim_qspi_busy_ms = 0U;
+  }
+  status = (uint8_t)(sim_qspi_status | (sim_qspi_wel << 1));
+  return ((status & cfg->Mask) == cfg->Match) ? HAL_OK : HAL_TIMEOUT;
+}
+
+HAL_StatusTypeDef HAL_QSPI_MemoryMapped(QSPI_HandleTypeDef *hqspi, QSPI_CommandTypeDef *cmd,
+                                        QSPI_MemoryMappedTypeDef *cfg)
+{
+  if ((hqspi == NULL) || (cmd == NULL) || (cfg == NULL))
+  {
+    return HAL_ERROR;
+  }
+  HalSim_QspiFormatOnce();
+  hqspi->Instance->CR |= 1U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_QSPI_Abort(QSPI_HandleTypeDef *hqspi)
+{
+  if (hqspi == NULL)
+  {
+    return HAL_ERROR;
+  }
+  HalSim_QspiFormatOnce();
+  hqspi->Instance->CR &= ~1U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Erase the whole simulated flash, as shipped from the factory.
+  * @retval None
+  */
+void HalSim_QspiFormat(void)
+{
+  memset(HalSim_QspiMemory, 0xFF, sizeof(HalSim_QspiMemory));
+  sim_qspi_formatted = 1U;
+}
+
+/**
+  * @brief  Arm a power failure of the flash: after budget programmed bytes
+  *         (an erase counts as HAL_SIM_QSPI_ERASE_COST) the operation in
+  *         progress is cut short and later ones are ignored, as if the
+  *         board had lost power. Pass 0xFFFFFFFF to restore the power.
+  * @param  budget: bytes programmed before the cut
+  * @retval None
+  */
+void HalSim_QspiPowerCut(uint32_t budget)
+{
+  sim_qspi_budget = budget;
+  sim_qspi_powered = 1U;
+}
+
+/**
+  * @brief  Whether the armed power failure has happened yet.
+  * @retval 1 while powered, 0 after the cut
+  */
+uint8_t HalSim_QspiPowered(void)
+{
+  return sim_qspi_powered;
+}
+
+static void HalSim_QspiFormatOnce(void)
+{
+  if (sim_qspi_formatted == 0U)
+  {
+    HalSim_QspiFormat();
+  }
+}
+
+/* Take cost from the power budget; 0 once the power is gone */
+static uint8_t HalSim_QspiSpend(uint32_t cost)
+{
+  if (sim_qspi_budget == 0xFFFFFFFFU)
+  {
+    return 1U;
+  }
+  if ((sim_qspi_powered == 0U) || (sim_qspi_budget < cost))
+  {
+    sim_qspi_powered = 0U;
+    return 0U;
+  }
+  sim_qspi_budget -= cost;
+  return 1U;
+}
+
+/* xorshift32 bits for half-done cells */
+static uint8_t HalSim_QspiNoise(void)
+{
+  sim_qspi_noise ^= sim_qspi_noise << 13;
+  sim_qspi_noise ^= sim_qspi_noise >> 17;
+  sim_qspi_noise ^= sim_qspi_noise << 5;
+  return (uint8_t)sim_qspi_noise;
+}
+
+/* I2C -----------------------------------------------------------------------*/
+__attribute__((weak)) void I2C2_EV_IRQHandler(void)
+{
+  I2C2->ICR = I2C2->ISR;
+}
+
+__attribute__((weak)) void I2C2_ER_IRQHandler(void)
+{
+}
+
+/**
+  * @brief  Put a device on the I2C2 bus.
+  * @param  device: copied; an attached address is replaced
+  * @retval HAL_ERROR when the bus is full
+  */
+HAL_StatusTypeDef HalSim_I2cAttach(const HalSim_I2cDeviceTypeDef *device)
+{
+  HalSim_I2cSlotTypeDef *free_slot = NULL;
+
+  for (uint32_t n = 0U; n < HAL_SIM_I2C_DEVICES; n++)
+  {
+    HalSim_I2cSlotTypeDef *slot = &sim_i2c_dev[n];
+
+    if ((slot->dev.read != NULL) && (slot->dev.address == device->address))
+    {
+      free_slot = slot;
+      break;
+    }
+    if ((slot->dev.read == NULL) && (free_slot == NULL))
+    {
+      free_slot = slot;
+    }
+  }
+  if (free_slot == NULL)
+  {
+    return HAL_ERROR;
+  }
+  free_slot->dev = *device;
+  free_slot->sub = 0U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Take a device off the bus; its address is NACKed from then on.
+  * @param  address: 7-bit address
+  * @retval None
+  */
+void HalSim_I2cDetach(uint8_t address)
+{
+  for (uint32_t n = 0U; n < HAL_SIM_I2C_DEVICES; n++)
+  {
+    if ((sim_i2c_dev[n].dev.read != NULL) && (sim_i2c_dev[n].dev.address == address))
+    {
+      memset(&sim_i2c_dev[n], 0, sizeof(sim_i2c_dev[n]));
+    }
+  }
+}
+
+/* Run the bus until it waits on the firmware or goes idle */
+static void HalSim_I2cStep(void)
+{
+  if ((sim_irq_masked != 0U) || (sim_core == SIM_CORE_STOP))
+  {
+    return;
+  }
+  if ((I2C2->CR1 & I2C_CR1_PE) == 0U)
+  {
+    /* PE low resets the state machine and the flags */
+    sim_i2c_state = SIM_I2C_IDLE;
+    I2C2->ISR = 0U;
+    I2C2->CR2 &= ~I2C_CR2_START;
+    return;
+  }
+  for (uint32_t guard = 0U; guard < HAL_SIM_I2C_EVENTS; guard++)
+  {
+    uint8_t moved = 0U;
+
+    if ((I2C2->CR2 & I2C_CR2_START) != 0U)
+    {
+      moved = HalSim_I2cStart();
+    }
+    else if ((sim_i2c_state == SIM_I2C_TX) && ((I2C2->ISR & I2C_ISR_TXIS) != 0U)
+             && (I2C2->TXDR != HAL_SIM_I2C_TXDR_EMPTY))
+    {
+      uint8_t value = (uint8_t)I2C2->TXDR;
+
+      I2C2->ISR &= ~I2C_ISR_TXIS;
+      if (sim_i2c_n == 0U)
+      {
+        sim_i2c_slot->sub = value;
+      }
+      else
+      {
+        sim_i2c_slot->dev.write(sim_i2c_slot->dev.ctx, sim_i2c_slot->sub, sim_i2c_n - 1U, value);
+      }
+      sim_i2c_n++;
+      if (--sim_i2c_left != 0U)
+      {
+        I2C2->TXDR = HAL_SIM_I2C_TXDR_EMPTY;
+        I2C2->ISR |= I2C_ISR_TXIS;
+      }
+      else
+      {
+        HalSim_I2cEnd();
+      }
+      moved = 1U;
+    }
+    if ((HalSim_I2cIrq() == 0U) && (moved == 0U))
+    {
+      return;
+    }
+  }
+}
+
+/* START written to CR2: address the device, move the data of a read */
+static uint8_t HalSim_I2cStart(void)
+{
+  uint8_t address = (uint8_t)((I2C2->CR2 & I2C_CR2_SADD) >> 1);
+
+  sim_i2c_cr2 = I2C2->CR2;
+  I2C2->CR2 &= ~I2C_CR2_START;
+  I2C2->ISR &= ~(I2C_ISR_TC | I2C_ISR_TXIS);
+  sim_i2c_left = (sim_i2c_cr2 & I2C_CR2_NBYTES) >> I2C_CR2_NBYTES_Pos;
+  sim_i2c_n = 0U;
+  sim_i2c_slot = NULL;
+  for (uint32_t n = 0U; n < HAL_SIM_I2C_DEVICES; n++)
+  {
+    if ((sim_i2c_dev[n].dev.read != NULL) && (sim_i2c_dev[n].dev.address == address))
+    {
+      sim_i2c_slot = &sim_i2c_dev[n];
+    }
+  }
+  if (sim_i2c_slot == NULL)
+  {
+    /* Nobody acknowledged: NACK, then the automatic STOP */
+    sim_i2c_state = SIM_I2C_IDLE;
+    I2C2->ISR |= I2C_ISR_NACKF | I2C_ISR_STOPF;
+    return 1U;
+  }
+  if ((sim_i2c_cr2 & I2C_CR2_RD_WRN) == 0U)
+  {
+    sim_i2c_state = SIM_I2C_TX;
+    if (sim_i2c_left != 0U)
+    {
+      I2C2->TXDR = HAL_SIM_I2C_TXDR_EMPTY;
+      I2C2->ISR |= I2C_ISR_TXIS;
+    }
+    else
+    {
+      HalSim_I2cEnd();
+    }
+    return 1U;
+  }
+
+  /* Reads are only served through DMA1 Channel5, request 3 */
+  while (sim_i2c_left != 0U)
+  {
+    DMA_Channel_TypeDef *dma = DMA1_Channel5;
+    uint8_t value = sim_i2c_slot->dev.read(sim_i2c_slot->dev.ctx, sim_i2c_slot->sub, sim_i2c_n);
+
+    if (((I2C2->CR1 & I2C_CR1_RXDMAEN) == 0U) || ((dma->CCR & DMA_CCR_EN) == 0U) || (dma->CNDTR == 0U)
+        || (((DMA1_CSELR->CSELR & DMA_CSELR_C5S) >> DMA_CSELR_C5S_Pos) != 3U))
+    {
+      /* Nobody takes RXDR: the bus stalls with RXNE set */
+      I2C2->RXDR = value;
+      I2C2->ISR |= I2C_ISR_RXNE;
+      sim_i2c_state = SIM_I2C_IDLE;
+      return 1U;
+    }
+    ((uint8_t *)dma->CMAR)[sim_i2c_n] = value;
+    dma->CNDTR--;
+    sim_i2c_n++;
+    sim_i2c_left--;
+  }
+  HalSim_I2cEnd();
+  return 1U;
+}
+
+/* NBYTES done: STOP with AUTOEND, otherwise wait in TC for a restart */
+static void HalSim_I2cEnd(void)
+{
+  sim_i2c_state = SIM_I2C_DONE;
+  I2C2->ISR |= ((sim_i2c_cr2 & I2C_CR2_AUTOEND) != 0U) ? I2C_ISR_STOPF : I2C_ISR_TC;
+}
+
+/* Event interrupt while an enabled flag is up */
+static uint8_t HalSim_I2cIrq(void)
+{
+  uint32_t enabled = 0U;
+
+  if ((I2C2->CR1 & I2C_CR1_TXIE) != 0U)
+  {
+    enabled |= I2C_ISR_TXIS;
+  }
+  if ((I2C2->CR1 & I2C_CR1_NACKIE) != 0U)
+  {
+    enabled |= I2C_ISR_NACKF;
+  }
+  if ((I2C2->CR1 & I2C_CR1_STOPIE) != 0U)
+  {
+    enabled |= I2C_ISR_STOPF;
+  }
+  if ((I2C2->CR1 & I2C_CR1_TCIE) != 0U)
+  {
+    enabled |= I2C_ISR_TC;
+  }
+  if ((I2C2->ISR & enabled) == 0U)
+  {
+    return 0U;
+  }
+  I2C2->ICR = 0U;
+  I2C2_EV_IRQHandler();
+  /* ICR is write-1-to-clear on the target */
+  I2C2->ISR &= ~(I2C2->ICR & (I2C_ISR_NACKF | I2C_ISR_STOPF | I2C_ISR_BERR | I2C_ISR_ARLO | I2C_ISR_OVR));
+  I2C2->ICR = 0U;
+  return 1U;
+}
+
+/* DMA -----------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+  return (hdma == NULL) ? HAL_ERROR : HAL_OK;
+}
+
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+  (void)hdma;
+}
+
+/* Cortex / RCC --------------------------------------------------------------*/
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+  (void)IRQn;
+  (void)PreemptPriority;
+  (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+  (void)IRQn;
+}
+
+/* HCLK through the APB1 prescaler: 0xx undivided, 1xx /2 .. /16 */
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+  uint32_t ppre1 = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;
+
+  return (ppre1 < 4U) ? HAL_SIM_HCLK_HZ : (HAL_SIM_HCLK_HZ >> (ppre1 - 3U));
+}
+
+__attribute__((weak)) void SystemClock_Config(void)
+{
+  SystemCoreClock = HAL_SIM_HCLK_HZ;
+}
+
+__attribute__((weak)) void PeriphCommonClock_Config(void)
+{
+  sim_pllsai1_on = 1U;
+}
+
+void HalSim_IrqDisable(void)
+{
+  sim_irq_masked = 1U;
+}
+
+void HalSim_IrqEnable(void)
+{
+  sim_irq_masked = 0U;
+  HalSim_ExtiIrq();
+  HalSim_LptimIrq();
+  HalSim_UartIrq();
+  HalSim_I2cStep();
+}
+
+static void HalSim_ExtiIrq(void)
+{
+  if ((sim_irq_masked != 0U) || (sim_core == SIM_CORE_STOP))
+  {
+    return;
+  }
+  while (sim_exti_pending != 0U)
+  {
+    uint16_t pin = sim_exti_pending & (uint16_t)(-sim_exti_pending);
+
+    sim_exti_pending &= (uint16_t)~pin;
+    HAL_GPIO_EXTI_IRQHandler(pin);
+  }
+}
+
+/* LPTIM ---------------------------------------------------------------------*/
+__attribute__((weak)) void LPTIM1_IRQHandler(void)
+{
+  LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+}
+
+/* One millisecond of LSE cycles; ARRM is raised on the wrap to zero */
+static void HalSim_LptimStep(void)
+{
+  uint32_t ticks;
+  uint32_t left;
+
+  if ((LPTIM1->CR & LPTIM_CR_CNTSTRT) == 0U)
+  {
+    return;
+  }
+  sim_lse_acc += HAL_SIM_LSE_HZ;
+  ticks = sim_lse_acc / 1000U;
+  sim_lse_acc -= ticks * 1000U;
+  left = LPTIM1->ARR - LPTIM1->CNT + 1U;
+  if (ticks >= left)
+  {
+    LPTIM1->CNT = (ticks - left) % (LPTIM1->ARR + 1U);
+    LPTIM1->ISR |= LPTIM_ISR_ARRM;
+  }
+  else
+  {
+    LPTIM1->CNT += ticks;
+  }
+  HalSim_LptimIrq();
+}
+
+static void HalSim_LptimIrq(void)
+{
+  if ((sim_irq_masked != 0U) || (sim_core == SIM_CORE_STOP))
+  {
+    return;
+  }
+  if (((LPTIM1->IER & LPTIM_IER_ARRMIE) != 0U) && ((LPTIM1->ISR & LPTIM_ISR_ARRM) != 0U))
+  {
+    LPTIM1->ICR = 0U;
+    LPTIM1_IRQHandler();
+    /* ICR is write-1-to-clear on the target */
+    LPTIM1->ISR &= ~(LPTIM1->ICR & LPTIM_ISR_ARRM);
+    LPTIM1->ICR = 0U;
+  }
+}
+
+/* PWR -----------------------------------------------------------------------*/
+void HAL_PWR_EnterSLEEPMode(uint32_t Regulator, uint8_t SLEEPEntry)
+{
+  (void)Regulator;
+  (void)SLEEPEntry;
+  sim_core = SIM_CORE_SLEEP;
+  HalSim_Tick(1U);
+  sim_core = SIM_CORE_RUN;
+}
+
+void HAL_PWREx_EnterSTOP2Mode(uint8_t STOPEntry)
+{
+  uint32_t ms = 0U;
+
+  (void)STOPEntry;
+  sim_core = SIM_CORE_STOP;
+  while ((sim_exti_pending == 0U) && ((LPTIM1->ISR & LPTIM_ISR_ARRM) == 0U) && (ms < HAL_SIM_STOP_MAX_MS))
+  {
+    uint32_t before = sim_now;
+
+    HalSim_StopSkip();
+    HalSim_Tick(1U);
+    ms += sim_now - before;
+  }
+  sim_core = SIM_CORE_RUN;
+  SystemCoreClock = HAL_SIM_MSI_HZ;
+  sim_pllsai1_on = 0U;
+}
+
+/* Nothing is sampled in Stop2: jump to the millisecond before the next
+   environment event or LPTIM1 match instead of stepping through it */
+static void HalSim_StopSkip(void)
+{
+  uint32_t skip = (sim_env_next > sim_now) ? (sim_env_next - sim_now - 1U) : 0U;
+  uint32_t ticks;
+
+  if (skip > HAL_SIM_STOP_MAX_MS)
+  {
+    skip = HAL_SIM_STOP_MAX_MS;
+  }
+  if ((LPTIM1->CR & LPTIM_CR_CNTSTRT) != 0U)
+  {
+    uint32_t left = ((LPTIM1->ARR - LPTIM1->CNT + 1U) * 1000U) - sim_lse_acc;
+    uint32_t to_match = (left + HAL_SIM_LSE_HZ - 1U) / HAL_SIM_LSE_HZ;
+
+    if (skip >= to_match)
+    {
+      skip = to_match - 1U;
+    }
+    sim_lse_acc += skip * HAL_SIM_LSE_HZ;
+    ticks = sim_lse_acc / 1000U;
+    sim_lse_acc -= ticks * 1000U;
+    LPTIM1->CNT += ticks;
+  }
+  sim_now += skip;
+}
@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file           : hal_sim.h
+  * @brief          : Header for hal_sim.c file.
+  *                   Hooks used on the host to drive the simulated
+  *                   peripherals the way the hardware would.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HAL_SIM_H
+#define __HAL_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32l4xx_hal.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Test bench hook, run with the wall-clock time. Returns the next time it
+   has something to apply, HAL_MAX_DELAY when done. It is called every
+   millisecond while the core runs or sleeps; in Stop2, where nothing samples
+   it, the simulation skips ahead to that time or to the next wake-up. */
+typedef uint32_t (*HalSim_EnvironmentTypeDef)(uint32_t now, void *ctx);
+
+/* Device on the I2C2 bus. A write transfer sets the register address sub
+   with its first byte, then passes byte n of the data to write(); a read
+   transfer asks read() for byte n starting at the last sub written. */
+typedef struct
+{
+  uint8_t address;                    /* 7-bit */
+  uint8_t (*read)(void *ctx, uint8_t sub, uint32_t n);
+  void (*write)(void *ctx, uint8_t sub, uint32_t n, uint8_t value);
+  void *ctx;
+} HalSim_I2cDeviceTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void HalSim_Reset(void);
+void HalSim_SetEnvironment(HalSim_EnvironmentTypeDef env, void *ctx);
+uint32_t HalSim_Now(void);
+void HalSim_SetUid(uint32_t w0, uint32_t w1, uint32_t w2);
+void HalSim_Tick(uint32_t ms);
+void HalSim_GpioInput(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HalSim_GpioOutput(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HalSim_AdcPush(const uint16_t *samples, uint32_t count);
+uint32_t HalSim_AdcDmaPosition(void);
+void HalSim_MicPush(const int16_t *samples, uint32_t count);
+uint32_t HalSim_MicRate(void);
+uint32_t HalSim_UartInput(USART_TypeDef *instance, const uint8_t *data, uint32_t count);
+uint32_t HalSim_UartOutput(USART_TypeDef *instance, uint8_t *data, uint32_t max);
+void HalSim_QspiFormat(void);
+void HalSim_QspiPowerCut(uint32_t budget);
+uint8_t HalSim_QspiPowered(void);
+HAL_StatusTypeDef HalSim_I2cAttach(const HalSim_I2cDeviceTypeDef *device);
+void HalSim_I2cDetach(uint8_t address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HAL_SIM_H */
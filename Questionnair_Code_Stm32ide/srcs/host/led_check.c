@@ -0,0 +1,206 @@
+/**
+  ******************************************************************************
+  * @file           : led_check.c
+  * @brief          : Checks the blink patterns of led_pattern.c.
+  *
+  *                     led_check [-v]
+  *
+  *                   LedPattern_Tick() is called as the 1 ms SysTick would,
+  *                   and the LED pin is read back after every tick.
+  *                   Checked:
+  *
+  *                     - each pattern lights the LED for exactly the on and
+  *                       off times of led_pattern.h, starting on the first
+  *                       tick after it is queued
+  *                     - the engine is busy until the last off time has
+  *                       run out, and leaves the LED off
+  *                     - queued patterns follow each other with no gap
+  *                     - the queue takes LED_PATTERN_QUEUE_LEN patterns,
+  *                       then refuses, and refuses a bad id
+  *                     - a cancel switches the LED off on the next tick and
+  *                       drops the queued patterns
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "led_pattern.h"
+#include "hal_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK_RUNS_MAX   64U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint16_t on_ms;
+  uint16_t off_ms;
+  uint8_t flashes;
+} Check_PatternTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+/* As documented in led_pattern.h */
+static const Check_PatternTypeDef check_patterns[LED_PATTERN_COUNT] =
+{
+  { 5000U, 5000U, 2U },
+  {  500U,  500U, 5U },
+  {   50U,   50U, 7U }
+};
+
+static uint32_t check_failures;
+static int check_verbose;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t Check_Play(uint32_t ticks, uint32_t *runs, uint32_t max);
+static uint32_t Check_Length(LedPattern_IdTypeDef id);
+static void Check_That(int ok, const char *what);
+static void Check_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler at simulated tick %lu\n", (unsigned long)HAL_GetTick());
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t runs[CHECK_RUNS_MAX];
+  uint32_t count;
+  char what[96];
+  int opt;
+
+  while ((opt = getopt(argc, argv, "vh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'v':
+        check_verbose = 1;
+        break;
+      default:
+        Check_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (optind != argc)
+  {
+    Check_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  HalSim_Reset();
+  LedPattern_Init();
+
+  /* each pattern on its own: runs alternate on / off, the last off one
+     running into the idle LED */
+  for (uint32_t p = 0U; p < LED_PATTERN_COUNT; p++)
+  {
+    const Check_PatternTypeDef *pat = &check_patterns[p];
+    uint32_t length = Check_Length((LedPattern_IdTypeDef)p);
+    int ok = 1;
+
+    Check_That(LedPattern_Enqueue((LedPattern_IdTypeDef)p) == HAL_OK, "pattern queued");
+    count = Check_Play(length, runs, CHECK_RUNS_MAX);
+    ok = (count == (2U * pat->flashes));
+    for (uint32_t n = 0U; ok && (n < count); n++)
+    {
+      ok = (runs[n] == (((n & 1U) == 0U) ? pat->on_ms : pat->off_ms));
+    }
+    snprintf(what, sizeof(what), "pattern %lu: %u x %u ms on / %u ms off", (unsigned long)p, pat->flashes,
+             pat->on_ms, pat->off_ms);
+    Check_That(ok, what);
+    Check_That(LedPattern_Busy() == 1U, "busy through the last off time");
+    LedPattern_Tick();
+    Check_That(LedPattern_Busy() == 0U, "idle once it has run out");
+    Check_That(HalSim_GpioOutput(LED_PATTERN_PORT, LED_PATTERN_PIN) == GPIO_PIN_RESET, "LED left off");
+  }
+
+  /* back to back: the second starts on the tick the first ends */
+  (void)LedPattern_Enqueue(LED_PATTERN_FAST);
+  (void)LedPattern_Enqueue(LED_PATTERN_MEDIUM);
+  count = Check_Play(Check_Length(LED_PATTERN_FAST) + check_patterns[LED_PATTERN_MEDIUM].on_ms, runs,
+                     CHECK_RUNS_MAX);
+  Check_That((count == ((2U * check_patterns[LED_PATTERN_FAST].flashes) + 1U))
+             && (runs[count - 1U] == check_patterns[LED_PATTERN_MEDIUM].on_ms),
+             "queued pattern follows with no gap");
+  LedPattern_Cancel();
+  LedPattern_Tick();
+
+  /* queue depth */
+  for (uint32_t n = 0U; n < LED_PATTERN_QUEUE_LEN; n++)
+  {
+    Check_That(LedPattern_Enqueue(LED_PATTERN_FAST) == HAL_OK, "queue takes LED_PATTERN_QUEUE_LEN");
+  }
+  Check_That(LedPattern_Enqueue(LED_PATTERN_FAST) == HAL_BUSY, "full queue refuses");
+  Check_That(LedPattern_Enqueue(LED_PATTERN_COUNT) == HAL_ERROR, "bad id refused");
+
+  /* cancel mid-flash */
+  (void)Check_Play(10U, runs, CHECK_RUNS_MAX);
+  Check_That(HalSim_GpioOutput(LED_PATTERN_PORT, LED_PATTERN_PIN) == GPIO_PIN_SET, "LED on before the cancel");
+  LedPattern_Cancel();
+  LedPattern_Tick();
+  Check_That((LedPattern_Busy() == 0U)
+             && (HalSim_GpioOutput(LED_PATTERN_PORT, LED_PATTERN_PIN) == GPIO_PIN_RESET),
+             "cancel switches off and drops the queue");
+  count = Check_Play(1000U, runs, CHECK_RUNS_MAX);
+  Check_That(count == 0U, "nothing plays after a cancel");
+
+  printf("led_check: %s\n", (check_failures != 0U) ? "FAILED" : "ok");
+  return (check_failures != 0U) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Tick, and measure the runs of the LED: runs[0] is the first lit one */
+static uint32_t Check_Play(uint32_t ticks, uint32_t *runs, uint32_t max)
+{
+  uint32_t count = 0U;
+  GPIO_PinState last = GPIO_PIN_RESET;
+
+  for (uint32_t t = 0U; t < ticks; t++)
+  {
+    GPIO_PinState pin;
+
+    LedPattern_Tick();
+    pin = HalSim_GpioOutput(LED_PATTERN_PORT, LED_PATTERN_PIN);
+    if ((pin != last) && (count < max))
+    {
+      runs[count++] = 0U;
+    }
+    if (count != 0U)
+    {
+      runs[count - 1U]++;
+    }
+    last = pin;
+  }
+  return count;
+}
+
+static uint32_t Check_Length(LedPattern_IdTypeDef id)
+{
+  return (uint32_t)check_patterns[id].flashes * (check_patterns[id].on_ms + check_patterns[id].off_ms);
+}
+
+static void Check_That(int ok, const char *what)
+{
+  if (ok == 0)
+  {
+    fprintf(stderr, "led_check: %s: FAILED\n", what);
+    check_failures++;
+  }
+  else if (check_verbose != 0)
+  {
+    printf("led_check: %s\n", what);
+  }
+}
+
+static void Check_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-v]\n"
+          "  -v     one line per check that holds\n",
+          argv0);
+}
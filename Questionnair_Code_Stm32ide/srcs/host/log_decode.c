@@ -0,0 +1,147 @@
+/**
+  ******************************************************************************
+  * @file           : log_decode.c
+  * @brief          : Host decoder for the binary log stream of log_ring.c.
+  *
+  *                     log_decode [capture]       (stdin when omitted)
+  *
+  *                   Reads 16-byte records from a capture of the USART1
+  *                   stream (serial port dump or questionnaire_sim -o),
+  *                   resynchronises on the sync byte after line noise,
+  *                   reports gaps in the record numbers and prints every
+  *                   record with the token table of log_tokens.h. LOG_TEXT
+  *                   records are joined back into lines.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "log_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define LOG_DECODE_REC_LEN    sizeof(LogRing_RecordTypeDef)
+#define LOG_DECODE_TEXT_LEN   256U
+
+#define LOG_TOKEN_NAME(id, name, fmt)   name,
+#define LOG_TOKEN_FMT(id, name, fmt)    fmt,
+
+/* Private variables ---------------------------------------------------------*/
+static const char *const log_names[LOG_TOKEN_COUNT] = { LOG_TOKENS(LOG_TOKEN_NAME) };
+static const char *const log_formats[LOG_TOKEN_COUNT] = { LOG_TOKENS(LOG_TOKEN_FMT) };
+
+/* Partial LOG_TEXT line */
+static char text_line[LOG_DECODE_TEXT_LEN];
+static size_t text_len;
+static uint32_t text_tick;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Decode_Record(const LogRing_RecordTypeDef *rec);
+static void Decode_FlushText(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  uint8_t buf[LOG_DECODE_REC_LEN];
+  size_t have = 0U;
+  unsigned long records = 0UL;
+  unsigned long skipped = 0UL;
+  unsigned long lost = 0UL;
+  int synced = 0;
+  uint16_t expect = 0U;
+  FILE *in = stdin;
+
+  if (argc > 2)
+  {
+    fprintf(stderr, "usage: %s [capture]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  if ((argc == 2) && ((in = fopen(argv[1], "rb")) == NULL))
+  {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  for (;;)
+  {
+    LogRing_RecordTypeDef rec;
+    size_t n = fread(&buf[have], 1U, LOG_DECODE_REC_LEN - have, in);
+
+    have += n;
+    if (have < LOG_DECODE_REC_LEN)
+    {
+      break;
+    }
+    memcpy(&rec, buf, sizeof(rec));
+    if ((rec.sync != LOG_RING_SYNC) || (rec.token >= LOG_TOKEN_COUNT))
+    {
+      /* Line noise or a partial record: slide by one byte */
+      memmove(buf, &buf[1], LOG_DECODE_REC_LEN - 1U);
+      have = LOG_DECODE_REC_LEN - 1U;
+      skipped++;
+      synced = 0;
+      continue;
+    }
+    have = 0U;
+    if ((synced != 0) && (rec.seq != expect))
+    {
+      lost += (uint16_t)(rec.seq - expect);
+      Decode_FlushText();
+      printf("-- %u records lost --\n", (unsigned)(uint16_t)(rec.seq - expect));
+    }
+    synced = 1;
+    expect = (uint16_t)(rec.seq + 1U);
+    records++;
+    Decode_Record(&rec);
+  }
+  Decode_FlushText();
+
+  fprintf(stderr, "%lu records, %lu lost, %lu bytes skipped\n", records, lost, skipped);
+  if (in != stdin)
+  {
+    fclose(in);
+  }
+  return EXIT_SUCCESS;
+}
+
+static void Decode_Record(const LogRing_RecordTypeDef *rec)
+{
+  if (rec->token == LOG_TEXT)
+  {
+    const char *chunk = (const char *)rec->arg;
+
+    for (size_t n = 0U; (n < sizeof(rec->arg)) && (chunk[n] != '\0'); n++)
+    {
+      if ((chunk[n] == '\n') || (text_len == (sizeof(text_line) - 1U)))
+      {
+        Decode_FlushText();
+      }
+      if ((chunk[n] != '\n') && (chunk[n] != '\r'))
+      {
+        if (text_len == 0U)
+        {
+          text_tick = rec->tick;
+        }
+        text_line[text_len++] = chunk[n];
+      }
+    }
+    return;
+  }
+
+  Decode_FlushText();
+  printf("%10lu  %-12s ", (unsigned long)rec->tick, log_names[rec->token]);
+  printf(log_formats[rec->token], (unsigned long)rec->arg[0], (unsigned long)rec->arg[1]);
+  putchar('\n');
+}
+
+static void Decode_FlushText(void)
+{
+  if (text_len != 0U)
+  {
+    text_line[text_len] = '\0';
+    printf("%10lu  %-12s %s\n", (unsigned long)text_tick, log_names[LOG_TEXT], text_line);
+    text_len = 0U;
+  }
+}
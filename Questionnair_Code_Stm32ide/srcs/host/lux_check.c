@@ -0,0 +1,494 @@
+/**
+  ******************************************************************************
+  * @file           : lux_check.c
+  * @brief          : Replays lux traces through the ADC stream and the lux
+  *                   filter.
+  *
+  *                     lux_check [-v] trace ...
+  *
+  *                   Each trace gives the photodiode level millisecond by
+  *                   millisecond, as the oversampled ADC results TIM6
+  *                   triggers. They go through the simulated DMA and
+  *                   analog watchdog into adc_stream.c, and every block
+  *                   into lux_filter.c as App_Step() hands it over, the
+  *                   watchdog window following the crossings. Trace lines,
+  *                   in time order:
+  *
+  *                     threshold <adc>           0 only filters
+  *                     noise <amplitude>         uniform, on every sample
+  *                     crossings <count>         rises the filter must see
+  *                     drift <adc>               most the value may differ
+  *                                               from every block examined
+  *                     <ms> level <adc>
+  *                     <ms> ramp <adc> <over_ms> from the level at <ms>
+  *                     <ms> spikes <adc> <count> <every_ms>
+  *                     <ms> expect bright|dark
+  *                     <ms> end
+  *
+  *                   The trace is played twice, the second time with
+  *                   every block examined: both must cross at the same
+  *                   blocks, and the filtered value at the end of every
+  *                   block must stay within drift (0 without the line) of
+  *                   the one examined. The rises of the firmware before
+  *                   the filter (a block mean against the threshold) and
+  *                   of a single sample against it are counted for
+  *                   comparison, and the share of blocks the watchdog let
+  *                   the filter skip is reported.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "adc_stream.h"
+#include "lux_filter.h"
+#include "hal_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK_EVENTS_MAX       256U
+#define CHECK_BLOCKS_MAX       4096U
+#define CHECK_LINE_LEN         256U
+#define CHECK_SEED             0x2545F491U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  CHECK_LEVEL = 0,
+  CHECK_RAMP,
+  CHECK_SPIKES,
+  CHECK_EXPECT,
+  CHECK_END
+} Check_EventTypeTypeDef;
+
+typedef struct
+{
+  uint32_t ms;
+  Check_EventTypeTypeDef type;
+  int32_t v[3];
+  uint32_t line;
+} Check_EventTypeDef;
+
+typedef struct
+{
+  Check_EventTypeDef event[CHECK_EVENTS_MAX];
+  uint32_t count;
+  uint32_t end_ms;
+  uint16_t threshold;
+  uint16_t noise;
+  uint32_t crossings;
+  uint16_t drift;
+  const char *path;
+  int verbose;
+} Check_TraceTypeDef;
+
+/* One replay; crossing[n] is the event at the end of block n */
+typedef struct
+{
+  uint8_t crossing[CHECK_BLOCKS_MAX];
+  uint16_t value[CHECK_BLOCKS_MAX];
+  uint32_t blocks;
+  uint32_t mean_rises;      /* block mean above the threshold, no filter  */
+  uint32_t sample_rises;    /* single sample above the threshold          */
+  uint32_t failures;        /* expect lines that did not hold             */
+  LuxFilter_StatsTypeDef filter;
+  AdcStream_StatsTypeDef stream;
+} Check_ReplayTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+ADC_HandleTypeDef hadc1 = { ADC1, { 0U }, NULL };
+
+static uint32_t check_noise;
+
+/* Private function prototypes -----------------------------------------------*/
+static int Check_Run(const char *path, int verbose);
+static int Check_Load(Check_TraceTypeDef *trace, const char *path);
+static void Check_Replay(const Check_TraceTypeDef *trace, uint8_t gated, Check_ReplayTypeDef *out);
+static void Check_Drain(uint8_t gated, Check_ReplayTypeDef *out);
+static void Check_Window(void);
+static int32_t Check_Noise(uint16_t amplitude);
+static void Check_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler at simulated tick %lu\n", (unsigned long)HAL_GetTick());
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  int verbose = 0;
+  int failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "vh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        Check_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (optind >= argc)
+  {
+    Check_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  for (int n = optind; n < argc; n++)
+  {
+    if (Check_Run(argv[n], verbose) != 0)
+    {
+      failed = 1;
+    }
+  }
+  return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Play one trace gated by the watchdog, then with every block examined */
+static int Check_Run(const char *path, int verbose)
+{
+  static Check_TraceTypeDef trace;
+  static Check_ReplayTypeDef gated;
+  static Check_ReplayTypeDef full;
+  uint32_t moved = 0U;
+  uint32_t drift = 0U;
+
+  memset(&trace, 0, sizeof(trace));
+  trace.path = path;
+  trace.verbose = verbose;
+  if (Check_Load(&trace, path) != 0)
+  {
+    return -1;
+  }
+  Check_Replay(&trace, 1U, &gated);
+  Check_Replay(&trace, 0U, &full);
+
+  for (uint32_t n = 0U; n < gated.blocks; n++)
+  {
+    uint32_t d = (gated.value[n] > full.value[n]) ? (gated.value[n] - full.value[n])
+                                                   : (full.value[n] - gated.value[n]);
+
+    if (gated.crossing[n] != full.crossing[n])
+    {
+      fprintf(stderr, "%s: block %lu: event %u examined only on wake-up, %u examined always\n", path,
+              (unsigned long)n, gated.crossing[n], full.crossing[n]);
+      moved++;
+    }
+    drift = (d > drift) ? d : drift;
+  }
+  if (drift > trace.drift)
+  {
+    fprintf(stderr, "%s: value drifts by %lu from every block examined, at most %u\n", path,
+            (unsigned long)drift, trace.drift);
+  }
+  if (gated.filter.rises != trace.crossings)
+  {
+    fprintf(stderr, "%s: %lu rises, expected %lu\n", path, (unsigned long)gated.filter.rises,
+            (unsigned long)trace.crossings);
+  }
+
+  printf("%s: %lu crossings: filter %lu, block mean %lu, single sample %lu; %lu of %lu blocks examined"
+         " (%.1f %%), %lu watchdog interrupts, value within %lu of every block examined\n",
+         path, (unsigned long)trace.crossings, (unsigned long)gated.filter.rises,
+         (unsigned long)gated.mean_rises, (unsigned long)gated.sample_rises,
+         (unsigned long)gated.filter.examined, (unsigned long)gated.filter.blocks,
+         (gated.filter.blocks != 0U) ? (100.0 * gated.filter.examined / gated.filter.blocks) : 0.0,
+         (unsigned long)gated.stream.watchdog, (unsigned long)drift);
+  return ((gated.filter.rises != trace.crossings) || (moved != 0U) || (drift > trace.drift)
+          || (gated.failures != 0U) || (full.failures != 0U)) ? -1 : 0;
+}
+
+/* Parse a trace; events must come in time order and end with end */
+static int Check_Load(Check_TraceTypeDef *trace, const char *path)
+{
+  char line[CHECK_LINE_LEN];
+  uint32_t number = 0U;
+  uint32_t last = 0U;
+  unsigned int value;
+  FILE *f = fopen(path, "r");
+
+  if (f == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    Check_EventTypeDef *e = &trace->event[trace->count];
+    char verb[16];
+    char what[16];
+    unsigned long ms;
+    int n = 0;
+
+    number++;
+    if ((line[0] == '#') || (sscanf(line, "%15s", verb) != 1))
+    {
+      continue;
+    }
+    if (sscanf(line, "threshold %u", &value) == 1)
+    {
+      trace->threshold = (uint16_t)value;
+      continue;
+    }
+    if (sscanf(line, "noise %u", &value) == 1)
+    {
+      trace->noise = (uint16_t)value;
+      continue;
+    }
+    if (sscanf(line, "crossings %u", &value) == 1)
+    {
+      trace->crossings = value;
+      continue;
+    }
+    if (sscanf(line, "drift %u", &value) == 1)
+    {
+      trace->drift = (uint16_t)value;
+      continue;
+    }
+    if (trace->count == CHECK_EVENTS_MAX)
+    {
+      fprintf(stderr, "%s:%lu: too many events\n", path, (unsigned long)number);
+      fclose(f);
+      return -1;
+    }
+
+    memset(e, 0, sizeof(*e));
+    e->line = number;
+    if (sscanf(line, "%lu %15s %n", &ms, verb, &n) < 2)
+    {
+      n = -1;
+    }
+    else if (strcmp(verb, "level") == 0)
+    {
+      e->type = CHECK_LEVEL;
+      n = (sscanf(&line[n], "%d", &e->v[0]) == 1) ? 0 : -1;
+    }
+    else if (strcmp(verb, "ramp") == 0)
+    {
+      e->type = CHECK_RAMP;
+      n = ((sscanf(&line[n], "%d %d", &e->v[0], &e->v[1]) == 2) && (e->v[1] > 0)) ? 0 : -1;
+    }
+    else if (strcmp(verb, "spikes") == 0)
+    {
+      e->type = CHECK_SPIKES;
+      n = ((sscanf(&line[n], "%d %d %d", &e->v[0], &e->v[1], &e->v[2]) == 3) && (e->v[2] > 0)) ? 0 : -1;
+    }
+    else if ((strcmp(verb, "expect") == 0) && (sscanf(&line[n], "%15s", what) == 1))
+    {
+      e->type = CHECK_EXPECT;
+      e->v[0] = (strcmp(what, "bright") == 0) ? 1 : 0;
+      n = ((e->v[0] != 0) || (strcmp(what, "dark") == 0)) ? 0 : -1;
+    }
+    else if (strcmp(verb, "end") == 0)
+    {
+      e->type = CHECK_END;
+      n = 0;
+    }
+    else
+    {
+      n = -1;
+    }
+    if ((n != 0) || (ms < last) || (trace->end_ms != 0U))
+    {
+      fprintf(stderr, "%s:%lu: bad line\n", path, (unsigned long)number);
+      fclose(f);
+      return -1;
+    }
+    e->ms = (uint32_t)ms;
+    last = e->ms;
+    if (e->type == CHECK_END)
+    {
+      trace->end_ms = e->ms;
+    }
+    trace->count++;
+  }
+  fclose(f);
+  if ((trace->end_ms == 0U) || (trace->end_ms > (CHECK_BLOCKS_MAX * ADC_STREAM_HALF_LEN)))
+  {
+    fprintf(stderr, "%s: no end, or past %lu ms\n", path, (unsigned long)(CHECK_BLOCKS_MAX * ADC_STREAM_HALF_LEN));
+    return -1;
+  }
+  return 0;
+}
+
+/* One sample per millisecond into the DMA, blocks drained as they fill */
+static void Check_Replay(const Check_TraceTypeDef *trace, uint8_t gated, Check_ReplayTypeDef *out)
+{
+  uint32_t next = 0U;
+  int32_t level = 0;
+  int32_t ramp_from = 0;
+  int32_t ramp_to = 0;
+  uint32_t ramp_start = 0U;
+  uint32_t ramp_ms = 0U;
+  int32_t spike = 0;
+  uint32_t spikes = 0U;
+  uint32_t spike_every = 1U;
+  uint32_t spike_next = 0U;
+  uint32_t mean_acc = 0U;
+  uint8_t mean_high = 0U;
+  uint8_t sample_high = 0U;
+
+  memset(out, 0, sizeof(*out));
+  check_noise = CHECK_SEED;
+  HalSim_Reset();
+  if ((AdcStream_Init(&hadc1, ADC_STREAM_DEFAULT_RATE_HZ) != HAL_OK) || (AdcStream_Start() != HAL_OK))
+  {
+    Error_Handler();
+  }
+  LuxFilter_Init(trace->threshold);
+  Check_Window();
+
+  for (uint32_t t = 0U; t < trace->end_ms; t++)
+  {
+    int32_t x;
+    uint16_t sample;
+
+    while ((next < trace->count) && (trace->event[next].ms <= t) && (trace->event[next].type != CHECK_EXPECT))
+    {
+      const Check_EventTypeDef *e = &trace->event[next++];
+
+      switch (e->type)
+      {
+        case CHECK_LEVEL:
+          level = e->v[0];
+          ramp_ms = 0U;
+          break;
+        case CHECK_RAMP:
+          ramp_from = level;
+          ramp_to = e->v[0];
+          ramp_start = t;
+          ramp_ms = (uint32_t)e->v[1];
+          break;
+        case CHECK_SPIKES:
+          spike = e->v[0];
+          spikes = (uint32_t)e->v[1];
+          spike_every = (uint32_t)e->v[2];
+          spike_next = t;
+          break;
+        default:
+          break;
+      }
+    }
+    if (ramp_ms != 0U)
+    {
+      uint32_t done = t - ramp_start;
+
+      level = (done >= ramp_ms) ? ramp_to : (ramp_from + (((ramp_to - ramp_from) * (int32_t)done) / (int32_t)ramp_ms));
+      ramp_ms = (done >= ramp_ms) ? 0U : ramp_ms;
+    }
+
+    x = level + Check_Noise(trace->noise);
+    if ((spikes != 0U) && (t == spike_next))
+    {
+      x = spike;
+      spikes--;
+      spike_next += spike_every;
+    }
+    sample = (uint16_t)((x < 0) ? 0 : ((x > (int32_t)LUX_FILTER_FULL_SCALE) ? (int32_t)LUX_FILTER_FULL_SCALE : x));
+
+    /* what the firmware did before: a single sample, a block mean */
+    if ((trace->threshold != 0U) && (sample > trace->threshold) && (sample_high == 0U))
+    {
+      out->sample_rises++;
+    }
+    sample_high = (sample > trace->threshold) ? 1U : 0U;
+    mean_acc += sample;
+    if ((t % ADC_STREAM_HALF_LEN) == (ADC_STREAM_HALF_LEN - 1U))
+    {
+      uint16_t mean = (uint16_t)(mean_acc / ADC_STREAM_HALF_LEN);
+
+      if ((trace->threshold != 0U) && (mean > trace->threshold) && (mean_high == 0U))
+      {
+        out->mean_rises++;
+      }
+      mean_high = (mean > trace->threshold) ? 1U : 0U;
+      mean_acc = 0U;
+    }
+
+    HalSim_AdcPush(&sample, 1U);
+    Check_Drain(gated, out);
+
+    while ((next < trace->count) && (trace->event[next].ms <= t) && (trace->event[next].type == CHECK_EXPECT))
+    {
+      const Check_EventTypeDef *e = &trace->event[next++];
+      uint8_t bright = LuxFilter_High();
+
+      if (bright != (uint8_t)e->v[0])
+      {
+        fprintf(stderr, "%s:%lu: %s at %lu ms, filtered %u\n", trace->path, (unsigned long)e->line,
+                (bright != 0U) ? "bright" : "dark", (unsigned long)t, LuxFilter_Value());
+        out->failures++;
+      }
+      else if ((trace->verbose != 0) && (gated != 0U))
+      {
+        printf("%s:%lu: %s at %lu ms, filtered %u\n", trace->path, (unsigned long)e->line,
+               (bright != 0U) ? "bright" : "dark", (unsigned long)t, LuxFilter_Value());
+      }
+    }
+  }
+  LuxFilter_GetStats(&out->filter);
+  AdcStream_GetStats(&out->stream);
+}
+
+/* The lux part of App_Step() */
+static void Check_Drain(uint8_t gated, Check_ReplayTypeDef *out)
+{
+  const uint16_t *block;
+
+  while ((block = AdcStream_GetBlock()) != NULL)
+  {
+    uint8_t woke = AdcStream_TakeWatchdog();
+    LuxFilter_EventTypeDef event = LuxFilter_Block(block, (gated != 0U) ? woke : 1U);
+
+    AdcStream_ReleaseBlock();
+    if (event != LUX_FILTER_NONE)
+    {
+      Check_Window();
+    }
+    if (out->blocks < CHECK_BLOCKS_MAX)
+    {
+      out->crossing[out->blocks] = (uint8_t)event;
+      out->value[out->blocks] = LuxFilter_Value();
+      out->blocks++;
+    }
+  }
+}
+
+static void Check_Window(void)
+{
+  uint16_t low;
+  uint16_t high;
+
+  LuxFilter_Window(&low, &high);
+  if (AdcStream_SetWatchdog(low, high) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/* xorshift32, uniform in [-amplitude, amplitude] */
+static int32_t Check_Noise(uint16_t amplitude)
+{
+  check_noise ^= check_noise << 13;
+  check_noise ^= check_noise >> 17;
+  check_noise ^= check_noise << 5;
+  return (amplitude == 0U) ? 0 : ((int32_t)(check_noise % ((2U * amplitude) + 1U)) - (int32_t)amplitude);
+}
+
+static void Check_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-v] trace ...\n"
+          "  -v     one line per expect that holds\n"
+          "  trace  lux trace, see the header of lux_check.c\n",
+          argv0);
+}
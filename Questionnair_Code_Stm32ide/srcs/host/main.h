@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file           : main.h
+  * @brief          : Host (Linux) replacement for Core/Inc/main.h.
+  *                   Lets the application modules in srcs/ be compiled
+  *                   against the simulated HAL in this directory.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32l4xx_hal.h"
+#include "hal_sim.h"
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Error_Handler(void);
+
+/* Private defines -----------------------------------------------------------*/
+/* Pins of the board used by srcs/, named as in the CubeMX generated main.h */
+#define VL53L0X_XSHUT_Pin              GPIO_PIN_6
+#define VL53L0X_XSHUT_GPIO_Port        GPIOC
+#define VL53L0X_GPIO1_EXTI7_Pin        GPIO_PIN_7
+#define VL53L0X_GPIO1_EXTI7_GPIO_Port  GPIOC
+#define LSM3MDL_DRDY_EXTI8_Pin         GPIO_PIN_8
+#define LSM3MDL_DRDY_EXTI8_GPIO_Port   GPIOC
+#define HTS221_DRDY_EXTI15_Pin         GPIO_PIN_15
+#define HTS221_DRDY_EXTI15_GPIO_Port   GPIOD
+#define ISM43362_DRDY_EXTI1_Pin        GPIO_PIN_1
+#define ISM43362_DRDY_EXTI1_GPIO_Port  GPIOE
+#define USB_OTG_FS_OVRCR_EXTI3_Pin     GPIO_PIN_3
+#define USB_OTG_FS_OVRCR_EXTI3_GPIO_Port GPIOE
+#define SPSGRF_915_GPIO3_EXTI5_Pin     GPIO_PIN_5
+#define SPSGRF_915_GPIO3_EXTI5_GPIO_Port GPIOE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MAIN_H */
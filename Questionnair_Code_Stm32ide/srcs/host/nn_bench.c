@@ -0,0 +1,677 @@
+/**
+  ******************************************************************************
+  * @file           : nn_bench.c
+  * @brief          : Correctness and throughput bench of the int8 emotion CNN.
+  *
+  *                     nn_bench [-r repeat] [-n images] [-m blob [-v vectors]]
+ *                              [-s out.bin]
+  *
+  *                   First every kernel is compared, bit for bit, with a
+  *                   plain loop reference on random layers whose shapes hit
+  *                   the odd tails of the vector loops (odd widths and
+  *                   channel counts, lengths not a multiple of 4, 8 or 16).
+  *
+  *                   Then the whole network: a blob written by
+  *                   convert_model.py (-m), or without one a random blob in
+  *                   the same format, is loaded by EmotionNet_Init() after
+  *                   checking that damaged copies are refused. Random and
+  *                   patterned faces go through EmotionNet_Run() and through
+  *                   the reference, which must give the same logits; -v
+  *                   replays the images and int8 logits that the converter
+  *                   computed in numpy. Finally EmotionNet_Run() is timed
+  *                   over -r inferences.
+  *
+  *                   The kernels compiled in are reported: the default
+  *                   build uses the x86 vectors, nn_bench_generic runs the
+  *                   Cortex-M4 code on plain C intrinsics.
+  *
+  *                   -s also writes the blob that was checked, so that
+  *                   tools needing a model can run without a trained one.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "emotion_net.h"
+#include "frame.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define NN_BENCH_CONVS      4U
+
+/* Private typedef -----------------------------------------------------------*/
+/* A random layer and the storage behind it */
+typedef struct
+{
+  NnKernels_LayerTypeDef layer;
+  int8_t *weights;
+  int32_t *bias;
+  int32_t *multiplier;
+  int8_t *shift;
+} Bench_LayerTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t bench_seed = 12345U;
+
+/* in_ch, out_ch, taps of the network layers, for the random blob */
+static const uint16_t bench_shapes[EMOTION_NET_LAYERS][3] =
+{
+  { 1U, 32U, 9U }, { 32U, 64U, 9U }, { 64U, 128U, 9U }, { 128U, 128U, 9U },
+  { 2048U, 1024U, 1U }, { 1024U, EMOTION_NET_CLASSES, 1U },
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static int Bench_Kernels(void);
+static int Bench_Network(uint8_t *blob, uint32_t size, const char *vectors, uint32_t images, uint32_t repeat);
+static void Bench_RefForward(const uint8_t *image, int8_t *logits);
+static void Bench_RefConv(const NnKernels_LayerTypeDef *layer, const int8_t *in, uint32_t h, uint32_t w, int8_t *out);
+static void Bench_RefPool(const int8_t *in, uint32_t h, uint32_t w, uint32_t c, int8_t *out);
+static void Bench_RefDense(const NnKernels_LayerTypeDef *layer, const int8_t *in, int8_t *out);
+static int8_t Bench_RefRequantize(const NnKernels_LayerTypeDef *layer, uint32_t o, int64_t acc);
+static void Bench_LayerRandom(Bench_LayerTypeDef *bl, uint32_t in_ch, uint32_t out_ch, uint32_t taps, int relu);
+static void Bench_LayerFree(Bench_LayerTypeDef *bl);
+static uint8_t *Bench_Synthesize(uint32_t *size);
+static uint8_t *Bench_ReadFile(const char *path, uint32_t *size);
+static int Bench_WriteFile(const char *path, const uint8_t *data, uint32_t size);
+static void Bench_Face(uint8_t *image, uint32_t n);
+static int Bench_Diff(const char *what, const int8_t *a, const int8_t *b, uint32_t n);
+static uint32_t Bench_Random(void);
+static void Bench_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler\n");
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *model = NULL;
+  const char *vectors = NULL;
+  const char *save = NULL;
+  uint32_t repeat = 5U;
+  uint32_t images = 20U;
+  uint8_t *blob;
+  uint32_t size;
+  int failed;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "r:n:m:v:s:h")) != -1)
+  {
+    switch (opt)
+    {
+      case 'r':
+        repeat = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        images = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'm':
+        model = optarg;
+        break;
+      case 'v':
+        vectors = optarg;
+        break;
+      case 's':
+        save = optarg;
+        break;
+      default:
+        Bench_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((vectors != NULL) && (model == NULL))
+  {
+    Bench_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  printf("kernels: %s\n", NnKernels_Isa());
+  failed = Bench_Kernels();
+
+  blob = (model != NULL) ? Bench_ReadFile(model, &size) : Bench_Synthesize(&size);
+  if (blob == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+  if (Bench_Network(blob, size, vectors, images, repeat) != 0)
+  {
+    failed = 1;
+  }
+  if ((save != NULL) && (Bench_WriteFile(save, blob, size) != 0))
+  {
+    failed = 1;
+  }
+  free(blob);
+  return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Every kernel against the reference on random data */
+static int Bench_Kernels(void)
+{
+  static const uint16_t convs[][4] =
+  {
+    /* height, width, in_ch, out_ch */
+    { 3U, 3U, 1U, 1U }, { 5U, 6U, 1U, 3U }, { 6U, 9U, 3U, 5U }, { 7U, 8U, 4U, 7U },
+    { 9U, 7U, 6U, 2U }, { 10U, 10U, 8U, 16U }, { 8U, 11U, 32U, 9U }, { 6U, 6U, 64U, 33U },
+  };
+  static const uint16_t pools[][3] =
+  {
+    { 2U, 2U, 1U }, { 5U, 7U, 3U }, { 8U, 8U, 16U }, { 9U, 6U, 33U }, { 4U, 4U, 128U },
+  };
+  static const uint16_t denses[][2] =
+  {
+    { 1U, 1U }, { 3U, 2U }, { 17U, 5U }, { 64U, 9U }, { 100U, 7U }, { 2048U, 32U },
+  };
+  Bench_LayerTypeDef bl;
+  uint32_t checks = 0U;
+  int failed = 0;
+
+  for (uint32_t t = 0U; t < (sizeof(convs) / sizeof(convs[0])); t++)
+  {
+    const uint32_t h = convs[t][0];
+    const uint32_t w = convs[t][1];
+    const uint32_t n_in = h * w * convs[t][2];
+    const uint32_t n_out = (h - 2U) * (w - 2U) * convs[t][3];
+    int8_t *in = malloc(n_in);
+    int8_t *got = malloc(n_out);
+    int8_t *want = malloc(n_out);
+    int16_t *scratch = malloc(NN_KERNELS_CONV_SCRATCH(convs[t][2]) * sizeof(int16_t));
+    char what[64];
+
+    Bench_LayerRandom(&bl, convs[t][2], convs[t][3], 9U, (int)(t & 1U));
+    for (uint32_t i = 0U; i < n_in; i++)
+    {
+      in[i] = (int8_t)Bench_Random();
+    }
+    NnKernels_Conv3x3(&bl.layer, in, (uint16_t)h, (uint16_t)w, got, scratch);
+    Bench_RefConv(&bl.layer, in, h, w, want);
+    snprintf(what, sizeof(what), "conv %lux%lux%u -> %u", (unsigned long)h, (unsigned long)w, convs[t][2],
+             convs[t][3]);
+    failed |= Bench_Diff(what, got, want, n_out);
+    checks++;
+    Bench_LayerFree(&bl);
+    free(in);
+    free(got);
+    free(want);
+    free(scratch);
+  }
+
+  for (uint32_t t = 0U; t < (sizeof(pools) / sizeof(pools[0])); t++)
+  {
+    const uint32_t h = pools[t][0];
+    const uint32_t w = pools[t][1];
+    const uint32_t c = pools[t][2];
+    const uint32_t n_out = (h / 2U) * (w / 2U) * c;
+    int8_t *in = malloc(h * w * c);
+    int8_t *got = malloc(n_out);
+    int8_t *want = malloc(n_out);
+    char what[64];
+
+    for (uint32_t i = 0U; i < (h * w * c); i++)
+    {
+      in[i] = (int8_t)Bench_Random();
+    }
+    NnKernels_MaxPool2x2(in, (uint16_t)h, (uint16_t)w, (uint16_t)c, got);
+    Bench_RefPool(in, h, w, c, want);
+    snprintf(what, sizeof(what), "pool %lux%lux%lu", (unsigned long)h, (unsigned long)w, (unsigned long)c);
+    failed |= Bench_Diff(what, got, want, n_out);
+    /* in place, as the arena may lay it out */
+    NnKernels_MaxPool2x2(in, (uint16_t)h, (uint16_t)w, (uint16_t)c, in);
+    failed |= Bench_Diff(what, in, want, n_out);
+    checks += 2U;
+    free(in);
+    free(got);
+    free(want);
+  }
+
+  for (uint32_t t = 0U; t < (sizeof(denses) / sizeof(denses[0])); t++)
+  {
+    const uint32_t n = denses[t][0];
+    const uint32_t o = denses[t][1];
+    int8_t *in = malloc(n);
+    int8_t got[32];
+    int8_t want[32];
+    int16_t *scratch = malloc(NN_KERNELS_DENSE_SCRATCH(n) * sizeof(int16_t));
+    char what[64];
+
+    Bench_LayerRandom(&bl, n, o, 1U, (int)(t & 1U));
+    for (uint32_t i = 0U; i < n; i++)
+    {
+      in[i] = (int8_t)Bench_Random();
+    }
+    NnKernels_Dense(&bl.layer, in, got, scratch);
+    Bench_RefDense(&bl.layer, in, want);
+    snprintf(what, sizeof(what), "dense %lu -> %lu", (unsigned long)n, (unsigned long)o);
+    failed |= Bench_Diff(what, got, want, o);
+    checks++;
+    Bench_LayerFree(&bl);
+    free(in);
+    free(scratch);
+  }
+
+  printf("kernels: %lu checks, %s\n", (unsigned long)checks, (failed != 0) ? "FAILED" : "bit-exact");
+  return failed;
+}
+
+/* Load checks, reference comparison and timing of the whole network */
+static int Bench_Network(uint8_t *blob, uint32_t size, const char *vectors, uint32_t images, uint32_t repeat)
+{
+  static uint8_t image[EMOTION_NET_INPUT_BYTES];
+  EmotionNet_ResultTypeDef res;
+  int8_t want[EMOTION_NET_CLASSES];
+  uint32_t histogram[EMOTION_NET_CLASSES] = { 0U };
+  uint64_t macs = 0U;
+  struct timespec t0;
+  struct timespec t1;
+  double ms;
+  int failed = 0;
+
+  /* damaged or cut blobs must be refused */
+  {
+    const uint32_t at = size / 2U;
+
+    blob[at] ^= 0x10U;
+    failed |= (EmotionNet_Init(blob, size) == HAL_OK);
+    blob[at] ^= 0x10U;
+    failed |= (EmotionNet_Init(blob, size - 1U) == HAL_OK);
+    failed |= (EmotionNet_Run(image, &res) == HAL_OK);
+    if (failed != 0)
+    {
+      printf("network: a damaged blob was accepted\n");
+    }
+  }
+  if (EmotionNet_Init(blob, size) != HAL_OK)
+  {
+    printf("network: blob refused\n");
+    return 1;
+  }
+
+  for (uint32_t n = 0U; n < images; n++)
+  {
+    float sum = 0.0f;
+
+    Bench_Face(image, n);
+    (void)EmotionNet_Run(image, &res);
+    Bench_RefForward(image, want);
+    failed |= Bench_Diff("network", res.logits, want, EMOTION_NET_CLASSES);
+    for (uint32_t c = 0U; c < EMOTION_NET_CLASSES; c++)
+    {
+      sum += res.probability[c];
+      if (res.probability[c] > res.probability[res.label])
+      {
+        failed = 1;
+      }
+    }
+    if (fabsf(sum - 1.0f) > 1e-4f)
+    {
+      printf("network: probabilities sum to %f\n", (double)sum);
+      failed = 1;
+    }
+    histogram[res.label]++;
+  }
+  printf("network: %lu images against the reference, %s; labels", (unsigned long)images,
+         (failed != 0) ? "FAILED" : "bit-exact");
+  for (uint32_t c = 0U; c < EMOTION_NET_CLASSES; c++)
+  {
+    printf(" %s %lu", EmotionNet_LabelName(c), (unsigned long)histogram[c]);
+  }
+  printf("\n");
+
+  if (vectors != NULL)
+  {
+    FILE *f = fopen(vectors, "rb");
+    uint32_t count = 0U;
+    uint32_t bad = 0U;
+
+    if (f == NULL)
+    {
+      perror(vectors);
+      return 1;
+    }
+    while ((fread(image, 1U, sizeof(image), f) == sizeof(image)) && (fread(want, 1U, sizeof(want), f) == sizeof(want)))
+    {
+      (void)EmotionNet_Run(image, &res);
+      if (memcmp(res.logits, want, sizeof(want)) != 0)
+      {
+        bad++;
+      }
+      count++;
+    }
+    fclose(f);
+    printf("vectors: %lu of %lu images match the converter\n", (unsigned long)(count - bad), (unsigned long)count);
+    failed |= ((bad != 0U) || (count == 0U));
+  }
+
+  for (uint32_t i = 0U; i < EMOTION_NET_LAYERS; i++)
+  {
+    static const uint16_t pixels[EMOTION_NET_LAYERS] = { 46U * 46U, 44U * 44U, 20U * 20U, 8U * 8U, 1U, 1U };
+
+    macs += (uint64_t)pixels[i] * bench_shapes[i][2] * bench_shapes[i][0] * bench_shapes[i][1];
+  }
+  Bench_Face(image, 0U);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (uint32_t r = 0U; r < repeat; r++)
+  {
+    (void)EmotionNet_Run(image, &res);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ms = (((double)(t1.tv_sec - t0.tv_sec) * 1e3) + ((double)(t1.tv_nsec - t0.tv_nsec) / 1e6)) / ((repeat != 0U) ? repeat : 1U);
+  printf("network: %.2f ms per face, %.1f MMAC, %.0f MMAC/s, arena %lu bytes\n", ms, (double)macs / 1e6,
+         (ms > 0.0) ? ((double)macs / 1e3 / ms) : 0.0, (unsigned long)EMOTION_NET_ARENA_BYTES);
+  return failed;
+}
+
+/* The network in plain loops, on the layers bound by EmotionNet_Init */
+static void Bench_RefForward(const uint8_t *image, int8_t *logits)
+{
+  int8_t *a = malloc(46U * 46U * 32U);
+  int8_t *b = malloc(44U * 44U * 64U);
+  int8_t *x = malloc(EMOTION_NET_INPUT_BYTES);
+
+  for (uint32_t i = 0U; i < EMOTION_NET_INPUT_BYTES; i++)
+  {
+    x[i] = (int8_t)((int32_t)image[i] + EMOTION_NET_INPUT_ZP);
+  }
+  Bench_RefConv(EmotionNet_Layer(0U), x, 48U, 48U, a);
+  Bench_RefConv(EmotionNet_Layer(1U), a, 46U, 46U, b);
+  Bench_RefPool(b, 44U, 44U, 64U, a);
+  Bench_RefConv(EmotionNet_Layer(2U), a, 22U, 22U, b);
+  Bench_RefPool(b, 20U, 20U, 128U, a);
+  Bench_RefConv(EmotionNet_Layer(3U), a, 10U, 10U, b);
+  Bench_RefPool(b, 8U, 8U, 128U, a);
+  Bench_RefDense(EmotionNet_Layer(4U), a, b);
+  Bench_RefDense(EmotionNet_Layer(5U), b, logits);
+  free(a);
+  free(b);
+  free(x);
+}
+
+static void Bench_RefConv(const NnKernels_LayerTypeDef *layer, const int8_t *in, uint32_t h, uint32_t w, int8_t *out)
+{
+  const uint32_t cin = layer->in_ch;
+  const uint32_t cout = layer->out_ch;
+
+  for (uint32_t y = 0U; y < (h - 2U); y++)
+  {
+    for (uint32_t x = 0U; x < (w - 2U); x++)
+    {
+      for (uint32_t o = 0U; o < cout; o++)
+      {
+        int64_t acc = layer->bias[o];
+
+        for (uint32_t ky = 0U; ky < 3U; ky++)
+        {
+          for (uint32_t kx = 0U; kx < 3U; kx++)
+          {
+            for (uint32_t c = 0U; c < cin; c++)
+            {
+              acc += (int64_t)in[((((y + ky) * w) + x + kx) * cin) + c]
+                     * layer->weights[(((((o * 3U) + ky) * 3U) + kx) * cin) + c];
+            }
+          }
+        }
+        out[(((y * (w - 2U)) + x) * cout) + o] = Bench_RefRequantize(layer, o, acc);
+      }
+    }
+  }
+}
+
+static void Bench_RefPool(const int8_t *in, uint32_t h, uint32_t w, uint32_t c, int8_t *out)
+{
+  for (uint32_t y = 0U; y < (h / 2U); y++)
+  {
+    for (uint32_t x = 0U; x < (w / 2U); x++)
+    {
+      for (uint32_t k = 0U; k < c; k++)
+      {
+        int8_t m = -128;
+
+        for (uint32_t d = 0U; d < 4U; d++)
+        {
+          const int8_t v = in[(((((2U * y) + (d >> 1)) * w) + (2U * x) + (d & 1U)) * c) + k];
+
+          m = (v > m) ? v : m;
+        }
+        out[(((y * (w / 2U)) + x) * c) + k] = m;
+      }
+    }
+  }
+}
+
+static void Bench_RefDense(const NnKernels_LayerTypeDef *layer, const int8_t *in, int8_t *out)
+{
+  for (uint32_t o = 0U; o < layer->out_ch; o++)
+  {
+    int64_t acc = layer->bias[o];
+
+    for (uint32_t i = 0U; i < layer->in_ch; i++)
+    {
+      acc += (int64_t)in[i] * layer->weights[(o * layer->in_ch) + i];
+    }
+    out[o] = Bench_RefRequantize(layer, o, acc);
+  }
+}
+
+/* round(acc * multiplier / 2^(31 - shift)), in long double */
+static int8_t Bench_RefRequantize(const NnKernels_LayerTypeDef *layer, uint32_t o, int64_t acc)
+{
+  const long double v = floorl(((long double)acc * layer->multiplier[o] / ldexpl(1.0L, 31 - layer->shift[o])) + 0.5L);
+  long double q = v + layer->output_zp;
+
+  q = (q < layer->act_min) ? layer->act_min : q;
+  q = (q > layer->act_max) ? layer->act_max : q;
+  return (int8_t)q;
+}
+
+/* Random weights, with a scale that keeps typical outputs inside int8 */
+static void Bench_LayerRandom(Bench_LayerTypeDef *bl, uint32_t in_ch, uint32_t out_ch, uint32_t taps, int relu)
+{
+  const uint32_t k = taps * in_ch;
+  int32_t shift = -7;
+
+  for (uint32_t v = 1U; v < k; v <<= 2)
+  {
+    shift--;
+  }
+  bl->weights = malloc(k * out_ch);
+  bl->bias = malloc(out_ch * sizeof(int32_t));
+  bl->multiplier = malloc(out_ch * sizeof(int32_t));
+  bl->shift = malloc(out_ch);
+  for (uint32_t i = 0U; i < (k * out_ch); i++)
+  {
+    bl->weights[i] = (int8_t)((int32_t)(Bench_Random() % 255U) - 127);
+  }
+  for (uint32_t o = 0U; o < out_ch; o++)
+  {
+    bl->bias[o] = (int32_t)(Bench_Random() % 20001U) - 10000;
+    bl->multiplier[o] = (int32_t)(0x40000000U | (Bench_Random() & 0x3FFFFFFFU));
+    bl->shift[o] = (int8_t)(shift + (int32_t)(Bench_Random() % 3U) - 1);
+  }
+  bl->layer.in_ch = (uint16_t)in_ch;
+  bl->layer.out_ch = (uint16_t)out_ch;
+  bl->layer.weights = bl->weights;
+  bl->layer.bias = bl->bias;
+  bl->layer.multiplier = bl->multiplier;
+  bl->layer.shift = bl->shift;
+  bl->layer.output_zp = (relu != 0) ? -128 : 3;
+  bl->layer.act_min = (relu != 0) ? -128 : -100;
+  bl->layer.act_max = (relu != 0) ? 127 : 90;
+}
+
+static void Bench_LayerFree(Bench_LayerTypeDef *bl)
+{
+  free(bl->weights);
+  free(bl->bias);
+  free(bl->multiplier);
+  free(bl->shift);
+}
+
+/* Random network in the blob format of convert_model.py */
+static uint8_t *Bench_Synthesize(uint32_t *size)
+{
+  const uint32_t from = offsetof(EmotionNet_BlobHeaderTypeDef, crc) + sizeof(uint16_t);
+  EmotionNet_BlobHeaderTypeDef hdr;
+  EmotionNet_BlobLayerTypeDef rec;
+  Bench_LayerTypeDef bl;
+  uint32_t total = sizeof(hdr) + (EMOTION_NET_LAYERS * sizeof(rec));
+  uint32_t pos;
+  uint8_t *blob;
+
+  for (uint32_t i = 0U; i < EMOTION_NET_LAYERS; i++)
+  {
+    const uint32_t out = bench_shapes[i][1];
+
+    total += ((bench_shapes[i][2] * bench_shapes[i][0] * out) + 3U) & ~3U;
+    total += (8U * out) + ((out + 3U) & ~3U);
+  }
+  blob = calloc(1U, total);
+  pos = sizeof(hdr) + (EMOTION_NET_LAYERS * sizeof(rec));
+  for (uint32_t i = 0U; i < EMOTION_NET_LAYERS; i++)
+  {
+    const uint32_t out = bench_shapes[i][1];
+    const uint32_t wbytes = bench_shapes[i][2] * bench_shapes[i][0] * out;
+    const int last = (i == (EMOTION_NET_LAYERS - 1U));
+
+    Bench_LayerRandom(&bl, bench_shapes[i][0], out, bench_shapes[i][2], 1);
+    memset(&rec, 0, sizeof(rec));
+    rec.in_ch = bench_shapes[i][0];
+    rec.out_ch = (uint16_t)out;
+    rec.output_zp = last ? 0 : -128;
+    rec.act_min = -128;
+    rec.act_max = 127;
+    rec.weights = pos;
+    memcpy(&blob[pos], bl.weights, wbytes);
+    pos += (wbytes + 3U) & ~3U;
+    rec.bias = pos;
+    memcpy(&blob[pos], bl.bias, 4U * out);
+    pos += 4U * out;
+    rec.multiplier = pos;
+    memcpy(&blob[pos], bl.multiplier, 4U * out);
+    pos += 4U * out;
+    rec.shift = pos;
+    memcpy(&blob[pos], bl.shift, out);
+    pos += (out + 3U) & ~3U;
+    memcpy(&blob[sizeof(hdr) + (i * sizeof(rec))], &rec, sizeof(rec));
+    Bench_LayerFree(&bl);
+  }
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = EMOTION_NET_MAGIC;
+  hdr.size = total;
+  hdr.layers = EMOTION_NET_LAYERS;
+  hdr.logit_scale = 0.05f;
+  hdr.logit_zp = 0;
+  memcpy(blob, &hdr, sizeof(hdr));
+  hdr.crc = Frame_Crc16(&blob[from], total - from);
+  memcpy(blob, &hdr, sizeof(hdr));
+  *size = total;
+  return blob;
+}
+
+static uint8_t *Bench_ReadFile(const char *path, uint32_t *size)
+{
+  FILE *f = fopen(path, "rb");
+  uint8_t *data;
+  long len;
+
+  if (f == NULL)
+  {
+    perror(path);
+    return NULL;
+  }
+  (void)fseek(f, 0L, SEEK_END);
+  len = ftell(f);
+  rewind(f);
+  data = (len > 0) ? malloc((size_t)len) : NULL;
+  if ((data == NULL) || (fread(data, 1U, (size_t)len, f) != (size_t)len))
+  {
+    fprintf(stderr, "%s: cannot read\n", path);
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  *size = (uint32_t)len;
+  return data;
+}
+
+static int Bench_WriteFile(const char *path, const uint8_t *data, uint32_t size)
+{
+  FILE *f = fopen(path, "wb");
+  int failed;
+
+  if (f == NULL)
+  {
+    perror(path);
+    return 1;
+  }
+  failed = (fwrite(data, 1U, size, f) != size);
+  failed |= (fclose(f) != 0);
+  if (failed != 0)
+  {
+    fprintf(stderr, "%s: cannot write\n", path);
+  }
+  return failed;
+}
+
+/* Test faces: noise for odd n, smooth gradients and blobs for even n */
+static void Bench_Face(uint8_t *image, uint32_t n)
+{
+  for (uint32_t y = 0U; y < EMOTION_NET_INPUT_SIZE; y++)
+  {
+    for (uint32_t x = 0U; x < EMOTION_NET_INPUT_SIZE; x++)
+    {
+      uint8_t *p = &image[(y * EMOTION_NET_INPUT_SIZE) + x];
+
+      if ((n & 1U) != 0U)
+      {
+        *p = (uint8_t)Bench_Random();
+      }
+      else
+      {
+        const double dx = (double)x - 24.0;
+        const double dy = (double)y - 20.0 - (double)(n % 7U);
+
+        *p = (uint8_t)(128.0 + (100.0 * cos(sqrt((dx * dx) + (dy * dy)) / (2.0 + (double)(n % 5U)))));
+      }
+    }
+  }
+}
+
+static int Bench_Diff(const char *what, const int8_t *a, const int8_t *b, uint32_t n)
+{
+  for (uint32_t i = 0U; i < n; i++)
+  {
+    if (a[i] != b[i])
+    {
+      printf("%s: element %lu is %d, reference %d\n", what, (unsigned long)i, a[i], b[i]);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static uint32_t Bench_Random(void)
+{
+  bench_seed = (bench_seed * 1664525U) + 1013904223U;
+  return bench_seed >> 8;
+}
+
+static void Bench_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-r repeat] [-n images] [-m blob [-v vectors]] [-s out.bin]\n"
+          "  -r     timed inferences (5)\n"
+          "  -n     faces compared with the reference (20)\n"
+          "  -m     blob written by convert_model.py; a random one without\n"
+          "  -v     images and int8 logits written by convert_model.py --vectors\n"
+          "  -s     write the blob that was checked\n",
+          argv0);
+}
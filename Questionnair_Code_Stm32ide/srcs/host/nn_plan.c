@@ -0,0 +1,646 @@
+/**
+  ******************************************************************************
+  * @file           : nn_plan.c
+  * @brief          : Activation memory planner of the emotion CNN.
+  *
+  *                     nn_plan [-o header] [-l ldscript [-f percent]] [-v]
+  *
+  *                   Walks the layer graph of emotion_2.py and lays its
+  *                   activations out in one arena, four ways, each adding
+  *                   to the one before:
+  *
+  *                     separate    every tensor in its own buffer
+  *                     liveness    buffers whose lifetimes do not overlap
+  *                                 share memory (greedy by size, lowest
+  *                                 offset that fits)
+  *                     in-place    Dropout and Flatten reuse their input
+  *                                 buffer, and a max pool writes over the
+  *                                 rows it has read
+  *                     row tiling  a tensor read only by a 3x3 conv or a
+  *                                 2x2 pool keeps just the rows that kernel
+  *                                 is looking at (3 or 2) in a ring; the
+  *                                 rows are produced on demand, so the
+  *                                 conv/pool chain from the input to the
+  *                                 last pool runs as one fused stage and
+  *                                 never holds a whole feature map
+  *
+  *                   Lifetimes are counted in stages: ops joined by a ring
+  *                   run interleaved, so they form one stage. For each plan
+  *                   the arena is reported with the lower bound (largest
+  *                   sum of live bytes in a stage), and every layout is
+  *                   checked for overlapping live buffers. -v lists the
+  *                   bytes live while each layer runs.
+  *
+  *                   -o writes the last plan as emotion_net_plan.h, the
+  *                   tables emotion_net.c executes. -l reads the RAM size
+  *                   from the linker script and fails if the arena takes
+  *                   more than -f percent of it (50).
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "emotion_net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define PLAN_OPS            13U                /* entries of plan_graph */
+#define PLAN_TENSORS        (PLAN_OPS + 1U)
+#define PLAN_SCRATCH        PLAN_TENSORS       /* extra buffer, always live */
+#define PLAN_BUFFERS        (PLAN_TENSORS + 1U)
+#define PLAN_ALIGN(n)       (((n) + 3U) & ~3U)
+
+#define PLAN_REUSE          0x01U
+#define PLAN_INPLACE        0x02U
+#define PLAN_TILED          0x04U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char *name;         /* Keras layer name                            */
+  uint8_t kind;             /* EMOTION_NET_OP_*                            */
+  uint16_t filters;         /* conv filters or dense units                 */
+} Plan_LayerTypeDef;
+
+typedef struct
+{
+  uint16_t height;
+  uint16_t width;
+  uint16_t channels;
+  uint16_t rows;            /* kept in memory                              */
+  uint32_t root;            /* buffer it lives in                          */
+  uint32_t bytes;           /* of its own buffer, if root                  */
+  int32_t first;            /* stages, of its own buffer                   */
+  int32_t last;
+  uint32_t offset;
+} Plan_TensorTypeDef;
+
+typedef struct
+{
+  const char *name;
+  uint32_t flags;
+  Plan_TensorTypeDef t[PLAN_BUFFERS];
+  int32_t stage[PLAN_OPS];
+  int32_t stages;
+  uint32_t arena;
+  uint32_t bound;
+} Plan_TypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+/* The Sequential model of emotion_2.py, input 48x48x1 */
+static const Plan_LayerTypeDef plan_graph[] =
+{
+  { "conv2d",          EMOTION_NET_OP_CONV,     32U   },
+  { "conv2d_1",        EMOTION_NET_OP_CONV,     64U   },
+  { "max_pooling2d",   EMOTION_NET_OP_POOL,     0U    },
+  { "dropout",         EMOTION_NET_OP_IDENTITY, 0U    },
+  { "conv2d_2",        EMOTION_NET_OP_CONV,     128U  },
+  { "max_pooling2d_1", EMOTION_NET_OP_POOL,     0U    },
+  { "conv2d_3",        EMOTION_NET_OP_CONV,     128U  },
+  { "max_pooling2d_2", EMOTION_NET_OP_POOL,     0U    },
+  { "dropout_1",       EMOTION_NET_OP_IDENTITY, 0U    },
+  { "flatten",         EMOTION_NET_OP_IDENTITY, 0U    },
+  { "dense",           EMOTION_NET_OP_DENSE,    1024U },
+  { "dropout_2",       EMOTION_NET_OP_IDENTITY, 0U    },
+  { "dense_1",         EMOTION_NET_OP_DENSE,    EMOTION_NET_CLASSES },
+};
+
+_Static_assert((sizeof(plan_graph) / sizeof(plan_graph[0])) == PLAN_OPS, "PLAN_OPS");
+
+static const char *const plan_kinds[] = { "CONV", "POOL", "DENSE", "IDENTITY" };
+
+/* Private function prototypes -----------------------------------------------*/
+static void Plan_Build(Plan_TypeDef *plan);
+static void Plan_Place(Plan_TypeDef *plan);
+static int Plan_Verify(const Plan_TypeDef *plan);
+static uint32_t Plan_Live(const Plan_TypeDef *plan, int32_t stage);
+static void Plan_Report(const Plan_TypeDef *plan, int verbose);
+static int Plan_Write(const Plan_TypeDef *plan, const char *path);
+static long Plan_RamBytes(const char *ldscript);
+static void Plan_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+void Error_Handler(void)
+{
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  static Plan_TypeDef plans[4] =
+  {
+    { .name = "separate", .flags = 0U },
+    { .name = "liveness", .flags = PLAN_REUSE },
+    { .name = "liveness + in-place", .flags = PLAN_REUSE | PLAN_INPLACE },
+    { .name = "liveness + in-place + row tiling", .flags = PLAN_REUSE | PLAN_INPLACE | PLAN_TILED },
+  };
+  const Plan_TypeDef *best = &plans[3];
+  const char *header = NULL;
+  const char *ldscript = NULL;
+  long percent = 50;
+  int verbose = 0;
+  int failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "o:l:f:vh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'o':
+        header = optarg;
+        break;
+      case 'l':
+        ldscript = optarg;
+        break;
+      case 'f':
+        percent = strtol(optarg, NULL, 0);
+        break;
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        Plan_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  for (uint32_t p = 0U; p < 4U; p++)
+  {
+    Plan_Build(&plans[p]);
+    Plan_Place(&plans[p]);
+    failed |= Plan_Verify(&plans[p]);
+    Plan_Report(&plans[p], verbose);
+  }
+  printf("%s: arena %lu bytes, %.1fx smaller than separate buffers\n", best->name, (unsigned long)best->arena,
+         (double)plans[0].arena / (double)best->arena);
+
+  if (ldscript != NULL)
+  {
+    const long ram = Plan_RamBytes(ldscript);
+
+    if (ram <= 0)
+    {
+      fprintf(stderr, "%s: no RAM region\n", ldscript);
+      return EXIT_FAILURE;
+    }
+    printf("%s: RAM %ld bytes, arena %.1f %% of it (limit %ld %%)\n", ldscript, ram,
+           100.0 * (double)best->arena / (double)ram, percent);
+    if (((long)best->arena * 100L) > (ram * percent))
+    {
+      failed = 1;
+    }
+  }
+  if ((header != NULL) && (Plan_Write(best, header) != 0))
+  {
+    failed = 1;
+  }
+  return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Shapes, aliases, rings, stages and lifetimes */
+static void Plan_Build(Plan_TypeDef *plan)
+{
+  Plan_TensorTypeDef *t = plan->t;
+  uint32_t scratch = 0U;
+
+  memset(t, 0, sizeof(plan->t));
+  t[0].height = EMOTION_NET_INPUT_SIZE;
+  t[0].width = EMOTION_NET_INPUT_SIZE;
+  t[0].channels = 1U;
+  for (uint32_t i = 0U; i < PLAN_TENSORS; i++)
+  {
+    t[i].root = i;
+  }
+
+  /* shapes, kernel scratch, and the ops that never need a buffer */
+  for (uint32_t i = 0U; i < PLAN_OPS; i++)
+  {
+    const Plan_LayerTypeDef *op = &plan_graph[i];
+    const Plan_TensorTypeDef *in = &t[i];
+    Plan_TensorTypeDef *out = &t[i + 1U];
+    uint32_t need = 0U;
+
+    switch (op->kind)
+    {
+      case EMOTION_NET_OP_CONV:
+        out->height = in->height - 2U;
+        out->width = in->width - 2U;
+        out->channels = op->filters;
+        need = 2U * NN_KERNELS_CONV_SCRATCH(in->channels);
+        break;
+      case EMOTION_NET_OP_POOL:
+        out->height = in->height / 2U;
+        out->width = in->width / 2U;
+        out->channels = in->channels;
+        break;
+      case EMOTION_NET_OP_DENSE:
+        out->height = 1U;
+        out->width = 1U;
+        out->channels = op->filters;
+        need = 2U * NN_KERNELS_DENSE_SCRATCH((uint32_t)in->height * in->width * in->channels);
+        break;
+      default:
+        /* Dropout keeps the shape, Flatten only follows a pool */
+        if (strncmp(op->name, "flatten", 7U) == 0)
+        {
+          out->height = 1U;
+          out->width = 1U;
+          out->channels = (uint16_t)((uint32_t)in->height * in->width * in->channels);
+        }
+        else
+        {
+          out->height = in->height;
+          out->width = in->width;
+          out->channels = in->channels;
+        }
+        if ((plan->flags & PLAN_INPLACE) != 0U)
+        {
+          out->root = in->root;
+        }
+        break;
+    }
+    scratch = (need > scratch) ? need : scratch;
+  }
+
+  /* rows kept: a ring when the buffer is only read by a conv or a pool.
+     The input is written whole before the run and the logits read after */
+  for (uint32_t r = 0U; r < PLAN_TENSORS; r++)
+  {
+    uint32_t reader = PLAN_OPS;
+
+    for (uint32_t i = r; i < PLAN_OPS; i++)
+    {
+      if (t[i].root == r)
+      {
+        reader = i;
+      }
+    }
+    t[r].rows = t[r].height;
+    if (((plan->flags & PLAN_TILED) != 0U) && (r != 0U) && (reader < PLAN_OPS))
+    {
+      if (plan_graph[reader].kind == EMOTION_NET_OP_CONV)
+      {
+        t[r].rows = 3U;
+      }
+      else if (plan_graph[reader].kind == EMOTION_NET_OP_POOL)
+      {
+        t[r].rows = 2U;
+      }
+    }
+  }
+  for (uint32_t i = 0U; i < PLAN_TENSORS; i++)
+  {
+    const Plan_TensorTypeDef *own = &t[t[i].root];
+
+    t[i].rows = (own->rows < own->height) ? own->rows : t[i].height;
+  }
+
+  /* a pool can write over a whole input it has finished reading */
+  for (uint32_t i = 0U; i < PLAN_OPS; i++)
+  {
+    const uint32_t root = t[i].root;
+
+    if (((plan->flags & PLAN_INPLACE) != 0U) && (plan_graph[i].kind == EMOTION_NET_OP_POOL)
+        && (t[root].rows == t[root].height) && (root != 0U))
+    {
+      t[i + 1U].root = root;
+      t[i + 1U].rows = t[i + 1U].height;
+    }
+  }
+  /* later aliases follow the buffer their input moved to */
+  for (uint32_t i = 1U; i < PLAN_TENSORS; i++)
+  {
+    t[i].root = t[t[i].root].root;
+  }
+
+  /* stages: ops joined by a ring run interleaved */
+  plan->stage[0] = 0;
+  for (uint32_t i = 1U; i < PLAN_OPS; i++)
+  {
+    const uint32_t root = t[i].root;
+    const int fused = (plan_graph[i].kind == EMOTION_NET_OP_IDENTITY) || (t[root].rows < t[root].height);
+
+    plan->stage[i] = plan->stage[i - 1U] + (fused ? 0 : 1);
+  }
+  plan->stages = plan->stage[PLAN_OPS - 1U] + 1;
+
+  /* lifetimes of the buffers: from their producer to their last reader */
+  for (uint32_t i = 0U; i < PLAN_TENSORS; i++)
+  {
+    t[i].first = -1;
+  }
+  for (uint32_t i = 0U; i < PLAN_TENSORS; i++)
+  {
+    Plan_TensorTypeDef *own = &t[t[i].root];
+    const int32_t made = (i == 0U) ? 0 : plan->stage[i - 1U];
+    const int32_t read = (i < PLAN_OPS) ? plan->stage[i] : (plan->stages - 1);
+
+    if (own->first < 0)
+    {
+      own->first = made;
+      own->last = made;
+    }
+    own->last = (read > own->last) ? read : own->last;
+    if (t[i].root == i)
+    {
+      own->bytes = PLAN_ALIGN((uint32_t)t[i].rows * t[i].width * t[i].channels);
+    }
+  }
+  t[PLAN_SCRATCH].root = PLAN_SCRATCH;
+  t[PLAN_SCRATCH].bytes = PLAN_ALIGN(scratch);
+  t[PLAN_SCRATCH].first = 0;
+  t[PLAN_SCRATCH].last = plan->stages - 1;
+}
+
+/* Offsets: largest buffer first, at the lowest offset clear of every
+   buffer already placed that is live at the same time */
+static void Plan_Place(Plan_TypeDef *plan)
+{
+  Plan_TensorTypeDef *t = plan->t;
+  uint32_t order[PLAN_BUFFERS];
+  uint32_t count = 0U;
+
+  for (uint32_t i = 0U; i < PLAN_BUFFERS; i++)
+  {
+    if (t[i].root == i)
+    {
+      order[count++] = i;
+    }
+  }
+  for (uint32_t a = 1U; a < count; a++)
+  {
+    for (uint32_t b = a; (b > 0U) && (t[order[b]].bytes > t[order[b - 1U]].bytes); b--)
+    {
+      const uint32_t tmp = order[b];
+
+      order[b] = order[b - 1U];
+      order[b - 1U] = tmp;
+    }
+  }
+
+  plan->arena = 0U;
+  for (uint32_t n = 0U; n < count; n++)
+  {
+    Plan_TensorTypeDef *cur = &t[order[n]];
+    uint32_t best = UINT32_MAX;
+
+    for (uint32_t c = 0U; c <= n; c++)
+    {
+      const uint32_t at = (c == 0U) ? 0U : (t[order[c - 1U]].offset + t[order[c - 1U]].bytes);
+      int clear = 1;
+
+      if ((plan->flags & PLAN_REUSE) == 0U)
+      {
+        /* separate: after everything placed so far */
+        if (c != n)
+        {
+          continue;
+        }
+        best = plan->arena;
+        break;
+      }
+      for (uint32_t m = 0U; (m < n) && (clear != 0); m++)
+      {
+        const Plan_TensorTypeDef *o = &t[order[m]];
+
+        if ((o->first <= cur->last) && (cur->first <= o->last)
+            && (at < (o->offset + o->bytes)) && (o->offset < (at + cur->bytes)))
+        {
+          clear = 0;
+        }
+      }
+      if ((clear != 0) && (at < best))
+      {
+        best = at;
+      }
+    }
+    cur->offset = best;
+    plan->arena = ((best + cur->bytes) > plan->arena) ? (best + cur->bytes) : plan->arena;
+  }
+  for (uint32_t i = 0U; i < PLAN_TENSORS; i++)
+  {
+    t[i].offset = t[t[i].root].offset;
+  }
+
+  plan->bound = 0U;
+  for (int32_t s = 0; s < plan->stages; s++)
+  {
+    const uint32_t live = Plan_Live(plan, s);
+
+    plan->bound = (live > plan->bound) ? live : plan->bound;
+  }
+}
+
+/* No two buffers live in the same stage may overlap, and the rings must
+   hold what their reader looks at */
+static int Plan_Verify(const Plan_TypeDef *plan)
+{
+  const Plan_TensorTypeDef *t = plan->t;
+  int failed = 0;
+
+  for (uint32_t a = 0U; a < PLAN_BUFFERS; a++)
+  {
+    for (uint32_t b = a + 1U; b < PLAN_BUFFERS; b++)
+    {
+      if ((t[a].root == a) && (t[b].root == b) && (t[a].first <= t[b].last) && (t[b].first <= t[a].last)
+          && (t[a].offset < (t[b].offset + t[b].bytes)) && (t[b].offset < (t[a].offset + t[a].bytes)))
+      {
+        printf("%s: buffers %lu and %lu overlap\n", plan->name, (unsigned long)a, (unsigned long)b);
+        failed = 1;
+      }
+    }
+  }
+  for (uint32_t i = 0U; i < PLAN_OPS; i++)
+  {
+    const uint8_t kind = plan_graph[i].kind;
+    uint32_t window = t[i].height;
+
+    if (kind == EMOTION_NET_OP_CONV)
+    {
+      window = 3U;
+    }
+    else if (kind == EMOTION_NET_OP_POOL)
+    {
+      window = 2U;
+    }
+    else if ((kind == EMOTION_NET_OP_IDENTITY) && (t[i + 1U].height == t[i].height))
+    {
+      window = 1U;
+    }
+
+    if ((t[i].rows < window) || ((t[i].rows < t[i].height) && (kind != EMOTION_NET_OP_IDENTITY)
+                                 && (t[i].root == t[i + 1U].root)))
+    {
+      printf("%s: %s cannot read its input\n", plan->name, plan_graph[i].name);
+      failed = 1;
+    }
+  }
+  if ((t[0].rows != t[0].height) || (t[PLAN_OPS].rows != t[PLAN_OPS].height))
+  {
+    printf("%s: input and output must be whole\n", plan->name);
+    failed = 1;
+  }
+  return failed;
+}
+
+/* Bytes of the buffers live in a stage */
+static uint32_t Plan_Live(const Plan_TypeDef *plan, int32_t stage)
+{
+  uint32_t live = 0U;
+
+  for (uint32_t i = 0U; i < PLAN_BUFFERS; i++)
+  {
+    if ((plan->t[i].root == i) && (plan->t[i].first <= stage) && (stage <= plan->t[i].last))
+    {
+      live += plan->t[i].bytes;
+    }
+  }
+  return live;
+}
+
+static void Plan_Report(const Plan_TypeDef *plan, int verbose)
+{
+  printf("%-34s arena %7lu bytes, lower bound %7lu, %ld stages\n", plan->name, (unsigned long)plan->arena,
+         (unsigned long)plan->bound, (long)plan->stages);
+  if (verbose == 0)
+  {
+    return;
+  }
+  printf("  %-16s %-9s %-12s %5s %8s %8s %8s\n", "layer", "op", "output", "rows", "bytes", "offset", "live");
+  for (uint32_t i = 0U; i < PLAN_OPS; i++)
+  {
+    const Plan_TensorTypeDef *out = &plan->t[i + 1U];
+    char shape[24];
+
+    snprintf(shape, sizeof(shape), "%ux%ux%u", out->height, out->width, out->channels);
+    printf("  %-16s %-9s %-12s %5u %8lu %8lu %8lu\n", plan_graph[i].name, plan_kinds[plan_graph[i].kind], shape,
+           out->rows, (out->root == (i + 1U)) ? (unsigned long)out->bytes : 0UL, (unsigned long)out->offset,
+           (unsigned long)Plan_Live(plan, plan->stage[i]));
+  }
+}
+
+/* emotion_net_plan.h */
+static int Plan_Write(const Plan_TypeDef *plan, const char *path)
+{
+  const Plan_TensorTypeDef *t = plan->t;
+  FILE *f = fopen(path, "w");
+  uint32_t layer = 0U;
+
+  if (f == NULL)
+  {
+    perror(path);
+    return 1;
+  }
+  fprintf(f,
+          "/**\n"
+          "  ******************************************************************************\n"
+          "  * @file           : emotion_net_plan.h\n"
+          "  * @brief          : Activation plan of the emotion CNN, generated by\n"
+          "  *                   host/nn_plan (%s).\n"
+          "  *                   Run make plan in srcs/host after changing the graph;\n"
+          "  *                   do not edit.\n"
+          "  ******************************************************************************\n"
+          "  */\n\n"
+          "/* Define to prevent recursive inclusion -------------------------------------*/\n"
+          "#ifndef __EMOTION_NET_PLAN_H\n"
+          "#define __EMOTION_NET_PLAN_H\n\n"
+          "/* Exported constants --------------------------------------------------------*/\n"
+          "/* %lu bytes, the lower bound is %lu */\n"
+          "#define EMOTION_NET_ARENA_BYTES     %luU\n"
+          "#define EMOTION_NET_SCRATCH_OFFSET  %luU\n"
+          "#define EMOTION_NET_TENSORS         %luU\n"
+          "#define EMOTION_NET_OPS             %luU\n"
+          "#define EMOTION_NET_OUTPUT          %luU\n\n",
+          plan->name, (unsigned long)plan->arena, (unsigned long)plan->bound, (unsigned long)plan->arena, (unsigned long)t[PLAN_SCRATCH].offset,
+          (unsigned long)PLAN_TENSORS, (unsigned long)PLAN_OPS, (unsigned long)PLAN_OPS);
+
+  fprintf(f, "/* height, width, channels, rows kept, arena offset, producing op */\n"
+             "#define EMOTION_NET_PLAN_TENSORS \\\n{ \\\n");
+  for (uint32_t i = 0U; i < PLAN_TENSORS; i++)
+  {
+    char entry[64];
+
+    snprintf(entry, sizeof(entry), "{ %uU, %uU, %uU, %uU, %luU, %ld },", t[i].height, t[i].width, t[i].channels,
+             t[i].rows, (unsigned long)t[i].offset, (long)i - 1L);
+    fprintf(f, "  %-44s /* %-16s */ \\\n", entry, (i == 0U) ? "input" : plan_graph[i - 1U].name);
+  }
+  fprintf(f, "}\n\n");
+
+  fprintf(f, "/* kind, layer with weights, input tensor, output tensor; bytes live */\n"
+             "#define EMOTION_NET_PLAN_OPS \\\n{ \\\n");
+  for (uint32_t i = 0U; i < PLAN_OPS; i++)
+  {
+    static const char *const kinds[] =
+    {
+      "EMOTION_NET_OP_CONV", "EMOTION_NET_OP_POOL", "EMOTION_NET_OP_DENSE", "EMOTION_NET_OP_IDENTITY",
+    };
+    const uint8_t kind = plan_graph[i].kind;
+    char entry[64];
+
+    snprintf(entry, sizeof(entry), "{ %s, %luU, %luU, %luU },", kinds[kind],
+             ((kind == EMOTION_NET_OP_CONV) || (kind == EMOTION_NET_OP_DENSE)) ? (unsigned long)layer : 0UL,
+             (unsigned long)i, (unsigned long)(i + 1U));
+    fprintf(f, "  %-44s /* %-16s %6lu */ \\\n", entry, plan_graph[i].name,
+            (unsigned long)Plan_Live(plan, plan->stage[i]));
+    if ((kind == EMOTION_NET_OP_CONV) || (kind == EMOTION_NET_OP_DENSE))
+    {
+      layer++;
+    }
+  }
+  fprintf(f, "}\n\n#endif /* __EMOTION_NET_PLAN_H */\n");
+  if (fclose(f) != 0)
+  {
+    perror(path);
+    return 1;
+  }
+  return 0;
+}
+
+/* LENGTH of the RAM region of a GNU ld script, in bytes */
+static long Plan_RamBytes(const char *ldscript)
+{
+  FILE *f = fopen(ldscript, "r");
+  char line[256];
+  long bytes = -1;
+
+  if (f == NULL)
+  {
+    perror(ldscript);
+    return -1;
+  }
+  while ((bytes < 0) && (fgets(line, sizeof(line), f) != NULL))
+  {
+    char name[32];
+    char *len = strstr(line, "LENGTH");
+
+    if ((len != NULL) && (sscanf(line, " %31s", name) == 1) && (strcmp(name, "RAM") == 0))
+    {
+      char *end;
+
+      len = strchr(len, '=');
+      if (len != NULL)
+      {
+        bytes = strtol(len + 1, &end, 0);
+        bytes *= (*end == 'K') ? 1024L : ((*end == 'M') ? (1024L * 1024L) : 1L);
+      }
+    }
+  }
+  fclose(f);
+  return bytes;
+}
+
+static void Plan_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-o header] [-l ldscript [-f percent]] [-v]\n"
+          "  -o     write the tiled plan as emotion_net_plan.h\n"
+          "  -l     check the arena against the RAM region of this linker script\n"
+          "  -f     largest share of RAM the arena may take (50)\n"
+          "  -v     bytes live while each layer runs\n",
+          argv0);
+}
@@ -0,0 +1,527 @@
+/**
+  ******************************************************************************
+  * @file           : score_plan.c
+  * @brief          : Scoring table generator of the questionnaire.
+  *
+  *                     score_plan [-o header] [-t] [-v]
+  *
+  *                   Reads the instruments of ../questionnaire_scales.h,
+  *                   works out the lowest and highest score each can
+  *                   reach from its sections, and checks that its bands
+  *                   are ascending and cover that range exactly once: no
+  *                   gap, no overlap, nothing left over at either end.
+  *
+  *                   -o writes questionnaire_plan.h: the sections of all
+  *                   instruments in one table, and one band entry per
+  *                   reachable score, so questionnaire.c classifies a
+  *                   score with a single index. -t also feeds the checker
+  *                   broken instruments and fails unless it rejects each
+  *                   of them. -v lists the bands.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "questionnaire_scales.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SCORE_SCALES        (sizeof(questionnaire_scales) / sizeof(questionnaire_scales[0]))
+#define SCORE_ROW           16U     /* band entries per line of the header */
+
+/* Private variables ---------------------------------------------------------*/
+static const char *const score_patterns[LED_PATTERN_COUNT] =
+{
+  "slow", "medium", "fast"
+};
+
+_Static_assert(LED_PATTERN_COUNT == 3, "score_patterns");
+_Static_assert(QUESTIONNAIRE_BUTTONS == 5, "Score_Write");
+
+/* Broken instruments for -t, each with one fault, on scores 0..4 */
+static const Questionnaire_SectionTypeDef broken_sections[] =
+{
+  { 0U, 3U, { 0U, 1U, 0U, 0U, 0U } }
+};
+
+static const Questionnaire_SectionTypeDef broken_sections_range[] =
+{
+  { 2U, 4U, { 0U, 1U, 0U, 0U, 0U } }
+};
+
+static const Questionnaire_BandTypeDef broken_gap[] =
+{
+  { 0U, 1U, LED_PATTERN_SLOW }, { 3U, 4U, LED_PATTERN_FAST }
+};
+
+static const Questionnaire_BandTypeDef broken_overlap[] =
+{
+  { 0U, 2U, LED_PATTERN_SLOW }, { 2U, 4U, LED_PATTERN_FAST }
+};
+
+static const Questionnaire_BandTypeDef broken_low[] =
+{
+  { 1U, 4U, LED_PATTERN_SLOW }
+};
+
+static const Questionnaire_BandTypeDef broken_high[] =
+{
+  { 0U, 3U, LED_PATTERN_SLOW }
+};
+
+static const Questionnaire_BandTypeDef broken_beyond[] =
+{
+  { 0U, 2U, LED_PATTERN_SLOW }, { 3U, 9U, LED_PATTERN_FAST }
+};
+
+static const Questionnaire_BandTypeDef broken_reversed[] =
+{
+  { 0U, 4U, LED_PATTERN_SLOW }, { 3U, 2U, LED_PATTERN_FAST }
+};
+
+static const Questionnaire_BandTypeDef broken_pattern[] =
+{
+  { 0U, 4U, LED_PATTERN_COUNT }
+};
+
+static const Questionnaire_BandTypeDef broken_none[] =
+{
+  { 0U, 4U, LED_PATTERN_SLOW }
+};
+
+static const Questionnaire_ScaleTypeDef broken_scales[] =
+{
+  { "gap", 4U, 0U, 0U, QUESTIONNAIRE_SCALE_ENTRIES(broken_sections), QUESTIONNAIRE_SCALE_ENTRIES(broken_gap) },
+  { "overlap", 4U, 0U, 0U, QUESTIONNAIRE_SCALE_ENTRIES(broken_sections),
+    QUESTIONNAIRE_SCALE_ENTRIES(broken_overlap) },
+  { "low end", 4U, 0U, 0U, QUESTIONNAIRE_SCALE_ENTRIES(broken_sections), QUESTIONNAIRE_SCALE_ENTRIES(broken_low) },
+  { "high end", 4U, 0U, 0U, QUESTIONNAIRE_SCALE_ENTRIES(broken_sections),
+    QUESTIONNAIRE_SCALE_ENTRIES(broken_high) },
+  { "beyond", 4U, 0U, 0U, QUESTIONNAIRE_SCALE_ENTRIES(broken_sections),
+    QUESTIONNAIRE_SCALE_ENTRIES(broken_beyond) },
+  { "reversed", 4U, 0U, 0U, QUESTIONNAIRE_SCALE_ENTRIES(broken_sections),
+    QUESTIONNAIRE_SCALE_ENTRIES(broken_reversed) },
+  { "pattern", 4U, 0U, 0U, QUESTIONNAIRE_SCALE_ENTRIES(broken_sections),
+    QUESTIONNAIRE_SCALE_ENTRIES(broken_pattern) },
+  { "no bands", 4U, 0U, 0U, QUESTIONNAIRE_SCALE_ENTRIES(broken_sections), 0U, NULL },
+  { "section", 4U, 0U, 0U, QUESTIONNAIRE_SCALE_ENTRIES(broken_sections_range),
+    QUESTIONNAIRE_SCALE_ENTRIES(broken_none) },
+  { "lux button", 4U, 100U, 6U, QUESTIONNAIRE_SCALE_ENTRIES(broken_sections),
+    QUESTIONNAIRE_SCALE_ENTRIES(broken_none) },
+};
+
+/* Private function prototypes -----------------------------------------------*/
+static void Score_Range(const Questionnaire_ScaleTypeDef *scale, uint32_t *lo, uint32_t *hi);
+static int Score_Check(const Questionnaire_ScaleTypeDef *scale, FILE *out);
+static int Score_SelfTest(int verbose);
+static void Score_Report(const Questionnaire_ScaleTypeDef *scale);
+static const char *Score_PatternName(uint8_t pattern);
+static int Score_Write(const char *path);
+static void Score_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+void Error_Handler(void)
+{
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *header = NULL;
+  int self_test = 0;
+  int verbose = 0;
+  int failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "o:tvh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'o':
+        header = optarg;
+        break;
+      case 't':
+        self_test = 1;
+        break;
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        Score_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  if (SCORE_SCALES != (uint32_t)QUESTIONNAIRE_AGE_COUNT)
+  {
+    fprintf(stderr, "score_plan: %lu instruments for %u age groups\n", (unsigned long)SCORE_SCALES,
+            (unsigned)QUESTIONNAIRE_AGE_COUNT);
+    failed = 1;
+  }
+  for (uint32_t i = 0U; i < SCORE_SCALES; i++)
+  {
+    failed |= Score_Check(&questionnaire_scales[i], stderr);
+    if (verbose != 0)
+    {
+      Score_Report(&questionnaire_scales[i]);
+    }
+  }
+  if (self_test != 0)
+  {
+    failed |= Score_SelfTest(verbose);
+  }
+  if (failed != 0)
+  {
+    return EXIT_FAILURE;
+  }
+  printf("score_plan: %lu instruments, bands complete and disjoint\n", (unsigned long)SCORE_SCALES);
+  if ((header != NULL) && (Score_Write(header) != 0))
+  {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+/* Lowest and highest score: each question weighs as its first section, as
+   Questionnaire_Weight() scores it, and 0 outside every section */
+static void Score_Range(const Questionnaire_ScaleTypeDef *scale, uint32_t *lo, uint32_t *hi)
+{
+  *lo = 0U;
+  *hi = 0U;
+  for (uint32_t q = 0U; q < scale->questions; q++)
+  {
+    for (uint32_t n = 0U; n < scale->nb_sections; n++)
+    {
+      const Questionnaire_SectionTypeDef *sec = &scale->sections[n];
+
+      if ((q >= sec->first) && (q <= sec->last))
+      {
+        uint32_t min = 0xFFU;
+        uint32_t max = 0U;
+
+        for (uint32_t b = 0U; b < QUESTIONNAIRE_BUTTONS; b++)
+        {
+          min = (sec->weight[b] < min) ? sec->weight[b] : min;
+          max = (sec->weight[b] > max) ? sec->weight[b] : max;
+        }
+        *lo += min;
+        *hi += max;
+        break;
+      }
+    }
+  }
+}
+
+/* Faults of an instrument, reported on out if not NULL; 1 if any */
+static int Score_Check(const Questionnaire_ScaleTypeDef *scale, FILE *out)
+{
+  uint32_t lo;
+  uint32_t hi;
+  uint32_t next;
+  int failed = 0;
+
+  if (scale->questions == 0U)
+  {
+    if (out != NULL)
+    {
+      fprintf(out, "score_plan: %s: no questions\n", scale->name);
+    }
+    return 1;
+  }
+  for (uint32_t n = 0U; n < scale->nb_sections; n++)
+  {
+    if ((scale->sections[n].first > scale->sections[n].last) || (scale->sections[n].last >= scale->questions))
+    {
+      if (out != NULL)
+      {
+        fprintf(out, "score_plan: %s: section %lu is questions %u..%u of %u\n", scale->name, (unsigned long)n,
+                scale->sections[n].first, scale->sections[n].last, scale->questions);
+      }
+      failed = 1;
+    }
+  }
+  if ((scale->lux_threshold != 0U) && ((scale->lux_button == 0U) || (scale->lux_button > QUESTIONNAIRE_BUTTONS)))
+  {
+    if (out != NULL)
+    {
+      fprintf(out, "score_plan: %s: lux answers with button %u\n", scale->name, scale->lux_button);
+    }
+    failed = 1;
+  }
+
+  Score_Range(scale, &lo, &hi);
+  if (hi > 0xFFFFU)
+  {
+    if (out != NULL)
+    {
+      fprintf(out, "score_plan: %s: scores up to %lu do not fit 16 bits\n", scale->name, (unsigned long)hi);
+    }
+    return 1;
+  }
+  if (scale->nb_bands == 0U)
+  {
+    if (out != NULL)
+    {
+      fprintf(out, "score_plan: %s: no bands for scores %lu..%lu\n", scale->name, (unsigned long)lo,
+              (unsigned long)hi);
+    }
+    return 1;
+  }
+
+  /* Scores below next are covered */
+  next = lo;
+  for (uint32_t n = 0U; n < scale->nb_bands; n++)
+  {
+    const Questionnaire_BandTypeDef *band = &scale->bands[n];
+
+    if ((band->pattern >= LED_PATTERN_COUNT) && (band->pattern != QUESTIONNAIRE_NO_BAND))
+    {
+      if (out != NULL)
+      {
+        fprintf(out, "score_plan: %s: band %u..%u has pattern %u\n", scale->name, band->lo, band->hi,
+                band->pattern);
+      }
+      failed = 1;
+    }
+    if (band->lo > band->hi)
+    {
+      if (out != NULL)
+      {
+        fprintf(out, "score_plan: %s: band %u..%u is empty\n", scale->name, band->lo, band->hi);
+      }
+      failed = 1;
+      continue;
+    }
+    if (band->lo > next)
+    {
+      if (out != NULL)
+      {
+        fprintf(out, "score_plan: %s: scores %lu..%u have no band\n", scale->name, (unsigned long)next,
+                band->lo - 1U);
+      }
+      failed = 1;
+    }
+    else if (band->lo < next)
+    {
+      if (out != NULL)
+      {
+        if (band->lo < lo)
+        {
+          fprintf(out, "score_plan: %s: band %u..%u starts below the lowest score %lu\n", scale->name, band->lo,
+                  band->hi, (unsigned long)lo);
+        }
+        else
+        {
+          fprintf(out, "score_plan: %s: band %u..%u overlaps scores up to %lu\n", scale->name, band->lo,
+                  band->hi, (unsigned long)(next - 1U));
+        }
+      }
+      failed = 1;
+    }
+    if ((uint32_t)band->hi + 1U > next)
+    {
+      next = (uint32_t)band->hi + 1U;
+    }
+  }
+  if (next <= hi)
+  {
+    if (out != NULL)
+    {
+      fprintf(out, "score_plan: %s: scores %lu..%lu have no band\n", scale->name, (unsigned long)next,
+              (unsigned long)hi);
+    }
+    failed = 1;
+  }
+  else if (next > hi + 1U)
+  {
+    if (out != NULL)
+    {
+      fprintf(out, "score_plan: %s: bands go up to %lu, the highest score is %lu\n", scale->name,
+              (unsigned long)(next - 1U), (unsigned long)hi);
+    }
+    failed = 1;
+  }
+  return failed;
+}
+
+/* Every broken instrument must be rejected */
+static int Score_SelfTest(int verbose)
+{
+  const uint32_t count = sizeof(broken_scales) / sizeof(broken_scales[0]);
+  int failed = 0;
+
+  for (uint32_t i = 0U; i < count; i++)
+  {
+    if (Score_Check(&broken_scales[i], (verbose != 0) ? stdout : NULL) == 0)
+    {
+      fprintf(stderr, "score_plan: broken instrument \"%s\" accepted\n", broken_scales[i].name);
+      failed = 1;
+    }
+  }
+  if (failed == 0)
+  {
+    printf("score_plan: %lu broken instruments rejected\n", (unsigned long)count);
+  }
+  return failed;
+}
+
+static void Score_Report(const Questionnaire_ScaleTypeDef *scale)
+{
+  uint32_t lo;
+  uint32_t hi;
+
+  Score_Range(scale, &lo, &hi);
+  printf("%s: %u questions, scores %lu..%lu\n", scale->name, scale->questions, (unsigned long)lo,
+         (unsigned long)hi);
+  for (uint32_t n = 0U; n < scale->nb_bands; n++)
+  {
+    printf("  %5u..%-5u %s\n", scale->bands[n].lo, scale->bands[n].hi, Score_PatternName(scale->bands[n].pattern));
+  }
+}
+
+static const char *Score_PatternName(uint8_t pattern)
+{
+  if (pattern == QUESTIONNAIRE_NO_BAND)
+  {
+    return "no result";
+  }
+  return (pattern < LED_PATTERN_COUNT) ? score_patterns[pattern] : "?";
+}
+
+/* Profiles, sections and one band entry per reachable score */
+static int Score_Write(const char *path)
+{
+  FILE *f = fopen(path, "w");
+  uint32_t sections = 0U;
+  uint32_t entries = 0U;
+
+  if (f == NULL)
+  {
+    perror(path);
+    return 1;
+  }
+  for (uint32_t i = 0U; i < SCORE_SCALES; i++)
+  {
+    uint32_t lo;
+    uint32_t hi;
+
+    Score_Range(&questionnaire_scales[i], &lo, &hi);
+    sections += questionnaire_scales[i].nb_sections;
+    entries += hi - lo + 1U;
+  }
+  fprintf(f,
+          "/**\n"
+          "  ******************************************************************************\n"
+          "  * @file           : questionnaire_plan.h\n"
+          "  * @brief          : Scoring tables of the questionnaire, generated by\n"
+          "  *                   host/score_plan from questionnaire_scales.h.\n"
+          "  *                   Run make scores in srcs/host after changing the\n"
+          "  *                   instruments; do not edit.\n"
+          "  ******************************************************************************\n"
+          "  */\n\n"
+          "/* Define to prevent recursive inclusion -------------------------------------*/\n"
+          "#ifndef __QUESTIONNAIRE_PLAN_H\n"
+          "#define __QUESTIONNAIRE_PLAN_H\n\n"
+          "/* Exported constants --------------------------------------------------------*/\n"
+          "#define QUESTIONNAIRE_PROFILES      %luU\n"
+          "#define QUESTIONNAIRE_SECTIONS      %luU\n"
+          "#define QUESTIONNAIRE_BAND_ENTRIES  %luU\n\n",
+          (unsigned long)SCORE_SCALES, (unsigned long)sections, (unsigned long)entries);
+
+  fprintf(f, "/* questions, first section, sections, lux button, lux threshold, lowest and\n"
+             "   highest score, band entry of the lowest */\n"
+             "#define QUESTIONNAIRE_PLAN_PROFILES \\\n{ \\\n");
+  sections = 0U;
+  entries = 0U;
+  for (uint32_t i = 0U; i < SCORE_SCALES; i++)
+  {
+    const Questionnaire_ScaleTypeDef *scale = &questionnaire_scales[i];
+    uint32_t lo;
+    uint32_t hi;
+    char entry[128];
+
+    Score_Range(scale, &lo, &hi);
+    snprintf(entry, sizeof(entry), "{ %uU, %luU, %uU, %uU, %uU, %luU, %luU, %luU },", scale->questions,
+             (unsigned long)sections, scale->nb_sections, scale->lux_button, scale->lux_threshold,
+             (unsigned long)lo, (unsigned long)hi, (unsigned long)entries);
+    fprintf(f, "  %-52s /* %-8s */ \\\n", entry, scale->name);
+    sections += scale->nb_sections;
+    entries += hi - lo + 1U;
+  }
+  fprintf(f, "}\n\n");
+
+  fprintf(f, "/* questions first..last, weight of each button */\n"
+             "#define QUESTIONNAIRE_PLAN_SECTIONS \\\n{ \\\n");
+  for (uint32_t i = 0U; i < SCORE_SCALES; i++)
+  {
+    const Questionnaire_ScaleTypeDef *scale = &questionnaire_scales[i];
+
+    for (uint32_t n = 0U; n < scale->nb_sections; n++)
+    {
+      const Questionnaire_SectionTypeDef *sec = &scale->sections[n];
+      char entry[80];
+
+      snprintf(entry, sizeof(entry), "{ %uU, %uU, { %uU, %uU, %uU, %uU, %uU } },", sec->first, sec->last,
+               sec->weight[0], sec->weight[1], sec->weight[2], sec->weight[3], sec->weight[4]);
+      fprintf(f, "  %-52s /* %-8s */ \\\n", entry, scale->name);
+    }
+  }
+  fprintf(f, "}\n\n");
+
+  fprintf(f, "/* LED pattern of each score, QUESTIONNAIRE_NO_BAND (255) for no result */\n"
+             "#define QUESTIONNAIRE_PLAN_BANDS \\\n{ \\\n");
+  for (uint32_t i = 0U; i < SCORE_SCALES; i++)
+  {
+    const Questionnaire_ScaleTypeDef *scale = &questionnaire_scales[i];
+    uint32_t lo;
+    uint32_t hi;
+
+    Score_Range(scale, &lo, &hi);
+    fprintf(f, "  /* %s:", scale->name);
+    for (uint32_t n = 0U; n < scale->nb_bands; n++)
+    {
+      fprintf(f, "%s %u..%u %s", (n != 0U) ? "," : "", scale->bands[n].lo, scale->bands[n].hi,
+              Score_PatternName(scale->bands[n].pattern));
+    }
+    fprintf(f, " */ \\\n");
+    for (uint32_t row = lo; row <= hi; row += SCORE_ROW)
+    {
+      const uint32_t end = ((hi - row) < SCORE_ROW) ? hi : (row + SCORE_ROW - 1U);
+      uint32_t band = 0U;
+
+      fprintf(f, " ");
+      for (uint32_t score = row; score <= end; score++)
+      {
+        while (scale->bands[band].hi < score)
+        {
+          band++;
+        }
+        fprintf(f, " %3uU,", scale->bands[band].pattern);
+      }
+      fprintf(f, "%*s /* %lu..%lu */ \\\n", (int)(6U * (SCORE_ROW - (end - row + 1U))), "",
+              (unsigned long)row, (unsigned long)end);
+    }
+  }
+  fprintf(f, "}\n\n#endif /* __QUESTIONNAIRE_PLAN_H */\n");
+  if (fclose(f) != 0)
+  {
+    perror(path);
+    return 1;
+  }
+  return 0;
+}
+
+static void Score_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-o header] [-t] [-v]\n"
+          "  -o     write the tables as questionnaire_plan.h\n"
+          "  -t     check that broken instruments are rejected\n"
+          "  -v     list the bands of each instrument\n",
+          argv0);
+}
@@ -0,0 +1,643 @@
+/**
+  ******************************************************************************
+  * @file           : sensor_check.c
+  * @brief          : Replays recorded sensor traces through sensor_hub.c.
+  *
+  *                     sensor_check [-v] trace ...
+  *
+  *                   The HTS221, LIS3MDL and VL53L0X are modelled on the
+  *                   simulated I2C2 bus at register level: the hub has to
+  *                   configure them before they raise their data-ready
+  *                   lines, reading the output block drops the line of the
+  *                   ST sensors and the VL53L0X keeps GPIO1 up until its
+  *                   interrupt is cleared. Trace lines, in time order:
+  *
+  *                     cal <16 bytes>            HTS221 calibration, 0x30..0x3F
+  *                     osc <value>               VL53L0X oscillator calibration
+  *                     <ms> hts221 <h_out> <t_out>
+  *                     <ms> lis3mdl <x> <y> <z>
+  *                     <ms> vl53l0x <range_mm> <status>
+  *                     <ms> detach <sensor>      the sensor stops answering
+  *                     <ms> expect env <cdeg> <permille>
+  *                     <ms> expect mag <x> <y> <z> <handled>
+  *                     <ms> expect range <mm> <presence>
+  *                     <ms> expect valid <mask>
+  *
+  *                   Every expect line is checked against
+  *                   SensorHub_GetContext() once that time is reached, and
+  *                   so is the age of each reading against the tick at which
+  *                   its data-ready line rose. SensorHub_Process() must
+  *                   never let simulated time pass, and every sample of a
+  *                   sensor still on the bus must be read exactly once.
+  *
+  *                   traces/sensors_presence.txt is the nominal session;
+  *                   sensors_missing.txt, sensors_stale.txt and
+  *                   sensors_edges.txt cover a sensor absent from power-up,
+  *                   sensors falling silent, and the limits of the
+  *                   conversions and of the presence hysteresis.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "sensor_hub.h"
+#include "hal_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK_EVENTS_MAX       1024U
+#define CHECK_LINE_LEN         256U
+#define CHECK_TAIL_MS          3000U     /* run on after the last event */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  CHECK_HTS221 = 0,
+  CHECK_LIS3MDL,
+  CHECK_VL53L0X,
+  CHECK_SENSORS
+} Check_SensorIdTypeDef;
+
+typedef enum
+{
+  CHECK_SAMPLE = 0,
+  CHECK_DETACH,
+  CHECK_EXPECT_ENV,
+  CHECK_EXPECT_MAG,
+  CHECK_EXPECT_RANGE,
+  CHECK_EXPECT_VALID
+} Check_EventTypeTypeDef;
+
+typedef struct
+{
+  uint32_t ms;
+  Check_EventTypeTypeDef type;
+  uint8_t sensor;
+  int32_t v[4];
+  uint32_t line;
+} Check_EventTypeDef;
+
+/* One sensor on the bus */
+typedef struct
+{
+  const char *name;
+  uint8_t address;
+  uint8_t st_auto_inc;      /* sub-address MSB selects auto-increment     */
+  uint8_t out_last;         /* reading it completes the output block      */
+  GPIO_TypeDef *port;
+  uint16_t pin;
+  uint8_t reg[256];
+  uint8_t fresh;            /* sample waiting to be read                  */
+  uint8_t attached;
+  uint32_t raised_tick;     /* HAL tick when the line last rose           */
+  uint32_t samples;
+  uint32_t reads;
+  uint32_t overwritten;     /* samples replaced before being read         */
+} Check_SensorTypeDef;
+
+typedef struct
+{
+  Check_EventTypeDef event[CHECK_EVENTS_MAX];
+  uint32_t count;
+  uint32_t applied;         /* events handed to the sensors               */
+  uint32_t checked;         /* expect lines evaluated                     */
+  uint32_t failures;
+  uint32_t expects;
+  const char *path;
+  int verbose;
+} Check_TraceTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static Check_SensorTypeDef check_sensor[CHECK_SENSORS];
+static const char *const check_names[CHECK_SENSORS] = { "hts221", "lis3mdl", "vl53l0x" };
+
+/* Private function prototypes -----------------------------------------------*/
+static int Check_Run(const char *path, int verbose);
+static int Check_Load(Check_TraceTypeDef *trace, const char *path);
+static void Check_Attach(void);
+static uint8_t Check_Read(void *ctx, uint8_t sub, uint32_t n);
+static void Check_Write(void *ctx, uint8_t sub, uint32_t n, uint8_t value);
+static uint8_t Check_Enabled(const Check_SensorTypeDef *s);
+static void Check_Line(Check_SensorTypeDef *s, uint8_t level);
+static uint32_t Check_Environment(uint32_t now, void *ctx);
+static void Check_Sample(Check_SensorTypeDef *s, const int32_t *v);
+static void Check_Expect(Check_TraceTypeDef *trace, const Check_EventTypeDef *e);
+static void Check_Age(Check_TraceTypeDef *trace, const Check_EventTypeDef *e, uint32_t sensor, uint16_t age);
+static int Check_Sensor(const char *name);
+static void Check_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler at simulated tick %lu\n", (unsigned long)HAL_GetTick());
+  exit(EXIT_FAILURE);
+}
+
+/* The hub is the only EXTI client in this build */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  if ((GPIO_Pin & SENSOR_HUB_DRDY_PINS) != 0U)
+  {
+    SensorHub_OnDrdy(GPIO_Pin);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int verbose = 0;
+  int failed = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "vh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        Check_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (optind >= argc)
+  {
+    Check_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  for (int n = optind; n < argc; n++)
+  {
+    if (Check_Run(argv[n], verbose) != 0)
+    {
+      failed = 1;
+    }
+  }
+  return (failed != 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Boot the hub on a fresh bus and play one trace */
+static int Check_Run(const char *path, int verbose)
+{
+  static Check_TraceTypeDef trace;
+  SensorHub_StatsTypeDef stats;
+  uint32_t end;
+  uint32_t before;
+  uint32_t blocked = 0U;
+  uint32_t missed = 0U;
+
+  memset(&trace, 0, sizeof(trace));
+  trace.path = path;
+  trace.verbose = verbose;
+  Check_Attach();
+  if (Check_Load(&trace, path) != 0)
+  {
+    return -1;
+  }
+  end = ((trace.count != 0U) ? trace.event[trace.count - 1U].ms : 0U) + CHECK_TAIL_MS;
+
+  HalSim_Reset();
+  HalSim_SetEnvironment(Check_Environment, &trace);
+  before = HalSim_Now();
+  if (SensorHub_Init() != HAL_OK)
+  {
+    Error_Handler();
+  }
+  blocked += HalSim_Now() - before;
+
+  /* The main loop of the firmware, minus the questionnaire */
+  while (HalSim_Now() < end)
+  {
+    before = HalSim_Now();
+    SensorHub_Process();
+    blocked += HalSim_Now() - before;
+    while ((trace.checked < trace.count) && (trace.event[trace.checked].ms <= HalSim_Now()))
+    {
+      Check_Expect(&trace, &trace.event[trace.checked++]);
+    }
+    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+  }
+
+  SensorHub_GetStats(&stats);
+  for (uint32_t n = 0U; n < CHECK_SENSORS; n++)
+  {
+    const Check_SensorTypeDef *s = &check_sensor[n];
+
+    if ((s->attached != 0U) && ((s->reads != s->samples) || (s->overwritten != 0U)))
+    {
+      fprintf(stderr, "%s: %s: %lu samples, %lu read, %lu overwritten\n", path, s->name,
+              (unsigned long)s->samples, (unsigned long)s->reads, (unsigned long)s->overwritten);
+      missed++;
+    }
+  }
+  if (blocked != 0U)
+  {
+    fprintf(stderr, "%s: the hub held the main loop for %lu ms\n", path, (unsigned long)blocked);
+  }
+
+  printf("%s: %lu expects, %lu failed; %lu transfers, %lu errors, readings %lu/%lu/%lu, %lu rearmed,"
+         " present 0x%x\n",
+         path, (unsigned long)trace.expects, (unsigned long)trace.failures, (unsigned long)stats.transfers,
+         (unsigned long)stats.errors, (unsigned long)stats.readings[CHECK_HTS221],
+         (unsigned long)stats.readings[CHECK_LIS3MDL], (unsigned long)stats.readings[CHECK_VL53L0X],
+         (unsigned long)stats.rearmed, (unsigned)SensorHub_Present());
+  return ((trace.failures != 0U) || (missed != 0U) || (blocked != 0U)) ? -1 : 0;
+}
+
+/* Parse a trace; events must come in time order */
+static int Check_Load(Check_TraceTypeDef *trace, const char *path)
+{
+  char line[CHECK_LINE_LEN];
+  uint32_t number = 0U;
+  uint32_t last = 0U;
+  FILE *f = fopen(path, "r");
+
+  if (f == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    Check_EventTypeDef *e = &trace->event[trace->count];
+    char verb[16];
+    char what[16];
+    unsigned long ms;
+    unsigned int cal[16];
+    unsigned int osc;
+    int sensor;
+    int n = 0;
+
+    number++;
+    if ((line[0] == '#') || (sscanf(line, "%15s", verb) != 1))
+    {
+      continue;
+    }
+    if (sscanf(line, "cal %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x %x", &cal[0], &cal[1], &cal[2],
+               &cal[3], &cal[4], &cal[5], &cal[6], &cal[7], &cal[8], &cal[9], &cal[10], &cal[11], &cal[12],
+               &cal[13], &cal[14], &cal[15]) == 16)
+    {
+      for (uint32_t i = 0U; i < 16U; i++)
+      {
+        check_sensor[CHECK_HTS221].reg[0x30U + i] = (uint8_t)cal[i];
+      }
+      continue;
+    }
+    if (sscanf(line, "osc %i", &osc) == 1)
+    {
+      check_sensor[CHECK_VL53L0X].reg[0xF8] = (uint8_t)(osc >> 8);
+      check_sensor[CHECK_VL53L0X].reg[0xF9] = (uint8_t)osc;
+      continue;
+    }
+    if (trace->count == CHECK_EVENTS_MAX)
+    {
+      fprintf(stderr, "%s:%lu: too many events\n", path, (unsigned long)number);
+      fclose(f);
+      return -1;
+    }
+
+    memset(e, 0, sizeof(*e));
+    e->line = number;
+    if (sscanf(line, "%lu %15s %n", &ms, verb, &n) < 2)
+    {
+      n = -1;
+    }
+    else if ((sensor = Check_Sensor(verb)) >= 0)
+    {
+      e->type = CHECK_SAMPLE;
+      e->sensor = (uint8_t)sensor;
+      n = sscanf(&line[n], "%d %d %d", &e->v[0], &e->v[1], &e->v[2]);
+      n = (n == ((sensor == CHECK_LIS3MDL) ? 3 : 2)) ? 0 : -1;
+    }
+    else if ((strcmp(verb, "detach") == 0) && (sscanf(&line[n], "%15s", what) == 1)
+             && ((sensor = Check_Sensor(what)) >= 0))
+    {
+      e->type = CHECK_DETACH;
+      e->sensor = (uint8_t)sensor;
+      n = 0;
+    }
+    else if (strcmp(verb, "expect") == 0)
+    {
+      int got = sscanf(&line[n], "%15s %d %d %d %d", what, &e->v[0], &e->v[1], &e->v[2], &e->v[3]) - 1;
+
+      n = -1;
+      if ((strcmp(what, "env") == 0) && (got == 2))
+      {
+        e->type = CHECK_EXPECT_ENV;
+        n = 0;
+      }
+      else if ((strcmp(what, "mag") == 0) && (got == 4))
+      {
+        e->type = CHECK_EXPECT_MAG;
+        n = 0;
+      }
+      else if ((strcmp(what, "range") == 0) && (got == 2))
+      {
+        e->type = CHECK_EXPECT_RANGE;
+        n = 0;
+      }
+      else if ((strcmp(what, "valid") == 0) && (got == 1))
+      {
+        e->type = CHECK_EXPECT_VALID;
+        n = 0;
+      }
+    }
+    else
+    {
+      n = -1;
+    }
+    if ((n != 0) || (ms < last))
+    {
+      fprintf(stderr, "%s:%lu: bad line\n", path, (unsigned long)number);
+      fclose(f);
+      return -1;
+    }
+    e->ms = (uint32_t)ms;
+    last = e->ms;
+    trace->count++;
+  }
+  fclose(f);
+  return 0;
+}
+
+/* Power-on state of the three sensors, all on the bus */
+static void Check_Attach(void)
+{
+  static const uint8_t address[CHECK_SENSORS] =
+  {
+    SENSOR_HUB_HTS221_ADDR, SENSOR_HUB_LIS3MDL_ADDR, SENSOR_HUB_VL53L0X_ADDR
+  };
+  static const uint8_t out_last[CHECK_SENSORS] = { 0x2BU, 0x2DU, 0x1FU };
+  static const uint8_t who_am_i[CHECK_SENSORS][2] = { { 0x0FU, 0xBCU }, { 0x0FU, 0x3DU }, { 0xC0U, 0xEEU } };
+  GPIO_TypeDef *const port[CHECK_SENSORS] =
+  {
+    HTS221_DRDY_EXTI15_GPIO_Port, LSM3MDL_DRDY_EXTI8_GPIO_Port, VL53L0X_GPIO1_EXTI7_GPIO_Port
+  };
+  const uint16_t pin[CHECK_SENSORS] =
+  {
+    HTS221_DRDY_EXTI15_Pin, LSM3MDL_DRDY_EXTI8_Pin, VL53L0X_GPIO1_EXTI7_Pin
+  };
+
+  for (uint32_t n = 0U; n < CHECK_SENSORS; n++)
+  {
+    Check_SensorTypeDef *s = &check_sensor[n];
+    HalSim_I2cDeviceTypeDef dev = { address[n], Check_Read, Check_Write, s };
+
+    memset(s, 0, sizeof(*s));
+    s->name = check_names[n];
+    s->address = address[n];
+    s->st_auto_inc = (n != CHECK_VL53L0X) ? 1U : 0U;
+    s->out_last = out_last[n];
+    s->port = port[n];
+    s->pin = pin[n];
+    s->reg[who_am_i[n][0]] = who_am_i[n][1];
+    s->attached = 1U;
+    if (HalSim_I2cAttach(&dev) != HAL_OK)
+    {
+      Error_Handler();
+    }
+  }
+  /* GPIO1 defaults to active low; LIS3MDL powers up in power-down */
+  check_sensor[CHECK_VL53L0X].reg[0x84] = 0x01U;
+  check_sensor[CHECK_LIS3MDL].reg[0x22] = 0x03U;
+}
+
+static uint8_t Check_Read(void *ctx, uint8_t sub, uint32_t n)
+{
+  Check_SensorTypeDef *s = (Check_SensorTypeDef *)ctx;
+  uint8_t reg;
+
+  if (s->st_auto_inc != 0U)
+  {
+    reg = (uint8_t)((sub & 0x7FU) + (((sub & 0x80U) != 0U) ? n : 0U));
+  }
+  else
+  {
+    reg = (uint8_t)(sub + n);
+  }
+  if ((reg == s->out_last) && (s->fresh != 0U))
+  {
+    s->fresh = 0U;
+    s->reads++;
+    if (s->st_auto_inc != 0U)
+    {
+      Check_Line(s, 0U);
+    }
+  }
+  return s->reg[reg];
+}
+
+static void Check_Write(void *ctx, uint8_t sub, uint32_t n, uint8_t value)
+{
+  Check_SensorTypeDef *s = (Check_SensorTypeDef *)ctx;
+  uint8_t reg;
+
+  if (s->st_auto_inc != 0U)
+  {
+    reg = (uint8_t)((sub & 0x7FU) + (((sub & 0x80U) != 0U) ? n : 0U));
+  }
+  else
+  {
+    reg = (uint8_t)(sub + n);
+  }
+  s->reg[reg] = value;
+  if ((s->st_auto_inc == 0U) && (reg == 0x0BU) && ((value & 0x01U) != 0U))
+  {
+    /* VL53L0X interrupt clear */
+    Check_Line(s, 0U);
+    return;
+  }
+  /* Enabling the output with a sample waiting raises the line at once */
+  Check_Line(s, ((s->fresh != 0U) && (s->st_auto_inc != 0U)) ? 1U : 0U);
+}
+
+/* Whether the configuration written so far lets the line report samples */
+static uint8_t Check_Enabled(const Check_SensorTypeDef *s)
+{
+  if (s == &check_sensor[CHECK_HTS221])
+  {
+    return (((s->reg[0x20] & 0x80U) != 0U) && ((s->reg[0x22] & 0x04U) != 0U)) ? 1U : 0U;
+  }
+  if (s == &check_sensor[CHECK_LIS3MDL])
+  {
+    return ((s->reg[0x22] & 0x03U) == 0U) ? 1U : 0U;
+  }
+  /* VL53L0X: timed ranging, new-sample interrupt, active high */
+  return (((s->reg[0x00] & 0x04U) != 0U) && ((s->reg[0x0A] & 0x07U) == 0x04U) && ((s->reg[0x84] & 0x10U) != 0U))
+         ? 1U : 0U;
+}
+
+/* Drive the data-ready line; a rising edge is stamped */
+static void Check_Line(Check_SensorTypeDef *s, uint8_t level)
+{
+  uint8_t high = ((level != 0U) && (Check_Enabled(s) != 0U)) ? 1U : 0U;
+
+  if ((high != 0U) && (HAL_GPIO_ReadPin(s->port, s->pin) == GPIO_PIN_RESET))
+  {
+    s->raised_tick = HAL_GetTick();
+  }
+  HalSim_GpioInput(s->port, s->pin, (high != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+/* Test bench hook: hand the trace events due to the sensors */
+static uint32_t Check_Environment(uint32_t now, void *ctx)
+{
+  Check_TraceTypeDef *trace = (Check_TraceTypeDef *)ctx;
+
+  while ((trace->applied < trace->count) && (trace->event[trace->applied].ms <= now))
+  {
+    const Check_EventTypeDef *e = &trace->event[trace->applied++];
+    Check_SensorTypeDef *s = &check_sensor[e->sensor];
+
+    if (e->type == CHECK_SAMPLE)
+    {
+      Check_Sample(s, e->v);
+    }
+    else if (e->type == CHECK_DETACH)
+    {
+      HalSim_I2cDetach(s->address);
+      s->attached = 0U;
+    }
+  }
+  return (trace->applied < trace->count) ? trace->event[trace->applied].ms : HAL_MAX_DELAY;
+}
+
+/* New sample in the output registers, data-ready up */
+static void Check_Sample(Check_SensorTypeDef *s, const int32_t *v)
+{
+  if (s == &check_sensor[CHECK_VL53L0X])
+  {
+    if ((Check_Enabled(s) == 0U) || (HAL_GPIO_ReadPin(s->port, s->pin) == GPIO_PIN_SET))
+    {
+      /* Not ranging, or the last interrupt is not cleared yet */
+      s->overwritten += (Check_Enabled(s) != 0U) ? 1U : 0U;
+    }
+    s->reg[0x14] = (uint8_t)((v[1] & 0x0F) << 3);
+    s->reg[0x1E] = (uint8_t)((uint32_t)v[0] >> 8);
+    s->reg[0x1F] = (uint8_t)v[0];
+    s->fresh = 1U;
+    s->samples++;
+    Check_Line(s, 1U);
+    return;
+  }
+
+  if (s->fresh != 0U)
+  {
+    s->overwritten++;
+  }
+  if (s == &check_sensor[CHECK_HTS221])
+  {
+    s->reg[0x28] = (uint8_t)v[0];
+    s->reg[0x29] = (uint8_t)((uint32_t)v[0] >> 8);
+    s->reg[0x2A] = (uint8_t)v[1];
+    s->reg[0x2B] = (uint8_t)((uint32_t)v[1] >> 8);
+  }
+  else
+  {
+    for (uint32_t axis = 0U; axis < 3U; axis++)
+    {
+      s->reg[0x28U + (2U * axis)] = (uint8_t)v[axis];
+      s->reg[0x29U + (2U * axis)] = (uint8_t)((uint32_t)v[axis] >> 8);
+    }
+  }
+  s->fresh = 1U;
+  s->samples++;
+  Check_Line(s, 1U);
+}
+
+/* Compare the context with one expect line */
+static void Check_Expect(Check_TraceTypeDef *trace, const Check_EventTypeDef *e)
+{
+  SensorHub_ContextTypeDef ctx;
+  int32_t got[4] = { 0 };
+  uint32_t fields = 0U;
+
+  if (e->type < CHECK_EXPECT_ENV)
+  {
+    return;
+  }
+  SensorHub_GetContext(&ctx);
+  switch (e->type)
+  {
+    case CHECK_EXPECT_ENV:
+      got[0] = ctx.temperature_cdeg;
+      got[1] = ctx.humidity_permille;
+      fields = 2U;
+      Check_Age(trace, e, CHECK_HTS221, ctx.env_age_ms);
+      break;
+    case CHECK_EXPECT_MAG:
+      got[0] = ctx.mag_mgauss[0];
+      got[1] = ctx.mag_mgauss[1];
+      got[2] = ctx.mag_mgauss[2];
+      got[3] = ctx.handled;
+      fields = 4U;
+      Check_Age(trace, e, CHECK_LIS3MDL, ctx.mag_age_ms);
+      break;
+    case CHECK_EXPECT_RANGE:
+      got[0] = ctx.range_mm;
+      got[1] = ctx.presence;
+      fields = 2U;
+      Check_Age(trace, e, CHECK_VL53L0X, ctx.range_age_ms);
+      break;
+    default:
+      got[0] = ctx.valid;
+      fields = 1U;
+      break;
+  }
+
+  trace->expects++;
+  if (memcmp(got, e->v, fields * sizeof(int32_t)) != 0)
+  {
+    trace->failures++;
+    fprintf(stderr, "%s:%lu: at %lu ms got %ld %ld %ld %ld\n", trace->path, (unsigned long)e->line,
+            (unsigned long)HalSim_Now(), (long)got[0], (long)got[1], (long)got[2], (long)got[3]);
+  }
+  else if (trace->verbose != 0)
+  {
+    printf("%s:%lu: ok at %lu ms\n", trace->path, (unsigned long)e->line, (unsigned long)HalSim_Now());
+  }
+}
+
+/* The reading is as old as the data-ready edge that announced it, the
+   context saturating at 0xFFFF ms */
+static void Check_Age(Check_TraceTypeDef *trace, const Check_EventTypeDef *e, uint32_t sensor, uint16_t age)
+{
+  uint32_t want = HAL_GetTick() - check_sensor[sensor].raised_tick;
+
+  if (want > 0xFFFFU)
+  {
+    want = 0xFFFFU;
+  }
+
+  if (age != want)
+  {
+    trace->failures++;
+    fprintf(stderr, "%s:%lu: %s reading %u ms old, its edge was %lu ms ago\n", trace->path,
+            (unsigned long)e->line, check_names[sensor], (unsigned)age, (unsigned long)want);
+  }
+}
+
+static int Check_Sensor(const char *name)
+{
+  for (uint32_t n = 0U; n < CHECK_SENSORS; n++)
+  {
+    if (strcmp(name, check_names[n]) == 0)
+    {
+      return (int)n;
+    }
+  }
+  return -1;
+}
+
+static void Check_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-v] trace ...\n"
+          "  -v     one line per expect that holds\n"
+          "  trace  recorded sensor trace, see the header of sensor_check.c\n",
+          argv0);
+}
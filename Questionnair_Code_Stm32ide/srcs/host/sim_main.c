@@ -0,0 +1,442 @@
+/**
+  ******************************************************************************
+  * @file           : sim_main.c
+  * @brief          : Host runner for the questionnaire application.
+  *
+  *                   Runs the firmware superloop (App_Step) against the
+  *                   simulated HAL, one session per script: either a
+  *                   recorded trace replayed once, or randomly generated
+  *                   sessions for regression and timing analysis.
+  *
+  *                     questionnaire_sim [-a age] [-n sessions] [-s seed] [-v]
+  *                                       [-o log] [-t telemetry]
+  *                                       [-c checksum] [trace]
+  *
+  *                   The binary log the firmware streams on USART1 is
+  *                   written to the -o file, for host/log_decode. The
+  *                   framed telemetry of USART2 is written to the -t file
+  *                   as it is produced, so -t may name a pty slave that
+  *                   host/telemetry_rx reads. The device ID follows the
+  *                   seed, so runs with different seeds are different
+  *                   boards to the receiver.
+  *
+  *                   No sensor answers on I2C2: the sensor hub gives them
+  *                   up while it configures them, and sessions carry no
+  *                   CONTEXT records (see host/sensor_check.c).
+  *
+  *                   The microphone hears room noise (sim_script.c) and
+  *                   is captured as on the board, duty-cycled by app.c,
+  *                   so the Stop2 residency includes the listening
+  *                   periods (see host/audio_bench.c for the features).
+  *
+  *                   The QSPI session store lives on across the sessions of
+  *                   a run, like the flash of a board that is rebooted;
+  *                   at the end it is replayed and must hold a summary
+  *                   record for every session, and the emotion CNN weight
+  *                   region above it must still be erased.
+  *
+  *                   The checksum folds score and result of every session;
+  *                   a change in scoring shows up as a different checksum
+  *                   for the same seed, and with -c the run fails unless
+  *                   it folds to the one given. Random sessions answer
+  *                   as many questions as questionnaire_plan.h gives the
+  *                   age group.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "app.h"
+#include "adc_stream.h"
+#include "led_pattern.h"
+#include "power_mgr.h"
+#include "log_ring.h"
+#include "telemetry.h"
+#include "flash_log.h"
+#include "sensor_hub.h"
+#include "audio_capture.h"
+#include "qspi_flash.h"
+#include "emotion_net.h"
+#include "profile.h"
+#include "questionnaire_plan.h"
+#include "sim_script.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+/* Give up on a session this long after its last event */
+#define SIM_SESSION_GRACE_MS   60000U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t sessions;
+  uint32_t timeouts;
+  uint32_t no_band;
+  uint32_t results[LED_PATTERN_COUNT];
+  uint32_t answers;
+  uint32_t bounces;
+  uint32_t dropped;
+  uint32_t max_latency_ms;
+  uint64_t sim_ms;
+  uint64_t stop_ms;
+  uint32_t checksum;
+} Sim_TotalsTypeDef;
+
+typedef struct
+{
+  uint32_t sessions;
+  uint32_t traces;
+  uint32_t samples;
+} Sim_StoreTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+ADC_HandleTypeDef hadc1 = { ADC1, { 0U }, NULL };
+UART_HandleTypeDef huart1 = { USART1, { 115200U, 0U, 0U, 0U, 0U, 0U, 0U }, NULL };
+UART_HandleTypeDef huart2 = { USART2, { 115200U, 0U, 0U, 0U, 0U, 0U, 0U }, NULL };
+QSPI_HandleTypeDef hqspi = { QUADSPI, { 2U, 4U, 0U, 23U, 0U, 0U } };
+/* As MX_DFSDM1_Init() leaves it */
+DFSDM_Channel_HandleTypeDef hdfsdm1_channel1 = { DFSDM1_Channel1, { { ENABLE, 0U, 2U }, 0, 0U } };
+
+static const Questionnaire_ProfileTypeDef sim_profiles[QUESTIONNAIRE_PROFILES] = QUESTIONNAIRE_PLAN_PROFILES;
+static const char *const sim_pattern_names[LED_PATTERN_COUNT] = { "slow", "medium", "fast" };
+
+/* Private function prototypes -----------------------------------------------*/
+static int Sim_Session(SimScript_TypeDef *script, Questionnaire_AgeTypeDef age,
+                       Sim_TotalsTypeDef *totals, int verbose, FILE *log, FILE *telemetry);
+static void Sim_Drain(USART_TypeDef *instance, FILE *out);
+static void Sim_StoreVisit(const FlashLog_RecordTypeDef *rec, const uint8_t *payload, void *ctx);
+static uint32_t Sim_WeightsWritten(void);
+static uint32_t Sim_Fold(uint32_t hash, uint32_t value);
+static double Sim_Seconds(void);
+static void Sim_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler at simulated tick %lu\n", (unsigned long)HAL_GetTick());
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  Questionnaire_AgeTypeDef age = QUESTIONNAIRE_AGE_1;
+  unsigned long sessions = 1000UL;
+  uint32_t seed = 1U;
+  uint32_t expected = 0U;
+  int check = 0;
+  int verbose = 0;
+  const char *trace = NULL;
+  FILE *log = NULL;
+  FILE *telemetry = NULL;
+  SimScript_TypeDef script;
+  Sim_TotalsTypeDef totals;
+  Sim_StoreTypeDef store;
+  FlashLog_StatsTypeDef flash;
+  uint32_t weights;
+  double t0;
+  double wall;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "a:n:s:o:t:c:vh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'a':
+        age = (Questionnaire_AgeTypeDef)strtoul(optarg, NULL, 0);
+        if ((uint32_t)age >= (uint32_t)QUESTIONNAIRE_AGE_COUNT)
+        {
+          Sim_Usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'n':
+        sessions = strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        seed = (uint32_t)strtoul(optarg, NULL, 0);
+        seed = (seed == 0U) ? 1U : seed;
+        break;
+      case 'v':
+        verbose = 1;
+        break;
+      case 'c':
+        expected = (uint32_t)strtoul(optarg, NULL, 16);
+        check = 1;
+        break;
+      case 'o':
+        log = fopen(optarg, "wb");
+        if (log == NULL)
+        {
+          perror(optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 't':
+        telemetry = fopen(optarg, "wb");
+        if (telemetry == NULL)
+        {
+          perror(optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+      default:
+        Sim_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (optind < argc)
+  {
+    trace = argv[optind];
+    sessions = 1UL;
+    verbose = 1;
+  }
+
+  memset(&totals, 0, sizeof(totals));
+  totals.checksum = 2166136261U;
+  SimScript_Init(&script);
+  if ((trace != NULL) && (SimScript_Load(&script, trace) != 0))
+  {
+    return EXIT_FAILURE;
+  }
+
+  HalSim_SetUid(seed, seed * 2654435761U, 0x20353945U);
+  t0 = Sim_Seconds();
+  for (unsigned long n = 0UL; n < sessions; n++)
+  {
+    if (trace == NULL)
+    {
+      SimScript_Clear(&script);
+      if (SimScript_Random(&script, &seed, sim_profiles[age].questions) != 0)
+      {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+      }
+    }
+    (void)Sim_Session(&script, age, &totals, verbose, log, telemetry);
+  }
+  wall = Sim_Seconds() - t0;
+  SimScript_Free(&script);
+  if (log != NULL)
+  {
+    fclose(log);
+  }
+  if (telemetry != NULL)
+  {
+    fclose(telemetry);
+  }
+
+  printf("age %u: %lu sessions, %.1f simulated hours in %.3f s (%.0f sessions/s)\n",
+         (unsigned)age, (unsigned long)totals.sessions, (double)totals.sim_ms / 3600000.0, wall,
+         (wall > 0.0) ? ((double)totals.sessions / wall) : 0.0);
+  printf("results: slow %lu, medium %lu, fast %lu, no band %lu, timeout %lu\n",
+         (unsigned long)totals.results[LED_PATTERN_SLOW], (unsigned long)totals.results[LED_PATTERN_MEDIUM],
+         (unsigned long)totals.results[LED_PATTERN_FAST], (unsigned long)totals.no_band,
+         (unsigned long)totals.timeouts);
+  printf("capture: %lu answers, %lu bounces rejected, %lu dropped, worst latency %lu ms\n",
+         (unsigned long)totals.answers, (unsigned long)totals.bounces, (unsigned long)totals.dropped,
+         (unsigned long)totals.max_latency_ms);
+  printf("stop2 residency %.1f %%, checksum %08lx\n",
+         (totals.sim_ms != 0U) ? (100.0 * (double)totals.stop_ms / (double)totals.sim_ms) : 0.0,
+         (unsigned long)totals.checksum);
+
+  memset(&store, 0, sizeof(store));
+  (void)FlashLog_Replay(Sim_StoreVisit, &store);
+  FlashLog_GetStats(&flash);
+  printf("store: %lu sessions, %lu traces (%lu samples) in %lu sectors, erase count %lu..%lu\n",
+         (unsigned long)store.sessions, (unsigned long)store.traces, (unsigned long)store.samples,
+         (unsigned long)flash.used_sectors, (unsigned long)flash.min_erase_count,
+         (unsigned long)flash.max_erase_count);
+  weights = Sim_WeightsWritten();
+  if (weights != 0U)
+  {
+    fprintf(stderr, "%lu bytes programmed in the emotion CNN weights at 0x%06lx\n", (unsigned long)weights,
+            (unsigned long)EMOTION_NET_QSPI_BASE);
+  }
+
+  if ((check != 0) && (totals.checksum != expected))
+  {
+    fprintf(stderr, "checksum %08lx, expected %08lx\n", (unsigned long)totals.checksum, (unsigned long)expected);
+    return EXIT_FAILURE;
+  }
+
+  return ((totals.timeouts != 0U) || (totals.dropped != 0U) || (store.sessions != totals.sessions)
+          || (weights != 0U)) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Boot the simulated board, play the script, stop when the result shows */
+static int Sim_Session(SimScript_TypeDef *script, Questionnaire_AgeTypeDef age,
+                       Sim_TotalsTypeDef *totals, int verbose, FILE *log, FILE *telemetry)
+{
+  uint32_t deadline;
+  HAL_StatusTypeDef shown = HAL_BUSY;
+  LedPattern_IdTypeDef pattern = LED_PATTERN_SLOW;
+  HAL_StatusTypeDef result;
+  Questionnaire_StatsTypeDef stats;
+  Power_ReportTypeDef power;
+
+  SimScript_Rewind(script);
+  deadline = SimScript_End(script) + SIM_SESSION_GRACE_MS;
+  HalSim_Reset();
+  HalSim_SetEnvironment(SimScript_Environment, script);
+
+  if ((LogRing_Init(&huart1) != HAL_OK) || (Telemetry_Init(&huart2) != HAL_OK)
+      || (FlashLog_Init(&hqspi, APP_STORE_QSPI_BASE, APP_STORE_QSPI_SIZE) != HAL_OK) || (SensorHub_Init() != HAL_OK)
+      || (AudioCapture_Init(&hdfsdm1_channel1) != HAL_OK)
+      || (AdcStream_Init(&hadc1, ADC_STREAM_DEFAULT_RATE_HZ) != HAL_OK) || (AdcStream_Start() != HAL_OK))
+  {
+    Error_Handler();
+  }
+  LedPattern_Init();
+  Power_Init(POWER_SAMPLE_PERIOD_MS);
+  Profile_Init();
+  App_Init(age);
+
+  while ((shown != HAL_OK) && (HalSim_Now() < deadline))
+  {
+    shown = App_Step();
+    Sim_Drain(USART2, telemetry);
+  }
+  /* Let the logger and the telemetry drain what the session recorded */
+  while (((LogRing_Busy() != 0U) || (Telemetry_Busy() != 0U)) && (HalSim_Now() < deadline))
+  {
+    LogRing_Flush();
+    Telemetry_Flush();
+    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+  }
+  Sim_Drain(USART2, telemetry);
+
+  result = Questionnaire_GetResult(&pattern);
+  Questionnaire_GetStats(&stats);
+  Power_GetReport(&power);
+
+  totals->sessions++;
+  if (shown != HAL_OK)
+  {
+    if (result == HAL_ERROR)
+    {
+      totals->no_band++;
+    }
+    else
+    {
+      totals->timeouts++;
+    }
+  }
+  else
+  {
+    totals->results[pattern]++;
+  }
+  totals->answers += stats.answers;
+  totals->bounces += stats.bounces;
+  totals->dropped += stats.dropped;
+  if (stats.max_latency_ms > totals->max_latency_ms)
+  {
+    totals->max_latency_ms = stats.max_latency_ms;
+  }
+  totals->sim_ms += HalSim_Now();
+  totals->stop_ms += power.stop_ms;
+  totals->checksum = Sim_Fold(totals->checksum, Questionnaire_Score());
+  totals->checksum = Sim_Fold(totals->checksum, (result == HAL_OK) ? (uint32_t)pattern : 0xFFU);
+
+  if (verbose != 0)
+  {
+    printf("session %lu: %u answers (%lu presses), score %u, %s, %lu ms, latency %lu ms, %lu bounces\n",
+           (unsigned long)totals->sessions, (unsigned)Questionnaire_Index(), (unsigned long)script->presses,
+           (unsigned)Questionnaire_Score(),
+           (result == HAL_OK) ? sim_pattern_names[pattern] : ((result == HAL_ERROR) ? "no band" : "unfinished"),
+           (unsigned long)HalSim_Now(), (unsigned long)stats.max_latency_ms, (unsigned long)stats.bounces);
+  }
+  Sim_Drain(USART1, log);
+  LedPattern_Cancel();
+  return (shown == HAL_OK) ? 0 : -1;
+}
+
+/* Move what the firmware transmitted on a UART to a file, if any */
+static void Sim_Drain(USART_TypeDef *instance, FILE *out)
+{
+  uint8_t uart[256];
+  uint32_t len;
+
+  while ((len = HalSim_UartOutput(instance, uart, sizeof(uart))) != 0U)
+  {
+    if (out != NULL)
+    {
+      fwrite(uart, 1U, len, out);
+    }
+  }
+}
+
+/* Count what the session store holds */
+static void Sim_StoreVisit(const FlashLog_RecordTypeDef *rec, const uint8_t *payload, void *ctx)
+{
+  Sim_StoreTypeDef *store = (Sim_StoreTypeDef *)ctx;
+
+  if (rec->type == APP_RECORD_SESSION)
+  {
+    store->sessions++;
+  }
+  else if (rec->type == APP_RECORD_TRACE)
+  {
+    store->traces++;
+    store->samples += ((const App_TraceRecordTypeDef *)payload)->count;
+  }
+}
+
+/* Bytes of the weight region that are not erased; no weights are loaded
+   here, so anything there came from the store */
+static uint32_t Sim_WeightsWritten(void)
+{
+  const uint8_t *map = QspiFlash_Map();
+  uint32_t written = 0U;
+
+  if (map == NULL)
+  {
+    return EMOTION_NET_QSPI_SIZE;
+  }
+  for (uint32_t n = 0U; n < EMOTION_NET_QSPI_SIZE; n++)
+  {
+    written += (map[EMOTION_NET_QSPI_BASE + n] != 0xFFU) ? 1U : 0U;
+  }
+  return written;
+}
+
+/* FNV-1a over the four bytes of value */
+static uint32_t Sim_Fold(uint32_t hash, uint32_t value)
+{
+  for (uint32_t n = 0U; n < 4U; n++)
+  {
+    hash ^= (value >> (8U * n)) & 0xFFU;
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+static double Sim_Seconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+static void Sim_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-a age] [-n sessions] [-s seed] [-v] [-o log] [-t telemetry] [-c checksum]\n"
+          "       [trace]\n"
+          "  -a age       age group 0..%u (default 1)\n"
+          "  -n sessions  random sessions to run (default 1000)\n"
+          "  -s seed      stimulus seed (default 1)\n"
+          "  -v           one line per session\n"
+          "  -o log       write the USART1 log stream to a file\n"
+          "  -t telemetry write the USART2 telemetry stream to a file or pty\n"
+          "  -c checksum  fail unless the run folds to this checksum (hex)\n"
+          "  trace        replay a recorded trace once instead\n",
+          argv0, (unsigned)(QUESTIONNAIRE_AGE_COUNT - 1));
+}
@@ -0,0 +1,422 @@
+/**
+  ******************************************************************************
+  * @file           : sim_script.c
+  * @brief          : Timed stimulus for the simulated board.
+  *
+  *                   A script is a list of events stamped with the simulated
+  *                   wall-clock time. SimScript_Environment() is installed as
+  *                   the HAL simulation environment hook: every simulated
+  *                   millisecond it applies the events that are due and
+  *                   feeds one photodiode sample to the ADC, matching the
+  *                   1 kHz TIM6 trigger, and a millisecond of room noise to
+  *                   the microphone, dropped while it is not captured.
+  *
+  *                   Trace file format, one event per line, '#' comments:
+  *
+  *                     <ms> press <button> <hold_ms> [bounces]
+  *                     <ms> lux <adc_value>
+  *                     <ms> uart <text>
+  *
+  *                   A press expands into the rising edge, its bounce edges
+  *                   one millisecond apart, and the same on release.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sim_script.h"
+#include "questionnaire.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_SCRIPT_LINE_LEN   256U
+
+/* Private function prototypes -----------------------------------------------*/
+static SimScript_EventTypeDef *SimScript_Push(SimScript_TypeDef *script, uint32_t time_ms,
+                                              SimScript_KindTypeDef kind);
+static int SimScript_AddEdges(SimScript_TypeDef *script, uint32_t time_ms, uint16_t pin,
+                              GPIO_PinState level, uint32_t bounces);
+static int SimScript_Compare(const void *a, const void *b);
+static uint32_t SimScript_Rand(uint32_t *seed, uint32_t lo, uint32_t hi);
+static void SimScript_Mic(SimScript_TypeDef *script);
+
+/* Private user code ---------------------------------------------------------*/
+
+void SimScript_Init(SimScript_TypeDef *script)
+{
+  memset(script, 0, sizeof(*script));
+  script->lux = SIM_SCRIPT_DEFAULT_LUX;
+  script->mic = 1U;
+}
+
+void SimScript_Free(SimScript_TypeDef *script)
+{
+  free(script->events);
+  free(script->pool);
+  SimScript_Init(script);
+}
+
+/**
+  * @brief  Drop every event but keep the allocations for the next session.
+  * @param  script: script
+  * @retval None
+  */
+void SimScript_Clear(SimScript_TypeDef *script)
+{
+  script->count = 0U;
+  script->next = 0U;
+  script->pool_len = 0U;
+  script->presses = 0U;
+  script->lux = SIM_SCRIPT_DEFAULT_LUX;
+}
+
+/**
+  * @brief  Append the events of a trace file.
+  * @param  script: script
+  * @param  path: trace file
+  * @retval 0 on success, -1 with a message on stderr otherwise
+  */
+int SimScript_Load(SimScript_TypeDef *script, const char *path)
+{
+  char line[SIM_SCRIPT_LINE_LEN];
+  unsigned long lineno = 0UL;
+  FILE *f = fopen(path, "r");
+
+  if (f == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    char cmd[16];
+    unsigned long t;
+    unsigned long a = 0UL;
+    unsigned long b = 0UL;
+    unsigned long c = 0UL;
+    int used = 0;
+    int fields;
+    char *hash = strchr(line, '#');
+    int rc = 0;
+
+    lineno++;
+    if (hash != NULL)
+    {
+      *hash = '\0';
+    }
+    if (sscanf(line, " %lu %15s %n", &t, cmd, &used) < 2)
+    {
+      if (strspn(line, " \t\r\n") == strlen(line))
+      {
+        continue;
+      }
+      rc = -1;
+    }
+    else if (strcmp(cmd, "press") == 0)
+    {
+      fields = sscanf(line + used, "%lu %lu %lu", &a, &b, &c);
+      rc = (fields < 2) ? -1 : SimScript_AddPress(script, (uint32_t)t, (uint8_t)a, (uint32_t)b, (uint32_t)c);
+    }
+    else if (strcmp(cmd, "lux") == 0)
+    {
+      rc = ((sscanf(line + used, "%lu", &a) != 1) || (a > 4095UL)) ? -1
+           : SimScript_AddLux(script, (uint32_t)t, (uint16_t)a);
+    }
+    else if (strcmp(cmd, "uart") == 0)
+    {
+      size_t len = strcspn(line + used, "\r\n");
+
+      line[used + len] = '\n';
+      rc = SimScript_AddUart(script, (uint32_t)t, line + used, (uint32_t)len + 1U);
+    }
+    else
+    {
+      rc = -1;
+    }
+    if (rc != 0)
+    {
+      fprintf(stderr, "%s:%lu: bad event\n", path, lineno);
+      fclose(f);
+      return -1;
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+/**
+  * @brief  Press and release an answer button.
+  * @param  script: script
+  * @param  time_ms: time of the first rising edge
+  * @param  button: 1 .. QUESTIONNAIRE_BUTTONS
+  * @param  hold_ms: time from the first rising to the first falling edge
+  * @param  bounces: extra edge pairs after each transition, 1 ms apart
+  * @retval 0 on success, -1 on a bad argument or allocation failure
+  */
+int SimScript_AddPress(SimScript_TypeDef *script, uint32_t time_ms, uint8_t button,
+                       uint32_t hold_ms, uint32_t bounces)
+{
+  uint16_t pin;
+
+  if ((button == 0U) || (button > QUESTIONNAIRE_BUTTONS) || (hold_ms <= (2U * bounces)))
+  {
+    return -1;
+  }
+  pin = (uint16_t)(GPIO_PIN_1 << (button - 1U));
+  if ((SimScript_AddEdges(script, time_ms, pin, GPIO_PIN_SET, bounces) != 0)
+      || (SimScript_AddEdges(script, time_ms + hold_ms, pin, GPIO_PIN_RESET, bounces) != 0))
+  {
+    return -1;
+  }
+  script->presses++;
+  return 0;
+}
+
+/**
+  * @brief  Change the photodiode level.
+  * @param  script: script
+  * @param  time_ms: time of the change
+  * @param  value: 12-bit ADC value converted from then on
+  * @retval 0 on success, -1 on allocation failure
+  */
+int SimScript_AddLux(SimScript_TypeDef *script, uint32_t time_ms, uint16_t value)
+{
+  SimScript_EventTypeDef *evt = SimScript_Push(script, time_ms, SIM_EVENT_LUX);
+
+  if (evt == NULL)
+  {
+    return -1;
+  }
+  evt->value = value;
+  return 0;
+}
+
+/**
+  * @brief  Send bytes to the board on USART1.
+  * @param  script: script
+  * @param  time_ms: arrival time
+  * @param  text: bytes
+  * @param  len: number of bytes
+  * @retval 0 on success, -1 on allocation failure
+  */
+int SimScript_AddUart(SimScript_TypeDef *script, uint32_t time_ms, const char *text, uint32_t len)
+{
+  SimScript_EventTypeDef *evt;
+
+  if ((len > 0xFFFFU) || (len > (0xFFFFFFFFU - script->pool_len)))
+  {
+    return -1;
+  }
+  if ((script->pool_len + len) > script->pool_size)
+  {
+    uint32_t size = (script->pool_size == 0U) ? 256U : script->pool_size;
+    char *pool;
+
+    while (size < (script->pool_len + len))
+    {
+      size *= 2U;
+    }
+    pool = realloc(script->pool, size);
+    if (pool == NULL)
+    {
+      return -1;
+    }
+    script->pool = pool;
+    script->pool_size = size;
+  }
+  evt = SimScript_Push(script, time_ms, SIM_EVENT_UART);
+  if (evt == NULL)
+  {
+    return -1;
+  }
+  memcpy(&script->pool[script->pool_len], text, len);
+  evt->text = script->pool_len;
+  evt->value = (uint16_t)len;
+  script->pool_len += len;
+  return 0;
+}
+
+/**
+  * @brief  Generate a session: random buttons, think times, hold times and
+  *         contact bounce, in a dark room.
+  * @param  script: script, usually cleared
+  * @param  seed: xorshift32 state, updated
+  * @param  answers: number of presses
+  * @retval 0 on success, -1 on allocation failure
+  */
+int SimScript_Random(SimScript_TypeDef *script, uint32_t *seed, uint32_t answers)
+{
+  uint32_t t = SimScript_End(script);
+
+  for (uint32_t n = 0U; n < answers; n++)
+  {
+    uint32_t hold = SimScript_Rand(seed, 60U, 300U);
+
+    t += SimScript_Rand(seed, 200U, 2000U);
+    if (SimScript_AddPress(script, t, (uint8_t)SimScript_Rand(seed, 1U, QUESTIONNAIRE_BUTTONS),
+                           hold, SimScript_Rand(seed, 0U, 3U)) != 0)
+    {
+      return -1;
+    }
+    t += hold;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Sort the events and start again from the first one.
+  * @param  script: script
+  * @retval None
+  */
+void SimScript_Rewind(SimScript_TypeDef *script)
+{
+  qsort(script->events, script->count, sizeof(SimScript_EventTypeDef), SimScript_Compare);
+  script->next = 0U;
+  script->lux = SIM_SCRIPT_DEFAULT_LUX;
+  script->mic = 1U;
+}
+
+/**
+  * @brief  Time of the last event.
+  * @param  script: script
+  * @retval Milliseconds
+  */
+uint32_t SimScript_End(const SimScript_TypeDef *script)
+{
+  uint32_t end = 0U;
+
+  for (uint32_t n = 0U; n < script->count; n++)
+  {
+    if (script->events[n].time_ms > end)
+    {
+      end = script->events[n].time_ms;
+    }
+  }
+  return end;
+}
+
+uint8_t SimScript_Done(const SimScript_TypeDef *script)
+{
+  return (script->next >= script->count) ? 1U : 0U;
+}
+
+/**
+  * @brief  HAL simulation environment hook.
+  * @param  now: simulated wall-clock time, ms
+  * @param  ctx: SimScript_TypeDef being replayed
+  * @retval Time of the next event, HAL_MAX_DELAY once all are applied
+  */
+uint32_t SimScript_Environment(uint32_t now, void *ctx)
+{
+  SimScript_TypeDef *script = ctx;
+
+  while ((script->next < script->count) && (script->events[script->next].time_ms <= now))
+  {
+    const SimScript_EventTypeDef *evt = &script->events[script->next++];
+
+    switch (evt->kind)
+    {
+      case SIM_EVENT_EDGE:
+        HalSim_GpioInput(QUESTIONNAIRE_PORT, evt->pin, (GPIO_PinState)evt->value);
+        break;
+      case SIM_EVENT_LUX:
+        script->lux = evt->value;
+        break;
+      case SIM_EVENT_UART:
+        (void)HalSim_UartInput(USART1, (const uint8_t *)&script->pool[evt->text], evt->value);
+        break;
+      default:
+        break;
+    }
+  }
+  HalSim_AdcPush(&script->lux, 1U);
+  SimScript_Mic(script);
+  return (script->next < script->count) ? script->events[script->next].time_ms : HAL_MAX_DELAY;
+}
+
+static SimScript_EventTypeDef *SimScript_Push(SimScript_TypeDef *script, uint32_t time_ms,
+                                              SimScript_KindTypeDef kind)
+{
+  SimScript_EventTypeDef *evt;
+
+  if (script->count == script->size)
+  {
+    uint32_t size = (script->size == 0U) ? 64U : (script->size * 2U);
+    SimScript_EventTypeDef *events = realloc(script->events, size * sizeof(*events));
+
+    if (events == NULL)
+    {
+      return NULL;
+    }
+    script->events = events;
+    script->size = size;
+  }
+  evt = &script->events[script->count];
+  memset(evt, 0, sizeof(*evt));
+  evt->time_ms = time_ms;
+  evt->seq = script->count++;
+  evt->kind = kind;
+  return evt;
+}
+
+/* The transition, then bounce pairs: level, !level, level ... ends on level */
+static int SimScript_AddEdges(SimScript_TypeDef *script, uint32_t time_ms, uint16_t pin,
+                              GPIO_PinState level, uint32_t bounces)
+{
+  for (uint32_t n = 0U; n <= (2U * bounces); n++)
+  {
+    SimScript_EventTypeDef *evt = SimScript_Push(script, time_ms + n, SIM_EVENT_EDGE);
+
+    if (evt == NULL)
+    {
+      return -1;
+    }
+    evt->pin = pin;
+    evt->value = (uint16_t)(((n & 1U) == 0U) ? level : !level);
+  }
+  return 0;
+}
+
+static int SimScript_Compare(const void *a, const void *b)
+{
+  const SimScript_EventTypeDef *ea = a;
+  const SimScript_EventTypeDef *eb = b;
+
+  if (ea->time_ms != eb->time_ms)
+  {
+    return (ea->time_ms < eb->time_ms) ? -1 : 1;
+  }
+  return (ea->seq < eb->seq) ? -1 : (ea->seq > eb->seq) ? 1 : 0;
+}
+
+/* xorshift32, uniform enough for stimulus in [lo, hi] */
+static uint32_t SimScript_Rand(uint32_t *seed, uint32_t lo, uint32_t hi)
+{
+  uint32_t x = *seed;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *seed = x;
+  return lo + (x % (hi - lo + 1U));
+}
+
+/* One millisecond of microphone samples at the rate the DFSDM is set up
+   for; none before AudioCapture_Init() */
+static void SimScript_Mic(SimScript_TypeDef *script)
+{
+  int16_t samples[64];
+  uint32_t count = HalSim_MicRate() / 1000U;
+
+  if (count > (sizeof(samples) / sizeof(samples[0])))
+  {
+    count = sizeof(samples) / sizeof(samples[0]);
+  }
+  for (uint32_t n = 0U; n < count; n++)
+  {
+    samples[n] = (int16_t)((int32_t)SimScript_Rand(&script->mic, 0U, 2U * SIM_SCRIPT_MIC_NOISE)
+                           - (int32_t)SIM_SCRIPT_MIC_NOISE);
+  }
+  HalSim_MicPush(samples, count);
+}
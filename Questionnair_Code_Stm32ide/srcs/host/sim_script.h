@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file           : sim_script.h
+  * @brief          : Header for sim_script.c file.
+  *                   Timed stimulus for the simulated board: answer button
+  *                   presses with contact bounce, photodiode level and UART
+  *                   input, loaded from a trace file or generated.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SIM_SCRIPT_H
+#define __SIM_SCRIPT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define SIM_SCRIPT_DEFAULT_LUX   100U
+
+/* Room noise on the microphone, peak amplitude of the decimated samples */
+#define SIM_SCRIPT_MIC_NOISE     64U
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  SIM_EVENT_EDGE = 0,       /* answer button pin changes level */
+  SIM_EVENT_LUX,            /* photodiode settles on a new ADC value */
+  SIM_EVENT_UART            /* bytes arrive on the USART1 RX line */
+} SimScript_KindTypeDef;
+
+typedef struct
+{
+  uint32_t time_ms;
+  uint32_t seq;             /* insertion order, keeps the sort stable */
+  SimScript_KindTypeDef kind;
+  uint16_t pin;
+  uint16_t value;           /* level, ADC value or text length */
+  uint32_t text;            /* offset in the text pool */
+} SimScript_EventTypeDef;
+
+typedef struct
+{
+  SimScript_EventTypeDef *events;
+  uint32_t count;
+  uint32_t size;
+  uint32_t next;
+  char *pool;
+  uint32_t pool_len;
+  uint32_t pool_size;
+  uint32_t presses;
+  uint16_t lux;
+  uint32_t mic;             /* noise generator state */
+} SimScript_TypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void SimScript_Init(SimScript_TypeDef *script);
+void SimScript_Free(SimScript_TypeDef *script);
+void SimScript_Clear(SimScript_TypeDef *script);
+int SimScript_Load(SimScript_TypeDef *script, const char *path);
+int SimScript_AddPress(SimScript_TypeDef *script, uint32_t time_ms, uint8_t button,
+                       uint32_t hold_ms, uint32_t bounces);
+int SimScript_AddLux(SimScript_TypeDef *script, uint32_t time_ms, uint16_t value);
+int SimScript_AddUart(SimScript_TypeDef *script, uint32_t time_ms, const char *text, uint32_t len);
+int SimScript_Random(SimScript_TypeDef *script, uint32_t *seed, uint32_t answers);
+void SimScript_Rewind(SimScript_TypeDef *script);
+uint32_t SimScript_End(const SimScript_TypeDef *script);
+uint8_t SimScript_Done(const SimScript_TypeDef *script);
+uint32_t SimScript_Environment(uint32_t now, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SIM_SCRIPT_H */
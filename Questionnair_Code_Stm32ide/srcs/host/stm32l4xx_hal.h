@@ -0,0 +1,764 @@
+/**
+  ******************************************************************************
+  * @file           : stm32l4xx_hal.h
+  * @brief          : Host (Linux) stand-in for the STM32L4 HAL.
+  *                   Only the types, constants and functions used by the
+  *                   application modules in srcs/ are provided. Peripheral
+  *                   behaviour is emulated in hal_sim.c.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STM32L4xx_HAL_H
+#define __STM32L4xx_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  HAL_OK       = 0x00,
+  HAL_ERROR    = 0x01,
+  HAL_BUSY     = 0x02,
+  HAL_TIMEOUT  = 0x03
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+  DISABLE = 0,
+  ENABLE = !DISABLE
+} FunctionalState;
+
+typedef enum
+{
+  EXTI1_IRQn         = 7,
+  EXTI2_IRQn         = 8,
+  EXTI3_IRQn         = 9,
+  EXTI4_IRQn         = 10,
+  DMA1_Channel1_IRQn = 11,
+  DMA1_Channel4_IRQn = 14,
+  DMA1_Channel5_IRQn = 15,
+  DMA1_Channel6_IRQn = 16,
+  DMA1_Channel7_IRQn = 17,
+  ADC1_2_IRQn        = 18,
+  EXTI9_5_IRQn       = 23,
+  I2C2_EV_IRQn       = 33,
+  I2C2_ER_IRQn       = 34,
+  USART1_IRQn        = 37,
+  USART2_IRQn        = 38,
+  EXTI15_10_IRQn     = 40,
+  LPTIM1_IRQn        = 65
+} IRQn_Type;
+
+/* Core / RCC ----------------------------------------------------------------*/
+#define __IO volatile
+
+typedef struct
+{
+  __IO uint32_t CR1;
+  __IO uint32_t CR2;
+  __IO uint32_t SMCR;
+  __IO uint32_t DIER;
+  __IO uint32_t SR;
+  __IO uint32_t EGR;
+  __IO uint32_t CNT;
+  __IO uint32_t PSC;
+  __IO uint32_t ARR;
+} TIM_TypeDef;
+
+extern TIM_TypeDef HalSim_TIM6;
+#define TIM6                      (&HalSim_TIM6)
+
+typedef struct
+{
+  __IO uint32_t CR;
+  __IO uint32_t ICSCR;
+  __IO uint32_t CFGR;
+} RCC_TypeDef;
+
+/* Only the APB1 prescaler: PCLK1 and the APB1 timer clock follow it */
+extern RCC_TypeDef HalSim_RCC;
+#define RCC                       (&HalSim_RCC)
+#define RCC_CFGR_PPRE1_Pos        8U
+#define RCC_CFGR_PPRE1            0x00000700U
+#define RCC_CFGR_PPRE1_DIV1       0x00000000U
+#define RCC_CFGR_PPRE1_DIV2       0x00000400U
+#define RCC_CFGR_PPRE1_DIV4       0x00000500U
+#define RCC_CFGR_PPRE1_DIV8       0x00000600U
+#define RCC_CFGR_PPRE1_DIV16      0x00000700U
+
+#define TIM_CR1_CEN               0x0001U
+#define TIM_CR1_ARPE              0x0080U
+#define TIM_CR2_MMS_1             0x0020U
+#define TIM_EGR_UG                0x0001U
+
+typedef struct
+{
+  __IO uint32_t ISR;
+  __IO uint32_t ICR;
+  __IO uint32_t IER;
+  __IO uint32_t CFGR;
+  __IO uint32_t CR;
+  __IO uint32_t CMP;
+  __IO uint32_t ARR;
+  __IO uint32_t CNT;
+} LPTIM_TypeDef;
+
+extern LPTIM_TypeDef HalSim_LPTIM1;
+#define LPTIM1                    (&HalSim_LPTIM1)
+
+#define LPTIM_ISR_ARRM            0x0002U
+#define LPTIM_ISR_ARROK           0x0010U
+#define LPTIM_ICR_ARRMCF          0x0002U
+#define LPTIM_ICR_ARROKCF         0x0010U
+#define LPTIM_IER_ARRMIE          0x0002U
+#define LPTIM_CR_ENABLE           0x0001U
+#define LPTIM_CR_CNTSTRT          0x0004U
+
+typedef struct
+{
+  __IO uint32_t IMR1;
+  __IO uint32_t EMR1;
+  __IO uint32_t RTSR1;
+  __IO uint32_t FTSR1;
+  __IO uint32_t SWIER1;
+  __IO uint32_t PR1;
+  uint32_t RESERVED1[2];
+  __IO uint32_t IMR2;
+} EXTI_TypeDef;
+
+extern EXTI_TypeDef HalSim_EXTI;
+#define EXTI                      (&HalSim_EXTI)
+#define EXTI_IMR2_IM32            0x0001U
+
+typedef struct
+{
+  __IO uint32_t CTRL;
+  __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+  __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type HalSim_DWT;
+extern CoreDebug_Type HalSim_CoreDebug;
+#define DWT                       (&HalSim_DWT)
+#define CoreDebug                 (&HalSim_CoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk         0x00000001U
+#define CoreDebug_DEMCR_TRCENA_Msk     0x01000000U
+
+/* The simulated CYCCNT only counts whole milliseconds of run time; the
+   profiler reads the host clock in HCLK cycles instead */
+uint32_t HalSim_Cycles(void);
+#define PROFILE_CYCLES()          HalSim_Cycles()
+
+extern uint32_t SystemCoreClock;
+
+void HalSim_IrqDisable(void);
+void HalSim_IrqEnable(void);
+#define __disable_irq()           HalSim_IrqDisable()
+#define __enable_irq()            HalSim_IrqEnable()
+
+#define __HAL_RCC_DMA1_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_I2C2_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_TIM6_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_LPTIM1_CLK_ENABLE() do { } while (0)
+#define __HAL_RCC_LPTIM1_CONFIG(__SOURCE__)          do { (void)(__SOURCE__); } while (0)
+#define __HAL_RCC_WAKEUPSTOP_CLK_CONFIG(__SOURCE__)  do { (void)(__SOURCE__); } while (0)
+#define RCC_LPTIM1CLKSOURCE_LSE       0x000C0000U
+#define RCC_STOP_WAKEUPCLOCK_MSI      0x00000000U
+
+/* PWR -----------------------------------------------------------------------*/
+#define PWR_MAINREGULATOR_ON          0x00000000U
+#define PWR_SLEEPENTRY_WFI            0x01U
+#define PWR_STOPENTRY_WFI             0x01U
+
+#define __HAL_LINKDMA(__HANDLE__, __PPP_DMA_FIELD__, __DMA_HANDLE__) \
+  do { \
+    (__HANDLE__)->__PPP_DMA_FIELD__ = &(__DMA_HANDLE__); \
+    (__DMA_HANDLE__).Parent = (__HANDLE__); \
+  } while (0)
+
+/* Time base -----------------------------------------------------------------*/
+typedef enum
+{
+  HAL_TICK_FREQ_1KHZ = 1U
+} HAL_TickFreqTypeDef;
+
+#define HAL_MAX_DELAY             0xFFFFFFFFU
+
+extern __IO uint32_t uwTick;
+extern HAL_TickFreqTypeDef uwTickFreq;
+
+/* GPIO ----------------------------------------------------------------------*/
+typedef struct
+{
+  __IO uint32_t IDR;
+  __IO uint32_t ODR;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef HalSim_GPIOA;
+extern GPIO_TypeDef HalSim_GPIOB;
+extern GPIO_TypeDef HalSim_GPIOC;
+extern GPIO_TypeDef HalSim_GPIOD;
+extern GPIO_TypeDef HalSim_GPIOE;
+#define GPIOA                     (&HalSim_GPIOA)
+#define GPIOB                     (&HalSim_GPIOB)
+#define GPIOC                     (&HalSim_GPIOC)
+#define GPIOD                     (&HalSim_GPIOD)
+#define GPIOE                     (&HalSim_GPIOE)
+
+typedef enum
+{
+  GPIO_PIN_RESET = 0U,
+  GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct
+{
+  uint32_t Pin;
+  uint32_t Mode;
+  uint32_t Pull;
+  uint32_t Speed;
+  uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_MODE_INPUT               0x00000000U
+#define GPIO_MODE_OUTPUT_PP           0x00000001U
+#define GPIO_MODE_AF_OD               0x00000012U
+#define GPIO_MODE_IT_RISING           0x10110000U
+#define GPIO_MODE_IT_FALLING          0x10210000U
+#define GPIO_MODE_IT_RISING_FALLING   0x10310000U
+#define GPIO_NOPULL                   0x00000000U
+#define GPIO_PULLUP                   0x00000001U
+#define GPIO_PULLDOWN                 0x00000002U
+#define GPIO_SPEED_FREQ_LOW           0x00000000U
+#define GPIO_SPEED_FREQ_VERY_HIGH     0x00000003U
+#define GPIO_AF4_I2C2                 0x04U
+
+#define GPIO_PIN_0                ((uint16_t)0x0001)
+#define GPIO_PIN_1                ((uint16_t)0x0002)
+#define GPIO_PIN_2                ((uint16_t)0x0004)
+#define GPIO_PIN_3                ((uint16_t)0x0008)
+#define GPIO_PIN_4                ((uint16_t)0x0010)
+#define GPIO_PIN_5                ((uint16_t)0x0020)
+#define GPIO_PIN_6                ((uint16_t)0x0040)
+#define GPIO_PIN_7                ((uint16_t)0x0080)
+#define GPIO_PIN_8                ((uint16_t)0x0100)
+#define GPIO_PIN_9                ((uint16_t)0x0200)
+#define GPIO_PIN_10               ((uint16_t)0x0400)
+#define GPIO_PIN_11               ((uint16_t)0x0800)
+#define GPIO_PIN_12               ((uint16_t)0x1000)
+#define GPIO_PIN_13               ((uint16_t)0x2000)
+#define GPIO_PIN_14               ((uint16_t)0x4000)
+#define GPIO_PIN_15               ((uint16_t)0x8000)
+
+/* DMA -----------------------------------------------------------------------*/
+/* CPAR/CMAR hold host pointers */
+typedef struct
+{
+  __IO uint32_t CCR;
+  __IO uint32_t CNDTR;
+  __IO uintptr_t CPAR;
+  __IO uintptr_t CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t CSELR;
+} DMA_Request_TypeDef;
+
+extern DMA_Channel_TypeDef HalSim_DMA1_Channel1;
+extern DMA_Channel_TypeDef HalSim_DMA1_Channel4;
+extern DMA_Channel_TypeDef HalSim_DMA1_Channel5;
+extern DMA_Channel_TypeDef HalSim_DMA1_Channel6;
+extern DMA_Channel_TypeDef HalSim_DMA1_Channel7;
+extern DMA_Request_TypeDef HalSim_DMA1_CSELR;
+#define DMA1_Channel1             (&HalSim_DMA1_Channel1)
+#define DMA1_Channel4             (&HalSim_DMA1_Channel4)
+#define DMA1_Channel5             (&HalSim_DMA1_Channel5)
+#define DMA1_Channel6             (&HalSim_DMA1_Channel6)
+#define DMA1_Channel7             (&HalSim_DMA1_Channel7)
+#define DMA1_CSELR                (&HalSim_DMA1_CSELR)
+
+#define DMA_CCR_EN                0x0001U
+#define DMA_CCR_TCIE              0x0002U
+#define DMA_CCR_DIR               0x0010U
+#define DMA_CCR_MINC              0x0080U
+#define DMA_CSELR_C5S_Pos         16U
+#define DMA_CSELR_C5S             (0xFU << DMA_CSELR_C5S_Pos)
+
+typedef struct
+{
+  uint32_t Request;
+  uint32_t Direction;
+  uint32_t PeriphInc;
+  uint32_t MemInc;
+  uint32_t PeriphDataAlignment;
+  uint32_t MemDataAlignment;
+  uint32_t Mode;
+  uint32_t Priority;
+} DMA_InitTypeDef;
+
+typedef struct
+{
+  DMA_Channel_TypeDef *Instance;
+  DMA_InitTypeDef Init;
+  void *Parent;
+} DMA_HandleTypeDef;
+
+#define DMA_REQUEST_0             0U
+#define DMA_REQUEST_2             2U
+#define DMA_PERIPH_TO_MEMORY      0U
+#define DMA_MEMORY_TO_PERIPH      1U
+#define DMA_PINC_DISABLE          0U
+#define DMA_MINC_ENABLE           1U
+#define DMA_PDATAALIGN_BYTE       0U
+#define DMA_PDATAALIGN_HALFWORD   1U
+#define DMA_MDATAALIGN_BYTE       0U
+#define DMA_MDATAALIGN_HALFWORD   1U
+#define DMA_NORMAL                0U
+#define DMA_CIRCULAR              1U
+#define DMA_PRIORITY_LOW          0U
+#define DMA_PRIORITY_HIGH         2U
+
+/* ADC -----------------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t ISR;
+  uint32_t IER;
+  uint32_t CR;
+  uint32_t CFGR;
+  uint32_t TR1;
+} ADC_TypeDef;
+
+extern ADC_TypeDef HalSim_ADC1;
+#define ADC1                      (&HalSim_ADC1)
+
+typedef struct
+{
+  uint32_t Ratio;
+  uint32_t RightBitShift;
+  uint32_t TriggeredMode;
+  uint32_t OversamplingStopReset;
+} ADC_OversamplingTypeDef;
+
+typedef struct
+{
+  uint32_t ClockPrescaler;
+  uint32_t Resolution;
+  uint32_t DataAlign;
+  uint32_t ScanConvMode;
+  uint32_t EOCSelection;
+  FunctionalState LowPowerAutoWait;
+  FunctionalState ContinuousConvMode;
+  uint32_t NbrOfConversion;
+  FunctionalState DiscontinuousConvMode;
+  uint32_t ExternalTrigConv;
+  uint32_t ExternalTrigConvEdge;
+  FunctionalState DMAContinuousRequests;
+  uint32_t Overrun;
+  FunctionalState OversamplingMode;
+  ADC_OversamplingTypeDef Oversampling;
+} ADC_InitTypeDef;
+
+typedef struct
+{
+  ADC_TypeDef *Instance;
+  ADC_InitTypeDef Init;
+  DMA_HandleTypeDef *DMA_Handle;
+} ADC_HandleTypeDef;
+
+#define ADC_SOFTWARE_START                 0U
+#define ADC_EXTERNALTRIG_T6_TRGO           0x34U
+#define ADC_EXTERNALTRIGCONVEDGE_NONE      0U
+#define ADC_EXTERNALTRIGCONVEDGE_RISING    1U
+#define ADC_OVR_DATA_PRESERVED             0U
+#define ADC_OVR_DATA_OVERWRITTEN           1U
+#define ADC_SINGLE_ENDED                   0U
+
+typedef struct
+{
+  uint32_t Channel;
+  uint32_t Rank;
+  uint32_t SamplingTime;
+  uint32_t SingleDiff;
+  uint32_t OffsetNumber;
+  uint32_t Offset;
+} ADC_ChannelConfTypeDef;
+
+typedef struct
+{
+  uint32_t WatchdogNumber;
+  uint32_t WatchdogMode;
+  uint32_t Channel;
+  FunctionalState ITMode;
+  uint32_t HighThreshold;
+  uint32_t LowThreshold;
+} ADC_AnalogWDGConfTypeDef;
+
+#define ADC_OVERSAMPLING_RATIO_16          0x0000000CU
+#define ADC_RIGHTBITSHIFT_4                0x00000080U
+#define ADC_TRIGGEREDMODE_SINGLE_TRIGGER   0U
+#define ADC_REGOVERSAMPLING_CONTINUED_MODE 0U
+#define ADC_CHANNEL_2                      2U
+#define ADC_REGULAR_RANK_1                 1U
+#define ADC_SAMPLETIME_2CYCLES_5           0U
+#define ADC_SAMPLETIME_47CYCLES_5          4U
+#define ADC_OFFSET_NONE                    4U
+
+#define ADC_CR_ADSTART                     0x00000004U
+#define ADC_CR_ADSTP                       0x00000010U
+#define ADC_REGULAR_GROUP                  0x00000001U
+#define ADC_CFGR_AWD1SGL                   0x00400000U
+#define ADC_CFGR_AWD1EN                    0x00800000U
+#define ADC_TR1_HT1_Pos                    16U
+#define ADC_ANALOGWATCHDOG_1               1U
+#define ADC_ANALOGWATCHDOG_SINGLE_REG      (ADC_CFGR_AWD1SGL | ADC_CFGR_AWD1EN)
+#define ADC_ISR_AWD1                       0x00000080U
+#define ADC_IER_AWD1IE                     0x00000080U
+#define ADC_FLAG_AWD1                      ADC_ISR_AWD1
+#define ADC_IT_AWD1                        ADC_IER_AWD1IE
+
+#define __HAL_ADC_ENABLE_IT(__HANDLE__, __INTERRUPT__)   ((__HANDLE__)->Instance->IER |= (__INTERRUPT__))
+#define __HAL_ADC_DISABLE_IT(__HANDLE__, __INTERRUPT__)  ((__HANDLE__)->Instance->IER &= ~(__INTERRUPT__))
+#define __HAL_ADC_CLEAR_FLAG(__HANDLE__, __FLAG__)       ((__HANDLE__)->Instance->ISR &= ~(__FLAG__))
+
+/* DFSDM ---------------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t CHCFGR1;
+} DFSDM_Channel_TypeDef;
+
+typedef struct
+{
+  uint32_t FLTCR1;
+} DFSDM_Filter_TypeDef;
+
+extern DFSDM_Channel_TypeDef HalSim_DFSDM1_Channel1;
+extern DFSDM_Filter_TypeDef HalSim_DFSDM1_Filter2;
+#define DFSDM1_Channel1           (&HalSim_DFSDM1_Channel1)
+#define DFSDM1_Filter2            (&HalSim_DFSDM1_Filter2)
+
+typedef struct
+{
+  FunctionalState Activation;
+  uint32_t Selection;
+  uint32_t Divider;
+} DFSDM_Channel_OutputClockTypeDef;
+
+typedef struct
+{
+  DFSDM_Channel_OutputClockTypeDef OutputClock;
+  int32_t Offset;
+  uint32_t RightBitShift;
+} DFSDM_Channel_InitTypeDef;
+
+typedef struct
+{
+  DFSDM_Channel_TypeDef *Instance;
+  DFSDM_Channel_InitTypeDef Init;
+} DFSDM_Channel_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t Trigger;
+  FunctionalState FastMode;
+  FunctionalState DmaMode;
+} DFSDM_Filter_RegularParamTypeDef;
+
+typedef struct
+{
+  uint32_t Trigger;
+  FunctionalState ScanMode;
+  FunctionalState DmaMode;
+  uint32_t ExtTrigger;
+  uint32_t ExtTriggerEdge;
+} DFSDM_Filter_InjectedParamTypeDef;
+
+typedef struct
+{
+  uint32_t SincOrder;
+  uint32_t Oversampling;
+  uint32_t IntOversampling;
+} DFSDM_Filter_FilterParamTypeDef;
+
+typedef struct
+{
+  DFSDM_Filter_RegularParamTypeDef RegularParam;
+  DFSDM_Filter_InjectedParamTypeDef InjectedParam;
+  DFSDM_Filter_FilterParamTypeDef FilterParam;
+} DFSDM_Filter_InitTypeDef;
+
+typedef struct
+{
+  DFSDM_Filter_TypeDef *Instance;
+  DFSDM_Filter_InitTypeDef Init;
+  DMA_HandleTypeDef *hdmaReg;
+  uint32_t RegularContMode;
+} DFSDM_Filter_HandleTypeDef;
+
+#define DFSDM_CHANNEL_1                    0x00010002U
+#define DFSDM_CONTINUOUS_CONV_OFF          0U
+#define DFSDM_CONTINUOUS_CONV_ON           1U
+#define DFSDM_FILTER_SW_TRIGGER            0U
+#define DFSDM_FILTER_EXT_TRIG_TIM1_TRGO    0U
+#define DFSDM_FILTER_EXT_TRIG_RISING_EDGE  1U
+#define DFSDM_FILTER_FASTSINC_ORDER        0U
+#define DFSDM_FILTER_SINC1_ORDER           1U
+#define DFSDM_FILTER_SINC2_ORDER           2U
+#define DFSDM_FILTER_SINC3_ORDER           3U
+#define DFSDM_FILTER_SINC4_ORDER           4U
+#define DFSDM_FILTER_SINC5_ORDER           5U
+
+/* I2C -----------------------------------------------------------------------*/
+typedef struct
+{
+  __IO uint32_t CR1;
+  __IO uint32_t CR2;
+  __IO uint32_t OAR1;
+  __IO uint32_t OAR2;
+  __IO uint32_t TIMINGR;
+  __IO uint32_t TIMEOUTR;
+  __IO uint32_t ISR;
+  __IO uint32_t ICR;
+  __IO uint32_t PECR;
+  __IO uint32_t RXDR;
+  __IO uint32_t TXDR;
+} I2C_TypeDef;
+
+extern I2C_TypeDef HalSim_I2C2;
+#define I2C2                      (&HalSim_I2C2)
+
+#define I2C_CR1_PE                0x00000001U
+#define I2C_CR1_TXIE              0x00000002U
+#define I2C_CR1_RXIE              0x00000004U
+#define I2C_CR1_NACKIE            0x00000010U
+#define I2C_CR1_STOPIE            0x00000020U
+#define I2C_CR1_TCIE              0x00000040U
+#define I2C_CR1_ERRIE             0x00000080U
+#define I2C_CR1_RXDMAEN           0x00008000U
+#define I2C_CR2_SADD              0x000003FFU
+#define I2C_CR2_RD_WRN            0x00000400U
+#define I2C_CR2_START             0x00002000U
+#define I2C_CR2_STOP              0x00004000U
+#define I2C_CR2_NBYTES_Pos        16U
+#define I2C_CR2_NBYTES            (0xFFU << I2C_CR2_NBYTES_Pos)
+#define I2C_CR2_AUTOEND           0x02000000U
+#define I2C_ISR_TXE               0x00000001U
+#define I2C_ISR_TXIS              0x00000002U
+#define I2C_ISR_RXNE              0x00000004U
+#define I2C_ISR_NACKF             0x00000010U
+#define I2C_ISR_STOPF             0x00000020U
+#define I2C_ISR_TC                0x00000040U
+#define I2C_ISR_BERR              0x00000100U
+#define I2C_ISR_ARLO              0x00000200U
+#define I2C_ISR_OVR               0x00000400U
+#define I2C_ISR_BUSY              0x00008000U
+#define I2C_ICR_NACKCF            0x00000010U
+#define I2C_ICR_STOPCF            0x00000020U
+#define I2C_ICR_BERRCF            0x00000100U
+#define I2C_ICR_ARLOCF            0x00000200U
+#define I2C_ICR_OVRCF             0x00000400U
+
+/* UART ----------------------------------------------------------------------*/
+typedef struct
+{
+  __IO uint32_t ISR;
+  __IO uint32_t RDR;
+  __IO uint32_t TDR;
+} USART_TypeDef;
+
+extern USART_TypeDef HalSim_USART1;
+extern USART_TypeDef HalSim_USART2;
+extern USART_TypeDef HalSim_USART3;
+#define USART1                    (&HalSim_USART1)
+#define USART2                    (&HalSim_USART2)
+#define USART3                    (&HalSim_USART3)
+
+typedef struct
+{
+  uint32_t BaudRate;
+  uint32_t WordLength;
+  uint32_t StopBits;
+  uint32_t Parity;
+  uint32_t Mode;
+  uint32_t HwFlowCtl;
+  uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef struct
+{
+  USART_TypeDef *Instance;
+  UART_InitTypeDef Init;
+  DMA_HandleTypeDef *hdmatx;
+} UART_HandleTypeDef;
+
+/* QSPI ----------------------------------------------------------------------*/
+typedef struct
+{
+  __IO uint32_t CR;
+} QUADSPI_TypeDef;
+
+extern QUADSPI_TypeDef HalSim_QUADSPI;
+extern uint8_t HalSim_QspiMemory[];
+#define QUADSPI                   (&HalSim_QUADSPI)
+/* Memory-mapped window: the simulated flash array */
+#define QSPI_BASE                 ((uintptr_t)HalSim_QspiMemory)
+
+typedef struct
+{
+  uint32_t ClockPrescaler;
+  uint32_t FifoThreshold;
+  uint32_t SampleShifting;
+  uint32_t FlashSize;
+  uint32_t ChipSelectHighTime;
+  uint32_t ClockMode;
+} QSPI_InitTypeDef;
+
+typedef struct
+{
+  QUADSPI_TypeDef *Instance;
+  QSPI_InitTypeDef Init;
+} QSPI_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t Instruction;
+  uint32_t Address;
+  uint32_t AlternateBytes;
+  uint32_t AddressSize;
+  uint32_t AlternateBytesSize;
+  uint32_t DummyCycles;
+  uint32_t InstructionMode;
+  uint32_t AddressMode;
+  uint32_t AlternateByteMode;
+  uint32_t DataMode;
+  uint32_t NbData;
+  uint32_t DdrMode;
+  uint32_t DdrHoldHalfCycle;
+  uint32_t SIOOMode;
+} QSPI_CommandTypeDef;
+
+typedef struct
+{
+  uint32_t Match;
+  uint32_t Mask;
+  uint32_t Interval;
+  uint32_t StatusBytesSize;
+  uint32_t MatchMode;
+  uint32_t AutomaticStop;
+} QSPI_AutoPollingTypeDef;
+
+typedef struct
+{
+  uint32_t TimeOutActivation;
+  uint32_t TimeOutPeriod;
+} QSPI_MemoryMappedTypeDef;
+
+#define HAL_QSPI_TIMEOUT_DEFAULT_VALUE     5000U
+#define QSPI_INSTRUCTION_NONE              0U
+#define QSPI_INSTRUCTION_1_LINE            1U
+#define QSPI_ADDRESS_NONE                  0U
+#define QSPI_ADDRESS_1_LINE                1U
+#define QSPI_ADDRESS_4_LINES               3U
+#define QSPI_ADDRESS_24_BITS               2U
+#define QSPI_ALTERNATE_BYTES_NONE          0U
+#define QSPI_ALTERNATE_BYTES_4_LINES       3U
+#define QSPI_ALTERNATE_BYTES_8_BITS        0U
+#define QSPI_DATA_NONE                     0U
+#define QSPI_DATA_1_LINE                   1U
+#define QSPI_DATA_4_LINES                  3U
+#define QSPI_DDR_MODE_DISABLE              0U
+#define QSPI_DDR_HHC_ANALOG_DELAY          0U
+#define QSPI_SIOO_INST_EVERY_CMD           0U
+#define QSPI_MATCH_MODE_AND                0U
+#define QSPI_AUTOMATIC_STOP_ENABLE         1U
+#define QSPI_TIMEOUT_COUNTER_DISABLE       0U
+
+/* Exported functions --------------------------------------------------------*/
+void HAL_IncTick(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+uint32_t HAL_GetUIDw0(void);
+uint32_t HAL_GetUIDw1(void);
+uint32_t HAL_GetUIDw2(void);
+void HAL_SuspendTick(void);
+void HAL_ResumeTick(void);
+
+void HAL_PWR_EnterSLEEPMode(uint32_t Regulator, uint8_t SLEEPEntry);
+void HAL_PWREx_EnterSTOP2Mode(uint8_t STOPEntry);
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef *hadc, uint32_t SingleDiff);
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length);
+HAL_StatusTypeDef HAL_ADC_Stop_DMA(ADC_HandleTypeDef *hadc);
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc);
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig);
+HAL_StatusTypeDef HAL_ADC_AnalogWDGConfig(ADC_HandleTypeDef *hadc, ADC_AnalogWDGConfTypeDef *AnalogWDGConfig);
+HAL_StatusTypeDef ADC_ConversionStop(ADC_HandleTypeDef *hadc, uint32_t ConversionGroup);
+void HAL_ADC_IRQHandler(ADC_HandleTypeDef *hadc);
+void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef *hadc);
+
+HAL_StatusTypeDef HAL_DFSDM_ChannelInit(DFSDM_Channel_HandleTypeDef *hdfsdm_channel);
+HAL_StatusTypeDef HAL_DFSDM_ChannelDeInit(DFSDM_Channel_HandleTypeDef *hdfsdm_channel);
+HAL_StatusTypeDef HAL_DFSDM_FilterInit(DFSDM_Filter_HandleTypeDef *hdfsdm_filter);
+HAL_StatusTypeDef HAL_DFSDM_FilterConfigRegChannel(DFSDM_Filter_HandleTypeDef *hdfsdm_filter,
+                                                   uint32_t Channel, uint32_t ContinuousMode);
+HAL_StatusTypeDef HAL_DFSDM_FilterRegularMsbStart_DMA(DFSDM_Filter_HandleTypeDef *hdfsdm_filter,
+                                                      int16_t *pData, uint32_t Length);
+HAL_StatusTypeDef HAL_DFSDM_FilterRegularStop_DMA(DFSDM_Filter_HandleTypeDef *hdfsdm_filter);
+void HAL_DFSDM_FilterRegConvHalfCpltCallback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter);
+void HAL_DFSDM_FilterRegConvCpltCallback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter);
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+
+HAL_StatusTypeDef HAL_QSPI_Command(QSPI_HandleTypeDef *hqspi, QSPI_CommandTypeDef *cmd, uint32_t Timeout);
+HAL_StatusTypeDef HAL_QSPI_Transmit(QSPI_HandleTypeDef *hqspi, uint8_t *pData, uint32_t Timeout);
+HAL_StatusTypeDef HAL_QSPI_Receive(QSPI_HandleTypeDef *hqspi, uint8_t *pData, uint32_t Timeout);
+HAL_StatusTypeDef HAL_QSPI_AutoPolling(QSPI_HandleTypeDef *hqspi, QSPI_CommandTypeDef *cmd,
+                                       QSPI_AutoPollingTypeDef *cfg, uint32_t Timeout);
+HAL_StatusTypeDef HAL_QSPI_MemoryMapped(QSPI_HandleTypeDef *hqspi, QSPI_CommandTypeDef *cmd,
+                                        QSPI_MemoryMappedTypeDef *cfg);
+HAL_StatusTypeDef HAL_QSPI_Abort(QSPI_HandleTypeDef *hqspi);
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+
+void SystemClock_Config(void);
+void PeriphCommonClock_Config(void);
+void LPTIM1_IRQHandler(void);
+void I2C2_EV_IRQHandler(void);
+void I2C2_ER_IRQHandler(void);
+void ADC1_2_IRQHandler(void);
+void DMA1_Channel6_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32L4xx_HAL_H */
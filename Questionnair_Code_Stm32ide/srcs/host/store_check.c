@@ -0,0 +1,359 @@
+/**
+  ******************************************************************************
+  * @file           : store_check.c
+  * @brief          : Power-failure torture test of flash_log.c.
+  *
+  *                     store_check [-r rounds] [-n sectors] [-c cuts] [-s seed] [-v]
+  *
+  *                   Runs the record log on a small region of the
+  *                   simulated QSPI flash. Every round mounts the log,
+  *                   appends a random batch of records with random syncs,
+  *                   and in -c percent of the rounds cuts the flash supply
+  *                   after a random number of programmed bytes, mid-page
+  *                   or mid-erase. The log is then mounted again on restored
+  *                   power and replayed against the model:
+  *
+  *                     - every record returned is intact and appears once
+  *                     - every synced record is still numbered below the
+  *                       append point, so none can be overwritten
+  *                     - every synced FLASH_LOG_KEEP record is present,
+  *                       however many sessions the log has been through;
+  *                       once it holds nothing else, appends fail instead
+  *                     - a synced trace record is only gone if every
+  *                       older one is gone too
+  *
+  *                   The erase counts of the region may end up at most
+  *                   FLASH_LOG_WEAR_SPREAD apart, plus one for every sector
+  *                   the log had to erase again because a cut tore its
+  *                   erase or its opening: that is the only extra wear a
+  *                   cut may cost.
+  *
+  *                   Contents, length and type of a record derive from its
+  *                   number, so a number reused after a lost append
+  *                   stands for the same record.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "flash_log.h"
+#include "hal_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define STORE_RECORDS_MAX      65536U
+#define STORE_LEN_MAX          300U
+#define STORE_KEEP_ONE_IN      100U
+#define STORE_KEEP_LEN_MAX     64U       /* session results are small */
+#define STORE_BATCH_MAX        200U
+#define STORE_CUT_MAX          40000U
+#define FLASH_LOG_WEAR_SPREAD  2U
+
+#define STORE_TYPE_TRACE       1U
+#define STORE_TYPE_KEEP        2U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint8_t synced[STORE_RECORDS_MAX];
+  uint8_t seen[STORE_RECORDS_MAX];
+  uint32_t next;            /* append point of the log */
+  uint32_t visited;
+  uint32_t errors;
+} Store_ModelTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+QSPI_HandleTypeDef hqspi = { QUADSPI, { 2U, 4U, 0U, 23U, 0U, 0U } };
+
+static Store_ModelTypeDef store_model;
+static uint32_t store_rand;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t Store_Hash(uint32_t seq);
+static uint16_t Store_Make(uint32_t seq, uint8_t *payload, uint8_t *type, uint8_t *flags);
+static void Store_Visit(const FlashLog_RecordTypeDef *rec, const uint8_t *payload, void *ctx);
+static int Store_Verify(uint32_t sectors, int verbose);
+static uint32_t Store_Rand(void);
+static void Store_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  unsigned long rounds = 300UL;
+  unsigned long sectors = 16UL;
+  unsigned long percent = 75UL;
+  unsigned long cuts = 0UL;
+  unsigned long appended = 0UL;
+  unsigned long torn = 0UL;
+  unsigned long relocated = 0UL;
+  unsigned long reerased = 0UL;
+  unsigned long refused = 0UL;
+  int verbose = 0;
+  FlashLog_StatsTypeDef stats;
+  int opt;
+
+  store_rand = 1U;
+  while ((opt = getopt(argc, argv, "r:n:c:s:vh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'r':
+        rounds = strtoul(optarg, NULL, 0);
+        break;
+      case 'n':
+        sectors = strtoul(optarg, NULL, 0);
+        break;
+      case 'c':
+        percent = strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        store_rand = ((uint32_t)strtoul(optarg, NULL, 0) * 2U) + 1U;
+        break;
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        Store_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((sectors < FLASH_LOG_MIN_SECTORS) || (sectors > (QSPI_FLASH_SIZE / QSPI_FLASH_SECTOR_SIZE)))
+  {
+    Store_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  HalSim_Reset();
+  HalSim_QspiFormat();
+  memset(&store_model, 0, sizeof(store_model));
+  for (unsigned long round = 0UL; round < rounds; round++)
+  {
+    uint32_t batch = 1U + (Store_Rand() % STORE_BATCH_MAX);
+    uint32_t pending = store_model.next;
+
+    if (Store_Verify((uint32_t)sectors, verbose) != 0)
+    {
+      fprintf(stderr, "store check failed in round %lu\n", round);
+      return EXIT_FAILURE;
+    }
+    FlashLog_GetStats(&stats);
+    torn += stats.torn;
+
+    if ((Store_Rand() % 100U) < percent)
+    {
+      HalSim_QspiPowerCut(Store_Rand() % STORE_CUT_MAX);
+      cuts++;
+    }
+    for (uint32_t n = 0U; (n < batch) && (HalSim_QspiPowered() != 0U); n++)
+    {
+      uint8_t payload[STORE_LEN_MAX];
+      uint8_t type;
+      uint8_t flags;
+      uint32_t seq = store_model.next;
+      uint16_t len = Store_Make(seq, payload, &type, &flags);
+
+      if ((seq + 1U) >= STORE_RECORDS_MAX)
+      {
+        break;
+      }
+      if (FlashLog_Append(type, payload, len, flags) != HAL_OK)
+      {
+        FlashLog_GetStats(&stats);
+        if (stats.full != 0U)
+        {
+          refused++;
+          break;
+        }
+        fprintf(stderr, "append of record %lu failed\n", (unsigned long)seq);
+        return EXIT_FAILURE;
+      }
+      store_model.next++;
+      appended++;
+      if ((Store_Rand() % 8U) == 0U)
+      {
+        if (FlashLog_Sync() != HAL_OK)
+        {
+          fprintf(stderr, "sync failed\n");
+          return EXIT_FAILURE;
+        }
+        for (; (pending < store_model.next) && (HalSim_QspiPowered() != 0U); pending++)
+        {
+          store_model.synced[pending] = 1U;
+        }
+      }
+    }
+    FlashLog_GetStats(&stats);
+    relocated += stats.relocated;
+    reerased += stats.reerased;
+    HalSim_QspiPowerCut(0xFFFFFFFFU);
+  }
+  if (Store_Verify((uint32_t)sectors, verbose) != 0)
+  {
+    fprintf(stderr, "store check failed after the last round\n");
+    return EXIT_FAILURE;
+  }
+
+  FlashLog_GetStats(&stats);
+  reerased += stats.reerased;
+  printf("store: %lu rounds, %lu power cuts, %lu appended, %lu torn, %lu relocated, %lu refused full\n",
+         rounds, cuts, appended, torn + stats.torn, relocated, refused);
+  printf("store: %lu records live in %lu of %lu sectors, erase count %lu..%lu, %lu erased again\n",
+         (unsigned long)store_model.visited, (unsigned long)stats.used_sectors,
+         (unsigned long)stats.sectors, (unsigned long)stats.min_erase_count,
+         (unsigned long)stats.max_erase_count, reerased);
+  if ((stats.max_erase_count - stats.min_erase_count) > (FLASH_LOG_WEAR_SPREAD + reerased))
+  {
+    fprintf(stderr, "store check failed: wear spread %lu\n",
+            (unsigned long)(stats.max_erase_count - stats.min_erase_count));
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+/* Mount the log on a powered flash and replay it against the model */
+static int Store_Verify(uint32_t sectors, int verbose)
+{
+  FlashLog_StatsTypeDef stats;
+  uint32_t oldest_trace = STORE_RECORDS_MAX;
+
+  if (FlashLog_Init(&hqspi, 0U, sectors * QSPI_FLASH_SECTOR_SIZE) != HAL_OK)
+  {
+    fprintf(stderr, "mount failed\n");
+    return -1;
+  }
+  FlashLog_GetStats(&stats);
+  for (uint32_t seq = stats.next_record; seq < store_model.next; seq++)
+  {
+    if (store_model.synced[seq] != 0U)
+    {
+      fprintf(stderr, "synced record %lu is past the append point %lu\n",
+              (unsigned long)seq, (unsigned long)stats.next_record);
+      return -1;
+    }
+  }
+  store_model.next = stats.next_record;
+
+  memset(store_model.seen, 0, sizeof(store_model.seen));
+  store_model.visited = 0U;
+  store_model.errors = 0U;
+  if (FlashLog_Replay(Store_Visit, &store_model) != store_model.visited)
+  {
+    return -1;
+  }
+  if (store_model.errors != 0U)
+  {
+    return -1;
+  }
+
+  for (uint32_t seq = 0U; seq < store_model.next; seq++)
+  {
+    uint8_t payload[STORE_LEN_MAX];
+    uint8_t type;
+    uint8_t flags;
+
+    (void)Store_Make(seq, payload, &type, &flags);
+    if ((type == STORE_TYPE_TRACE) && (store_model.seen[seq] != 0U) && (oldest_trace == STORE_RECORDS_MAX))
+    {
+      oldest_trace = seq;
+    }
+    if ((store_model.synced[seq] == 0U) || (store_model.seen[seq] != 0U))
+    {
+      continue;
+    }
+    if ((type == STORE_TYPE_KEEP) || (seq > oldest_trace))
+    {
+      fprintf(stderr, "synced %s record %lu is missing\n",
+              (type == STORE_TYPE_KEEP) ? "KEEP" : "trace", (unsigned long)seq);
+      return -1;
+    }
+  }
+  if (verbose != 0)
+  {
+    printf("mount: next %lu, %lu records, %lu/%lu sectors, torn %lu, oldest trace %lu\n",
+           (unsigned long)stats.next_record, (unsigned long)store_model.visited,
+           (unsigned long)stats.used_sectors, (unsigned long)stats.sectors,
+           (unsigned long)stats.torn, (unsigned long)oldest_trace);
+  }
+  return 0;
+}
+
+static void Store_Visit(const FlashLog_RecordTypeDef *rec, const uint8_t *payload, void *ctx)
+{
+  Store_ModelTypeDef *model = (Store_ModelTypeDef *)ctx;
+  uint8_t expect[STORE_LEN_MAX];
+  uint8_t type;
+  uint8_t flags;
+  uint16_t len;
+
+  model->visited++;
+  if (rec->seq >= model->next)
+  {
+    fprintf(stderr, "record %lu is past the append point\n", (unsigned long)rec->seq);
+    model->errors++;
+    return;
+  }
+  len = Store_Make(rec->seq, expect, &type, &flags);
+  if ((rec->len != len) || (rec->type != type) || ((rec->flags & FLASH_LOG_KEEP) != flags)
+      || (memcmp(payload, expect, len) != 0))
+  {
+    fprintf(stderr, "record %lu has the wrong contents\n", (unsigned long)rec->seq);
+    model->errors++;
+  }
+  if (model->seen[rec->seq] != 0U)
+  {
+    fprintf(stderr, "record %lu appears twice\n", (unsigned long)rec->seq);
+    model->errors++;
+  }
+  model->seen[rec->seq] = 1U;
+}
+
+/* The record numbered seq */
+static uint16_t Store_Make(uint32_t seq, uint8_t *payload, uint8_t *type, uint8_t *flags)
+{
+  uint32_t hash = Store_Hash(seq);
+  uint16_t len;
+
+  *flags = (((hash >> 16) % STORE_KEEP_ONE_IN) == 0U) ? FLASH_LOG_KEEP : 0U;
+  *type = (*flags != 0U) ? STORE_TYPE_KEEP : STORE_TYPE_TRACE;
+  len = (uint16_t)(1U + (hash % ((*flags != 0U) ? STORE_KEEP_LEN_MAX : STORE_LEN_MAX)));
+  for (uint16_t n = 0U; n < len; n++)
+  {
+    payload[n] = (uint8_t)((hash >> ((n % 4U) * 8U)) ^ n);
+  }
+  return len;
+}
+
+static uint32_t Store_Hash(uint32_t seq)
+{
+  uint32_t h = (seq + 1U) * 2654435761U;
+
+  h ^= h >> 15;
+  h *= 2246822519U;
+  return h ^ (h >> 13);
+}
+
+/* xorshift32 */
+static uint32_t Store_Rand(void)
+{
+  store_rand ^= store_rand << 13;
+  store_rand ^= store_rand >> 17;
+  store_rand ^= store_rand << 5;
+  return store_rand;
+}
+
+static void Store_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-r rounds] [-n sectors] [-c cuts] [-s seed] [-v]\n"
+          "  -r rounds    mount, append and power-cut cycles (300)\n"
+          "  -n sectors   size of the log region, at least %u (16)\n"
+          "  -c cuts      percentage of rounds cut short by a power failure (75)\n"
+          "  -s seed      random seed\n"
+          "  -v           print every mount\n",
+          argv0, FLASH_LOG_MIN_SECTORS);
+}
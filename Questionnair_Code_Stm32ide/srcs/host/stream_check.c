@@ -0,0 +1,253 @@
+/**
+  ******************************************************************************
+  * @file           : stream_check.c
+  * @brief          : Checks the half-buffer hand-off of adc_stream.c.
+  *
+  *                     stream_check [-v]
+  *
+  *                   Samples are pushed one at a time through the
+  *                   simulated DMA, numbered so that a block tells which
+  *                   conversions it holds. Checked, along with the DMA
+  *                   position:
+  *
+  *                     - no block before a half is full, then the oldest
+  *                       full half first, its samples in order
+  *                     - a half is handed over again only once released
+  *                     - the DMA wraps to the start of the buffer
+  *                     - a half filled again before its release counts
+  *                       one overrun and stays readable
+  *                     - releasing with no block ready changes nothing
+  *                     - the watchdog window changes while streaming,
+  *                       with conversions stopped around the write and
+  *                       the DMA position kept
+  *                     - no sample is taken while stopped
+  *                     - no restart after Stop2 until PLLSAI1 is
+  *                       configured again
+  *                     - the trigger rate after timer rounding
+  *                     - the TIM6 period at every APB1 prescaler, the
+  *                       timer clock being twice PCLK1 once APB1 is
+  *                       divided
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Includes ------------------------------------------------------------------*/
+#include "adc_stream.h"
+#include "hal_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define CHECK_HALF   ADC_STREAM_HALF_LEN
+
+/* Private variables ---------------------------------------------------------*/
+ADC_HandleTypeDef hadc1 = { ADC1, { 0U }, NULL };
+
+static const uint32_t check_ppre1[] =
+{
+  RCC_CFGR_PPRE1_DIV1, RCC_CFGR_PPRE1_DIV2, RCC_CFGR_PPRE1_DIV4, RCC_CFGR_PPRE1_DIV8, RCC_CFGR_PPRE1_DIV16
+};
+
+static uint16_t check_next;       /* number of the next sample pushed */
+static uint32_t check_failures;
+static int check_verbose;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Check_Push(uint32_t count);
+static void Check_That(int ok, const char *what);
+static void Check_Block(uint16_t first, const char *what);
+static uint32_t Check_Tim6Rate(void);
+static void Check_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "Error_Handler at simulated tick %lu\n", (unsigned long)HAL_GetTick());
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+  AdcStream_StatsTypeDef stats;
+  ADC_AnalogWDGConfTypeDef awd = {0};
+  uint32_t pos;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "vh")) != -1)
+  {
+    switch (opt)
+    {
+      case 'v':
+        check_verbose = 1;
+        break;
+      default:
+        Check_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (optind != argc)
+  {
+    Check_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  HalSim_Reset();
+  if ((AdcStream_Init(&hadc1, ADC_STREAM_DEFAULT_RATE_HZ) != HAL_OK) || (AdcStream_Start() != HAL_OK))
+  {
+    Error_Handler();
+  }
+
+  /* first half */
+  Check_Push(CHECK_HALF - 1U);
+  Check_That(AdcStream_GetBlock() == NULL, "no block before the first half is full");
+  Check_That(HalSim_AdcDmaPosition() == (CHECK_HALF - 1U), "DMA inside the first half");
+  Check_Push(1U);
+  Check_Block(0U, "first half handed over");
+  Check_That(AdcStream_Latest() == (CHECK_HALF - 1U), "latest sample is the last of the first half");
+
+  /* second half, the first one still held: the oldest comes first */
+  Check_Push(CHECK_HALF);
+  Check_That(HalSim_AdcDmaPosition() == 0U, "DMA wrapped to the start of the buffer");
+  Check_Block(0U, "first half still handed over before the second");
+  AdcStream_ReleaseBlock();
+  Check_Block(CHECK_HALF, "second half after the first is released");
+  AdcStream_ReleaseBlock();
+  Check_That(AdcStream_GetBlock() == NULL, "no block once both are released");
+  AdcStream_ReleaseBlock();
+  Check_That(AdcStream_GetBlock() == NULL, "release with no block ready changes nothing");
+
+  /* a lap with nothing released: the first half is overwritten */
+  Check_Push(CHECK_HALF);
+  Check_Push(CHECK_HALF);
+  Check_Push(CHECK_HALF);
+  AdcStream_GetStats(&stats);
+  Check_That(stats.overruns == 1U, "one overrun for a half filled again before its release");
+  Check_That(stats.blocks == 5U, "five halves completed");
+  Check_Block((uint16_t)(4U * CHECK_HALF), "overwritten half holds its newest samples");
+  AdcStream_ReleaseBlock();
+  Check_Block((uint16_t)(3U * CHECK_HALF), "then the other half");
+  AdcStream_ReleaseBlock();
+
+  /* the AWD1 window moves while streaming, the DMA keeping its place */
+  awd.WatchdogNumber = ADC_ANALOGWATCHDOG_1;
+  awd.WatchdogMode = ADC_ANALOGWATCHDOG_SINGLE_REG;
+  awd.Channel = ADC_CHANNEL_2;
+  awd.ITMode = ENABLE;
+  awd.HighThreshold = 0x0FFFU;
+  awd.LowThreshold = 0U;
+  pos = HalSim_AdcDmaPosition();
+  Check_That(HAL_ADC_AnalogWDGConfig(&hadc1, &awd) == HAL_ERROR, "no TR1 write with ADSTART set");
+  Check_That(AdcStream_SetWatchdog(0x100U, 0x200U) == HAL_OK, "window set while streaming");
+  Check_That(ADC1->TR1 == (0x100U | (0x200U << ADC_TR1_HT1_Pos)), "window written");
+  Check_That((ADC1->CR & ADC_CR_ADSTART) != 0U, "conversions restarted");
+  Check_That(HalSim_AdcDmaPosition() == pos, "DMA position kept");
+  Check_That(AdcStream_SetWatchdog(0U, 0x0FFFU) == HAL_OK, "window reset while streaming");
+
+  /* stopped: samples are never converted */
+  if (AdcStream_Stop() != HAL_OK)
+  {
+    Error_Handler();
+  }
+  Check_That(HalSim_AdcDmaPosition() == CHECK_HALF, "DMA at the second half after five halves");
+  Check_Push(CHECK_HALF);
+  Check_That(HalSim_AdcDmaPosition() == CHECK_HALF, "no sample taken while stopped");
+  Check_That(AdcStream_GetBlock() == NULL, "no block while stopped");
+
+  /* Stop2 stops PLLSAI1, the ADC kernel clock, until it is configured again */
+  HAL_PWREx_EnterSTOP2Mode(PWR_STOPENTRY_WFI);
+  SystemClock_Config();
+  Check_That(AdcStream_Start() == HAL_ERROR, "no restart while Stop2 left PLLSAI1 off");
+  PeriphCommonClock_Config();
+  Check_That(AdcStream_Start() == HAL_OK, "restart once PLLSAI1 is configured again");
+  if (AdcStream_Stop() != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /* timer rounding */
+  Check_That(AdcStream_SetRate(0U) == HAL_ERROR, "rate 0 refused");
+  Check_That(AdcStream_SetRate(ADC_STREAM_DEFAULT_RATE_HZ) == HAL_OK, "default rate");
+  AdcStream_GetStats(&stats);
+  Check_That(stats.rate_hz == ADC_STREAM_DEFAULT_RATE_HZ, "default rate exact");
+  Check_That(AdcStream_SetRate(7U) == HAL_OK, "7 Hz");
+  AdcStream_GetStats(&stats);
+  Check_That((stats.rate_hz >= 6U) && (stats.rate_hz <= 7U), "7 Hz within the prescaler rounding");
+
+  /* APB1 prescaler */
+  for (uint32_t n = 0U; n < (sizeof(check_ppre1) / sizeof(check_ppre1[0])); n++)
+  {
+    char what[64];
+
+    RCC->CFGR = check_ppre1[n];
+    (void)AdcStream_SetRate(ADC_STREAM_DEFAULT_RATE_HZ);
+    AdcStream_GetStats(&stats);
+    snprintf(what, sizeof(what), "TIM6 at the default rate with APB1 /%lu",
+             (unsigned long)(SystemCoreClock / HAL_RCC_GetPCLK1Freq()));
+    Check_That((Check_Tim6Rate() == ADC_STREAM_DEFAULT_RATE_HZ) && (stats.rate_hz == ADC_STREAM_DEFAULT_RATE_HZ),
+               what);
+  }
+  RCC->CFGR = RCC_CFGR_PPRE1_DIV1;
+
+  printf("stream_check: %s\n", (check_failures != 0U) ? "FAILED" : "ok");
+  return (check_failures != 0U) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Numbered samples, 12 bits wide */
+static void Check_Push(uint32_t count)
+{
+  for (uint32_t n = 0U; n < count; n++)
+  {
+    uint16_t sample = (uint16_t)(check_next++ & 0x0FFFU);
+
+    HalSim_AdcPush(&sample, 1U);
+  }
+}
+
+static void Check_That(int ok, const char *what)
+{
+  if (ok == 0)
+  {
+    fprintf(stderr, "stream_check: %s: FAILED\n", what);
+    check_failures++;
+  }
+  else if (check_verbose != 0)
+  {
+    printf("stream_check: %s\n", what);
+  }
+}
+
+/* The block handed over holds samples first .. first + CHECK_HALF - 1 */
+static void Check_Block(uint16_t first, const char *what)
+{
+  const uint16_t *block = AdcStream_GetBlock();
+  int ok = (block != NULL);
+
+  for (uint32_t n = 0U; ok && (n < CHECK_HALF); n++)
+  {
+    ok = (block[n] == ((first + n) & 0x0FFFU));
+  }
+  Check_That(ok, what);
+}
+
+/* Update rate of TIM6 as programmed, on the APB1 timer clock */
+static uint32_t Check_Tim6Rate(void)
+{
+  uint32_t tim_clk = HAL_RCC_GetPCLK1Freq();
+
+  if (tim_clk != SystemCoreClock)
+  {
+    tim_clk *= 2U;
+  }
+  return tim_clk / ((TIM6->PSC + 1U) * (TIM6->ARR + 1U));
+}
+
+static void Check_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [-v]\n"
+          "  -v     one line per check that holds\n",
+          argv0);
+}
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Two simulated boards stream telemetry over pseudo-terminals into one
+# receiver; the columnar log must hold every session, with no frame lost
+# or corrupted, and the replayed trace must come out with its known score.
+#
+#   telemetry_check.sh [build dir]
+
+set -eu
+
+build=${1:-build}
+out=$build/telemetry
+names=$build/telemetry_ptys.txt
+
+rm -rf "$out" "$names"
+"$build/telemetry_rx" -d "$out" -p 2 > "$names" 2> "$build/telemetry_rx.txt" &
+rx=$!
+
+tries=0
+while [ "$(wc -l < "$names")" -lt 2 ]; do
+  tries=$((tries + 1))
+  if [ "$tries" -gt 50 ]; then
+    kill "$rx"
+    echo "telemetry_rx did not open its ptys" >&2
+    exit 1
+  fi
+  sleep 0.1
+done
+pty1=$(sed -n 1p "$names")
+pty2=$(sed -n 2p "$names")
+
+"$build/questionnaire_sim" -a 1 -t "$pty1" traces/age1_five_yes.txt > /dev/null &
+board=$!
+"$build/questionnaire_sim" -a 0 -n 20 -s 7 -t "$pty2" > /dev/null
+wait "$board"
+kill -INT "$rx"
+wait "$rx"
+
+cat "$build/telemetry_rx.txt"
+sessions=$(($(wc -c < "$out/sessions/session.u32") / 4))
+devices=$(wc -l < "$out/devices.txt")
+scores=$(od -An -tu4 -v "$out/sessions/score.u32" | tr -s ' \n' '\n' | grep -c '^5$' || true)
+
+if [ "$sessions" -ne 21 ] || [ "$devices" -ne 2 ] || [ "$scores" -lt 1 ] \
+   || ! grep -q ' 0 lost, 0 bad$' "$build/telemetry_rx.txt"; then
+  echo "telemetry check failed: $sessions sessions, $devices devices" >&2
+  exit 1
+fi
+echo "telemetry: $sessions sessions from $devices boards"
@@ -0,0 +1,659 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry_rx.c
+  * @brief          : Host receiver for the telemetry stream of telemetry.c.
+  *
+  *                     telemetry_rx -d dir [-p ptys] [device ...]
+  *
+  *                   Reads any number of boards at once: serial ports
+  *                   (switched to raw 115200 8N1), captures or FIFOs, and
+  *                   with -p, pseudo-terminals it creates itself and whose
+  *                   slave names it prints one per line, for
+  *                   questionnaire_sim -t. All inputs are multiplexed with
+  *                   poll() in one thread, each with its own frame decoder,
+  *                   so a slow or noisy board never stalls the others.
+  *
+  *                   Records are appended to a columnar session log, one
+  *                   file of little-endian uint32 values per column:
+  *
+  *                     dir/samples/<column>.u32
+  *                     dir/answers/<column>.u32
+  *                     dir/sessions/<column>.u32
+  *                     dir/contexts/<column>.u32   (signed values as int32)
+  *                     dir/profiles/<column>.u32   (cycles per profiled scope)
+  *                     dir/devices.txt       device ID and input it was seen on
+  *
+  *                   Files are opened with O_APPEND and only ever grow, so
+  *                   several runs accumulate in the same log and readers can
+  *                   map the columns while the receiver writes. Row n of a
+  *                   table is element n of each of its column files.
+  *
+  *                   Runs until every input reaches end of file, or until
+  *                   SIGINT/SIGTERM, after which whatever the inputs still
+  *                   hold is drained before the summary is printed.
+  ******************************************************************************
+  */
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 700
+
+/* Includes ------------------------------------------------------------------*/
+#include "telemetry.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+/* Private define ------------------------------------------------------------*/
+#define RX_STREAMS_MAX    64U
+#define RX_COLUMNS_MAX    16U
+#define RX_BATCH          1024U       /* rows buffered per table */
+#define RX_FRAME_LEN      (2U * TELEMETRY_FRAME_MAX)
+#define RX_PATH_LEN       512U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char *name;
+  uint32_t columns;
+  const char *const *column;
+  int fd[RX_COLUMNS_MAX];
+  uint32_t *rows;                     /* [column][RX_BATCH] */
+  uint32_t buffered;
+  unsigned long total;
+} Rx_TableTypeDef;
+
+typedef struct
+{
+  char name[RX_PATH_LEN];
+  int fd;
+  int slave;                          /* pty slave kept open, -1 otherwise */
+  uint8_t frame[RX_FRAME_LEN];
+  uint32_t len;
+  uint8_t overflow;
+  uint8_t synced;
+  uint16_t expect;
+  uint32_t device;
+  uint32_t logged_device;
+  uint8_t age;
+  uint32_t session_lost;
+  unsigned long frames;
+  unsigned long lost;
+  unsigned long bad;
+  unsigned long bytes;
+} Rx_StreamTypeDef;
+
+enum { RX_SAMPLES = 0, RX_ANSWERS, RX_SESSIONS, RX_CONTEXTS, RX_PROFILES, RX_TABLES };
+
+/* Private variables ---------------------------------------------------------*/
+static const char *const rx_sample_cols[] = { "device", "session", "seq", "tick", "lux" };
+static const char *const rx_answer_cols[] =
+{
+  "device", "session", "tick", "question", "button", "score", "latency_ms"
+};
+static const char *const rx_session_cols[] =
+{
+  "device", "session", "tick", "age", "answers", "result", "score", "duration_ms",
+  "max_latency_ms", "bounces", "presses_dropped", "frames_dropped", "frames_lost"
+};
+static const char *const rx_context_cols[] =
+{
+  "device", "session", "tick", "question", "valid", "presence", "handled", "temperature_cdeg",
+  "humidity_permille", "mag_x_mgauss", "mag_y_mgauss", "mag_z_mgauss", "range_mm", "env_age_ms",
+  "mag_age_ms", "range_age_ms"
+};
+static const char *const rx_profile_cols[] =
+{
+  "device", "session", "tick", "scope", "count", "min_cycles", "max_cycles", "mean_cycles",
+  "hist_0", "hist_1", "hist_2", "hist_3", "hist_4", "hist_5", "hist_6", "hist_7"
+};
+
+#define RX_COUNT(a)   (uint32_t)(sizeof(a) / sizeof((a)[0]))
+
+static Rx_TableTypeDef rx_tables[RX_TABLES] =
+{
+  { "samples", RX_COUNT(rx_sample_cols), rx_sample_cols, { 0 }, NULL, 0U, 0UL },
+  { "answers", RX_COUNT(rx_answer_cols), rx_answer_cols, { 0 }, NULL, 0U, 0UL },
+  { "sessions", RX_COUNT(rx_session_cols), rx_session_cols, { 0 }, NULL, 0U, 0UL },
+  { "contexts", RX_COUNT(rx_context_cols), rx_context_cols, { 0 }, NULL, 0U, 0UL },
+  { "profiles", RX_COUNT(rx_profile_cols), rx_profile_cols, { 0 }, NULL, 0U, 0UL }
+};
+
+_Static_assert(RX_COUNT(rx_profile_cols) == (8U + TELEMETRY_PROFILE_BUCKETS), "rx_profile_cols");
+
+static Rx_StreamTypeDef rx_streams[RX_STREAMS_MAX];
+static uint32_t rx_nb_streams;
+static FILE *rx_devices;
+static volatile sig_atomic_t rx_stop;
+
+/* Private function prototypes -----------------------------------------------*/
+static int Rx_OpenLog(const char *dir);
+static int Rx_OpenDevice(const char *path);
+static int Rx_OpenPty(void);
+static void Rx_Raw(int fd);
+static int Rx_Read(Rx_StreamTypeDef *s);
+static void Rx_Byte(Rx_StreamTypeDef *s, uint8_t b);
+static void Rx_Record(Rx_StreamTypeDef *s, const uint8_t *rec, size_t len);
+static void Rx_Append(uint32_t table, const uint32_t *row);
+static void Rx_FlushTable(Rx_TableTypeDef *t);
+static void Rx_Signal(int sig);
+static void Rx_Usage(const char *argv0);
+
+/* Private user code ---------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  struct pollfd pfd[RX_STREAMS_MAX];
+  const char *dir = NULL;
+  unsigned long ptys = 0UL;
+  unsigned long frames = 0UL;
+  unsigned long lost = 0UL;
+  unsigned long bad = 0UL;
+  struct sigaction sa;
+  int open_streams;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:p:h")) != -1)
+  {
+    switch (opt)
+    {
+      case 'd':
+        dir = optarg;
+        break;
+      case 'p':
+        ptys = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        Rx_Usage(argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((dir == NULL) || (((unsigned long)(argc - optind) + ptys) == 0UL)
+      || (((unsigned long)(argc - optind) + ptys) > RX_STREAMS_MAX))
+  {
+    Rx_Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (Rx_OpenLog(dir) != 0)
+  {
+    return EXIT_FAILURE;
+  }
+  for (int n = optind; n < argc; n++)
+  {
+    if (Rx_OpenDevice(argv[n]) != 0)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  for (unsigned long n = 0UL; n < ptys; n++)
+  {
+    if (Rx_OpenPty() != 0)
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  fflush(stdout);
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = Rx_Signal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  /* One thread, one poll() over every board */
+  do
+  {
+    open_streams = 0;
+    for (uint32_t n = 0U; n < rx_nb_streams; n++)
+    {
+      pfd[n].fd = rx_streams[n].fd;
+      pfd[n].events = POLLIN;
+      pfd[n].revents = 0;
+      open_streams += (rx_streams[n].fd >= 0) ? 1 : 0;
+    }
+    if ((open_streams == 0) || (poll(pfd, rx_nb_streams, -1) < 0))
+    {
+      continue;
+    }
+    for (uint32_t n = 0U; n < rx_nb_streams; n++)
+    {
+      if ((pfd[n].revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+      {
+        (void)Rx_Read(&rx_streams[n]);
+      }
+    }
+  } while ((rx_stop == 0) && (open_streams != 0));
+
+  /* Take what is still buffered in the kernel before leaving */
+  for (uint32_t n = 0U; n < rx_nb_streams; n++)
+  {
+    while ((rx_streams[n].fd >= 0) && (Rx_Read(&rx_streams[n]) > 0))
+    {
+    }
+  }
+  for (uint32_t t = 0U; t < RX_TABLES; t++)
+  {
+    Rx_FlushTable(&rx_tables[t]);
+  }
+  fclose(rx_devices);
+
+  for (uint32_t n = 0U; n < rx_nb_streams; n++)
+  {
+    const Rx_StreamTypeDef *s = &rx_streams[n];
+
+    fprintf(stderr, "%s: %lu bytes, %lu frames, %lu lost, %lu bad\n",
+            s->name, s->bytes, s->frames, s->lost, s->bad);
+    frames += s->frames;
+    lost += s->lost;
+    bad += s->bad;
+  }
+  fprintf(stderr, "total: %lu frames, %lu samples, %lu answers, %lu contexts, %lu sessions, %lu profiles, "
+          "%lu lost, %lu bad\n", frames, rx_tables[RX_SAMPLES].total, rx_tables[RX_ANSWERS].total,
+          rx_tables[RX_CONTEXTS].total, rx_tables[RX_SESSIONS].total, rx_tables[RX_PROFILES].total, lost, bad);
+  return EXIT_SUCCESS;
+}
+
+/* Create the log directories and open every column for appending */
+static int Rx_OpenLog(const char *dir)
+{
+  char path[RX_PATH_LEN];
+
+  if ((mkdir(dir, 0777) != 0) && (errno != EEXIST))
+  {
+    perror(dir);
+    return -1;
+  }
+  for (uint32_t t = 0U; t < RX_TABLES; t++)
+  {
+    Rx_TableTypeDef *table = &rx_tables[t];
+
+    snprintf(path, sizeof(path), "%s/%s", dir, table->name);
+    if ((mkdir(path, 0777) != 0) && (errno != EEXIST))
+    {
+      perror(path);
+      return -1;
+    }
+    table->rows = calloc((size_t)table->columns * RX_BATCH, sizeof(uint32_t));
+    if (table->rows == NULL)
+    {
+      fprintf(stderr, "out of memory\n");
+      return -1;
+    }
+    for (uint32_t c = 0U; c < table->columns; c++)
+    {
+      snprintf(path, sizeof(path), "%s/%s/%s.u32", dir, table->name, table->column[c]);
+      table->fd[c] = open(path, O_WRONLY | O_CREAT | O_APPEND, 0666);
+      if (table->fd[c] < 0)
+      {
+        perror(path);
+        return -1;
+      }
+    }
+  }
+  snprintf(path, sizeof(path), "%s/devices.txt", dir);
+  rx_devices = fopen(path, "a");
+  if (rx_devices == NULL)
+  {
+    perror(path);
+    return -1;
+  }
+  return 0;
+}
+
+static Rx_StreamTypeDef *Rx_NewStream(const char *name, int fd, int slave)
+{
+  Rx_StreamTypeDef *s = &rx_streams[rx_nb_streams++];
+
+  memset(s, 0, sizeof(*s));
+  snprintf(s->name, sizeof(s->name), "%s", name);
+  s->fd = fd;
+  s->slave = slave;
+  (void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return s;
+}
+
+/* Serial port, capture file or FIFO */
+static int Rx_OpenDevice(const char *path)
+{
+  int fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+
+  if (fd < 0)
+  {
+    perror(path);
+    return -1;
+  }
+  if (isatty(fd) != 0)
+  {
+    Rx_Raw(fd);
+  }
+  (void)Rx_NewStream(path, fd, -1);
+  return 0;
+}
+
+/* Pseudo-terminal standing in for a board; the slave is kept open so
+   writers can come and go without the master reporting a hang-up */
+static int Rx_OpenPty(void)
+{
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  int slave;
+  const char *name;
+
+  if ((fd < 0) || (grantpt(fd) != 0) || (unlockpt(fd) != 0) || ((name = ptsname(fd)) == NULL))
+  {
+    perror("pty");
+    return -1;
+  }
+  slave = open(name, O_RDWR | O_NOCTTY);
+  if (slave < 0)
+  {
+    perror(name);
+    return -1;
+  }
+  Rx_Raw(slave);
+  printf("%s\n", name);
+  (void)Rx_NewStream(name, fd, slave);
+  return 0;
+}
+
+/* Binary-clean 115200 8N1: no echo, no line editing, no CR/LF mapping */
+static void Rx_Raw(int fd)
+{
+  struct termios tio;
+
+  if (tcgetattr(fd, &tio) == 0)
+  {
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    (void)tcsetattr(fd, TCSANOW, &tio);
+  }
+}
+
+/* Read what is available; closes the stream at end of file */
+static int Rx_Read(Rx_StreamTypeDef *s)
+{
+  uint8_t buf[4096];
+  ssize_t n = read(s->fd, buf, sizeof(buf));
+
+  if (n > 0)
+  {
+    s->bytes += (unsigned long)n;
+    for (ssize_t i = 0; i < n; i++)
+    {
+      Rx_Byte(s, buf[i]);
+    }
+    return (int)n;
+  }
+  if ((n < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+  {
+    return 0;
+  }
+  close(s->fd);
+  s->fd = -1;
+  if (s->slave >= 0)
+  {
+    close(s->slave);
+    s->slave = -1;
+  }
+  return 0;
+}
+
+/* Collect bytes up to the delimiter, then decode the frame */
+static void Rx_Byte(Rx_StreamTypeDef *s, uint8_t b)
+{
+  uint8_t rec[RX_FRAME_LEN];
+  size_t len;
+
+  if (b != FRAME_DELIMITER)
+  {
+    if (s->len < sizeof(s->frame))
+    {
+      s->frame[s->len++] = b;
+    }
+    else
+    {
+      s->overflow = 1U;
+    }
+    return;
+  }
+  if (s->len == 0U)
+  {
+    return;
+  }
+  len = (s->overflow == 0U) ? Frame_Decode(s->frame, s->len, rec) : 0U;
+  s->len = 0U;
+  s->overflow = 0U;
+  if ((len < sizeof(Telemetry_HeaderTypeDef)) || (rec[1] != TELEMETRY_VERSION))
+  {
+    s->bad++;
+    return;
+  }
+  Rx_Record(s, rec, len);
+}
+
+/* One decoded record: account for gaps, append it to its table */
+static void Rx_Record(Rx_StreamTypeDef *s, const uint8_t *rec, size_t len)
+{
+  Telemetry_HeaderTypeDef h;
+  const uint8_t *payload = &rec[sizeof(h)];
+  size_t size = len - sizeof(h);
+  uint32_t row[RX_COLUMNS_MAX];
+
+  memcpy(&h, rec, sizeof(h));
+  if ((s->synced != 0U) && (h.seq != s->expect))
+  {
+    s->lost += (uint16_t)(h.seq - s->expect);
+    s->session_lost += (uint16_t)(h.seq - s->expect);
+  }
+  s->synced = 1U;
+  s->expect = (uint16_t)(h.seq + 1U);
+  s->frames++;
+
+  switch (h.type)
+  {
+    case TELEMETRY_BEGIN:
+    {
+      Telemetry_BeginTypeDef b;
+
+      if (size != sizeof(b))
+      {
+        break;
+      }
+      memcpy(&b, payload, sizeof(b));
+      s->device = b.device;
+      s->age = b.age;
+      s->session_lost = 0U;
+      if (s->logged_device != b.device)
+      {
+        fprintf(rx_devices, "%08lx %s\n", (unsigned long)b.device, s->name);
+        fflush(rx_devices);
+        s->logged_device = b.device;
+      }
+      return;
+    }
+    case TELEMETRY_SAMPLE:
+    {
+      Telemetry_SampleTypeDef smp;
+
+      if (size != sizeof(smp))
+      {
+        break;
+      }
+      memcpy(&smp, payload, sizeof(smp));
+      row[0] = s->device;
+      row[1] = h.session;
+      row[2] = h.seq;
+      row[3] = h.tick;
+      row[4] = smp.lux;
+      Rx_Append(RX_SAMPLES, row);
+      return;
+    }
+    case TELEMETRY_ANSWER:
+    {
+      Telemetry_AnswerTypeDef a;
+
+      if (size != sizeof(a))
+      {
+        break;
+      }
+      memcpy(&a, payload, sizeof(a));
+      row[0] = s->device;
+      row[1] = h.session;
+      row[2] = h.tick;
+      row[3] = a.question;
+      row[4] = a.button;
+      row[5] = a.score;
+      row[6] = a.latency_ms;
+      Rx_Append(RX_ANSWERS, row);
+      return;
+    }
+    case TELEMETRY_END:
+    {
+      Telemetry_SessionTypeDef e;
+
+      if (size != sizeof(e))
+      {
+        break;
+      }
+      memcpy(&e, payload, sizeof(e));
+      row[0] = s->device;
+      row[1] = h.session;
+      row[2] = h.tick;
+      row[3] = s->age;
+      row[4] = e.answers;
+      row[5] = e.result;
+      row[6] = e.score;
+      row[7] = e.duration_ms;
+      row[8] = e.max_latency_ms;
+      row[9] = e.bounces;
+      row[10] = e.presses_dropped;
+      row[11] = e.frames_dropped;
+      row[12] = s->session_lost;
+      Rx_Append(RX_SESSIONS, row);
+      return;
+    }
+    case TELEMETRY_CONTEXT:
+    {
+      Telemetry_ContextTypeDef c;
+
+      if (size != sizeof(c))
+      {
+        break;
+      }
+      memcpy(&c, payload, sizeof(c));
+      row[0] = s->device;
+      row[1] = h.session;
+      row[2] = h.tick;
+      row[3] = c.question;
+      row[4] = c.valid;
+      row[5] = c.presence;
+      row[6] = c.handled;
+      row[7] = (uint32_t)(int32_t)c.temperature_cdeg;
+      row[8] = c.humidity_permille;
+      row[9] = (uint32_t)(int32_t)c.mag_mgauss[0];
+      row[10] = (uint32_t)(int32_t)c.mag_mgauss[1];
+      row[11] = (uint32_t)(int32_t)c.mag_mgauss[2];
+      row[12] = c.range_mm;
+      row[13] = c.env_age_ms;
+      row[14] = c.mag_age_ms;
+      row[15] = c.range_age_ms;
+      Rx_Append(RX_CONTEXTS, row);
+      return;
+    }
+    case TELEMETRY_PROFILE:
+    {
+      Telemetry_ProfileTypeDef p;
+
+      if (size != sizeof(p))
+      {
+        break;
+      }
+      memcpy(&p, payload, sizeof(p));
+      row[0] = s->device;
+      row[1] = h.session;
+      row[2] = h.tick;
+      row[3] = p.scope;
+      row[4] = p.count;
+      row[5] = p.min_cycles;
+      row[6] = p.max_cycles;
+      row[7] = p.mean_cycles;
+      for (uint32_t b = 0U; b < TELEMETRY_PROFILE_BUCKETS; b++)
+      {
+        row[8U + b] = p.histogram[b];
+      }
+      Rx_Append(RX_PROFILES, row);
+      return;
+    }
+    default:
+      break;
+  }
+  s->bad++;
+}
+
+static void Rx_Append(uint32_t table, const uint32_t *row)
+{
+  Rx_TableTypeDef *t = &rx_tables[table];
+
+  for (uint32_t c = 0U; c < t->columns; c++)
+  {
+    t->rows[(c * RX_BATCH) + t->buffered] = row[c];
+  }
+  t->total++;
+  if (++t->buffered == RX_BATCH)
+  {
+    Rx_FlushTable(t);
+  }
+}
+
+/* One write per column; a row is complete once its last column lands */
+static void Rx_FlushTable(Rx_TableTypeDef *t)
+{
+  for (uint32_t c = 0U; (c < t->columns) && (t->buffered != 0U); c++)
+  {
+    const uint8_t *p = (const uint8_t *)&t->rows[c * RX_BATCH];
+    size_t left = t->buffered * sizeof(uint32_t);
+
+    while (left != 0U)
+    {
+      ssize_t n = write(t->fd[c], p, left);
+
+      if (n < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        perror(t->name);
+        exit(EXIT_FAILURE);
+      }
+      p += n;
+      left -= (size_t)n;
+    }
+  }
+  t->buffered = 0U;
+}
+
+static void Rx_Signal(int sig)
+{
+  (void)sig;
+  rx_stop = 1;
+}
+
+static void Rx_Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s -d dir [-p ptys] [device ...]\n"
+          "  -d dir       columnar session log, appended to\n"
+          "  -p ptys      create pseudo-terminals and print their names\n"
+          "  device       serial port, capture file or FIFO to read\n",
+          argv0);
+}
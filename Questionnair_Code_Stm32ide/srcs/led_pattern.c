@@ -0,0 +1,155 @@
+/**
+  ******************************************************************************
+  * @file           : led_pattern.c
+  * @brief          : Table-driven blink pattern engine.
+  *
+  *                   Each pattern is an array of durations in milliseconds,
+  *                   alternating LED on / LED off and terminated by 0.
+  *                   The main loop only enqueues a pattern id;
+  *                   LedPattern_Tick(), called from the 1 ms SysTick,
+  *                   drives the pin. Nothing in here ever blocks.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "led_pattern.h"
+
+/* Private define ------------------------------------------------------------*/
+#define LED_PATTERN_QUEUE_MASK   (LED_PATTERN_QUEUE_LEN - 1U)
+
+/* Private variables ---------------------------------------------------------*/
+static const uint16_t led_slow[] =
+{
+  5000, 5000, 5000, 5000, 0
+};
+
+static const uint16_t led_medium[] =
+{
+  500, 500, 500, 500, 500, 500, 500, 500, 500, 500, 0
+};
+
+static const uint16_t led_fast[] =
+{
+  50, 50, 50, 50, 50, 50, 50, 50, 50, 50, 50, 50, 50, 50, 0
+};
+
+static const uint16_t * const led_patterns[LED_PATTERN_COUNT] =
+{
+  led_slow,
+  led_medium,
+  led_fast
+};
+
+/* Single producer (main loop) / single consumer (SysTick) request queue */
+static volatile uint8_t led_queue[LED_PATTERN_QUEUE_LEN];
+static volatile uint8_t led_queue_head;
+static volatile uint8_t led_queue_tail;
+static volatile uint8_t led_cancel;
+
+/* Owned by LedPattern_Tick() */
+static const uint16_t * volatile led_active;
+static uint8_t led_step;
+static uint16_t led_remaining;
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Reset the engine and switch the LED off.
+  * @retval None
+  */
+void LedPattern_Init(void)
+{
+  led_queue_head = 0U;
+  led_queue_tail = 0U;
+  led_cancel = 0U;
+  led_active = NULL;
+  HAL_GPIO_WritePin(LED_PATTERN_PORT, LED_PATTERN_PIN, GPIO_PIN_RESET);
+}
+
+/**
+  * @brief  Queue a pattern behind the ones already pending.
+  * @param  id: pattern to play
+  * @retval HAL_OK, HAL_BUSY if the queue is full, HAL_ERROR on a bad id
+  */
+HAL_StatusTypeDef LedPattern_Enqueue(LedPattern_IdTypeDef id)
+{
+  uint8_t head = led_queue_head;
+
+  if ((uint32_t)id >= (uint32_t)LED_PATTERN_COUNT)
+  {
+    return HAL_ERROR;
+  }
+  if ((uint8_t)(head - led_queue_tail) >= LED_PATTERN_QUEUE_LEN)
+  {
+    return HAL_BUSY;
+  }
+  led_queue[head & LED_PATTERN_QUEUE_MASK] = (uint8_t)id;
+  led_queue_head = head + 1U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Whether a pattern is playing or waiting in the queue.
+  * @retval 1 if busy, 0 if idle
+  */
+uint8_t LedPattern_Busy(void)
+{
+  return ((led_active != NULL) || (led_queue_head != led_queue_tail)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Drop the current and pending patterns on the next tick.
+  * @retval None
+  */
+void LedPattern_Cancel(void)
+{
+  led_cancel = 1U;
+}
+
+/**
+  * @brief  Advance the engine by one millisecond.
+  * @note   Called from SysTick context.
+  * @retval None
+  */
+void LedPattern_Tick(void)
+{
+  if (led_cancel != 0U)
+  {
+    led_cancel = 0U;
+    led_queue_tail = led_queue_head;
+    led_active = NULL;
+    HAL_GPIO_WritePin(LED_PATTERN_PORT, LED_PATTERN_PIN, GPIO_PIN_RESET);
+    return;
+  }
+
+  if (led_active != NULL)
+  {
+    if (--led_remaining != 0U)
+    {
+      return;
+    }
+    led_step++;
+    if (led_active[led_step] == 0U)
+    {
+      led_active = NULL;
+      HAL_GPIO_WritePin(LED_PATTERN_PORT, LED_PATTERN_PIN, GPIO_PIN_RESET);
+    }
+  }
+
+  if (led_active == NULL)
+  {
+    uint8_t tail = led_queue_tail;
+
+    if (tail == led_queue_head)
+    {
+      return;
+    }
+    led_step = 0U;
+    led_active = led_patterns[led_queue[tail & LED_PATTERN_QUEUE_MASK]];
+    led_queue_tail = tail + 1U;
+  }
+
+  led_remaining = led_active[led_step];
+  HAL_GPIO_WritePin(LED_PATTERN_PORT, LED_PATTERN_PIN,
+                    ((led_step & 1U) == 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
@@ -0,0 +1,48 @@
+/**
+  ******************************************************************************
+  * @file           : led_pattern.h
+  * @brief          : Header for led_pattern.c file.
+  *                   Non-blocking, tick-driven blink patterns on the result
+  *                   LED (GPIOC PIN9).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LED_PATTERN_H
+#define __LED_PATTERN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define LED_PATTERN_PORT         GPIOC
+#define LED_PATTERN_PIN          GPIO_PIN_9
+
+/* Pending pattern requests, must be a power of two */
+#define LED_PATTERN_QUEUE_LEN    4U
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  LED_PATTERN_SLOW = 0,    /* 5 s on / 5 s off, twice      */
+  LED_PATTERN_MEDIUM,      /* 500 ms on / 500 ms off, x5   */
+  LED_PATTERN_FAST,        /* 50 ms on / 50 ms off, x7     */
+  LED_PATTERN_COUNT
+} LedPattern_IdTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void LedPattern_Init(void);
+HAL_StatusTypeDef LedPattern_Enqueue(LedPattern_IdTypeDef id);
+uint8_t LedPattern_Busy(void);
+void LedPattern_Cancel(void);
+void LedPattern_Tick(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LED_PATTERN_H */
@@ -0,0 +1,254 @@
+/**
+  ******************************************************************************
+  * @file           : log_ring.c
+  * @brief          : Lock-free tokenized logger drained by DMA.
+  *
+  *                   Producers (main loop and interrupt handlers) reserve a
+  *                   16-byte record with a compare-and-swap on the head
+  *                   index, fill it, and publish it by writing its sequence
+  *                   number last. Nothing is formatted on the target: a
+  *                   record is a token id, the HAL tick and two arguments,
+  *                   so the cost on the sampling path is a handful of
+  *                   stores.
+  *
+  *                   LogRing_Flush() hands the longest run of contiguous,
+  *                   published records to DMA1 Channel4, which streams them
+  *                   to USART1 (ST-LINK virtual COM port) while the CPU
+  *                   carries on. The transfer-complete callback releases
+  *                   the slots and starts the next run. The host decodes
+  *                   the stream with the token table in log_tokens.h.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "log_ring.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define LOG_RING_MASK   (LOG_RING_LEN - 1U)
+
+/* Private variables ---------------------------------------------------------*/
+DMA_HandleTypeDef hdma_usart1_tx;
+
+static UART_HandleTypeDef *log_huart;
+static LogRing_RecordTypeDef log_ring[LOG_RING_LEN];
+static volatile uint32_t log_head;      /* next record to reserve          */
+static volatile uint32_t log_tail;      /* oldest record not yet sent      */
+static uint32_t log_inflight;           /* records owned by the DMA        */
+static volatile uint8_t log_busy;       /* a transfer is in flight         */
+static LogRing_StatsTypeDef log_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t LogRing_Put(Log_TokenTypeDef token, uint32_t arg0, uint32_t arg1);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Attach the ring to USART1 and configure its TX DMA channel.
+  * @note   Call after MX_USART1_UART_Init(). Records logged before this
+  *         call are kept and sent with the first flush.
+  * @param  huart: handle initialised by MX_USART1_UART_Init
+  * @retval HAL status
+  */
+HAL_StatusTypeDef LogRing_Init(UART_HandleTypeDef *huart)
+{
+  /* DMA1 Channel4 request 2 is USART1_TX on the STM32L475 */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  hdma_usart1_tx.Instance = DMA1_Channel4;
+  hdma_usart1_tx.Init.Request = DMA_REQUEST_2;
+  hdma_usart1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_usart1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_usart1_tx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_usart1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_usart1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_usart1_tx.Init.Mode = DMA_NORMAL;
+  hdma_usart1_tx.Init.Priority = DMA_PRIORITY_LOW;
+  if (HAL_DMA_Init(&hdma_usart1_tx) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  __HAL_LINKDMA(huart, hdmatx, hdma_usart1_tx);
+
+  HAL_NVIC_SetPriority(DMA1_Channel4_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel4_IRQn);
+  HAL_NVIC_SetPriority(USART1_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(USART1_IRQn);
+
+  log_busy = 0U;
+  log_inflight = 0U;
+  log_huart = huart;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Append one record. Safe from any interrupt priority.
+  * @param  token: record type
+  * @param  arg0: first argument
+  * @param  arg1: second argument
+  * @retval None
+  */
+void LogRing_Record(Log_TokenTypeDef token, uint32_t arg0, uint32_t arg1)
+{
+  if (LogRing_Put(token, arg0, arg1) == 0U)
+  {
+    __atomic_fetch_add(&log_stats.dropped, 1U, __ATOMIC_RELAXED);
+  }
+}
+
+/**
+  * @brief  Log free text as LOG_TEXT records of 8 bytes each.
+  * @note   Stops at the first record the ring has no room for; the rest
+  *         is neither logged nor counted as dropped, the caller decides.
+  * @param  text: characters, not necessarily terminated
+  * @param  len: number of characters
+  * @retval Number of characters logged
+  */
+uint32_t LogRing_Text(const char *text, uint32_t len)
+{
+  uint32_t done = 0U;
+
+  while (done < len)
+  {
+    uint32_t chunk[2] = { 0U, 0U };
+    uint32_t n = ((len - done) > sizeof(chunk)) ? sizeof(chunk) : (len - done);
+
+    memcpy(chunk, &text[done], n);
+    if (LogRing_Put(LOG_TEXT, chunk[0], chunk[1]) == 0U)
+    {
+      break;
+    }
+    done += n;
+  }
+  return done;
+}
+
+/**
+  * @brief  Start a DMA transfer of the published records, if idle.
+  * @note   Called from the main loop; the transfer-complete callback keeps
+  *         the stream going on its own while records keep coming.
+  * @retval HAL_OK if a transfer started or nothing was waiting, HAL_BUSY
+  *         if one is in flight, HAL_ERROR before LogRing_Init() or if the
+  *         UART refused the transfer
+  */
+HAL_StatusTypeDef LogRing_Flush(void)
+{
+  uint32_t tail;
+  uint32_t end;
+
+  if (log_huart == NULL)
+  {
+    return HAL_ERROR;
+  }
+  if (__atomic_exchange_n(&log_busy, 1U, __ATOMIC_ACQUIRE) != 0U)
+  {
+    return HAL_BUSY;
+  }
+
+  /* Contiguous run of published records, up to the end of the array */
+  tail = log_tail;
+  end = tail;
+  while ((end != log_head)
+         && (__atomic_load_n(&log_ring[end & LOG_RING_MASK].seq, __ATOMIC_ACQUIRE) == (uint16_t)(end + 1U)))
+  {
+    end++;
+    if ((end & LOG_RING_MASK) == 0U)
+    {
+      break;
+    }
+  }
+
+  log_inflight = end - tail;
+  if (log_inflight == 0U)
+  {
+    __atomic_store_n(&log_busy, 0U, __ATOMIC_RELEASE);
+    return HAL_OK;
+  }
+  if (HAL_UART_Transmit_DMA(log_huart, (uint8_t *)&log_ring[tail & LOG_RING_MASK],
+                            (uint16_t)(log_inflight * sizeof(LogRing_RecordTypeDef))) != HAL_OK)
+  {
+    log_inflight = 0U;
+    __atomic_store_n(&log_busy, 0U, __ATOMIC_RELEASE);
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Whether records are waiting or in flight. The DMA and USART1
+  *         stop in Stop2, so the power manager only sleeps meanwhile.
+  * @retval 1 while busy, 0 otherwise
+  */
+uint8_t LogRing_Busy(void)
+{
+  return ((log_huart != NULL) && ((log_busy != 0U) || (log_head != log_tail))) ? 1U : 0U;
+}
+
+/**
+  * @brief  Snapshot of the logger counters.
+  * @param  stats: destination
+  * @retval None
+  */
+void LogRing_GetStats(LogRing_StatsTypeDef *stats)
+{
+  *stats = log_stats;
+}
+
+/**
+  * @brief  Release the records sent and continue with the next run.
+  * @param  huart: UART handle whose transmission completed
+  * @retval None
+  */
+void LogRing_TxCpltHandler(UART_HandleTypeDef *huart)
+{
+  if (huart != log_huart)
+  {
+    return;
+  }
+  log_stats.bytes_sent += log_inflight * sizeof(LogRing_RecordTypeDef);
+  log_tail += log_inflight;
+  log_inflight = 0U;
+  __atomic_store_n(&log_busy, 0U, __ATOMIC_RELEASE);
+  (void)LogRing_Flush();
+}
+
+/**
+  * @brief This function handles DMA1 channel4 global interrupt.
+  */
+void DMA1_Channel4_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_usart1_tx);
+}
+
+/**
+  * @brief This function handles USART1 global interrupt.
+  */
+void USART1_IRQHandler(void)
+{
+  HAL_UART_IRQHandler(log_huart);
+}
+
+/* Reserve, fill and publish one record; 0 if the ring is full */
+static uint8_t LogRing_Put(Log_TokenTypeDef token, uint32_t arg0, uint32_t arg1)
+{
+  uint32_t head = log_head;
+  LogRing_RecordTypeDef *rec;
+
+  do
+  {
+    if ((head - log_tail) >= LOG_RING_LEN)
+    {
+      return 0U;
+    }
+  } while (!__atomic_compare_exchange_n(&log_head, &head, head + 1U, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  rec = &log_ring[head & LOG_RING_MASK];
+  rec->sync = LOG_RING_SYNC;
+  rec->token = (uint8_t)token;
+  rec->tick = HAL_GetTick();
+  rec->arg[0] = arg0;
+  rec->arg[1] = arg1;
+  __atomic_store_n(&rec->seq, (uint16_t)(head + 1U), __ATOMIC_RELEASE);
+  __atomic_fetch_add(&log_stats.records, 1U, __ATOMIC_RELAXED);
+  return 1U;
+}
@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * @file           : log_ring.h
+  * @brief          : Header for log_ring.c file.
+  *                   Lock-free ring of tokenized log records, drained to
+  *                   USART1 (ST-LINK virtual COM port) by DMA.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LOG_RING_H
+#define __LOG_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "log_tokens.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Records in the ring, power of two below 65536 */
+#define LOG_RING_LEN        64U
+
+/* First byte of every record on the wire */
+#define LOG_RING_SYNC       0xA5U
+
+/* Exported types ------------------------------------------------------------*/
+/* One record, 16 bytes, sent as is (little endian) */
+typedef struct
+{
+  uint8_t sync;             /* LOG_RING_SYNC                               */
+  uint8_t token;            /* Log_TokenTypeDef                            */
+  uint16_t seq;             /* record number + 1, written last (commit)    */
+  uint32_t tick;            /* HAL_GetTick() when recorded                 */
+  uint32_t arg[2];
+} LogRing_RecordTypeDef;
+
+typedef struct
+{
+  uint32_t records;
+  uint32_t dropped;         /* ring full, record lost                      */
+  uint32_t bytes_sent;
+} LogRing_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef LogRing_Init(UART_HandleTypeDef *huart);
+void LogRing_Record(Log_TokenTypeDef token, uint32_t arg0, uint32_t arg1);
+uint32_t LogRing_Text(const char *text, uint32_t len);
+HAL_StatusTypeDef LogRing_Flush(void);
+uint8_t LogRing_Busy(void);
+void LogRing_GetStats(LogRing_StatsTypeDef *stats);
+
+/* Called from HAL_UART_TxCpltCallback */
+void LogRing_TxCpltHandler(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LOG_RING_H */
@@ -0,0 +1,38 @@
+/**
+  ******************************************************************************
+  * @file           : log_tokens.h
+  * @brief          : Token table of the binary log records.
+  *                   The firmware only stores the token id and two 32-bit
+  *                   arguments; the host decoder includes this same table to
+  *                   turn records back into text. Append new tokens at the
+  *                   end so older captures still decode.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LOG_TOKENS_H
+#define __LOG_TOKENS_H
+
+/*  X(id,               name,          format of the two arguments)          */
+#define LOG_TOKENS(X) \
+  X(LOG_TEXT,          "text",        "%.8s")                                \
+  X(LOG_BOOT,          "boot",        "age %lu")                             \
+  X(LOG_PRESS,         "press",       "button %lu")                          \
+  X(LOG_LUX_PRESS,     "lux_press",   "button %lu lux %lu")                  \
+  X(LOG_ANSWER,        "answer",      "question %lu score %lu")              \
+  X(LOG_RESULT,        "result",      "pattern %lu score %lu")               \
+  X(LOG_ADC_OVERRUN,   "adc_overrun", "blocks %lu overruns %lu")          \
+  X(LOG_STORE,         "store",       "next record %lu erases %lu")        \
+  X(LOG_SENSORS,       "sensors",     "present %lu errors %lu")            \
+  X(LOG_AUDIO_OVERRUN, "audio_overrun", "blocks %lu overruns %lu")        \
+  X(LOG_AUDIO,         "audio",       "frames %lu voiced %lu")
+
+#define LOG_TOKEN_ENUM(id, name, fmt)   id,
+
+typedef enum
+{
+  LOG_TOKENS(LOG_TOKEN_ENUM)
+  LOG_TOKEN_COUNT
+} Log_TokenTypeDef;
+
+#endif /* __LOG_TOKENS_H */
@@ -0,0 +1,225 @@
+/**
+  ******************************************************************************
+  * @file           : lux_filter.c
+  * @brief          : Fixed-point conditioning of the lux stream.
+  *
+  *                   Each sample, already the mean of 16 conversions from
+  *                   the ADC oversampler, goes through a median of 3, which
+  *                   removes any single-sample spike, then a first-order
+  *                   IIR kept in Q4. At the end of each block the filtered
+  *                   value is compared with the threshold: above it is a
+  *                   RISE, and only a fall below the hysteresis low ends
+  *                   the crossing, so noise around the threshold answers
+  *                   once.
+  *
+  *                   The ADC analog watchdog watches the raw samples
+  *                   against LuxFilter_Window(): [0, threshold] while dark,
+  *                   [low, full scale] while bright. A block with no
+  *                   watchdog event cannot cross, as every median and the
+  *                   IIR stay in the window too, so it is not examined:
+  *                   the IIR takes the block as constant at the mean of
+  *                   its last 2^LUX_FILTER_IIR_SHIFT samples, the ones it
+  *                   still remembers, a single multiply by the decay of a
+  *                   block. The watchdog event of a sample in the
+  *                   block the DMA is filling may be taken with the block
+  *                   before it, so the block after a woken one is examined
+  *                   too, as is the one after a crossing, while the new
+  *                   window is being armed.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "lux_filter.h"
+#include "adc_stream.h"
+
+/* Private define ------------------------------------------------------------*/
+#define LUX_FILTER_Q            LUX_FILTER_IIR_SHIFT   /* fraction bits of y */
+#define LUX_FILTER_DECAY_ONE    0x10000U               /* Q16                */
+#define LUX_FILTER_SKIP_MEAN    (1U << LUX_FILTER_Q)   /* samples, sum in Q4 */
+
+_Static_assert(LUX_FILTER_SKIP_MEAN <= ADC_STREAM_HALF_LEN, "LUX_FILTER_SKIP_MEAN");
+
+/* Private variables ---------------------------------------------------------*/
+static uint16_t lf_threshold;     /* 0: no crossings                        */
+static uint16_t lf_low;           /* hysteresis low                         */
+static uint16_t lf_history[2];    /* two samples before the next one        */
+static uint32_t lf_y;             /* IIR output, Q4                         */
+static uint32_t lf_decay;         /* (1 - 2^-shift)^ADC_STREAM_HALF_LEN, Q16 */
+static uint8_t lf_primed;
+static uint8_t lf_high;
+static uint8_t lf_examine;        /* examine the next block whatever happens */
+static LuxFilter_StatsTypeDef lf_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t LuxFilter_Median(uint16_t a, uint16_t b, uint16_t c);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Reset the filter for a new threshold.
+  * @param  threshold: 12-bit value above which the photodiode answers,
+  *         0 to only filter
+  * @retval None
+  */
+void LuxFilter_Init(uint16_t threshold)
+{
+  lf_threshold = (threshold > LUX_FILTER_FULL_SCALE) ? LUX_FILTER_FULL_SCALE : threshold;
+  lf_low = (uint16_t)(lf_threshold - (lf_threshold >> LUX_FILTER_HYSTERESIS_SHIFT));
+  lf_history[0] = 0U;
+  lf_history[1] = 0U;
+  lf_y = 0U;
+  lf_primed = 0U;
+  lf_high = 0U;
+  lf_examine = 1U;
+  lf_stats.blocks = 0U;
+  lf_stats.examined = 0U;
+  lf_stats.rises = 0U;
+  lf_stats.falls = 0U;
+
+  lf_decay = LUX_FILTER_DECAY_ONE;
+  for (uint32_t n = 0U; n < ADC_STREAM_HALF_LEN; n++)
+  {
+    lf_decay -= lf_decay >> LUX_FILTER_IIR_SHIFT;
+  }
+}
+
+/**
+  * @brief  Filter one block of the ADC stream.
+  * @param  block: ADC_STREAM_HALF_LEN samples from AdcStream_GetBlock()
+  * @param  woke: the analog watchdog fired since the last block
+  * @retval Crossing at the end of the block, if any
+  */
+LuxFilter_EventTypeDef LuxFilter_Block(const uint16_t *block, uint8_t woke)
+{
+  LuxFilter_EventTypeDef event = LUX_FILTER_NONE;
+  uint16_t value;
+
+  lf_stats.blocks++;
+  if (lf_primed == 0U)
+  {
+    lf_history[0] = block[0];
+    lf_history[1] = block[0];
+    lf_y = (uint32_t)block[0] << LUX_FILTER_Q;
+    lf_primed = 1U;
+  }
+
+  if ((woke != 0U) || (lf_examine != 0U))
+  {
+    int32_t y = (int32_t)lf_y;
+
+    for (uint32_t n = 0U; n < ADC_STREAM_HALF_LEN; n++)
+    {
+      int32_t m = (int32_t)LuxFilter_Median(lf_history[0], lf_history[1], block[n]);
+
+      lf_history[0] = lf_history[1];
+      lf_history[1] = block[n];
+      y += ((m << LUX_FILTER_Q) - y) >> LUX_FILTER_IIR_SHIFT;
+    }
+    lf_y = (uint32_t)y;
+    lf_stats.examined++;
+  }
+  else
+  {
+    /* y = x + (y - x) * decay, x the mean of the newest samples, whose
+       sum is that mean in Q4 */
+    int32_t x = 0;
+    int32_t d;
+
+    for (uint32_t n = ADC_STREAM_HALF_LEN - LUX_FILTER_SKIP_MEAN; n < ADC_STREAM_HALF_LEN; n++)
+    {
+      x += (int32_t)block[n];
+    }
+    d = (int32_t)lf_y - x;
+
+    lf_history[0] = block[ADC_STREAM_HALF_LEN - 2U];
+    lf_history[1] = block[ADC_STREAM_HALF_LEN - 1U];
+    lf_y = (uint32_t)(x + (int32_t)(((int64_t)d * (int64_t)lf_decay) >> 16));
+  }
+  lf_examine = woke;
+
+  value = LuxFilter_Value();
+  if (lf_threshold == 0U)
+  {
+    return LUX_FILTER_NONE;
+  }
+  if ((lf_high == 0U) && (value > lf_threshold))
+  {
+    lf_high = 1U;
+    lf_stats.rises++;
+    event = LUX_FILTER_RISE;
+  }
+  else if ((lf_high != 0U) && (value < lf_low))
+  {
+    lf_high = 0U;
+    lf_stats.falls++;
+    event = LUX_FILTER_FALL;
+  }
+  if (event != LUX_FILTER_NONE)
+  {
+    lf_examine = 1U;
+  }
+  return event;
+}
+
+/**
+  * @brief  Filtered lux value.
+  * @retval 12-bit ADC value
+  */
+uint16_t LuxFilter_Value(void)
+{
+  return (uint16_t)((lf_y + (1UL << (LUX_FILTER_Q - 1U))) >> LUX_FILTER_Q);
+}
+
+/**
+  * @brief  Whether the filtered value crossed the threshold and has not
+  *         fallen back below the hysteresis low since.
+  * @retval 1 while bright
+  */
+uint8_t LuxFilter_High(void)
+{
+  return lf_high;
+}
+
+/**
+  * @brief  Analog watchdog window: a raw sample outside it may make the
+  *         filter cross.
+  * @param  low: lowest sample inside
+  * @param  high: highest sample inside
+  * @retval None
+  */
+void LuxFilter_Window(uint16_t *low, uint16_t *high)
+{
+  if (lf_threshold == 0U)
+  {
+    *low = 0U;
+    *high = LUX_FILTER_FULL_SCALE;
+  }
+  else if (lf_high == 0U)
+  {
+    *low = 0U;
+    *high = lf_threshold;
+  }
+  else
+  {
+    *low = lf_low;
+    *high = LUX_FILTER_FULL_SCALE;
+  }
+}
+
+/**
+  * @brief  Snapshot of the block counters.
+  * @param  stats: destination
+  * @retval None
+  */
+void LuxFilter_GetStats(LuxFilter_StatsTypeDef *stats)
+{
+  *stats = lf_stats;
+}
+
+static uint16_t LuxFilter_Median(uint16_t a, uint16_t b, uint16_t c)
+{
+  uint16_t lo = (a < b) ? a : b;
+  uint16_t hi = (a < b) ? b : a;
+
+  return (c < lo) ? lo : ((c > hi) ? hi : c);
+}
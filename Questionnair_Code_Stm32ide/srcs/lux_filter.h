@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file           : lux_filter.h
+  * @brief          : Header for lux_filter.c file.
+  *                   Fixed-point conditioning of the lux stream: median of
+  *                   3, first-order IIR and a threshold with hysteresis,
+  *                   gated by the ADC analog watchdog.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LUX_FILTER_H
+#define __LUX_FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* IIR y += (x - y) / 2^LUX_FILTER_IIR_SHIFT, a 16 sample time constant */
+#define LUX_FILTER_IIR_SHIFT         4U
+
+/* Falling back below threshold - threshold / 2^LUX_FILTER_HYSTERESIS_SHIFT
+   ends a crossing */
+#define LUX_FILTER_HYSTERESIS_SHIFT  3U
+
+#define LUX_FILTER_FULL_SCALE        0x0FFFU   /* 12-bit results */
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  LUX_FILTER_NONE = 0,
+  LUX_FILTER_RISE,            /* filtered value went above the threshold  */
+  LUX_FILTER_FALL             /* and back below the hysteresis low        */
+} LuxFilter_EventTypeDef;
+
+typedef struct
+{
+  uint32_t blocks;
+  uint32_t examined;          /* blocks filtered sample by sample         */
+  uint32_t rises;
+  uint32_t falls;
+} LuxFilter_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void LuxFilter_Init(uint16_t threshold);
+LuxFilter_EventTypeDef LuxFilter_Block(const uint16_t *block, uint8_t woke);
+uint16_t LuxFilter_Value(void);
+uint8_t LuxFilter_High(void);
+void LuxFilter_Window(uint16_t *low, uint16_t *high);
+void LuxFilter_GetStats(LuxFilter_StatsTypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LUX_FILTER_H */
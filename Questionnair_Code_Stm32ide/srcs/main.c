@@ -19,6 +19,16 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include"string.h"
+#include "adc_stream.h"
+#include "led_pattern.h"
+#include "power_mgr.h"
+#include "app.h"
+#include "log_ring.h"
+#include "telemetry.h"
+#include "flash_log.h"
+#include "sensor_hub.h"
+#include "audio_capture.h"
+#include "profile.h"
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
@@ -41,7 +51,9 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-
+/* Longest wait for the log DMA to make room for printf text: a whole ring
+   takes about 90 ms at 115200 baud */
+#define LOG_DRAIN_TIMEOUT_MS  200U
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -65,7 +77,6 @@ UART_HandleTypeDef huart3;
 PCD_HandleTypeDef hpcd_USB_OTG_FS;
 
 /* USER CODE BEGIN PV */
-uint16_t lux=0;
 char msg[20];
 /* USER CODE END PV */
 
@@ -87,17 +98,34 @@ static void MX_USART2_UART_Init(void);
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
+/* printf goes to the DMA-drained log ring instead of the ITM port. Only
+   the session reports print, once per session, and they are longer than
+   the ring: once it is full, wait for the DMA to make room for the rest.
+   If the ring is not set up, or the DMA stops making room, the rest of
+   the text is dropped */
 int _write(int file,char *ptr,int len)
 {
-	for(int i=0; i<len;i++){
-		ITM_SendChar(*ptr++);
-
+	uint32_t done = LogRing_Text(ptr, (uint32_t)len);
+	uint32_t start = HAL_GetTick();
+
+	while (done < (uint32_t)len)
+	{
+		HAL_StatusTypeDef flushed = LogRing_Flush();
+		uint32_t n = LogRing_Text(&ptr[done], (uint32_t)len - done);
+
+		if (n != 0U)
+		{
+			done += n;
+			start = HAL_GetTick();
+		}
+		else if ((flushed == HAL_ERROR) || ((HAL_GetTick() - start) > LOG_DRAIN_TIMEOUT_MS))
+		{
+			break;
+		}
 	}
-	return len;
+	return (int)done;
 }
 
-uint16_t temp_var=0;
-
 /* USER CODE END 0 */
 
 /**
@@ -141,389 +169,60 @@ int main(void)
   MX_ADC1_Init();
   MX_USART2_UART_Init();
   /* USER CODE BEGIN 2 */
-
+  if (LogRing_Init(&huart1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (Telemetry_Init(&huart2) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* The log keeps below the emotion CNN weights at the top of the QSPI */
+  if (FlashLog_Init(&hqspi, APP_STORE_QSPI_BASE, APP_STORE_QSPI_SIZE) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (SensorHub_Init() != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (AudioCapture_Init(&hdfsdm1_channel1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (AdcStream_Init(&hadc1, ADC_STREAM_DEFAULT_RATE_HZ) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  if (AdcStream_Start() != HAL_OK)
+  {
+    Error_Handler();
+  }
+  LedPattern_Init();
+  Power_Init(POWER_SAMPLE_PERIOD_MS);
+  Profile_Init();
   /* USER CODE END 2 */
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
-  /*int sum=0;
-  int i = 0;
-  int age=0;
-  int temp_sum2=0;
-  int temp_sum1=0;
-  int flag = 0;*/
-  int sum=0;
-    int i = 0;
-    int age=1;
-    int temp_sum2=0;
-    int temp_sum1=0;
-
+  int age=1;
+  uint8_t reported = 0U;
 
+  App_Init((Questionnaire_AgeTypeDef)age);
 
   while (1)
   {
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
-	  HAL_ADC_Start(&hadc1);
-	  	  HAL_ADC_PollForConversion(&hadc1,20);
-	  	  lux=HAL_ADC_GetValue(&hadc1);
-
-	  	  HAL_Delay(500);
-
-
-
-
-	  	if(age==0){
-
-	  		int temp_var_sum =0;
-	  		int flag =0;
-
-
-
-	  		  	  	  if(i<40 ){
-
-	  		  	  		  temp_var = 0;
-	  		  	  		 // HAL_Delay(200);
-	  		  	  		  temp_var = lux;
-
-	  		  	  	int value1 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_1);
-	  		  	    int value2 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_2);
-	  		  	  	int value3 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_3);
-	  		  	    int value4 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_4);
-	  		  	    int value5 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_5);
-
-	  		  	  	if(lux>500){
-	  		  	  		value5 =1;
-	  		  	  		value1 = 0;
-	  		  	  		value2 = 0;
-	  		  	  		value3 = 0;
-	  		  	  		value4 = 0;
-	  		  	  	    temp_var_sum = value1 + 2*value2 + 3*value3 + 4*value4 + 5*value5;
-	  		  	  		flag = 1;
-	  		  	  	}
-	  		  	  	else {
-	  		  	  		flag =0;
-	  		  	  	}
-
-
-	  		  	  	/*	 int value1 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_1);
-	  		  	  	     int value2 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_2);
-	  		  	  	   int value3 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_3);
-	  		  	  			  	    int value4 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_4);
-	  		  	  			  	    int value5 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_5);*/
-
-
-	  		  	  	  /*	int value1 = 0;
-	  		  	 	  	int value2 = 0;
-	  		  	 	  	int value3 = 1;
-	  		  	 	  	int value4 = 0;
-	  		  	 	  	int value5 = 0;*/
-
-	  		  	 	  	int temp_sum = value1 + 2*value2 + 3*value3 + 4*value4 + 5*value5;
-	  		  	 	  	i=i+1;
-	  		  	 	  	if (flag){
-	  		  	 	  	sum=sum+temp_var_sum;
-	  		  	 	  	}
-	  		  	 	  	else{
-	  		  	 	  	sum=sum+temp_sum;
-	  		  	 	  	}
-
-
-
-	  		  	  	  }
-
-	  		  if(i==40){
-	  		  	 	 if(sum>70 && sum<107){
-
-	  		  	  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	  HAL_Delay(5000);
-	  		  	  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	  HAL_Delay(5000);
-	  		  	  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	  HAL_Delay(5000);
-	  		  	  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	  HAL_Delay(5000);
-
-
-	  		      /* USER CODE BEGIN 3 */
-	  		  	 	 }
-
-	  		  	 	if(sum>107 && sum<153){
-
-	  		  	 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	 		  HAL_Delay(500);
-	  		  	 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	 		  HAL_Delay(500);
-	  		  	 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	 		  HAL_Delay(500);
-	  		  	 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	 		  HAL_Delay(500);
-	  		  	 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	 		  HAL_Delay(500);
-	  		  	 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	 		  HAL_Delay(500);
-	  		  	 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	 		  HAL_Delay(500);
-	  		  	 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	 		  HAL_Delay(500);
-	  		  	 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	 		  HAL_Delay(500);
-	  		  	 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	 		  HAL_Delay(500);
-
-	  		  	 	    /* USER CODE BEGIN 3 */
-	  		  	 		 	 }
-
-	  		  	 	if(sum>153 ){
-
-	  		  	 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	 		 		  HAL_Delay(50);
-	  		  	 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	 		 		  HAL_Delay(50);
-	  		  	 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	 		 		  HAL_Delay(50);
-	  		  	 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	 		 		  HAL_Delay(50);
-	  		  	 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	 		 		  HAL_Delay(50);
-	  		  	 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	 		 		  HAL_Delay(50);
-	  		  	 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	 		 		  HAL_Delay(50);
-	  		  	 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	 		 		  HAL_Delay(50);
-	  		  	 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  	 		 		  HAL_Delay(50);
-	  		  	 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	 		 		  HAL_Delay(50);
-	  		  	 		 		 HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-
-	  		  	 		 			HAL_Delay(50);
-	  		  	 		 			 HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  	 		 			  HAL_Delay(50);
-
-	  		  	 		 	    /* USER CODE BEGIN 3 */
-	  		  	 		 		 	 }
-
-
-	  		    }
-	  		    /* USER CODE END 3*/
-	  		  }
-
-	  		  	if(age==1){
-	  		  	int temp_var_sum =0;
-	  		  	  		int flag =0;
-
-	  		  		if(i<20){
-
-	  		  		//HAL_Delay(200);
-
-
-
-	  		  			  			  temp_var = 0;
-	  		  			  			  	  		  	  		 // HAL_Delay(200);
-	  		  			  			  	  		  	  		  temp_var = lux;
-
-	  		  			  			  	  		  	  	int value1 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_1);
-	  		  			  			  	  		  	    int value2 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_2);
-	  		  			  			  	  		  	  	int value3 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_3);
-	  		  			  			  	  		  	   // int value4 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_4);
-	  		  			  			  	  		  	  //  int value5 = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_5);
-
-	  		  			  			  	  		  	  	if(lux>2000){
-	  		  			  			  	  		  	  		//value5 =1;
-	  		  			  			  	  		  	  		value1 = 0;
-	  		  			  			  	  		  	  		value2 = 1;
-	  		  			  			  	  		  	  		value3 = 0;
-	  		  			  			  	  		  	  		//value4 = 0;
-	  		  			  			  	  		  	  	    temp_var_sum = value2 ;
-
-
-
-	  		  			  			  	  		  	  		flag = 1;
-	  		  			  			  	  		  	  	}
-	  		  			  			  	  		  	  	else {
-	  		  			  			  	  		  	  		flag =0;
-	  		  			  			  	  		  	  	}
-
-	  		  			  	/*	int value1 = 0;
-	  		  			 	  	int value2 = 1;
-	  		  			 	  	int value3 = 0;*/
-	  		  			 	  	int temp_sum=value2;
-
-	  		  			 	  	if(flag){
-	  		  			 	  		sum = temp_var_sum +1;
-	  		  			 	  	}
-
-	  		  			 	  	else if(value2==1 && value1==0 && value3==0 && flag !=0){
-	  		  			 	  		sum=temp_sum+1;
-	  		  			 	  		}
-	  		  			 	  		i=i+1;
-	  		  			 	  	}
-
-
-	  		  	if(i==20){
-
-	  		  		if(sum<2){
-
-	  		  		 HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		  HAL_Delay(5000);
-	  		  		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		  HAL_Delay(5000);
-	  		  		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		  HAL_Delay(5000);
-	  		  		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		  HAL_Delay(5000);
-
-	  		  		}
-	  		  	if(sum>=2 && sum<6){
-
-	  		  		 HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		 		  HAL_Delay(500);
-	  		  		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		 		  HAL_Delay(500);
-	  		  		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		 		  HAL_Delay(500);
-	  		  		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		 		  HAL_Delay(500);
-	  		  		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		 		  HAL_Delay(500);
-	  		  		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		 		  HAL_Delay(500);
-	  		  		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		 		  HAL_Delay(500);
-	  		  		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		 		  HAL_Delay(500);
-	  		  		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		 		  HAL_Delay(500);
-	  		  		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		 		  HAL_Delay(500);
-	  		  		}
-
-	  		  	if(sum>7){
-
-	  		  	         HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		 		 		  HAL_Delay(50);
-	  		  		 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		 		 		  HAL_Delay(50);
-	  		  		 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		 		 		  HAL_Delay(50);
-	  		  		 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		 		 		  HAL_Delay(50);
-	  		  		 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		 		 		  HAL_Delay(50);
-	  		  		 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		 		 		  HAL_Delay(50);
-	  		  		 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		 		 		  HAL_Delay(50);
-	  		  		 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		 		 		  HAL_Delay(50);
-	  		  		 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  		 		 		  HAL_Delay(50);
-	  		  		 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		 		 		  HAL_Delay(50);
-	  		  		 		 		 HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-
-	  		  		 		 			HAL_Delay(50);
-	  		  		 		 			 HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  		 		 			  HAL_Delay(50);
-	  		  		}
-	  		  	}
-	  		  	}
-
-	  		  	if(age==2){
-
-	  		  	if(i<50){
-	  		  		if(i<24){
-	  		  				int value1=0;
-	  		  				int value2=1;
-	  		  				int value3=0;
-	  		  				int value4=0;
-
-
-
-	  		  				if(value1==1 || value2==1 || value3==0  || value4==0 ){
-	  		  							temp_sum1=temp_sum1+1;
-
-	  		  							}
-	  		  				i=i+1;
-
-	  		  			}
-	  		  		if(i>24 && i<50){
-	  		  				int value1=0;
-	  		  				int value2=0;
-	  		  				int value3=1;
-	  		  				int value4=0;
-
-
-
-	  		  				if(value3==1 || value4==1 || value1==0 || value2==0){
-	  		  							temp_sum2=temp_sum2+1;
-
-	  		  							}
-	  		  				i=i+1;
-
-
-
-	  		  					}
-
-
-
-
-	  		  	}
-	  		  	sum=temp_sum1+temp_sum2;
-
-	  		  		if(i==50)
-	  		  		{
-	  		  			if(sum>32){
-	  		  					 HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  			 		 		  HAL_Delay(50);
-	  		  			 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  			 		 		  HAL_Delay(50);
-	  		  			 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  			 		 		  HAL_Delay(50);
-	  		  			 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  			 		 		  HAL_Delay(50);
-	  		  			 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  			 		 		  HAL_Delay(50);
-	  		  			 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  			 		 		  HAL_Delay(50);
-	  		  			 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  			 		 		  HAL_Delay(50);
-	  		  			 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  			 		 		  HAL_Delay(50);
-	  		  			 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  			 		 		  HAL_Delay(50);
-	  		  			 		 		  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  			 		 		  HAL_Delay(50);
-	  		  			 		 		 HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-
-	  		  			 		 			HAL_Delay(50);
-	  		  			 		 			 HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  			 		 			  HAL_Delay(50);
-	  		  					}
-	  		  			if(sum<32){
-
-	  		  				 HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  			  HAL_Delay(5000);
-	  		  			  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_RESET);
-	  		  			  HAL_Delay(5000);
-	  		  			  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  			  HAL_Delay(5000);
-	  		  			  HAL_GPIO_WritePin(GPIOC,GPIO_PIN_9,GPIO_PIN_SET);
-	  		  			  HAL_Delay(5000);
-
-	  		  	}
-	  		 		 		 	 }
-
-
-	  	  }
-
-
-
-
-	  	    }
+	  (void)App_Step();
+	  /* the result pattern repeats; the reports print once per session */
+	  if((reported == 0U) && (App_Reported() != 0U)){
+		  reported = 1U;
+		  Power_PrintReport();
+		  Profile_PrintReport();
+	  }
+  }
   /* USER CODE END 3 */
 }
 
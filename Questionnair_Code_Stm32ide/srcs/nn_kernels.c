@@ -0,0 +1,615 @@
+/**
+  ******************************************************************************
+  * @file           : nn_kernels.c
+  * @brief          : Int8 kernels of the emotion CNN.
+  *
+  *                   A 3x3 convolution is computed as a matrix product:
+  *                   the input patch of an output pixel is unrolled into an
+  *                   int16 im2col column, and two columns are multiplied by
+  *                   two output channels at a time, so each weight and each
+  *                   column element is loaded once for two MACs. The conv
+  *                   and pool kernels work one output row at a time from
+  *                   separate input row pointers, so a caller can keep
+  *                   only a few rows of a tensor in a ring. A dense
+  *                   layer widens its input once and walks the weight rows
+  *                   two at a time.
+  *
+  *                   The multiply-accumulate loops come in three flavours:
+  *                   - Cortex-M4 (__ARM_FEATURE_DSP): four int8 weights are
+  *                     widened with SXTB16 into their even and odd pairs,
+  *                     which SMLAD multiplies against a column stored in
+  *                     the same even/odd order, two MACs per instruction.
+  *                   - x86 with AVX2 or SSE2: weights are sign-extended to
+  *                     16 bits and PMADDWD does 16 or 8 MACs at a time.
+  *                   - Otherwise the Cortex-M4 flavour runs on plain C
+  *                     versions of its intrinsics, which is how the host
+  *                     bench checks it. NN_KERNELS_GENERIC selects it on
+  *                     x86 as well.
+  *                   Accumulation is exact in 32 bits, so all of them give
+  *                   the same results.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "nn_kernels.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#if !defined(NN_KERNELS_GENERIC) && defined(__AVX2__)
+#define NN_AVX2           1
+#include <immintrin.h>
+#elif !defined(NN_KERNELS_GENERIC) && defined(__SSE2__)
+#define NN_SSE2           1
+#include <emmintrin.h>
+#else
+#define NN_PACKED         1
+#endif
+
+#if defined(NN_PACKED)
+/* The even/odd order restarts at every im2col row, so the rows of a patch
+   are accumulated one after the other */
+#define NN_SEGMENT(cin)   (3U * (uint32_t)(cin))
+#else
+#define NN_SEGMENT(cin)   (9U * (uint32_t)(cin))
+#endif
+
+/* Packed int8/int16 helpers -------------------------------------------------*/
+#if defined(NN_PACKED)
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1) && !defined(NN_KERNELS_GENERIC)
+#define NN_SXTB16(x)            __SXTB16(x)
+#define NN_ROR8(x)              __ROR((x), 8U)
+#define NN_SMLAD(x, y, acc)     ((int32_t)__SMLAD((x), (y), (uint32_t)(acc)))
+#define NN_SSUB8(x, y)          __SSUB8((x), (y))
+#define NN_SEL(x, y)            __SEL((x), (y))
+#define NN_ISA                  "cortex-m4 dsp"
+#else
+static uint32_t nn_ge;          /* APSR.GE flags of the emulated SSUB8 */
+
+static inline uint32_t NN_SXTB16(uint32_t x)
+{
+  return ((uint32_t)(int32_t)(int8_t)(uint8_t)x & 0xFFFFU)
+         | ((uint32_t)(int32_t)(int8_t)(uint8_t)(x >> 16) << 16);
+}
+
+static inline uint32_t NN_ROR8(uint32_t x)
+{
+  return (x >> 8) | (x << 24);
+}
+
+static inline int32_t NN_SMLAD(uint32_t x, uint32_t y, int32_t acc)
+{
+  return acc + ((int32_t)(int16_t)(uint16_t)x * (int32_t)(int16_t)(uint16_t)y)
+         + ((int32_t)(int16_t)(uint16_t)(x >> 16) * (int32_t)(int16_t)(uint16_t)(y >> 16));
+}
+
+static inline uint32_t NN_SSUB8(uint32_t x, uint32_t y)
+{
+  uint32_t r = 0U;
+
+  nn_ge = 0U;
+  for (uint32_t b = 0U; b < 32U; b += 8U)
+  {
+    int32_t d = (int32_t)(int8_t)(uint8_t)(x >> b) - (int32_t)(int8_t)(uint8_t)(y >> b);
+
+    r |= ((uint32_t)d & 0xFFU) << b;
+    nn_ge |= (d >= 0) ? (0xFFU << b) : 0U;
+  }
+  return r;
+}
+
+static inline uint32_t NN_SEL(uint32_t x, uint32_t y)
+{
+  return (x & nn_ge) | (y & ~nn_ge);
+}
+#define NN_ISA                  "generic (cortex-m4 order)"
+#endif
+
+static inline uint32_t NN_Read32(const void *p)
+{
+  uint32_t v;
+
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline void NN_Write32(void *p, uint32_t v)
+{
+  memcpy(p, &v, sizeof(v));
+}
+#elif defined(NN_AVX2)
+#define NN_ISA                  "avx2"
+#else
+#define NN_ISA                  "sse2"
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static void NnKernels_Widen(const int8_t *src, int16_t *dst, uint32_t n);
+static void NnKernels_Column(const int8_t *const rows[3], uint32_t at, uint32_t cin, int16_t *col);
+static void NnKernels_Mac2x2(const int8_t *w0, const int8_t *w1, const int16_t *c0, const int16_t *c1,
+                             uint32_t n, int32_t acc[4]);
+static void NnKernels_Mac2x1(const int8_t *w0, const int8_t *w1, const int16_t *c, uint32_t n, int32_t acc[2]);
+static void NnKernels_Max4(const int8_t *a, const int8_t *b, const int8_t *c, const int8_t *d, int8_t *out,
+                           uint32_t n);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Valid 3x3 convolution, stride 1, followed by the requantization.
+  * @param  layer: quantized layer, in_ch input and out_ch output channels
+  * @param  in: height x width x in_ch input
+  * @param  height: input rows, at least 3
+  * @param  width: input columns, at least 3
+  * @param  out: (height - 2) x (width - 2) x out_ch output
+  * @param  scratch: NN_KERNELS_CONV_SCRATCH(in_ch) halfwords
+  * @retval None
+  */
+void NnKernels_Conv3x3(const NnKernels_LayerTypeDef *layer, const int8_t *in, uint16_t height, uint16_t width,
+                       int8_t *out, int16_t *scratch)
+{
+  const uint32_t row = (uint32_t)width * layer->in_ch;
+  const uint32_t out_row = ((uint32_t)width - 2U) * layer->out_ch;
+
+  for (uint32_t oy = 0U; (oy + 2U) < height; oy++)
+  {
+    const int8_t *const rows[3] = { &in[oy * row], &in[(oy + 1U) * row], &in[(oy + 2U) * row] };
+
+    NnKernels_Conv3x3Row(layer, rows, width, &out[oy * out_row], scratch);
+  }
+}
+
+/**
+  * @brief  One output row of the 3x3 convolution, from three input rows
+  *         that need not be contiguous (row-tiled execution).
+  * @param  layer: quantized layer, in_ch input and out_ch output channels
+  * @param  rows: three consecutive input rows of width x in_ch
+  * @param  width: input columns, at least 3
+  * @param  out: (width - 2) x out_ch output row
+  * @param  scratch: NN_KERNELS_CONV_SCRATCH(in_ch) halfwords
+  * @retval None
+  */
+void NnKernels_Conv3x3Row(const NnKernels_LayerTypeDef *layer, const int8_t *const rows[3], uint16_t width,
+                          int8_t *out, int16_t *scratch)
+{
+  const uint32_t cin = layer->in_ch;
+  const uint32_t cout = layer->out_ch;
+  const uint32_t k = 9U * cin;
+  const uint32_t seg = NN_SEGMENT(cin);
+  const uint32_t out_w = (uint32_t)width - 2U;
+  int16_t *col0 = scratch;
+  int16_t *col1 = &scratch[k];
+
+  for (uint32_t ox = 0U; ox < out_w; ox += 2U)
+  {
+    const uint32_t pair = ((ox + 1U) < out_w) ? 1U : 0U;
+    int8_t *dst = &out[ox * cout];
+
+    NnKernels_Column(rows, ox * cin, cin, col0);
+    if (pair != 0U)
+    {
+      NnKernels_Column(rows, (ox + 1U) * cin, cin, col1);
+    }
+
+    for (uint32_t oc = 0U; oc < cout; oc += 2U)
+    {
+      const uint32_t oc1 = ((oc + 1U) < cout) ? (oc + 1U) : oc;
+      const int8_t *w0 = &layer->weights[oc * k];
+      const int8_t *w1 = &layer->weights[oc1 * k];
+      int32_t acc[4] = { 0, 0, 0, 0 };
+
+      for (uint32_t s = 0U; s < k; s += seg)
+      {
+        NnKernels_Mac2x2(&w0[s], &w1[s], &col0[s], (pair != 0U) ? &col1[s] : &col0[s], seg, acc);
+      }
+      dst[oc] = NnKernels_Requantize(layer, oc, acc[0] + layer->bias[oc]);
+      if (oc1 != oc)
+      {
+        dst[oc1] = NnKernels_Requantize(layer, oc1, acc[1] + layer->bias[oc1]);
+      }
+      if (pair != 0U)
+      {
+        dst[cout + oc] = NnKernels_Requantize(layer, oc, acc[2] + layer->bias[oc]);
+        if (oc1 != oc)
+        {
+          dst[cout + oc1] = NnKernels_Requantize(layer, oc1, acc[3] + layer->bias[oc1]);
+        }
+      }
+    }
+  }
+}
+
+/**
+  * @brief  2x2 max pooling, stride 2; an odd last row or column is dropped.
+  *         Input and output share the quantization, so no rescaling.
+  * @param  in: height x width x channels input
+  * @param  height: input rows
+  * @param  width: input columns
+  * @param  channels: channels
+  * @param  out: (height / 2) x (width / 2) x channels output, may be in
+  * @retval None
+  */
+void NnKernels_MaxPool2x2(const int8_t *in, uint16_t height, uint16_t width, uint16_t channels, int8_t *out)
+{
+  const uint32_t row = (uint32_t)width * channels;
+  const uint32_t out_row = ((uint32_t)width / 2U) * channels;
+
+  for (uint32_t oy = 0U; oy < ((uint32_t)height / 2U); oy++)
+  {
+    NnKernels_MaxPool2x2Row(&in[(2U * oy) * row], &in[((2U * oy) + 1U) * row], width, channels, &out[oy * out_row]);
+  }
+}
+
+/**
+  * @brief  One output row of the 2x2 max pooling.
+  * @param  row0: upper input row of width x channels
+  * @param  row1: lower input row
+  * @param  width: input columns
+  * @param  channels: channels
+  * @param  out: (width / 2) x channels output row, may be row0
+  * @retval None
+  */
+void NnKernels_MaxPool2x2Row(const int8_t *row0, const int8_t *row1, uint16_t width, uint16_t channels, int8_t *out)
+{
+  for (uint32_t ox = 0U; ox < ((uint32_t)width / 2U); ox++)
+  {
+    const uint32_t at = (2U * ox) * channels;
+
+    NnKernels_Max4(&row0[at], &row0[at + channels], &row1[at], &row1[at + channels], &out[ox * channels], channels);
+  }
+}
+
+/**
+  * @brief  Fully connected layer followed by the requantization.
+  * @param  layer: quantized layer, in_ch inputs and out_ch outputs
+  * @param  in: in_ch inputs
+  * @param  out: out_ch outputs
+  * @param  scratch: NN_KERNELS_DENSE_SCRATCH(in_ch) halfwords
+  * @retval None
+  */
+void NnKernels_Dense(const NnKernels_LayerTypeDef *layer, const int8_t *in, int8_t *out, int16_t *scratch)
+{
+  const uint32_t n = layer->in_ch;
+  const uint32_t cout = layer->out_ch;
+
+  NnKernels_Widen(in, scratch, n);
+  for (uint32_t o = 0U; o < cout; o += 2U)
+  {
+    const uint32_t o1 = ((o + 1U) < cout) ? (o + 1U) : o;
+    int32_t acc[2] = { 0, 0 };
+
+    NnKernels_Mac2x1(&layer->weights[o * n], &layer->weights[o1 * n], scratch, n, acc);
+    out[o] = NnKernels_Requantize(layer, o, acc[0] + layer->bias[o]);
+    out[o1] = NnKernels_Requantize(layer, o1, acc[1] + layer->bias[o1]);
+  }
+}
+
+/**
+  * @brief  Scale an accumulator of output channel `channel` to int8.
+  * @param  layer: quantized layer
+  * @param  channel: output channel
+  * @param  acc: sum of products and bias
+  * @retval Output value, clamped to the activation range
+  */
+int8_t NnKernels_Requantize(const NnKernels_LayerTypeDef *layer, uint32_t channel, int32_t acc)
+{
+  const uint32_t shift = (uint32_t)(31 - (int32_t)layer->shift[channel]);
+  int64_t v = (int64_t)acc * layer->multiplier[channel];
+
+  v = (v + ((int64_t)1 << (shift - 1U))) >> shift;
+  v += layer->output_zp;
+  if (v < layer->act_min)
+  {
+    v = layer->act_min;
+  }
+  if (v > layer->act_max)
+  {
+    v = layer->act_max;
+  }
+  return (int8_t)v;
+}
+
+/**
+  * @brief  Which multiply-accumulate flavour was compiled in.
+  * @retval Name
+  */
+const char *NnKernels_Isa(void)
+{
+  return NN_ISA;
+}
+
+/* Widen n int8 values to int16, in the order the MAC loops expect */
+static void NnKernels_Widen(const int8_t *src, int16_t *dst, uint32_t n)
+{
+  uint32_t i = 0U;
+
+#if defined(NN_PACKED)
+  for (; (i + 4U) <= n; i += 4U)
+  {
+    const uint32_t x = NN_Read32(&src[i]);
+
+    NN_Write32(&dst[i], NN_SXTB16(x));
+    NN_Write32(&dst[i + 2U], NN_SXTB16(NN_ROR8(x)));
+  }
+#elif defined(NN_AVX2)
+  for (; (i + 16U) <= n; i += 16U)
+  {
+    _mm256_storeu_si256((__m256i *)&dst[i], _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&src[i])));
+  }
+#else
+  for (; (i + 8U) <= n; i += 8U)
+  {
+    const __m128i x = _mm_loadl_epi64((const __m128i *)&src[i]);
+
+    _mm_storeu_si128((__m128i *)&dst[i], _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8));
+  }
+#endif
+  for (; i < n; i++)
+  {
+    dst[i] = src[i];
+  }
+}
+
+/* im2col column of the 3x3 patch starting `at` bytes into each of the three
+   input rows: three runs of 3 * cin contiguous values */
+static void NnKernels_Column(const int8_t *const rows[3], uint32_t at, uint32_t cin, int16_t *col)
+{
+  const uint32_t len = 3U * cin;
+
+  for (uint32_t ky = 0U; ky < 3U; ky++)
+  {
+    NnKernels_Widen(&rows[ky][at], &col[ky * len], len);
+  }
+}
+
+/* acc[0] += w0.c0, acc[1] += w1.c0, acc[2] += w0.c1, acc[3] += w1.c1 */
+static void NnKernels_Mac2x2(const int8_t *w0, const int8_t *w1, const int16_t *c0, const int16_t *c1,
+                             uint32_t n, int32_t acc[4])
+{
+  int32_t a00 = acc[0];
+  int32_t a10 = acc[1];
+  int32_t a01 = acc[2];
+  int32_t a11 = acc[3];
+  uint32_t i = 0U;
+
+#if defined(NN_PACKED)
+  for (; (i + 4U) <= n; i += 4U)
+  {
+    const uint32_t x0 = NN_Read32(&c0[i]);
+    const uint32_t y0 = NN_Read32(&c0[i + 2U]);
+    const uint32_t x1 = NN_Read32(&c1[i]);
+    const uint32_t y1 = NN_Read32(&c1[i + 2U]);
+    uint32_t w = NN_Read32(&w0[i]);
+    uint32_t even = NN_SXTB16(w);
+    uint32_t odd = NN_SXTB16(NN_ROR8(w));
+
+    a00 = NN_SMLAD(x0, even, a00);
+    a00 = NN_SMLAD(y0, odd, a00);
+    a01 = NN_SMLAD(x1, even, a01);
+    a01 = NN_SMLAD(y1, odd, a01);
+
+    w = NN_Read32(&w1[i]);
+    even = NN_SXTB16(w);
+    odd = NN_SXTB16(NN_ROR8(w));
+    a10 = NN_SMLAD(x0, even, a10);
+    a10 = NN_SMLAD(y0, odd, a10);
+    a11 = NN_SMLAD(x1, even, a11);
+    a11 = NN_SMLAD(y1, odd, a11);
+  }
+#elif defined(NN_AVX2)
+  {
+    __m256i s00 = _mm256_setzero_si256();
+    __m256i s10 = _mm256_setzero_si256();
+    __m256i s01 = _mm256_setzero_si256();
+    __m256i s11 = _mm256_setzero_si256();
+    __m128i h;
+
+    for (; (i + 16U) <= n; i += 16U)
+    {
+      const __m256i x0 = _mm256_loadu_si256((const __m256i *)&c0[i]);
+      const __m256i x1 = _mm256_loadu_si256((const __m256i *)&c1[i]);
+      const __m256i v0 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w0[i]));
+      const __m256i v1 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w1[i]));
+
+      s00 = _mm256_add_epi32(s00, _mm256_madd_epi16(v0, x0));
+      s10 = _mm256_add_epi32(s10, _mm256_madd_epi16(v1, x0));
+      s01 = _mm256_add_epi32(s01, _mm256_madd_epi16(v0, x1));
+      s11 = _mm256_add_epi32(s11, _mm256_madd_epi16(v1, x1));
+    }
+    /* lane sums of the four accumulators, transposed into one vector */
+    s00 = _mm256_hadd_epi32(s00, s10);
+    s01 = _mm256_hadd_epi32(s01, s11);
+    s00 = _mm256_hadd_epi32(s00, s01);
+    h = _mm_add_epi32(_mm256_castsi256_si128(s00), _mm256_extracti128_si256(s00, 1));
+    a00 += _mm_cvtsi128_si32(h);
+    a10 += _mm_extract_epi32(h, 1);
+    a01 += _mm_extract_epi32(h, 2);
+    a11 += _mm_extract_epi32(h, 3);
+  }
+#else
+  {
+    __m128i s00 = _mm_setzero_si128();
+    __m128i s10 = _mm_setzero_si128();
+    __m128i s01 = _mm_setzero_si128();
+    __m128i s11 = _mm_setzero_si128();
+    int32_t lane[4];
+
+    for (; (i + 8U) <= n; i += 8U)
+    {
+      const __m128i x0 = _mm_loadu_si128((const __m128i *)&c0[i]);
+      const __m128i x1 = _mm_loadu_si128((const __m128i *)&c1[i]);
+      __m128i v0 = _mm_loadl_epi64((const __m128i *)&w0[i]);
+      __m128i v1 = _mm_loadl_epi64((const __m128i *)&w1[i]);
+
+      v0 = _mm_srai_epi16(_mm_unpacklo_epi8(v0, v0), 8);
+      v1 = _mm_srai_epi16(_mm_unpacklo_epi8(v1, v1), 8);
+      s00 = _mm_add_epi32(s00, _mm_madd_epi16(v0, x0));
+      s10 = _mm_add_epi32(s10, _mm_madd_epi16(v1, x0));
+      s01 = _mm_add_epi32(s01, _mm_madd_epi16(v0, x1));
+      s11 = _mm_add_epi32(s11, _mm_madd_epi16(v1, x1));
+    }
+    /* 4x4 transpose, then one vertical add gives the four sums */
+    {
+      const __m128i t0 = _mm_unpacklo_epi32(s00, s10);
+      const __m128i t1 = _mm_unpackhi_epi32(s00, s10);
+      const __m128i t2 = _mm_unpacklo_epi32(s01, s11);
+      const __m128i t3 = _mm_unpackhi_epi32(s01, s11);
+      const __m128i u0 = _mm_add_epi32(t0, t1);
+      const __m128i u1 = _mm_add_epi32(t2, t3);
+
+      _mm_storeu_si128((__m128i *)lane,
+                       _mm_add_epi32(_mm_unpacklo_epi64(u0, u1), _mm_unpackhi_epi64(u0, u1)));
+    }
+    a00 += lane[0];
+    a10 += lane[1];
+    a01 += lane[2];
+    a11 += lane[3];
+  }
+#endif
+  for (; i < n; i++)
+  {
+    a00 += (int32_t)w0[i] * c0[i];
+    a10 += (int32_t)w1[i] * c0[i];
+    a01 += (int32_t)w0[i] * c1[i];
+    a11 += (int32_t)w1[i] * c1[i];
+  }
+  acc[0] = a00;
+  acc[1] = a10;
+  acc[2] = a01;
+  acc[3] = a11;
+}
+
+/* acc[0] += w0.c, acc[1] += w1.c */
+static void NnKernels_Mac2x1(const int8_t *w0, const int8_t *w1, const int16_t *c, uint32_t n, int32_t acc[2])
+{
+  int32_t a0 = acc[0];
+  int32_t a1 = acc[1];
+  uint32_t i = 0U;
+
+#if defined(NN_PACKED)
+  for (; (i + 4U) <= n; i += 4U)
+  {
+    const uint32_t x = NN_Read32(&c[i]);
+    const uint32_t y = NN_Read32(&c[i + 2U]);
+    const uint32_t v0 = NN_Read32(&w0[i]);
+    const uint32_t v1 = NN_Read32(&w1[i]);
+
+    a0 = NN_SMLAD(x, NN_SXTB16(v0), a0);
+    a0 = NN_SMLAD(y, NN_SXTB16(NN_ROR8(v0)), a0);
+    a1 = NN_SMLAD(x, NN_SXTB16(v1), a1);
+    a1 = NN_SMLAD(y, NN_SXTB16(NN_ROR8(v1)), a1);
+  }
+#elif defined(NN_AVX2)
+  {
+    __m256i s0 = _mm256_setzero_si256();
+    __m256i s1 = _mm256_setzero_si256();
+    __m128i h;
+
+    for (; (i + 16U) <= n; i += 16U)
+    {
+      const __m256i x = _mm256_loadu_si256((const __m256i *)&c[i]);
+
+      s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w0[i])), x));
+      s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)&w1[i])), x));
+    }
+    s0 = _mm256_hadd_epi32(s0, s1);
+    s0 = _mm256_hadd_epi32(s0, s0);
+    h = _mm_add_epi32(_mm256_castsi256_si128(s0), _mm256_extracti128_si256(s0, 1));
+    a0 += _mm_cvtsi128_si32(h);
+    a1 += _mm_extract_epi32(h, 1);
+  }
+#else
+  {
+    __m128i s0 = _mm_setzero_si128();
+    __m128i s1 = _mm_setzero_si128();
+    int32_t lane[4];
+
+    for (; (i + 8U) <= n; i += 8U)
+    {
+      const __m128i x = _mm_loadu_si128((const __m128i *)&c[i]);
+      __m128i v0 = _mm_loadl_epi64((const __m128i *)&w0[i]);
+      __m128i v1 = _mm_loadl_epi64((const __m128i *)&w1[i]);
+
+      v0 = _mm_srai_epi16(_mm_unpacklo_epi8(v0, v0), 8);
+      v1 = _mm_srai_epi16(_mm_unpacklo_epi8(v1, v1), 8);
+      s0 = _mm_add_epi32(s0, _mm_madd_epi16(v0, x));
+      s1 = _mm_add_epi32(s1, _mm_madd_epi16(v1, x));
+    }
+    {
+      const __m128i t0 = _mm_unpacklo_epi32(s0, s1);
+      const __m128i t1 = _mm_unpackhi_epi32(s0, s1);
+      const __m128i u = _mm_add_epi32(t0, t1);
+
+      _mm_storeu_si128((__m128i *)lane, _mm_add_epi32(u, _mm_unpackhi_epi64(u, u)));
+    }
+    a0 += lane[0];
+    a1 += lane[1];
+  }
+#endif
+  for (; i < n; i++)
+  {
+    a0 += (int32_t)w0[i] * c[i];
+    a1 += (int32_t)w1[i] * c[i];
+  }
+  acc[0] = a0;
+  acc[1] = a1;
+}
+
+/* out[i] = max(a[i], b[i], c[i], d[i]) */
+static void NnKernels_Max4(const int8_t *a, const int8_t *b, const int8_t *c, const int8_t *d, int8_t *out,
+                           uint32_t n)
+{
+  uint32_t i = 0U;
+
+#if defined(NN_PACKED)
+  for (; (i + 4U) <= n; i += 4U)
+  {
+    const uint32_t x = NN_Read32(&a[i]);
+    const uint32_t y = NN_Read32(&b[i]);
+    const uint32_t z = NN_Read32(&c[i]);
+    const uint32_t t = NN_Read32(&d[i]);
+    uint32_t m1;
+    uint32_t m2;
+
+    (void)NN_SSUB8(x, y);
+    m1 = NN_SEL(x, y);
+    (void)NN_SSUB8(z, t);
+    m2 = NN_SEL(z, t);
+    (void)NN_SSUB8(m1, m2);
+    NN_Write32(&out[i], NN_SEL(m1, m2));
+  }
+#elif defined(NN_AVX2)
+  for (; (i + 32U) <= n; i += 32U)
+  {
+    const __m256i m1 = _mm256_max_epi8(_mm256_loadu_si256((const __m256i *)&a[i]),
+                                       _mm256_loadu_si256((const __m256i *)&b[i]));
+    const __m256i m2 = _mm256_max_epi8(_mm256_loadu_si256((const __m256i *)&c[i]),
+                                       _mm256_loadu_si256((const __m256i *)&d[i]));
+
+    _mm256_storeu_si256((__m256i *)&out[i], _mm256_max_epi8(m1, m2));
+  }
+#else
+  {
+    /* SSE2 only has an unsigned byte max: flip the sign bits around it */
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+
+    for (; (i + 16U) <= n; i += 16U)
+    {
+      const __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&a[i]), bias);
+      const __m128i y = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&b[i]), bias);
+      const __m128i z = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&c[i]), bias);
+      const __m128i t = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&d[i]), bias);
+
+      _mm_storeu_si128((__m128i *)&out[i],
+                       _mm_xor_si128(_mm_max_epu8(_mm_max_epu8(x, y), _mm_max_epu8(z, t)), bias));
+    }
+  }
+#endif
+  for (; i < n; i++)
+  {
+    int8_t m = a[i];
+
+    m = (b[i] > m) ? b[i] : m;
+    m = (c[i] > m) ? c[i] : m;
+    m = (d[i] > m) ? d[i] : m;
+    out[i] = m;
+  }
+}
@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+  * @file           : nn_kernels.h
+  * @brief          : Header for nn_kernels.c file.
+  *                   Int8 kernels for the layer types of the emotion CNN:
+  *                   3x3 convolution, 2x2 max pooling and fully connected.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __NN_KERNELS_H
+#define __NN_KERNELS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Requantization shifts accepted by NnKernels_Requantize() */
+#define NN_KERNELS_SHIFT_MIN     (-31)
+#define NN_KERNELS_SHIFT_MAX     30
+
+/* int16 scratch needed by the kernels for a 3x3 convolution with cin input
+   channels (two im2col columns) and for a dense layer with n inputs */
+#define NN_KERNELS_CONV_SCRATCH(cin)   (2U * 9U * (cin))
+#define NN_KERNELS_DENSE_SCRATCH(n)    (n)
+
+/* Exported types ------------------------------------------------------------*/
+/* Quantized layer with int8 activations: real = scale * (q - zero_point).
+   Weights are symmetric per output channel, laid out [out][kh][kw][in]
+   for a convolution and [out][in] for a dense layer. The bias already
+   holds -input_zero_point * sum(weights), so the kernels multiply the raw
+   int8 inputs. Output channel o is requantized with
+   round(acc * multiplier[o] * 2^(shift[o] - 31)) + output_zp and clamped
+   to [act_min, act_max], which also applies the ReLU. */
+typedef struct
+{
+  uint16_t in_ch;           /* input channels, or inputs of a dense layer  */
+  uint16_t out_ch;          /* output channels, or outputs                 */
+  const int8_t *weights;
+  const int32_t *bias;
+  const int32_t *multiplier;  /* Q31, in [2^30, 2^31)                      */
+  const int8_t *shift;
+  int8_t output_zp;
+  int8_t act_min;
+  int8_t act_max;
+} NnKernels_LayerTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void NnKernels_Conv3x3(const NnKernels_LayerTypeDef *layer, const int8_t *in, uint16_t height, uint16_t width,
+                       int8_t *out, int16_t *scratch);
+void NnKernels_Conv3x3Row(const NnKernels_LayerTypeDef *layer, const int8_t *const rows[3], uint16_t width,
+                          int8_t *out, int16_t *scratch);
+void NnKernels_MaxPool2x2(const int8_t *in, uint16_t height, uint16_t width, uint16_t channels, int8_t *out);
+void NnKernels_MaxPool2x2Row(const int8_t *row0, const int8_t *row1, uint16_t width, uint16_t channels, int8_t *out);
+void NnKernels_Dense(const NnKernels_LayerTypeDef *layer, const int8_t *in, int8_t *out, int16_t *scratch);
+int8_t NnKernels_Requantize(const NnKernels_LayerTypeDef *layer, uint32_t channel, int32_t acc);
+const char *NnKernels_Isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NN_KERNELS_H */
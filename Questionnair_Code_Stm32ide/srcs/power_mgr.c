@@ -0,0 +1,250 @@
+/**
+  ******************************************************************************
+  * @file           : power_mgr.c
+  * @brief          : Idle strategy between questionnaire samples.
+  *
+  *                   While the LED engine or a lux block is pending the core
+  *                   only executes WFI (Sleep): SysTick and the ADC DMA keep
+  *                   running and wake it. Otherwise the ADC stream is stopped
+  *                   and the MCU enters Stop2; LPTIM1, clocked by the LSE,
+  *                   wakes it every sample period, and the answer buttons
+  *                   wake it through their EXTI lines.
+  *
+  *                   Stop2 is entered with interrupts masked, so the wake-up
+  *                   ISR only runs once the PLLs are locked again and the HAL
+  *                   tick has been advanced by the time spent stopped:
+  *                   answer timestamps stay exact and capture latency grows
+  *                   only by the clock restore time.
+  *
+  *                   The LPTIM1 and TIM HAL modules are not enabled in
+  *                   stm32l4xx_hal_conf.h, so LPTIM1 is driven through its
+  *                   registers.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "power_mgr.h"
+#include "adc_stream.h"
+#include <stdio.h>
+
+/* Private define ------------------------------------------------------------*/
+#define POWER_LSE_HZ   32768U
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t power_start_tick;
+static uint32_t power_last_cyccnt;
+static uint64_t power_run_cycles;
+static uint32_t power_stop_ms;
+static uint32_t power_stop_frac;      /* LSE ticks not yet turned into ms */
+static uint32_t power_stop_entries;
+static volatile uint32_t power_lptim_wakeups;
+
+/* Private function prototypes -----------------------------------------------*/
+void SystemClock_Config(void);
+void PeriphCommonClock_Config(void);
+static uint32_t Power_LptimCount(void);
+static void Power_Account(void);
+static void Power_Resume(uint32_t cnt_entry);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Start LPTIM1 as the Stop2 sample tick and the DWT cycle counter
+  *         used for run-time accounting.
+  * @param  sample_period_ms: LPTIM1 period, 1 .. 2000 ms
+  * @retval None
+  */
+void Power_Init(uint32_t sample_period_ms)
+{
+  uint32_t arr = ((sample_period_ms * POWER_LSE_HZ) / 1000U) - 1U;
+
+  /* Wake up from Stop2 on MSI, which also feeds the PLL */
+  __HAL_RCC_WAKEUPSTOP_CLK_CONFIG(RCC_STOP_WAKEUPCLOCK_MSI);
+
+  /* LPTIM1 on LSE, auto-reload match interrupt, continuous mode */
+  __HAL_RCC_LPTIM1_CONFIG(RCC_LPTIM1CLKSOURCE_LSE);
+  __HAL_RCC_LPTIM1_CLK_ENABLE();
+  LPTIM1->CR = 0U;
+  LPTIM1->CFGR = 0U;
+  LPTIM1->IER = LPTIM_IER_ARRMIE;
+  LPTIM1->CR = LPTIM_CR_ENABLE;
+  LPTIM1->ARR = (arr > 0xFFFFU) ? 0xFFFFU : arr;
+  while ((LPTIM1->ISR & LPTIM_ISR_ARROK) == 0U)
+  {
+  }
+  LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+  LPTIM1->CR |= LPTIM_CR_CNTSTRT;
+
+  /* LPTIM1 reaches the NVIC in Stop2 through EXTI line 32 */
+  EXTI->IMR2 |= EXTI_IMR2_IM32;
+  HAL_NVIC_SetPriority(LPTIM1_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(LPTIM1_IRQn);
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0U;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  power_start_tick = HAL_GetTick();
+  power_last_cyccnt = 0U;
+  power_run_cycles = 0U;
+  power_stop_ms = 0U;
+  power_stop_frac = 0U;
+  power_stop_entries = 0U;
+  power_lptim_wakeups = 0U;
+}
+
+/**
+  * @brief  Wait for the next event in the requested low-power mode.
+  * @param  mode: POWER_IDLE_SLEEP or POWER_IDLE_STOP2
+  * @retval None
+  */
+void Power_Idle(Power_IdleTypeDef mode)
+{
+  uint32_t cnt_entry;
+
+  Power_Account();
+
+  if (mode == POWER_IDLE_SLEEP)
+  {
+    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+    return;
+  }
+
+  __disable_irq();
+  if ((LPTIM1->ISR & LPTIM_ISR_ARRM) != 0U)
+  {
+    /* Sample tick already pending, serve it first */
+    __enable_irq();
+    return;
+  }
+  if (AdcStream_Stop() != HAL_OK)
+  {
+    Error_Handler();
+  }
+  HAL_SuspendTick();
+  cnt_entry = Power_LptimCount();
+
+  HAL_PWREx_EnterSTOP2Mode(PWR_STOPENTRY_WFI);
+
+  Power_Resume(cnt_entry);
+  if (AdcStream_Start() != HAL_OK)
+  {
+    Error_Handler();
+  }
+  power_last_cyccnt = DWT->CYCCNT;
+  __enable_irq();
+}
+
+/**
+  * @brief  Residency and current estimate since Power_Init().
+  * @param  report: destination
+  * @retval None
+  */
+void Power_GetReport(Power_ReportTypeDef *report)
+{
+  uint32_t elapsed;
+  uint32_t busy;
+
+  Power_Account();
+
+  elapsed = HAL_GetTick() - power_start_tick;
+  report->run_ms = (uint32_t)(power_run_cycles / (SystemCoreClock / 1000U));
+  report->stop_ms = power_stop_ms;
+  busy = report->run_ms + report->stop_ms;
+  report->sleep_ms = (elapsed > busy) ? (elapsed - busy) : 0U;
+  report->stop_entries = power_stop_entries;
+  report->lptim_wakeups = power_lptim_wakeups;
+  report->always_on_ua = POWER_RUN_80MHZ_UA;
+
+  elapsed = report->run_ms + report->sleep_ms + report->stop_ms;
+  if (elapsed == 0U)
+  {
+    report->duty_permille = 1000U;
+    report->avg_current_ua = POWER_RUN_80MHZ_UA;
+    return;
+  }
+  report->duty_permille = (uint32_t)(((uint64_t)report->run_ms * 1000U) / elapsed);
+  report->avg_current_ua = (uint32_t)((((uint64_t)report->run_ms * POWER_RUN_80MHZ_UA)
+                                     + ((uint64_t)report->sleep_ms * POWER_SLEEP_80MHZ_UA)
+                                     + ((uint64_t)report->stop_ms * POWER_STOP2_LPTIM_UA))
+                                     / elapsed);
+}
+
+/**
+  * @brief  Print the residency report on the trace output.
+  * @retval None
+  */
+void Power_PrintReport(void)
+{
+  Power_ReportTypeDef r;
+
+  Power_GetReport(&r);
+  printf("power: run %lu ms, sleep %lu ms, stop2 %lu ms (%lu entries, %lu tick wakeups)\r\n",
+         (unsigned long)r.run_ms, (unsigned long)r.sleep_ms, (unsigned long)r.stop_ms,
+         (unsigned long)r.stop_entries, (unsigned long)r.lptim_wakeups);
+  printf("power: duty %lu.%lu %%, ~%lu uA vs %lu uA always-on\r\n",
+         (unsigned long)(r.duty_permille / 10U), (unsigned long)(r.duty_permille % 10U),
+         (unsigned long)r.avg_current_ua, (unsigned long)r.always_on_ua);
+}
+
+/* LPTIM1 runs on its own clock: read CNT until two reads agree */
+static uint32_t Power_LptimCount(void)
+{
+  uint32_t a;
+  uint32_t b;
+
+  do
+  {
+    a = LPTIM1->CNT;
+    b = LPTIM1->CNT;
+  } while (a != b);
+  return a;
+}
+
+/* The cycle counter only advances while the core is clocked */
+static void Power_Account(void)
+{
+  uint32_t now = DWT->CYCCNT;
+
+  power_run_cycles += (uint32_t)(now - power_last_cyccnt);
+  power_last_cyccnt = now;
+}
+
+/* Restore the 80 MHz clock tree, the PLLSAI1 ADC clock and the HAL time
+   base after Stop2, which stops every PLL */
+static void Power_Resume(uint32_t cnt_entry)
+{
+  uint32_t cnt_now = Power_LptimCount();
+  uint32_t ticks;
+  uint32_t ms;
+
+  ticks = cnt_now - cnt_entry;
+  if ((LPTIM1->ISR & LPTIM_ISR_ARRM) != 0U)
+  {
+    /* Woken by the sample tick, the counter wrapped once */
+    ticks = (LPTIM1->ARR + 1U) - cnt_entry + cnt_now;
+  }
+  ticks += power_stop_frac;
+  ms = (ticks * 1000U) / POWER_LSE_HZ;
+  power_stop_frac = ticks - ((ms * POWER_LSE_HZ) / 1000U);
+
+  uwTick += ms;
+  power_stop_ms += ms;
+  power_stop_entries++;
+
+  SystemClock_Config();
+  PeriphCommonClock_Config();
+  HAL_ResumeTick();
+}
+
+/**
+  * @brief This function handles LPTIM1 global interrupt.
+  */
+void LPTIM1_IRQHandler(void)
+{
+  if ((LPTIM1->ISR & LPTIM_ISR_ARRM) != 0U)
+  {
+    LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+    power_lptim_wakeups++;
+  }
+}
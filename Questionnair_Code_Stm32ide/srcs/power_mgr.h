@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file           : power_mgr.h
+  * @brief          : Header for power_mgr.c file.
+  *                   Sleep / Stop2 idle strategy for the questionnaire
+  *                   superloop and duty-cycle accounting.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __POWER_MGR_H
+#define __POWER_MGR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* LPTIM1 sample tick waking the core from Stop2 to refresh the lux value */
+#define POWER_SAMPLE_PERIOD_MS     100U
+
+/* Typical STM32L475 supply currents (datasheet, 25 degC, VDD 3 V), in uA.
+   Board-level consumers (sensors, ST-LINK, LEDs) are not included. */
+#define POWER_RUN_80MHZ_UA         9100U
+#define POWER_SLEEP_80MHZ_UA       2600U
+#define POWER_STOP2_LPTIM_UA       3U
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  POWER_IDLE_SLEEP = 0,     /* WFI, clocks kept: SysTick/DMA wake the core */
+  POWER_IDLE_STOP2          /* Stop2 until EXTI answer or LPTIM1 tick      */
+} Power_IdleTypeDef;
+
+typedef struct
+{
+  uint32_t run_ms;
+  uint32_t sleep_ms;
+  uint32_t stop_ms;
+  uint32_t stop_entries;
+  uint32_t lptim_wakeups;
+  uint32_t duty_permille;     /* run time / elapsed time                  */
+  uint32_t avg_current_ua;    /* estimate for the measured residency      */
+  uint32_t always_on_ua;      /* same period spent in the old busy loop   */
+} Power_ReportTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Power_Init(uint32_t sample_period_ms);
+void Power_Idle(Power_IdleTypeDef mode);
+void Power_GetReport(Power_ReportTypeDef *report);
+void Power_PrintReport(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __POWER_MGR_H */
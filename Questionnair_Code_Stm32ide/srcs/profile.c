@@ -0,0 +1,255 @@
+/**
+  ******************************************************************************
+  * @file           : profile.c
+  * @brief          : Cycle-count profiling of the firmware hot paths.
+  *
+  *                   A scope is timed with the DWT cycle counter:
+  *
+  *                     uint32_t t0 = Profile_Begin();
+  *                     ...
+  *                     Profile_End(PROFILE_SCORE, t0);
+  *
+  *                   and each scope of PROFILE_SCOPES keeps its count,
+  *                   min, max and total cycles and a histogram in factors
+  *                   of 4, so a rare slow pass shows next to the mean. The
+  *                   cost of a Begin/End pair on its own is measured at
+  *                   Profile_Init() and taken off every sample.
+  *
+  *                   The counts go out as text on the log (printf, USART1)
+  *                   and as one PROFILE telemetry record per scope
+  *                   (USART2). Building with PROFILE_DISABLE compiles the
+  *                   instrumentation out.
+  *
+  *                   Cycles are core cycles at 80 MHz: a scope that sleeps
+  *                   or is interrupted counts the time it was away too.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "profile.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define PROFILE_BUCKET_FIRST_LOG2   8U        /* of PROFILE_BUCKET_FIRST */
+#define PROFILE_CALIBRATE_RUNS      16U
+#define PROFILE_SCOPE_NAME(id, name)   name,
+
+_Static_assert(PROFILE_BUCKETS == TELEMETRY_PROFILE_BUCKETS, "PROFILE_BUCKETS");
+_Static_assert(PROFILE_BUCKET_FIRST == (1UL << PROFILE_BUCKET_FIRST_LOG2), "PROFILE_BUCKET_FIRST");
+
+/* Private variables ---------------------------------------------------------*/
+static const char *const profile_names[PROFILE_SCOPE_COUNT] =
+{
+  PROFILE_SCOPES(PROFILE_SCOPE_NAME)
+};
+
+static Profile_ScopeTypeDef profile_scopes[PROFILE_SCOPE_COUNT];
+static uint32_t profile_overhead;   /* cycles of an empty scope */
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t Profile_Bucket(uint32_t cycles);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Start the DWT cycle counter, measure the cost of an empty scope
+  *         and clear every scope.
+  * @note   The counter is left running if Power_Init() started it already,
+  *         and is never cleared here.
+  * @retval None
+  */
+void Profile_Init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  profile_overhead = 0xFFFFFFFFU;
+  for (uint32_t n = 0U; n < PROFILE_CALIBRATE_RUNS; n++)
+  {
+    uint32_t start = PROFILE_CYCLES();
+    uint32_t cycles = PROFILE_CYCLES() - start;
+
+    if (cycles < profile_overhead)
+    {
+      profile_overhead = cycles;
+    }
+  }
+  Profile_Reset();
+}
+
+/**
+  * @brief  Clear every scope, e.g. at the start of a session.
+  * @retval None
+  */
+void Profile_Reset(void)
+{
+  __disable_irq();
+  memset(profile_scopes, 0, sizeof(profile_scopes));
+  for (uint32_t n = 0U; n < PROFILE_SCOPE_COUNT; n++)
+  {
+    profile_scopes[n].min_cycles = 0xFFFFFFFFU;
+  }
+  __enable_irq();
+}
+
+#ifndef PROFILE_DISABLE
+/**
+  * @brief  End of a scope.
+  * @param  id: scope
+  * @param  start: Profile_Begin() at its start
+  * @retval None
+  */
+void Profile_End(Profile_IdTypeDef id, uint32_t start)
+{
+  uint32_t cycles = PROFILE_CYCLES() - start;
+
+  Profile_Record(id, (cycles > profile_overhead) ? (cycles - profile_overhead) : 0U);
+}
+#endif
+
+/**
+  * @brief  Add one sample to a scope.
+  * @param  id: scope
+  * @param  cycles: duration, instrumentation overhead already taken off
+  * @retval None
+  */
+void Profile_Record(Profile_IdTypeDef id, uint32_t cycles)
+{
+  Profile_ScopeTypeDef *scope;
+
+  if ((uint32_t)id >= (uint32_t)PROFILE_SCOPE_COUNT)
+  {
+    return;
+  }
+  scope = &profile_scopes[id];
+  scope->count++;
+  scope->total_cycles += cycles;
+  if (cycles < scope->min_cycles)
+  {
+    scope->min_cycles = cycles;
+  }
+  if (cycles > scope->max_cycles)
+  {
+    scope->max_cycles = cycles;
+  }
+  scope->histogram[Profile_Bucket(cycles)]++;
+}
+
+/**
+  * @brief  Snapshot of a scope, consistent even for interrupt scopes.
+  * @param  id: scope
+  * @param  scope: destination
+  * @retval None
+  */
+void Profile_Get(Profile_IdTypeDef id, Profile_ScopeTypeDef *scope)
+{
+  if ((uint32_t)id >= (uint32_t)PROFILE_SCOPE_COUNT)
+  {
+    memset(scope, 0, sizeof(*scope));
+    scope->min_cycles = 0xFFFFFFFFU;
+    return;
+  }
+  __disable_irq();
+  *scope = profile_scopes[id];
+  __enable_irq();
+}
+
+/**
+  * @brief  Mean cycles of a scope.
+  * @param  scope: snapshot from Profile_Get()
+  * @retval Cycles, 0 without samples
+  */
+uint32_t Profile_Mean(const Profile_ScopeTypeDef *scope)
+{
+  return (scope->count != 0U) ? (uint32_t)(scope->total_cycles / scope->count) : 0U;
+}
+
+/**
+  * @brief  Name of a scope in the reports.
+  * @param  id: scope
+  * @retval Name, "?" for an unknown id
+  */
+const char *Profile_Name(Profile_IdTypeDef id)
+{
+  return ((uint32_t)id < (uint32_t)PROFILE_SCOPE_COUNT) ? profile_names[id] : "?";
+}
+
+/**
+  * @brief  Cycles of an empty scope, taken off every sample.
+  * @retval Cycles measured by Profile_Init()
+  */
+uint32_t Profile_Overhead(void)
+{
+  return profile_overhead;
+}
+
+/**
+  * @brief  Print the scopes that ran on the trace output.
+  * @retval None
+  */
+void Profile_PrintReport(void)
+{
+  Profile_ScopeTypeDef s;
+
+  for (uint32_t n = 0U; n < PROFILE_SCOPE_COUNT; n++)
+  {
+    Profile_Get((Profile_IdTypeDef)n, &s);
+    if (s.count == 0U)
+    {
+      continue;
+    }
+    printf("profile: %s %lu runs, cycles min %lu mean %lu max %lu, hist",
+           profile_names[n], (unsigned long)s.count, (unsigned long)s.min_cycles,
+           (unsigned long)Profile_Mean(&s), (unsigned long)s.max_cycles);
+    for (uint32_t b = 0U; b < PROFILE_BUCKETS; b++)
+    {
+      printf(" %lu", (unsigned long)s.histogram[b]);
+    }
+    printf("\r\n");
+  }
+}
+
+/**
+  * @brief  One PROFILE telemetry record per scope that ran.
+  * @retval None
+  */
+void Profile_Export(void)
+{
+  Profile_ScopeTypeDef s;
+  Telemetry_ProfileTypeDef record;
+
+  for (uint32_t n = 0U; n < PROFILE_SCOPE_COUNT; n++)
+  {
+    Profile_Get((Profile_IdTypeDef)n, &s);
+    if (s.count == 0U)
+    {
+      continue;
+    }
+    memset(&record, 0, sizeof(record));
+    record.scope = (uint8_t)n;
+    record.count = s.count;
+    record.min_cycles = s.min_cycles;
+    record.max_cycles = s.max_cycles;
+    record.mean_cycles = Profile_Mean(&s);
+    for (uint32_t b = 0U; b < PROFILE_BUCKETS; b++)
+    {
+      record.histogram[b] = (s.histogram[b] > 0xFFFFU) ? 0xFFFFU : (uint16_t)s.histogram[b];
+    }
+    Telemetry_Profile(&record);
+  }
+}
+
+/* 0 below PROFILE_BUCKET_FIRST, then one per factor of 4 */
+static uint32_t Profile_Bucket(uint32_t cycles)
+{
+  uint32_t bucket;
+
+  if (cycles < PROFILE_BUCKET_FIRST)
+  {
+    return 0U;
+  }
+  bucket = 1U + (((31U - (uint32_t)__builtin_clz(cycles)) - PROFILE_BUCKET_FIRST_LOG2) >> 1);
+  return (bucket < PROFILE_BUCKETS) ? bucket : (PROFILE_BUCKETS - 1U);
+}
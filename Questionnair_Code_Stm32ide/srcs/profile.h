@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file           : profile.h
+  * @brief          : Header for profile.c file.
+  *                   Cycle counts of the firmware hot paths, taken with the
+  *                   DWT cycle counter around named scopes.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Scopes: id, name in the reports. Each is recorded from one context only,
+   the main loop or one interrupt. */
+#define PROFILE_SCOPES(X)                                                    \
+  X(PROFILE_LUX_FILTER, "lux_filter")       /* LuxFilter_Block            */ \
+  X(PROFILE_LUX,        "lux")              /* Questionnaire_OnLux        */ \
+  X(PROFILE_AUDIO,      "audio_features")   /* AudioFeatures_Push         */ \
+  X(PROFILE_SENSORS,    "sensor_hub")       /* SensorHub_Process          */ \
+  X(PROFILE_SCORE,      "score")            /* Questionnaire_Process      */ \
+  X(PROFILE_LED_TICK,   "led_tick")         /* LedPattern_Tick, SysTick   */ \
+  X(PROFILE_STEP,       "app_step")         /* App_Step up to the idle    */
+
+/* Histogram: bucket 0 below PROFILE_BUCKET_FIRST cycles, then one bucket
+   per factor of 4, the last one open-ended */
+#define PROFILE_BUCKETS         8U
+#define PROFILE_BUCKET_FIRST    256U
+
+/* Cycle source: the DWT on the target; the host simulation supplies its own */
+#ifndef PROFILE_CYCLES
+#define PROFILE_CYCLES()        (DWT->CYCCNT)
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+#define PROFILE_SCOPE_ENUM(id, name)   id,
+
+typedef enum
+{
+  PROFILE_SCOPES(PROFILE_SCOPE_ENUM)
+  PROFILE_SCOPE_COUNT
+} Profile_IdTypeDef;
+
+typedef struct
+{
+  uint32_t count;
+  uint32_t min_cycles;        /* 0xFFFFFFFF while count is 0               */
+  uint32_t max_cycles;
+  uint64_t total_cycles;
+  uint32_t histogram[PROFILE_BUCKETS];
+} Profile_ScopeTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Profile_Init(void);
+void Profile_Reset(void);
+void Profile_Record(Profile_IdTypeDef id, uint32_t cycles);
+void Profile_Get(Profile_IdTypeDef id, Profile_ScopeTypeDef *scope);
+uint32_t Profile_Mean(const Profile_ScopeTypeDef *scope);
+const char *Profile_Name(Profile_IdTypeDef id);
+uint32_t Profile_Overhead(void);
+void Profile_PrintReport(void);
+void Profile_Export(void);
+
+/* Exported functions --------------------------------------------------------*/
+#ifndef PROFILE_DISABLE
+/* Start of a scope: the cycle count to hand to Profile_End() */
+static inline uint32_t Profile_Begin(void)
+{
+  return PROFILE_CYCLES();
+}
+
+void Profile_End(Profile_IdTypeDef id, uint32_t start);
+#else
+/* Instrumentation compiled out, the report and export stay empty */
+static inline uint32_t Profile_Begin(void)
+{
+  return 0U;
+}
+
+static inline void Profile_End(Profile_IdTypeDef id, uint32_t start)
+{
+  (void)id;
+  (void)start;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PROFILE_H */
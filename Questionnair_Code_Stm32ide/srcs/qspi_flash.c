@@ -0,0 +1,273 @@
+/**
+  ******************************************************************************
+  * @file           : qspi_flash.c
+  * @brief          : MX25R6435F QSPI NOR flash driver.
+  *
+  *                   Reads go through the QUADSPI memory-mapped window at
+  *                   QSPI_BASE (quad I/O fast read, 0xEB), so callers walk
+  *                   the flash with plain pointers. Program and erase are
+  *                   indirect commands; the driver leaves memory-mapped
+  *                   mode for them and QspiFlash_Map() enters it again.
+  *                   Both wait for completion by auto-polling the WIP bit,
+  *                   so the CPU is free of status reads meanwhile.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "qspi_flash.h"
+
+/* Private define ------------------------------------------------------------*/
+#define MX25R_RESET_ENABLE       0x66U
+#define MX25R_RESET_MEMORY       0x99U
+#define MX25R_WRITE_ENABLE       0x06U
+#define MX25R_READ_STATUS        0x05U
+#define MX25R_WRITE_STATUS       0x01U
+#define MX25R_QUAD_PAGE_PROGRAM  0x38U     /* 1-4-4 */
+#define MX25R_SECTOR_ERASE       0x20U
+#define MX25R_QUAD_IO_READ       0xEBU     /* 1-4-4 */
+
+#define MX25R_SR_WIP             0x01U     /* write in progress */
+#define MX25R_SR_WEL             0x02U     /* write enable latch */
+#define MX25R_SR_QE              0x40U     /* quad enable */
+
+/* Quad I/O read: a mode byte that does not enter continuous read, then
+   4 dummy clocks */
+#define MX25R_QUAD_READ_ALT      0xAAU
+#define MX25R_QUAD_READ_DUMMY    4U
+
+/* Worst-case timings, datasheet tPP and tSE */
+#define MX25R_PROGRAM_TIMEOUT_MS 10U
+#define MX25R_ERASE_TIMEOUT_MS   240U
+
+/* Private variables ---------------------------------------------------------*/
+static QSPI_HandleTypeDef *qf_hqspi;
+static uint8_t qf_mapped;
+
+/* Private function prototypes -----------------------------------------------*/
+static void QspiFlash_Command(QSPI_CommandTypeDef *cmd, uint32_t instruction);
+static HAL_StatusTypeDef QspiFlash_Unmap(void);
+static HAL_StatusTypeDef QspiFlash_WriteEnable(void);
+static HAL_StatusTypeDef QspiFlash_WaitReady(uint32_t timeout_ms);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Reset the flash and enable its quad I/O lines.
+  * @note   Call after MX_QUADSPI_Init().
+  * @param  hqspi: handle initialised by MX_QUADSPI_Init
+  * @retval HAL status
+  */
+HAL_StatusTypeDef QspiFlash_Init(QSPI_HandleTypeDef *hqspi)
+{
+  QSPI_CommandTypeDef cmd;
+  uint8_t status;
+
+  qf_hqspi = hqspi;
+  qf_mapped = 0U;
+  if (HAL_QSPI_Abort(qf_hqspi) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  /* Software reset ends any program or erase cut short by a CPU reset */
+  QspiFlash_Command(&cmd, MX25R_RESET_ENABLE);
+  if (HAL_QSPI_Command(qf_hqspi, &cmd, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  QspiFlash_Command(&cmd, MX25R_RESET_MEMORY);
+  if ((HAL_QSPI_Command(qf_hqspi, &cmd, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+      || (QspiFlash_WaitReady(MX25R_ERASE_TIMEOUT_MS) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+
+  QspiFlash_Command(&cmd, MX25R_READ_STATUS);
+  cmd.DataMode = QSPI_DATA_1_LINE;
+  cmd.NbData = 1U;
+  if ((HAL_QSPI_Command(qf_hqspi, &cmd, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+      || (HAL_QSPI_Receive(qf_hqspi, &status, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  if ((status & MX25R_SR_QE) != 0U)
+  {
+    return HAL_OK;
+  }
+
+  /* QE is non-volatile: written once in the life of the board */
+  status |= MX25R_SR_QE;
+  QspiFlash_Command(&cmd, MX25R_WRITE_STATUS);
+  cmd.DataMode = QSPI_DATA_1_LINE;
+  cmd.NbData = 1U;
+  if ((QspiFlash_WriteEnable() != HAL_OK)
+      || (HAL_QSPI_Command(qf_hqspi, &cmd, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+      || (HAL_QSPI_Transmit(qf_hqspi, &status, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  return QspiFlash_WaitReady(MX25R_ERASE_TIMEOUT_MS);
+}
+
+/**
+  * @brief  Enter memory-mapped mode if needed.
+  * @retval Flash contents at QSPI_BASE, NULL on error
+  */
+const uint8_t *QspiFlash_Map(void)
+{
+  QSPI_CommandTypeDef cmd;
+  QSPI_MemoryMappedTypeDef mm;
+
+  if (qf_mapped == 0U)
+  {
+    QspiFlash_Command(&cmd, MX25R_QUAD_IO_READ);
+    cmd.AddressMode = QSPI_ADDRESS_4_LINES;
+    cmd.AlternateByteMode = QSPI_ALTERNATE_BYTES_4_LINES;
+    cmd.AlternateBytes = MX25R_QUAD_READ_ALT;
+    cmd.DummyCycles = MX25R_QUAD_READ_DUMMY;
+    cmd.DataMode = QSPI_DATA_4_LINES;
+    mm.TimeOutActivation = QSPI_TIMEOUT_COUNTER_DISABLE;
+    mm.TimeOutPeriod = 0U;
+    if (HAL_QSPI_MemoryMapped(qf_hqspi, &cmd, &mm) != HAL_OK)
+    {
+      return NULL;
+    }
+    qf_mapped = 1U;
+  }
+  return (const uint8_t *)QSPI_BASE;
+}
+
+/**
+  * @brief  Program bytes, split at page boundaries. Bits only go 1 -> 0:
+  *         the target range must be erased.
+  * @param  addr: flash address
+  * @param  data: bytes
+  * @param  len: number of bytes
+  * @retval HAL status
+  */
+HAL_StatusTypeDef QspiFlash_Program(uint32_t addr, const uint8_t *data, uint32_t len)
+{
+  QSPI_CommandTypeDef cmd;
+
+  if (((addr + len) > QSPI_FLASH_SIZE) || (QspiFlash_Unmap() != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  while (len != 0U)
+  {
+    uint32_t chunk = QSPI_FLASH_PAGE_SIZE - (addr & (QSPI_FLASH_PAGE_SIZE - 1U));
+
+    chunk = (chunk > len) ? len : chunk;
+    QspiFlash_Command(&cmd, MX25R_QUAD_PAGE_PROGRAM);
+    cmd.AddressMode = QSPI_ADDRESS_4_LINES;
+    cmd.Address = addr;
+    cmd.DataMode = QSPI_DATA_4_LINES;
+    cmd.NbData = chunk;
+    if ((QspiFlash_WriteEnable() != HAL_OK)
+        || (HAL_QSPI_Command(qf_hqspi, &cmd, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+        || (HAL_QSPI_Transmit(qf_hqspi, (uint8_t *)data, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+        || (QspiFlash_WaitReady(MX25R_PROGRAM_TIMEOUT_MS) != HAL_OK))
+    {
+      return HAL_ERROR;
+    }
+    addr += chunk;
+    data += chunk;
+    len -= chunk;
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Erase the 4 KB sector holding addr.
+  * @param  addr: any address in the sector
+  * @retval HAL status
+  */
+HAL_StatusTypeDef QspiFlash_EraseSector(uint32_t addr)
+{
+  QSPI_CommandTypeDef cmd;
+
+  if ((addr >= QSPI_FLASH_SIZE) || (QspiFlash_Unmap() != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  QspiFlash_Command(&cmd, MX25R_SECTOR_ERASE);
+  cmd.AddressMode = QSPI_ADDRESS_1_LINE;
+  cmd.Address = addr & ~(QSPI_FLASH_SECTOR_SIZE - 1U);
+  if ((QspiFlash_WriteEnable() != HAL_OK)
+      || (HAL_QSPI_Command(qf_hqspi, &cmd, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK))
+  {
+    return HAL_ERROR;
+  }
+  return QspiFlash_WaitReady(MX25R_ERASE_TIMEOUT_MS);
+}
+
+/* Single-line instruction with no address, alternate bytes or data */
+static void QspiFlash_Command(QSPI_CommandTypeDef *cmd, uint32_t instruction)
+{
+  cmd->Instruction = instruction;
+  cmd->InstructionMode = QSPI_INSTRUCTION_1_LINE;
+  cmd->Address = 0U;
+  cmd->AddressSize = QSPI_ADDRESS_24_BITS;
+  cmd->AddressMode = QSPI_ADDRESS_NONE;
+  cmd->AlternateBytes = 0U;
+  cmd->AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
+  cmd->AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+  cmd->DummyCycles = 0U;
+  cmd->DataMode = QSPI_DATA_NONE;
+  cmd->NbData = 0U;
+  cmd->DdrMode = QSPI_DDR_MODE_DISABLE;
+  cmd->DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+  cmd->SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+}
+
+/* Indirect commands are refused while memory-mapped */
+static HAL_StatusTypeDef QspiFlash_Unmap(void)
+{
+  if (qf_mapped != 0U)
+  {
+    if (HAL_QSPI_Abort(qf_hqspi) != HAL_OK)
+    {
+      return HAL_ERROR;
+    }
+    qf_mapped = 0U;
+  }
+  return HAL_OK;
+}
+
+static HAL_StatusTypeDef QspiFlash_WriteEnable(void)
+{
+  QSPI_CommandTypeDef cmd;
+  QSPI_AutoPollingTypeDef poll;
+
+  QspiFlash_Command(&cmd, MX25R_WRITE_ENABLE);
+  if (HAL_QSPI_Command(qf_hqspi, &cmd, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+
+  QspiFlash_Command(&cmd, MX25R_READ_STATUS);
+  cmd.DataMode = QSPI_DATA_1_LINE;
+  poll.Match = MX25R_SR_WEL;
+  poll.Mask = MX25R_SR_WEL;
+  poll.MatchMode = QSPI_MATCH_MODE_AND;
+  poll.StatusBytesSize = 1U;
+  poll.Interval = 0x10U;
+  poll.AutomaticStop = QSPI_AUTOMATIC_STOP_ENABLE;
+  return HAL_QSPI_AutoPolling(qf_hqspi, &cmd, &poll, HAL_QSPI_TIMEOUT_DEFAULT_VALUE);
+}
+
+static HAL_StatusTypeDef QspiFlash_WaitReady(uint32_t timeout_ms)
+{
+  QSPI_CommandTypeDef cmd;
+  QSPI_AutoPollingTypeDef poll;
+
+  QspiFlash_Command(&cmd, MX25R_READ_STATUS);
+  cmd.DataMode = QSPI_DATA_1_LINE;
+  poll.Match = 0U;
+  poll.Mask = MX25R_SR_WIP;
+  poll.MatchMode = QSPI_MATCH_MODE_AND;
+  poll.StatusBytesSize = 1U;
+  poll.Interval = 0x10U;
+  poll.AutomaticStop = QSPI_AUTOMATIC_STOP_ENABLE;
+  return HAL_QSPI_AutoPolling(qf_hqspi, &cmd, &poll, timeout_ms);
+}
@@ -0,0 +1,37 @@
+/**
+  ******************************************************************************
+  * @file           : qspi_flash.h
+  * @brief          : Header for qspi_flash.c file.
+  *                   MX25R6435F (8 MB QSPI NOR flash of the B-L475E-IOT01A)
+  *                   on the QUADSPI handle set up by MX_QUADSPI_Init.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __QSPI_FLASH_H
+#define __QSPI_FLASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define QSPI_FLASH_SIZE          0x800000U     /* 2^(FlashSize + 1) bytes */
+#define QSPI_FLASH_SECTOR_SIZE   4096U         /* smallest erasable unit  */
+#define QSPI_FLASH_PAGE_SIZE     256U          /* largest program unit    */
+#define QSPI_FLASH_ERASED        0xFFU
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef QspiFlash_Init(QSPI_HandleTypeDef *hqspi);
+const uint8_t *QspiFlash_Map(void);
+HAL_StatusTypeDef QspiFlash_Program(uint32_t addr, const uint8_t *data, uint32_t len);
+HAL_StatusTypeDef QspiFlash_EraseSector(uint32_t addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __QSPI_FLASH_H */
@@ -0,0 +1,376 @@
+/**
+  ******************************************************************************
+  * @file           : questionnaire.c
+  * @brief          : Event-driven questionnaire engine.
+  *
+  *                   Answer buttons on GPIOA PIN1..PIN5 raise EXTI
+  *                   interrupts on both edges. Each edge is stamped with the
+  *                   SysTick time base on entry and debounced against the
+  *                   last accepted edge of the same button; accepted presses
+  *                   are queued for Questionnaire_Process(), which scores
+  *                   them against the profile of the selected age group.
+  *                   Answer latency is therefore bounded by the interrupt,
+  *                   not by a polling period.
+  *
+  *                   The instruments are data: questionnaire_scales.h
+  *                   defines them and host/score_plan turns them into
+  *                   questionnaire_plan.h, with one band entry per
+  *                   reachable score, so a result is one table index.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "questionnaire.h"
+#include "questionnaire_plan.h"
+#include "log_ring.h"
+#include "telemetry.h"
+
+/* Private define ------------------------------------------------------------*/
+#define QUESTIONNAIRE_EVENT_MASK    (QUESTIONNAIRE_EVENT_LEN - 1U)
+
+_Static_assert(QUESTIONNAIRE_PROFILES == QUESTIONNAIRE_AGE_COUNT, "questionnaire_plan.h: one profile per age");
+_Static_assert(LED_PATTERN_COUNT <= QUESTIONNAIRE_NO_BAND, "QUESTIONNAIRE_NO_BAND");
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint8_t button;             /* 1-based */
+  uint32_t tick;
+} Questionnaire_EventTypeDef;
+
+typedef struct
+{
+  uint32_t last_tick;
+  uint8_t seen;
+  uint8_t pressed;
+} Questionnaire_ButtonTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const Questionnaire_ProfileTypeDef questionnaire_profiles[QUESTIONNAIRE_PROFILES] =
+  QUESTIONNAIRE_PLAN_PROFILES;
+static const Questionnaire_SectionTypeDef questionnaire_sections[QUESTIONNAIRE_SECTIONS] =
+  QUESTIONNAIRE_PLAN_SECTIONS;
+static const uint8_t questionnaire_bands[QUESTIONNAIRE_BAND_ENTRIES] = QUESTIONNAIRE_PLAN_BANDS;
+
+/* Filled by EXTI context, and by Questionnaire_OnLux() with interrupts
+   masked so that the two never interleave; drained by
+   Questionnaire_Process() */
+static Questionnaire_EventTypeDef q_events[QUESTIONNAIRE_EVENT_LEN];
+static volatile uint8_t q_head;
+static volatile uint8_t q_tail;
+static Questionnaire_ButtonTypeDef q_buttons[QUESTIONNAIRE_BUTTONS];
+
+static const Questionnaire_ProfileTypeDef *q_profile;
+static uint8_t q_index;
+static uint16_t q_score;
+static uint8_t q_lux_high;
+static Questionnaire_StatsTypeDef q_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Questionnaire_Post(uint8_t button, uint32_t tick);
+static uint8_t Questionnaire_Weight(uint8_t question, uint8_t button);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Start a new questionnaire for the given age group.
+  * @param  age: age group selecting the scoring profile
+  * @retval None
+  */
+void Questionnaire_Init(Questionnaire_AgeTypeDef age)
+{
+  if ((uint32_t)age >= (uint32_t)QUESTIONNAIRE_AGE_COUNT)
+  {
+    age = QUESTIONNAIRE_AGE_0;
+  }
+  q_profile = &questionnaire_profiles[age];
+  q_index = 0U;
+  q_score = 0U;
+  q_lux_high = 0U;
+  q_tail = q_head;
+  for (uint32_t n = 0U; n < QUESTIONNAIRE_BUTTONS; n++)
+  {
+    q_buttons[n].seen = 0U;
+    q_buttons[n].pressed = 0U;
+  }
+  q_stats.answers = 0U;
+  q_stats.bounces = 0U;
+  q_stats.dropped = 0U;
+  q_stats.max_latency_ms = 0U;
+}
+
+/**
+  * @brief  Route GPIOA PIN1..PIN5 to EXTI lines 1..5, both edges.
+  * @note   SYSCFG selects one port per EXTI line, so PA1, PA3 and PA5 take
+  *         lines 1, 3 and 5 away from ISM43362_DRDY (PE1),
+  *         USB_OTG_FS_OVRCR (PE3) and SPSGRF_915_GPIO3 (PE5) altogether:
+  *         those become plain inputs here, and an EXTI1/3/5 interrupt is
+  *         always a button. Call after MX_GPIO_Init(), which would take
+  *         the lines back. Line 5 is dispatched by the generated
+  *         EXTI9_5_IRQHandler.
+  * @retval None
+  */
+void Questionnaire_ConfigExti(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  GPIO_InitStruct.Pin = QUESTIONNAIRE_EXTI_TAKEN_PINS;
+  GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init(QUESTIONNAIRE_EXTI_TAKEN_PORT, &GPIO_InitStruct);
+
+  GPIO_InitStruct.Pin = QUESTIONNAIRE_PINS;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
+  GPIO_InitStruct.Pull = GPIO_PULLDOWN;
+  HAL_GPIO_Init(QUESTIONNAIRE_PORT, &GPIO_InitStruct);
+
+  HAL_NVIC_SetPriority(EXTI1_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI1_IRQn);
+  HAL_NVIC_SetPriority(EXTI2_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI2_IRQn);
+  HAL_NVIC_SetPriority(EXTI3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI3_IRQn);
+  HAL_NVIC_SetPriority(EXTI4_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI4_IRQn);
+  HAL_NVIC_SetPriority(EXTI9_5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
+}
+
+/**
+  * @brief  Debounce one answer button edge.
+  * @note   Called from HAL_GPIO_EXTI_Callback(), or by a host replay of
+  *         recorded edge traces.
+  * @param  pin: GPIO_PIN_1..GPIO_PIN_5
+  * @param  level: pin level sampled in the interrupt
+  * @param  tick: HAL_GetTick() at interrupt entry
+  * @retval None
+  */
+void Questionnaire_OnEdge(uint16_t pin, GPIO_PinState level, uint32_t tick)
+{
+  Questionnaire_ButtonTypeDef *btn;
+  uint8_t button = 0U;
+
+  while ((button < QUESTIONNAIRE_BUTTONS) && (pin != (uint16_t)(GPIO_PIN_1 << button)))
+  {
+    button++;
+  }
+  if (button == QUESTIONNAIRE_BUTTONS)
+  {
+    return;
+  }
+  btn = &q_buttons[button];
+
+  if ((btn->seen != 0U) && ((tick - btn->last_tick) < QUESTIONNAIRE_DEBOUNCE_MS))
+  {
+    q_stats.bounces++;
+    return;
+  }
+
+  if (level == GPIO_PIN_SET)
+  {
+    /* A release shorter than the debounce window is folded into the
+       press, so a rising edge after the window always counts. */
+    btn->pressed = 1U;
+    Questionnaire_Post(button + 1U, tick);
+    LogRing_Record(LOG_PRESS, button + 1U, 0U);
+  }
+  else if (btn->pressed != 0U)
+  {
+    btn->pressed = 0U;
+  }
+  else
+  {
+    return;
+  }
+  btn->seen = 1U;
+  btn->last_tick = tick;
+}
+
+/**
+  * @brief  Feed the lux photodiode. A crossing above the profile threshold
+  *         answers the current question with the profile's lux button.
+  * @note   Called from the main loop. Answers are also posted from EXTI
+  *         context, so the post runs with interrupts masked.
+  * @param  bright: the filtered value is above Questionnaire_LuxThreshold(),
+  *         with its hysteresis
+  * @param  lux: filtered ADC value, for the log
+  * @param  tick: time of the reading
+  * @retval None
+  */
+void Questionnaire_OnLux(uint8_t bright, uint16_t lux, uint32_t tick)
+{
+  if ((q_profile == NULL) || (q_profile->lux_threshold == 0U))
+  {
+    return;
+  }
+  if (bright != 0U)
+  {
+    if (q_lux_high == 0U)
+    {
+      q_lux_high = 1U;
+      __disable_irq();
+      Questionnaire_Post(q_profile->lux_button, tick);
+      __enable_irq();
+      LogRing_Record(LOG_LUX_PRESS, q_profile->lux_button, lux);
+    }
+  }
+  else
+  {
+    q_lux_high = 0U;
+  }
+}
+
+/**
+  * @brief  Lux threshold of the current profile.
+  * @retval 12-bit ADC value, 0 when the photodiode does not answer
+  */
+uint16_t Questionnaire_LuxThreshold(void)
+{
+  return (q_profile != NULL) ? q_profile->lux_threshold : 0U;
+}
+
+/**
+  * @brief  Score every answer captured since the last call.
+  * @retval QUESTIONNAIRE_DONE once all questions of the profile are answered
+  */
+Questionnaire_StateTypeDef Questionnaire_Process(void)
+{
+  while (q_tail != q_head)
+  {
+    const Questionnaire_EventTypeDef *evt = &q_events[q_tail & QUESTIONNAIRE_EVENT_MASK];
+    uint32_t latency;
+
+    if (q_index < q_profile->questions)
+    {
+      q_score += Questionnaire_Weight(q_index, evt->button);
+      q_index++;
+      LogRing_Record(LOG_ANSWER, q_index, q_score);
+      q_stats.answers++;
+      latency = HAL_GetTick() - evt->tick;
+      if (latency > q_stats.max_latency_ms)
+      {
+        q_stats.max_latency_ms = latency;
+      }
+      Telemetry_Answer(q_index, evt->button, q_score, latency);
+    }
+    q_tail++;
+  }
+
+  return (q_index >= q_profile->questions) ? QUESTIONNAIRE_DONE : QUESTIONNAIRE_RUNNING;
+}
+
+/**
+  * @brief  Map the final score onto the profile's result bands.
+  * @param  pattern: LED pattern reporting the band
+  * @retval HAL_OK, HAL_BUSY while running, HAL_ERROR if the band of the
+  *         score gives no result
+  */
+HAL_StatusTypeDef Questionnaire_GetResult(LedPattern_IdTypeDef *pattern)
+{
+  uint8_t band;
+
+  if (q_index < q_profile->questions)
+  {
+    return HAL_BUSY;
+  }
+  /* score_plan checked that every score in range has exactly one band */
+  if ((q_score < q_profile->score_min) || (q_score > q_profile->score_max))
+  {
+    return HAL_ERROR;
+  }
+  band = questionnaire_bands[q_profile->band_offset + (q_score - q_profile->score_min)];
+  if (band == QUESTIONNAIRE_NO_BAND)
+  {
+    return HAL_ERROR;
+  }
+  *pattern = (LedPattern_IdTypeDef)band;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Running score.
+  * @retval Sum of the weights of the answers scored so far
+  */
+uint16_t Questionnaire_Score(void)
+{
+  return q_score;
+}
+
+/**
+  * @brief  Number of questions answered so far.
+  * @retval Question index
+  */
+uint8_t Questionnaire_Index(void)
+{
+  return q_index;
+}
+
+/**
+  * @brief  Snapshot of the capture statistics.
+  * @param  stats: destination
+  * @retval None
+  */
+void Questionnaire_GetStats(Questionnaire_StatsTypeDef *stats)
+{
+  *stats = q_stats;
+}
+
+static void Questionnaire_Post(uint8_t button, uint32_t tick)
+{
+  uint8_t head = q_head;
+
+  if ((uint8_t)(head - q_tail) >= QUESTIONNAIRE_EVENT_LEN)
+  {
+    q_stats.dropped++;
+    return;
+  }
+  q_events[head & QUESTIONNAIRE_EVENT_MASK].button = button;
+  q_events[head & QUESTIONNAIRE_EVENT_MASK].tick = tick;
+  q_head = head + 1U;
+}
+
+static uint8_t Questionnaire_Weight(uint8_t question, uint8_t button)
+{
+  for (uint32_t n = 0U; n < q_profile->nb_sections; n++)
+  {
+    const Questionnaire_SectionTypeDef *sec = &questionnaire_sections[q_profile->first_section + n];
+
+    if ((question >= sec->first) && (question <= sec->last))
+    {
+      return sec->weight[button - 1U];
+    }
+  }
+  return 0U;
+}
+
+/**
+  * @brief This function handles EXTI line1 interrupt.
+  */
+void EXTI1_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_1);
+}
+
+/**
+  * @brief This function handles EXTI line2 interrupt.
+  */
+void EXTI2_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_2);
+}
+
+/**
+  * @brief This function handles EXTI line3 interrupt.
+  */
+void EXTI3_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_3);
+}
+
+/**
+  * @brief This function handles EXTI line4 interrupt.
+  */
+void EXTI4_IRQHandler(void)
+{
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_4);
+}
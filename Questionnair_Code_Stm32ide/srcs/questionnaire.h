@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+  * @file           : questionnaire.h
+  * @brief          : Header for questionnaire.c file.
+  *                   Event-driven questionnaire engine: EXTI answer capture
+  *                   on GPIOA PIN1..PIN5 and per-age scoring tables,
+  *                   generated from questionnaire_scales.h.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __QUESTIONNAIRE_H
+#define __QUESTIONNAIRE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "led_pattern.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define QUESTIONNAIRE_PORT          GPIOA
+#define QUESTIONNAIRE_PINS          (GPIO_PIN_1 | GPIO_PIN_2 | GPIO_PIN_3 | \
+                                     GPIO_PIN_4 | GPIO_PIN_5)
+#define QUESTIONNAIRE_BUTTONS       5U
+
+/* EXTI line n takes pin n of one port only: the buttons take EXTI1, EXTI3
+   and EXTI5 from these board signals, which MX_GPIO_Init() sets up as
+   interrupts but nothing here uses */
+#define QUESTIONNAIRE_EXTI_TAKEN_PORT  GPIOE
+#define QUESTIONNAIRE_EXTI_TAKEN_PINS  (ISM43362_DRDY_EXTI1_Pin | USB_OTG_FS_OVRCR_EXTI3_Pin | \
+                                        SPSGRF_915_GPIO3_EXTI5_Pin)
+
+/* Edges closer than this to the last accepted one are contact bounce */
+#define QUESTIONNAIRE_DEBOUNCE_MS   20U
+
+/* Captured answers waiting for Questionnaire_Process(), power of two */
+#define QUESTIONNAIRE_EVENT_LEN     8U
+
+/* Band of the scores that get no result */
+#define QUESTIONNAIRE_NO_BAND       0xFFU
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  QUESTIONNAIRE_AGE_0 = 0,
+  QUESTIONNAIRE_AGE_1,
+  QUESTIONNAIRE_AGE_2,
+  QUESTIONNAIRE_AGE_COUNT
+} Questionnaire_AgeTypeDef;
+
+typedef enum
+{
+  QUESTIONNAIRE_RUNNING = 0,
+  QUESTIONNAIRE_DONE
+} Questionnaire_StateTypeDef;
+
+/* Questions [first, last] are scored with one weight per answer button */
+typedef struct
+{
+  uint8_t first;
+  uint8_t last;
+  uint8_t weight[QUESTIONNAIRE_BUTTONS];
+} Questionnaire_SectionTypeDef;
+
+/* Final score in [lo, hi], both included, is reported with the given LED
+   pattern, or QUESTIONNAIRE_NO_BAND */
+typedef struct
+{
+  uint16_t lo;
+  uint16_t hi;
+  uint8_t pattern;
+} Questionnaire_BandTypeDef;
+
+/* An age group as questionnaire_plan.h lays it out */
+typedef struct
+{
+  uint8_t questions;
+  uint8_t first_section;      /* in QUESTIONNAIRE_PLAN_SECTIONS           */
+  uint8_t nb_sections;
+  uint8_t lux_button;         /* 1-based button a lux crossing stands for */
+  uint16_t lux_threshold;     /* 0: the photodiode does not answer        */
+  uint16_t score_min;         /* lowest and highest reachable scores      */
+  uint16_t score_max;
+  uint16_t band_offset;       /* of score_min in QUESTIONNAIRE_PLAN_BANDS */
+} Questionnaire_ProfileTypeDef;
+
+typedef struct
+{
+  uint32_t answers;
+  uint32_t bounces;           /* edges rejected by the debounce window    */
+  uint32_t dropped;           /* presses lost because the queue was full  */
+  uint32_t max_latency_ms;    /* worst press-to-scored delay              */
+} Questionnaire_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Questionnaire_Init(Questionnaire_AgeTypeDef age);
+void Questionnaire_ConfigExti(void);
+void Questionnaire_OnEdge(uint16_t pin, GPIO_PinState level, uint32_t tick);
+void Questionnaire_OnLux(uint8_t bright, uint16_t lux, uint32_t tick);
+uint16_t Questionnaire_LuxThreshold(void);
+Questionnaire_StateTypeDef Questionnaire_Process(void);
+HAL_StatusTypeDef Questionnaire_GetResult(LedPattern_IdTypeDef *pattern);
+uint16_t Questionnaire_Score(void);
+uint8_t Questionnaire_Index(void);
+void Questionnaire_GetStats(Questionnaire_StatsTypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __QUESTIONNAIRE_H */
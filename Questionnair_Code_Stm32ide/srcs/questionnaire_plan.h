@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file           : questionnaire_plan.h
+  * @brief          : Scoring tables of the questionnaire, generated by
+  *                   host/score_plan from questionnaire_scales.h.
+  *                   Run make scores in srcs/host after changing the
+  *                   instruments; do not edit.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __QUESTIONNAIRE_PLAN_H
+#define __QUESTIONNAIRE_PLAN_H
+
+/* Exported constants --------------------------------------------------------*/
+#define QUESTIONNAIRE_PROFILES      3U
+#define QUESTIONNAIRE_SECTIONS      4U
+#define QUESTIONNAIRE_BAND_ENTRIES  233U
+
+/* questions, first section, sections, lux button, lux threshold, lowest and
+   highest score, band entry of the lowest */
+#define QUESTIONNAIRE_PLAN_PROFILES \
+{ \
+  { 40U, 0U, 1U, 5U, 500U, 40U, 200U, 0U },            /* age 0    */ \
+  { 20U, 1U, 1U, 2U, 2000U, 0U, 20U, 161U },           /* age 1    */ \
+  { 50U, 2U, 2U, 0U, 0U, 0U, 50U, 182U },              /* age 2    */ \
+}
+
+/* questions first..last, weight of each button */
+#define QUESTIONNAIRE_PLAN_SECTIONS \
+{ \
+  { 0U, 39U, { 1U, 2U, 3U, 4U, 5U } },                 /* age 0    */ \
+  { 0U, 19U, { 0U, 1U, 0U, 0U, 0U } },                 /* age 1    */ \
+  { 0U, 23U, { 1U, 1U, 0U, 0U, 0U } },                 /* age 2    */ \
+  { 24U, 49U, { 0U, 0U, 1U, 1U, 0U } },                /* age 2    */ \
+}
+
+/* LED pattern of each score, QUESTIONNAIRE_NO_BAND (255) for no result */
+#define QUESTIONNAIRE_PLAN_BANDS \
+{ \
+  /* age 0: 40..70 no result, 71..107 slow, 108..153 medium, 154..200 fast */ \
+  255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, /* 40..55 */ \
+  255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U, 255U,   0U, /* 56..71 */ \
+    0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U, /* 72..87 */ \
+    0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U, /* 88..103 */ \
+    0U,   0U,   0U,   0U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U, /* 104..119 */ \
+    1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U, /* 120..135 */ \
+    1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U,   1U, /* 136..151 */ \
+    1U,   1U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U, /* 152..167 */ \
+    2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U, /* 168..183 */ \
+    2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U, /* 184..199 */ \
+    2U,                                                                                           /* 200..200 */ \
+  /* age 1: 0..1 slow, 2..7 medium, 8..20 fast */ \
+    0U,   0U,   1U,   1U,   1U,   1U,   1U,   1U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U, /* 0..15 */ \
+    2U,   2U,   2U,   2U,   2U,                                                                   /* 16..20 */ \
+  /* age 2: 0..32 slow, 33..50 fast */ \
+    0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U, /* 0..15 */ \
+    0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U,   0U, /* 16..31 */ \
+    0U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U,   2U, /* 32..47 */ \
+    2U,   2U,   2U,                                                                               /* 48..50 */ \
+}
+
+#endif /* __QUESTIONNAIRE_PLAN_H */
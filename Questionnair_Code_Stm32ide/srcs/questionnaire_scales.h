@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file           : questionnaire_scales.h
+  * @brief          : Screening instruments of the questionnaire, one per age
+  *                   group: questions, answer weights and result bands.
+  *
+  *                   Read by host/score_plan only, which checks that the
+  *                   bands of each instrument cover every score it can
+  *                   reach exactly once and writes questionnaire_plan.h,
+  *                   the tables questionnaire.c runs. Run make scores in
+  *                   srcs/host after changing this file.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __QUESTIONNAIRE_SCALES_H
+#define __QUESTIONNAIRE_SCALES_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "questionnaire.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define QUESTIONNAIRE_SCALE_ENTRIES(a)   (uint8_t)(sizeof(a) / sizeof((a)[0])), (a)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  const char *name;
+  uint8_t questions;
+  uint16_t lux_threshold;     /* 0: the photodiode does not answer        */
+  uint8_t lux_button;         /* 1-based button a lux crossing stands for */
+  uint8_t nb_sections;
+  const Questionnaire_SectionTypeDef *sections;
+  uint8_t nb_bands;           /* ascending                                */
+  const Questionnaire_BandTypeDef *bands;
+} Questionnaire_ScaleTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+/* Age 0: 40 questions, answer n scores n */
+static const Questionnaire_SectionTypeDef scale_age0_sections[] =
+{
+  { 0U, 39U, { 1U, 2U, 3U, 4U, 5U } }
+};
+
+static const Questionnaire_BandTypeDef scale_age0_bands[] =
+{
+  {  40U,  70U, QUESTIONNAIRE_NO_BAND },
+  {  71U, 107U, LED_PATTERN_SLOW },
+  { 108U, 153U, LED_PATTERN_MEDIUM },
+  { 154U, 200U, LED_PATTERN_FAST }
+};
+
+/* Age 1: 20 yes/no questions, button 2 is "yes" */
+static const Questionnaire_SectionTypeDef scale_age1_sections[] =
+{
+  { 0U, 19U, { 0U, 1U, 0U, 0U, 0U } }
+};
+
+static const Questionnaire_BandTypeDef scale_age1_bands[] =
+{
+  { 0U,  1U, LED_PATTERN_SLOW },
+  { 2U,  7U, LED_PATTERN_MEDIUM },
+  { 8U, 20U, LED_PATTERN_FAST }
+};
+
+/* Age 2: 50 questions in two sub-scales */
+static const Questionnaire_SectionTypeDef scale_age2_sections[] =
+{
+  {  0U, 23U, { 1U, 1U, 0U, 0U, 0U } },
+  { 24U, 49U, { 0U, 0U, 1U, 1U, 0U } }
+};
+
+static const Questionnaire_BandTypeDef scale_age2_bands[] =
+{
+  {  0U, 32U, LED_PATTERN_SLOW },
+  { 33U, 50U, LED_PATTERN_FAST }
+};
+
+/* In the order of Questionnaire_AgeTypeDef */
+static const Questionnaire_ScaleTypeDef questionnaire_scales[] =
+{
+  { "age 0", 40U,  500U, 5U, QUESTIONNAIRE_SCALE_ENTRIES(scale_age0_sections),
+    QUESTIONNAIRE_SCALE_ENTRIES(scale_age0_bands) },
+  { "age 1", 20U, 2000U, 2U, QUESTIONNAIRE_SCALE_ENTRIES(scale_age1_sections),
+    QUESTIONNAIRE_SCALE_ENTRIES(scale_age1_bands) },
+  { "age 2", 50U,    0U, 0U, QUESTIONNAIRE_SCALE_ENTRIES(scale_age2_sections),
+    QUESTIONNAIRE_SCALE_ENTRIES(scale_age2_bands) }
+};
+
+#endif /* __QUESTIONNAIRE_SCALES_H */
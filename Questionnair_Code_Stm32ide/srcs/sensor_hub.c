@@ -0,0 +1,782 @@
+/**
+  ******************************************************************************
+  * @file           : sensor_hub.c
+  * @brief          : Data-ready driven sensor hub on the internal I2C2 bus.
+  *
+  *                   The HTS221 (humidity, temperature), LIS3MDL
+  *                   (magnetometer) and VL53L0X (time of flight) each raise
+  *                   their data-ready line when a new sample is waiting.
+  *                   The EXTI interrupt only stamps the reading with the HAL
+  *                   tick and marks it pending; the I2C2 event interrupt
+  *                   then runs one transfer after the other: the register
+  *                   address is written, a repeated start turns the bus
+  *                   around and DMA1 Channel5 moves the whole output block
+  *                   into RAM. The STOP interrupt publishes the raw bytes
+  *                   and starts the next pending transfer, so the main loop
+  *                   never waits on the bus.
+  *
+  *                   SensorHub_Process(), from the main loop, converts the
+  *                   raw readings to physical units and fuses them into the
+  *                   context returned by SensorHub_GetContext().
+  *
+  *                   The sensors are configured by the same engine, from a
+  *                   table run once after SensorHub_Init(). A sensor that
+  *                   does not acknowledge its configuration, or fails three
+  *                   reads in a row, is left alone from then on.
+  *
+  *                   The I2C HAL module is not enabled in
+  *                   stm32l4xx_hal_conf.h, so I2C2 and its DMA channel are
+  *                   driven through their registers. The VL53L0X is used
+  *                   without the ST API tuning settings: ranges are
+  *                   uncalibrated, good enough to tell presence.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sensor_hub.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+/* 400 kHz fast mode from the 80 MHz PCLK1 */
+#define SENSOR_HUB_TIMING         0x00702991U
+
+/* DMA1 Channel5 request 3 is I2C2_RX on the STM32L475 */
+#define SENSOR_HUB_DMA_REQUEST    3U
+
+/* VL53L0X boot time after XSHUT is released (tBOOT 1.2 ms) */
+#define SENSOR_HUB_TOF_BOOT_MS    2U
+
+/* A transfer not over by then is aborted and the bus reset */
+#define SENSOR_HUB_TIMEOUT_MS     10U
+
+/* Consecutive failed reads before a sensor is given up */
+#define SENSOR_HUB_RETRIES        3U
+
+/* Sub-address bit enabling auto-increment on the ST MEMS sensors */
+#define SENSOR_HUB_AUTO_INC       0x80U
+
+/* Pending transfers, served in this order */
+#define SENSOR_HUB_PEND_TOF_CLEAR 0x01U
+#define SENSOR_HUB_PEND_HTS       0x02U
+#define SENSOR_HUB_PEND_MAG       0x04U
+#define SENSOR_HUB_PEND_TOF       0x08U
+
+#define SENSOR_HUB_RAW_MAX        12U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  SH_HTS221 = 0,
+  SH_LIS3MDL,
+  SH_VL53L0X,
+  SH_SENSORS
+} SensorHub_SensorTypeDef;
+
+typedef enum
+{
+  SH_STATE_INIT = 0,
+  SH_STATE_PRESENT,
+  SH_STATE_ABSENT
+} SensorHub_StateTypeDef;
+
+/* One configuration transfer */
+typedef struct
+{
+  uint8_t sensor;             /* SensorHub_SensorTypeDef                   */
+  uint8_t reg;
+  uint8_t len;
+  uint8_t read;               /* 1: read len bytes into dest               */
+  uint8_t data[5];            /* written bytes                              */
+  uint8_t *dest;
+} SensorHub_StepTypeDef;
+
+/* The transfer on the bus */
+typedef struct
+{
+  uint8_t sensor;
+  uint8_t pend;               /* SENSOR_HUB_PEND_x, 0 for a setup step      */
+  uint8_t addr;
+  uint8_t len;
+  uint8_t read;
+  uint8_t tx_pos;
+  uint8_t error;
+  uint8_t tx[6];
+  uint8_t *rx;
+  uint32_t tick;              /* HAL tick when it started                   */
+} SensorHub_JobTypeDef;
+
+/* Raw reading handed from the I2C interrupt to the main loop. seq is odd
+   while the interrupt writes it. */
+typedef struct
+{
+  volatile uint32_t seq;
+  uint32_t tick;              /* HAL tick of the data-ready edge           */
+  uint8_t raw[SENSOR_HUB_RAW_MAX];
+} SensorHub_SlotTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t sh_hts_cal[16];
+static uint8_t sh_tof_osc[2];
+
+/* HTS221: power on, block data update, 1 Hz, DRDY on its pin.
+   LIS3MDL: ultra-high performance X/Y/Z, 1.25 Hz, +/-4 gauss, continuous,
+   block data update.
+   VL53L0X: sample-ready on GPIO1, active high, timed ranging. */
+static SensorHub_StepTypeDef sh_steps[] =
+{
+  { SH_HTS221,  0x30U | SENSOR_HUB_AUTO_INC, 16U, 1U, { 0U }, sh_hts_cal },
+  { SH_HTS221,  0x20U | SENSOR_HUB_AUTO_INC, 3U, 0U, { 0x85U, 0x00U, 0x04U }, NULL },
+  { SH_LIS3MDL, 0x20U | SENSOR_HUB_AUTO_INC, 5U, 0U, { 0x64U, 0x00U, 0x00U, 0x0CU, 0x40U }, NULL },
+  { SH_VL53L0X, 0xF8U, 2U, 1U, { 0U }, sh_tof_osc },
+  { SH_VL53L0X, 0x04U, 4U, 0U, { 0U }, NULL },            /* period, filled in */
+  { SH_VL53L0X, 0x0AU, 1U, 0U, { 0x04U }, NULL },
+  { SH_VL53L0X, 0x84U, 1U, 0U, { 0x11U }, NULL },
+  { SH_VL53L0X, 0x0BU, 1U, 0U, { 0x01U }, NULL },
+  { SH_VL53L0X, 0x00U, 1U, 0U, { 0x04U }, NULL }
+};
+
+#define SENSOR_HUB_STEPS          (uint8_t)(sizeof(sh_steps) / sizeof(sh_steps[0]))
+#define SENSOR_HUB_STEP_OSC       3U
+#define SENSOR_HUB_STEP_PERIOD    4U
+
+static const uint8_t sh_addr[SH_SENSORS] =
+{
+  SENSOR_HUB_HTS221_ADDR, SENSOR_HUB_LIS3MDL_ADDR, SENSOR_HUB_VL53L0X_ADDR
+};
+
+/* Output block of every sensor */
+static const uint8_t sh_data_reg[SH_SENSORS] = { 0x28U | SENSOR_HUB_AUTO_INC, 0x28U | SENSOR_HUB_AUTO_INC, 0x14U };
+static const uint8_t sh_data_len[SH_SENSORS] = { 4U, 6U, 12U };
+static const uint8_t sh_pend_bit[SH_SENSORS] = { SENSOR_HUB_PEND_HTS, SENSOR_HUB_PEND_MAG, SENSOR_HUB_PEND_TOF };
+
+/* Nominal output period, a reading three periods old is stale */
+static const uint16_t sh_period_ms[SH_SENSORS] = { 1000U, 800U, SENSOR_HUB_RANGE_PERIOD_MS };
+
+/* Data-ready line of every sensor */
+static GPIO_TypeDef *const sh_drdy_port[SH_SENSORS] =
+{
+  HTS221_DRDY_EXTI15_GPIO_Port, LSM3MDL_DRDY_EXTI8_GPIO_Port, VL53L0X_GPIO1_EXTI7_GPIO_Port
+};
+static const uint16_t sh_drdy_pin[SH_SENSORS] =
+{
+  HTS221_DRDY_EXTI15_Pin, LSM3MDL_DRDY_EXTI8_Pin, VL53L0X_GPIO1_EXTI7_Pin
+};
+
+static SensorHub_JobTypeDef sh_job;
+static volatile uint8_t sh_busy;        /* a transfer is on the bus        */
+static volatile uint8_t sh_pending;     /* SENSOR_HUB_PEND_x               */
+static volatile uint8_t sh_step;        /* next configuration step         */
+static volatile uint8_t sh_state[SH_SENSORS];
+static uint8_t sh_failures[SH_SENSORS];
+static uint32_t sh_drdy_tick[SH_SENSORS];
+static uint32_t sh_boot_tick;
+static uint8_t sh_rx[SENSOR_HUB_RAW_MAX];
+static SensorHub_SlotTypeDef sh_slot[SH_SENSORS];
+static SensorHub_StatsTypeDef sh_stats;
+
+/* Main loop side */
+static uint32_t sh_seen[SH_SENSORS];    /* slot seq last converted         */
+static uint32_t sh_tick[SH_SENSORS];    /* data-ready tick of that reading */
+static SensorHub_ContextTypeDef sh_ctx;
+static uint8_t sh_mag_primed;           /* a field sample to compare with  */
+
+/* Private function prototypes -----------------------------------------------*/
+void I2C2_EV_IRQHandler(void);
+void I2C2_ER_IRQHandler(void);
+static void SensorHub_Kick(void);
+static void SensorHub_Start(void);
+static void SensorHub_Done(void);
+static void SensorHub_Rearm(void);
+static void SensorHub_BusReset(void);
+static uint8_t SensorHub_Fetch(SensorHub_SensorTypeDef sensor, uint8_t *raw);
+static void SensorHub_Hts221(const uint8_t *raw);
+static void SensorHub_Lis3mdl(const uint8_t *raw);
+static void SensorHub_Vl53l0x(const uint8_t *raw);
+static uint16_t SensorHub_Age(uint32_t now, SensorHub_SensorTypeDef sensor);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Take over I2C2 and the sensor data-ready lines, release the
+  *         VL53L0X from reset and start configuring the sensors.
+  * @note   Call after MX_GPIO_Init(), which leaves PB10/PB11 as plain
+  *         outputs. Configuration completes in the background, driven by
+  *         the I2C2 interrupt and SensorHub_Process().
+  * @retval HAL status
+  */
+HAL_StatusTypeDef SensorHub_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_I2C2_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* I2C2 SCL/SDA, open drain; the board has the bus pull-ups */
+  GPIO_InitStruct.Pin = SENSOR_HUB_I2C_PINS;
+  GPIO_InitStruct.Mode = GPIO_MODE_AF_OD;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  GPIO_InitStruct.Alternate = GPIO_AF4_I2C2;
+  HAL_GPIO_Init(SENSOR_HUB_I2C_PORT, &GPIO_InitStruct);
+
+  /* Data-ready lines, rising edge, as MX_GPIO_Init sets them */
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct.Alternate = 0U;
+  for (uint32_t n = 0U; n < SH_SENSORS; n++)
+  {
+    GPIO_InitStruct.Pin = sh_drdy_pin[n];
+    HAL_GPIO_Init(sh_drdy_port[n], &GPIO_InitStruct);
+  }
+
+  /* I2C2 master, interrupts for every event the engine waits on */
+  I2C2->CR1 = 0U;
+  I2C2->TIMINGR = SENSOR_HUB_TIMING;
+  I2C2->CR1 = I2C_CR1_TXIE | I2C_CR1_NACKIE | I2C_CR1_STOPIE | I2C_CR1_TCIE | I2C_CR1_ERRIE;
+  I2C2->CR1 |= I2C_CR1_PE;
+
+  /* DMA1 Channel5: I2C2_RXDR to memory, bytes; armed per transfer */
+  DMA1_Channel5->CCR = 0U;
+  DMA1_CSELR->CSELR = (DMA1_CSELR->CSELR & ~DMA_CSELR_C5S) | (SENSOR_HUB_DMA_REQUEST << DMA_CSELR_C5S_Pos);
+  DMA1_Channel5->CPAR = (uintptr_t)&I2C2->RXDR;
+
+  /* Same priority as the EXTI lines: the two never preempt each other */
+  HAL_NVIC_SetPriority(I2C2_EV_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(I2C2_EV_IRQn);
+  HAL_NVIC_SetPriority(I2C2_ER_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(I2C2_ER_IRQn);
+
+  memset(&sh_stats, 0, sizeof(sh_stats));
+  memset(&sh_ctx, 0, sizeof(sh_ctx));
+  memset(sh_seen, 0, sizeof(sh_seen));
+  memset(sh_tick, 0, sizeof(sh_tick));
+  sh_mag_primed = 0U;
+  for (uint32_t n = 0U; n < SH_SENSORS; n++)
+  {
+    sh_state[n] = SH_STATE_INIT;
+    sh_failures[n] = 0U;
+    sh_slot[n].seq = 0U;
+  }
+  sh_busy = 0U;
+  sh_pending = 0U;
+  sh_step = 0U;
+
+  /* The VL53L0X boots while the other two are configured */
+  HAL_GPIO_WritePin(VL53L0X_XSHUT_GPIO_Port, VL53L0X_XSHUT_Pin, GPIO_PIN_SET);
+  sh_boot_tick = HAL_GetTick();
+
+  __disable_irq();
+  SensorHub_Kick();
+  __enable_irq();
+  return HAL_OK;
+}
+
+/**
+  * @brief  Data-ready edge, called from HAL_GPIO_EXTI_Callback.
+  * @param  GPIO_Pin: pin whose EXTI line fired
+  * @retval None
+  */
+void SensorHub_OnDrdy(uint16_t GPIO_Pin)
+{
+  uint32_t now = HAL_GetTick();
+
+  for (uint32_t n = 0U; n < SH_SENSORS; n++)
+  {
+    if (((GPIO_Pin & sh_drdy_pin[n]) != 0U) && (sh_state[n] == SH_STATE_PRESENT))
+    {
+      sh_drdy_tick[n] = now;
+      sh_pending |= sh_pend_bit[n];
+    }
+  }
+  SensorHub_Kick();
+}
+
+/**
+  * @brief  Main loop work: convert new readings, keep the bus moving.
+  *         Never waits on the bus.
+  * @retval None
+  */
+void SensorHub_Process(void)
+{
+  uint8_t raw[SENSOR_HUB_RAW_MAX];
+
+  for (uint32_t n = 0U; n < SH_SENSORS; n++)
+  {
+    if (SensorHub_Fetch((SensorHub_SensorTypeDef)n, raw) == 0U)
+    {
+      continue;
+    }
+    if (n == SH_HTS221)
+    {
+      SensorHub_Hts221(raw);
+    }
+    else if (n == SH_LIS3MDL)
+    {
+      SensorHub_Lis3mdl(raw);
+    }
+    else
+    {
+      SensorHub_Vl53l0x(raw);
+    }
+  }
+
+  if (sh_busy != 0U)
+  {
+    if ((HAL_GetTick() - sh_job.tick) > SENSOR_HUB_TIMEOUT_MS)
+    {
+      /* No STOP came back: someone holds the bus */
+      __disable_irq();
+      if (sh_busy != 0U)
+      {
+        SensorHub_BusReset();
+        sh_job.error = 1U;
+        SensorHub_Done();
+      }
+      __enable_irq();
+    }
+  }
+  else if ((sh_pending != 0U) || (sh_step < SENSOR_HUB_STEPS))
+  {
+    /* Setup steps waiting for the VL53L0X to boot */
+    __disable_irq();
+    SensorHub_Kick();
+    __enable_irq();
+  }
+}
+
+/**
+  * @brief  Whether the hub needs the bus clocks: configuration is running,
+  *         or a transfer is in flight or pending. I2C2 stops in Stop2, so
+  *         the power manager only sleeps meanwhile.
+  * @retval 1 while busy, 0 otherwise
+  */
+uint8_t SensorHub_Busy(void)
+{
+  return ((sh_busy != 0U) || (sh_pending != 0U) || (sh_step < SENSOR_HUB_STEPS)) ? 1U : 0U;
+}
+
+/**
+  * @brief  Sensors configured and answering.
+  * @retval SENSOR_HUB_ENV | SENSOR_HUB_MAG | SENSOR_HUB_RANGE
+  */
+uint8_t SensorHub_Present(void)
+{
+  uint8_t present = 0U;
+
+  for (uint32_t n = 0U; n < SH_SENSORS; n++)
+  {
+    if (sh_state[n] == SH_STATE_PRESENT)
+    {
+      present |= (uint8_t)(1U << n);
+    }
+  }
+  return present;
+}
+
+/**
+  * @brief  Fused context as of the last SensorHub_Process().
+  * @param  ctx: destination
+  * @retval None
+  */
+void SensorHub_GetContext(SensorHub_ContextTypeDef *ctx)
+{
+  uint32_t now = HAL_GetTick();
+  uint8_t present = SensorHub_Present();
+
+  *ctx = sh_ctx;
+  ctx->tick = now;
+  ctx->env_age_ms = SensorHub_Age(now, SH_HTS221);
+  ctx->mag_age_ms = SensorHub_Age(now, SH_LIS3MDL);
+  ctx->range_age_ms = SensorHub_Age(now, SH_VL53L0X);
+  ctx->valid = 0U;
+  for (uint32_t n = 0U; n < SH_SENSORS; n++)
+  {
+    if (((present & (1U << n)) != 0U) && (sh_seen[n] != 0U)
+        && (SensorHub_Age(now, (SensorHub_SensorTypeDef)n) < (3U * sh_period_ms[n])))
+    {
+      ctx->valid |= (uint8_t)(1U << n);
+    }
+  }
+}
+
+/**
+  * @brief  Bus counters since SensorHub_Init().
+  * @param  stats: destination
+  * @retval None
+  */
+void SensorHub_GetStats(SensorHub_StatsTypeDef *stats)
+{
+  *stats = sh_stats;
+}
+
+/* Interrupts ----------------------------------------------------------------*/
+
+/**
+  * @brief  I2C2 event interrupt: feed the address byte and written data,
+  *         turn the bus around for reads, finish on STOP.
+  * @retval None
+  */
+void I2C2_EV_IRQHandler(void)
+{
+  uint32_t isr = I2C2->ISR;
+
+  /* One write for both: a NACK comes with its STOP, and a second write
+     would only clear what it names */
+  I2C2->ICR = isr & (I2C_ICR_NACKCF | I2C_ICR_STOPCF);
+  if ((isr & I2C_ISR_NACKF) != 0U)
+  {
+    /* The hardware sends the STOP itself */
+    sh_job.error = 1U;
+  }
+  if ((isr & I2C_ISR_TXIS) != 0U)
+  {
+    I2C2->TXDR = sh_job.tx[sh_job.tx_pos++];
+  }
+  if ((isr & I2C_ISR_TC) != 0U)
+  {
+    /* Register address sent: repeated start, the DMA takes the data */
+    I2C2->CR1 |= I2C_CR1_RXDMAEN;
+    I2C2->CR2 = ((uint32_t)sh_job.addr << 1) | I2C_CR2_RD_WRN | ((uint32_t)sh_job.len << I2C_CR2_NBYTES_Pos)
+                | I2C_CR2_AUTOEND | I2C_CR2_START;
+  }
+  if ((isr & I2C_ISR_STOPF) != 0U)
+  {
+    SensorHub_Done();
+  }
+}
+
+/**
+  * @brief  I2C2 error interrupt: bus error or lost arbitration.
+  * @retval None
+  */
+void I2C2_ER_IRQHandler(void)
+{
+  I2C2->ICR = I2C_ICR_BERRCF | I2C_ICR_ARLOCF | I2C_ICR_OVRCF;
+  if (sh_busy != 0U)
+  {
+    SensorHub_BusReset();
+    sh_job.error = 1U;
+    SensorHub_Done();
+  }
+}
+
+/* Start the next transfer if the bus is free; interrupt context or masked */
+static void SensorHub_Kick(void)
+{
+  uint8_t pend;
+
+  if (sh_busy != 0U)
+  {
+    return;
+  }
+
+  /* Configuration first */
+  while (sh_step < SENSOR_HUB_STEPS)
+  {
+    const SensorHub_StepTypeDef *step = &sh_steps[sh_step];
+
+    if (sh_state[step->sensor] == SH_STATE_ABSENT)
+    {
+      sh_step++;
+      continue;
+    }
+    if ((step->sensor == SH_VL53L0X) && ((HAL_GetTick() - sh_boot_tick) < SENSOR_HUB_TOF_BOOT_MS))
+    {
+      /* Still booting; SensorHub_Process() tries again */
+      return;
+    }
+    sh_job.sensor = step->sensor;
+    sh_job.pend = 0U;
+    sh_job.len = step->len;
+    sh_job.read = step->read;
+    sh_job.rx = step->dest;
+    if (step->read == 0U)
+    {
+      memcpy(&sh_job.tx[1], step->data, step->len);
+    }
+    SensorHub_Start();
+    return;
+  }
+
+  pend = sh_pending;
+  if (pend == 0U)
+  {
+    return;
+  }
+  if ((pend & SENSOR_HUB_PEND_TOF_CLEAR) != 0U)
+  {
+    /* Drop GPIO1 so the next sample raises a new edge */
+    sh_job.sensor = SH_VL53L0X;
+    sh_job.pend = SENSOR_HUB_PEND_TOF_CLEAR;
+    sh_job.len = 1U;
+    sh_job.read = 0U;
+    sh_job.tx[1] = 0x01U;
+    SensorHub_Start();
+    return;
+  }
+  for (uint32_t n = 0U; n < SH_SENSORS; n++)
+  {
+    if ((pend & sh_pend_bit[n]) != 0U)
+    {
+      sh_job.sensor = (uint8_t)n;
+      sh_job.pend = sh_pend_bit[n];
+      sh_job.len = sh_data_len[n];
+      sh_job.read = 1U;
+      sh_job.rx = sh_rx;
+      SensorHub_Start();
+      return;
+    }
+  }
+}
+
+/* Put sh_job on the bus */
+static void SensorHub_Start(void)
+{
+  uint8_t reg;
+
+  if (sh_job.pend == 0U)
+  {
+    reg = sh_steps[sh_step].reg;
+  }
+  else if (sh_job.pend == SENSOR_HUB_PEND_TOF_CLEAR)
+  {
+    reg = 0x0BU;
+  }
+  else
+  {
+    reg = sh_data_reg[sh_job.sensor];
+  }
+  sh_job.addr = sh_addr[sh_job.sensor];
+  sh_job.tx[0] = reg;
+  sh_job.tx_pos = 0U;
+  sh_job.error = 0U;
+  sh_job.tick = HAL_GetTick();
+  sh_busy = 1U;
+
+  if (sh_job.read != 0U)
+  {
+    DMA1_Channel5->CCR = 0U;
+    DMA1_Channel5->CMAR = (uintptr_t)sh_job.rx;
+    DMA1_Channel5->CNDTR = sh_job.len;
+    DMA1_Channel5->CCR = DMA_CCR_MINC | DMA_CCR_EN;
+    I2C2->CR2 = ((uint32_t)sh_job.addr << 1) | (1U << I2C_CR2_NBYTES_Pos) | I2C_CR2_START;
+  }
+  else
+  {
+    I2C2->CR2 = ((uint32_t)sh_job.addr << 1) | ((1U + sh_job.len) << I2C_CR2_NBYTES_Pos)
+                | I2C_CR2_AUTOEND | I2C_CR2_START;
+  }
+}
+
+/* The transfer is over: account for it, publish, go on with the next */
+static void SensorHub_Done(void)
+{
+  uint8_t sensor = sh_job.sensor;
+
+  DMA1_Channel5->CCR = 0U;
+  I2C2->CR1 &= ~I2C_CR1_RXDMAEN;
+  if ((sh_job.error == 0U) && (sh_job.read != 0U) && (DMA1_Channel5->CNDTR != 0U))
+  {
+    sh_job.error = 1U;
+  }
+  sh_stats.transfers++;
+
+  if (sh_job.pend == 0U)
+  {
+    /* Configuration step */
+    if (sh_job.error != 0U)
+    {
+      sh_stats.errors++;
+      sh_state[sensor] = SH_STATE_ABSENT;
+    }
+    else
+    {
+      if (sh_step == SENSOR_HUB_STEP_OSC)
+      {
+        /* Inter-measurement period counts oscillator periods per ms */
+        uint32_t period = SENSOR_HUB_RANGE_PERIOD_MS * (((uint32_t)sh_tof_osc[0] << 8) | sh_tof_osc[1]);
+
+        sh_steps[SENSOR_HUB_STEP_PERIOD].data[0] = (uint8_t)(period >> 24);
+        sh_steps[SENSOR_HUB_STEP_PERIOD].data[1] = (uint8_t)(period >> 16);
+        sh_steps[SENSOR_HUB_STEP_PERIOD].data[2] = (uint8_t)(period >> 8);
+        sh_steps[SENSOR_HUB_STEP_PERIOD].data[3] = (uint8_t)period;
+      }
+      if (((sh_step + 1U) == SENSOR_HUB_STEPS) || (sh_steps[sh_step + 1U].sensor != sensor))
+      {
+        sh_state[sensor] = SH_STATE_PRESENT;
+      }
+    }
+    sh_step++;
+  }
+  else if (sh_job.error != 0U)
+  {
+    sh_stats.errors++;
+    if (sh_job.pend != SENSOR_HUB_PEND_TOF_CLEAR)
+    {
+      /* Retried by SensorHub_Rearm() while the line stays high */
+      sh_pending &= (uint8_t)~sh_job.pend;
+    }
+    if (++sh_failures[sensor] >= SENSOR_HUB_RETRIES)
+    {
+      sh_state[sensor] = SH_STATE_ABSENT;
+      sh_pending &= (uint8_t)~(sh_pend_bit[sensor] | ((sensor == SH_VL53L0X) ? SENSOR_HUB_PEND_TOF_CLEAR : 0U));
+    }
+  }
+  else
+  {
+    sh_pending &= (uint8_t)~sh_job.pend;
+    sh_failures[sensor] = 0U;
+    if (sh_job.pend != SENSOR_HUB_PEND_TOF_CLEAR)
+    {
+      SensorHub_SlotTypeDef *slot = &sh_slot[sensor];
+      uint32_t seq = slot->seq;
+
+      __atomic_store_n(&slot->seq, seq + 1U, __ATOMIC_RELEASE);
+      slot->tick = sh_drdy_tick[sensor];
+      memcpy(slot->raw, sh_rx, sh_data_len[sensor]);
+      __atomic_store_n(&slot->seq, seq + 2U, __ATOMIC_RELEASE);
+      sh_stats.readings[sensor]++;
+      if (sensor == SH_VL53L0X)
+      {
+        sh_pending |= SENSOR_HUB_PEND_TOF_CLEAR;
+      }
+    }
+  }
+
+  sh_busy = 0U;
+  SensorHub_Rearm();
+  SensorHub_Kick();
+}
+
+/* A line still high has no edge left to raise: a sample came in before
+   the last one was read, or before the sensor was configured */
+static void SensorHub_Rearm(void)
+{
+  uint32_t now = HAL_GetTick();
+
+  for (uint32_t n = 0U; n < SH_SENSORS; n++)
+  {
+    if ((sh_state[n] == SH_STATE_PRESENT) && ((sh_pending & sh_pend_bit[n]) == 0U)
+        && !((n == SH_VL53L0X) && ((sh_pending & SENSOR_HUB_PEND_TOF_CLEAR) != 0U))
+        && (HAL_GPIO_ReadPin(sh_drdy_port[n], sh_drdy_pin[n]) == GPIO_PIN_SET))
+    {
+      sh_drdy_tick[n] = now;
+      sh_pending |= sh_pend_bit[n];
+      sh_stats.rearmed++;
+    }
+  }
+}
+
+/* Abort whatever is on the bus; PE low resets the I2C2 state machine */
+static void SensorHub_BusReset(void)
+{
+  I2C2->CR1 &= ~I2C_CR1_PE;
+  while ((I2C2->CR1 & I2C_CR1_PE) != 0U)
+  {
+  }
+  I2C2->CR1 |= I2C_CR1_PE;
+}
+
+/* Copy a reading the interrupt published since the last call */
+static uint8_t SensorHub_Fetch(SensorHub_SensorTypeDef sensor, uint8_t *raw)
+{
+  SensorHub_SlotTypeDef *slot = &sh_slot[sensor];
+  uint32_t seq;
+  uint32_t tick;
+
+  do
+  {
+    seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if ((seq == sh_seen[sensor]) || ((seq & 1U) != 0U))
+    {
+      return 0U;
+    }
+    tick = slot->tick;
+    memcpy(raw, slot->raw, sh_data_len[sensor]);
+  } while (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq);
+
+  sh_seen[sensor] = seq;
+  sh_tick[sensor] = tick;
+  return 1U;
+}
+
+/* Humidity and temperature, interpolated between the factory points */
+static void SensorHub_Hts221(const uint8_t *raw)
+{
+  const uint8_t *c = sh_hts_cal;
+  int32_t h_out = (int16_t)((uint16_t)raw[0] | ((uint16_t)raw[1] << 8));
+  int32_t t_out = (int16_t)((uint16_t)raw[2] | ((uint16_t)raw[3] << 8));
+  int32_t h0_x2 = c[0];
+  int32_t h1_x2 = c[1];
+  int32_t t0_x8 = (int32_t)c[2] | ((int32_t)(c[5] & 0x03U) << 8);
+  int32_t t1_x8 = (int32_t)c[3] | ((int32_t)(c[5] & 0x0CU) << 6);
+  int32_t h0_out = (int16_t)((uint16_t)c[6] | ((uint16_t)c[7] << 8));
+  int32_t h1_out = (int16_t)((uint16_t)c[10] | ((uint16_t)c[11] << 8));
+  int32_t t0_out = (int16_t)((uint16_t)c[12] | ((uint16_t)c[13] << 8));
+  int32_t t1_out = (int16_t)((uint16_t)c[14] | ((uint16_t)c[15] << 8));
+  int64_t v;
+
+  if ((h1_out != h0_out) && (t1_out != t0_out))
+  {
+    /* x2 rH in 0.1 % is x5, x8 degC in 0.01 degC is x12.5 */
+    v = ((int64_t)h0_x2 * 5) + (((int64_t)(h_out - h0_out) * (h1_x2 - h0_x2) * 5) / (h1_out - h0_out));
+    sh_ctx.humidity_permille = (uint16_t)((v < 0) ? 0 : ((v > 1000) ? 1000 : v));
+    v = (((int64_t)t0_x8 * 25) + (((int64_t)(t_out - t0_out) * (t1_x8 - t0_x8) * 25) / (t1_out - t0_out))) / 2;
+    sh_ctx.temperature_cdeg = (int16_t)((v < -32768) ? -32768 : ((v > 32767) ? 32767 : v));
+  }
+}
+
+/* Field in mgauss at +/-4 gauss (6842 LSB/gauss); a step larger than
+   SENSOR_HUB_HANDLED_MGAUSS between samples means the board moved */
+static void SensorHub_Lis3mdl(const uint8_t *raw)
+{
+  uint8_t handled = 0U;
+
+  for (uint32_t axis = 0U; axis < 3U; axis++)
+  {
+    int32_t v = (int16_t)((uint16_t)raw[2U * axis] | ((uint16_t)raw[(2U * axis) + 1U] << 8));
+    int16_t mg = (int16_t)((v * 1000) / 6842);
+    int32_t step = (int32_t)mg - sh_ctx.mag_mgauss[axis];
+
+    if ((step > SENSOR_HUB_HANDLED_MGAUSS) || (step < -SENSOR_HUB_HANDLED_MGAUSS))
+    {
+      handled = 1U;
+    }
+    sh_ctx.mag_mgauss[axis] = mg;
+  }
+  /* The first sample has nothing to compare with */
+  sh_ctx.handled = (sh_mag_primed != 0U) ? handled : 0U;
+  sh_mag_primed = 1U;
+}
+
+/* Range with presence hysteresis; no target or a failed measurement
+   counts as nobody there */
+static void SensorHub_Vl53l0x(const uint8_t *raw)
+{
+  uint8_t status = (uint8_t)((raw[0] >> 3) & 0x0FU);
+  uint16_t range = (uint16_t)(((uint16_t)raw[10] << 8) | raw[11]);
+
+  sh_ctx.range_mm = range;
+  sh_ctx.range_status = status;
+  if ((status == 11U) && (range < SENSOR_HUB_PRESENT_MM))
+  {
+    sh_ctx.presence = 1U;
+  }
+  else if ((status != 11U) || (range > SENSOR_HUB_ABSENT_MM))
+  {
+    sh_ctx.presence = 0U;
+  }
+}
+
+/* Age of the last converted reading, saturated */
+static uint16_t SensorHub_Age(uint32_t now, SensorHub_SensorTypeDef sensor)
+{
+  uint32_t age = now - sh_tick[sensor];
+
+  if (sh_seen[sensor] == 0U)
+  {
+    return 0xFFFFU;
+  }
+  return (age > 0xFFFFU) ? 0xFFFFU : (uint16_t)age;
+}
@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file           : sensor_hub.h
+  * @brief          : Header for sensor_hub.c file.
+  *                   Data-ready driven sampling of the on-board HTS221,
+  *                   LIS3MDL and VL53L0X, fused into one context snapshot.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SENSOR_HUB_H
+#define __SENSOR_HUB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Internal sensor bus of the B-L475E-IOT01A: I2C2 on PB10 (SCL) / PB11 (SDA) */
+#define SENSOR_HUB_I2C_PORT        GPIOB
+#define SENSOR_HUB_I2C_PINS        (GPIO_PIN_10 | GPIO_PIN_11)
+
+/* 7-bit bus addresses */
+#define SENSOR_HUB_HTS221_ADDR     0x5FU
+#define SENSOR_HUB_LIS3MDL_ADDR    0x1EU
+#define SENSOR_HUB_VL53L0X_ADDR    0x29U
+
+/* Data-ready lines, as wired by MX_GPIO_Init */
+#define SENSOR_HUB_DRDY_PINS       (HTS221_DRDY_EXTI15_Pin | VL53L0X_GPIO1_EXTI7_Pin | LSM3MDL_DRDY_EXTI8_Pin)
+
+/* VL53L0X ranging period in timed mode */
+#define SENSOR_HUB_RANGE_PERIOD_MS 500U
+
+/* Presence hysteresis on the VL53L0X range */
+#define SENSOR_HUB_PRESENT_MM      600U
+#define SENSOR_HUB_ABSENT_MM       800U
+
+/* Field change between two LIS3MDL samples taken as the board being handled */
+#define SENSOR_HUB_HANDLED_MGAUSS  50
+
+/* Context.valid / SensorHub_Present() bits */
+#define SENSOR_HUB_ENV             0x01U     /* HTS221  */
+#define SENSOR_HUB_MAG             0x02U     /* LIS3MDL */
+#define SENSOR_HUB_RANGE           0x04U     /* VL53L0X */
+
+/* Exported types ------------------------------------------------------------*/
+/* Latest reading of every sensor, with its age when the snapshot was taken.
+   A sensor's bit in valid is clear when it is absent or its last reading is
+   older than three of its periods. */
+typedef struct
+{
+  uint32_t tick;                 /* HAL tick of the snapshot                */
+  int16_t temperature_cdeg;      /* 0.01 degC                               */
+  uint16_t humidity_permille;    /* 0.1 %rH                                 */
+  int16_t mag_mgauss[3];         /* X, Y, Z                                 */
+  uint16_t range_mm;
+  uint8_t range_status;          /* VL53L0X device range status, 11 = valid */
+  uint8_t presence;              /* someone in front of the board          */
+  uint8_t handled;               /* field moved on the last LIS3MDL sample  */
+  uint8_t valid;                 /* SENSOR_HUB_ENV | MAG | RANGE            */
+  uint16_t env_age_ms;           /* saturated at 0xFFFF                     */
+  uint16_t mag_age_ms;
+  uint16_t range_age_ms;
+} SensorHub_ContextTypeDef;
+
+typedef struct
+{
+  uint32_t transfers;
+  uint32_t errors;               /* NACKed or bus error transfers           */
+  uint32_t readings[3];          /* HTS221, LIS3MDL, VL53L0X                */
+  uint32_t rearmed;              /* DRDY still high after a read            */
+} SensorHub_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef SensorHub_Init(void);
+void SensorHub_OnDrdy(uint16_t GPIO_Pin);
+void SensorHub_Process(void);
+uint8_t SensorHub_Busy(void);
+uint8_t SensorHub_Present(void);
+void SensorHub_GetContext(SensorHub_ContextTypeDef *ctx);
+void SensorHub_GetStats(SensorHub_StatsTypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SENSOR_HUB_H */
@@ -0,0 +1,268 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry.c
+  * @brief          : Framed binary session telemetry on USART2.
+  *
+  *                   Each session is streamed as a BEGIN record, one SAMPLE
+  *                   per lux block, one ANSWER per scored press, followed
+  *                   by a CONTEXT record when the sensor hub has readings,
+  *                   and an END record with the session summary, then
+  *                   one PROFILE record per profiled scope. Records are framed
+  *                   as they are produced (CRC-16 + COBS, see frame.c) into
+  *                   a byte ring, which DMA1 Channel7 drains to USART2
+  *                   (PD5/PD6, PMOD connector) the same way log_ring.c
+  *                   drains the log to USART1. A record that does not fit
+  *                   the ring is dropped and counted, never waited for.
+  *
+  *                   Records are produced by the main loop only; the
+  *                   transfer-complete interrupt only releases bytes.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "telemetry.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define TELEMETRY_RING_MASK   (TELEMETRY_RING_LEN - 1U)
+
+/* Private variables ---------------------------------------------------------*/
+DMA_HandleTypeDef hdma_usart2_tx;
+
+static UART_HandleTypeDef *tm_huart;
+static uint8_t tm_ring[TELEMETRY_RING_LEN];
+static volatile uint32_t tm_head;       /* next byte to write              */
+static volatile uint32_t tm_tail;       /* oldest byte not yet sent        */
+static uint32_t tm_inflight;            /* bytes owned by the DMA          */
+static volatile uint8_t tm_busy;        /* a transfer is in flight         */
+static uint16_t tm_seq;
+static uint16_t tm_session;
+static uint32_t tm_begin_tick;
+static uint32_t tm_dropped;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Telemetry_Put(Telemetry_TypeTypeDef type, const void *payload, uint32_t len);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Attach the telemetry stream to USART2 and configure its TX DMA.
+  * @note   Call after MX_USART2_UART_Init(). Session and record numbers
+  *         keep counting across calls.
+  * @param  huart: handle initialised by MX_USART2_UART_Init
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Telemetry_Init(UART_HandleTypeDef *huart)
+{
+  /* DMA1 Channel7 request 2 is USART2_TX on the STM32L475 */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  hdma_usart2_tx.Instance = DMA1_Channel7;
+  hdma_usart2_tx.Init.Request = DMA_REQUEST_2;
+  hdma_usart2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_usart2_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_usart2_tx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_usart2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_usart2_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_usart2_tx.Init.Mode = DMA_NORMAL;
+  hdma_usart2_tx.Init.Priority = DMA_PRIORITY_LOW;
+  if (HAL_DMA_Init(&hdma_usart2_tx) != HAL_OK)
+  {
+    return HAL_ERROR;
+  }
+  __HAL_LINKDMA(huart, hdmatx, hdma_usart2_tx);
+
+  HAL_NVIC_SetPriority(DMA1_Channel7_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+  HAL_NVIC_SetPriority(USART2_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(USART2_IRQn);
+
+  tm_head = 0U;
+  tm_tail = 0U;
+  tm_inflight = 0U;
+  tm_busy = 0U;
+  tm_huart = huart;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Open a session: BEGIN record with the device identity.
+  * @param  age: age group selecting the scoring profile
+  * @retval None
+  */
+void Telemetry_Begin(uint8_t age)
+{
+  Telemetry_BeginTypeDef begin;
+
+  memset(&begin, 0, sizeof(begin));
+  begin.device = HAL_GetUIDw0() ^ (HAL_GetUIDw1() * 31U) ^ (HAL_GetUIDw2() * 961U);
+  begin.age = age;
+
+  tm_session++;
+  tm_dropped = 0U;
+  tm_begin_tick = HAL_GetTick();
+  Telemetry_Put(TELEMETRY_BEGIN, &begin, sizeof(begin));
+}
+
+/**
+  * @brief  SAMPLE record.
+  * @param  lux: filtered 12-bit ADC value
+  * @retval None
+  */
+void Telemetry_Sample(uint16_t lux)
+{
+  Telemetry_SampleTypeDef sample = { lux, 0U };
+
+  Telemetry_Put(TELEMETRY_SAMPLE, &sample, sizeof(sample));
+}
+
+/**
+  * @brief  ANSWER record.
+  * @param  question: 1-based question just scored
+  * @param  button: 1-based answer button
+  * @param  score: running score
+  * @param  latency_ms: press to scored delay
+  * @retval None
+  */
+void Telemetry_Answer(uint8_t question, uint8_t button, uint16_t score, uint32_t latency_ms)
+{
+  Telemetry_AnswerTypeDef answer = { question, button, score, latency_ms };
+
+  Telemetry_Put(TELEMETRY_ANSWER, &answer, sizeof(answer));
+}
+
+/**
+  * @brief  Close the session: END record.
+  * @param  session: summary; duration_ms and frames_dropped are filled in
+  * @retval None
+  */
+void Telemetry_End(Telemetry_SessionTypeDef *session)
+{
+  session->duration_ms = HAL_GetTick() - tm_begin_tick;
+  session->frames_dropped = tm_dropped;
+  Telemetry_Put(TELEMETRY_END, session, sizeof(*session));
+}
+
+/**
+  * @brief  CONTEXT record.
+  * @param  context: sensor readings when the answer was scored
+  * @retval None
+  */
+void Telemetry_Context(const Telemetry_ContextTypeDef *context)
+{
+  Telemetry_Put(TELEMETRY_CONTEXT, context, sizeof(*context));
+}
+
+/**
+  * @brief  PROFILE record.
+  * @param  profile: cycle counts of one scope
+  * @retval None
+  */
+void Telemetry_Profile(const Telemetry_ProfileTypeDef *profile)
+{
+  Telemetry_Put(TELEMETRY_PROFILE, profile, sizeof(*profile));
+}
+
+/**
+  * @brief  Start a DMA transfer of the framed bytes, if idle.
+  * @retval None
+  */
+void Telemetry_Flush(void)
+{
+  uint32_t tail;
+  uint32_t len;
+
+  if ((tm_huart == NULL) || (__atomic_exchange_n(&tm_busy, 1U, __ATOMIC_ACQUIRE) != 0U))
+  {
+    return;
+  }
+
+  /* Contiguous run up to the end of the array; the rest goes next time */
+  tail = tm_tail;
+  len = __atomic_load_n(&tm_head, __ATOMIC_ACQUIRE) - tail;
+  if (len > (TELEMETRY_RING_LEN - (tail & TELEMETRY_RING_MASK)))
+  {
+    len = TELEMETRY_RING_LEN - (tail & TELEMETRY_RING_MASK);
+  }
+
+  tm_inflight = len;
+  if ((len == 0U)
+      || (HAL_UART_Transmit_DMA(tm_huart, &tm_ring[tail & TELEMETRY_RING_MASK], (uint16_t)len) != HAL_OK))
+  {
+    tm_inflight = 0U;
+    __atomic_store_n(&tm_busy, 0U, __ATOMIC_RELEASE);
+  }
+}
+
+/**
+  * @brief  Whether bytes are waiting or in flight. The DMA and USART2 stop
+  *         in Stop2, so the power manager only sleeps meanwhile.
+  * @retval 1 while busy, 0 otherwise
+  */
+uint8_t Telemetry_Busy(void)
+{
+  return ((tm_huart != NULL) && ((tm_busy != 0U) || (tm_head != tm_tail))) ? 1U : 0U;
+}
+
+/**
+  * @brief  Release the bytes sent and continue with the next run.
+  * @param  huart: UART handle whose transmission completed
+  * @retval None
+  */
+void Telemetry_TxCpltHandler(UART_HandleTypeDef *huart)
+{
+  if (huart != tm_huart)
+  {
+    return;
+  }
+  __atomic_store_n(&tm_tail, tm_tail + tm_inflight, __ATOMIC_RELEASE);
+  tm_inflight = 0U;
+  __atomic_store_n(&tm_busy, 0U, __ATOMIC_RELEASE);
+  Telemetry_Flush();
+}
+
+/**
+  * @brief This function handles DMA1 channel7 global interrupt.
+  */
+void DMA1_Channel7_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_usart2_tx);
+}
+
+/**
+  * @brief This function handles USART2 global interrupt.
+  */
+void USART2_IRQHandler(void)
+{
+  HAL_UART_IRQHandler(tm_huart);
+}
+
+/* Frame one record into the ring, or count it as dropped */
+static void Telemetry_Put(Telemetry_TypeTypeDef type, const void *payload, uint32_t len)
+{
+  uint8_t record[TELEMETRY_RECORD_MAX];
+  uint8_t frame[TELEMETRY_FRAME_MAX];
+  Telemetry_HeaderTypeDef header;
+  uint32_t head = tm_head;
+  size_t n;
+
+  header.type = (uint8_t)type;
+  header.version = TELEMETRY_VERSION;
+  header.seq = tm_seq++;
+  header.tick = HAL_GetTick();
+  header.session = tm_session;
+  header.reserved = 0U;
+  memcpy(record, &header, sizeof(header));
+  memcpy(&record[sizeof(header)], payload, len);
+  n = Frame_Encode(record, sizeof(header) + len, frame);
+
+  if ((TELEMETRY_RING_LEN - (head - __atomic_load_n(&tm_tail, __ATOMIC_ACQUIRE))) < n)
+  {
+    tm_dropped++;
+    return;
+  }
+  for (size_t i = 0U; i < n; i++)
+  {
+    tm_ring[(head + i) & TELEMETRY_RING_MASK] = frame[i];
+  }
+  __atomic_store_n(&tm_head, head + (uint32_t)n, __ATOMIC_RELEASE);
+}
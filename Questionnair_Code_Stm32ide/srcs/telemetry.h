@@ -0,0 +1,142 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry.h
+  * @brief          : Header for telemetry.c file.
+  *                   Framed binary session telemetry streamed by DMA on
+  *                   USART2, and the record layout shared with the host
+  *                   receiver (host/telemetry_rx.c).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "frame.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define TELEMETRY_VERSION       1U
+
+/* Encoded bytes waiting for the DMA, power of two */
+#define TELEMETRY_RING_LEN      1024U
+
+/* Session result when the score fell in no band */
+#define TELEMETRY_NO_RESULT     0xFFU
+
+/* Histogram buckets of a PROFILE record, PROFILE_BUCKETS of profile.h */
+#define TELEMETRY_PROFILE_BUCKETS  8U
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  TELEMETRY_BEGIN = 1,      /* Telemetry_BeginTypeDef                      */
+  TELEMETRY_SAMPLE,         /* Telemetry_SampleTypeDef                     */
+  TELEMETRY_ANSWER,         /* Telemetry_AnswerTypeDef                     */
+  TELEMETRY_END,            /* Telemetry_SessionTypeDef                    */
+  TELEMETRY_CONTEXT,        /* Telemetry_ContextTypeDef                    */
+  TELEMETRY_PROFILE         /* Telemetry_ProfileTypeDef                    */
+} Telemetry_TypeTypeDef;
+
+/* Every record starts with this header. Records are sent as is (little
+   endian, naturally aligned, no padding), then framed by frame.c. */
+typedef struct
+{
+  uint8_t type;             /* Telemetry_TypeTypeDef                       */
+  uint8_t version;          /* TELEMETRY_VERSION                           */
+  uint16_t seq;             /* record number, gaps are lost records        */
+  uint32_t tick;            /* HAL_GetTick() when recorded                 */
+  uint16_t session;         /* sessions started since boot                 */
+  uint16_t reserved;
+} Telemetry_HeaderTypeDef;
+
+typedef struct
+{
+  uint32_t device;          /* folded 96-bit unique device ID              */
+  uint8_t age;
+  uint8_t reserved[3];
+} Telemetry_BeginTypeDef;
+
+typedef struct
+{
+  uint16_t lux;             /* filtered 12-bit ADC value                   */
+  uint16_t reserved;
+} Telemetry_SampleTypeDef;
+
+typedef struct
+{
+  uint8_t question;         /* 1-based                                     */
+  uint8_t button;           /* 1-based                                     */
+  uint16_t score;           /* running score after this answer             */
+  uint32_t latency_ms;      /* press to scored                             */
+} Telemetry_AnswerTypeDef;
+
+typedef struct
+{
+  uint8_t answers;
+  uint8_t result;           /* LedPattern_IdTypeDef or TELEMETRY_NO_RESULT */
+  uint16_t score;
+  uint32_t duration_ms;
+  uint32_t max_latency_ms;
+  uint32_t bounces;
+  uint32_t presses_dropped;
+  uint32_t frames_dropped;  /* records that did not fit the ring          */
+} Telemetry_SessionTypeDef;
+
+/* Sensor hub readings when an answer was scored */
+typedef struct
+{
+  uint8_t question;         /* 1-based, as in the ANSWER record            */
+  uint8_t valid;            /* fresh readings: 1 env, 2 field, 4 range     */
+  uint8_t presence;         /* someone in front of the board              */
+  uint8_t handled;          /* the board moved                             */
+  int16_t temperature_cdeg;
+  uint16_t humidity_permille;
+  int16_t mag_mgauss[3];
+  uint16_t range_mm;
+  uint16_t env_age_ms;      /* age of each reading, 0xFFFF: none yet       */
+  uint16_t mag_age_ms;
+  uint16_t range_age_ms;
+  uint16_t reserved;
+} Telemetry_ContextTypeDef;
+
+/* Cycle counts of one profile.c scope, sent after the END record */
+typedef struct
+{
+  uint8_t scope;            /* Profile_IdTypeDef                           */
+  uint8_t reserved[3];
+  uint32_t count;
+  uint32_t min_cycles;
+  uint32_t max_cycles;
+  uint32_t mean_cycles;
+  uint16_t histogram[TELEMETRY_PROFILE_BUCKETS];  /* saturated at 0xFFFF  */
+} Telemetry_ProfileTypeDef;
+
+/* Largest record and its encoded frame */
+#define TELEMETRY_RECORD_MAX    (sizeof(Telemetry_HeaderTypeDef) + sizeof(Telemetry_ProfileTypeDef))
+#define TELEMETRY_FRAME_MAX     FRAME_ENCODED_MAX(TELEMETRY_RECORD_MAX)
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef Telemetry_Init(UART_HandleTypeDef *huart);
+void Telemetry_Begin(uint8_t age);
+void Telemetry_Sample(uint16_t lux);
+void Telemetry_Answer(uint8_t question, uint8_t button, uint16_t score, uint32_t latency_ms);
+void Telemetry_End(Telemetry_SessionTypeDef *session);
+void Telemetry_Context(const Telemetry_ContextTypeDef *context);
+void Telemetry_Profile(const Telemetry_ProfileTypeDef *profile);
+void Telemetry_Flush(void);
+uint8_t Telemetry_Busy(void);
+
+/* Called from HAL_UART_TxCpltCallback */
+void Telemetry_TxCpltHandler(UART_HandleTypeDef *huart);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TELEMETRY_H */
@@ -0,0 +1,379 @@
+"""
+Accuracy and speed of every way this repository runs its two models, on
+the CPU and offline: the emotion CNN (Emotion_Detection_model) and the
+stimming model (AI_model_file).
+
+    python model_bench.py [--models emotion,stimming] [--fer fer2013.fer] [--weights model.h5]
+                          [--images n] [--clips n] [-o results.json] [--baseline old.json [-t percent]]
+
+emotion     the FER2013 test split (PublicTest and PrivateTest, 7178 faces)
+            of a packed file (fer_data.py), or as many generated faces
+            without one, through the Keras weights of emotion_2.py, or
+            random ones of the same shapes without h5py or model.h5,
+            quantized as convert_model.py does:
+              float          numpy float64 forward pass, the reference
+              int8-numpy     convert_model.int8_forward, the arithmetic
+                             of the kernels
+              native         emotion_net.c of the firmware through
+                             native/build/libemotion_net.so, SSE2 kernels
+              native-generic the same with the plain C kernels
+              native-avx2    the same with the AVX2 kernels, on CPUs
+                             that have them
+stimming    random clips of 40 frames through a random
+            MultimodalSSBDModel of the notebook's shape:
+              numpy          ssbd_runtime.reference, float64, the reference
+              native         native/build/libssbd_model.so (ssbd_runtime)
+              native-generic the same with the plain C kernels
+
+Each backend runs in a process of its own, one thread, and reports its
+throughput, the p50 and p99 latency of an item (the numpy backends take
+batches, and an item waits for its whole batch), its peak RSS, and how
+its predictions agree with the reference, per class as a confusion
+matrix (rows: reference class, columns: this backend's), and with the
+dataset labels when there are some. The native emotion CNN must give
+the int8 logits of int8-numpy bit for bit.
+
+-o writes the results as JSON. --baseline compares with an earlier file
+of the same items and fails when a backend agrees less with the
+reference. Its throughput, p99 latency and peak RSS depend on the
+machine: changes past REPORT_TOLERANCE percent are only reported, unless
+-t sets a tolerance past which they fail too.
+"""
+import argparse
+import ctypes
+import gc
+import json
+import os
+import pickle
+import platform
+import resource
+import sys
+import tempfile
+import time
+
+import numpy as np
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+sys.path[:0] = [os.path.join(ROOT, 'Emotion_Detection_model'), os.path.join(ROOT, 'AI_model_file')]
+
+import convert_model  # noqa: E402
+import fer_data  # noqa: E402
+import ssbd_runtime  # noqa: E402
+
+EMOTION_LIB = os.path.join(ROOT, 'Emotion_Detection_model', 'native', 'build', 'libemotion_net%s.so')
+SSBD_LIB = os.path.join(ROOT, 'AI_model_file', 'native', 'build', 'libssbd_model%s.so')
+MODELS = ('emotion', 'stimming')
+CALIB = 500                 # images for the activation ranges
+PERCENTILE = 99.99
+WARMUP = 2                  # batches run before the timing
+AGREE_SLACK = 0.002         # agreement may drop by this much
+REPORT_TOLERANCE = 25.0     # percent slower or bigger reported without -t
+SSBD_TOLERANCE = (1e-4, 1e-5)   # rtol, atol of native against numpy, as ssbd_runtime --self-check
+MALLOC_TRIM = getattr(ctypes.CDLL(None), 'malloc_trim', None)   # glibc
+
+
+class _Result(ctypes.Structure):
+    _fields_ = [('label', ctypes.c_uint8), ('logits', ctypes.c_int8 * len(fer_data.CLASSES)),
+                ('probability', ctypes.c_float * len(fer_data.CLASSES))]
+
+
+class EmotionNet:
+    """emotion_net.c with one blob; the module keeps a single network."""
+
+    def __init__(self, path, blob):
+        if not os.path.exists(path):
+            raise OSError('%s missing: run make in %s' % (path, os.path.dirname(os.path.dirname(path))))
+        self._lib = ctypes.CDLL(path)
+        self._lib.EmotionNet_Init.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+        self._lib.EmotionNet_Run.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Result)]
+        self._lib.NnKernels_Isa.restype = ctypes.c_char_p
+        # the layers point into the blob, which must stay word aligned
+        self._blob = np.frombuffer(blob, dtype=np.uint8).copy()
+        if self._lib.EmotionNet_Init(self._blob.ctypes.data, len(self._blob)):
+            raise ValueError('%s: blob rejected' % path)
+        self._result = _Result()
+        self.isa = self._lib.NnKernels_Isa().decode()
+
+    def logits(self, images):
+        out = np.zeros((len(images), len(fer_data.CLASSES)), dtype=np.int8)
+        for i, image in enumerate(images):
+            image = np.ascontiguousarray(image, dtype=np.uint8)
+            if self._lib.EmotionNet_Run(image.ctypes.data, ctypes.byref(self._result)):
+                raise ValueError('EmotionNet_Run failed')
+            out[i] = self._result.logits
+        return out
+
+
+def has_avx2():
+    try:
+        with open('/proc/cpuinfo') as f:
+            return any(line.startswith('flags') and ' avx2' in line for line in f)
+    except OSError:
+        return False
+
+
+def rss_kb():
+    with open('/proc/self/statm') as f:
+        return int(f.read().split()[1]) * (os.sysconf('SC_PAGE_SIZE') // 1024)
+
+
+def run_forked(backend, items):
+    """backend(items) -> (outputs, latencies, seconds, isa) in a child
+    process, with the child's memory use."""
+    # the child starts with the parent's resident pages: give back what
+    # the last backend freed, or the memory measured depends on it
+    gc.collect()
+    if MALLOC_TRIM is not None:
+        MALLOC_TRIM(0)
+    read, write = os.pipe()
+    pid = os.fork()
+    if pid == 0:
+        os.close(read)
+        try:
+            start = rss_kb()
+            outputs, latencies, seconds, isa = backend(items)
+            reply = {'outputs': outputs, 'latencies': latencies, 'seconds': seconds, 'isa': isa,
+                     'start_rss_kb': start,
+                     'peak_rss_kb': resource.getrusage(resource.RUSAGE_SELF).ru_maxrss}
+        except Exception as e:      # noqa: BLE001 - handed to the parent
+            reply = {'error': '%s: %s' % (type(e).__name__, e)}
+        with os.fdopen(write, 'wb') as f:
+            pickle.dump(reply, f)
+        os._exit(0)
+    os.close(write)
+    with os.fdopen(read, 'rb') as f:
+        data = f.read()
+    os.waitpid(pid, 0)
+    if not data:
+        raise ValueError('benchmark process died')
+    reply = pickle.loads(data)
+    if 'error' in reply:
+        raise ValueError(reply['error'])
+    return reply
+
+
+def timed(run, items, batch):
+    """Outputs of run over items in batches, each item's latency and the
+    time of them all."""
+    for i in range(0, min(len(items), WARMUP * batch), batch):
+        run(items[i:i + batch])
+    outputs, latencies = [], []
+    first = time.perf_counter()
+    for i in range(0, len(items), batch):
+        part = items[i:i + batch]
+        start = time.perf_counter()
+        outputs.append(run(part))
+        latencies += [time.perf_counter() - start] * len(part)
+    return np.concatenate(outputs), np.array(latencies), time.perf_counter() - first
+
+
+def summary(reply, reference, labels, classes):
+    """The record of one backend: speed, memory, agreement."""
+    lat = reply['latencies']
+    pred = np.argmax(reply['outputs'], axis=1)
+    ref = np.argmax(reference, axis=1)
+    confusion = np.zeros((classes, classes), dtype=np.int64)
+    np.add.at(confusion, (ref, pred), 1)
+    return {'isa': reply['isa'], 'items': len(lat), 'seconds': float(reply['seconds']),
+            'throughput': float(len(lat) / reply['seconds']), 'p50_ms': float(np.percentile(lat, 50) * 1e3),
+            'p99_ms': float(np.percentile(lat, 99) * 1e3), 'peak_rss_kb': int(reply['peak_rss_kb']),
+            'added_rss_kb': int(max(0, reply['peak_rss_kb'] - reply['start_rss_kb'])),
+            'agreement': float(np.mean(pred == ref)), 'confusion': confusion.tolist(),
+            'accuracy': None if labels is None else float(np.mean(pred == labels))}
+
+
+def random_layers(rng):
+    """Layers of emotion_2.py's shapes, He-initialized."""
+    layers = []
+    for i, (cin, cout) in enumerate(convert_model.SHAPES):
+        shape = (3, 3, cin, cout) if i < convert_model.CONVS else (cin, cout)
+        fan_in = int(np.prod(shape[:-1]))
+        layers.append((rng.normal(0, np.sqrt(2.0 / fan_in), shape), rng.normal(0, 0.05, cout)))
+    return layers
+
+
+def generated_faces(count, rng):
+    """Smooth 48x48 patterns with noise, for the lack of a dataset."""
+    coarse = rng.integers(0, 256, (count, 6, 6)).astype(np.float64)
+    images = np.kron(coarse, np.ones((8, 8))) + rng.normal(0, 12, (count, 48, 48))
+    return np.clip(images, 0, 255).astype(np.uint8)
+
+
+def bench_emotion(args):
+    rng = np.random.default_rng(0)
+    if args.fer:
+        images, labels = fer_data.open_packed(args.fer).split('test')
+        images, labels = np.ascontiguousarray(images[:args.images]), np.array(labels[:args.images], dtype=np.int64)
+        source = '%s test split' % args.fer
+    else:
+        images, labels = generated_faces(args.images or 7178, rng), None
+        source = 'generated'
+    if not len(images):
+        raise ValueError('no images')
+    layers = convert_model.load_weights(args.weights) if args.weights else random_layers(rng)
+    ranges, _ = convert_model.calibrate(layers, images[:CALIB], PERCENTILE)
+    quant, logit_scale, logit_zp = convert_model.quantize(layers, ranges)
+    blob = convert_model.blob(quant, logit_scale, logit_zp)
+
+    def numpy_backend(forward):
+        return lambda items: timed(forward, items, convert_model.BATCH) + ('numpy',)
+
+    def native_backend(suffix):
+        def run(items):
+            net = EmotionNet(EMOTION_LIB % suffix, blob)
+            return timed(net.logits, items, 1) + (net.isa,)
+        return run
+
+    backends = [('float', numpy_backend(lambda x: convert_model.float_forward(layers, x)[-1])),
+                ('int8-numpy', numpy_backend(lambda x: convert_model.int8_forward(quant, x))),
+                ('native', native_backend('')), ('native-generic', native_backend('_generic'))]
+    if has_avx2():
+        backends.append(('native-avx2', native_backend('_avx2')))
+
+    results, replies = {}, {}
+    for name, backend in backends:
+        replies[name] = run_forked(backend, images)
+        results[name] = summary(replies[name], replies['float']['outputs'], labels, len(fer_data.CLASSES))
+        if name.startswith('native'):
+            same = np.array_equal(replies[name]['outputs'], replies['int8-numpy']['outputs'])
+            results[name]['exact'] = bool(same)
+            if not same:
+                raise ValueError('emotion %s: int8 logits differ from int8-numpy' % name)
+        report('emotion', name, results[name])
+    return {'items': len(images), 'source': source, 'weights': args.weights or 'random',
+            'reference': 'float', 'classes': list(fer_data.CLASSES), 'backends': results}
+
+
+def bench_stimming(args, directory):
+    rng = np.random.default_rng(0)
+    dims = ssbd_runtime.NOTEBOOK
+    state = ssbd_runtime.random_state(dims, rng)
+    model = os.path.join(directory, 'bench.ssbm')
+    ssbd_runtime.write(model, dims, state)
+    frames = rng.integers(0, 256, (args.clips, dims['frames'], dims['height'], dims['width'], 3), dtype=np.uint8)
+    movenet = rng.random((args.clips, dims['frames'], dims['movenet_dim']), dtype=np.float32)
+    clips = list(zip(frames, movenet))
+
+    def numpy_backend(items):
+        def run(part):
+            return np.stack([ssbd_runtime.reference(dims, state,
+                                                    np.transpose(f, (0, 3, 1, 2)).astype(np.float32) / 255, m)
+                             for f, m in part])
+        return timed(run, items, 1) + ('numpy',)
+
+    def native_backend(suffix):
+        def bench(items):
+            ssbd_runtime.LIB = SSBD_LIB % suffix
+            with ssbd_runtime.Runtime(model) as runtime:
+                return timed(lambda part: np.stack([runtime.predict(f, m) for f, m in part]), items, 1) \
+                    + (runtime.isa,)
+        return bench
+
+    results, replies = {}, {}
+    for name, backend in (('numpy', numpy_backend), ('native', native_backend('')),
+                          ('native-generic', native_backend('_generic'))):
+        replies[name] = run_forked(backend, clips)
+        results[name] = summary(replies[name], replies['numpy']['outputs'], None, dims['classes'])
+        diff = np.abs(replies[name]['outputs'] - replies['numpy']['outputs'])
+        results[name]['max_abs_diff'] = float(diff.max())
+        if not np.allclose(replies[name]['outputs'], replies['numpy']['outputs'], *SSBD_TOLERANCE):
+            raise ValueError('stimming %s: probabilities differ from numpy by %.3g' % (name, diff.max()))
+        report('stimming', name, results[name])
+    return {'items': len(clips), 'source': 'random clips', 'weights': 'random', 'reference': 'numpy',
+            'classes': [ssbd_runtime.CLASSES[c] for c in sorted(ssbd_runtime.CLASSES)], 'backends': results}
+
+
+def report(model, name, r):
+    accuracy = '' if r['accuracy'] is None else '  labels %.1f%%' % (100.0 * r['accuracy'])
+    print('%-8s %-14s %6d items %8.1f/s  p50 %8.3f ms  p99 %8.3f ms  rss %6.1f MB  agree %6.2f%%%s  (%s)'
+          % (model, name, r['items'], r['throughput'], r['p50_ms'], r['p99_ms'], r['peak_rss_kb'] / 1024.0,
+             100.0 * r['agreement'], accuracy, r['isa']))
+    if r['agreement'] < 1.0:
+        # of the items the reference puts in each class, how many this backend does too
+        per_class = ['%.0f%%' % (100.0 * row[i] / sum(row)) if sum(row) else '-'
+                     for i, row in enumerate(r['confusion'])]
+        print('%-23s per class %s' % ('', ' '.join(per_class)))
+
+
+def compare(results, baseline, tolerance):
+    """Changes of results against baseline, as messages: agreement drops,
+    and speed and memory changes past tolerance percent."""
+    slower = 1.0 + tolerance / 100.0
+    agreement, timing, compared = [], [], 0
+    for model, old in baseline['models'].items():
+        new = results['models'].get(model)
+        if new is None:
+            continue
+        if new['items'] != old['items'] or new['source'] != old['source']:
+            raise ValueError('%s: baseline of %d items of %s, not %d of %s'
+                             % (model, old['items'], old['source'], new['items'], new['source']))
+        for name, o in old['backends'].items():
+            n = new['backends'].get(name)
+            if n is None:
+                print('%s %s: in the baseline, not run' % (model, name))
+                continue
+            compared += 1
+            if n['agreement'] < o['agreement'] - AGREE_SLACK:
+                agreement.append('%s %s: agreement %.6g, baseline %.6g'
+                                 % (model, name, n['agreement'], o['agreement']))
+            checks = (('throughput', n['throughput'] < o['throughput'] / slower),
+                      ('p99_ms', n['p99_ms'] > o['p99_ms'] * slower),
+                      ('peak_rss_kb', n['peak_rss_kb'] > o['peak_rss_kb'] * slower))
+            timing += ['%s %s: %s %.6g, baseline %.6g' % (model, name, key, n[key], o[key])
+                       for key, bad in checks if bad]
+    return agreement, timing, compared
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument('--models', default=','.join(MODELS), help='comma-separated, of %s' % ', '.join(MODELS))
+    ap.add_argument('--fer', help='packed FER2013 file (fer_data.py); generated faces without it')
+    ap.add_argument('--weights', help='Keras weights of emotion_2.py; random ones without them')
+    ap.add_argument('--images', type=int, default=0, help='emotion images, 0 for the whole test split')
+    ap.add_argument('--clips', type=int, default=32, help='stimming clips')
+    ap.add_argument('-o', '--out', help='write the results as JSON')
+    ap.add_argument('--baseline', help='results of an earlier run to compare with')
+    ap.add_argument('-t', '--tolerance', type=float,
+                    help='also fail a backend this many percent slower or bigger than the baseline')
+    args = ap.parse_args()
+
+    models = [m for m in args.models.split(',') if m]
+    for m in models:
+        if m not in MODELS:
+            raise ValueError('unknown model %s, not one of %s' % (m, ', '.join(MODELS)))
+    if args.clips < 1 or args.images < 0:
+        raise ValueError('--clips must be positive and --images not negative')
+
+    results = {'host': {'machine': platform.machine(), 'cpus': os.cpu_count(), 'python': platform.python_version(),
+                        'numpy': np.__version__}, 'models': {}}
+    if 'emotion' in models:
+        results['models']['emotion'] = bench_emotion(args)
+    if 'stimming' in models:
+        with tempfile.TemporaryDirectory() as directory:
+            results['models']['stimming'] = bench_stimming(args, directory)
+
+    if args.out:
+        with open(args.out + '.tmp', 'w') as f:
+            json.dump(results, f, indent=1)
+        os.replace(args.out + '.tmp', args.out)
+    if args.baseline:
+        tolerance = REPORT_TOLERANCE if args.tolerance is None else args.tolerance
+        with open(args.baseline) as f:
+            agreement, timing, compared = compare(results, json.load(f), tolerance)
+        if timing:
+            print('more than %g%% slower or bigger than %s:\n  %s'
+                  % (tolerance, args.baseline, '\n  '.join(timing)))
+        failed = agreement + (timing if args.tolerance is not None else [])
+        if failed:
+            sys.exit('regressions against %s:\n  %s' % (args.baseline, '\n  '.join(failed)))
+        if args.tolerance is None:
+            print('%d backends agree with %s' % (compared, args.baseline))
+        else:
+            print('%d backends agree with %s, within %g%%' % (compared, args.baseline, args.tolerance))
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except (ValueError, OSError) as e:
+        sys.exit(str(e))